@@ -10,6 +10,7 @@
 #include <SDL3/SDL_stdinc.h>
 #include <SDL3/SDL_log.h>
 #include <cglm/cglm.h>
+#include <EGL/EGL_transform.h>
 
 
 typedef versor quat;
@@ -60,19 +61,38 @@ static inline void EGL_TransformCopy(Transform *src, Transform *dest) {
 /**
  * Rotate the transform by an angle in radians about an axis through its center.
  *
+ * The rotation is applied to the quaternion and the model is rebuilt from it,
+ * so repeated calls do not accumulate error through the matrix. Use
+ * EGL_TransformIntegrate for per-tick spinning, which skips the trig, the
+ * square root and the model rebuild.
+ *
  * @param t Transform
  * @param angle Angle (radians)
  * @param axis The axis relative to the center of the transform.
  */
 static inline void EGL_TransformRotate(Transform *t, float angle, vec3 axis) {
-	glm_rotate(t->model, angle, axis);
-	glm_mat4_quat(t->model, t->rotation);
-	glm_vec3_copy(t->translation, t->model[3]);
+	EGL_QuatRotate(t->rotation, angle, axis);
+	EGL_QuatNormalize(t->rotation);
+	EGL_TransformUpdate(t);
+}
+
+/**
+ * Integrate an angular velocity over one fixed step (see EGL_QuatIntegrate).
+ *
+ * Only the rotation changes; call EGL_TransformUpdate before using the model,
+ * and renormalize the rotation every EGL_QUAT_RENORMALIZE_STEPS steps.
+ *
+ * @param t Transform
+ * @param omega Angular velocity about each axis relative to the center of the transform.
+ * @param dt The step.
+ */
+static inline void EGL_TransformIntegrate(Transform *t, vec3 omega, float dt) {
+	EGL_QuatIntegrate(t->rotation, omega, dt);
 }
 
 /** Print all data held by the transform for debugging. */
 static inline void EGL_TransformPrint(Transform *t) {
-	char *log = (char *)SDL_malloc(sizeof(char) * 1024);
+	char log[1024];
 	char line[64];
 
 	line[0] = '\0';
@@ -103,7 +123,6 @@ static inline void EGL_TransformPrint(Transform *t) {
 	}
 
 	SDL_Log("%s", log);
-	SDL_free(log);
 }
 
 
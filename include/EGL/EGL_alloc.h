@@ -0,0 +1,104 @@
+/**
+ * @file EGL_alloc.h
+ * @brief Allocation tracker: counts every allocation by thread and by frame, and where it came from in debug builds.
+ *
+ * The tracker is a set of malloc, calloc, realloc and free functions that
+ * count each call and forward it to the functions given to EGL_AllocWrap.
+ * Install it in front of SDL's allocator with
+ *
+ *     SDL_malloc_func m; SDL_calloc_func c; SDL_realloc_func r; SDL_free_func f;
+ *     SDL_GetOriginalMemoryFunctions(&m, &c, &r, &f);
+ *     EGL_AllocWrap(m, c, r, f);
+ *     SDL_SetMemoryFunctions(EGL_AllocMalloc, EGL_AllocCalloc, EGL_AllocRealloc, EGL_AllocFree);
+ *
+ * and in front of EGL's (EGL_memory.h), which EGL modules allocate through
+ * instead of calling the C library:
+ *
+ *     EGL_SetMemoryFunctions(EGL_AllocMalloc, EGL_AllocCalloc, EGL_AllocRealloc, EGL_AllocFree);
+ *
+ * Since every call reaches the same allocator as before, memory allocated
+ * before the tracker was installed can be freed through it and the other way
+ * around.
+ *
+ * Each thread counts into its own counters, so counting never contends. In
+ * debug builds (without NDEBUG) on glibc, each allocation also records the
+ * call stack that made it, so a frame that should not allocate can say where
+ * it did. Stacks are collected under a lock and cost a few microseconds each.
+ */
+
+#ifndef EGL_ALLOC_H
+#define EGL_ALLOC_H
+
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <EGL/EGL_memory.h>
+
+
+#if !defined(NDEBUG) && !defined(EGL_ALLOC_NO_SITES)
+#define EGL_ALLOC_SITES // Record the call stack of each allocation.
+#endif
+
+#define EGL_ALLOC_SITE_DEPTH 8   // Stack frames kept per call site.
+#define EGL_ALLOC_SITES_MAX 256  // Distinct call sites kept per frame; more count as dropped.
+
+
+typedef struct {
+	uint64_t allocs; /**< malloc, calloc and realloc calls. */
+	uint64_t frees;  /**< free calls with a pointer that is not NULL. */
+	uint64_t bytes;  /**< Bytes asked for by the allocations. */
+} EGL_AllocCounts;
+
+/** The call stack that made allocations, innermost frame first. */
+typedef struct {
+	void *frames[EGL_ALLOC_SITE_DEPTH];
+	int depth;
+	uint64_t allocs;
+	uint64_t bytes;
+} EGL_AllocSite;
+
+
+/**
+ * Set the functions the tracker forwards to. Call before any allocation goes
+ * through the tracker. Without a call, the tracker forwards to the C library.
+ */
+void EGL_AllocWrap(EGL_MallocFunc malloc_func, EGL_CallocFunc calloc_func, EGL_ReallocFunc realloc_func, EGL_FreeFunc free_func);
+
+void *EGL_AllocMalloc(size_t size);
+void *EGL_AllocCalloc(size_t count, size_t size);
+void *EGL_AllocRealloc(void *memory, size_t size);
+void EGL_AllocFree(void *memory);
+
+/** Get what the calling thread has allocated since it first allocated. */
+void EGL_AllocThreadCounts(EGL_AllocCounts *counts);
+
+/** Get what every thread has allocated since the tracker started. */
+void EGL_AllocTotalCounts(EGL_AllocCounts *counts);
+
+/**
+ * End a frame: get what every thread allocated since the previous call, and
+ * keep the frame's call sites for EGL_AllocSites while the next frame records
+ * its own. Call from one thread, once a frame.
+ *
+ * @param counts The frame's allocations.
+ */
+void EGL_AllocFrame(EGL_AllocCounts *counts);
+
+/**
+ * Get the call sites of the frame the last EGL_AllocFrame ended, most
+ * allocations first. Always 0 without EGL_ALLOC_SITES.
+ *
+ * @param sites Filled with up to max sites.
+ * @param max The room in sites.
+ * @return The number of sites written.
+ */
+size_t EGL_AllocSites(EGL_AllocSite *sites, size_t max);
+
+/** Print up to max call sites of the frame the last EGL_AllocFrame ended, with symbols where they can be found. */
+void EGL_AllocPrintSites(FILE *f, size_t max);
+
+
+#endif /* EGL_ALLOC_H */
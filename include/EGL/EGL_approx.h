@@ -0,0 +1,433 @@
+/**
+ * @file EGL_approx.h
+ * @brief Fast polynomial approximations of trig and transcendental functions.
+ *
+ * Each function comes in a scalar form, a 4-wide form on EGL_Vec4 and an
+ * 8-wide form on EGL_Floatx8, all evaluating the same polynomials, so a lane
+ * gives the same answer whichever form computed it. The polynomials are the
+ * Cephes single precision ones (S. Moshier); the argument reductions are
+ * rewritten without branches so the SIMD forms need no per-lane fallbacks.
+ *
+ * Errors are the largest seen sweeping float bit patterns against double
+ * precision libm, in units in the last place of the exact result:
+ *
+ *   EGL_FastSin, EGL_FastCos  1.6 ulp on [-pi, pi]. For |x| up to 8192 the
+ *                             absolute error stays below 1e-7, but near the
+ *                             zeros the ulp error grows (14 ulp by 100, 1000
+ *                             by 8192) because the reduction keeps only
+ *                             three parts of pi/2. Beyond that, use libm.
+ *   EGL_FastAtan2             3.2 ulp for finite inputs.
+ *   EGL_FastAcos              1.3 ulp on [-1, 1], NaN outside.
+ *   EGL_FastExp               1.3 ulp while the result is a normal float;
+ *                             0 below -103.97, infinity above 88.72.
+ *   EGL_FastLog               0.9 ulp for positive inputs including
+ *                             subnormals; -inf at 0, NaN below.
+ *
+ * libm is still the right call when exact IEEE behaviour for infinities and
+ * NaNs matters; these are for hot loops.
+ */
+
+#ifndef EGL_APPROX_H
+#define EGL_APPROX_H
+
+
+#include <EGL/EGL_math.h>
+
+#include <float.h>
+#include <stdint.h>
+#include <string.h>
+
+
+#define EGL_APPROX_PI      3.14159265358979f
+#define EGL_APPROX_PI_2    1.57079632679490f
+#define EGL_APPROX_PI_4    0.78539816339745f
+#define EGL_APPROX_2_PI    0.63661977236758f
+#define EGL_APPROX_LOG2E   1.44269504088896f
+#define EGL_APPROX_SQRT1_2 0.70710678118655f
+#define EGL_APPROX_TAN_PI_8 0.41421356237310f
+
+/* pi/2 and ln 2 split so the high parts times a small integer are exact */
+#define EGL_APPROX_PI_2_A 1.5703125f
+#define EGL_APPROX_PI_2_B 4.837512969970703125e-4f
+#define EGL_APPROX_PI_2_C 7.54978995489188216e-8f
+#define EGL_APPROX_LN2_A  0.693359375f
+#define EGL_APPROX_LN2_B  -2.12194440e-4f
+
+#define EGL_APPROX_EXP_MAX 88.7228317f
+#define EGL_APPROX_EXP_MIN -103.972084f
+
+/* Adding and subtracting 1.5 * 2^23 rounds to the nearest integer, like cvtps2dq */
+#define EGL_APPROX_ROUNDER 12582912.0f
+
+
+static inline uint32_t EGL_ApproxBits(float f) {
+	uint32_t u;
+	memcpy(&u, &f, sizeof(u));
+	return u;
+}
+
+static inline float EGL_ApproxFloat(uint32_t u) {
+	float f;
+	memcpy(&f, &u, sizeof(f));
+	return f;
+}
+
+static inline float EGL_ApproxSinPoly(float r, float r2) {
+	return r + r * r2 * (-1.6666654611e-1f + r2 * (8.3321608736e-3f + r2 * -1.9515295891e-4f));
+}
+
+static inline float EGL_ApproxCosPoly(float r2) {
+	return 1.0f - 0.5f * r2 + r2 * r2 * (4.166664568298827e-2f + r2 * (-1.388731625493765e-3f + r2 * 2.443315711809948e-5f));
+}
+
+/* atan on [0, 1] */
+static inline float EGL_ApproxAtanUnit(float t) {
+	const int big = t > EGL_APPROX_TAN_PI_8;
+	const float offset = big ? EGL_APPROX_PI_4 : 0.0f;
+	t = big ? (t - 1.0f) / (t + 1.0f) : t;
+	const float z = t * t;
+	return offset + t + t * z * (((8.05374449538e-2f * z - 1.38776856032e-1f) * z + 1.99777106478e-1f) * z - 3.33329491539e-1f);
+}
+
+/* asin on [-0.5, 0.5], given z = x^2 */
+static inline float EGL_ApproxAsinPoly(float x, float z) {
+	return x + x * z * ((((4.2163199048e-2f * z + 2.4181311049e-2f) * z + 4.5470025998e-2f) * z + 7.4953002686e-2f) * z + 1.6666752422e-1f);
+}
+
+static inline float EGL_ApproxLogPoly(float x) {
+	return ((((((((7.0376836292e-2f * x - 1.1514610310e-1f) * x + 1.1676998740e-1f) * x - 1.2420140846e-1f) * x + 1.4249322787e-1f) * x
+		- 1.6668057665e-1f) * x + 2.0000714765e-1f) * x - 2.4999993993e-1f) * x + 3.3333331174e-1f);
+}
+
+static inline float EGL_ApproxExpPoly(float r) {
+	return (((((1.9875691500e-4f * r + 1.3981999507e-3f) * r + 8.3334519073e-3f) * r + 4.1665795894e-2f) * r + 1.6666665459e-1f) * r + 5.0000001201e-1f);
+}
+
+
+/* Scalar */
+
+/** Sine and cosine of x in radians, sharing the argument reduction. */
+static inline void EGL_FastSinCos(float x, float *s, float *c) {
+	const float j = (x * EGL_APPROX_2_PI + EGL_APPROX_ROUNDER) - EGL_APPROX_ROUNDER;
+	const int32_t q = (fabsf(j) < 2147483648.0f) ? (int32_t)j : 0; // NaN and huge inputs must not convert.
+	const float r = ((x - j * EGL_APPROX_PI_2_A) - j * EGL_APPROX_PI_2_B) - j * EGL_APPROX_PI_2_C;
+	const float r2 = r * r;
+	const float sp = EGL_ApproxSinPoly(r, r2);
+	const float cp = EGL_ApproxCosPoly(r2);
+
+	/* x = r + q pi/2: odd quadrants swap sine and cosine, then the signs follow the quadrant */
+	const float sv = (q & 1) ? cp : sp;
+	const float cv = (q & 1) ? sp : cp;
+	*s = EGL_ApproxFloat(EGL_ApproxBits(sv) ^ ((uint32_t)(q & 2) << 30));
+	*c = EGL_ApproxFloat(EGL_ApproxBits(cv) ^ ((uint32_t)((q + 1) & 2) << 30));
+}
+
+static inline float EGL_FastSin(float x) {
+	float s, c;
+	EGL_FastSinCos(x, &s, &c);
+	return s;
+}
+
+static inline float EGL_FastCos(float x) {
+	float s, c;
+	EGL_FastSinCos(x, &s, &c);
+	return c;
+}
+
+/** Angle of (x, y) in [-pi, pi], like atan2f. */
+static inline float EGL_FastAtan2(float y, float x) {
+	const float ax = fabsf(x);
+	const float ay = fabsf(y);
+	const float mx = (ax < ay) ? ay : ax;
+	const float mn = (ax < ay) ? ax : ay;
+	float a = EGL_ApproxAtanUnit((mx > 0.0f) ? mn / mx : 0.0f);
+	a = (ay > ax) ? EGL_APPROX_PI_2 - a : a;
+	a = (EGL_ApproxBits(x) >> 31) ? EGL_APPROX_PI - a : a;
+	a = EGL_ApproxFloat(EGL_ApproxBits(a) | (EGL_ApproxBits(y) & 0x80000000u));
+	return (x != x || y != y) ? x + y : a;
+}
+
+static inline float EGL_FastAcos(float x) {
+	const float ax = fabsf(x);
+	/* Near +-1, acos |x| = 2 asin sqrt((1 - |x|) / 2) keeps the precision */
+	const float z_big = 0.5f * (1.0f - ax);
+	const float s = sqrtf(z_big);
+	const float big = 2.0f * EGL_ApproxAsinPoly(s, z_big);
+	const float small = EGL_APPROX_PI_2 - EGL_ApproxAsinPoly(x, x * x);
+	return (ax > 0.5f) ? ((x < 0.0f) ? EGL_APPROX_PI - big : big) : small;
+}
+
+static inline float EGL_FastExp(float x) {
+	/* Clamp first so the integer conversion cannot overflow (NaN clamps too, and is put back below) */
+	const float v = (x > 200.0f) ? 200.0f : (x >= -200.0f) ? x : -200.0f;
+	const float j = (v * EGL_APPROX_LOG2E + EGL_APPROX_ROUNDER) - EGL_APPROX_ROUNDER;
+	const float r = (v - j * EGL_APPROX_LN2_A) - j * EGL_APPROX_LN2_B;
+	const float p = 1.0f + r + r * r * EGL_ApproxExpPoly(r);
+
+	/* 2^n in two halves, so results down to the subnormals and up to FLT_MAX work */
+	int32_t n = (int32_t)j;
+	n = (n < -150) ? -150 : (n > 128) ? 128 : n;
+	const int32_t n1 = n >> 1;
+	const float y = p * EGL_ApproxFloat((uint32_t)(n1 + 127) << 23) * EGL_ApproxFloat((uint32_t)(n - n1 + 127) << 23);
+	return (x > EGL_APPROX_EXP_MAX) ? INFINITY : (x < EGL_APPROX_EXP_MIN) ? 0.0f : (x == x) ? y : x;
+}
+
+static inline float EGL_FastLog(float x) {
+	/* Bring subnormals up to normal range first */
+	const int subnormal = x < FLT_MIN;
+	const uint32_t u = EGL_ApproxBits(subnormal ? x * 8388608.0f : x);
+	float e = (float)((int32_t)((u >> 23) & 0xff) - 126 - (subnormal ? 23 : 0));
+	float m = EGL_ApproxFloat((u & 0x007fffffu) | 0x3f000000u); // In [0.5, 1).
+
+	/* Centre the mantissa on 1: [sqrt(1/2), sqrt(2)) */
+	const int low = m < EGL_APPROX_SQRT1_2;
+	e = low ? e - 1.0f : e;
+	m = (low ? m + m : m) - 1.0f;
+
+	const float z = m * m;
+	float y = m * z * EGL_ApproxLogPoly(m) + e * EGL_APPROX_LN2_B - 0.5f * z;
+	y = (m + y) + e * EGL_APPROX_LN2_A;
+	return (x == 0.0f) ? -INFINITY : !(x >= 0.0f) ? NAN : (x == INFINITY) ? INFINITY : y;
+}
+
+
+/* 4-wide */
+
+#ifdef EGL_MATH_SSE
+static inline __m128 EGL_ApproxSelect(__m128 mask, __m128 a, __m128 b) {
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+static inline __m128 EGL_ApproxPoly(__m128 x, const float *c, int n) {
+	__m128 r = _mm_set1_ps(c[0]);
+	for (int k = 1; k < n; k++) {
+		r = _mm_add_ps(_mm_mul_ps(r, x), _mm_set1_ps(c[k]));
+	}
+	return r;
+}
+
+static inline __m128 EGL_ApproxAtanUnit4(__m128 t) {
+	static const float c[4] = { 8.05374449538e-2f, -1.38776856032e-1f, 1.99777106478e-1f, -3.33329491539e-1f };
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 big = _mm_cmpgt_ps(t, _mm_set1_ps(EGL_APPROX_TAN_PI_8));
+	const __m128 offset = _mm_and_ps(big, _mm_set1_ps(EGL_APPROX_PI_4));
+	t = EGL_ApproxSelect(big, _mm_div_ps(_mm_sub_ps(t, one), _mm_add_ps(t, one)), t);
+	const __m128 z = _mm_mul_ps(t, t);
+	return _mm_add_ps(_mm_add_ps(offset, t), _mm_mul_ps(_mm_mul_ps(t, z), EGL_ApproxPoly(z, c, 4)));
+}
+
+static inline __m128 EGL_ApproxAsinPoly4(__m128 x, __m128 z) {
+	static const float c[5] = { 4.2163199048e-2f, 2.4181311049e-2f, 4.5470025998e-2f, 7.4953002686e-2f, 1.6666752422e-1f };
+	return _mm_add_ps(x, _mm_mul_ps(_mm_mul_ps(x, z), EGL_ApproxPoly(z, c, 5)));
+}
+#endif
+
+static inline void EGL_FastSinCos4(EGL_Vec4 x, EGL_Vec4 *s, EGL_Vec4 *c) {
+#ifdef EGL_MATH_SSE
+	const __m128i q = _mm_cvtps_epi32(_mm_mul_ps(x.simd, _mm_set1_ps(EGL_APPROX_2_PI)));
+	const __m128 j = _mm_cvtepi32_ps(q);
+	__m128 r = _mm_sub_ps(x.simd, _mm_mul_ps(j, _mm_set1_ps(EGL_APPROX_PI_2_A)));
+	r = _mm_sub_ps(r, _mm_mul_ps(j, _mm_set1_ps(EGL_APPROX_PI_2_B)));
+	r = _mm_sub_ps(r, _mm_mul_ps(j, _mm_set1_ps(EGL_APPROX_PI_2_C)));
+	const __m128 r2 = _mm_mul_ps(r, r);
+
+	static const float sc[3] = { -1.9515295891e-4f, 8.3321608736e-3f, -1.6666654611e-1f };
+	static const float cc[3] = { 2.443315711809948e-5f, -1.388731625493765e-3f, 4.166664568298827e-2f };
+	const __m128 sp = _mm_add_ps(r, _mm_mul_ps(_mm_mul_ps(r, r2), EGL_ApproxPoly(r2, sc, 3)));
+	const __m128 cp = _mm_add_ps(_mm_sub_ps(_mm_set1_ps(1.0f), _mm_mul_ps(_mm_set1_ps(0.5f), r2)), _mm_mul_ps(_mm_mul_ps(r2, r2), EGL_ApproxPoly(r2, cc, 3)));
+
+	const __m128i one = _mm_set1_epi32(1);
+	const __m128i two = _mm_set1_epi32(2);
+	const __m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(q, one), one));
+	const __m128 sin_sign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(q, two), 30));
+	const __m128 cos_sign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(q, one), two), 30));
+	s->simd = _mm_xor_ps(EGL_ApproxSelect(swap, cp, sp), sin_sign);
+	c->simd = _mm_xor_ps(EGL_ApproxSelect(swap, sp, cp), cos_sign);
+#else
+	for (int k = 0; k < 4; k++) {
+		EGL_FastSinCos(x.array[k], &s->array[k], &c->array[k]);
+	}
+#endif
+}
+
+static inline EGL_Vec4 EGL_FastSin4(EGL_Vec4 x) {
+	EGL_Vec4 s, c;
+	EGL_FastSinCos4(x, &s, &c);
+	return s;
+}
+
+static inline EGL_Vec4 EGL_FastCos4(EGL_Vec4 x) {
+	EGL_Vec4 s, c;
+	EGL_FastSinCos4(x, &s, &c);
+	return c;
+}
+
+static inline EGL_Vec4 EGL_FastAtan24(EGL_Vec4 y, EGL_Vec4 x) {
+	EGL_Vec4 r;
+#ifdef EGL_MATH_SSE
+	const __m128 sign = _mm_set1_ps(-0.0f);
+	const __m128 ax = _mm_andnot_ps(sign, x.simd);
+	const __m128 ay = _mm_andnot_ps(sign, y.simd);
+	const __m128 mx = _mm_max_ps(ax, ay);
+	const __m128 mn = _mm_min_ps(ax, ay);
+	const __m128 t = _mm_and_ps(_mm_cmpgt_ps(mx, _mm_setzero_ps()), _mm_div_ps(mn, mx));
+	__m128 a = EGL_ApproxAtanUnit4(t);
+	a = EGL_ApproxSelect(_mm_cmpgt_ps(ay, ax), _mm_sub_ps(_mm_set1_ps(EGL_APPROX_PI_2), a), a);
+	const __m128 x_negative = _mm_castsi128_ps(_mm_srai_epi32(_mm_castps_si128(x.simd), 31));
+	a = EGL_ApproxSelect(x_negative, _mm_sub_ps(_mm_set1_ps(EGL_APPROX_PI), a), a);
+	a = _mm_or_ps(a, _mm_and_ps(sign, y.simd));
+	/* A NaN in either input gives NaN, as atan2f does */
+	r.simd = _mm_or_ps(a, _mm_cmpunord_ps(x.simd, y.simd));
+#else
+	for (int k = 0; k < 4; k++) {
+		r.array[k] = EGL_FastAtan2(y.array[k], x.array[k]);
+	}
+#endif
+	return r;
+}
+
+static inline EGL_Vec4 EGL_FastAcos4(EGL_Vec4 x) {
+	EGL_Vec4 r;
+#ifdef EGL_MATH_SSE
+	const __m128 ax = _mm_andnot_ps(_mm_set1_ps(-0.0f), x.simd);
+	const __m128 z_big = _mm_mul_ps(_mm_set1_ps(0.5f), _mm_sub_ps(_mm_set1_ps(1.0f), ax));
+	const __m128 s = _mm_sqrt_ps(z_big);
+	__m128 big = _mm_mul_ps(_mm_set1_ps(2.0f), EGL_ApproxAsinPoly4(s, z_big));
+	big = EGL_ApproxSelect(_mm_cmplt_ps(x.simd, _mm_setzero_ps()), _mm_sub_ps(_mm_set1_ps(EGL_APPROX_PI), big), big);
+	const __m128 small = _mm_sub_ps(_mm_set1_ps(EGL_APPROX_PI_2), EGL_ApproxAsinPoly4(x.simd, _mm_mul_ps(x.simd, x.simd)));
+	r.simd = EGL_ApproxSelect(_mm_cmpgt_ps(ax, _mm_set1_ps(0.5f)), big, small);
+#else
+	for (int k = 0; k < 4; k++) {
+		r.array[k] = EGL_FastAcos(x.array[k]);
+	}
+#endif
+	return r;
+}
+
+static inline EGL_Vec4 EGL_FastExp4(EGL_Vec4 x) {
+	EGL_Vec4 r;
+#ifdef EGL_MATH_SSE
+	static const float c[6] = { 1.9875691500e-4f, 1.3981999507e-3f, 8.3334519073e-3f, 4.1665795894e-2f, 1.6666665459e-1f, 5.0000001201e-1f };
+	/* Clamp first so the integer conversion cannot overflow (NaN clamps too, and is put back below) */
+	const __m128 v = _mm_max_ps(_mm_min_ps(x.simd, _mm_set1_ps(200.0f)), _mm_set1_ps(-200.0f));
+	__m128i n = _mm_cvtps_epi32(_mm_mul_ps(v, _mm_set1_ps(EGL_APPROX_LOG2E)));
+	const __m128 j = _mm_cvtepi32_ps(n);
+	__m128 t = _mm_sub_ps(v, _mm_mul_ps(j, _mm_set1_ps(EGL_APPROX_LN2_A)));
+	t = _mm_sub_ps(t, _mm_mul_ps(j, _mm_set1_ps(EGL_APPROX_LN2_B)));
+	const __m128 p = _mm_add_ps(_mm_add_ps(_mm_set1_ps(1.0f), t), _mm_mul_ps(_mm_mul_ps(t, t), EGL_ApproxPoly(t, c, 6)));
+
+	/* SSE2 has no 32-bit integer min and max; n is in range once x is, and lanes outside are replaced below */
+	const __m128i bias = _mm_set1_epi32(127);
+	const __m128i n1 = _mm_srai_epi32(n, 1);
+	const __m128 scale1 = _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(n1, bias), 23));
+	const __m128 scale2 = _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(_mm_sub_epi32(n, n1), bias), 23));
+	__m128 y = _mm_mul_ps(_mm_mul_ps(p, scale1), scale2);
+	y = EGL_ApproxSelect(_mm_cmpgt_ps(x.simd, _mm_set1_ps(EGL_APPROX_EXP_MAX)), _mm_set1_ps(INFINITY), y);
+	y = _mm_andnot_ps(_mm_cmplt_ps(x.simd, _mm_set1_ps(EGL_APPROX_EXP_MIN)), y);
+	r.simd = EGL_ApproxSelect(_mm_cmpunord_ps(x.simd, x.simd), x.simd, y);
+#else
+	for (int k = 0; k < 4; k++) {
+		r.array[k] = EGL_FastExp(x.array[k]);
+	}
+#endif
+	return r;
+}
+
+static inline EGL_Vec4 EGL_FastLog4(EGL_Vec4 x) {
+	EGL_Vec4 r;
+#ifdef EGL_MATH_SSE
+	static const float c[9] = {
+		7.0376836292e-2f, -1.1514610310e-1f, 1.1676998740e-1f, -1.2420140846e-1f, 1.4249322787e-1f,
+		-1.6668057665e-1f, 2.0000714765e-1f, -2.4999993993e-1f, 3.3333331174e-1f,
+	};
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 subnormal = _mm_cmplt_ps(x.simd, _mm_set1_ps(FLT_MIN));
+	const __m128i u = _mm_castps_si128(EGL_ApproxSelect(subnormal, _mm_mul_ps(x.simd, _mm_set1_ps(8388608.0f)), x.simd));
+	__m128 e = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_and_si128(_mm_srli_epi32(u, 23), _mm_set1_epi32(0xff)), _mm_set1_epi32(126)));
+	e = _mm_sub_ps(e, _mm_and_ps(subnormal, _mm_set1_ps(23.0f)));
+	__m128 m = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(u, _mm_set1_epi32(0x007fffff)), _mm_set1_epi32(0x3f000000)));
+
+	const __m128 low = _mm_cmplt_ps(m, _mm_set1_ps(EGL_APPROX_SQRT1_2));
+	e = _mm_sub_ps(e, _mm_and_ps(low, one));
+	m = _mm_sub_ps(_mm_add_ps(m, _mm_and_ps(low, m)), one);
+
+	const __m128 z = _mm_mul_ps(m, m);
+	__m128 y = _mm_mul_ps(_mm_mul_ps(m, z), EGL_ApproxPoly(m, c, 9));
+	y = _mm_add_ps(y, _mm_mul_ps(e, _mm_set1_ps(EGL_APPROX_LN2_B)));
+	y = _mm_sub_ps(y, _mm_mul_ps(_mm_set1_ps(0.5f), z));
+	y = _mm_add_ps(_mm_add_ps(m, y), _mm_mul_ps(e, _mm_set1_ps(EGL_APPROX_LN2_A)));
+
+	y = EGL_ApproxSelect(_mm_cmpeq_ps(x.simd, _mm_set1_ps(INFINITY)), x.simd, y);
+	y = EGL_ApproxSelect(_mm_cmpeq_ps(x.simd, _mm_setzero_ps()), _mm_set1_ps(-INFINITY), y);
+	r.simd = _mm_or_ps(y, _mm_cmpnge_ps(x.simd, _mm_setzero_ps())); // All ones is a NaN.
+#else
+	for (int k = 0; k < 4; k++) {
+		r.array[k] = EGL_FastLog(x.array[k]);
+	}
+#endif
+	return r;
+}
+
+
+/* 8-wide, as two 4-wide halves */
+
+static inline EGL_Vec4 EGL_ApproxHalf(EGL_Floatx8 x, int half) {
+	EGL_Vec4 r;
+#if defined(EGL_MATH_AVX)
+	r.simd = half ? _mm256_extractf128_ps(x.v, 1) : _mm256_castps256_ps128(x.v);
+#elif defined(EGL_MATH_SSE)
+	r.simd = half ? x.hi : x.lo;
+#else
+	memcpy(r.array, x.f + 4 * half, sizeof(r.array));
+#endif
+	return r;
+}
+
+static inline EGL_Floatx8 EGL_ApproxJoin(EGL_Vec4 lo, EGL_Vec4 hi) {
+	EGL_Floatx8 r;
+#if defined(EGL_MATH_AVX)
+	r.v = _mm256_insertf128_ps(_mm256_castps128_ps256(lo.simd), hi.simd, 1);
+#elif defined(EGL_MATH_SSE)
+	r.lo = lo.simd;
+	r.hi = hi.simd;
+#else
+	memcpy(r.f, lo.array, sizeof(lo.array));
+	memcpy(r.f + 4, hi.array, sizeof(hi.array));
+#endif
+	return r;
+}
+
+static inline void EGL_FastSinCos8(EGL_Floatx8 x, EGL_Floatx8 *s, EGL_Floatx8 *c) {
+	EGL_Vec4 s0, c0, s1, c1;
+	EGL_FastSinCos4(EGL_ApproxHalf(x, 0), &s0, &c0);
+	EGL_FastSinCos4(EGL_ApproxHalf(x, 1), &s1, &c1);
+	*s = EGL_ApproxJoin(s0, s1);
+	*c = EGL_ApproxJoin(c0, c1);
+}
+
+static inline EGL_Floatx8 EGL_FastSin8(EGL_Floatx8 x) {
+	return EGL_ApproxJoin(EGL_FastSin4(EGL_ApproxHalf(x, 0)), EGL_FastSin4(EGL_ApproxHalf(x, 1)));
+}
+
+static inline EGL_Floatx8 EGL_FastCos8(EGL_Floatx8 x) {
+	return EGL_ApproxJoin(EGL_FastCos4(EGL_ApproxHalf(x, 0)), EGL_FastCos4(EGL_ApproxHalf(x, 1)));
+}
+
+static inline EGL_Floatx8 EGL_FastAtan28(EGL_Floatx8 y, EGL_Floatx8 x) {
+	return EGL_ApproxJoin(EGL_FastAtan24(EGL_ApproxHalf(y, 0), EGL_ApproxHalf(x, 0)), EGL_FastAtan24(EGL_ApproxHalf(y, 1), EGL_ApproxHalf(x, 1)));
+}
+
+static inline EGL_Floatx8 EGL_FastAcos8(EGL_Floatx8 x) {
+	return EGL_ApproxJoin(EGL_FastAcos4(EGL_ApproxHalf(x, 0)), EGL_FastAcos4(EGL_ApproxHalf(x, 1)));
+}
+
+static inline EGL_Floatx8 EGL_FastExp8(EGL_Floatx8 x) {
+	return EGL_ApproxJoin(EGL_FastExp4(EGL_ApproxHalf(x, 0)), EGL_FastExp4(EGL_ApproxHalf(x, 1)));
+}
+
+static inline EGL_Floatx8 EGL_FastLog8(EGL_Floatx8 x) {
+	return EGL_ApproxJoin(EGL_FastLog4(EGL_ApproxHalf(x, 0)), EGL_FastLog4(EGL_ApproxHalf(x, 1)));
+}
+
+
+#endif /* EGL_APPROX_H */
@@ -0,0 +1,170 @@
+/**
+ * @file EGL_arena.h
+ * @brief Linear arena and fixed-size block pool allocators.
+ *
+ * An EGL_Arena hands out memory by bumping an offset through one fixed block,
+ * and takes it all back at once: at a marker, or entirely at the end of a
+ * frame or load. An EGL_Pool hands out equal-sized blocks from one fixed
+ * array through a free list, for data that comes and goes one item at a time.
+ * Neither grows; when one is full, allocation returns NULL.
+ *
+ * In debug builds (without NDEBUG), memory taken back is filled with
+ * EGL_ARENA_POISON, so stale pointers read garbage that stands out. On POSIX
+ * systems, both are also mapped with an inaccessible guard page after their
+ * last byte, so running off the end faults at once.
+ */
+
+#ifndef EGL_ARENA_H
+#define EGL_ARENA_H
+
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+
+#if !defined(NDEBUG) && defined(__unix__)
+#define EGL_ARENA_GUARD // Map a guard page after each arena and pool.
+#endif
+
+#define EGL_ARENA_ALIGN 16    // Alignment of EGL_ArenaAlloc and of pool blocks.
+#define EGL_ARENA_POISON 0xCD // Fill for memory taken back, in debug builds.
+
+
+typedef struct {
+	uint8_t *base;
+	size_t capacity; /**< Bytes that can be allocated. */
+	size_t used;     /**< Bytes allocated, including alignment padding. */
+	size_t peak;     /**< The most bytes ever allocated at once. */
+	size_t mapped;   /**< Bytes mapped for base, including the guard page, or 0 if base came from EGL_malloc. */
+} EGL_Arena;
+
+/** A point in an arena to rewind to, from EGL_ArenaMark. */
+typedef size_t EGL_ArenaMarker;
+
+typedef struct {
+	uint8_t *blocks;
+	void *free_list;     /**< Released blocks, each holding a pointer to the next. */
+	size_t block_size;   /**< Bytes per block, rounded up to EGL_ARENA_ALIGN. */
+	uint32_t capacity;   /**< Blocks in the pool. */
+	uint32_t untouched;  /**< Blocks from here on have never been handed out. */
+	uint32_t used;       /**< Blocks handed out and not released. */
+	size_t mapped;
+} EGL_Pool;
+
+
+/**
+ * Allocate an arena's memory.
+ *
+ * @param a The arena. Free with EGL_ArenaFree.
+ * @param capacity Bytes the arena can hand out.
+ * @return False on allocation failure.
+ */
+bool EGL_ArenaInit(EGL_Arena *a, size_t capacity);
+
+/** Free all memory held by the arena and zero it. */
+void EGL_ArenaFree(EGL_Arena *a);
+
+/**
+ * Allocate from an arena.
+ *
+ * @param a The arena.
+ * @param size Bytes to allocate.
+ * @param align Alignment in bytes, a power of two.
+ * @return The memory, or NULL if the arena is full.
+ */
+static inline void *EGL_ArenaAllocAligned(EGL_Arena *a, size_t size, size_t align) {
+	const uintptr_t base = (uintptr_t)a->base;
+	const size_t offset = (size_t)(((base + a->used + align - 1) & ~(uintptr_t)(align - 1)) - base);
+	if (offset > a->capacity || size > a->capacity - offset) {
+		return NULL;
+	}
+	a->used = offset + size;
+	a->peak = (a->used > a->peak) ? a->used : a->peak;
+	return a->base + offset;
+}
+
+/** Allocate from an arena, aligned to EGL_ARENA_ALIGN. */
+static inline void *EGL_ArenaAlloc(EGL_Arena *a, size_t size) {
+	return EGL_ArenaAllocAligned(a, size, EGL_ARENA_ALIGN);
+}
+
+/**
+ * Format a string into an arena.
+ *
+ * @param a The arena.
+ * @param format A printf format.
+ * @return The string, or NULL if it does not fit.
+ */
+char *EGL_ArenaPrintf(EGL_Arena *a, const char *format, ...);
+
+/** Get a marker to rewind the arena to, freeing everything allocated after it. */
+static inline EGL_ArenaMarker EGL_ArenaMark(const EGL_Arena *a) {
+	return a->used;
+}
+
+/** Free everything allocated since the marker was taken. */
+void EGL_ArenaRewind(EGL_Arena *a, EGL_ArenaMarker marker);
+
+/** Free everything allocated from the arena, as at the end of a frame. */
+static inline void EGL_ArenaReset(EGL_Arena *a) {
+	EGL_ArenaRewind(a, 0);
+}
+
+
+/**
+ * Allocate a pool's blocks. Building the free list is left to the blocks'
+ * first use, so this is O(1) too.
+ *
+ * @param p The pool. Free with EGL_PoolFree.
+ * @param block_size Bytes per block.
+ * @param capacity Blocks in the pool.
+ * @return False on allocation failure.
+ */
+bool EGL_PoolInit(EGL_Pool *p, size_t block_size, uint32_t capacity);
+
+/** Free all memory held by the pool and zero it. */
+void EGL_PoolFree(EGL_Pool *p);
+
+/**
+ * Take a block from a pool.
+ *
+ * @param p The pool.
+ * @return A block aligned to EGL_ARENA_ALIGN, or NULL if every block is in use.
+ */
+static inline void *EGL_PoolAlloc(EGL_Pool *p) {
+	void *block = p->free_list;
+	if (block) {
+		p->free_list = *(void **)block;
+	} else if (p->untouched < p->capacity) {
+		block = p->blocks + (size_t)p->untouched++ * p->block_size;
+	} else {
+		return NULL;
+	}
+	p->used++;
+	return block;
+}
+
+/** Give a block from EGL_PoolAlloc back to its pool. */
+static inline void EGL_PoolRelease(EGL_Pool *p, void *block) {
+#ifndef NDEBUG
+	memset(block, EGL_ARENA_POISON, p->block_size);
+#endif
+	*(void **)block = p->free_list;
+	p->free_list = block;
+	p->used--;
+}
+
+/** Get the index of a block in its pool, for handles that outlive pointers. */
+static inline uint32_t EGL_PoolIndex(const EGL_Pool *p, const void *block) {
+	return (uint32_t)(((const uint8_t *)block - p->blocks) / p->block_size);
+}
+
+/** Get the block at an index. */
+static inline void *EGL_PoolBlock(const EGL_Pool *p, uint32_t index) {
+	return p->blocks + (size_t)index * p->block_size;
+}
+
+
+#endif /* EGL_ARENA_H */
@@ -0,0 +1,145 @@
+/**
+ * @file EGL_assets.h
+ * @brief Asynchronous asset loader: one I/O thread feeding a pool of decode workers, finished on the main thread.
+ *
+ * Each asset moves through three stages. An I/O thread reads the whole file
+ * into memory, in the order assets were queued. A decode worker then runs
+ * the asset's decode function on the bytes (parsing, building acceleration
+ * structures, decompressing), several assets at once. Finally the main thread
+ * runs its done function from EGL_AssetPoll or EGL_AssetWait, where it can
+ * touch state that is not thread safe, such as creating GPU resources.
+ *
+ * Loading runs while the main thread does other startup work:
+ *
+ *     EGL_AssetLoad(&loader, &world);   // Returns at once.
+ *     EGL_AssetLoad(&loader, &texture);
+ *     ... create the window and device ...
+ *     EGL_AssetWaitAll(&loader);        // Runs both done functions here.
+ */
+
+#ifndef EGL_ASSETS_H
+#define EGL_ASSETS_H
+
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <threads.h>
+
+
+#define EGL_ASSET_DECODERS_MAX 8
+
+
+typedef struct EGL_Asset EGL_Asset;
+
+/**
+ * Turn an asset's bytes into something usable, on a decode worker.
+ *
+ * @param asset The asset, with data and size read. Set result, and free data
+ * (setting it to NULL) if it is no longer needed.
+ * @return False if the asset cannot be used.
+ */
+typedef bool (*EGL_AssetDecodeFunc)(EGL_Asset *asset);
+
+/** Finish an asset on the main thread, whether it loaded or failed. */
+typedef void (*EGL_AssetDoneFunc)(EGL_Asset *asset);
+
+typedef enum {
+	EGL_ASSET_IDLE,
+	EGL_ASSET_QUEUED,
+	EGL_ASSET_READING,
+	EGL_ASSET_DECODING,
+	EGL_ASSET_LOADED,
+	EGL_ASSET_FAILED,
+} EGL_AssetState;
+
+/** An asset to load. Fill in the first four fields; the loader fills in the rest. It must not move until finished. */
+struct EGL_Asset {
+	const char *path;
+	EGL_AssetDecodeFunc decode; /**< Optional: without one, the asset is just its bytes. */
+	EGL_AssetDoneFunc done;     /**< Optional. */
+	void *user;
+
+	void *data;           /**< The file's bytes, from EGL_malloc. Free with EGL_AssetFree. */
+	size_t size;
+	bool borrowed;        /**< data belongs to someone else (EGL_AssetLoadMemory) and is read-only. */
+	void *result;         /**< Whatever decode made. */
+	EGL_AssetState state; /**< Written by the loader's threads; read it once the asset is finished. */
+	bool finished;        /**< Its done function has run. Main thread only. */
+	uint64_t queued_ns;   /**< When it was queued, and how long each stage took. */
+	uint64_t read_ns;
+	uint64_t decode_ns;
+	uint64_t wait_ns;     /**< From decoded to done: time the main thread left it waiting. */
+
+	EGL_Asset *next;
+};
+
+typedef struct {
+	mtx_t lock;
+	cnd_t read_ready;   /**< Assets to read, or stopping. */
+	cnd_t decode_ready; /**< Assets to decode, or stopping. */
+	cnd_t done_ready;   /**< Assets to finish. */
+	EGL_Asset *read_head, *read_tail;
+	EGL_Asset *decode_head, *decode_tail;
+	EGL_Asset *done_head, *done_tail;
+	uint32_t unfinished; /**< Queued and not yet finished. Main thread only. */
+	bool stopping;
+
+	thrd_t io;
+	thrd_t decoders[EGL_ASSET_DECODERS_MAX];
+	int decoder_count;
+} EGL_AssetLoader;
+
+
+/**
+ * Start a loader's I/O thread and decode workers.
+ *
+ * @param l The loader, which must not move until freed. Free with EGL_AssetLoaderFree.
+ * @param decoders Decode workers (values < 1 mean EGL_ThreadCount(), at most EGL_ASSET_DECODERS_MAX).
+ * @return False if no threads could be started.
+ */
+bool EGL_AssetLoaderInit(EGL_AssetLoader *l, int decoders);
+
+/**
+ * Stop a loader's threads and zero it. Assets not yet decoded are marked
+ * failed and their bytes freed; done functions that have not run never will.
+ */
+void EGL_AssetLoaderFree(EGL_AssetLoader *l);
+
+/** Queue an asset to load. Call from the main thread. */
+void EGL_AssetLoad(EGL_AssetLoader *l, EGL_Asset *asset);
+
+/**
+ * Queue an asset whose bytes are already in memory, such as a view into an
+ * EGL_Pack, straight to the decode workers. Its path is only a label.
+ *
+ * @param data The bytes, which must outlive the asset; the asset never frees or writes them.
+ */
+void EGL_AssetLoadMemory(EGL_AssetLoader *l, EGL_Asset *asset, const void *data, size_t size);
+
+/**
+ * Run the done functions of every decoded asset, without waiting.
+ *
+ * @return The number of assets finished.
+ */
+size_t EGL_AssetPoll(EGL_AssetLoader *l);
+
+/**
+ * Finish assets until this one is finished, sleeping while none are ready.
+ *
+ * @return True if the asset loaded.
+ */
+bool EGL_AssetWait(EGL_AssetLoader *l, EGL_Asset *asset);
+
+/**
+ * Finish every queued asset.
+ *
+ * @return True if every asset it finished loaded.
+ */
+bool EGL_AssetWaitAll(EGL_AssetLoader *l);
+
+/** Free an asset's bytes, or forget them if borrowed. Its result is the caller's to free. */
+void EGL_AssetFree(EGL_Asset *asset);
+
+
+#endif /* EGL_ASSETS_H */
@@ -0,0 +1,98 @@
+/**
+ * @file EGL_bench.h
+ * @brief A barebones benchmarking harness with wall clock timing.
+ *
+ * Benchmarks are plain functions which time their own kernels with
+ * EGL_BenchNow and print rows with EGL_BenchReport. Build in release mode
+ * for meaningful numbers.
+ */
+#ifndef EGL_BENCH_H
+#define EGL_BENCH_H
+
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+
+#define EGL_BENCH_REPEATS 5 // Default number of repeats to take the best of.
+
+
+/* Benchmarking API Macros */
+
+/**
+ * Declare the current function as a benchmark module and print its header.
+ *
+ * @param m the title of the module (no string quotes necessary).
+ */
+#define EGL_DECLARE_BENCH(m)\
+	printf("\033[36m-------------------------------------------------------------------------------\n");\
+	printf(" BENCH | %s\n", #m);\
+	printf("-------------------------------------------------------------------------------\033[0m\n")
+
+/**
+ * Run a benchmark module if it matches the filter (or there is no filter).
+ *
+ * @param m The module (function) name.
+ */
+#define EGL_RUN_BENCH(m)\
+	if (NULL == filter || NULL != strstr(#m, filter)) {\
+		m();\
+	}
+
+
+/** Written to by benchmarks so the compiler cannot discard their results. */
+static volatile uint64_t EGL_BENCH_SINK;
+
+
+/** Get a monotonic-enough wall clock time in seconds. */
+static inline double EGL_BenchNow(void) {
+	struct timespec ts;
+	timespec_get(&ts, TIME_UTC);
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/**
+ * Print one row of benchmark results.
+ *
+ * @param label What was measured.
+ * @param seconds The time taken by one run.
+ * @param work The amount of work done in one run (e.g. items or bytes).
+ * @param unit The unit of work (e.g. "items" or "MB").
+ */
+static inline void EGL_BenchReport(const char *label, double seconds, double work, const char *unit) {
+	printf(" %-44s %10.3f ms %12.3f M%s/s\n", label, seconds * 1e3, work / seconds * 1e-6, unit);
+}
+
+
+// Put benchmark module prototypes here.
+
+/*$ BENCHMARKS */
+void EGL_MeshBench(void);
+void EGL_FlowFieldBench(void);
+void EGL_SpatialBench(void);
+void EGL_TargetBench(void);
+void EGL_BvhBench(void);
+void EGL_TransformBench(void);
+void EGL_TransformRotateBench(void);
+void EGL_SnapshotBench(void);
+void EGL_HierarchyBench(void);
+void EGL_MathBench(void);
+void EGL_ApproxBench(void);
+void EGL_JobsBench(void);
+void EGL_QueueBench(void);
+void EGL_ProfileBench(void);
+void EGL_FrameStatsBench(void);
+void EGL_AllocBench(void);
+void EGL_ArenaBench(void);
+void EGL_AssetsBench(void);
+void EGL_PackBench(void);
+void EGL_TextureBench(void);
+void EGL_StagingBench(void);
+void EGL_InstanceBench(void);
+void EGL_RasterBench(void);
+/*$ END BENCHMARKS */
+
+
+#endif /* EGL_BENCH_H */
@@ -0,0 +1,90 @@
+/**
+ * @file EGL_bvh.h
+ * @brief 4-wide bounding volume hierarchy for ray casts against triangle meshes.
+ *
+ * Built once in object space with a binned surface area heuristic. Every node
+ * stores the bounds of its four children in SoA order so one SIMD slab test
+ * checks all of them. Rays in world space are cast by transforming them into
+ * object space first, so a moving or rotating mesh never needs a rebuild.
+ */
+
+#ifndef EGL_BVH_H
+#define EGL_BVH_H
+
+
+#include <stdbool.h>
+#include <stdint.h>
+
+
+#define EGL_BVH_EMPTY UINT32_MAX // Unused child slot.
+#define EGL_BVH_LEAF  0x80000000 // Set in child[] for leaves; the rest is the first triangle.
+#define EGL_BVH_DEPTH_MAX 64     // Bounds the traversal stack.
+
+
+/** A 4-wide node (128 bytes). */
+typedef struct {
+	float min_x[4], min_y[4], min_z[4];
+	float max_x[4], max_y[4], max_z[4];
+	uint32_t child[4]; /**< Node index, EGL_BVH_LEAF | first triangle, or EGL_BVH_EMPTY. */
+	uint32_t count[4]; /**< Triangles in a leaf child (0 for inner children). */
+} EGL_BvhNode;
+
+typedef struct {
+	EGL_BvhNode *nodes;   /**< [node_count] The root is node 0. */
+	float *triangles;     /**< [triangle_count * 9] First corner and both edges in leaf order. */
+	uint32_t *ids;        /**< [triangle_count] Original triangle index in leaf order. */
+	uint32_t node_count;
+	uint32_t triangle_count;
+} EGL_Bvh;
+
+/** The nearest intersection of a ray with the mesh. */
+typedef struct {
+	float t;           /**< Ray parameter: hit point = origin + t * direction. */
+	float u;           /**< Barycentric weight of the triangle's second corner. */
+	float v;           /**< Barycentric weight of the triangle's third corner. */
+	uint32_t triangle; /**< Index of the triangle (indices[3 * triangle ...]). */
+} EGL_BvhHit;
+
+
+/**
+ * Build a BVH over an indexed triangle mesh.
+ *
+ * @param bvh The BVH. Free with EGL_BvhFree.
+ * @param indices [index_count] Triangle list indices.
+ * @param index_count Number of indices (a multiple of 3).
+ * @param vertices [vertex_count * 3] Vertex positions.
+ * @param vertex_count Number of vertices.
+ * @return False on allocation failure, bad indices or a degenerate (too deep) tree.
+ */
+bool EGL_BvhBuild(EGL_Bvh *bvh, const uint32_t *indices, uint32_t index_count, const float *vertices, uint32_t vertex_count);
+
+/** Free all memory held by the BVH and zero it. */
+void EGL_BvhFree(EGL_Bvh *bvh);
+
+/**
+ * Find the nearest triangle a ray hits (both faces count).
+ *
+ * Equally near hits go to the lowest triangle index.
+ *
+ * @param bvh The BVH.
+ * @param origin The ray origin in object space.
+ * @param direction The ray direction in object space (need not be normalized).
+ * @param t_max Ignore hits beyond origin + t_max * direction.
+ * @param hit Output nearest hit.
+ * @return True if the ray hits a triangle.
+ */
+bool EGL_BvhRaycast(const EGL_Bvh *bvh, const float origin[3], const float direction[3], float t_max, EGL_BvhHit *hit);
+
+/**
+ * Interpolate a per-vertex attribute (e.g. uvs or normals) at a hit.
+ *
+ * @param hit The hit.
+ * @param indices The triangle list indices the BVH was built from.
+ * @param attributes [vertex_count * components] The attribute.
+ * @param components Floats per vertex.
+ * @param out [components] The interpolated attribute.
+ */
+void EGL_BvhInterpolate(const EGL_BvhHit *hit, const uint32_t *indices, const float *attributes, int components, float *out);
+
+
+#endif /* EGL_BVH_H */
@@ -0,0 +1,112 @@
+/**
+ * @file EGL_flowfield.h
+ * @brief Weighted flow fields over mesh vertex graphs for crowd pathfinding.
+ *
+ * A flow field stores, for every node, the cost of the cheapest path to the
+ * nearest goal and the neighbor to step to next. Any number of agents can
+ * then follow the field in O(1) per step instead of searching individually.
+ */
+
+#ifndef EGL_FLOWFIELD_H
+#define EGL_FLOWFIELD_H
+
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <EGL/EGL_mesh.h>
+
+
+#define EGL_FLOW_NONE UINT32_MAX // No step: the node is a goal or cannot reach one.
+
+
+/**
+ * A flow field over the node graph of an EGL_MeshAdjacency.
+ *
+ * The cost of an edge is its length times the mean cost of its endpoints.
+ * Nodes with infinite cost (e.g. under a tower) are impassable.
+ */
+typedef struct {
+	const EGL_MeshAdjacency *adj; /**< The graph (borrowed, must outlive the field). */
+	uint32_t node_count;
+
+	float    *cost;     /**< [node_count] Traversal cost multiplier (1 = open ground). */
+	float    *distance; /**< [node_count] Cost to the nearest goal (INFINITY if unreachable). */
+	uint32_t *next;     /**< [node_count] Neighbor to step to, or EGL_FLOW_NONE. */
+	uint8_t  *goal;     /**< [node_count] Non-zero for goal nodes. */
+
+	/* Sweep state */
+	_Atomic uint32_t *bits;    /**< [node_count] Working distances as ordered float bits. */
+	_Atomic uint8_t  *queued;  /**< [node_count] Set while a node is in the next frontier. */
+	uint8_t  *flags;           /**< [node_count] Bookkeeping bits for incremental updates. */
+	uint32_t *frontier;        /**< [node_count] Nodes to relax this iteration. */
+	uint32_t *frontier_next;   /**< [node_count] Nodes to relax next iteration. */
+	uint32_t *touched;         /**< [node_count] Nodes whose distance the last sweep changed. */
+	uint32_t *pending;         /**< [node_count] Nodes whose cost changed since the last sweep. */
+	float    *pending_cost;    /**< [node_count] Their costs before the change. */
+	uint32_t  pending_count;
+} EGL_FlowField;
+
+
+/**
+ * Initialize a flow field with unit costs and no goals.
+ *
+ * @param f The flow field. Free with EGL_FlowFieldFree.
+ * @param adj The graph to path over.
+ * @return False on allocation failure.
+ */
+bool EGL_FlowFieldInit(EGL_FlowField *f, const EGL_MeshAdjacency *adj);
+
+/** Free all memory held by the flow field and zero it. */
+void EGL_FlowFieldFree(EGL_FlowField *f);
+
+/**
+ * Mark or unmark a node as a goal. Requires a full EGL_FlowFieldBuild.
+ */
+void EGL_FlowFieldSetGoal(EGL_FlowField *f, uint32_t node, bool goal);
+
+/**
+ * Change the traversal cost of a node (e.g. when a tower is placed).
+ *
+ * The change is queued and applied by the next EGL_FlowFieldUpdate, which
+ * only re-sweeps the part of the field it affects.
+ *
+ * @param f The flow field.
+ * @param node The node.
+ * @param cost The new cost multiplier (> 0, INFINITY to block).
+ */
+void EGL_FlowFieldSetCost(EGL_FlowField *f, uint32_t node, float cost);
+
+/**
+ * Rebuild the whole field with a frontier-parallel sweep from the goals.
+ *
+ * @param f The flow field.
+ * @param threads Number of threads to sweep with (usually EGL_ThreadCount()).
+ */
+void EGL_FlowFieldBuild(EGL_FlowField *f, int threads);
+
+/**
+ * Rebuild the whole field with a single-threaded Dijkstra search.
+ *
+ * Produces exactly the same distances and steps as EGL_FlowFieldBuild.
+ *
+ * @return False on allocation failure.
+ */
+bool EGL_FlowFieldBuildReference(EGL_FlowField *f);
+
+/**
+ * Apply queued cost changes by re-sweeping only the nodes they affect.
+ *
+ * @param f The flow field (must have been built).
+ * @param threads Number of threads to sweep with.
+ */
+void EGL_FlowFieldUpdate(EGL_FlowField *f, int threads);
+
+/** Get the neighbor an agent at `node` should step to, or EGL_FLOW_NONE. */
+static inline uint32_t EGL_FlowFieldNext(const EGL_FlowField *f, uint32_t node) {
+	return f->next[node];
+}
+
+
+#endif /* EGL_FLOWFIELD_H */
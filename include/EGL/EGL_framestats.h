@@ -0,0 +1,162 @@
+/**
+ * @file EGL_framestats.h
+ * @brief Frame time statistics: percentiles over a rolling window and a whole run, in fixed memory.
+ *
+ * Each frame records two nanosecond durations: the CPU time spent building the
+ * frame and the interval since the previous present. Both go into log-linear
+ * histograms (the HDR histogram layout): values under 128 ns get a bucket
+ * each, and every power of two above that is split into 64 buckets, so any
+ * value up to EGL_HISTOGRAM_MAX_NS is kept to within 1/64 of itself.
+ *
+ * The rolling window keeps the last few hundred frames' samples, so the oldest
+ * frame's buckets can be taken back out as each new frame goes in.
+ */
+
+#ifndef EGL_FRAMESTATS_H
+#define EGL_FRAMESTATS_H
+
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+#define EGL_HISTOGRAM_SUB_BITS 7                                       // Values below 2^7 are exact.
+#define EGL_HISTOGRAM_HALF (1u << (EGL_HISTOGRAM_SUB_BITS - 1))       // Buckets per power of two.
+#define EGL_HISTOGRAM_MAX_BITS 40                                      // Values up to 2^40 ns (18 minutes).
+#define EGL_HISTOGRAM_MAX_NS ((1ull << EGL_HISTOGRAM_MAX_BITS) - 1)
+#define EGL_HISTOGRAM_BUCKETS ((EGL_HISTOGRAM_MAX_BITS - EGL_HISTOGRAM_SUB_BITS + 2) * EGL_HISTOGRAM_HALF)
+
+
+/** Counts of values by log-linear bucket. */
+typedef struct {
+	uint32_t counts[EGL_HISTOGRAM_BUCKETS];
+	uint64_t total; /**< Values added and not removed. */
+	uint64_t max;   /**< The largest value ever added. */
+} EGL_Histogram;
+
+/** Percentiles of one kind of duration, in nanoseconds. */
+typedef struct {
+	uint64_t p50;
+	uint64_t p95;
+	uint64_t p99;
+	uint64_t max;
+} EGL_FramePercentiles;
+
+typedef struct {
+	EGL_FramePercentiles cpu;      /**< Time building a frame. */
+	EGL_FramePercentiles interval; /**< Time from one present to the next. */
+	uint64_t frames;               /**< Frames in the window (or run). */
+	uint64_t missed;               /**< Vsync deadlines missed in the window (or run). */
+} EGL_FrameReport;
+
+typedef struct {
+	EGL_Histogram cpu_window, interval_window; /**< The last `window` frames. */
+	EGL_Histogram cpu_run, interval_run;       /**< Every frame since init. */
+
+	uint64_t *cpu_samples;      /**< [window] Ring of the window's samples. */
+	uint64_t *interval_samples; /**< [window] */
+	uint8_t *missed_samples;    /**< [window] Deadlines each frame in the window missed. */
+	uint32_t window;
+	uint32_t next;              /**< Ring slot the next frame goes in. */
+
+	uint64_t refresh_ns;    /**< Vsync period, or 0 to not count deadlines. */
+	uint64_t last_present;  /**< Time of the previous present, 0 before the first. */
+	uint64_t frames;        /**< Frames recorded since init. */
+	uint64_t window_missed;
+	uint64_t run_missed;
+} EGL_FrameStats;
+
+
+/** Get the bucket a value falls in. */
+static inline uint32_t EGL_HistogramBucket(uint64_t value) {
+	if (value > EGL_HISTOGRAM_MAX_NS) {
+		value = EGL_HISTOGRAM_MAX_NS;
+	}
+	if (value < (1u << EGL_HISTOGRAM_SUB_BITS)) {
+		return (uint32_t)value;
+	}
+	int msb = 0;
+	for (int half = 32; half; half >>= 1) {
+		if (value >> (msb + half)) {
+			msb += half;
+		}
+	}
+	const int shift = msb - EGL_HISTOGRAM_SUB_BITS + 1;
+	return (uint32_t)shift * EGL_HISTOGRAM_HALF + (uint32_t)(value >> shift);
+}
+
+/** Get the largest value that falls in a bucket. */
+static inline uint64_t EGL_HistogramBucketMax(uint32_t bucket) {
+	if (bucket < (1u << EGL_HISTOGRAM_SUB_BITS)) {
+		return bucket;
+	}
+	const uint32_t shift = bucket / EGL_HISTOGRAM_HALF - 1;
+	const uint64_t mantissa = bucket % EGL_HISTOGRAM_HALF + EGL_HISTOGRAM_HALF;
+	return ((mantissa + 1) << shift) - 1;
+}
+
+/** Empty the histogram. */
+void EGL_HistogramClear(EGL_Histogram *h);
+
+/** Count a value. Values above EGL_HISTOGRAM_MAX_NS count in the last bucket. */
+void EGL_HistogramAdd(EGL_Histogram *h, uint64_t value);
+
+/** Take back a value added before. max is not lowered. */
+void EGL_HistogramRemove(EGL_Histogram *h, uint64_t value);
+
+/**
+ * Get the value at a quantile: the largest value in the bucket holding the
+ * q * total-th value, so it is never under the exact answer by more than a
+ * bucket width and never over the max.
+ *
+ * @param h The histogram.
+ * @param q The quantile, 0 to 1.
+ * @return The value, or 0 if the histogram is empty.
+ */
+uint64_t EGL_HistogramQuantile(const EGL_Histogram *h, double q);
+
+
+/**
+ * Allocate empty statistics.
+ *
+ * @param s The statistics. Free with EGL_FrameStatsFree.
+ * @param window Frames in the rolling window.
+ * @param refresh_ns The vsync period to count missed deadlines against, or 0.
+ * @return False on allocation failure.
+ */
+bool EGL_FrameStatsInit(EGL_FrameStats *s, uint32_t window, uint64_t refresh_ns);
+
+/** Free all memory held by the statistics and zero them. */
+void EGL_FrameStatsFree(EGL_FrameStats *s);
+
+/**
+ * Record a frame.
+ *
+ * An interval counts as missing one deadline for each whole vsync period past
+ * the first it took, rounded to the nearest period so jitter does not count.
+ *
+ * @param s The statistics.
+ * @param cpu_ns Time spent building the frame.
+ * @param present_ns The time the frame was presented (any monotonic clock).
+ */
+void EGL_FrameStatsAdd(EGL_FrameStats *s, uint64_t cpu_ns, uint64_t present_ns);
+
+/** Get percentiles over the rolling window. */
+void EGL_FrameStatsWindow(const EGL_FrameStats *s, EGL_FrameReport *report);
+
+/** Get percentiles over every frame since init. */
+void EGL_FrameStatsRun(const EGL_FrameStats *s, EGL_FrameReport *report);
+
+/**
+ * Write whole-run percentiles and the non-empty buckets of both histograms
+ * as JSON.
+ *
+ * @param s The statistics.
+ * @param path The file to write.
+ * @return False if the file cannot be written.
+ */
+bool EGL_FrameStatsWrite(const EGL_FrameStats *s, const char *path);
+
+
+#endif /* EGL_FRAMESTATS_H */
@@ -0,0 +1,92 @@
+/**
+ * @file EGL_hierarchy.h
+ * @brief Parent/child transform hierarchy stored as flat arrays.
+ *
+ * Nodes are kept in depth-first order, so every parent comes before its
+ * children and every subtree is one contiguous run of slots. World matrices
+ * are then computed in one linear pass, which jumps over whole subtrees that
+ * hold nothing dirty. Reparenting rotates a subtree's run to its new place in
+ * preallocated arrays, so nothing is ever reallocated after init.
+ *
+ * Nodes are referred to by stable ids; their slots change as the tree does.
+ * Matrices are column-major, laid out like cglm's mat4.
+ */
+
+#ifndef EGL_HIERARCHY_H
+#define EGL_HIERARCHY_H
+
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+#define EGL_HIERARCHY_NONE UINT32_MAX // No node (the parent of roots).
+
+
+typedef struct {
+	uint32_t capacity;
+	uint32_t count;
+
+	uint32_t *slot; /**< [capacity] Slot of each node id. */
+
+	/* By slot, in depth-first order */
+	uint32_t *node;        /**< [capacity] Node id in each slot. */
+	uint32_t *parent;      /**< [capacity] Parent node id or EGL_HIERARCHY_NONE. */
+	uint32_t *parent_slot; /**< [capacity] Parent slot or EGL_HIERARCHY_NONE. */
+	uint32_t *size;        /**< [capacity] Slots in the subtree, including this one. */
+	uint8_t  *flags;       /**< [capacity] Dirty bits. */
+	float    *local;       /**< [capacity * 16] Transform relative to the parent. */
+	float    *world;       /**< [capacity * 16] Transform relative to the root's space. */
+
+	void *scratch; /**< Room to move the largest possible subtree. */
+} EGL_Hierarchy;
+
+
+/**
+ * Allocate an empty hierarchy.
+ *
+ * @param h The hierarchy. Free with EGL_HierarchyFree.
+ * @param capacity Maximum number of nodes.
+ * @return False on allocation failure.
+ */
+bool EGL_HierarchyInit(EGL_Hierarchy *h, uint32_t capacity);
+
+/** Free all memory held by the hierarchy and zero it. */
+void EGL_HierarchyFree(EGL_Hierarchy *h);
+
+/**
+ * Add a node as the last child of a parent.
+ *
+ * @param h The hierarchy.
+ * @param parent The parent node, or EGL_HIERARCHY_NONE for a new root.
+ * @param local [16] Transform relative to the parent.
+ * @return The new node's id, or EGL_HIERARCHY_NONE if the hierarchy is full or the parent is invalid.
+ */
+uint32_t EGL_HierarchyAdd(EGL_Hierarchy *h, uint32_t parent, const float local[16]);
+
+/**
+ * Move a node and its subtree under a new parent, keeping its local transform.
+ * Costs a copy of every slot between the old and new place, so keep it out of
+ * per-frame loops.
+ *
+ * @param h The hierarchy.
+ * @param node The node to move.
+ * @param parent The new parent, or EGL_HIERARCHY_NONE to make the node a root.
+ * @return False if the parent is invalid or inside the node's own subtree.
+ */
+bool EGL_HierarchyReparent(EGL_Hierarchy *h, uint32_t node, uint32_t parent);
+
+/** Set a node's transform relative to its parent. */
+void EGL_HierarchySetLocal(EGL_Hierarchy *h, uint32_t node, const float local[16]);
+
+/** Get a node's world matrix as of the last EGL_HierarchyUpdate. */
+static inline const float *EGL_HierarchyWorld(const EGL_Hierarchy *h, uint32_t node) {
+	return h->world + (size_t)h->slot[node] * 16;
+}
+
+/** Recompute the world matrices of every node that is dirty or below a dirty node. */
+void EGL_HierarchyUpdate(EGL_Hierarchy *h);
+
+
+#endif /* EGL_HIERARCHY_H */
@@ -0,0 +1,123 @@
+/**
+ * @file EGL_instance.h
+ * @brief Instanced draw batches built from SoA simulation state.
+ *
+ * Each frame, groups of objects that share a mesh and material are added
+ * from their SoA arrays. Every instance is packed into the 32-byte
+ * EGL_Instance a vertex shader reads per instance, and given a 64-bit draw
+ * key:
+ *
+ *     bits 48-63  material
+ *     bits 32-47  mesh
+ *     bits  0-31  squared distance from the eye, as float bits
+ *
+ * EGL_InstanceBatchBuild radix sorts the keys (EGL_sort.h), gathers the
+ * instances in key order and splits them into one EGL_DrawBatch per mesh and
+ * material, nearest first within each. A frame then binds each material and
+ * mesh once and draws all their instances with one instanced call. Distances
+ * are non-negative, so their float bits sort like the floats.
+ *
+ * Nearest first is for a pass that depth tests and writes: the near instances
+ * fill the depth buffer early and the fragments behind them are rejected
+ * before shading. The order alone does not resolve visibility.
+ */
+
+#ifndef EGL_INSTANCE_H
+#define EGL_INSTANCE_H
+
+
+#include <stdbool.h>
+#include <stdint.h>
+
+
+#define EGL_INSTANCE_WHITE 0xFFFFFFFFu // Opaque white, the default color.
+
+
+/** One instance as the vertex shader reads it. */
+typedef struct {
+	float position[3];
+	float scale;         /**< Uniform scale. */
+	int16_t rotation[4]; /**< Unit quaternion (x, y, z, w), normalized to [-32767, 32767]. */
+	uint32_t color;      /**< RGBA8, red in the lowest byte. */
+	float phase;         /**< Animation phase, in [0, 1). */
+} EGL_Instance;
+
+/** A group of objects in SoA layout. Optional arrays may be NULL. */
+typedef struct {
+	const float *x; /**< [count] Position. */
+	const float *y; /**< [count] */
+	const float *z; /**< [count] */
+	const float *rotation_x; /**< [count] Unit quaternion, optional: all four or none (identity). */
+	const float *rotation_y; /**< [count] */
+	const float *rotation_z; /**< [count] */
+	const float *rotation_w; /**< [count] */
+	const float *scale;      /**< [count] Optional, else 1. */
+	const uint32_t *color;   /**< [count] Optional, else EGL_INSTANCE_WHITE. */
+	const float *phase;      /**< [count] Optional, else 0. */
+	uint32_t count;
+} EGL_InstanceSource;
+
+/** A run of instances that share a mesh and material, drawn with one call. */
+typedef struct {
+	uint16_t mesh;
+	uint16_t material;
+	uint32_t first; /**< Index of the first instance in EGL_InstanceBatch.instances. */
+	uint32_t count;
+} EGL_DrawBatch;
+
+typedef struct {
+	EGL_Instance *instances; /**< [count] Sorted by draw key after EGL_InstanceBatchBuild. */
+	EGL_Instance *unsorted;  /**< [count] In the order they were added. */
+	uint64_t *keys;          /**< [capacity] Draw keys, sorted by EGL_InstanceBatchBuild. */
+	uint64_t *keys_tmp;
+	uint32_t *order;         /**< [capacity] Index in unsorted of each sorted key. */
+	uint32_t *order_tmp;
+	void *sort_scratch;      /**< Histograms for EGL_RadixSort, kept so building does not allocate. */
+	uint32_t count;
+	uint32_t capacity;
+
+	EGL_DrawBatch *draws; /**< [draw_count] In key order. */
+	uint32_t draw_count;
+	uint32_t draws_max;
+
+	float eye[3]; /**< Distances are measured from here. */
+} EGL_InstanceBatch;
+
+
+/** Build the draw key of an instance. */
+static inline uint64_t EGL_DrawKey(uint16_t material, uint16_t mesh, float distance_squared) {
+	union { float f; uint32_t u; } depth = { distance_squared };
+	return (uint64_t)material << 48 | (uint64_t)mesh << 32 | depth.u;
+}
+
+/**
+ * Allocate a batch.
+ *
+ * @param b The batch. Free with EGL_InstanceBatchFree.
+ * @param capacity Instances per frame.
+ * @param draws_max Distinct meshes and materials per frame.
+ * @return False on allocation failure.
+ */
+bool EGL_InstanceBatchInit(EGL_InstanceBatch *b, uint32_t capacity, uint32_t draws_max);
+
+void EGL_InstanceBatchFree(EGL_InstanceBatch *b);
+
+/** Empty a batch for a new frame, measuring distances from the eye. */
+void EGL_InstanceBatchBegin(EGL_InstanceBatch *b, const float eye[3]);
+
+/**
+ * Pack a group of objects into the batch.
+ *
+ * @return False, adding none of them, if they would pass the capacity.
+ */
+bool EGL_InstanceBatchAdd(EGL_InstanceBatch *b, uint16_t mesh, uint16_t material, const EGL_InstanceSource *source);
+
+/**
+ * Sort the instances by draw key and split them into draws.
+ *
+ * @return False if the sort could not allocate, or there are more than draws_max draws.
+ */
+bool EGL_InstanceBatchBuild(EGL_InstanceBatch *b);
+
+
+#endif /* EGL_INSTANCE_H */
@@ -0,0 +1,154 @@
+/**
+ * @file EGL_jobs.h
+ * @brief Work-stealing job system with fork-join counters and a parallel for.
+ *
+ * Unlike EGL_ParallelRun, which starts threads for every call, the workers
+ * here live as long as the job system. Each worker pushes and pops jobs at
+ * the bottom of its own Chase-Lev deque and steals from the top of the
+ * others' when it runs dry, so jobs stay on the thread that made them unless
+ * another one is idle. Idle workers sleep instead of spinning.
+ *
+ * The thread that calls EGL_JobsInit is worker 0. It runs jobs while it waits
+ * on them, so in a game initialize the system in SDL_AppInit and use it from
+ * any of the SDL callbacks, which all run on that thread. Jobs are created
+ * and run only by workers (including from inside jobs): from any other thread
+ * EGL_JobsCreate returns NULL and EGL_JobsRun false. EGL_JobsWait and
+ * EGL_JobsParallelFor may be called from any thread: outside the job system
+ * (e.g. on an EGL_SimThread) the wait yields instead of helping, and the
+ * parallel for runs the whole range inline.
+ */
+
+#ifndef EGL_JOBS_H
+#define EGL_JOBS_H
+
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <threads.h>
+
+
+#define EGL_JOBS_MAX 4096 // Jobs each worker can have in flight, and the capacity of its deque (a power of two).
+
+#define EGL_JOBS_GRAIN_SPLITS 8 // Automatic grain sizing aims for this many chunks per worker.
+
+
+typedef struct EGL_Jobs EGL_Jobs;
+typedef struct EGL_Job EGL_Job;
+
+/**
+ * A job.
+ *
+ * @param jobs The job system, to create child jobs with.
+ * @param job This job, to pass as the parent of its children.
+ * @param data User data given when the job was created.
+ */
+typedef void (*EGL_JobFunc)(EGL_Jobs *jobs, EGL_Job *job, void *data);
+
+/**
+ * A kernel run over part of an index range by EGL_JobsParallelFor.
+ *
+ * @param data User data shared by every chunk.
+ * @param begin First index of the chunk.
+ * @param end One past the last index of the chunk.
+ */
+typedef void (*EGL_RangeFunc)(void *data, size_t begin, size_t end);
+
+typedef enum {
+	EGL_JOBS_AFFINITY_NONE, /**< Let the OS schedule the workers. */
+	EGL_JOBS_AFFINITY_PIN,  /**< Pin worker i to processor i (Linux only; worker 0 is never pinned). */
+} EGL_JobsAffinity;
+
+/** A job, one cache line each so workers finishing neighbors do not share lines. */
+struct EGL_Job {
+	_Alignas(64) EGL_JobFunc func;
+	void *data;
+	size_t begin;               /**< Range of a parallel for chunk. */
+	size_t end;
+	EGL_Job *parent;            /**< Finishes only after this job does. */
+	_Atomic int32_t unfinished; /**< This job and its unfinished children, 0 once done. */
+};
+
+/** Chase-Lev deque of jobs, owned by one worker. */
+typedef struct {
+	_Alignas(64) _Atomic int64_t top;    /**< Next job to steal. */
+	_Alignas(64) _Atomic int64_t bottom; /**< Next free slot, pushed and popped by the owner. */
+	_Atomic(EGL_Job *) *slots;           /**< [EGL_JOBS_MAX] */
+} EGL_JobDeque;
+
+typedef struct {
+	EGL_JobDeque deque;
+	EGL_Job *jobs;       /**< [EGL_JOBS_MAX] Ring the worker creates its jobs in. */
+	uint32_t next_job;
+	uint32_t rng;        /**< Picks steal victims. */
+	int index;
+	EGL_Jobs *system;
+	thrd_t thread;
+} EGL_JobWorker;
+
+struct EGL_Jobs {
+	EGL_JobWorker *workers; /**< [worker_count] */
+	int worker_count;       /**< Including the thread that called EGL_JobsInit. */
+	EGL_JobsAffinity affinity;
+	_Atomic bool running;
+	_Atomic int sleepers;   /**< Workers waiting on wake. */
+	mtx_t mutex;
+	cnd_t wake;
+};
+
+
+/**
+ * Start a job system. The calling thread becomes worker 0.
+ *
+ * @param jobs The job system, which must not move until freed. Free with EGL_JobsFree on the same thread.
+ * @param threads Number of workers including the caller (values < 1 mean EGL_ThreadCount()).
+ * @param affinity Whether to pin the workers to processors.
+ * @return False if nothing could be allocated. If fewer threads can be
+ * started than requested, the job system runs with fewer workers.
+ */
+bool EGL_JobsInit(EGL_Jobs *jobs, int threads, EGL_JobsAffinity affinity);
+
+/** Stop and join the workers, then free everything and zero it. No jobs may be in flight. */
+void EGL_JobsFree(EGL_Jobs *jobs);
+
+/**
+ * Create a job without running it.
+ *
+ * @param jobs The job system.
+ * @param func The job.
+ * @param data User data passed to the job.
+ * @param parent Optional job that will not finish before this one.
+ * @return The job, to pass to EGL_JobsRun, or NULL if the calling thread is
+ * not one of this system's workers.
+ */
+EGL_Job *EGL_JobsCreate(EGL_Jobs *jobs, EGL_JobFunc func, void *data, EGL_Job *parent);
+
+/**
+ * Queue a created job for any worker to run.
+ *
+ * @return False, queueing nothing, if the calling thread is not one of this
+ * system's workers.
+ */
+bool EGL_JobsRun(EGL_Jobs *jobs, EGL_Job *job);
+
+/** Run other jobs until a job and all of its children have finished (off the pool, just yield until then). */
+void EGL_JobsWait(EGL_Jobs *jobs, EGL_Job *job);
+
+/**
+ * Run a kernel over [0, n) in chunks across all workers and wait for it.
+ *
+ * Ranges are split in halves, keeping one and queueing the other, so idle
+ * workers steal the biggest pieces first. May be called from inside a job.
+ *
+ * @param jobs The job system.
+ * @param n The size of the range.
+ * @param grain The largest chunk to run (0 sizes chunks automatically for
+ * EGL_JOBS_GRAIN_SPLITS chunks per worker).
+ * @param func The kernel.
+ * @param data User data passed to every chunk.
+ */
+void EGL_JobsParallelFor(EGL_Jobs *jobs, size_t n, size_t grain, EGL_RangeFunc func, void *data);
+
+
+#endif /* EGL_JOBS_H */
@@ -1,33 +1,606 @@
+/**
+ * @file EGL_math.h
+ * @brief Vector, matrix and quaternion value types with SIMD implementations.
+ *
+ * Everything is static inline and passed by value, so values stay in
+ * registers across a hot loop instead of round-tripping through the pointers
+ * cglm's API takes. SSE is used whenever the compiler targets it, with a
+ * scalar fallback otherwise; define EGL_MATH_SCALAR before including to force
+ * the fallback. EGL_Vec3x8 holds eight vectors in SoA form for batched kernels
+ * and uses AVX when it is enabled, two SSE registers when not.
+ *
+ * Layouts match cglm: vectors are packed floats, matrices are column-major
+ * and quaternions are x, y, z, w with w the real part. The quaternion
+ * functions here are the by-value counterparts of the array helpers in
+ * EGL_transform.h, and use the same conventions.
+ */
+
 #ifndef EGL_MATH_H
 #define EGL_MATH_H
 
 
-//typedef union {
-//	float array[2];
-//	struct {
-//		float x;
-//		float y;
-//	};
-//} Vec2;
-//
-//typedef union {
-//	float array[3];
-//	struct {
-//		float x;
-//		float y;
-//		float z;
-//	};
-//} Vec3;
-//
-//typedef union {
-//	float array[4];
-//	struct {
-//		float x;
-//		float y;
-//		float z;
-//		float w;
-//	};
-//} Vec4;
-
-
-#endif //EGL_MATH_H
+#include <math.h>
+#include <stddef.h>
+
+#if !defined(EGL_MATH_SCALAR) && defined(__SSE2__)
+#define EGL_MATH_SSE
+#include <emmintrin.h>
+#if defined(__AVX__)
+#define EGL_MATH_AVX
+#include <immintrin.h>
+#endif
+#endif
+
+
+typedef union {
+	float array[2];
+	struct {
+		float x;
+		float y;
+	};
+} EGL_Vec2;
+
+typedef union {
+	float array[3];
+	struct {
+		float x;
+		float y;
+		float z;
+	};
+} EGL_Vec3;
+
+typedef union {
+	float array[4];
+	struct {
+		float x;
+		float y;
+		float z;
+		float w;
+	};
+#ifdef EGL_MATH_SSE
+	__m128 simd;
+#endif
+} EGL_Vec4;
+
+/** A rotation as a unit quaternion, x, y, z, w. */
+typedef EGL_Vec4 EGL_Quat;
+
+/** A column-major 4x4 matrix. */
+typedef union {
+	float array[16];
+	EGL_Vec4 columns[4];
+} EGL_Mat4;
+
+/** Eight floats, one per lane of an SoA kernel. */
+typedef struct {
+#if defined(EGL_MATH_AVX)
+	__m256 v;
+#elif defined(EGL_MATH_SSE)
+	__m128 lo;
+	__m128 hi;
+#else
+	float f[8];
+#endif
+} EGL_Floatx8;
+
+/** Eight 3D vectors in SoA form. */
+typedef struct {
+	EGL_Floatx8 x;
+	EGL_Floatx8 y;
+	EGL_Floatx8 z;
+} EGL_Vec3x8;
+
+
+#ifdef EGL_MATH_SSE
+/* Lane i of the result is lane i of the argument list's source lanes. */
+#define EGL_SWIZZLE(v, a, b, c, d) _mm_shuffle_ps((v), (v), _MM_SHUFFLE(d, c, b, a))
+#define EGL_SHUFFLE(v, u, a, b, c, d) _mm_shuffle_ps((v), (u), _MM_SHUFFLE(d, c, b, a))
+
+static inline __m128 EGL_HorizontalSum(__m128 v) {
+	v = _mm_add_ps(v, EGL_SWIZZLE(v, 2, 3, 0, 1));
+	return _mm_add_ps(v, EGL_SWIZZLE(v, 1, 0, 3, 2));
+}
+#endif
+
+
+/* Vec3 — three lanes gain nothing from SSE once the loads and stores are counted */
+
+static inline EGL_Vec3 EGL_Vec3Add(EGL_Vec3 a, EGL_Vec3 b) {
+	return (EGL_Vec3){{ a.x + b.x, a.y + b.y, a.z + b.z }};
+}
+
+static inline EGL_Vec3 EGL_Vec3Sub(EGL_Vec3 a, EGL_Vec3 b) {
+	return (EGL_Vec3){{ a.x - b.x, a.y - b.y, a.z - b.z }};
+}
+
+static inline EGL_Vec3 EGL_Vec3Mul(EGL_Vec3 a, EGL_Vec3 b) {
+	return (EGL_Vec3){{ a.x * b.x, a.y * b.y, a.z * b.z }};
+}
+
+static inline EGL_Vec3 EGL_Vec3Scale(EGL_Vec3 v, float s) {
+	return (EGL_Vec3){{ v.x * s, v.y * s, v.z * s }};
+}
+
+static inline float EGL_Vec3Dot(EGL_Vec3 a, EGL_Vec3 b) {
+	return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+static inline EGL_Vec3 EGL_Vec3Cross(EGL_Vec3 a, EGL_Vec3 b) {
+	return (EGL_Vec3){{ a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x }};
+}
+
+static inline float EGL_Vec3Length(EGL_Vec3 v) {
+	return sqrtf(EGL_Vec3Dot(v, v));
+}
+
+/** Scale to unit length (a zero vector stays zero). */
+static inline EGL_Vec3 EGL_Vec3Normalize(EGL_Vec3 v) {
+	const float d = EGL_Vec3Dot(v, v);
+	return (d > 0.0f) ? EGL_Vec3Scale(v, 1.0f / sqrtf(d)) : v;
+}
+
+static inline EGL_Vec3 EGL_Vec3Lerp(EGL_Vec3 a, EGL_Vec3 b, float t) {
+	return (EGL_Vec3){{ a.x + t * (b.x - a.x), a.y + t * (b.y - a.y), a.z + t * (b.z - a.z) }};
+}
+
+
+/* Vec4 */
+
+static inline EGL_Vec4 EGL_Vec4Add(EGL_Vec4 a, EGL_Vec4 b) {
+	EGL_Vec4 r;
+#ifdef EGL_MATH_SSE
+	r.simd = _mm_add_ps(a.simd, b.simd);
+#else
+	for (int k = 0; k < 4; k++) {
+		r.array[k] = a.array[k] + b.array[k];
+	}
+#endif
+	return r;
+}
+
+static inline EGL_Vec4 EGL_Vec4Sub(EGL_Vec4 a, EGL_Vec4 b) {
+	EGL_Vec4 r;
+#ifdef EGL_MATH_SSE
+	r.simd = _mm_sub_ps(a.simd, b.simd);
+#else
+	for (int k = 0; k < 4; k++) {
+		r.array[k] = a.array[k] - b.array[k];
+	}
+#endif
+	return r;
+}
+
+static inline EGL_Vec4 EGL_Vec4Mul(EGL_Vec4 a, EGL_Vec4 b) {
+	EGL_Vec4 r;
+#ifdef EGL_MATH_SSE
+	r.simd = _mm_mul_ps(a.simd, b.simd);
+#else
+	for (int k = 0; k < 4; k++) {
+		r.array[k] = a.array[k] * b.array[k];
+	}
+#endif
+	return r;
+}
+
+static inline EGL_Vec4 EGL_Vec4Scale(EGL_Vec4 v, float s) {
+	EGL_Vec4 r;
+#ifdef EGL_MATH_SSE
+	r.simd = _mm_mul_ps(v.simd, _mm_set1_ps(s));
+#else
+	for (int k = 0; k < 4; k++) {
+		r.array[k] = v.array[k] * s;
+	}
+#endif
+	return r;
+}
+
+static inline float EGL_Vec4Dot(EGL_Vec4 a, EGL_Vec4 b) {
+#ifdef EGL_MATH_SSE
+	return _mm_cvtss_f32(EGL_HorizontalSum(_mm_mul_ps(a.simd, b.simd)));
+#else
+	return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+#endif
+}
+
+static inline EGL_Vec4 EGL_Vec4Lerp(EGL_Vec4 a, EGL_Vec4 b, float t) {
+	return EGL_Vec4Add(a, EGL_Vec4Scale(EGL_Vec4Sub(b, a), t));
+}
+
+
+/* Mat4 */
+
+static inline EGL_Mat4 EGL_Mat4Identity(void) {
+	return (EGL_Mat4){{ 1,0,0,0, 0,1,0,0, 0,0,1,0, 0,0,0,1 }};
+}
+
+static inline EGL_Vec4 EGL_Mat4MulVec4(EGL_Mat4 m, EGL_Vec4 v) {
+	EGL_Vec4 r;
+#ifdef EGL_MATH_SSE
+	r.simd = _mm_mul_ps(m.columns[0].simd, EGL_SWIZZLE(v.simd, 0, 0, 0, 0));
+	r.simd = _mm_add_ps(r.simd, _mm_mul_ps(m.columns[1].simd, EGL_SWIZZLE(v.simd, 1, 1, 1, 1)));
+	r.simd = _mm_add_ps(r.simd, _mm_mul_ps(m.columns[2].simd, EGL_SWIZZLE(v.simd, 2, 2, 2, 2)));
+	r.simd = _mm_add_ps(r.simd, _mm_mul_ps(m.columns[3].simd, EGL_SWIZZLE(v.simd, 3, 3, 3, 3)));
+#else
+	for (int row = 0; row < 4; row++) {
+		r.array[row] = m.array[row] * v.x + m.array[4 + row] * v.y + m.array[8 + row] * v.z + m.array[12 + row] * v.w;
+	}
+#endif
+	return r;
+}
+
+/** a * b, so b is applied first. */
+static inline EGL_Mat4 EGL_Mat4Mul(EGL_Mat4 a, EGL_Mat4 b) {
+	EGL_Mat4 r;
+	for (int c = 0; c < 4; c++) {
+		r.columns[c] = EGL_Mat4MulVec4(a, b.columns[c]);
+	}
+	return r;
+}
+
+/** Transform a point (w = 1), ignoring any projection. */
+static inline EGL_Vec3 EGL_Mat4MulPoint(EGL_Mat4 m, EGL_Vec3 p) {
+	const float *a = m.array;
+	return (EGL_Vec3){{
+		a[0] * p.x + a[4] * p.y + a[8] * p.z + a[12],
+		a[1] * p.x + a[5] * p.y + a[9] * p.z + a[13],
+		a[2] * p.x + a[6] * p.y + a[10] * p.z + a[14],
+	}};
+}
+
+static inline EGL_Mat4 EGL_Mat4Transpose(EGL_Mat4 m) {
+#ifdef EGL_MATH_SSE
+	_MM_TRANSPOSE4_PS(m.columns[0].simd, m.columns[1].simd, m.columns[2].simd, m.columns[3].simd);
+	return m;
+#else
+	EGL_Mat4 r;
+	for (int c = 0; c < 4; c++) {
+		for (int row = 0; row < 4; row++) {
+			r.array[c * 4 + row] = m.array[row * 4 + c];
+		}
+	}
+	return r;
+#endif
+}
+
+#ifdef EGL_MATH_SSE
+/* 2x2 blocks packed as (m00, m01, m10, m11): a * b, adj(a) * b and a * adj(b). */
+static inline __m128 EGL_Mat2Mul(__m128 a, __m128 b) {
+	return _mm_add_ps(_mm_mul_ps(a, EGL_SWIZZLE(b, 0, 3, 0, 3)), _mm_mul_ps(EGL_SWIZZLE(a, 1, 0, 3, 2), EGL_SWIZZLE(b, 2, 1, 2, 1)));
+}
+
+static inline __m128 EGL_Mat2AdjMul(__m128 a, __m128 b) {
+	return _mm_sub_ps(_mm_mul_ps(EGL_SWIZZLE(a, 3, 3, 0, 0), b), _mm_mul_ps(EGL_SWIZZLE(a, 1, 1, 2, 2), EGL_SWIZZLE(b, 2, 3, 0, 1)));
+}
+
+static inline __m128 EGL_Mat2MulAdj(__m128 a, __m128 b) {
+	return _mm_sub_ps(_mm_mul_ps(a, EGL_SWIZZLE(b, 3, 0, 3, 0)), _mm_mul_ps(EGL_SWIZZLE(a, 1, 0, 3, 2), EGL_SWIZZLE(b, 2, 1, 2, 1)));
+}
+#endif
+
+/**
+ * Invert a general matrix. A singular matrix gives infinities or NaNs; use
+ * EGL_Mat4InverseRigid for rotations and translations, which is cheaper.
+ */
+static inline EGL_Mat4 EGL_Mat4Inverse(EGL_Mat4 m) {
+#ifdef EGL_MATH_SSE
+	/*
+	 * Block-wise inverse on 2x2 sub-matrices, after E. Zhang, "Fast 4x4
+	 * Matrix Inverse with SSE SIMD, Explained". Written for row-major data,
+	 * but inverting the transpose and reading it back transposed is the same.
+	 */
+	const __m128 c0 = m.columns[0].simd;
+	const __m128 c1 = m.columns[1].simd;
+	const __m128 c2 = m.columns[2].simd;
+	const __m128 c3 = m.columns[3].simd;
+	const __m128 A = _mm_movelh_ps(c0, c1);
+	const __m128 B = _mm_movehl_ps(c1, c0);
+	const __m128 C = _mm_movelh_ps(c2, c3);
+	const __m128 D = _mm_movehl_ps(c3, c2);
+
+	/* (|A|, |B|, |C|, |D|) */
+	const __m128 det_sub = _mm_sub_ps(
+		_mm_mul_ps(EGL_SHUFFLE(c0, c2, 0, 2, 0, 2), EGL_SHUFFLE(c1, c3, 1, 3, 1, 3)),
+		_mm_mul_ps(EGL_SHUFFLE(c0, c2, 1, 3, 1, 3), EGL_SHUFFLE(c1, c3, 0, 2, 0, 2)));
+	const __m128 det_a = EGL_SWIZZLE(det_sub, 0, 0, 0, 0);
+	const __m128 det_b = EGL_SWIZZLE(det_sub, 1, 1, 1, 1);
+	const __m128 det_c = EGL_SWIZZLE(det_sub, 2, 2, 2, 2);
+	const __m128 det_d = EGL_SWIZZLE(det_sub, 3, 3, 3, 3);
+
+	const __m128 d_c = EGL_Mat2AdjMul(D, C);
+	const __m128 a_b = EGL_Mat2AdjMul(A, B);
+	__m128 x = _mm_sub_ps(_mm_mul_ps(det_d, A), EGL_Mat2Mul(B, d_c));
+	__m128 w = _mm_sub_ps(_mm_mul_ps(det_a, D), EGL_Mat2Mul(C, a_b));
+	__m128 y = _mm_sub_ps(_mm_mul_ps(det_b, C), EGL_Mat2MulAdj(D, a_b));
+	__m128 z = _mm_sub_ps(_mm_mul_ps(det_c, B), EGL_Mat2MulAdj(A, d_c));
+
+	/* |M| = |A||D| + |B||C| - tr(adj(A) B adj(D) C) */
+	const __m128 tr = EGL_HorizontalSum(_mm_mul_ps(a_b, EGL_SWIZZLE(d_c, 0, 2, 1, 3)));
+	const __m128 det = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(det_a, det_d), _mm_mul_ps(det_b, det_c)), tr);
+	const __m128 inv = _mm_div_ps(_mm_setr_ps(1.0f, -1.0f, -1.0f, 1.0f), det);
+	x = _mm_mul_ps(x, inv);
+	y = _mm_mul_ps(y, inv);
+	z = _mm_mul_ps(z, inv);
+	w = _mm_mul_ps(w, inv);
+
+	EGL_Mat4 r;
+	r.columns[0].simd = EGL_SHUFFLE(x, y, 3, 1, 3, 1);
+	r.columns[1].simd = EGL_SHUFFLE(x, y, 2, 0, 2, 0);
+	r.columns[2].simd = EGL_SHUFFLE(z, w, 3, 1, 3, 1);
+	r.columns[3].simd = EGL_SHUFFLE(z, w, 2, 0, 2, 0);
+	return r;
+#else
+	/* Laplace expansion over 2x2 minors of the top and bottom halves */
+	const float *a = m.array;
+	const float s0 = a[0] * a[5] - a[4] * a[1];
+	const float s1 = a[0] * a[6] - a[4] * a[2];
+	const float s2 = a[0] * a[7] - a[4] * a[3];
+	const float s3 = a[1] * a[6] - a[5] * a[2];
+	const float s4 = a[1] * a[7] - a[5] * a[3];
+	const float s5 = a[2] * a[7] - a[6] * a[3];
+	const float c5 = a[10] * a[15] - a[14] * a[11];
+	const float c4 = a[9] * a[15] - a[13] * a[11];
+	const float c3 = a[9] * a[14] - a[13] * a[10];
+	const float c2 = a[8] * a[15] - a[12] * a[11];
+	const float c1 = a[8] * a[14] - a[12] * a[10];
+	const float c0 = a[8] * a[13] - a[12] * a[9];
+	const float inv = 1.0f / (s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0);
+
+	return (EGL_Mat4){{
+		( a[5] * c5 - a[6] * c4 + a[7] * c3) * inv,
+		(-a[1] * c5 + a[2] * c4 - a[3] * c3) * inv,
+		( a[13] * s5 - a[14] * s4 + a[15] * s3) * inv,
+		(-a[9] * s5 + a[10] * s4 - a[11] * s3) * inv,
+
+		(-a[4] * c5 + a[6] * c2 - a[7] * c1) * inv,
+		( a[0] * c5 - a[2] * c2 + a[3] * c1) * inv,
+		(-a[12] * s5 + a[14] * s2 - a[15] * s1) * inv,
+		( a[8] * s5 - a[10] * s2 + a[11] * s1) * inv,
+
+		( a[4] * c4 - a[5] * c2 + a[7] * c0) * inv,
+		(-a[0] * c4 + a[1] * c2 - a[3] * c0) * inv,
+		( a[12] * s4 - a[13] * s2 + a[15] * s0) * inv,
+		(-a[8] * s4 + a[9] * s2 - a[11] * s0) * inv,
+
+		(-a[4] * c3 + a[5] * c1 - a[6] * c0) * inv,
+		( a[0] * c3 - a[1] * c1 + a[2] * c0) * inv,
+		(-a[12] * s3 + a[13] * s1 - a[14] * s0) * inv,
+		( a[8] * s3 - a[9] * s1 + a[10] * s0) * inv,
+	}};
+#endif
+}
+
+/** Invert a matrix made only of a rotation and a translation. */
+static inline EGL_Mat4 EGL_Mat4InverseRigid(EGL_Mat4 m) {
+	const EGL_Vec3 t = {{ m.array[12], m.array[13], m.array[14] }};
+	m.array[12] = m.array[13] = m.array[14] = 0.0f;
+	EGL_Mat4 r = EGL_Mat4Transpose(m);
+	const EGL_Vec3 u = EGL_Mat4MulPoint(r, t);
+	r.array[12] = -u.x;
+	r.array[13] = -u.y;
+	r.array[14] = -u.z;
+	return r;
+}
+
+
+/* Quat */
+
+static inline EGL_Quat EGL_QuatIdentity(void) {
+	return (EGL_Quat){{ 0.0f, 0.0f, 0.0f, 1.0f }};
+}
+
+/** A rotation of angle radians about a unit axis. */
+static inline EGL_Quat EGL_QuatAxisAngle(EGL_Vec3 axis, float angle) {
+	const float s = sinf(0.5f * angle);
+	return (EGL_Quat){{ axis.x * s, axis.y * s, axis.z * s, cosf(0.5f * angle) }};
+}
+
+static inline EGL_Quat EGL_QuatConjugate(EGL_Quat q) {
+	return (EGL_Quat){{ -q.x, -q.y, -q.z, q.w }};
+}
+
+/** Hamilton product a * b (rotate by b, then by a), like EGL_QuatMul. */
+static inline EGL_Quat EGL_QuatProduct(EGL_Quat a, EGL_Quat b) {
+	EGL_Quat r;
+#ifdef EGL_MATH_SSE
+	const __m128 aw = EGL_SWIZZLE(a.simd, 3, 3, 3, 3);
+	const __m128 ax = EGL_SWIZZLE(a.simd, 0, 0, 0, 0);
+	const __m128 ay = EGL_SWIZZLE(a.simd, 1, 1, 1, 1);
+	const __m128 az = EGL_SWIZZLE(a.simd, 2, 2, 2, 2);
+	__m128 v = _mm_mul_ps(aw, b.simd);
+	v = _mm_add_ps(v, _mm_mul_ps(_mm_mul_ps(ax, EGL_SWIZZLE(b.simd, 3, 2, 1, 0)), _mm_setr_ps(1.0f, -1.0f, 1.0f, -1.0f)));
+	v = _mm_add_ps(v, _mm_mul_ps(_mm_mul_ps(ay, EGL_SWIZZLE(b.simd, 2, 3, 0, 1)), _mm_setr_ps(1.0f, 1.0f, -1.0f, -1.0f)));
+	v = _mm_add_ps(v, _mm_mul_ps(_mm_mul_ps(az, EGL_SWIZZLE(b.simd, 1, 0, 3, 2)), _mm_setr_ps(-1.0f, 1.0f, 1.0f, -1.0f)));
+	r.simd = v;
+#else
+	r.x = a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y;
+	r.y = a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x;
+	r.z = a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w;
+	r.w = a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z;
+#endif
+	return r;
+}
+
+/** Scale back to unit length (a zero quaternion becomes the identity), like EGL_QuatNormalize. */
+static inline EGL_Quat EGL_QuatUnit(EGL_Quat q) {
+	const float d = EGL_Vec4Dot(q, q);
+	return (d > 0.0f) ? EGL_Vec4Scale(q, 1.0f / sqrtf(d)) : EGL_QuatIdentity();
+}
+
+/** Rotate a vector by a unit quaternion: v + w t + u x t, with t = 2 u x v. */
+static inline EGL_Vec3 EGL_QuatRotateVec3(EGL_Quat q, EGL_Vec3 v) {
+	const EGL_Vec3 u = {{ q.x, q.y, q.z }};
+	const EGL_Vec3 t = EGL_Vec3Scale(EGL_Vec3Cross(u, v), 2.0f);
+	return EGL_Vec3Add(EGL_Vec3Add(v, EGL_Vec3Scale(t, q.w)), EGL_Vec3Cross(u, t));
+}
+
+/** Compose translation * rotation * scale, the usual model matrix. */
+static inline EGL_Mat4 EGL_Mat4Trs(EGL_Vec3 translation, EGL_Quat rotation, EGL_Vec3 scale) {
+	const float x = rotation.x, y = rotation.y, z = rotation.z, w = rotation.w;
+	const float xx = x * x, yy = y * y, zz = z * z;
+	const float xy = x * y, xz = x * z, yz = y * z;
+	const float wx = w * x, wy = w * y, wz = w * z;
+	return (EGL_Mat4){{
+		(1.0f - 2.0f * (yy + zz)) * scale.x, 2.0f * (xy + wz) * scale.x, 2.0f * (xz - wy) * scale.x, 0.0f,
+		2.0f * (xy - wz) * scale.y, (1.0f - 2.0f * (xx + zz)) * scale.y, 2.0f * (yz + wx) * scale.y, 0.0f,
+		2.0f * (xz + wy) * scale.z, 2.0f * (yz - wx) * scale.z, (1.0f - 2.0f * (xx + yy)) * scale.z, 0.0f,
+		translation.x, translation.y, translation.z, 1.0f,
+	}};
+}
+
+
+/* Floatx8 */
+
+static inline EGL_Floatx8 EGL_Floatx8Set(float s) {
+	EGL_Floatx8 r;
+#if defined(EGL_MATH_AVX)
+	r.v = _mm256_set1_ps(s);
+#elif defined(EGL_MATH_SSE)
+	r.lo = r.hi = _mm_set1_ps(s);
+#else
+	for (int k = 0; k < 8; k++) {
+		r.f[k] = s;
+	}
+#endif
+	return r;
+}
+
+static inline EGL_Floatx8 EGL_Floatx8Load(const float *p) {
+	EGL_Floatx8 r;
+#if defined(EGL_MATH_AVX)
+	r.v = _mm256_loadu_ps(p);
+#elif defined(EGL_MATH_SSE)
+	r.lo = _mm_loadu_ps(p);
+	r.hi = _mm_loadu_ps(p + 4);
+#else
+	for (int k = 0; k < 8; k++) {
+		r.f[k] = p[k];
+	}
+#endif
+	return r;
+}
+
+static inline void EGL_Floatx8Store(float *p, EGL_Floatx8 a) {
+#if defined(EGL_MATH_AVX)
+	_mm256_storeu_ps(p, a.v);
+#elif defined(EGL_MATH_SSE)
+	_mm_storeu_ps(p, a.lo);
+	_mm_storeu_ps(p + 4, a.hi);
+#else
+	for (int k = 0; k < 8; k++) {
+		p[k] = a.f[k];
+	}
+#endif
+}
+
+/* The arithmetic is the same shape for every backend */
+#if defined(EGL_MATH_AVX)
+#define EGL_FLOATX8_OP(name, avx, sse, expr) \
+	static inline EGL_Floatx8 name(EGL_Floatx8 a, EGL_Floatx8 b) { \
+		EGL_Floatx8 r; \
+		r.v = avx(a.v, b.v); \
+		return r; \
+	}
+#elif defined(EGL_MATH_SSE)
+#define EGL_FLOATX8_OP(name, avx, sse, expr) \
+	static inline EGL_Floatx8 name(EGL_Floatx8 a, EGL_Floatx8 b) { \
+		EGL_Floatx8 r; \
+		r.lo = sse(a.lo, b.lo); \
+		r.hi = sse(a.hi, b.hi); \
+		return r; \
+	}
+#else
+#define EGL_FLOATX8_OP(name, avx, sse, expr) \
+	static inline EGL_Floatx8 name(EGL_Floatx8 a, EGL_Floatx8 b) { \
+		EGL_Floatx8 r; \
+		for (int k = 0; k < 8; k++) { \
+			const float x = a.f[k], y = b.f[k]; \
+			r.f[k] = (expr); \
+		} \
+		return r; \
+	}
+#endif
+
+EGL_FLOATX8_OP(EGL_Floatx8Add, _mm256_add_ps, _mm_add_ps, x + y)
+EGL_FLOATX8_OP(EGL_Floatx8Sub, _mm256_sub_ps, _mm_sub_ps, x - y)
+EGL_FLOATX8_OP(EGL_Floatx8Mul, _mm256_mul_ps, _mm_mul_ps, x * y)
+EGL_FLOATX8_OP(EGL_Floatx8Div, _mm256_div_ps, _mm_div_ps, x / y)
+EGL_FLOATX8_OP(EGL_Floatx8Min, _mm256_min_ps, _mm_min_ps, (y < x) ? y : x)
+EGL_FLOATX8_OP(EGL_Floatx8Max, _mm256_max_ps, _mm_max_ps, (x < y) ? y : x)
+
+static inline EGL_Floatx8 EGL_Floatx8Sqrt(EGL_Floatx8 a) {
+	EGL_Floatx8 r;
+#if defined(EGL_MATH_AVX)
+	r.v = _mm256_sqrt_ps(a.v);
+#elif defined(EGL_MATH_SSE)
+	r.lo = _mm_sqrt_ps(a.lo);
+	r.hi = _mm_sqrt_ps(a.hi);
+#else
+	for (int k = 0; k < 8; k++) {
+		r.f[k] = sqrtf(a.f[k]);
+	}
+#endif
+	return r;
+}
+
+
+/* Vec3x8 */
+
+/** Load vectors i to i + 7 from SoA arrays. */
+static inline EGL_Vec3x8 EGL_Vec3x8Load(const float *x, const float *y, const float *z, size_t i) {
+	return (EGL_Vec3x8){ EGL_Floatx8Load(x + i), EGL_Floatx8Load(y + i), EGL_Floatx8Load(z + i) };
+}
+
+/** Store into vectors i to i + 7 of SoA arrays. */
+static inline void EGL_Vec3x8Store(float *x, float *y, float *z, size_t i, EGL_Vec3x8 v) {
+	EGL_Floatx8Store(x + i, v.x);
+	EGL_Floatx8Store(y + i, v.y);
+	EGL_Floatx8Store(z + i, v.z);
+}
+
+/** The same vector in every lane. */
+static inline EGL_Vec3x8 EGL_Vec3x8Splat(EGL_Vec3 v) {
+	return (EGL_Vec3x8){ EGL_Floatx8Set(v.x), EGL_Floatx8Set(v.y), EGL_Floatx8Set(v.z) };
+}
+
+static inline EGL_Vec3x8 EGL_Vec3x8Add(EGL_Vec3x8 a, EGL_Vec3x8 b) {
+	return (EGL_Vec3x8){ EGL_Floatx8Add(a.x, b.x), EGL_Floatx8Add(a.y, b.y), EGL_Floatx8Add(a.z, b.z) };
+}
+
+static inline EGL_Vec3x8 EGL_Vec3x8Sub(EGL_Vec3x8 a, EGL_Vec3x8 b) {
+	return (EGL_Vec3x8){ EGL_Floatx8Sub(a.x, b.x), EGL_Floatx8Sub(a.y, b.y), EGL_Floatx8Sub(a.z, b.z) };
+}
+
+static inline EGL_Vec3x8 EGL_Vec3x8Scale(EGL_Vec3x8 v, EGL_Floatx8 s) {
+	return (EGL_Vec3x8){ EGL_Floatx8Mul(v.x, s), EGL_Floatx8Mul(v.y, s), EGL_Floatx8Mul(v.z, s) };
+}
+
+static inline EGL_Floatx8 EGL_Vec3x8Dot(EGL_Vec3x8 a, EGL_Vec3x8 b) {
+	return EGL_Floatx8Add(EGL_Floatx8Add(EGL_Floatx8Mul(a.x, b.x), EGL_Floatx8Mul(a.y, b.y)), EGL_Floatx8Mul(a.z, b.z));
+}
+
+static inline EGL_Vec3x8 EGL_Vec3x8Cross(EGL_Vec3x8 a, EGL_Vec3x8 b) {
+	return (EGL_Vec3x8){
+		EGL_Floatx8Sub(EGL_Floatx8Mul(a.y, b.z), EGL_Floatx8Mul(a.z, b.y)),
+		EGL_Floatx8Sub(EGL_Floatx8Mul(a.z, b.x), EGL_Floatx8Mul(a.x, b.z)),
+		EGL_Floatx8Sub(EGL_Floatx8Mul(a.x, b.y), EGL_Floatx8Mul(a.y, b.x)),
+	};
+}
+
+static inline EGL_Floatx8 EGL_Vec3x8Length(EGL_Vec3x8 v) {
+	return EGL_Floatx8Sqrt(EGL_Vec3x8Dot(v, v));
+}
+
+/** Scale every lane to unit length (zero vectors give NaNs). */
+static inline EGL_Vec3x8 EGL_Vec3x8Normalize(EGL_Vec3x8 v) {
+	return EGL_Vec3x8Scale(v, EGL_Floatx8Div(EGL_Floatx8Set(1.0f), EGL_Vec3x8Length(v)));
+}
+
+/** Rotate eight vectors by one unit quaternion, as EGL_QuatRotateVec3. */
+static inline EGL_Vec3x8 EGL_Vec3x8Rotate(EGL_Quat q, EGL_Vec3x8 v) {
+	const EGL_Vec3x8 u = EGL_Vec3x8Splat((EGL_Vec3){{ q.x, q.y, q.z }});
+	const EGL_Vec3x8 t = EGL_Vec3x8Scale(EGL_Vec3x8Cross(u, v), EGL_Floatx8Set(2.0f));
+	return EGL_Vec3x8Add(EGL_Vec3x8Add(v, EGL_Vec3x8Scale(t, EGL_Floatx8Set(q.w))), EGL_Vec3x8Cross(u, t));
+}
+
+
+#endif /* EGL_MATH_H */
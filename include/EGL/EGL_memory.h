@@ -0,0 +1,44 @@
+/**
+ * @file EGL_memory.h
+ * @brief The allocator every EGL module allocates through.
+ *
+ * EGL modules allocate with EGL_malloc, EGL_calloc and EGL_realloc and free
+ * with EGL_free. These call the C library until EGL_SetMemoryFunctions
+ * replaces them, the way SDL_SetMemoryFunctions does for SDL. A game that
+ * counts allocations installs the tracker (EGL_alloc.h) here as well as in
+ * front of SDL, so the library's allocations count against its frame budget:
+ *
+ *     EGL_SetMemoryFunctions(EGL_AllocMalloc, EGL_AllocCalloc, EGL_AllocRealloc, EGL_AllocFree);
+ *
+ * Memory an EGL function hands back "from EGL_malloc" is freed with EGL_free.
+ * The few cache-line aligned blocks the job system and sim thread allocate
+ * once at startup come from aligned_alloc and are not counted.
+ */
+
+#ifndef EGL_MEMORY_H
+#define EGL_MEMORY_H
+
+
+#include <stddef.h>
+
+
+typedef void *(*EGL_MallocFunc)(size_t size);
+typedef void *(*EGL_CallocFunc)(size_t count, size_t size);
+typedef void *(*EGL_ReallocFunc)(void *memory, size_t size);
+typedef void (*EGL_FreeFunc)(void *memory);
+
+
+/**
+ * Set the functions EGL allocates with. Call before EGL allocates anything,
+ * or make sure the new functions can free what the old ones allocated. A NULL
+ * function restores the C library's.
+ */
+void EGL_SetMemoryFunctions(EGL_MallocFunc malloc_func, EGL_CallocFunc calloc_func, EGL_ReallocFunc realloc_func, EGL_FreeFunc free_func);
+
+void *EGL_malloc(size_t size);
+void *EGL_calloc(size_t count, size_t size);
+void *EGL_realloc(void *memory, size_t size);
+void EGL_free(void *memory);
+
+
+#endif
@@ -0,0 +1,133 @@
+/**
+ * @file EGL_mesh.h
+ * @brief Triangle mesh connectivity and procedural mesh generation.
+ */
+
+#ifndef EGL_MESH_H
+#define EGL_MESH_H
+
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <EGL/EGL_memory.h>
+
+
+#define EGL_MESH_NONE UINT32_MAX // Marks a missing neighbor (boundary edge).
+
+#define EGL_MESH_ADJACENCY_MAGIC   0x4A444145 // "EADJ"
+#define EGL_MESH_ADJACENCY_VERSION 1
+
+
+/**
+ * Compact connectivity of an indexed triangle mesh.
+ *
+ * Render meshes duplicate vertices along UV seams, so vertices sharing a
+ * position are first welded into a single node. All connectivity is expressed
+ * in terms of nodes, ordered along a Morton curve for spatial locality.
+ *
+ * Every array lives in one contiguous block of memory so the structure can be
+ * serialized with a single copy.
+ */
+typedef struct {
+	uint32_t vertex_count;   /**< Render vertices in the source mesh. */
+	uint32_t node_count;     /**< Welded vertices. */
+	uint32_t triangle_count;
+	uint32_t edge_count;     /**< Directed neighbor entries (twice the undirected edges). */
+
+	uint32_t *remap;              /**< [vertex_count] Render vertex -> node. */
+	float    *positions;          /**< [node_count * 3] Node positions (x,y,z). */
+	uint32_t *triangle_nodes;     /**< [triangle_count * 3] Triangle corners as nodes. */
+	uint32_t *neighbor_offsets;   /**< [node_count + 1] CSR offsets into neighbors. */
+	uint32_t *neighbors;          /**< [edge_count] Node -> node, sorted ascending per node. */
+	uint32_t *triangle_neighbors; /**< [triangle_count * 3] Slot e is the triangle across edge (c[e], c[e+1]). */
+	uint32_t *fan_offsets;        /**< [node_count + 1] CSR offsets into fans. */
+	uint32_t *fans;               /**< [triangle_count * 3] Node -> incident triangles. */
+
+	void  *memory;
+	size_t memory_size;
+} EGL_MeshAdjacency;
+
+
+/**
+ * Build the adjacency of an indexed triangle mesh.
+ *
+ * Vertices whose positions fall into the same cell of a 2^21 grid over the
+ * mesh bounds are welded. Construction is sort based (parallel radix sort)
+ * rather than hash based. Edges shared by more than two triangles are paired
+ * in index order; the rest are left as EGL_MESH_NONE.
+ *
+ * @param adj The adjacency to initialize. Free with EGL_MeshAdjacencyFree.
+ * @param indices Triangle list indices.
+ * @param index_count Number of indices (a multiple of 3).
+ * @param vertices Vertex positions (x,y,z).
+ * @param vertex_count Number of vertices.
+ * @return True on success, false on allocation failure, an index out of range
+ * or an index count that is not a multiple of 3.
+ */
+bool EGL_MeshAdjacencyBuild(EGL_MeshAdjacency *adj, const uint32_t *indices, uint32_t index_count, const float *vertices, uint32_t vertex_count);
+
+/** Free all memory held by the adjacency and zero it. */
+void EGL_MeshAdjacencyFree(EGL_MeshAdjacency *adj);
+
+/** Get the number of bytes EGL_MeshAdjacencySerialize will write. */
+size_t EGL_MeshAdjacencySerializedSize(const EGL_MeshAdjacency *adj);
+
+/**
+ * Serialize the adjacency into a buffer.
+ *
+ * @param adj The adjacency to serialize.
+ * @param dst Destination of at least EGL_MeshAdjacencySerializedSize bytes.
+ * @return The number of bytes written.
+ */
+size_t EGL_MeshAdjacencySerialize(const EGL_MeshAdjacency *adj, void *dst);
+
+/**
+ * Deserialize adjacency written by EGL_MeshAdjacencySerialize.
+ *
+ * @param adj The adjacency to initialize. Free with EGL_MeshAdjacencyFree.
+ * @param src The serialized bytes.
+ * @param size The number of bytes available in src.
+ * @return False if the data is malformed or memory could not be allocated.
+ */
+bool EGL_MeshAdjacencyDeserialize(EGL_MeshAdjacency *adj, const void *src, size_t size);
+
+/**
+ * Check that adjacency belongs to a mesh, such as one loaded alongside it.
+ *
+ * Every count must match the mesh, every triangle corner must be the welded
+ * node of its vertex, and every node, edge and triangle reference must be in
+ * range, so stale or corrupt adjacency is caught before anything indexes it.
+ *
+ * @param adj The adjacency to check.
+ * @param indices Triangle list indices of the mesh.
+ * @param index_count Number of indices.
+ * @param vertex_count Number of vertices in the mesh.
+ * @return True if the adjacency is consistent with the mesh.
+ */
+bool EGL_MeshAdjacencyValidate(const EGL_MeshAdjacency *adj, const uint32_t *indices, uint32_t index_count, uint32_t vertex_count);
+
+/** Get the number of neighbors of a node. */
+static inline uint32_t EGL_MeshNodeDegree(const EGL_MeshAdjacency *adj, uint32_t node) {
+	return adj->neighbor_offsets[node + 1] - adj->neighbor_offsets[node];
+}
+
+/**
+ * Generate an icosphere of unit radius.
+ *
+ * Each face of an icosahedron is split into a (2^level)^2 triangle grid, so a
+ * sphere has 20 * 4^level triangles. Vertices along face edges are duplicated
+ * (bitwise identical) between faces, as they would be in a seamed render mesh.
+ *
+ * @param level Subdivision level in [0, 10].
+ * @param vertices Output positions (x,y,z). Free with EGL_free().
+ * @param vertex_count Output number of vertices.
+ * @param indices Output triangle list indices (CCW, outward). Free with EGL_free().
+ * @param index_count Output number of indices.
+ * @return False if the level is out of range or allocation failed.
+ */
+bool EGL_MeshIcosphere(int level, float **vertices, uint32_t *vertex_count, uint32_t **indices, uint32_t *index_count);
+
+
+#endif /* EGL_MESH_H */
@@ -0,0 +1,120 @@
+/**
+ * @file EGL_pack.h
+ * @brief Packed asset archives: many files in one, mapped read-only and looked up by name.
+ *
+ * An archive is written once at build time by the pack tool, then mapped by
+ * the game at startup. Opening it costs one open and one mmap however many
+ * assets it holds, and each asset is a view straight into the mapping: no
+ * copy, and a page is only read from disk when something first touches it.
+ *
+ * Layout, in the byte order of the machine that packed it, with every asset
+ * aligned to EGL_PACK_ALIGN:
+ *
+ *     EGL_PackHeader
+ *     EGL_PackEntry[count]  Assets in the order they were packed; the index is the id.
+ *     uint32_t[slots]       Open-addressed hash table of id + 1 (0 is empty), by name hash.
+ *     char[]                Names, each NUL-terminated.
+ *     ...                   Asset bytes.
+ */
+
+#ifndef EGL_PACK_H
+#define EGL_PACK_H
+
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+#define EGL_PACK_MAGIC "EGLPACK"
+#define EGL_PACK_VERSION 1
+#define EGL_PACK_ALIGN 64 // Alignment of every asset in the archive.
+#define EGL_PACK_NONE UINT32_MAX
+
+
+typedef struct {
+	char magic[8];         /**< EGL_PACK_MAGIC, NUL-terminated. */
+	uint32_t version;
+	uint32_t count;        /**< Assets in the archive. */
+	uint32_t slots;        /**< Hash table slots, a power of two above count. */
+	uint32_t names_size;   /**< Bytes of names. */
+	uint64_t size;         /**< Bytes in the whole archive. */
+} EGL_PackHeader;
+
+typedef struct {
+	uint64_t hash;         /**< EGL_PackHash of the name. */
+	uint64_t offset;       /**< From the start of the archive. */
+	uint64_t size;
+	uint32_t name;         /**< Offset into the names. */
+	uint32_t name_length;
+} EGL_PackEntry;
+
+typedef struct {
+	const uint8_t *base;   /**< The mapped archive. */
+	size_t size;
+	const EGL_PackHeader *header;
+	const EGL_PackEntry *entries;
+	const uint32_t *slots;
+	const char *names;
+	bool mapped;           /**< base came from mmap rather than EGL_malloc. */
+} EGL_Pack;
+
+
+/** Hash an asset name (64-bit FNV-1a). */
+static inline uint64_t EGL_PackHash(const char *name, size_t length) {
+	uint64_t hash = 14695981039346656037u;
+	for (size_t i = 0; i < length; i++) {
+		hash = (hash ^ (uint8_t)name[i]) * 1099511628211u;
+	}
+	return hash;
+}
+
+
+/**
+ * Write an archive.
+ *
+ * @param path The archive, replacing any file there.
+ * @param names The assets' names, which must be distinct.
+ * @param data The assets' bytes.
+ * @param sizes The assets' sizes.
+ * @param count The number of assets.
+ * @return False if a name repeats or the file cannot be written.
+ */
+bool EGL_PackWrite(const char *path, const char *const *names, const void *const *data, const size_t *sizes, uint32_t count);
+
+/**
+ * Map an archive read-only and check its table of contents.
+ *
+ * @param p The archive. Views into it last until EGL_PackClose.
+ * @param path The archive file.
+ * @return False if it cannot be opened or is not a valid archive.
+ */
+bool EGL_PackOpen(EGL_Pack *p, const char *path);
+
+/** Unmap an archive and zero it. */
+void EGL_PackClose(EGL_Pack *p);
+
+/** Get an asset's id, or EGL_PACK_NONE if the archive has no asset by that name. */
+uint32_t EGL_PackFind(const EGL_Pack *p, const char *name);
+
+/** Get the asset with an id and its size, or NULL if there is none. */
+static inline const void *EGL_PackData(const EGL_Pack *p, uint32_t id, size_t *size) {
+	if (id >= p->header->count) {
+		return NULL;
+	}
+	*size = (size_t)p->entries[id].size;
+	return p->base + p->entries[id].offset;
+}
+
+/** Get the asset with a name and its size, or NULL if there is none. */
+static inline const void *EGL_PackGet(const EGL_Pack *p, const char *name, size_t *size) {
+	return EGL_PackData(p, EGL_PackFind(p, name), size);
+}
+
+/** Get an asset's name. */
+static inline const char *EGL_PackName(const EGL_Pack *p, uint32_t id) {
+	return (id < p->header->count) ? p->names + p->entries[id].name : NULL;
+}
+
+
+#endif /* EGL_PACK_H */
@@ -0,0 +1,72 @@
+/**
+ * @file EGL_parallel.h
+ * @brief Minimal fork-join helpers for splitting a kernel across threads.
+ */
+
+#ifndef EGL_PARALLEL_H
+#define EGL_PARALLEL_H
+
+
+#include <stddef.h>
+
+
+#define EGL_THREADS_MAX 64
+
+
+/**
+ * A kernel run once per thread by EGL_ParallelRun.
+ *
+ * @param data User data shared by every invocation.
+ * @param index The index of this invocation in [0, count).
+ * @param count The total number of invocations.
+ */
+typedef void (*EGL_ParallelFunc)(void *data, int index, int count);
+
+
+/**
+ * Get the number of threads EGL kernels should split their work across.
+ *
+ * Defaults to the number of online processors, clamped to EGL_THREADS_MAX.
+ */
+int EGL_ThreadCount(void);
+
+/**
+ * Override the number of threads returned by EGL_ThreadCount.
+ *
+ * @param count Thread count (values < 1 restore the default).
+ */
+void EGL_SetThreadCount(int count);
+
+/**
+ * Run a kernel `count` times in parallel and wait for all of them to finish.
+ *
+ * Invocation 0 runs on the calling thread. All invocations run concurrently,
+ * so kernels may synchronize with each other (e.g. with a barrier). If fewer
+ * threads can be created than requested, the kernel sees a smaller count.
+ *
+ * @param func The kernel.
+ * @param data User data passed to every invocation.
+ * @param count Requested number of invocations (usually EGL_ThreadCount()).
+ */
+void EGL_ParallelRun(EGL_ParallelFunc func, void *data, int count);
+
+/**
+ * Split the range [0, n) into `count` contiguous chunks and get chunk `index`.
+ *
+ * @param n The size of the range.
+ * @param index The chunk index in [0, count).
+ * @param count The number of chunks.
+ * @param begin Output first element of the chunk.
+ * @param end Output one past the last element of the chunk.
+ */
+static inline void EGL_ParallelRange(size_t n, int index, int count, size_t *begin, size_t *end) {
+	size_t chunk = n / (size_t)count;
+	size_t rem = n % (size_t)count;
+	size_t i = (size_t)index;
+
+	*begin = i * chunk + (i < rem ? i : rem);
+	*end = *begin + chunk + (i < rem ? 1 : 0);
+}
+
+
+#endif /* EGL_PARALLEL_H */
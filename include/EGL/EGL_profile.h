@@ -0,0 +1,106 @@
+/**
+ * @file EGL_profile.h
+ * @brief Scoped zone profiler that records per-thread timelines and exports them as a Chrome trace.
+ *
+ * Each thread records finished zones into its own EGL_SpscRing, so recording
+ * never takes a lock or touches another thread's cache lines. Once a frame,
+ * EGL_ProfileFrame marks the frame boundary and drains every ring into the
+ * trace file, which loads in chrome://tracing and ui.perfetto.dev.
+ *
+ * The zone macros compile to nothing unless EGL_PROFILE is defined. When it
+ * is defined but no trace is being written, a zone costs one relaxed load.
+ *
+ *     EGL_PROFILE_SCOPE("simulate") {
+ *         ...
+ *     }
+ *
+ *     EGL_PROFILE_BEGIN(upload, "upload");
+ *     ...
+ *     EGL_PROFILE_END(upload);
+ *
+ * Zone names must outlive the trace (string literals). Leaving a scope with
+ * return, break or goto drops its zone.
+ */
+
+#ifndef EGL_PROFILE_H
+#define EGL_PROFILE_H
+
+
+#include <EGL/EGL_queue.h>
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+
+#define EGL_PROFILE_EVENTS 16384 // Events each thread can hold between flushes; more are dropped.
+
+
+typedef struct {
+	const char *name;
+	uint64_t begin_ns; /**< 0 when the zone started with profiling off. */
+	bool open;
+} EGL_ProfileZone;
+
+/** True while a trace is being written. */
+extern _Atomic bool EGL_PROFILE_ENABLED;
+
+
+/**
+ * Start writing a trace, replacing any file at path.
+ *
+ * @param path The trace file.
+ * @return False if a trace is already being written or the file cannot be opened.
+ */
+bool EGL_ProfileStart(const char *path);
+
+/** Stop recording, flush every thread's events and close the trace. */
+void EGL_ProfileStop(void);
+
+/** Mark the end of a frame and flush every thread's events into the trace. Call from the main loop. */
+void EGL_ProfileFrame(void);
+
+/** Name the calling thread in the trace. The name must outlive the trace. */
+void EGL_ProfileThreadName(const char *name);
+
+/** Get the number of events dropped because a thread's ring was full. */
+uint64_t EGL_ProfileDropped(void);
+
+/** Get monotonic time in nanoseconds. */
+uint64_t EGL_ProfileNow(void);
+
+/** Record a finished zone for the calling thread. */
+void EGL_ProfileRecord(const char *name, uint64_t begin_ns, uint64_t end_ns);
+
+
+static inline EGL_ProfileZone EGL_ProfileBegin(const char *name) {
+	EGL_ProfileZone zone = { .name = name, .begin_ns = 0, .open = true };
+	if (atomic_load_explicit(&EGL_PROFILE_ENABLED, memory_order_relaxed)) {
+		zone.begin_ns = EGL_ProfileNow();
+	}
+	return zone;
+}
+
+static inline void EGL_ProfileEnd(EGL_ProfileZone *zone) {
+	zone->open = false;
+	if (zone->begin_ns) {
+		EGL_ProfileRecord(zone->name, zone->begin_ns, EGL_ProfileNow());
+	}
+}
+
+
+#ifdef EGL_PROFILE
+#define EGL_PROFILE_SCOPE(name) \
+	for (EGL_ProfileZone EGL_PROFILE_ZONE_ = EGL_ProfileBegin(name); EGL_PROFILE_ZONE_.open; EGL_ProfileEnd(&EGL_PROFILE_ZONE_))
+#define EGL_PROFILE_BEGIN(zone, name) EGL_ProfileZone zone = EGL_ProfileBegin(name)
+#define EGL_PROFILE_END(zone) EGL_ProfileEnd(&zone)
+#define EGL_PROFILE_FRAME() EGL_ProfileFrame()
+#else
+#define EGL_PROFILE_SCOPE(name)
+#define EGL_PROFILE_BEGIN(zone, name) ((void)0)
+#define EGL_PROFILE_END(zone) ((void)0)
+#define EGL_PROFILE_FRAME() ((void)0)
+#endif
+
+
+#endif /* EGL_PROFILE_H */
@@ -0,0 +1,251 @@
+/**
+ * @file EGL_queue.h
+ * @brief Lock-free bounded queues and sharded counters for passing work between threads.
+ *
+ * - EGL_SpscRing: one producer and one consumer. Each side owns its index and
+ *   keeps a cached copy of the other's, so it only touches the shared cache
+ *   line when the ring looks full (or empty).
+ * - EGL_MpmcQueue: any number of producers and consumers, after D. Vyukov's
+ *   bounded MPMC queue. Each cell carries a sequence number that says whose
+ *   turn it is, so a push or pop is one compare-and-swap on the index and no
+ *   thread ever waits for another to finish its copy.
+ * - EGL_ShardedCounter: a counter many threads bump at once. Each thread adds
+ *   to its own cache line and readers sum the shards.
+ *
+ * Elements are fixed-size byte blobs copied in and out. Capacities are
+ * rounded up to a power of two. Every push and pop returns false instead of
+ * blocking, so callers choose whether to spin, yield or do other work.
+ */
+
+#ifndef EGL_QUEUE_H
+#define EGL_QUEUE_H
+
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <EGL/EGL_memory.h>
+
+
+#define EGL_CACHE_LINE 64
+
+#define EGL_COUNTER_SHARDS 16 // Shards per counter; threads beyond this share them.
+
+
+typedef struct {
+	_Alignas(EGL_CACHE_LINE) _Atomic size_t head; /**< Next element to pop, written by the consumer. */
+	size_t cached_tail;                            /**< The consumer's last look at tail. */
+	_Alignas(EGL_CACHE_LINE) _Atomic size_t tail; /**< Next slot to push, written by the producer. */
+	size_t cached_head;                            /**< The producer's last look at head. */
+	_Alignas(EGL_CACHE_LINE) unsigned char *slots; /**< [capacity * size] */
+	size_t mask;                                   /**< Capacity - 1. */
+	size_t size;                                   /**< Bytes per element. */
+} EGL_SpscRing;
+
+typedef struct {
+	_Alignas(EGL_CACHE_LINE) _Atomic size_t enqueue; /**< Next position to push. */
+	_Alignas(EGL_CACHE_LINE) _Atomic size_t dequeue; /**< Next position to pop. */
+	_Alignas(EGL_CACHE_LINE) unsigned char *cells;   /**< [capacity * stride] A sequence number, then the element. */
+	size_t mask;                                     /**< Capacity - 1. */
+	size_t size;                                     /**< Bytes per element. */
+	size_t stride;                                   /**< Bytes per cell. */
+} EGL_MpmcQueue;
+
+typedef struct {
+	_Alignas(EGL_CACHE_LINE) _Atomic int64_t value;
+} EGL_CounterShard;
+
+typedef struct {
+	EGL_CounterShard shards[EGL_COUNTER_SHARDS];
+} EGL_ShardedCounter;
+
+
+static inline size_t EGL_QueueCapacity(size_t capacity) {
+	size_t c = 2;
+	while (c < capacity) {
+		c <<= 1;
+	}
+	return c;
+}
+
+
+/**
+ * Allocate an empty ring.
+ *
+ * @param ring The ring. Free with EGL_SpscRingFree.
+ * @param capacity Elements the ring can hold (rounded up to a power of two).
+ * @param size Bytes per element.
+ * @return False on allocation failure.
+ */
+static inline bool EGL_SpscRingInit(EGL_SpscRing *ring, size_t capacity, size_t size) {
+	memset(ring, 0, sizeof(*ring));
+	capacity = EGL_QueueCapacity(capacity);
+	ring->slots = (unsigned char *)EGL_malloc(capacity * (size ? size : 1));
+	if (!ring->slots) {
+		return false;
+	}
+	ring->mask = capacity - 1;
+	ring->size = size;
+	atomic_init(&ring->head, 0);
+	atomic_init(&ring->tail, 0);
+	return true;
+}
+
+/** Free all memory held by the ring and zero it. */
+static inline void EGL_SpscRingFree(EGL_SpscRing *ring) {
+	EGL_free(ring->slots);
+	memset(ring, 0, sizeof(*ring));
+}
+
+/** Copy an element in. Only the producer may call this. False if the ring is full. */
+static inline bool EGL_SpscRingPush(EGL_SpscRing *ring, const void *element) {
+	const size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+	if (tail - ring->cached_head > ring->mask) {
+		ring->cached_head = atomic_load_explicit(&ring->head, memory_order_acquire);
+		if (tail - ring->cached_head > ring->mask) {
+			return false;
+		}
+	}
+	memcpy(ring->slots + (tail & ring->mask) * ring->size, element, ring->size);
+	atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+	return true;
+}
+
+/** Copy the oldest element out. Only the consumer may call this. False if the ring is empty. */
+static inline bool EGL_SpscRingPop(EGL_SpscRing *ring, void *element) {
+	const size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+	if (head == ring->cached_tail) {
+		ring->cached_tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+		if (head == ring->cached_tail) {
+			return false;
+		}
+	}
+	memcpy(element, ring->slots + (head & ring->mask) * ring->size, ring->size);
+	atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+	return true;
+}
+
+/** Get roughly how many elements are queued (exact when neither side is running). */
+static inline size_t EGL_SpscRingCount(EGL_SpscRing *ring) {
+	return atomic_load_explicit(&ring->tail, memory_order_acquire) - atomic_load_explicit(&ring->head, memory_order_acquire);
+}
+
+
+static inline _Atomic size_t *EGL_MpmcSequence(EGL_MpmcQueue *queue, size_t position) {
+	return (_Atomic size_t *)(queue->cells + (position & queue->mask) * queue->stride);
+}
+
+/**
+ * Allocate an empty queue.
+ *
+ * @param queue The queue. Free with EGL_MpmcQueueFree.
+ * @param capacity Elements the queue can hold (rounded up to a power of two).
+ * @param size Bytes per element.
+ * @return False on allocation failure.
+ */
+static inline bool EGL_MpmcQueueInit(EGL_MpmcQueue *queue, size_t capacity, size_t size) {
+	memset(queue, 0, sizeof(*queue));
+	capacity = EGL_QueueCapacity(capacity);
+	queue->size = size;
+	queue->stride = (sizeof(size_t) + size + _Alignof(max_align_t) - 1) / _Alignof(max_align_t) * _Alignof(max_align_t);
+	queue->cells = (unsigned char *)EGL_malloc(capacity * queue->stride);
+	if (!queue->cells) {
+		return false;
+	}
+	queue->mask = capacity - 1;
+	for (size_t i = 0; i < capacity; i++) {
+		atomic_init(EGL_MpmcSequence(queue, i), i);
+	}
+	atomic_init(&queue->enqueue, 0);
+	atomic_init(&queue->dequeue, 0);
+	return true;
+}
+
+/** Free all memory held by the queue and zero it. */
+static inline void EGL_MpmcQueueFree(EGL_MpmcQueue *queue) {
+	EGL_free(queue->cells);
+	memset(queue, 0, sizeof(*queue));
+}
+
+/** Copy an element in from any thread. False if the queue is full. */
+static inline bool EGL_MpmcQueuePush(EGL_MpmcQueue *queue, const void *element) {
+	size_t position = atomic_load_explicit(&queue->enqueue, memory_order_relaxed);
+	for (;;) {
+		_Atomic size_t *sequence = EGL_MpmcSequence(queue, position);
+		const intptr_t turn = (intptr_t)atomic_load_explicit(sequence, memory_order_acquire) - (intptr_t)position;
+		if (turn == 0) {
+			/* The cell is free for this lap: claim the position */
+			if (atomic_compare_exchange_weak_explicit(&queue->enqueue, &position, position + 1, memory_order_relaxed, memory_order_relaxed)) {
+				memcpy((unsigned char *)sequence + sizeof(size_t), element, queue->size);
+				atomic_store_explicit(sequence, position + 1, memory_order_release);
+				return true;
+			}
+		} else if (turn < 0) {
+			return false; // Still holds last lap's element.
+		} else {
+			position = atomic_load_explicit(&queue->enqueue, memory_order_relaxed);
+		}
+	}
+}
+
+/** Copy the oldest element out from any thread. False if the queue is empty. */
+static inline bool EGL_MpmcQueuePop(EGL_MpmcQueue *queue, void *element) {
+	size_t position = atomic_load_explicit(&queue->dequeue, memory_order_relaxed);
+	for (;;) {
+		_Atomic size_t *sequence = EGL_MpmcSequence(queue, position);
+		const intptr_t turn = (intptr_t)atomic_load_explicit(sequence, memory_order_acquire) - (intptr_t)(position + 1);
+		if (turn == 0) {
+			if (atomic_compare_exchange_weak_explicit(&queue->dequeue, &position, position + 1, memory_order_relaxed, memory_order_relaxed)) {
+				memcpy(element, (unsigned char *)sequence + sizeof(size_t), queue->size);
+				atomic_store_explicit(sequence, position + queue->mask + 1, memory_order_release);
+				return true;
+			}
+		} else if (turn < 0) {
+			return false; // Not pushed yet.
+		} else {
+			position = atomic_load_explicit(&queue->dequeue, memory_order_relaxed);
+		}
+	}
+}
+
+
+/** Zero a counter. */
+static inline void EGL_ShardedCounterInit(EGL_ShardedCounter *counter) {
+	for (int s = 0; s < EGL_COUNTER_SHARDS; s++) {
+		atomic_init(&counter->shards[s].value, 0);
+	}
+}
+
+/**
+ * Get the shard this thread adds to. Threads take shards round-robin the
+ * first time they ask.
+ */
+static inline int EGL_CounterShardIndex(void) {
+	static _Atomic int next = 0;
+	static _Thread_local int shard = -1;
+	if (shard < 0) {
+		shard = atomic_fetch_add_explicit(&next, 1, memory_order_relaxed) % EGL_COUNTER_SHARDS;
+	}
+	return shard;
+}
+
+/** Add to the counter from any thread. */
+static inline void EGL_ShardedCounterAdd(EGL_ShardedCounter *counter, int64_t delta) {
+	atomic_fetch_add_explicit(&counter->shards[EGL_CounterShardIndex()].value, delta, memory_order_relaxed);
+}
+
+/** Get the total. Adds racing with the read may or may not be counted. */
+static inline int64_t EGL_ShardedCounterSum(EGL_ShardedCounter *counter) {
+	int64_t sum = 0;
+	for (int s = 0; s < EGL_COUNTER_SHARDS; s++) {
+		sum += atomic_load_explicit(&counter->shards[s].value, memory_order_relaxed);
+	}
+	return sum;
+}
+
+
+#endif /* EGL_QUEUE_H */
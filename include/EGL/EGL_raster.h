@@ -0,0 +1,127 @@
+/**
+ * @file EGL_raster.h
+ * @brief A tiled, multithreaded software rasterizer for rendering without a GPU.
+ *
+ * It draws what triangle_vert.glsl and triangle_frag.glsl draw: indexed
+ * triangle lists of EGL_RasterVertex, transformed by one MVP matrix, with the
+ * vertex color times a texture sampled bilinearly with repeat. Like the
+ * game's pipelines it depth tests less than and writes depth, against a
+ * buffer EGL_RasterBegin clears, so it draws the same frame from the same
+ * draws in any order. It never culls, and it clips only in front of the eye,
+ * not at the far plane.
+ *
+ * A frame is recorded between EGL_RasterBegin and EGL_RasterEnd. Each draw
+ * clips its triangles in clip space, snaps them to 1/16 pixel and sets them
+ * up. EGL_RasterEnd bins them into EGL_RASTER_TILE square tiles, then threads
+ * take tiles one at a time and draw every triangle that touches one, in the
+ * order they were drawn. No two threads share a pixel, so the image is the
+ * same for any number of threads.
+ *
+ * Coverage is tested at pixel centers with edge functions, four pixels at
+ * once. Every edge is evaluated from its lower vertex to its upper one,
+ * whichever triangle it belongs to, and pixels exactly on an edge belong to
+ * the triangle on its top or left side. Triangles that share an edge
+ * therefore cover each pixel along it exactly once.
+ */
+
+#ifndef EGL_RASTER_H
+#define EGL_RASTER_H
+
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <EGL/EGL_texture.h>
+
+
+#define EGL_RASTER_TILE 64 // Tile side, in pixels. A multiple of 4.
+#define EGL_RASTER_SIZE_MAX 4096 // Largest target side, so snapped coordinates stay exact.
+
+
+/** A vertex as triangle_vert.glsl reads it. */
+typedef struct {
+	float position[3];
+	float color[4];
+	float uv[2];
+} EGL_RasterVertex;
+
+/** A triangle set up for drawing, in pixels with y down. */
+typedef struct {
+	/* Edge k is opposite vertex k: sign * ((x - x0) * dy - (y - y0) * dx), from its lower vertex */
+	float edge_x[3];
+	float edge_y[3];
+	float edge_dx[3];
+	float edge_dy[3];
+	float edge_sign[3];  /**< +1 or -1, so that the inside is positive. */
+	uint32_t top_left;   /**< Bit k is set if pixels exactly on edge k are inside. */
+	float inverse_area;  /**< Turns edge values into barycentric weights. */
+
+	float z[3];           /**< Depth at each vertex, after the perspective divide. */
+	float inverse_w[3];
+	float varyings[3][6]; /**< Color and uv at each vertex, over w. */
+
+	int32_t x0, y0, x1, y1; /**< Pixels it may cover, ends exclusive. */
+	const EGL_Image *texture; /**< NULL for white. */
+} EGL_RasterTriangle;
+
+typedef struct {
+	EGL_Image target; /**< RGBA8, rows top to bottom. */
+	float *depth;     /**< [width * height] */
+
+	EGL_RasterTriangle *triangles; /**< [triangles_max] Set up since EGL_RasterBegin. */
+	uint32_t triangle_count;
+	uint32_t triangles_max;
+	uint64_t dropped; /**< Triangles past triangles_max, never drawn. */
+
+	uint32_t tiles_x;
+	uint32_t tiles_y;
+	uint32_t *bin_starts; /**< [tiles + 1] Where each tile's triangles start in bins. */
+	uint32_t *bins;       /**< [bins_capacity] Triangle indices, by tile. */
+	uint32_t bins_capacity;
+
+	uint32_t clear_color; /**< RGBA8, red in the lowest byte. */
+	float clear_depth;
+} EGL_Raster;
+
+
+/**
+ * Allocate a rasterizer and its target.
+ *
+ * @param r The rasterizer. Free with EGL_RasterFree.
+ * @param width Up to EGL_RASTER_SIZE_MAX.
+ * @param height Up to EGL_RASTER_SIZE_MAX.
+ * @param triangles_max Triangles per frame, after clipping.
+ * @return False on allocation failure or an unsupported size.
+ */
+bool EGL_RasterInit(EGL_Raster *r, uint32_t width, uint32_t height, uint32_t triangles_max);
+
+void EGL_RasterFree(EGL_Raster *r);
+
+/**
+ * Start a frame. Each tile is cleared as it is drawn.
+ *
+ * @param clear_color RGBA8, red in the lowest byte.
+ * @param clear_depth Usually 1, the far plane.
+ */
+void EGL_RasterBegin(EGL_Raster *r, uint32_t clear_color, float clear_depth);
+
+/**
+ * Clip and set up an indexed triangle list.
+ *
+ * @param mvp Column-major, like cglm's mat4.
+ * @param texture RGBA8, or NULL for white. Must live until EGL_RasterEnd.
+ * @return False if some triangles were past triangles_max and dropped.
+ *     Triangles with an index past vertex_count are skipped.
+ */
+bool EGL_RasterDraw(EGL_Raster *r, const float *mvp, const EGL_RasterVertex *vertices, uint32_t vertex_count,
+	const uint16_t *indices, uint32_t index_count, const EGL_Image *texture);
+
+/**
+ * Bin the frame's triangles and draw every tile, on EGL_ThreadCount threads.
+ *
+ * @return False if the bins could not grow, leaving the target as it was.
+ */
+bool EGL_RasterEnd(EGL_Raster *r);
+
+
+#endif /* EGL_RASTER_H */
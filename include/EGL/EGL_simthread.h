@@ -0,0 +1,171 @@
+/**
+ * @file EGL_simthread.h
+ * @brief Fixed-step simulation on its own thread, handed to rendering through a lock-free triple buffer.
+ *
+ * The simulation thread steps its private state every step_ns and publishes
+ * a copy into a triple buffer. Publishing swaps the written slot with the
+ * shared one, and reading swaps the shared slot with the one being read,
+ * each with a single atomic exchange. Neither side ever waits for the other:
+ * a render stall only means some published states are never seen, and a slow
+ * step only means the renderer draws the same state twice.
+ *
+ * Nothing here depends on a window or a GPU, so the same loop runs headless.
+ */
+
+#ifndef EGL_SIMTHREAD_H
+#define EGL_SIMTHREAD_H
+
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <threads.h>
+
+
+#define EGL_SIM_LAG_MAX 8 // Steps the simulation may fall behind before it skips time instead of catching up.
+
+#define EGL_SIM_STATE_OFFSET 64 // Offset of the state in a published frame, so it is as aligned as the slot.
+
+#define EGL_TRIPLE_FRESH 4u // Set in the shared index when it holds a slot the reader has not taken.
+
+
+/**
+ * Three slots of one fixed size shared by one writer and one reader.
+ */
+typedef struct {
+	unsigned char *slots;    /**< [3 * stride] */
+	size_t size;             /**< Bytes usable in each slot. */
+	size_t stride;           /**< Bytes between slots, a whole number of cache lines. */
+	_Atomic unsigned shared; /**< Index of the shared slot, with EGL_TRIPLE_FRESH. */
+	unsigned back;           /**< Slot the writer owns. */
+	unsigned front;          /**< Slot the reader owns. */
+} EGL_TripleBuffer;
+
+/** Header of every state the simulation thread publishes. */
+typedef struct {
+	uint64_t tick;    /**< Steps simulated, counting this one. */
+	uint64_t time_ns; /**< EGL_SimNow time at which this step was due. */
+} EGL_SimFrame;
+
+/**
+ * Advance the simulation by one step.
+ *
+ * @param data User data given to EGL_SimThreadStart.
+ * @param state The simulation state, owned by the simulation thread.
+ * @param tick The number of this step, starting at 1.
+ */
+typedef void (*EGL_SimStepFunc)(void *data, void *state, uint64_t tick);
+
+typedef struct {
+	EGL_TripleBuffer buffer; /**< Published frames: an EGL_SimFrame, then a copy of the state at EGL_SIM_STATE_OFFSET. */
+	void *state;             /**< The state being stepped. */
+	size_t state_size;
+	uint64_t step_ns;
+	uint64_t start_ns;       /**< EGL_SimNow time of tick 0. */
+	EGL_SimStepFunc step;
+	void *data;
+	_Atomic bool running;
+	_Atomic uint64_t skipped; /**< Steps dropped because the simulation fell too far behind. */
+	thrd_t thread;
+} EGL_SimThread;
+
+
+/**
+ * Allocate a triple buffer with every slot zeroed.
+ *
+ * @param b The buffer. Free with EGL_TripleBufferFree.
+ * @param size Bytes in each slot.
+ * @return False on allocation failure.
+ */
+bool EGL_TripleBufferInit(EGL_TripleBuffer *b, size_t size);
+
+/** Free all memory held by the triple buffer and zero it. */
+void EGL_TripleBufferFree(EGL_TripleBuffer *b);
+
+/** Get the slot the writer may fill. Only the writer may call this. */
+static inline void *EGL_TripleBufferBack(EGL_TripleBuffer *b) {
+	return b->slots + b->back * b->stride;
+}
+
+/** Make the back slot the latest one and take the old shared slot to write next. */
+static inline void EGL_TripleBufferPublish(EGL_TripleBuffer *b) {
+	b->back = atomic_exchange_explicit(&b->shared, b->back | EGL_TRIPLE_FRESH, memory_order_acq_rel) & 3u;
+}
+
+/**
+ * Get the latest published slot. Only the reader may call this, and the slot
+ * stays valid until its next call.
+ *
+ * @param b The buffer.
+ * @param fresh Optional output, true if a slot was published since the last call.
+ * @return The latest slot (zeroed if nothing was ever published).
+ */
+static inline const void *EGL_TripleBufferLatest(EGL_TripleBuffer *b, bool *fresh) {
+	const bool published = atomic_load_explicit(&b->shared, memory_order_relaxed) & EGL_TRIPLE_FRESH;
+	if (published) {
+		b->front = atomic_exchange_explicit(&b->shared, b->front, memory_order_acq_rel) & 3u;
+	}
+	if (fresh) {
+		*fresh = published;
+	}
+	return b->slots + b->front * b->stride;
+}
+
+/** Get a monotonic time in nanoseconds. */
+uint64_t EGL_SimNow(void);
+
+/**
+ * Start stepping a copy of the state on a new thread, one step every step_ns.
+ *
+ * Before the first step the initial state is published as tick 0. If the
+ * thread falls more than EGL_SIM_LAG_MAX steps behind (a debugger break, a
+ * suspended laptop) it skips the time instead of running the backlog.
+ *
+ * @param sim The simulation. Stop with EGL_SimThreadStop.
+ * @param initial The state at tick 0, copied.
+ * @param size Size of the state in bytes.
+ * @param step_ns Simulated (and real) time per step.
+ * @param step The step function, run on the simulation thread.
+ * @param data User data passed to the step function.
+ * @return False if the buffers or the thread could not be created.
+ */
+bool EGL_SimThreadStart(EGL_SimThread *sim, const void *initial, size_t size, uint64_t step_ns, EGL_SimStepFunc step, void *data);
+
+/** Stop and join the simulation thread, then free everything and zero it. */
+void EGL_SimThreadStop(EGL_SimThread *sim);
+
+/**
+ * Get the latest published state without blocking. Only one thread may read.
+ *
+ * @param sim The simulation.
+ * @param frame Optional output step and due time of the state.
+ * @return The state, valid until the next call.
+ */
+static inline const void *EGL_SimThreadLatest(EGL_SimThread *sim, EGL_SimFrame *frame) {
+	const unsigned char *slot = (const unsigned char *)EGL_TripleBufferLatest(&sim->buffer, NULL);
+	if (frame) {
+		*frame = *(const EGL_SimFrame *)slot;
+	}
+	return slot + EGL_SIM_STATE_OFFSET;
+}
+
+/**
+ * Get how far rendering at now_ns is between the frame's previous and current
+ * step, drawing one step behind the simulation.
+ *
+ * @param sim The simulation.
+ * @param frame The frame being drawn.
+ * @param now_ns The EGL_SimNow time being drawn.
+ * @return The blend factor in [0, 1].
+ */
+static inline float EGL_SimThreadAlpha(const EGL_SimThread *sim, const EGL_SimFrame *frame, uint64_t now_ns) {
+	if (now_ns <= frame->time_ns) {
+		return 0.0f;
+	}
+	const uint64_t ahead = now_ns - frame->time_ns;
+	return (ahead >= sim->step_ns) ? 1.0f : (float)((double)ahead / (double)sim->step_ns);
+}
+
+
+#endif /* EGL_SIMTHREAD_H */
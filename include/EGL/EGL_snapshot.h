@@ -0,0 +1,93 @@
+/**
+ * @file EGL_snapshot.h
+ * @brief Double-buffered simulation state with batched interpolation for rendering.
+ *
+ * The simulation runs at a fixed step and writes entity state into the
+ * current snapshot, after saving the last one as the previous snapshot. The
+ * renderer runs at any rate and blends the two by how far it is into the next
+ * step (alpha), so motion stays smooth without the simulation step changing.
+ *
+ * State is SoA so all entities are interpolated four at a time. The result is
+ * written into an EGL_TransformBatch, ready for EGL_TransformBatchUpdate.
+ */
+
+#ifndef EGL_SNAPSHOT_H
+#define EGL_SNAPSHOT_H
+
+
+#include <EGL/EGL_transform.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+
+typedef enum {
+	EGL_INTERPOLATE_LERP,  /**< Blend rotations componentwise (cheapest, only for tiny steps). */
+	EGL_INTERPOLATE_NLERP, /**< Blend along the shorter arc and renormalize (speed varies a little). */
+	EGL_INTERPOLATE_SLERP, /**< Constant angular speed along the shorter arc. */
+} EGL_InterpolateMode;
+
+/** Entity state at one simulation step, in SoA layout. */
+typedef struct {
+	float *scale_x;       /**< [count] */
+	float *scale_y;       /**< [count] */
+	float *scale_z;       /**< [count] */
+	float *rotation_x;    /**< [count] Unit quaternion x. */
+	float *rotation_y;    /**< [count] Unit quaternion y. */
+	float *rotation_z;    /**< [count] Unit quaternion z. */
+	float *rotation_w;    /**< [count] Unit quaternion w (real part). */
+	float *translation_x; /**< [count] */
+	float *translation_y; /**< [count] */
+	float *translation_z; /**< [count] */
+} EGL_SnapshotState;
+
+typedef struct {
+	uint32_t count;
+	EGL_SnapshotState previous; /**< The state at the last step. */
+	EGL_SnapshotState current;  /**< The state the simulation is writing. */
+} EGL_Snapshot;
+
+
+/**
+ * Allocate a snapshot of identity transforms.
+ *
+ * @param snapshot The snapshot. Free with EGL_SnapshotFree.
+ * @param count Number of entities.
+ * @return False on allocation failure.
+ */
+bool EGL_SnapshotInit(EGL_Snapshot *snapshot, uint32_t count);
+
+/** Free all memory held by the snapshot and zero it. */
+void EGL_SnapshotFree(EGL_Snapshot *snapshot);
+
+/** Save the current state as the previous state. Call at the start of every simulation step. */
+void EGL_SnapshotSave(EGL_Snapshot *snapshot);
+
+/**
+ * Get how far rendering is between the previous and current step.
+ *
+ * @param accumulator_ns Time simulated ahead of rendering, in [0, step_ns).
+ * @param step_ns The simulation step.
+ * @return The blend factor in [0, 1].
+ */
+static inline float EGL_SnapshotAlpha(uint64_t accumulator_ns, uint64_t step_ns) {
+	if (accumulator_ns >= step_ns) {
+		return 1.0f;
+	}
+	return (float)((double)accumulator_ns / (double)step_ns);
+}
+
+/**
+ * Blend the previous and current state of every entity into a transform batch
+ * and mark them dirty. Translation and scale are always lerped.
+ *
+ * @param snapshot The snapshot.
+ * @param alpha Blend factor (0 is the previous state, 1 the current state).
+ * @param mode How rotations are blended.
+ * @param out The batch to write (its count must match the snapshot).
+ * @param threads Number of threads to split the entities across.
+ */
+void EGL_SnapshotInterpolate(const EGL_Snapshot *snapshot, float alpha, EGL_InterpolateMode mode, EGL_TransformBatch *out, int threads);
+
+
+#endif /* EGL_SNAPSHOT_H */
@@ -0,0 +1,37 @@
+/**
+ * @file EGL_sort.h
+ * @brief Parallel sorting routines.
+ */
+
+#ifndef EGL_SORT_H
+#define EGL_SORT_H
+
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+/**
+ * Stable parallel LSD radix sort of 64 bit keys with optional 32 bit values.
+ *
+ * Byte digits which are identical across every key are skipped, so keys
+ * which only use their low bits sort in fewer passes. The sorted result is
+ * always written back into `keys` and `values`.
+ *
+ * @param keys The keys to sort (n elements).
+ * @param values The values to permute alongside the keys, or NULL.
+ * @param keys_tmp Scratch space for n keys.
+ * @param values_tmp Scratch space for n values (ignored if values is NULL).
+ * @param n The number of elements.
+ * @param scratch EGL_RadixSortScratchSize() bytes for the histograms, or NULL
+ * to allocate them for this call. Callers that sort every frame keep one.
+ * @return False if scratch was NULL and the histograms could not be allocated.
+ */
+bool EGL_RadixSort(uint64_t *keys, uint32_t *values, uint64_t *keys_tmp, uint32_t *values_tmp, size_t n, void *scratch);
+
+/** The size in bytes of the scratch EGL_RadixSort takes, for any thread count. */
+size_t EGL_RadixSortScratchSize(void);
+
+
+#endif /* EGL_SORT_H */
@@ -0,0 +1,142 @@
+/**
+ * @file EGL_spatial.h
+ * @brief Cube-sphere spatial index for radius and nearest neighbor queries on a sphere.
+ *
+ * Each face of a cube is split into an N x N grid and projected onto the
+ * sphere (gnomonic projection), giving 6 N^2 cells. Entities are bucketed into
+ * cells with a counting sort and stored in SoA order by cell, so a query only
+ * scans the cells that can intersect it. Queries walk neighboring cells
+ * outward from the query point, crossing cube face boundaries seamlessly.
+ *
+ * Distances are angles in radians between directions from the sphere center,
+ * so positions may lie on a sphere of any radius.
+ */
+
+#ifndef EGL_SPATIAL_H
+#define EGL_SPATIAL_H
+
+
+#include <stdbool.h>
+#include <stdint.h>
+
+
+#define EGL_SPATIAL_NONE UINT32_MAX
+#define EGL_SPATIAL_RESOLUTION_MAX 1024
+
+
+/**
+ * A spatial index of entities on a sphere.
+ *
+ * Sorted arrays are indexed by slot: entities of cell c occupy slots
+ * [cell_start[c], cell_start[c + 1]).
+ */
+typedef struct {
+	uint32_t resolution; /**< Cells per cube face edge (N). */
+	uint32_t cell_count; /**< 6 N^2. */
+	uint32_t count;      /**< Number of indexed entities. */
+	uint32_t capacity;   /**< Allocated entity slots. */
+
+	/* Cells */
+	uint32_t *cell_start;     /**< [cell_count + 1] First slot of each cell. */
+	float    *cell_center;    /**< [cell_count * 3] Unit direction of each cell center. */
+	float    *cell_radius;    /**< [cell_count] Angle from the center to the farthest corner. */
+	uint32_t *cell_neighbors; /**< [cell_count * 8] Adjacent cells (EGL_SPATIAL_NONE pads). */
+
+	/* Entities in cell order */
+	float    *x;   /**< [capacity] Unit direction x. */
+	float    *y;   /**< [capacity] Unit direction y. */
+	float    *z;   /**< [capacity] Unit direction z. */
+	uint32_t *ids; /**< [capacity] Index of the entity in the arrays given to Build. */
+
+	uint32_t *entity_cell; /**< [capacity] Scratch: cell of each input entity. */
+} EGL_SpatialIndex;
+
+/**
+ * Per-caller query state, so threads can query one index concurrently.
+ */
+typedef struct {
+	uint32_t  cell_count;
+	uint32_t  generation;
+	uint32_t *stamp; /**< [cell_count] Generation a cell was last visited in. */
+	uint32_t *queue; /**< [cell_count] Cells to visit. */
+	void     *heap;  /**< [cell_count] Cells to visit, nearest first. */
+} EGL_SpatialScratch;
+
+
+/**
+ * Initialize an empty index and precompute its cell geometry.
+ *
+ * Pick the resolution so a cell is about the size of a typical query radius
+ * (a cell spans roughly pi / (2N) radians) or holds a handful of entities.
+ *
+ * @param index The index. Free with EGL_SpatialIndexFree.
+ * @param resolution Cells per cube face edge in [1, EGL_SPATIAL_RESOLUTION_MAX].
+ * @return False on allocation failure or bad resolution.
+ */
+bool EGL_SpatialIndexInit(EGL_SpatialIndex *index, uint32_t resolution);
+
+/** Free all memory held by the index and zero it. */
+void EGL_SpatialIndexFree(EGL_SpatialIndex *index);
+
+/**
+ * Get the cell containing a direction.
+ *
+ * @param index The index.
+ * @param p A non-zero vector.
+ * @return The cell id in [0, cell_count).
+ */
+uint32_t EGL_SpatialIndexCell(const EGL_SpatialIndex *index, const float p[3]);
+
+/**
+ * Rebuild the index from entity positions (e.g. once per tick).
+ *
+ * @param index The index.
+ * @param x [count] Position x of every entity.
+ * @param y [count] Position y of every entity.
+ * @param z [count] Position z of every entity (positions must be non-zero).
+ * @param count Number of entities.
+ * @param threads Number of threads to bucket with (usually EGL_ThreadCount()).
+ * @return False on allocation failure.
+ */
+bool EGL_SpatialIndexBuild(EGL_SpatialIndex *index, const float *x, const float *y, const float *z, uint32_t count, int threads);
+
+/**
+ * Initialize query state for an index.
+ *
+ * @param scratch The scratch. Free with EGL_SpatialScratchFree.
+ * @param index The index to query (only its resolution matters).
+ * @return False on allocation failure.
+ */
+bool EGL_SpatialScratchInit(EGL_SpatialScratch *scratch, const EGL_SpatialIndex *index);
+
+/** Free all memory held by the scratch and zero it. */
+void EGL_SpatialScratchFree(EGL_SpatialScratch *scratch);
+
+/**
+ * Find all entities within an angle of a point, in no particular order.
+ *
+ * @param index The index.
+ * @param scratch Query state owned by the calling thread.
+ * @param p The query direction (non-zero).
+ * @param radius The angular radius in radians.
+ * @param out Output entity ids.
+ * @param out_max Capacity of out.
+ * @return The number of entities in range (may exceed out_max).
+ */
+uint32_t EGL_SpatialIndexRadius(const EGL_SpatialIndex *index, EGL_SpatialScratch *scratch, const float p[3], float radius, uint32_t *out, uint32_t out_max);
+
+/**
+ * Find the k entities nearest to a point, nearest first (lowest id on ties).
+ *
+ * @param index The index.
+ * @param scratch Query state owned by the calling thread.
+ * @param p The query direction (non-zero).
+ * @param k The number of neighbors to find.
+ * @param out [k] Output entity ids.
+ * @param angles [k] Output angles to the entities in radians.
+ * @return The number of neighbors found (k unless fewer entities exist).
+ */
+uint32_t EGL_SpatialIndexNearest(const EGL_SpatialIndex *index, EGL_SpatialScratch *scratch, const float p[3], uint32_t k, uint32_t *out, float *angles);
+
+
+#endif /* EGL_SPATIAL_H */
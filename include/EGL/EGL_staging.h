@@ -0,0 +1,115 @@
+/**
+ * @file EGL_staging.h
+ * @brief A staging ring for GPU uploads, reused frame after frame.
+ *
+ * One transfer buffer is created up front and handed out front to back,
+ * wrapping at its end. Every upload staged in a frame is recorded as an
+ * EGL_StagingCopy, so the caller can issue them all in one copy pass. When
+ * the frame is submitted, EGL_StagingEndFrame marks where its bytes end;
+ * once the GPU signals that frame's fence, EGL_StagingRetire hands them back.
+ * Until then they are never written over: when the ring is full, staging
+ * fails and the caller must wait for the oldest frame and retire it.
+ *
+ * Nothing here calls the GPU API, which is the caller's part: it owns the
+ * transfer buffer, maps it into memory, issues the copies and keeps one fence
+ * per frame in flight.
+ */
+
+#ifndef EGL_STAGING_H
+#define EGL_STAGING_H
+
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+#define EGL_STAGING_ALIGN 16 // Offset alignment of every upload: a BC7 block, and any texel.
+#define EGL_STAGING_FRAMES 4 // Frames that can be in flight at once.
+
+
+/** One upload staged in the ring, to be copied to its target. */
+typedef struct {
+	void *target;     /**< A buffer or texture, opaque here. */
+	uint32_t offset;  /**< Where the data sits in the ring. */
+	uint32_t size;
+	bool texture;
+	uint32_t target_offset; /**< Buffers: bytes into the target. */
+	uint32_t level;         /**< Textures: the mip level and its size. */
+	uint32_t width;
+	uint32_t height;
+} EGL_StagingCopy;
+
+typedef struct {
+	uint8_t *memory;   /**< The ring, mapped by the caller; NULL while unmapped. */
+	uint32_t capacity;
+
+	/* Byte counts since Init, never wrapped: staged up to head, in flight from tail */
+	uint64_t head;
+	uint64_t tail;
+	uint64_t frame_ends[EGL_STAGING_FRAMES]; /**< Head at the end of each frame in flight. */
+	uint64_t frames;  /**< Frames ended. */
+	uint64_t retired; /**< Frames retired; frames from here to frames are in flight. */
+
+	EGL_StagingCopy *copies; /**< Staged this frame, in order. */
+	uint32_t copy_count;
+	uint32_t copies_max;
+
+	uint64_t bytes; /**< Bytes staged since Init. */
+	uint64_t fails; /**< Uploads refused for lack of space. */
+} EGL_StagingRing;
+
+
+/**
+ * Set up a ring.
+ *
+ * @param r The ring. Free with EGL_StagingFree.
+ * @param capacity Bytes in the transfer buffer.
+ * @param copies_max Uploads that can be staged in one frame.
+ * @return False on allocation failure.
+ */
+bool EGL_StagingInit(EGL_StagingRing *r, uint32_t capacity, uint32_t copies_max);
+
+void EGL_StagingFree(EGL_StagingRing *r);
+
+/**
+ * Take space in the ring, without recording a copy.
+ *
+ * @param size Bytes, at most the capacity.
+ * @param offset Set to the space's offset in the ring.
+ * @return The space, or NULL if the ring is unmapped or full until a frame retires.
+ */
+void *EGL_StagingAlloc(EGL_StagingRing *r, uint32_t size, uint32_t *offset);
+
+/**
+ * Stage bytes for a buffer.
+ *
+ * @return False if the ring or this frame's copies are full, or the ring is unmapped.
+ */
+bool EGL_StagingBuffer(EGL_StagingRing *r, void *buffer, uint32_t buffer_offset, const void *data, uint32_t size);
+
+/**
+ * Stage one level of a texture, tightly packed.
+ *
+ * @return False if the ring or this frame's copies are full, or the ring is unmapped.
+ */
+bool EGL_StagingTexture(EGL_StagingRing *r, void *texture, uint32_t level, uint32_t width, uint32_t height, const void *data, uint32_t size);
+
+/**
+ * End a frame once its copies are recorded: they are forgotten, and their
+ * bytes stay in flight until EGL_StagingRetire.
+ *
+ * @return False if EGL_STAGING_FRAMES frames are already in flight; retire one first.
+ */
+bool EGL_StagingEndFrame(EGL_StagingRing *r);
+
+/** Hand back the oldest frame in flight's bytes, once the GPU is done with them. */
+void EGL_StagingRetire(EGL_StagingRing *r);
+
+/** Get the frames in flight. */
+static inline uint32_t EGL_StagingInFlight(const EGL_StagingRing *r) {
+	return (uint32_t)(r->frames - r->retired);
+}
+
+
+#endif /* EGL_STAGING_H */
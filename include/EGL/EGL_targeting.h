@@ -0,0 +1,70 @@
+/**
+ * @file EGL_targeting.h
+ * @brief Batched target selection for towers on a sphere.
+ *
+ * Every tick each tower picks one alien within its angular range according
+ * to its policy. Positions are unit directions from the planet center, so the
+ * range test is a dot product against the cosine of the range.
+ */
+
+#ifndef EGL_TARGETING_H
+#define EGL_TARGETING_H
+
+
+#include <stdint.h>
+
+
+#define EGL_TARGET_NONE UINT32_MAX // No alien in range.
+
+
+typedef enum {
+	EGL_TARGET_NEAREST,   /**< Smallest angle to the tower. */
+	EGL_TARGET_FIRST,     /**< Furthest along its path (largest progress). */
+	EGL_TARGET_STRONGEST, /**< Most health. */
+} EGL_TargetPolicy;
+
+/** Towers in SoA layout. */
+typedef struct {
+	const float   *x;      /**< [count] Unit direction x. */
+	const float   *y;      /**< [count] Unit direction y. */
+	const float   *z;      /**< [count] Unit direction z. */
+	const float   *range;  /**< [count] Angular range in radians. */
+	const uint8_t *policy; /**< [count] EGL_TargetPolicy. */
+	uint32_t count;
+} EGL_TargetTowers;
+
+/** Aliens in SoA layout. Aliens with health <= 0 are never targeted. */
+typedef struct {
+	const float *x;        /**< [count] Unit direction x. */
+	const float *y;        /**< [count] Unit direction y. */
+	const float *z;        /**< [count] Unit direction z. */
+	const float *health;   /**< [count] Remaining health. */
+	const float *progress; /**< [count] Distance travelled along the path. */
+	uint32_t count;
+} EGL_TargetAliens;
+
+
+/**
+ * Pick a target for every tower with SIMD range tests across multiple threads.
+ *
+ * Ties go to the alien with the lowest index, so the result is identical to
+ * EGL_TargetSelectReference for any thread count.
+ *
+ * @param towers The towers.
+ * @param aliens The aliens.
+ * @param targets [towers->count] Output alien index per tower, or EGL_TARGET_NONE.
+ * @param threads Number of threads to split the towers across.
+ */
+void EGL_TargetSelect(const EGL_TargetTowers *towers, const EGL_TargetAliens *aliens, uint32_t *targets, int threads);
+
+/**
+ * Pick a target for every tower with a plain scalar loop.
+ *
+ * @param towers The towers.
+ * @param aliens The aliens.
+ * @param targets [towers->count] Output alien index per tower, or EGL_TARGET_NONE.
+ */
+void EGL_TargetSelectReference(const EGL_TargetTowers *towers, const EGL_TargetAliens *aliens, uint32_t *targets);
+
+
+#endif /* EGL_TARGETING_H */
@@ -6,6 +6,7 @@
 #define EGL_TESTING_H
 
 
+#include <stdarg.h>
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -128,26 +129,45 @@ typedef struct {
 
 static bool TESTS_FAILING = false;
 
+/* Append to the log, doubling it until the text and its terminator fit */
+static inline void EGL_LogPrintf(EGL_TestLog *L, const char *format, ...) {
+	va_list args;
+	va_start(args, format);
+	const int length = vsnprintf(NULL, 0, format, args);
+	va_end(args);
+	if (length < 0) {
+		fprintf(stderr, "\033[31mFATAL\033[35m%d\033[0m    Encoding error with snprintf.\n", __LINE__);
+		exit(EXIT_FAILURE);
+	}
+
+	size_t capacity = L->capacity;
+	while (capacity - L->size <= (size_t)length) {
+		capacity <<= 1;
+	}
+	if (capacity != L->capacity) {
+		char *buffer = (char *)realloc(L->buffer, capacity);
+		if (!buffer) {
+			fprintf(stderr, "\033[31mFATAL\033[35m%d\033[0m    Logger out of memory.\n", __LINE__);
+			exit(EXIT_FAILURE);
+		}
+		L->buffer = buffer;
+		L->capacity = capacity;
+	}
+
+	va_start(args, format);
+	vsnprintf(L->buffer + L->size, L->capacity - L->size, format, args);
+	va_end(args);
+	L->size += (size_t)length;
+}
+
 static inline void EGL_LogModule(EGL_TestModule *M, EGL_TestLog *L) {
 	if (!L->buffer) {
 		fprintf(stderr, "\033[31mFATAL\033[35m%d\033[0m    NULL log buffer.\n", __LINE__);
 		exit(EXIT_FAILURE);
-	} else if (L->size >= L->capacity) {
-		fprintf(stderr, "\033[31mFATAL\033[35m%d\033[0m    Logger out of memory.\n", __LINE__);
-		exit(EXIT_FAILURE);
-	}
-	
-	/* Double memory if remaining memory is less than half the original max */
-	if (L->capacity - L->size < (L->capacity >> 1)) {
-		L->capacity <<= 1;
-		L->buffer = (char *)realloc(L->buffer, L->capacity);
 	}
 
 	int total_errors = 0;
 	double total_time = 0;
-	int bytes_written = 0;
-
-	char *head = L->buffer + L->size;
 	for (int i = 0; i < M->test_count; i++) {
 		if (M->tests[i].error_count > 0) {
 			M->fail_count++;
@@ -156,78 +176,24 @@ static inline void EGL_LogModule(EGL_TestModule *M, EGL_TestLog *L) {
 		total_time += M->tests[i].time;
 	}
 
-	/* It is 'safe' not to check bounds here since bytes >= 2048. */
 	if (total_errors == 0) {
-		memcpy(head, ANSI_GREEN(HLINE), sizeof(ANSI_GREEN(HLINE)));
-		head += sizeof(ANSI_GREEN(HLINE)) - 1;
-		bytes_written = snprintf(head, L->capacity - L->size, " PASS | %s (%.3fs)\n", M->module, total_time);
-		if (bytes_written < 0) {
-			fprintf(stderr, "\033[31mFATAL\033[35m%d\033[0m    Encoding error with snprintf.\n", __LINE__);
-			exit(EXIT_FAILURE);
-		}
-		head += bytes_written;
-		memcpy(head, HLINE, sizeof(HLINE));
-		head += sizeof(HLINE) - 1;
-		L->size += sizeof(ANSI_GREEN(HLINE)) + sizeof(HLINE) + bytes_written - 2;
+		EGL_LogPrintf(L, "%s PASS | %s (%.3fs)\n%s", ANSI_GREEN(HLINE), M->module, total_time, HLINE);
 	} else {
 		TESTS_FAILING = true;
-		memcpy(head, ANSI_RED(HLINE), sizeof(ANSI_RED(HLINE)));
-		head += sizeof(ANSI_RED(HLINE)) - 1;
-		bytes_written = snprintf(head, L->capacity - L->size, " FAIL | %s (%.3fs)\n", M->module, total_time);
-		if (bytes_written < 0) {
-			fprintf(stderr, "\033[31mFATAL\033[35m%d\033[0m    Encoding error with snprintf.\n", __LINE__);
-			exit(EXIT_FAILURE);
-		}
-		head += bytes_written;
-		memcpy(head, HLINE, sizeof(HLINE));
-		head += sizeof(HLINE) - 1;
-		L->size += sizeof(ANSI_RED(HLINE)) + sizeof(HLINE) + bytes_written - 2;
+		EGL_LogPrintf(L, "%s FAIL | %s (%.3fs)\n%s", ANSI_RED(HLINE), M->module, total_time, HLINE);
 	}
 
 #ifdef VERBOSE_TEST
 	for (int i = 0; i < M->test_count; i++) {
-		if (L->capacity - L->size < (L->capacity >> 1)) {
-			L->capacity <<= 1;
-			L->buffer = (char *)realloc(L->buffer, L->capacity);
-		}
 		EGL_Test *t = &M->tests[i];
 		if (t->error_count == 0) {
-			bytes_written = snprintf(head, L->capacity - L->size, ANSI_GREEN(" PASS | %s (%.3fs)\n"), t->testname, t->time);
-			if (bytes_written < 0) {
-				fprintf(stderr, "\033[31mFATAL\033[35m%d\033[0m    Encoding error with snprintf.\n", __LINE__);
-				exit(EXIT_FAILURE);
-			}
-			head += bytes_written;
-			L->size += bytes_written;
+			EGL_LogPrintf(L, ANSI_GREEN(" PASS | %s (%.3fs)\n"), t->testname, t->time);
 		} else {
-			bytes_written = snprintf(head, L->capacity - L->size, ANSI_RED(" FAIL | %s (%.3fs)\n"), t->testname, t->time);
-			if (bytes_written < 0) {
-				fprintf(stderr, "\033[31mFATAL\033[35m%d\033[0m    Encoding error with snprintf.\n", __LINE__);
-				exit(EXIT_FAILURE);
-			}
-			head += bytes_written;
-			L->size += bytes_written;
+			EGL_LogPrintf(L, ANSI_RED(" FAIL | %s (%.3fs)\n"), t->testname, t->time);
 			for (int j = 0; j < t->error_count; j++) {
 				EGL_TestError *e = &t->errors[j];
-				if (L->capacity - L->size < (L->capacity >> 1)) {
-					L->capacity <<= 1;
-					L->buffer = (char *)realloc(L->buffer, L->capacity);
-				}
-				bytes_written = snprintf(head, L->capacity - L->size, "      |     Trace:    \033[36m%s\033[35m:%d\033[31m\n", M->filename, e->line);
-				if (bytes_written < 0) {
-					fprintf(stderr, "\033[31mFATAL\033[35m%d\033[0m    Encoding error with snprintf.\n", __LINE__);
-					exit(EXIT_FAILURE);
-				}
-				head += bytes_written;
-				L->size += bytes_written;
-
-				bytes_written = snprintf(head, L->capacity - L->size, "      |     Error:    %s\n", e->error);
-				if (bytes_written < 0) {
-					fprintf(stderr, "\033[31mFATAL\033[35m%d\033[0m    Encoding error with snprintf.\n", __LINE__);
-					exit(EXIT_FAILURE);
-				}
-				head += bytes_written;
-				L->size += bytes_written;
+				EGL_LogPrintf(L, "      |     Trace:    \033[36m%s\033[35m:%d\033[31m\n", M->filename, e->line);
+				EGL_LogPrintf(L, "      |     Error:    %s\n", e->error);
 			}
 		}
 	}
@@ -240,10 +206,56 @@ static inline void EGL_LogModule(EGL_TestModule *M, EGL_TestLog *L) {
 
 /*$ HEADERS */
 #include <EGL/EGL_random.h>
+#include <EGL/EGL_mesh.h>
+#include <EGL/EGL_flowfield.h>
+#include <EGL/EGL_spatial.h>
+#include <EGL/EGL_targeting.h>
+#include <EGL/EGL_bvh.h>
+#include <EGL/EGL_transform.h>
+#include <EGL/EGL_snapshot.h>
+#include <EGL/EGL_hierarchy.h>
+#include <EGL/EGL_math.h>
+#include <EGL/EGL_approx.h>
+#include <EGL/EGL_simthread.h>
+#include <EGL/EGL_jobs.h>
+#include <EGL/EGL_queue.h>
+#include <EGL/EGL_profile.h>
+#include <EGL/EGL_framestats.h>
+#include <EGL/EGL_alloc.h>
+#include <EGL/EGL_arena.h>
+#include <EGL/EGL_assets.h>
+#include <EGL/EGL_pack.h>
+#include <EGL/EGL_texture.h>
+#include <EGL/EGL_staging.h>
+#include <EGL/EGL_instance.h>
+#include <EGL/EGL_raster.h>
 /*$ END HEADERS */
 
 /*$ TESTS */
 void EGL_Xoshiro128PlusTest(EGL_TestModule *M);
+void EGL_MeshTest(EGL_TestModule *M);
+void EGL_FlowFieldTest(EGL_TestModule *M);
+void EGL_SpatialTest(EGL_TestModule *M);
+void EGL_TargetTest(EGL_TestModule *M);
+void EGL_BvhTest(EGL_TestModule *M);
+void EGL_TransformTest(EGL_TestModule *M);
+void EGL_SnapshotTest(EGL_TestModule *M);
+void EGL_HierarchyTest(EGL_TestModule *M);
+void EGL_MathTest(EGL_TestModule *M);
+void EGL_ApproxTest(EGL_TestModule *M);
+void EGL_SimThreadTest(EGL_TestModule *M);
+void EGL_JobsTest(EGL_TestModule *M);
+void EGL_QueueTest(EGL_TestModule *M);
+void EGL_ProfileTest(EGL_TestModule *M);
+void EGL_FrameStatsTest(EGL_TestModule *M);
+void EGL_AllocTest(EGL_TestModule *M);
+void EGL_ArenaTest(EGL_TestModule *M);
+void EGL_AssetsTest(EGL_TestModule *M);
+void EGL_PackTest(EGL_TestModule *M);
+void EGL_TextureTest(EGL_TestModule *M);
+void EGL_StagingTest(EGL_TestModule *M);
+void EGL_InstanceTest(EGL_TestModule *M);
+void EGL_RasterTest(EGL_TestModule *M);
 /*$ END TESTS */
 
 
@@ -0,0 +1,175 @@
+/**
+ * @file EGL_texture.h
+ * @brief Texture cooking: pixel format conversion, gamma-correct mip chains and BC1/BC7 compression.
+ *
+ * Everything here runs on the CPU, offline in the texcook tool or in tests.
+ * Images are RGBA8 in sRGB, rows top to bottom. Mip levels are averaged in
+ * linear light, so a black and white checkerboard shrinks to the grey it
+ * looks like from afar rather than to a darker one. Compressed levels are
+ * meant for the *_UNORM_SRGB block formats:
+ *
+ *     EGL_TEXTURE_BC1  8 bytes per 4x4 block: two RGB565 endpoints and 2-bit
+ *                      indices, with 1-bit alpha.
+ *     EGL_TEXTURE_BC7  16 bytes per 4x4 block, always mode 6: two RGBA7777
+ *                      endpoints with a shared low bit each and 4-bit indices.
+ *
+ * A cooked texture is an EGL_TextureHeader followed by every level, largest
+ * first, each tightly packed. EGL_TextureParse reads one in place, so it can
+ * come straight from an EGL_Pack.
+ */
+
+#ifndef EGL_TEXTURE_H
+#define EGL_TEXTURE_H
+
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <EGL/EGL_memory.h>
+
+
+#define EGL_TEXTURE_MAGIC "EGLTEX"
+#define EGL_TEXTURE_VERSION 1
+#define EGL_TEXTURE_LEVELS_MAX 16 // Enough for 32768 x 32768.
+
+
+/** Layouts pixels can be converted from. Multi-byte pixels are little-endian. */
+typedef enum {
+	EGL_PIXEL_RGBA8,
+	EGL_PIXEL_BGRA8,
+	EGL_PIXEL_BGRX8,    /**< BGRA8 with the alpha byte ignored (opaque). */
+	EGL_PIXEL_BGR8,
+	EGL_PIXEL_RGB565,   /**< Red in the top five bits. */
+	EGL_PIXEL_XRGB1555, /**< Red in bits 10-14, the top bit ignored. */
+} EGL_PixelFormat;
+
+typedef enum {
+	EGL_TEXTURE_RGBA8,
+	EGL_TEXTURE_BC1,
+	EGL_TEXTURE_BC7,
+} EGL_TextureFormat;
+
+/** How hard the block encoders search for endpoints. */
+typedef enum {
+	EGL_TEXTURE_FAST,   /**< The block's bounding box. */
+	EGL_TEXTURE_NORMAL, /**< The block's principal axis. */
+	EGL_TEXTURE_BEST,   /**< The principal axis, refined by least squares. */
+} EGL_TextureQuality;
+
+typedef struct {
+	uint8_t *pixels; /**< RGBA8, sRGB, rows top to bottom, tightly packed. */
+	uint32_t width;
+	uint32_t height;
+} EGL_Image;
+
+typedef struct {
+	EGL_Image levels[EGL_TEXTURE_LEVELS_MAX]; /**< Level 0 is full size; each next one is half, down to 1 x 1. */
+	uint32_t count;
+} EGL_MipChain;
+
+typedef struct {
+	char magic[8]; /**< EGL_TEXTURE_MAGIC, NUL-terminated. */
+	uint32_t version;
+	uint32_t format; /**< An EGL_TextureFormat. */
+	uint32_t width;
+	uint32_t height;
+	uint32_t levels;
+	uint32_t reserved;
+} EGL_TextureHeader;
+
+/** A cooked texture, viewed in place. */
+typedef struct {
+	EGL_TextureFormat format;
+	uint32_t width;
+	uint32_t height;
+	uint32_t levels;
+	const uint8_t *data[EGL_TEXTURE_LEVELS_MAX];
+	size_t sizes[EGL_TEXTURE_LEVELS_MAX];
+	size_t size; /**< Bytes of every level together. */
+} EGL_Texture;
+
+
+/** Allocate an image's pixels. Free with EGL_ImageFree. */
+bool EGL_ImageInit(EGL_Image *image, uint32_t width, uint32_t height);
+
+void EGL_ImageFree(EGL_Image *image);
+
+/**
+ * Convert pixels to RGBA8.
+ *
+ * @param src The first row to convert.
+ * @param pitch Bytes from one row to the next; negative for rows stored bottom to top.
+ * @param rgba Width * height * 4 bytes, rows top to bottom.
+ */
+void EGL_PixelsConvert(const void *src, ptrdiff_t pitch, EGL_PixelFormat format, uint32_t width, uint32_t height, uint8_t *rgba);
+
+/**
+ * Read an uncompressed 16, 24 or 32-bit BMP.
+ *
+ * @param image Allocated here. Free with EGL_ImageFree.
+ * @return False if the file is malformed or its layout unsupported.
+ */
+bool EGL_ImageReadBMP(EGL_Image *image, const void *data, size_t size);
+
+/**
+ * Write an image as a 32-bit BMP, alpha included.
+ *
+ * @param out Set to the file's bytes, from EGL_malloc. Free with EGL_free.
+ * @return Its size, or 0 on failure.
+ */
+size_t EGL_ImageWriteBMP(const EGL_Image *image, uint8_t **out);
+
+/**
+ * Get the peak signal-to-noise ratio between two RGBA8 images, in dB.
+ *
+ * @param alpha Whether alpha counts, or only RGB.
+ * @return The PSNR, or INFINITY if the images are identical.
+ */
+double EGL_ImagePSNR(const uint8_t *a, const uint8_t *b, size_t pixels, bool alpha);
+
+/**
+ * Build a full mip chain, averaging in linear light.
+ *
+ * @param m Levels are allocated here. Free with EGL_MipChainFree.
+ * @param base Copied as level 0.
+ */
+bool EGL_MipChainBuild(EGL_MipChain *m, const EGL_Image *base);
+
+void EGL_MipChainFree(EGL_MipChain *m);
+
+/** Get the bytes of one level in a format. */
+size_t EGL_TextureLevelSize(EGL_TextureFormat format, uint32_t width, uint32_t height);
+
+/**
+ * Encode an image in a format.
+ *
+ * @param out EGL_TextureLevelSize bytes.
+ */
+void EGL_TextureEncode(const EGL_Image *image, EGL_TextureFormat format, EGL_TextureQuality quality, uint8_t *out);
+
+/**
+ * Decode one level back to RGBA8, as a GPU would sample it.
+ *
+ * @param rgba Width * height * 4 bytes.
+ */
+void EGL_TextureDecode(const uint8_t *data, EGL_TextureFormat format, uint32_t width, uint32_t height, uint8_t *rgba);
+
+/**
+ * Cook an image: build its mips if asked and encode every level.
+ *
+ * @param out Set to the cooked texture, from EGL_malloc. Free with EGL_free.
+ * @return Its size, or 0 on failure.
+ */
+size_t EGL_TextureCook(const EGL_Image *base, EGL_TextureFormat format, EGL_TextureQuality quality, bool mips, uint8_t **out);
+
+/**
+ * View a cooked texture in place.
+ *
+ * @param t Points into data, so data must outlive it.
+ * @return False if data is not a complete cooked texture.
+ */
+bool EGL_TextureParse(EGL_Texture *t, const void *data, size_t size);
+
+
+#endif /* EGL_TEXTURE_H */
@@ -0,0 +1,192 @@
+/**
+ * @file EGL_transform.h
+ * @brief Batches of transforms in SoA layout with SIMD model matrix composition.
+ *
+ * A batch holds the same properties as a Transform (see EGL_3d.h), one array
+ * per component, plus the composed model matrices. Changed transforms are
+ * flagged with a dirty bit and EGL_TransformBatchUpdate rebuilds only those,
+ * four at a time, producing the same matrices as EGL_TransformUpdate:
+ * model = S * R with the translation in column 3.
+ *
+ * Rotations are integrated on the quaternion directly. Quaternions are stored
+ * (x, y, z, w) like cglm's versor, and rotations are applied in the local
+ * frame (q = q * dq) like glm_rotate applied to the model matrix.
+ */
+
+#ifndef EGL_TRANSFORM_H
+#define EGL_TRANSFORM_H
+
+
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+#define EGL_QUAT_RENORMALIZE_STEPS 64 // Integration steps between renormalizations.
+
+
+typedef struct {
+	uint32_t count;
+
+	float *scale_x;       /**< [count] */
+	float *scale_y;       /**< [count] */
+	float *scale_z;       /**< [count] */
+	float *rotation_x;    /**< [count] Unit quaternion x. */
+	float *rotation_y;    /**< [count] Unit quaternion y. */
+	float *rotation_z;    /**< [count] Unit quaternion z. */
+	float *rotation_w;    /**< [count] Unit quaternion w (real part). */
+	float *translation_x; /**< [count] */
+	float *translation_y; /**< [count] */
+	float *translation_z; /**< [count] */
+
+	float *models;   /**< [count * 16] Column-major matrices, laid out like cglm's mat4. */
+	uint64_t *dirty; /**< [(count + 63) / 64] Bit i is set if transform i changed since the last update. */
+} EGL_TransformBatch;
+
+
+/** Hamilton product r = a * b (r may alias a or b). */
+static inline void EGL_QuatMul(const float a[4], const float b[4], float r[4]) {
+	const float x = a[3] * b[0] + a[0] * b[3] + a[1] * b[2] - a[2] * b[1];
+	const float y = a[3] * b[1] - a[0] * b[2] + a[1] * b[3] + a[2] * b[0];
+	const float z = a[3] * b[2] + a[0] * b[1] - a[1] * b[0] + a[2] * b[3];
+	const float w = a[3] * b[3] - a[0] * b[0] - a[1] * b[1] - a[2] * b[2];
+	r[0] = x;
+	r[1] = y;
+	r[2] = z;
+	r[3] = w;
+}
+
+/** Scale a quaternion back to unit length (a zero quaternion becomes the identity). */
+static inline void EGL_QuatNormalize(float q[4]) {
+	const float d = q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3];
+	if (!(d > 0.0f)) {
+		q[0] = q[1] = q[2] = 0.0f;
+		q[3] = 1.0f;
+		return;
+	}
+	const float inv = 1.0f / sqrtf(d);
+	q[0] *= inv;
+	q[1] *= inv;
+	q[2] *= inv;
+	q[3] *= inv;
+}
+
+/**
+ * Rotate a quaternion by an angle about an axis in its local frame.
+ *
+ * @param q The quaternion to rotate in place.
+ * @param angle Angle (radians).
+ * @param axis The axis (need not be normalized).
+ */
+static inline void EGL_QuatRotate(float q[4], float angle, const float axis[3]) {
+	const float length = sqrtf(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+	if (!(length > 0.0f)) {
+		return;
+	}
+	const float s = sinf(0.5f * angle) / length;
+	const float dq[4] = { axis[0] * s, axis[1] * s, axis[2] * s, cosf(0.5f * angle) };
+	EGL_QuatMul(q, dq, q);
+}
+
+/**
+ * Integrate an angular velocity in the local frame over one step.
+ *
+ * Uses the exponential map with its sine and cosine replaced by their series
+ * to the h^4 term (h is half the step's angle), so there is no trig and no
+ * square root. While |omega| * dt < 0.2 the truncation is below float
+ * precision, so each step is off by its rounding alone (about 1e-8 rad at
+ * 0.16 rad a step, as with EGL_QuatRotate). Those roundings add up over a
+ * constant spin: after a million such steps the orientation is about 6e-3
+ * rad off, against 1.3e-3 for EGL_QuatRotate (see EGL_transform_bench.c).
+ * The length drifts too, by about 3e-2 over the same run. Renormalizing every
+ * EGL_QUAT_RENORMALIZE_STEPS steps holds the length to float precision, but
+ * it does not undo the angle error.
+ *
+ * @param q The quaternion to rotate in place.
+ * @param omega Angular velocity (radians per unit of dt) about each local axis.
+ * @param dt The step.
+ */
+static inline void EGL_QuatIntegrate(float q[4], const float omega[3], float dt) {
+	const float hx = 0.5f * dt * omega[0];
+	const float hy = 0.5f * dt * omega[1];
+	const float hz = 0.5f * dt * omega[2];
+	const float h2 = hx * hx + hy * hy + hz * hz;
+	const float s = 1.0f - h2 * (1.0f / 6.0f) + h2 * h2 * (1.0f / 120.0f);
+	const float c = 1.0f - h2 * 0.5f + h2 * h2 * (1.0f / 24.0f);
+	const float dq[4] = { hx * s, hy * s, hz * s, c };
+	EGL_QuatMul(q, dq, q);
+}
+
+
+/**
+ * Allocate a batch of identity transforms, all marked dirty.
+ *
+ * @param batch The batch. Free with EGL_TransformBatchFree.
+ * @param count Number of transforms.
+ * @return False on allocation failure.
+ */
+bool EGL_TransformBatchInit(EGL_TransformBatch *batch, uint32_t count);
+
+/** Free all memory held by the batch and zero it. */
+void EGL_TransformBatchFree(EGL_TransformBatch *batch);
+
+/** Flag a transform whose arrays were written directly for the next update. */
+static inline void EGL_TransformBatchMarkDirty(EGL_TransformBatch *batch, uint32_t i) {
+	batch->dirty[i >> 6] |= (uint64_t)1 << (i & 63);
+}
+
+/**
+ * Set every property of a transform and mark it dirty.
+ *
+ * @param batch The batch.
+ * @param i The transform.
+ * @param scale [3] Scale.
+ * @param rotation [4] Unit quaternion (x, y, z, w) like cglm's versor.
+ * @param translation [3] Translation.
+ */
+void EGL_TransformBatchSet(EGL_TransformBatch *batch, uint32_t i, const float scale[3], const float rotation[4], const float translation[3]);
+
+/**
+ * Rebuild the model matrices of all dirty transforms and clear their bits.
+ *
+ * @param batch The batch.
+ * @param threads Number of threads to split the batch across.
+ */
+void EGL_TransformBatchUpdate(EGL_TransformBatch *batch, int threads);
+
+/**
+ * Rebuild the dirty model matrices of a range of dirty words, for callers that
+ * split the batch themselves (e.g. with EGL_JobsParallelFor). Ranges that do
+ * not overlap can be updated concurrently.
+ *
+ * @param batch The batch.
+ * @param begin First dirty word (transforms 64 * begin onwards).
+ * @param end One past the last dirty word, at most (count + 63) / 64.
+ */
+void EGL_TransformBatchUpdateWords(EGL_TransformBatch *batch, size_t begin, size_t end);
+
+/**
+ * Rebuild dirty model matrices one at a time the way EGL_TransformUpdate does
+ * (identity, scale, then multiply by the rotation matrix). For testing and
+ * benchmarking.
+ */
+void EGL_TransformBatchUpdateReference(EGL_TransformBatch *batch);
+
+/**
+ * Integrate per-transform angular velocities over one step (see
+ * EGL_QuatIntegrate) and mark every transform dirty.
+ *
+ * @param batch The batch.
+ * @param omega_x [count] Angular velocity about the local x axis.
+ * @param omega_y [count] Angular velocity about the local y axis.
+ * @param omega_z [count] Angular velocity about the local z axis.
+ * @param dt The step.
+ * @param renormalize Also renormalize the rotations (e.g. every EGL_QUAT_RENORMALIZE_STEPS steps).
+ * @param threads Number of threads to split the batch across.
+ */
+void EGL_TransformBatchIntegrate(EGL_TransformBatch *batch, const float *omega_x, const float *omega_y, const float *omega_z,
+	float dt, bool renormalize, int threads);
+
+
+#endif /* EGL_TRANSFORM_H */
@@ -0,0 +1,28 @@
+#version 460
+
+layout(set=1, binding=0) uniform UBO {
+    mat4 mvp;
+};
+
+layout(location=0) in vec3 position;
+layout(location=1) in vec4 color;
+layout(location=2) in vec2 uv;
+
+// Per instance, as EGL_Instance packs it
+layout(location=3) in vec4 instance_position; // xyz, then uniform scale in w
+layout(location=4) in vec4 instance_rotation; // unit quaternion
+layout(location=5) in vec4 instance_color;
+layout(location=6) in float instance_phase;
+
+layout(location=0) out vec4 out_color;
+layout(location=1) out vec2 out_uv;
+
+void main() {
+    vec3 q = instance_rotation.xyz;
+    float pulse = 1.0 + 0.15 * sin(6.2831853 * instance_phase);
+    vec3 v = position * instance_position.w * pulse;
+    v += 2.0 * cross(q, cross(q, v) + instance_rotation.w * v);
+    gl_Position = mvp * vec4(instance_position.xyz + v, 1);
+    out_color = color * instance_color;
+    out_uv = uv;
+}
@@ -0,0 +1,261 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <EGL/EGL_alloc.h>
+#include <EGL/EGL_queue.h>
+
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+
+#if defined(EGL_ALLOC_SITES) && defined(__GLIBC__)
+#include <execinfo.h>
+#define STACKS // This C library can walk the stack.
+#endif
+
+
+#define SKIP_FRAMES 2                        // record_site and the EGL_Alloc function that called it.
+#define SLOTS (2 * EGL_ALLOC_SITES_MAX)      // Open addressing, at most half full.
+
+
+/*
+ * A thread's counters, registered the first time it allocates. Only the thread
+ * writes them; they are atomic so other threads can sum them. They live until
+ * the process exits, since nothing tells the tracker a thread is gone.
+ */
+typedef struct AllocThread {
+	_Alignas(EGL_CACHE_LINE) _Atomic uint64_t allocs;
+	_Atomic uint64_t frees;
+	_Atomic uint64_t bytes;
+	struct AllocThread *next;
+} AllocThread;
+
+
+static EGL_MallocFunc MALLOC = malloc;
+static EGL_CallocFunc CALLOC = calloc;
+static EGL_ReallocFunc REALLOC = realloc;
+static EGL_FreeFunc FREE = free;
+
+static _Atomic(AllocThread *) THREADS = NULL;
+static _Thread_local AllocThread *CURRENT = NULL;
+static AllocThread LOST; // Counts for threads whose counters could not be allocated.
+static EGL_AllocCounts FRAME_BASE; // Totals at the last EGL_AllocFrame.
+
+#ifdef STACKS
+/* Call sites of the frame being recorded and the frame before it, guarded by SITE_LOCK */
+typedef struct {
+	EGL_AllocSite slots[SLOTS];
+	size_t count;
+	uint64_t dropped;
+} SiteTable;
+
+static once_flag ONCE = ONCE_FLAG_INIT;
+static mtx_t SITE_LOCK;
+static SiteTable TABLES[2];
+static int RECORDING = 0; // The table the current frame records into.
+#endif
+
+
+static AllocThread *current(void) {
+	if (CURRENT) {
+		return CURRENT;
+	}
+	AllocThread *t = (AllocThread *)aligned_alloc(EGL_CACHE_LINE, sizeof(AllocThread));
+	if (!t) {
+		return &LOST;
+	}
+	atomic_init(&t->allocs, 0);
+	atomic_init(&t->frees, 0);
+	atomic_init(&t->bytes, 0);
+	t->next = atomic_load(&THREADS);
+	while (!atomic_compare_exchange_weak(&THREADS, &t->next, t)) {
+	}
+	CURRENT = t;
+	return t;
+}
+
+/* Only the owner writes a thread's counters, so it needs no locked add. LOST is shared. */
+static void add(AllocThread *t, _Atomic uint64_t *counter, uint64_t n) {
+	if (t == &LOST) {
+		atomic_fetch_add_explicit(counter, n, memory_order_relaxed);
+	} else {
+		atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + n, memory_order_relaxed);
+	}
+}
+
+static void add_counts(EGL_AllocCounts *counts, AllocThread *t) {
+	counts->allocs += atomic_load_explicit(&t->allocs, memory_order_relaxed);
+	counts->frees += atomic_load_explicit(&t->frees, memory_order_relaxed);
+	counts->bytes += atomic_load_explicit(&t->bytes, memory_order_relaxed);
+}
+
+static void sum(EGL_AllocCounts *counts) {
+	memset(counts, 0, sizeof(*counts));
+	add_counts(counts, &LOST);
+	for (AllocThread *t = atomic_load(&THREADS); t; t = t->next) {
+		add_counts(counts, t);
+	}
+}
+
+#ifdef STACKS
+static void init_lock(void) {
+	mtx_init(&SITE_LOCK, mtx_plain);
+}
+
+static uint64_t hash_frames(void *const *frames, int depth) {
+	uint64_t h = 14695981039346656037ull;
+	for (int i = 0; i < depth; i++) {
+		h = (h ^ (uint64_t)(uintptr_t)frames[i]) * 1099511628211ull;
+	}
+	return h;
+}
+
+static void record_site(size_t bytes) {
+	void *frames[EGL_ALLOC_SITE_DEPTH + SKIP_FRAMES];
+	int depth = backtrace(frames, EGL_ALLOC_SITE_DEPTH + SKIP_FRAMES) - SKIP_FRAMES;
+	depth = depth < 0 ? 0 : depth;
+	void **stack = frames + SKIP_FRAMES;
+	const uint64_t h = hash_frames(stack, depth);
+
+	call_once(&ONCE, init_lock);
+	mtx_lock(&SITE_LOCK);
+	SiteTable *table = &TABLES[RECORDING];
+	for (size_t i = h % SLOTS;; i = (i + 1) % SLOTS) {
+		EGL_AllocSite *s = &table->slots[i];
+		if (s->allocs && s->depth == depth && memcmp(s->frames, stack, (size_t)depth * sizeof(void *)) == 0) {
+			s->allocs++;
+			s->bytes += bytes;
+			break;
+		}
+		if (!s->allocs) {
+			if (table->count == EGL_ALLOC_SITES_MAX) {
+				table->dropped++;
+				break;
+			}
+			memcpy(s->frames, stack, (size_t)depth * sizeof(void *));
+			s->depth = depth;
+			s->allocs = 1;
+			s->bytes = bytes;
+			table->count++;
+			break;
+		}
+	}
+	mtx_unlock(&SITE_LOCK);
+}
+
+static int compare_sites(const void *a, const void *b) {
+	const uint64_t x = ((const EGL_AllocSite *)a)->allocs, y = ((const EGL_AllocSite *)b)->allocs;
+	return (x < y) - (x > y);
+}
+#else
+static void record_site(size_t bytes) {
+}
+#endif
+
+static void count_alloc(size_t bytes) {
+	AllocThread *t = current();
+	add(t, &t->allocs, 1);
+	add(t, &t->bytes, bytes);
+	record_site(bytes);
+}
+
+
+void EGL_AllocWrap(EGL_MallocFunc malloc_func, EGL_CallocFunc calloc_func, EGL_ReallocFunc realloc_func, EGL_FreeFunc free_func) {
+	MALLOC = malloc_func;
+	CALLOC = calloc_func;
+	REALLOC = realloc_func;
+	FREE = free_func;
+}
+
+void *EGL_AllocMalloc(size_t size) {
+	count_alloc(size);
+	return MALLOC(size);
+}
+
+void *EGL_AllocCalloc(size_t count, size_t size) {
+	count_alloc(count * size);
+	return CALLOC(count, size);
+}
+
+void *EGL_AllocRealloc(void *memory, size_t size) {
+	count_alloc(size);
+	return REALLOC(memory, size);
+}
+
+void EGL_AllocFree(void *memory) {
+	if (memory) {
+		AllocThread *t = current();
+		add(t, &t->frees, 1);
+	}
+	FREE(memory);
+}
+
+void EGL_AllocThreadCounts(EGL_AllocCounts *counts) {
+	memset(counts, 0, sizeof(*counts));
+	add_counts(counts, current());
+}
+
+void EGL_AllocTotalCounts(EGL_AllocCounts *counts) {
+	sum(counts);
+}
+
+void EGL_AllocFrame(EGL_AllocCounts *counts) {
+	EGL_AllocCounts total;
+	sum(&total);
+	counts->allocs = total.allocs - FRAME_BASE.allocs;
+	counts->frees = total.frees - FRAME_BASE.frees;
+	counts->bytes = total.bytes - FRAME_BASE.bytes;
+	FRAME_BASE = total;
+
+#ifdef STACKS
+	call_once(&ONCE, init_lock);
+	mtx_lock(&SITE_LOCK);
+	RECORDING ^= 1;
+	SiteTable *table = &TABLES[RECORDING];
+	if (table->count || table->dropped) {
+		memset(table, 0, sizeof(*table));
+	}
+	mtx_unlock(&SITE_LOCK);
+#endif
+}
+
+size_t EGL_AllocSites(EGL_AllocSite *sites, size_t max) {
+	size_t n = 0;
+#ifdef STACKS
+	call_once(&ONCE, init_lock);
+	mtx_lock(&SITE_LOCK);
+	const SiteTable *table = &TABLES[RECORDING ^ 1];
+	EGL_AllocSite all[EGL_ALLOC_SITES_MAX];
+	for (size_t i = 0; i < SLOTS; i++) {
+		if (table->slots[i].allocs) {
+			all[n++] = table->slots[i];
+		}
+	}
+	mtx_unlock(&SITE_LOCK);
+
+	qsort(all, n, sizeof(EGL_AllocSite), compare_sites);
+	n = n < max ? n : max;
+	memcpy(sites, all, n * sizeof(EGL_AllocSite));
+#endif
+	return n;
+}
+
+void EGL_AllocPrintSites(FILE *f, size_t max) {
+#ifdef STACKS
+	EGL_AllocSite sites[EGL_ALLOC_SITES_MAX];
+	const size_t n = EGL_AllocSites(sites, max < EGL_ALLOC_SITES_MAX ? max : EGL_ALLOC_SITES_MAX);
+	mtx_lock(&SITE_LOCK);
+	const uint64_t dropped = TABLES[RECORDING ^ 1].dropped;
+	mtx_unlock(&SITE_LOCK);
+	for (size_t i = 0; i < n; i++) {
+		fprintf(f, "%llu allocations, %llu bytes at:\n", (unsigned long long)sites[i].allocs, (unsigned long long)sites[i].bytes);
+		fflush(f);
+		backtrace_symbols_fd(sites[i].frames, sites[i].depth, fileno(f));
+	}
+	if (dropped) {
+		fprintf(f, "%llu allocations at sites past the first %d.\n", (unsigned long long)dropped, EGL_ALLOC_SITES_MAX);
+	}
+#else
+	fprintf(f, "Allocation call sites are recorded in debug builds on glibc.\n");
+#endif
+}
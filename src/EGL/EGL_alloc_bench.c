@@ -0,0 +1,43 @@
+#include <EGL/EGL_bench.h>
+#include <EGL/EGL_alloc.h>
+
+#include <stdlib.h>
+
+
+#define ALLOCS 1000000
+
+
+static uint32_t lcg(uint32_t *state) {
+	*state = *state * 1664525u + 1013904223u;
+	return *state >> 8;
+}
+
+
+void EGL_AllocBench(void) {
+	EGL_DECLARE_BENCH(EGL_alloc);
+
+	uint32_t state = 43;
+
+#define RUN(name, alloc, release) do { \
+		double best = 1e30; \
+		for (int r = 0; r < EGL_BENCH_REPEATS; r++) { \
+			double begin = EGL_BenchNow(); \
+			for (int i = 0; i < ALLOCS; i++) { \
+				char *p = (char *)alloc(16 + lcg(&state) % 256); \
+				EGL_BENCH_SINK += (uintptr_t)p & 0xff; \
+				release(p); \
+			} \
+			double elapsed = EGL_BenchNow() - begin; \
+			best = (elapsed < best) ? elapsed : best; \
+		} \
+		EGL_BenchReport(name, best, (double)ALLOCS, "alloc"); \
+	} while (0)
+
+	/* What counting adds to a malloc and free of up to 272 bytes */
+	RUN("malloc", malloc, free);
+	RUN("tracked malloc", EGL_AllocMalloc, EGL_AllocFree);
+#undef RUN
+
+	EGL_AllocCounts frame;
+	EGL_AllocFrame(&frame);
+}
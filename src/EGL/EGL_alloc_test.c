@@ -0,0 +1,154 @@
+#include <EGL/EGL_testing.h>
+#include <EGL/EGL_sort.h>
+#include <stdlib.h>
+
+
+#define THREADS 4
+#define ALLOCS 10000 // Allocations each thread makes.
+#define SORTED 64    // Keys sorted inside the budgeted frame.
+
+
+static int churn(void *arg) {
+	for (int i = 0; i < ALLOCS; i++) {
+		void *p = EGL_AllocMalloc((size_t)(i % 64) + 1);
+		EGL_AllocFree(p);
+	}
+	return 0;
+}
+
+static void *allocate_here(size_t size) {
+	return EGL_AllocMalloc(size);
+}
+
+static void *allocate_there(size_t size) {
+	return EGL_AllocCalloc(1, size);
+}
+
+
+/**
+ * Each call is counted against the thread that made it, and the frame
+ * reports what all threads did since the last frame.
+ */
+static void EGL_AllocCountsTest(EGL_Test *T) {
+	EGL_DECLARE_TEST;
+
+	EGL_AllocCounts before, after, frame;
+	EGL_AllocFrame(&frame);
+	EGL_AllocThreadCounts(&before);
+
+	void *a = EGL_AllocMalloc(100);
+	void *b = EGL_AllocCalloc(10, 20);
+	a = EGL_AllocRealloc(a, 300);
+	EGL_AllocFree(a);
+	EGL_AllocFree(b);
+	EGL_AllocFree(NULL);
+
+	EGL_AllocThreadCounts(&after);
+	if (after.allocs - before.allocs != 3 || after.frees - before.frees != 2 || after.bytes - before.bytes != 600) {
+		EGL_DECLARE_ERROR("Expected 3 allocations of 600 bytes and 2 frees, got %llu of %llu and %llu.",
+			(unsigned long long)(after.allocs - before.allocs), (unsigned long long)(after.bytes - before.bytes),
+			(unsigned long long)(after.frees - before.frees));
+	}
+
+	thrd_t threads[THREADS];
+	int started = 0;
+	for (int t = 0; t < THREADS; t++) {
+		started += (thrd_create(&threads[started], churn, NULL) == thrd_success);
+	}
+	for (int t = 0; t < started; t++) {
+		thrd_join(threads[t], NULL);
+	}
+
+	EGL_AllocThreadCounts(&before);
+	EGL_AllocFrame(&frame);
+	const uint64_t expected = 3 + (uint64_t)started * ALLOCS;
+	if (frame.allocs != expected || frame.frees != expected - 1 || before.allocs != after.allocs) {
+		EGL_DECLARE_ERROR("Expected %llu allocations in the frame, %llu on this thread, got %llu and %llu.",
+			(unsigned long long)expected, (unsigned long long)after.allocs, (unsigned long long)frame.allocs, (unsigned long long)before.allocs);
+	}
+
+	EGL_AllocFrame(&frame);
+	if (frame.allocs != 0 || frame.frees != 0 || frame.bytes != 0) {
+		EGL_DECLARE_ERROR("An empty frame counted %llu allocations.", (unsigned long long)frame.allocs);
+	}
+}
+
+/**
+ * In debug builds, allocations are grouped by the stack that made them, and
+ * each frame keeps only its own sites.
+ */
+static void EGL_AllocSitesTest(EGL_Test *T) {
+	EGL_DECLARE_TEST;
+
+	EGL_AllocCounts frame;
+	EGL_AllocFrame(&frame);
+
+	void *p[8];
+	for (int i = 0; i < 8; i++) {
+		p[i] = (i < 5) ? allocate_here(16) : allocate_there(32);
+	}
+	for (int i = 0; i < 8; i++) {
+		EGL_AllocFree(p[i]);
+	}
+
+	EGL_AllocFrame(&frame);
+	EGL_AllocSite sites[4];
+	const size_t n = EGL_AllocSites(sites, 4);
+#if defined(EGL_ALLOC_SITES) && defined(__GLIBC__)
+	if (n != 2 || sites[0].allocs != 5 || sites[0].bytes != 80 || sites[1].allocs != 3 || sites[1].bytes != 96) {
+		EGL_DECLARE_ERROR("Expected sites of 5 and 3 allocations, got %zu sites.", n);
+	}
+#else
+	if (n != 0) {
+		EGL_DECLARE_ERROR("Recorded %zu sites without EGL_ALLOC_SITES.", n);
+	}
+#endif
+
+	EGL_AllocFrame(&frame);
+	if (EGL_AllocSites(sites, 4) != 0) {
+		EGL_DECLARE_ERROR("An empty frame had %zu sites.", EGL_AllocSites(sites, 4));
+	}
+}
+
+/**
+ * With the tracker installed in front of EGL's allocator, an EGL module that
+ * allocates inside a frame is counted, so a budget of 0 allocations trips.
+ */
+static void EGL_AllocBudgetTest(EGL_Test *T) {
+	EGL_DECLARE_TEST;
+
+	uint64_t keys[SORTED], keys_tmp[SORTED];
+	for (int i = 0; i < SORTED; i++) {
+		keys[i] = (uint64_t)(SORTED - i) * 0x9E3779B97F4A7C15ull;
+	}
+	const uint64_t budget = 0;
+	EGL_AllocCounts frame;
+
+	EGL_SetMemoryFunctions(EGL_AllocMalloc, EGL_AllocCalloc, EGL_AllocRealloc, EGL_AllocFree);
+	EGL_AllocFrame(&frame);
+	const bool sorted = EGL_RadixSort(keys, NULL, keys_tmp, NULL, SORTED, NULL);
+	EGL_AllocFrame(&frame);
+	if (!sorted || frame.allocs <= budget || frame.frees != frame.allocs) {
+		EGL_DECLARE_ERROR("Sorting without scratch counted %llu allocations against a budget of %llu.",
+			(unsigned long long)frame.allocs, (unsigned long long)budget);
+	}
+
+	void *scratch = EGL_malloc(EGL_RadixSortScratchSize());
+	EGL_AllocFrame(&frame);
+	EGL_RadixSort(keys, NULL, keys_tmp, NULL, SORTED, scratch);
+	EGL_AllocFrame(&frame);
+	if (frame.allocs != budget) {
+		EGL_DECLARE_ERROR("Sorting with scratch counted %llu allocations.", (unsigned long long)frame.allocs);
+	}
+	EGL_free(scratch);
+	EGL_SetMemoryFunctions(NULL, NULL, NULL, NULL);
+}
+
+
+void EGL_AllocTest(EGL_TestModule *M) {
+	EGL_DECLARE_MODULE(EGL_alloc);
+
+	EGL_RUN_TEST(EGL_AllocCountsTest);
+	EGL_RUN_TEST(EGL_AllocSitesTest);
+	EGL_RUN_TEST(EGL_AllocBudgetTest);
+}
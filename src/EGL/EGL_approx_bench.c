@@ -0,0 +1,89 @@
+#include <EGL/EGL_bench.h>
+#include <EGL/EGL_approx.h>
+
+#include <math.h>
+#include <stdlib.h>
+
+
+#define COUNT 4096 // Small enough to stay in L1/L2, so this measures the math and not memory.
+
+
+static uint32_t lcg(uint32_t *state) {
+	*state = *state * 1664525u + 1013904223u;
+	return *state >> 8;
+}
+
+static float unit(uint32_t *state) {
+	return (float)lcg(state) / 16777216.0f;
+}
+
+
+void EGL_ApproxBench(void) {
+	EGL_DECLARE_BENCH(EGL_approx);
+
+	float *x = (float *)malloc(sizeof(float) * COUNT);
+	float *y = (float *)malloc(sizeof(float) * COUNT);
+	float *out = (float *)calloc(COUNT, sizeof(float));
+	float *out2 = (float *)calloc(COUNT, sizeof(float));
+	if (!x || !y || !out || !out2) {
+		printf(" %d values: failed to allocate\n", COUNT);
+		free(x);
+		free(y);
+		free(out);
+		free(out2);
+		return;
+	}
+
+	/* Inputs in the ranges a game sees: angles within a few turns, dot products, modest exponents */
+	uint32_t state = 36;
+	for (int i = 0; i < COUNT; i++) {
+		x[i] = 2.0f * unit(&state) - 1.0f;
+		y[i] = 2.0f * unit(&state) - 1.0f;
+	}
+
+#define RUN(label, step, ...) do { \
+		double best = 1e30; \
+		for (int rep = 0; rep < EGL_BENCH_REPEATS * 4; rep++) { \
+			double begin = EGL_BenchNow(); \
+			for (int i = 0; i < COUNT; i += step) { \
+				__VA_ARGS__; \
+			} \
+			double elapsed = EGL_BenchNow() - begin; \
+			best = (elapsed < best) ? elapsed : best; \
+		} \
+		EGL_BENCH_SINK += (uint64_t)(1000.0f * (out[COUNT / 3] + out2[COUNT / 3])); \
+		EGL_BenchReport(label, best, (double)COUNT, "value"); \
+	} while (0)
+
+#define FORMS(name, libm, fast, fast4, fast8, scale) \
+	RUN(name ", libm", 1, out[i] = libm(scale * x[i])); \
+	RUN(name ", scalar", 1, out[i] = fast(scale * x[i])); \
+	RUN(name ", 4-wide", 4, out[i] = 0.0f; EGL_Vec4 v; memcpy(v.array, x + i, sizeof(v.array)); \
+		const EGL_Vec4 r = fast4(EGL_Vec4Scale(v, scale)); memcpy(out + i, r.array, sizeof(r.array))); \
+	RUN(name ", 8-wide", 8, EGL_Floatx8Store(out + i, fast8(EGL_Floatx8Mul(EGL_Floatx8Load(x + i), EGL_Floatx8Set(scale)))))
+
+	FORMS("sin", sinf, EGL_FastSin, EGL_FastSin4, EGL_FastSin8, 10.0f);
+	FORMS("cos", cosf, EGL_FastCos, EGL_FastCos4, EGL_FastCos8, 10.0f);
+	FORMS("acos", acosf, EGL_FastAcos, EGL_FastAcos4, EGL_FastAcos8, 1.0f);
+	FORMS("exp", expf, EGL_FastExp, EGL_FastExp4, EGL_FastExp8, 20.0f);
+	FORMS("log", logf, EGL_FastLog, EGL_FastLog4, EGL_FastLog8, 1.0f + x[i]);
+
+	RUN("sincos, libm", 1, out[i] = sinf(10.0f * x[i]); out2[i] = cosf(10.0f * x[i]));
+	RUN("sincos, 8-wide", 8, {
+		EGL_Floatx8 s, c;
+		EGL_FastSinCos8(EGL_Floatx8Mul(EGL_Floatx8Load(x + i), EGL_Floatx8Set(10.0f)), &s, &c);
+		EGL_Floatx8Store(out + i, s);
+		EGL_Floatx8Store(out2 + i, c);
+	});
+
+	RUN("atan2, libm", 1, out[i] = atan2f(y[i], x[i]));
+	RUN("atan2, scalar", 1, out[i] = EGL_FastAtan2(y[i], x[i]));
+	RUN("atan2, 8-wide", 8, EGL_Floatx8Store(out + i, EGL_FastAtan28(EGL_Floatx8Load(y + i), EGL_Floatx8Load(x + i))));
+#undef FORMS
+#undef RUN
+
+	free(x);
+	free(y);
+	free(out);
+	free(out2);
+}
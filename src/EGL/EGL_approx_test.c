@@ -0,0 +1,156 @@
+#include <EGL/EGL_testing.h>
+#include <math.h>
+#include <stdlib.h>
+
+
+#define STRIDE 4099 // Bit patterns between samples, about a million over all floats.
+
+
+/* Error in units in the last place of the float nearest the exact result. */
+static double ulp_error(float got, double exact) {
+	const float a = fabsf((float)exact);
+	const float ulp = (a < FLT_MIN) ? 1.4e-45f : nextafterf(a, INFINITY) - a;
+	return fabs((double)got - exact) / ulp;
+}
+
+static float from_bits(uint32_t u) {
+	float f;
+	memcpy(&f, &u, sizeof(f));
+	return f;
+}
+
+static bool same(float a, float b) {
+	return (a == b) || (a != a && b != b);
+}
+
+/* The 4- and 8-wide forms give each lane exactly what the scalar form does. */
+static bool wide_matches(float x, float y) {
+	const EGL_Vec4 x4 = {{ x, -x, 0.5f * x, y }};
+	const EGL_Vec4 y4 = {{ y, y, -y, x }};
+	const float xs[8] = { x, -x, 0.5f * x, y, x, -x, 0.5f * x, y };
+	const float ys[8] = { y, y, -y, x, y, y, -y, x };
+	const EGL_Floatx8 x8 = EGL_Floatx8Load(xs);
+	const EGL_Floatx8 y8 = EGL_Floatx8Load(ys);
+
+	EGL_Vec4 s4, c4;
+	EGL_Floatx8 s8, c8;
+	EGL_FastSinCos4(x4, &s4, &c4);
+	EGL_FastSinCos8(x8, &s8, &c8);
+	const EGL_Vec4 results4[6] = { s4, c4, EGL_FastAtan24(y4, x4), EGL_FastAcos4(x4), EGL_FastExp4(x4), EGL_FastLog4(x4) };
+	const EGL_Floatx8 results8[6] = { s8, c8, EGL_FastAtan28(y8, x8), EGL_FastAcos8(x8), EGL_FastExp8(x8), EGL_FastLog8(x8) };
+	for (int f = 0; f < 6; f++) {
+		float out8[8];
+		EGL_Floatx8Store(out8, results8[f]);
+		for (int k = 0; k < 8; k++) {
+			const float a = xs[k], b = ys[k];
+			const float expected[6] = { EGL_FastSin(a), EGL_FastCos(a), EGL_FastAtan2(b, a), EGL_FastAcos(a), EGL_FastExp(a), EGL_FastLog(a) };
+			if (!same(out8[k], expected[f]) || (k < 4 && !same(results4[f].array[k], expected[f]))) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+
+/**
+ * Sweeping float bit patterns, every function stays within the error the
+ * header documents.
+ */
+static void EGL_ApproxAccuracyTest(EGL_Test *T) {
+	EGL_DECLARE_TEST;
+
+	double sin_ulp = 0.0, cos_ulp = 0.0, sin_abs = 0.0, exp_ulp = 0.0, log_ulp = 0.0, acos_ulp = 0.0;
+	for (uint64_t bits = 0; bits < 0x100000000ull; bits += STRIDE) {
+		const float x = from_bits((uint32_t)bits);
+		if (x != x) {
+			continue;
+		}
+		const double xd = x;
+		if (fabsf(x) <= 3.14159265f) {
+			sin_ulp = fmax(sin_ulp, ulp_error(EGL_FastSin(x), sin(xd)));
+			cos_ulp = fmax(cos_ulp, ulp_error(EGL_FastCos(x), cos(xd)));
+		}
+		if (fabsf(x) <= 8192.0f) {
+			sin_abs = fmax(sin_abs, fmax(fabs(EGL_FastSin(x) - sin(xd)), fabs(EGL_FastCos(x) - cos(xd))));
+		}
+		if (x >= -87.3f && x <= 88.72f) {
+			exp_ulp = fmax(exp_ulp, ulp_error(EGL_FastExp(x), exp(xd)));
+		}
+		if (x > 0.0f && x < INFINITY) {
+			log_ulp = fmax(log_ulp, ulp_error(EGL_FastLog(x), log(xd)));
+		}
+		if (fabsf(x) <= 1.0f) {
+			acos_ulp = fmax(acos_ulp, ulp_error(EGL_FastAcos(x), acos(xd)));
+		}
+	}
+
+	/* Pairs of random finite floats of any magnitude, and of similar magnitude */
+	double atan2_ulp = 0.0;
+	uint32_t state[4] = {0,0,0,0};
+	EGL_Seed(state, 36);
+	for (int i = 0; i < 200000; i++) {
+		const float y = from_bits(EGL_RandNext(state));
+		const float x = from_bits(EGL_RandNext(state));
+		if (isfinite(x) && isfinite(y)) {
+			atan2_ulp = fmax(atan2_ulp, ulp_error(EGL_FastAtan2(y, x), atan2((double)y, (double)x)));
+		}
+		const float v = EGL_RandFloat(state) - 0.5f;
+		const float u = EGL_RandFloat(state) - 0.5f;
+		atan2_ulp = fmax(atan2_ulp, ulp_error(EGL_FastAtan2(v, u), atan2((double)v, (double)u)));
+	}
+
+	if (sin_ulp > 2.0 || cos_ulp > 2.0 || sin_abs > 1e-7) {
+		EGL_DECLARE_ERROR("Sine is off by %.2f ulp, cosine by %.2f ulp, either by %g.", sin_ulp, cos_ulp, sin_abs);
+	}
+	if (atan2_ulp > 3.5 || acos_ulp > 1.5) {
+		EGL_DECLARE_ERROR("atan2 is off by %.2f ulp and acos by %.2f ulp.", atan2_ulp, acos_ulp);
+	}
+	if (exp_ulp > 1.5 || log_ulp > 1.0) {
+		EGL_DECLARE_ERROR("exp is off by %.2f ulp and log by %.2f ulp.", exp_ulp, log_ulp);
+	}
+}
+
+/**
+ * Zeros, infinities, NaNs and the ends of the ranges behave like libm, and the
+ * SIMD forms agree with the scalar ones lane for lane.
+ */
+static void EGL_ApproxSpecialTest(EGL_Test *T) {
+	EGL_DECLARE_TEST;
+
+	if (EGL_FastLog(0.0f) != -INFINITY || !isnan(EGL_FastLog(-1.0f)) || EGL_FastLog(INFINITY) != INFINITY || EGL_FastLog(1.0f) != 0.0f) {
+		EGL_DECLARE_ERROR("log of 0, -1, inf and 1 gave %f, %f, %f, %f.", EGL_FastLog(0.0f), EGL_FastLog(-1.0f), EGL_FastLog(INFINITY), EGL_FastLog(1.0f));
+	}
+	if (EGL_FastExp(100.0f) != INFINITY || EGL_FastExp(-200.0f) != 0.0f || EGL_FastExp(0.0f) != 1.0f || !isnan(EGL_FastExp(NAN))) {
+		EGL_DECLARE_ERROR("exp of 100, -200, 0 and NaN gave %f, %f, %f, %f.", EGL_FastExp(100.0f), EGL_FastExp(-200.0f), EGL_FastExp(0.0f), EGL_FastExp(NAN));
+	}
+	if (EGL_FastExp(-100.0f) <= 0.0f || fabs(EGL_FastExp(-100.0f) - exp(-100.0)) > 1e-44) {
+		EGL_DECLARE_ERROR("exp of -100 gave %g, not a subnormal near %g.", EGL_FastExp(-100.0f), exp(-100.0));
+	}
+	if (EGL_FastAtan2(0.0f, -1.0f) != EGL_APPROX_PI || EGL_FastAtan2(-0.0f, -1.0f) != -EGL_APPROX_PI || EGL_FastAtan2(0.0f, 0.0f) != 0.0f || EGL_FastAtan2(1.0f, 0.0f) != EGL_APPROX_PI_2) {
+		EGL_DECLARE_ERROR("atan2 of (0, -1), (-0, -1), (0, 0), (1, 0) gave %f, %f, %f, %f.", EGL_FastAtan2(0.0f, -1.0f), EGL_FastAtan2(-0.0f, -1.0f), EGL_FastAtan2(0.0f, 0.0f), EGL_FastAtan2(1.0f, 0.0f));
+	}
+	if (!isnan(EGL_FastAcos(1.5f)) || EGL_FastAcos(1.0f) != 0.0f || EGL_FastAcos(-1.0f) != EGL_APPROX_PI || !isnan(EGL_FastSin(NAN))) {
+		EGL_DECLARE_ERROR("acos of 1.5, 1 and -1 gave %f, %f, %f.", EGL_FastAcos(1.5f), EGL_FastAcos(1.0f), EGL_FastAcos(-1.0f));
+	}
+
+	const float edges[] = { 0.0f, -0.0f, 1e-40f, FLT_MIN, 0.5f, 1.0f, -1.0f, 3.14159265f, 88.8f, -104.0f, 1e30f, -1e30f, INFINITY, -INFINITY, NAN };
+	const int n = (int)(sizeof(edges) / sizeof(edges[0]));
+	uint32_t state[4] = {0,0,0,0};
+	EGL_Seed(state, 37);
+	for (int i = 0; i < 20000 && T->error_count < ERRORS_MAX - 1; i++) {
+		const float x = (i < n * n) ? edges[i % n] : 200.0f * EGL_RandFloat(state) - 100.0f;
+		const float y = (i < n * n) ? edges[i / n] : 200.0f * EGL_RandFloat(state) - 100.0f;
+		if (!wide_matches(x, y)) {
+			EGL_DECLARE_ERROR("SIMD lanes for (%g, %g) differ from the scalar functions.", x, y);
+		}
+	}
+}
+
+
+void EGL_ApproxTest(EGL_TestModule *M) {
+	EGL_DECLARE_MODULE(EGL_approx);
+
+	EGL_RUN_TEST(EGL_ApproxAccuracyTest);
+	EGL_RUN_TEST(EGL_ApproxSpecialTest);
+}
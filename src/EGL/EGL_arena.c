@@ -0,0 +1,117 @@
+#define _DEFAULT_SOURCE // MAP_ANONYMOUS
+
+#include <EGL/EGL_arena.h>
+#include <EGL/EGL_memory.h>
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef EGL_ARENA_GUARD
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+
+static size_t round_up(size_t n, size_t multiple) {
+	return (n + multiple - 1) / multiple * multiple;
+}
+
+/*
+ * Get size bytes that end where the guard page starts, so the first byte past
+ * them faults. size must be a multiple of EGL_ARENA_ALIGN.
+ */
+static uint8_t *map(size_t size, size_t *mapped) {
+#ifdef EGL_ARENA_GUARD
+	const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+	const size_t body = round_up(size ? size : 1, page);
+	uint8_t *start = (uint8_t *)mmap(NULL, body + page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (start == (uint8_t *)MAP_FAILED) {
+		return NULL;
+	}
+	if (mprotect(start + body, page, PROT_NONE) != 0) {
+		munmap(start, body + page);
+		return NULL;
+	}
+	*mapped = body + page;
+	return start + body - size;
+#else
+	*mapped = 0;
+	return (uint8_t *)EGL_malloc(size ? size : 1);
+#endif
+}
+
+static void unmap(uint8_t *base, size_t size, size_t mapped) {
+#ifdef EGL_ARENA_GUARD
+	if (base) {
+		const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+		munmap(base + size + page - mapped, mapped);
+	}
+#else
+	EGL_free(base);
+#endif
+}
+
+
+bool EGL_ArenaInit(EGL_Arena *a, size_t capacity) {
+	memset(a, 0, sizeof(*a));
+	capacity = round_up(capacity, EGL_ARENA_ALIGN);
+	a->base = map(capacity, &a->mapped);
+	if (!a->base) {
+		return false;
+	}
+	a->capacity = capacity;
+	return true;
+}
+
+void EGL_ArenaFree(EGL_Arena *a) {
+	unmap(a->base, a->capacity, a->mapped);
+	memset(a, 0, sizeof(*a));
+}
+
+char *EGL_ArenaPrintf(EGL_Arena *a, const char *format, ...) {
+	char *s = (char *)a->base + a->used;
+	const size_t room = a->capacity - a->used;
+
+	va_list args;
+	va_start(args, format);
+	const int n = vsnprintf(s, room, format, args);
+	va_end(args);
+
+	if (n < 0 || (size_t)n >= room) {
+		return NULL;
+	}
+	a->used += (size_t)n + 1;
+	a->peak = (a->used > a->peak) ? a->used : a->peak;
+	return s;
+}
+
+void EGL_ArenaRewind(EGL_Arena *a, EGL_ArenaMarker marker) {
+	if (marker >= a->used) {
+		return;
+	}
+#ifndef NDEBUG
+	memset(a->base + marker, EGL_ARENA_POISON, a->used - marker);
+#endif
+	a->used = marker;
+}
+
+
+bool EGL_PoolInit(EGL_Pool *p, size_t block_size, uint32_t capacity) {
+	memset(p, 0, sizeof(*p));
+	p->block_size = round_up(block_size < sizeof(void *) ? sizeof(void *) : block_size, EGL_ARENA_ALIGN);
+	if (capacity && p->block_size > SIZE_MAX / capacity) {
+		return false;
+	}
+	p->blocks = map(p->block_size * capacity, &p->mapped);
+	if (!p->blocks) {
+		return false;
+	}
+	p->capacity = capacity;
+	return true;
+}
+
+void EGL_PoolFree(EGL_Pool *p) {
+	unmap(p->blocks, p->block_size * p->capacity, p->mapped);
+	memset(p, 0, sizeof(*p));
+}
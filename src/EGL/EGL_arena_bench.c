@@ -0,0 +1,119 @@
+#include <EGL/EGL_bench.h>
+#include <EGL/EGL_arena.h>
+
+#include <stdlib.h>
+
+
+#define FRAMES 10000
+#define FRAME_ALLOCS 64      // Scratch allocations per frame, of 16 to 1039 bytes.
+#define ENTITIES 4096        // Live entity slots in the churn.
+#define ENTITY_BYTES 96
+#define CHURN 1000000        // Entities destroyed and created.
+#define PATHS 1000000
+
+
+static uint32_t lcg(uint32_t *state) {
+	*state = *state * 1664525u + 1013904223u;
+	return *state >> 8;
+}
+
+
+static void frame_malloc(uint32_t *state) {
+	void *scratch[FRAME_ALLOCS];
+	for (int i = 0; i < FRAME_ALLOCS; i++) {
+		scratch[i] = malloc(16 + lcg(state) % 1024);
+		EGL_BENCH_SINK += (uintptr_t)scratch[i] & 0xff;
+	}
+	for (int i = 0; i < FRAME_ALLOCS; i++) {
+		free(scratch[i]);
+	}
+}
+
+static void frame_arena(EGL_Arena *a, uint32_t *state) {
+	for (int i = 0; i < FRAME_ALLOCS; i++) {
+		void *p = EGL_ArenaAlloc(a, 16 + lcg(state) % 1024);
+		EGL_BENCH_SINK += (uintptr_t)p & 0xff;
+	}
+	EGL_ArenaReset(a);
+}
+
+/* Replace a random live entity with a new one */
+static void churn_malloc(void **live, uint32_t *state) {
+	const uint32_t i = lcg(state) % ENTITIES;
+	free(live[i]);
+	live[i] = malloc(ENTITY_BYTES);
+	EGL_BENCH_SINK += (uintptr_t)live[i] & 0xff;
+}
+
+static void churn_pool(EGL_Pool *p, void **live, uint32_t *state) {
+	const uint32_t i = lcg(state) % ENTITIES;
+	EGL_PoolRelease(p, live[i]);
+	live[i] = EGL_PoolAlloc(p);
+	EGL_BENCH_SINK += (uintptr_t)live[i] & 0xff;
+}
+
+static void path_malloc(uint32_t *state) {
+	char *path = (char *)malloc(4096);
+	snprintf(path, 4096, "%sassets/level%u.bin", "/home/player/games/florbles/", lcg(state) % 100);
+	EGL_BENCH_SINK += (uint8_t)path[40];
+	free(path);
+}
+
+static void path_arena(EGL_Arena *a, uint32_t *state) {
+	const EGL_ArenaMarker mark = EGL_ArenaMark(a);
+	char *path = EGL_ArenaPrintf(a, "%sassets/level%u.bin", "/home/player/games/florbles/", lcg(state) % 100);
+	EGL_BENCH_SINK += (uint8_t)path[40];
+	EGL_ArenaRewind(a, mark);
+}
+
+
+void EGL_ArenaBench(void) {
+	EGL_DECLARE_BENCH(EGL_arena);
+
+	EGL_Arena arena;
+	EGL_Pool pool;
+	void **live = (void **)malloc(ENTITIES * sizeof(void *));
+	if (!live || !EGL_ArenaInit(&arena, FRAME_ALLOCS * 1040) || !EGL_PoolInit(&pool, ENTITY_BYTES, ENTITIES)) {
+		printf(" failed to allocate\n");
+		free(live);
+		return;
+	}
+	uint32_t state = 44;
+
+#define RUN(name, count, unit, ...) do { \
+		double best = 1e30; \
+		for (int r = 0; r < EGL_BENCH_REPEATS; r++) { \
+			double begin = EGL_BenchNow(); \
+			for (int i = 0; i < (count); i++) { \
+				__VA_ARGS__; \
+			} \
+			double elapsed = EGL_BenchNow() - begin; \
+			best = (elapsed < best) ? elapsed : best; \
+		} \
+		EGL_BenchReport(name, best, (double)(count), unit); \
+	} while (0)
+
+	/* A frame's scratch: many short-lived allocations of mixed sizes, all gone by the next frame */
+	RUN("frame scratch, malloc", FRAMES, "frame", frame_malloc(&state));
+	RUN("frame scratch, arena", FRAMES, "frame", frame_arena(&arena, &state));
+
+	/* Entities dying and spawning in random order */
+	for (int i = 0; i < ENTITIES; i++) {
+		live[i] = malloc(ENTITY_BYTES);
+	}
+	RUN("entity churn, malloc", CHURN, "entity", churn_malloc(live, &state));
+	for (int i = 0; i < ENTITIES; i++) {
+		free(live[i]);
+		live[i] = EGL_PoolAlloc(&pool);
+	}
+	RUN("entity churn, pool", CHURN, "entity", churn_pool(&pool, live, &state));
+
+	/* A temporary asset path */
+	RUN("path, malloc", PATHS, "path", path_malloc(&state));
+	RUN("path, arena", PATHS, "path", path_arena(&arena, &state));
+#undef RUN
+
+	EGL_PoolFree(&pool);
+	EGL_ArenaFree(&arena);
+	free(live);
+}
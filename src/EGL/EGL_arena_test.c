@@ -0,0 +1,116 @@
+#include <EGL/EGL_testing.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+#define ARENA_BYTES 1000 // Not a multiple of the alignment, to check rounding.
+#define BLOCKS 100
+#define BLOCK_BYTES 40
+
+
+/**
+ * Allocations are aligned, never overlap and never pass the capacity, and a
+ * marker takes back exactly what came after it.
+ */
+static void EGL_ArenaAllocTest(EGL_Test *T) {
+	EGL_DECLARE_TEST;
+
+	EGL_Arena a;
+	if (!EGL_ArenaInit(&a, ARENA_BYTES)) {
+		EGL_DECLARE_ERROR("Failed to allocate an arena of %d bytes.", ARENA_BYTES);
+		return;
+	}
+	if (a.capacity < ARENA_BYTES || a.capacity % EGL_ARENA_ALIGN != 0) {
+		EGL_DECLARE_ERROR("An arena of %d bytes got a capacity of %zu.", ARENA_BYTES, a.capacity);
+	}
+
+	uint8_t *first = (uint8_t *)EGL_ArenaAlloc(&a, 3);
+	uint8_t *wide = (uint8_t *)EGL_ArenaAllocAligned(&a, 64, 64);
+	if (!first || !wide || (uintptr_t)first % EGL_ARENA_ALIGN || (uintptr_t)wide % 64 || wide < first + 3) {
+		EGL_DECLARE_ERROR("Allocations at %p and %p were misaligned or overlapped.", (void *)first, (void *)wide);
+	}
+	memset(first, 1, 3);
+	memset(wide, 2, 64);
+
+	const EGL_ArenaMarker mark = EGL_ArenaMark(&a);
+	const char *path = EGL_ArenaPrintf(&a, "%s%s.bin", "assets/", "sphere");
+	if (!path || strcmp(path, "assets/sphere.bin") != 0) {
+		EGL_DECLARE_ERROR("Formatted \"%s\" into the arena.", path ? path : "(null)");
+	}
+	size_t filled = 0;
+	while (EGL_ArenaAlloc(&a, 24)) {
+		filled++;
+	}
+	if (a.used > a.capacity || a.peak != a.used || EGL_ArenaPrintf(&a, "%d", 12345678) != NULL) {
+		EGL_DECLARE_ERROR("A full arena used %zu of %zu bytes, peak %zu.", a.used, a.capacity, a.peak);
+	}
+
+	EGL_ArenaRewind(&a, mark);
+	const char *again = EGL_ArenaPrintf(&a, "%s", "again");
+	if (again != path || first[2] != 1 || wide[63] != 2) {
+		EGL_DECLARE_ERROR("Rewinding to a marker moved %p to %p or lost earlier data.", (const void *)path, (const void *)again);
+	}
+
+	EGL_ArenaReset(&a);
+	if (a.used != 0 || EGL_ArenaAlloc(&a, a.capacity) != a.base || EGL_ArenaAlloc(&a, 1) != NULL) {
+		EGL_DECLARE_ERROR("A reset arena could not hand out all %zu bytes.", a.capacity);
+	}
+	EGL_ArenaFree(&a);
+}
+
+/**
+ * A pool hands out each block once until it is released, reuses released
+ * blocks first, and maps blocks to indices and back.
+ */
+static void EGL_PoolAllocTest(EGL_Test *T) {
+	EGL_DECLARE_TEST;
+
+	EGL_Pool p;
+	if (!EGL_PoolInit(&p, BLOCK_BYTES, BLOCKS)) {
+		EGL_DECLARE_ERROR("Failed to allocate a pool of %d blocks.", BLOCKS);
+		return;
+	}
+
+	uint8_t *blocks[BLOCKS];
+	uint8_t seen[BLOCKS] = { 0 };
+	for (int i = 0; i < BLOCKS; i++) {
+		blocks[i] = (uint8_t *)EGL_PoolAlloc(&p);
+		const uint32_t index = blocks[i] ? EGL_PoolIndex(&p, blocks[i]) : BLOCKS;
+		if (index >= BLOCKS || seen[index] || EGL_PoolBlock(&p, index) != blocks[i] || (uintptr_t)blocks[i] % EGL_ARENA_ALIGN) {
+			EGL_DECLARE_ERROR("Block %d at %p was null, misaligned or handed out twice.", i, (void *)blocks[i]);
+			EGL_PoolFree(&p);
+			return;
+		}
+		seen[index] = 1;
+		memset(blocks[i], i, BLOCK_BYTES);
+	}
+	if (EGL_PoolAlloc(&p) != NULL || p.used != BLOCKS) {
+		EGL_DECLARE_ERROR("A full pool of %d blocks handed out another, with %u used.", BLOCKS, p.used);
+	}
+
+	/* Release every other block; they come back most recent first */
+	for (int i = 0; i < BLOCKS; i += 2) {
+		EGL_PoolRelease(&p, blocks[i]);
+	}
+	for (int i = BLOCKS - 2; i >= 0; i -= 2) {
+		if (EGL_PoolAlloc(&p) != blocks[i]) {
+			EGL_DECLARE_ERROR("Expected released block %d back.", i);
+			break;
+		}
+	}
+	for (int i = 1; i < BLOCKS; i += 2) {
+		if (blocks[i][0] != i || blocks[i][BLOCK_BYTES - 1] != i) {
+			EGL_DECLARE_ERROR("Block %d was overwritten by its neighbours.", i);
+			break;
+		}
+	}
+	EGL_PoolFree(&p);
+}
+
+
+void EGL_ArenaTest(EGL_TestModule *M) {
+	EGL_DECLARE_MODULE(EGL_arena);
+
+	EGL_RUN_TEST(EGL_ArenaAllocTest);
+	EGL_RUN_TEST(EGL_PoolAllocTest);
+}
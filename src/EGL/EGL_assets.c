@@ -0,0 +1,309 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <EGL/EGL_assets.h>
+#include <EGL/EGL_parallel.h>
+#include <EGL/EGL_profile.h>
+#include <EGL/EGL_memory.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+
+static uint64_t now_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/* Queues are intrusive lists through EGL_Asset.next, guarded by the loader's lock. */
+static void push(EGL_Asset **head, EGL_Asset **tail, EGL_Asset *asset) {
+	asset->next = NULL;
+	if (*tail) {
+		(*tail)->next = asset;
+	} else {
+		*head = asset;
+	}
+	*tail = asset;
+}
+
+static EGL_Asset *pop(EGL_Asset **head, EGL_Asset **tail) {
+	EGL_Asset *asset = *head;
+	if (asset) {
+		*head = asset->next;
+		*tail = (*head) ? *tail : NULL;
+		asset->next = NULL;
+	}
+	return asset;
+}
+
+static bool read_file(EGL_Asset *asset) {
+	FILE *f = fopen(asset->path, "rb");
+	if (!f) {
+		return false;
+	}
+	long size = -1;
+	if (fseek(f, 0, SEEK_END) == 0) {
+		size = ftell(f);
+	}
+	if (size < 0 || fseek(f, 0, SEEK_SET) != 0) {
+		fclose(f);
+		return false;
+	}
+
+	/* One byte more, so text assets can be terminated in place */
+	char *data = (char *)EGL_malloc((size_t)size + 1);
+	if (!data || fread(data, 1, (size_t)size, f) != (size_t)size) {
+		EGL_free(data);
+		fclose(f);
+		return false;
+	}
+	fclose(f);
+	data[size] = '\0';
+	asset->data = data;
+	asset->size = (size_t)size;
+	return true;
+}
+
+/* Reads files in the order they were queued, so the disk sees one stream at a time. */
+static int io_main(void *arg) {
+	EGL_AssetLoader *l = (EGL_AssetLoader *)arg;
+#ifdef EGL_PROFILE
+	EGL_ProfileThreadName("asset io");
+#endif
+	mtx_lock(&l->lock);
+	while (true) {
+		while (!l->read_head && !l->stopping) {
+			cnd_wait(&l->read_ready, &l->lock);
+		}
+		if (l->stopping) {
+			break;
+		}
+		EGL_Asset *asset = pop(&l->read_head, &l->read_tail);
+		asset->state = EGL_ASSET_READING;
+		mtx_unlock(&l->lock);
+
+		const uint64_t begin = now_ns();
+		bool ok = false;
+		EGL_PROFILE_SCOPE("read asset") {
+			ok = read_file(asset);
+		}
+		asset->read_ns = now_ns() - begin;
+
+		mtx_lock(&l->lock);
+		if (ok) {
+			asset->state = EGL_ASSET_DECODING;
+			push(&l->decode_head, &l->decode_tail, asset);
+			cnd_signal(&l->decode_ready);
+		} else {
+			asset->state = EGL_ASSET_FAILED;
+			asset->wait_ns = now_ns();
+			push(&l->done_head, &l->done_tail, asset);
+			cnd_signal(&l->done_ready);
+		}
+	}
+	mtx_unlock(&l->lock);
+	return 0;
+}
+
+static int decode_main(void *arg) {
+	EGL_AssetLoader *l = (EGL_AssetLoader *)arg;
+#ifdef EGL_PROFILE
+	EGL_ProfileThreadName("asset decode");
+#endif
+	mtx_lock(&l->lock);
+	while (true) {
+		while (!l->decode_head && !l->stopping) {
+			cnd_wait(&l->decode_ready, &l->lock);
+		}
+		if (l->stopping) {
+			break;
+		}
+		EGL_Asset *asset = pop(&l->decode_head, &l->decode_tail);
+		mtx_unlock(&l->lock);
+
+		const uint64_t begin = now_ns();
+		bool ok = true;
+		if (asset->decode) {
+			EGL_PROFILE_SCOPE("decode asset") {
+				ok = asset->decode(asset);
+			}
+		}
+		const uint64_t end = now_ns();
+		asset->decode_ns = end - begin;
+		asset->wait_ns = end;
+
+		mtx_lock(&l->lock);
+		asset->state = ok ? EGL_ASSET_LOADED : EGL_ASSET_FAILED;
+		push(&l->done_head, &l->done_tail, asset);
+		cnd_signal(&l->done_ready);
+	}
+	mtx_unlock(&l->lock);
+	return 0;
+}
+
+/* Run one asset's done function. Call without the lock. */
+static void finish(EGL_AssetLoader *l, EGL_Asset *asset) {
+	asset->wait_ns = now_ns() - asset->wait_ns;
+	asset->finished = true;
+	l->unfinished--;
+	if (asset->done) {
+		EGL_PROFILE_SCOPE("finish asset") {
+			asset->done(asset);
+		}
+	}
+}
+
+static void stop(EGL_AssetLoader *l) {
+	mtx_lock(&l->lock);
+	l->stopping = true;
+	cnd_broadcast(&l->read_ready);
+	cnd_broadcast(&l->decode_ready);
+	mtx_unlock(&l->lock);
+	thrd_join(l->io, NULL);
+	for (int i = 0; i < l->decoder_count; i++) {
+		thrd_join(l->decoders[i], NULL);
+	}
+}
+
+static void destroy(EGL_AssetLoader *l) {
+	cnd_destroy(&l->read_ready);
+	cnd_destroy(&l->decode_ready);
+	cnd_destroy(&l->done_ready);
+	mtx_destroy(&l->lock);
+	memset(l, 0, sizeof(*l));
+}
+
+static void reset(EGL_AssetLoader *l, EGL_Asset *asset, const void *data, size_t size, bool borrowed) {
+	asset->data = (void *)data;
+	asset->size = size;
+	asset->borrowed = borrowed;
+	asset->result = NULL;
+	asset->finished = false;
+	asset->queued_ns = now_ns();
+	asset->read_ns = asset->decode_ns = asset->wait_ns = 0;
+	l->unfinished++;
+}
+
+
+bool EGL_AssetLoaderInit(EGL_AssetLoader *l, int decoders) {
+	memset(l, 0, sizeof(*l));
+	decoders = (decoders < 1) ? EGL_ThreadCount() : decoders;
+	decoders = (decoders > EGL_ASSET_DECODERS_MAX) ? EGL_ASSET_DECODERS_MAX : decoders;
+
+	if (mtx_init(&l->lock, mtx_plain) != thrd_success) {
+		return false;
+	}
+	cnd_init(&l->read_ready);
+	cnd_init(&l->decode_ready);
+	cnd_init(&l->done_ready);
+
+	if (thrd_create(&l->io, io_main, l) != thrd_success) {
+		destroy(l);
+		return false;
+	}
+	for (int i = 0; i < decoders; i++) {
+		if (thrd_create(&l->decoders[l->decoder_count], decode_main, l) == thrd_success) {
+			l->decoder_count++;
+		}
+	}
+	if (!l->decoder_count) {
+		stop(l);
+		destroy(l);
+		return false;
+	}
+	return true;
+}
+
+void EGL_AssetLoaderFree(EGL_AssetLoader *l) {
+	if (!l->decoder_count) {
+		return; // Never started, or already freed
+	}
+	stop(l);
+
+	EGL_Asset *asset;
+	while ((asset = pop(&l->read_head, &l->read_tail)) || (asset = pop(&l->decode_head, &l->decode_tail))) {
+		EGL_AssetFree(asset);
+		asset->state = EGL_ASSET_FAILED;
+	}
+	destroy(l);
+}
+
+void EGL_AssetLoad(EGL_AssetLoader *l, EGL_Asset *asset) {
+	reset(l, asset, NULL, 0, false);
+
+	mtx_lock(&l->lock);
+	asset->state = EGL_ASSET_QUEUED;
+	push(&l->read_head, &l->read_tail, asset);
+	cnd_signal(&l->read_ready);
+	mtx_unlock(&l->lock);
+}
+
+void EGL_AssetLoadMemory(EGL_AssetLoader *l, EGL_Asset *asset, const void *data, size_t size) {
+	reset(l, asset, data, size, true);
+
+	mtx_lock(&l->lock);
+	asset->state = EGL_ASSET_DECODING;
+	push(&l->decode_head, &l->decode_tail, asset);
+	cnd_signal(&l->decode_ready);
+	mtx_unlock(&l->lock);
+}
+
+size_t EGL_AssetPoll(EGL_AssetLoader *l) {
+	mtx_lock(&l->lock);
+	EGL_Asset *ready = l->done_head;
+	l->done_head = l->done_tail = NULL;
+	mtx_unlock(&l->lock);
+
+	size_t n = 0;
+	while (ready) {
+		EGL_Asset *next = ready->next;
+		finish(l, ready);
+		ready = next;
+		n++;
+	}
+	return n;
+}
+
+bool EGL_AssetWait(EGL_AssetLoader *l, EGL_Asset *asset) {
+	EGL_AssetPoll(l);
+	while (!asset->finished) {
+		mtx_lock(&l->lock);
+		while (!l->done_head) {
+			cnd_wait(&l->done_ready, &l->lock);
+		}
+		mtx_unlock(&l->lock);
+		EGL_AssetPoll(l);
+	}
+	return asset->state == EGL_ASSET_LOADED;
+}
+
+bool EGL_AssetWaitAll(EGL_AssetLoader *l) {
+	bool ok = true;
+	while (l->unfinished) {
+		mtx_lock(&l->lock);
+		while (!l->done_head) {
+			cnd_wait(&l->done_ready, &l->lock);
+		}
+		EGL_Asset *ready = l->done_head;
+		l->done_head = l->done_tail = NULL;
+		mtx_unlock(&l->lock);
+
+		while (ready) {
+			EGL_Asset *next = ready->next;
+			ok = ok && ready->state == EGL_ASSET_LOADED;
+			finish(l, ready);
+			ready = next;
+		}
+	}
+	return ok;
+}
+
+void EGL_AssetFree(EGL_Asset *asset) {
+	if (!asset->borrowed) {
+		EGL_free(asset->data);
+	}
+	asset->data = NULL;
+	asset->size = 0;
+}
@@ -0,0 +1,126 @@
+#include <EGL/EGL_bench.h>
+#include <EGL/EGL_assets.h>
+
+#include <stdlib.h>
+
+
+#define FILES 16
+#define FILE_BYTES (1 << 20)
+#define DECODE_PASSES 8    // Checksum passes over each file, standing in for parsing and building structures.
+#define DEVICE_MS 40       // Main thread blocked creating the window and device.
+#define PATH_FORMAT "EGL_assets_bench_%d.bin"
+
+
+static uint32_t lcg(uint32_t *state) {
+	*state = *state * 1664525u + 1013904223u;
+	return *state >> 8;
+}
+
+static bool decode(EGL_Asset *asset) {
+	const uint8_t *bytes = (const uint8_t *)asset->data;
+	uint32_t sum = 2166136261u;
+	for (int pass = 0; pass < DECODE_PASSES; pass++) {
+		for (size_t i = 0; i < asset->size; i++) {
+			sum = (sum ^ bytes[i]) * 16777619u;
+		}
+	}
+	EGL_BENCH_SINK += sum;
+	EGL_AssetFree(asset);
+	return true;
+}
+
+/* Window and device creation mostly waits on the driver and compositor, so it sleeps rather than spins */
+static void create_device(void) {
+	thrd_sleep(&(struct timespec){ .tv_nsec = DEVICE_MS * 1000000L }, NULL);
+}
+
+static bool read_whole(const char *path, EGL_Asset *asset) {
+	FILE *f = fopen(path, "rb");
+	if (!f) {
+		return false;
+	}
+	asset->data = malloc(FILE_BYTES);
+	asset->size = asset->data ? fread(asset->data, 1, FILE_BYTES, f) : 0;
+	fclose(f);
+	return asset->data != NULL;
+}
+
+static void startup_serial(char paths[FILES][64], EGL_Asset *assets) {
+	for (int i = 0; i < FILES; i++) {
+		if (read_whole(paths[i], &assets[i])) {
+			decode(&assets[i]);
+		}
+	}
+	create_device();
+}
+
+static void startup_async(EGL_AssetLoader *l, char paths[FILES][64], EGL_Asset *assets) {
+	for (int i = 0; i < FILES; i++) {
+		assets[i] = (EGL_Asset){ .path = paths[i], .decode = decode };
+		EGL_AssetLoad(l, &assets[i]);
+	}
+	create_device();
+	EGL_AssetWaitAll(l);
+}
+
+
+void EGL_AssetsBench(void) {
+	EGL_DECLARE_BENCH(EGL_assets);
+
+	char paths[FILES][64];
+	EGL_Asset assets[FILES] = { 0 };
+	uint8_t *bytes = (uint8_t *)malloc(FILE_BYTES);
+	if (!bytes) {
+		printf(" failed to allocate\n");
+		return;
+	}
+	uint32_t state = 45;
+	for (int i = 0; i < FILES; i++) {
+		snprintf(paths[i], sizeof(paths[i]), PATH_FORMAT, i);
+		for (int b = 0; b < FILE_BYTES; b++) {
+			bytes[b] = (uint8_t)lcg(&state);
+		}
+		FILE *f = fopen(paths[i], "wb");
+		const bool written = f && fwrite(bytes, 1, FILE_BYTES, f) == FILE_BYTES;
+		if (f) {
+			fclose(f);
+		}
+		if (!written) {
+			printf(" failed to write %s\n", paths[i]);
+			free(bytes);
+			return;
+		}
+	}
+	free(bytes);
+
+	EGL_AssetLoader loader;
+	if (!EGL_AssetLoaderInit(&loader, 0)) {
+		printf(" failed to start the loader\n");
+		return;
+	}
+
+#define RUN(name, ...) do { \
+		double best = 1e30; \
+		for (int r = 0; r < EGL_BENCH_REPEATS; r++) { \
+			double begin = EGL_BenchNow(); \
+			__VA_ARGS__; \
+			double elapsed = EGL_BenchNow() - begin; \
+			best = (elapsed < best) ? elapsed : best; \
+		} \
+		EGL_BenchReport(name, best, (double)FILES * FILE_BYTES, "B"); \
+	} while (0)
+
+	/*
+	 * Warm startup: the files were just written, so they are in the page
+	 * cache. A cold run needs the cache dropped between repeats, which takes
+	 * root; there the I/O thread's reads overlap the device wait as well.
+	 */
+	RUN("startup, load then create device", startup_serial(paths, assets));
+	RUN("startup, load during device creation", startup_async(&loader, paths, assets));
+#undef RUN
+
+	EGL_AssetLoaderFree(&loader);
+	for (int i = 0; i < FILES; i++) {
+		remove(paths[i]);
+	}
+}
@@ -0,0 +1,197 @@
+#include <EGL/EGL_testing.h>
+#include <EGL/EGL_parallel.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+#define FILES 12
+#define FILE_BYTES 5000 // Plus 100 per file, so each has its own size.
+#define PATH_FORMAT "EGL_assets_test_%d.bin"
+#define MISSING_PATH "EGL_assets_test_missing.bin"
+
+
+typedef struct {
+	thrd_t main;
+	int done_count;
+	int wrong_thread;
+	uint32_t sums[FILES];
+} Shared;
+
+
+static uint32_t checksum(const uint8_t *data, size_t size) {
+	uint32_t sum = 2166136261u;
+	for (size_t i = 0; i < size; i++) {
+		sum = (sum ^ data[i]) * 16777619u;
+	}
+	return sum;
+}
+
+static bool write_file(const char *path, int index) {
+	FILE *f = fopen(path, "wb");
+	if (!f) {
+		return false;
+	}
+	const int size = FILE_BYTES + 100 * index;
+	for (int i = 0; i < size; i++) {
+		fputc((i * 7 + index) & 0xff, f);
+	}
+	return fclose(f) == 0;
+}
+
+/* Replace the bytes with their checksum, as a decoder that needs nothing else would */
+static bool decode_sum(EGL_Asset *asset) {
+	uint32_t *sum = (uint32_t *)malloc(sizeof(uint32_t));
+	if (!sum) {
+		return false;
+	}
+	*sum = checksum((const uint8_t *)asset->data, asset->size);
+	asset->result = sum;
+	EGL_AssetFree(asset);
+	return true;
+}
+
+static bool decode_reject(EGL_Asset *asset) {
+	return false;
+}
+
+static void done(EGL_Asset *asset) {
+	Shared *s = (Shared *)asset->user;
+	s->done_count++;
+	s->wrong_thread += !thrd_equal(thrd_current(), s->main);
+}
+
+
+/**
+ * Every queued file is read, decoded on a worker and finished on the main
+ * thread exactly once, with the same bytes a plain read gets.
+ */
+static void EGL_AssetLoadTest(EGL_Test *T) {
+	EGL_DECLARE_TEST;
+
+	Shared s = { .main = thrd_current() };
+	char paths[FILES][64];
+	for (int i = 0; i < FILES; i++) {
+		snprintf(paths[i], sizeof(paths[i]), PATH_FORMAT, i);
+		if (!write_file(paths[i], i)) {
+			EGL_DECLARE_ERROR("Failed to write %s.", paths[i]);
+			return;
+		}
+		uint8_t bytes[FILE_BYTES + 100 * FILES];
+		for (int b = 0; b < FILE_BYTES + 100 * i; b++) {
+			bytes[b] = (uint8_t)((b * 7 + i) & 0xff);
+		}
+		s.sums[i] = checksum(bytes, FILE_BYTES + 100 * i);
+	}
+
+	EGL_AssetLoader l;
+	if (!EGL_AssetLoaderInit(&l, 3)) {
+		EGL_DECLARE_ERROR("Failed to start a loader with %d decoders.", 3);
+		return;
+	}
+	EGL_Asset assets[FILES];
+	for (int i = 0; i < FILES; i++) {
+		assets[i] = (EGL_Asset){ .path = paths[i], .decode = decode_sum, .done = done, .user = &s };
+		EGL_AssetLoad(&l, &assets[i]);
+	}
+
+	/* Wait for one in the middle, then the rest */
+	const int middle = FILES / 2;
+	if (!EGL_AssetWait(&l, &assets[middle]) || !assets[middle].finished) {
+		EGL_DECLARE_ERROR("Waiting for asset %d left it in state %d.", middle, (int)assets[middle].state);
+	}
+	if (!EGL_AssetWaitAll(&l) || l.unfinished != 0) {
+		EGL_DECLARE_ERROR("Waiting for all assets left %u unfinished.", l.unfinished);
+	}
+	if (s.done_count != FILES || s.wrong_thread != 0) {
+		EGL_DECLARE_ERROR("Expected %d done calls on the main thread, got %d with %d elsewhere.", FILES, s.done_count, s.wrong_thread);
+	}
+	for (int i = 0; i < FILES; i++) {
+		const uint32_t *sum = (const uint32_t *)assets[i].result;
+		if (assets[i].state != EGL_ASSET_LOADED || !sum || *sum != s.sums[i] || assets[i].data) {
+			EGL_DECLARE_ERROR("Asset %d decoded to the wrong checksum or kept its bytes.", i);
+		}
+		free(assets[i].result);
+		remove(paths[i]);
+	}
+	EGL_AssetLoaderFree(&l);
+}
+
+/**
+ * A missing file and a failed decode both finish as failed, and an asset
+ * without a decode function keeps its bytes, terminated.
+ */
+static void EGL_AssetFailTest(EGL_Test *T) {
+	EGL_DECLARE_TEST;
+
+	Shared s = { .main = thrd_current() };
+	char path[64];
+	snprintf(path, sizeof(path), PATH_FORMAT, 0);
+	if (!write_file(path, 0)) {
+		EGL_DECLARE_ERROR("Failed to write %s.", path);
+		return;
+	}
+	remove(MISSING_PATH);
+
+	EGL_AssetLoader l;
+	if (!EGL_AssetLoaderInit(&l, 0)) {
+		EGL_DECLARE_ERROR("Failed to start a loader with %d decoders.", EGL_ThreadCount());
+		return;
+	}
+	EGL_Asset missing = { .path = MISSING_PATH, .decode = decode_sum, .done = done, .user = &s };
+	EGL_Asset rejected = { .path = path, .decode = decode_reject, .done = done, .user = &s };
+	EGL_Asset raw = { .path = path, .done = done, .user = &s };
+	EGL_AssetLoad(&l, &missing);
+	EGL_AssetLoad(&l, &rejected);
+	EGL_AssetLoad(&l, &raw);
+
+	if (EGL_AssetWaitAll(&l)) {
+		EGL_DECLARE_ERROR("Waiting for %d assets, two of them failing, reported success.", 3);
+	}
+	if (missing.state != EGL_ASSET_FAILED || missing.data || rejected.state != EGL_ASSET_FAILED || s.done_count != 3) {
+		EGL_DECLARE_ERROR("Failed assets ended in states %d and %d after %d done calls.", (int)missing.state, (int)rejected.state, s.done_count);
+	}
+	if (raw.state != EGL_ASSET_LOADED || raw.size != FILE_BYTES || !raw.data || ((const char *)raw.data)[raw.size] != '\0') {
+		EGL_DECLARE_ERROR("An asset without a decoder loaded %zu bytes.", raw.size);
+	}
+	if (EGL_AssetPoll(&l) != 0) {
+		EGL_DECLARE_ERROR("Polling a drained loader finished %s assets.", "more");
+	}
+	EGL_AssetFree(&rejected);
+	EGL_AssetFree(&raw);
+	EGL_AssetLoaderFree(&l);
+	remove(path);
+}
+
+/**
+ * Bytes already in memory go straight to the decoders, and freeing the asset
+ * leaves them alone.
+ */
+static void EGL_AssetMemoryTest(EGL_Test *T) {
+	EGL_DECLARE_TEST;
+
+	Shared s = { .main = thrd_current() };
+	static const uint8_t bytes[] = "not read from any file";
+	EGL_AssetLoader l;
+	if (!EGL_AssetLoaderInit(&l, 1)) {
+		EGL_DECLARE_ERROR("Failed to start a loader with %d decoders.", 1);
+		return;
+	}
+	EGL_Asset view = { .path = "in memory", .decode = decode_sum, .done = done, .user = &s };
+	EGL_AssetLoadMemory(&l, &view, bytes, sizeof(bytes));
+
+	const uint32_t *sum = EGL_AssetWait(&l, &view) ? (const uint32_t *)view.result : NULL;
+	if (!sum || *sum != checksum(bytes, sizeof(bytes)) || view.data || s.done_count != 1 || s.wrong_thread) {
+		EGL_DECLARE_ERROR("A view of %zu bytes decoded in state %d.", sizeof(bytes), (int)view.state);
+	}
+	free(view.result);
+	EGL_AssetLoaderFree(&l);
+}
+
+
+void EGL_AssetsTest(EGL_TestModule *M) {
+	EGL_DECLARE_MODULE(EGL_assets);
+
+	EGL_RUN_TEST(EGL_AssetLoadTest);
+	EGL_RUN_TEST(EGL_AssetFailTest);
+	EGL_RUN_TEST(EGL_AssetMemoryTest);
+}
@@ -0,0 +1,38 @@
+#include <EGL/EGL_bench.h>
+
+
+/**
+ * Run every benchmark module, or only those whose name contains argv[1].
+ */
+int main(int argc, char **argv)
+{
+	const char *filter = (argc > 1) ? argv[1] : NULL;
+
+	/*$ BENCHMARKS */
+	EGL_RUN_BENCH(EGL_MeshBench);
+	EGL_RUN_BENCH(EGL_FlowFieldBench);
+	EGL_RUN_BENCH(EGL_SpatialBench);
+	EGL_RUN_BENCH(EGL_TargetBench);
+	EGL_RUN_BENCH(EGL_BvhBench);
+	EGL_RUN_BENCH(EGL_TransformBench);
+	EGL_RUN_BENCH(EGL_TransformRotateBench);
+	EGL_RUN_BENCH(EGL_SnapshotBench);
+	EGL_RUN_BENCH(EGL_HierarchyBench);
+	EGL_RUN_BENCH(EGL_MathBench);
+	EGL_RUN_BENCH(EGL_ApproxBench);
+	EGL_RUN_BENCH(EGL_JobsBench);
+	EGL_RUN_BENCH(EGL_QueueBench);
+	EGL_RUN_BENCH(EGL_ProfileBench);
+	EGL_RUN_BENCH(EGL_FrameStatsBench);
+	EGL_RUN_BENCH(EGL_AllocBench);
+	EGL_RUN_BENCH(EGL_ArenaBench);
+	EGL_RUN_BENCH(EGL_AssetsBench);
+	EGL_RUN_BENCH(EGL_PackBench);
+	EGL_RUN_BENCH(EGL_TextureBench);
+	EGL_RUN_BENCH(EGL_StagingBench);
+	EGL_RUN_BENCH(EGL_InstanceBench);
+	EGL_RUN_BENCH(EGL_RasterBench);
+	/*$ END BENCHMARKS */
+
+	return 0;
+}
@@ -0,0 +1,495 @@
+#include <EGL/EGL_bvh.h>
+#include <EGL/EGL_memory.h>
+
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+
+#define BINS 16
+#define LEAF_MAX 4
+#define STACK_MAX (3 * EGL_BVH_DEPTH_MAX + 1) // Each level pushes at most three siblings.
+
+
+typedef struct {
+	float min[3];
+	float max[3];
+} Box;
+
+typedef struct {
+	uint32_t begin;
+	uint32_t end;
+	Box box;
+} Range;
+
+typedef struct {
+	const Box *boxes;       // [triangle_count] Triangle bounds.
+	const float *centroids; // [triangle_count * 3] Triangle bound centers.
+	uint32_t *order;        // [triangle_count] Triangles in leaf order.
+	EGL_BvhNode *nodes;
+	uint32_t node_count;
+	bool too_deep;
+} Builder;
+
+typedef struct {
+	uint32_t node;
+	float t;
+} StackEntry;
+
+
+/* fminf/fmaxf handle NaN and are library calls without -ffast-math */
+static inline float min_f(float a, float b) {
+	return (a < b) ? a : b;
+}
+
+static inline float max_f(float a, float b) {
+	return (a > b) ? a : b;
+}
+
+static inline void box_empty(Box *b) {
+	b->min[0] = b->min[1] = b->min[2] = FLT_MAX;
+	b->max[0] = b->max[1] = b->max[2] = -FLT_MAX;
+}
+
+static inline void box_grow(Box *b, const Box *other) {
+	for (int a = 0; a < 3; a++) {
+		b->min[a] = min_f(b->min[a], other->min[a]);
+		b->max[a] = max_f(b->max[a], other->max[a]);
+	}
+}
+
+static inline float box_area(const Box *b) {
+	float dx = b->max[0] - b->min[0];
+	float dy = b->max[1] - b->min[1];
+	float dz = b->max[2] - b->min[2];
+	return (dx < 0.0f) ? 0.0f : dx * dy + dy * dz + dz * dx;
+}
+
+static inline void cross(const float a[3], const float b[3], float out[3]) {
+	out[0] = a[1] * b[2] - a[2] * b[1];
+	out[1] = a[2] * b[0] - a[0] * b[2];
+	out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+static inline float dot(const float a[3], const float b[3]) {
+	return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+/*
+ * Split a range in two with a binned surface area heuristic over the
+ * centroids. Returns false if the range should be a leaf.
+ */
+static bool split(Builder *b, const Range *range, Range *left, Range *right) {
+	const uint32_t count = range->end - range->begin;
+	if (count <= LEAF_MAX) {
+		return false;
+	}
+
+	Box centroid_box;
+	box_empty(&centroid_box);
+	for (uint32_t i = range->begin; i < range->end; i++) {
+		const float *c = b->centroids + (size_t)b->order[i] * 3;
+		for (int a = 0; a < 3; a++) {
+			centroid_box.min[a] = min_f(centroid_box.min[a], c[a]);
+			centroid_box.max[a] = max_f(centroid_box.max[a], c[a]);
+		}
+	}
+
+	float best_cost = INFINITY;
+	int best_axis = -1;
+	int best_bin = 0;
+
+	for (int a = 0; a < 3; a++) {
+		float extent = centroid_box.max[a] - centroid_box.min[a];
+		if (!(extent > 0.0f)) {
+			continue;
+		}
+		float scale = (float)BINS / extent;
+
+		Box bin_box[BINS];
+		uint32_t bin_count[BINS] = { 0 };
+		for (int k = 0; k < BINS; k++) {
+			box_empty(&bin_box[k]);
+		}
+		for (uint32_t i = range->begin; i < range->end; i++) {
+			uint32_t t = b->order[i];
+			int k = (int)((b->centroids[(size_t)t * 3 + a] - centroid_box.min[a]) * scale);
+			k = (k >= BINS) ? BINS - 1 : k;
+			bin_count[k]++;
+			box_grow(&bin_box[k], &b->boxes[t]);
+		}
+
+		/* Sweep from the right, then from the left, to cost every split plane */
+		float right_area[BINS];
+		uint32_t right_count[BINS];
+		Box acc;
+		box_empty(&acc);
+		uint32_t n = 0;
+		for (int k = BINS - 1; k > 0; k--) {
+			box_grow(&acc, &bin_box[k]);
+			n += bin_count[k];
+			right_area[k] = box_area(&acc);
+			right_count[k] = n;
+		}
+		box_empty(&acc);
+		n = 0;
+		for (int k = 1; k < BINS; k++) {
+			box_grow(&acc, &bin_box[k - 1]);
+			n += bin_count[k - 1];
+			if (n == 0 || right_count[k] == 0) {
+				continue;
+			}
+			float cost = box_area(&acc) * (float)n + right_area[k] * (float)right_count[k];
+			if (cost < best_cost) {
+				best_cost = cost;
+				best_axis = a;
+				best_bin = k;
+			}
+		}
+	}
+
+	uint32_t mid;
+	if (best_axis < 0) {
+		/* Every centroid coincides: any split is as good as another */
+		mid = range->begin + count / 2;
+	} else {
+		const int a = best_axis;
+		const float scale = (float)BINS / (centroid_box.max[a] - centroid_box.min[a]);
+		uint32_t i = range->begin;
+		uint32_t j = range->end;
+		while (i < j) {
+			uint32_t t = b->order[i];
+			int k = (int)((b->centroids[(size_t)t * 3 + a] - centroid_box.min[a]) * scale);
+			k = (k >= BINS) ? BINS - 1 : k;
+			if (k < best_bin) {
+				i++;
+			} else {
+				b->order[i] = b->order[--j];
+				b->order[j] = t;
+			}
+		}
+		mid = i;
+	}
+
+	left->begin = range->begin;
+	left->end = mid;
+	right->begin = mid;
+	right->end = range->end;
+
+	Range *sides[2] = { left, right };
+	for (int s = 0; s < 2; s++) {
+		box_empty(&sides[s]->box);
+		for (uint32_t i = sides[s]->begin; i < sides[s]->end; i++) {
+			box_grow(&sides[s]->box, &b->boxes[b->order[i]]);
+		}
+	}
+
+	return true;
+}
+
+/* Fill a node with up to four children by repeatedly splitting the largest one. */
+static void build_node(Builder *b, uint32_t node_index, const Range *range, int depth) {
+	if (depth >= EGL_BVH_DEPTH_MAX) {
+		b->too_deep = true;
+		return;
+	}
+
+	Range children[4] = { *range };
+	bool leaf[4] = { false, false, false, false };
+	int n = 1;
+
+	while (n < 4) {
+		int largest = -1;
+		float largest_area = -1.0f;
+		for (int k = 0; k < n; k++) {
+			float area = box_area(&children[k].box);
+			if (!leaf[k] && area > largest_area) {
+				largest = k;
+				largest_area = area;
+			}
+		}
+		if (largest < 0) {
+			break;
+		}
+
+		Range left, right;
+		if (!split(b, &children[largest], &left, &right)) {
+			leaf[largest] = true;
+			continue;
+		}
+		children[largest] = left;
+		children[n++] = right;
+	}
+
+	uint32_t inner[4];
+	int inner_count = 0;
+	EGL_BvhNode *node = &b->nodes[node_index];
+	for (int k = 0; k < 4; k++) {
+		if (k >= n) {
+			node->min_x[k] = node->min_y[k] = node->min_z[k] = 0.0f;
+			node->max_x[k] = node->max_y[k] = node->max_z[k] = 0.0f;
+			node->child[k] = EGL_BVH_EMPTY;
+			node->count[k] = 0;
+			continue;
+		}
+
+		const Box *box = &children[k].box;
+		node->min_x[k] = box->min[0];
+		node->min_y[k] = box->min[1];
+		node->min_z[k] = box->min[2];
+		node->max_x[k] = box->max[0];
+		node->max_y[k] = box->max[1];
+		node->max_z[k] = box->max[2];
+
+		uint32_t count = children[k].end - children[k].begin;
+		if (count <= LEAF_MAX) {
+			node->child[k] = EGL_BVH_LEAF | children[k].begin;
+			node->count[k] = count;
+		} else {
+			node->child[k] = b->node_count++;
+			node->count[k] = 0;
+			inner[inner_count++] = (uint32_t)k;
+		}
+	}
+
+	for (int i = 0; i < inner_count; i++) {
+		uint32_t k = inner[i];
+		build_node(b, b->nodes[node_index].child[k], &children[k], depth + 1);
+	}
+}
+
+/* Möller-Trumbore against a triangle stored as corner and edges. */
+static inline bool intersect(const float *tri, const float o[3], const float d[3], float *t, float *u, float *v) {
+	const float *v0 = tri;
+	const float *e1 = tri + 3;
+	const float *e2 = tri + 6;
+
+	float p[3];
+	cross(d, e2, p);
+	float det = dot(e1, p);
+	if (det == 0.0f) {
+		return false;
+	}
+	float inv = 1.0f / det;
+
+	float s[3] = { o[0] - v0[0], o[1] - v0[1], o[2] - v0[2] };
+	*u = dot(s, p) * inv;
+	if (*u < 0.0f || *u > 1.0f) {
+		return false;
+	}
+
+	float q[3];
+	cross(s, e1, q);
+	*v = dot(d, q) * inv;
+	if (*v < 0.0f || *u + *v > 1.0f) {
+		return false;
+	}
+
+	*t = dot(e2, q) * inv;
+	return *t >= 0.0f;
+}
+
+static void intersect_leaf(const EGL_Bvh *bvh, uint32_t first, uint32_t count, const float o[3], const float d[3], EGL_BvhHit *best) {
+	for (uint32_t i = first; i < first + count; i++) {
+		float t, u, v;
+		if (!intersect(bvh->triangles + (size_t)i * 9, o, d, &t, &u, &v)) {
+			continue;
+		}
+		uint32_t id = bvh->ids[i];
+		if (t < best->t || (t == best->t && id < best->triangle)) {
+			best->t = t;
+			best->u = u;
+			best->v = v;
+			best->triangle = id;
+		}
+	}
+}
+
+/* Slab test against the four children. Returns a lane mask and the entry distances. */
+static inline int test_children(const EGL_BvhNode *node, const float o[3], const float inv[3], float t_max, float t_near[4]) {
+#ifdef __SSE2__
+	const __m128 ox = _mm_set1_ps(o[0]), oy = _mm_set1_ps(o[1]), oz = _mm_set1_ps(o[2]);
+	const __m128 ix = _mm_set1_ps(inv[0]), iy = _mm_set1_ps(inv[1]), iz = _mm_set1_ps(inv[2]);
+
+	__m128 t1x = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node->min_x), ox), ix);
+	__m128 t2x = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node->max_x), ox), ix);
+	__m128 t1y = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node->min_y), oy), iy);
+	__m128 t2y = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node->max_y), oy), iy);
+	__m128 t1z = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node->min_z), oz), iz);
+	__m128 t2z = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node->max_z), oz), iz);
+
+	__m128 enter = _mm_max_ps(_mm_max_ps(_mm_min_ps(t1x, t2x), _mm_min_ps(t1y, t2y)), _mm_max_ps(_mm_min_ps(t1z, t2z), _mm_setzero_ps()));
+	__m128 exit = _mm_min_ps(_mm_min_ps(_mm_max_ps(t1x, t2x), _mm_max_ps(t1y, t2y)), _mm_min_ps(_mm_max_ps(t1z, t2z), _mm_set1_ps(t_max)));
+
+	_mm_storeu_ps(t_near, enter);
+	return _mm_movemask_ps(_mm_cmple_ps(enter, exit));
+#else
+	int mask = 0;
+	for (int k = 0; k < 4; k++) {
+		float t1x = (node->min_x[k] - o[0]) * inv[0], t2x = (node->max_x[k] - o[0]) * inv[0];
+		float t1y = (node->min_y[k] - o[1]) * inv[1], t2y = (node->max_y[k] - o[1]) * inv[1];
+		float t1z = (node->min_z[k] - o[2]) * inv[2], t2z = (node->max_z[k] - o[2]) * inv[2];
+		float enter = max_f(max_f(min_f(t1x, t2x), min_f(t1y, t2y)), max_f(min_f(t1z, t2z), 0.0f));
+		float exit = min_f(min_f(max_f(t1x, t2x), max_f(t1y, t2y)), min_f(max_f(t1z, t2z), t_max));
+		t_near[k] = enter;
+		mask |= (enter <= exit) << k;
+	}
+	return mask;
+#endif
+}
+
+
+bool EGL_BvhBuild(EGL_Bvh *bvh, const uint32_t *indices, uint32_t index_count, const float *vertices, uint32_t vertex_count) {
+	memset(bvh, 0, sizeof(*bvh));
+
+	const uint32_t n = index_count / 3;
+	for (uint32_t i = 0; i < n * 3; i++) {
+		if (indices[i] >= vertex_count) {
+			return false;
+		}
+	}
+
+	Builder b = { 0 };
+	Box *boxes = (Box *)EGL_malloc(sizeof(Box) * (n ? n : 1));
+	float *centroids = (float *)EGL_malloc(sizeof(float) * 3 * (n ? n : 1));
+	b.order = (uint32_t *)EGL_malloc(sizeof(uint32_t) * (n ? n : 1));
+	bvh->nodes = (EGL_BvhNode *)EGL_malloc(sizeof(EGL_BvhNode) * ((size_t)n + 1));
+	bvh->triangles = (float *)EGL_malloc(sizeof(float) * 9 * (n ? n : 1));
+	bvh->ids = (uint32_t *)EGL_malloc(sizeof(uint32_t) * (n ? n : 1));
+	if (!boxes || !centroids || !b.order || !bvh->nodes || !bvh->triangles || !bvh->ids) {
+		EGL_free(boxes);
+		EGL_free(centroids);
+		EGL_free(b.order);
+		EGL_BvhFree(bvh);
+		return false;
+	}
+
+	Range root = { .begin = 0, .end = n };
+	box_empty(&root.box);
+	for (uint32_t t = 0; t < n; t++) {
+		box_empty(&boxes[t]);
+		for (int c = 0; c < 3; c++) {
+			const float *p = vertices + (size_t)indices[t * 3 + c] * 3;
+			for (int a = 0; a < 3; a++) {
+				boxes[t].min[a] = min_f(boxes[t].min[a], p[a]);
+				boxes[t].max[a] = max_f(boxes[t].max[a], p[a]);
+			}
+		}
+		for (int a = 0; a < 3; a++) {
+			centroids[t * 3 + a] = 0.5f * (boxes[t].min[a] + boxes[t].max[a]);
+		}
+		box_grow(&root.box, &boxes[t]);
+		b.order[t] = t;
+	}
+
+	b.boxes = boxes;
+	b.centroids = centroids;
+	b.nodes = bvh->nodes;
+	b.node_count = 1;
+	build_node(&b, 0, &root, 0);
+
+	EGL_free(boxes);
+	EGL_free(centroids);
+
+	if (b.too_deep) {
+		EGL_free(b.order);
+		EGL_BvhFree(bvh);
+		return false;
+	}
+
+	/* Store triangles in leaf order as corner and edges, ready for intersection */
+	for (uint32_t i = 0; i < n; i++) {
+		uint32_t t = b.order[i];
+		const float *v0 = vertices + (size_t)indices[t * 3 + 0] * 3;
+		const float *v1 = vertices + (size_t)indices[t * 3 + 1] * 3;
+		const float *v2 = vertices + (size_t)indices[t * 3 + 2] * 3;
+		float *tri = bvh->triangles + (size_t)i * 9;
+		for (int a = 0; a < 3; a++) {
+			tri[a] = v0[a];
+			tri[3 + a] = v1[a] - v0[a];
+			tri[6 + a] = v2[a] - v0[a];
+		}
+		bvh->ids[i] = t;
+	}
+	EGL_free(b.order);
+
+	bvh->node_count = b.node_count;
+	bvh->triangle_count = n;
+	return true;
+}
+
+void EGL_BvhFree(EGL_Bvh *bvh) {
+	EGL_free(bvh->nodes);
+	EGL_free(bvh->triangles);
+	EGL_free(bvh->ids);
+	memset(bvh, 0, sizeof(*bvh));
+}
+
+bool EGL_BvhRaycast(const EGL_Bvh *bvh, const float origin[3], const float direction[3], float t_max, EGL_BvhHit *hit) {
+	/* Keep inverse directions finite so empty slabs never produce 0 * inf */
+	float inv[3];
+	for (int a = 0; a < 3; a++) {
+		float d = direction[a];
+		inv[a] = 1.0f / ((fabsf(d) > 1e-30f) ? d : copysignf(1e-30f, d));
+	}
+
+	EGL_BvhHit best = { .t = t_max, .u = 0.0f, .v = 0.0f, .triangle = EGL_BVH_EMPTY };
+	StackEntry stack[STACK_MAX];
+	int top = 0;
+	stack[top++] = (StackEntry){ 0, 0.0f };
+
+	while (top > 0) {
+		StackEntry entry = stack[--top];
+		if (entry.t > best.t) {
+			continue;
+		}
+
+		const EGL_BvhNode *node = &bvh->nodes[entry.node];
+		float t_near[4];
+		int mask = test_children(node, origin, inv, best.t, t_near);
+
+		/* Push inner children farthest first so the nearest is traversed next */
+		StackEntry pending[4];
+		int pending_count = 0;
+		for (int k = 0; k < 4; k++) {
+			if (!(mask & (1 << k)) || node->child[k] == EGL_BVH_EMPTY) {
+				continue;
+			}
+			if (node->child[k] & EGL_BVH_LEAF) {
+				intersect_leaf(bvh, node->child[k] & ~EGL_BVH_LEAF, node->count[k], origin, direction, &best);
+				continue;
+			}
+			int i = pending_count++;
+			while (i > 0 && pending[i - 1].t < t_near[k]) {
+				pending[i] = pending[i - 1];
+				i--;
+			}
+			pending[i] = (StackEntry){ node->child[k], t_near[k] };
+		}
+		for (int i = 0; i < pending_count; i++) {
+			stack[top++] = pending[i];
+		}
+	}
+
+	if (best.triangle == EGL_BVH_EMPTY) {
+		return false;
+	}
+	*hit = best;
+	return true;
+}
+
+void EGL_BvhInterpolate(const EGL_BvhHit *hit, const uint32_t *indices, const float *attributes, int components, float *out) {
+	const float *a0 = attributes + (size_t)indices[hit->triangle * 3 + 0] * components;
+	const float *a1 = attributes + (size_t)indices[hit->triangle * 3 + 1] * components;
+	const float *a2 = attributes + (size_t)indices[hit->triangle * 3 + 2] * components;
+	const float w = 1.0f - hit->u - hit->v;
+
+	for (int c = 0; c < components; c++) {
+		out[c] = w * a0[c] + hit->u * a1[c] + hit->v * a2[c];
+	}
+}
@@ -0,0 +1,94 @@
+#include <EGL/EGL_bench.h>
+#include <EGL/EGL_bvh.h>
+#include <EGL/EGL_mesh.h>
+
+#include <math.h>
+#include <stdlib.h>
+
+
+#define LEVEL_MIN 4
+#define LEVEL_MAX 8
+#define RAYS 100000
+
+
+static uint32_t lcg(uint32_t *state) {
+	*state = *state * 1664525u + 1013904223u;
+	return *state >> 8;
+}
+
+/* Rays from a camera distance towards random points near the planet (about 60% hit). */
+static void random_rays(uint32_t count, float *origins, float *directions) {
+	uint32_t state = 30;
+	for (uint32_t r = 0; r < count; r++) {
+		float *o = origins + r * 3;
+		float *d = directions + r * 3;
+		o[0] = 2.0f * ((float)lcg(&state) / 16777216.0f) - 1.0f;
+		o[1] = 2.0f * ((float)lcg(&state) / 16777216.0f) - 1.0f;
+		o[2] = 3.0f;
+		for (int a = 0; a < 3; a++) {
+			d[a] = 2.4f * ((float)lcg(&state) / 16777216.0f) - 1.2f - o[a];
+		}
+	}
+}
+
+
+void EGL_BvhBench(void) {
+	EGL_DECLARE_BENCH(EGL_bvh);
+
+	char label[64];
+	float *origins = (float *)malloc(sizeof(float) * 3 * RAYS);
+	float *directions = (float *)malloc(sizeof(float) * 3 * RAYS);
+	random_rays(RAYS, origins, directions);
+
+	for (int level = LEVEL_MIN; level <= LEVEL_MAX; level++) {
+		float *vertices = NULL;
+		uint32_t *indices = NULL;
+		uint32_t vertex_count = 0;
+		uint32_t index_count = 0;
+		if (!EGL_MeshIcosphere(level, &vertices, &vertex_count, &indices, &index_count)) {
+			printf(" level %d: failed to generate icosphere\n", level);
+			break;
+		}
+
+		EGL_Bvh bvh;
+		double best = 1e30;
+		for (int r = 0; r < EGL_BENCH_REPEATS; r++) {
+			double begin = EGL_BenchNow();
+			bool ok = EGL_BvhBuild(&bvh, indices, index_count, vertices, vertex_count);
+			double elapsed = EGL_BenchNow() - begin;
+			best = (elapsed < best) ? elapsed : best;
+			if (!ok) {
+				printf(" level %d: failed to build BVH\n", level);
+				break;
+			}
+			if (r + 1 < EGL_BENCH_REPEATS) {
+				EGL_BvhFree(&bvh);
+			}
+		}
+		snprintf(label, sizeof(label), "build level %d (%u tris)", level, index_count / 3);
+		EGL_BenchReport(label, best, (double)(index_count / 3), "tri");
+
+		best = 1e30;
+		uint64_t hits = 0;
+		for (int r = 0; r < EGL_BENCH_REPEATS; r++) {
+			hits = 0;
+			double begin = EGL_BenchNow();
+			for (uint32_t i = 0; i < RAYS; i++) {
+				EGL_BvhHit hit;
+				hits += EGL_BvhRaycast(&bvh, origins + i * 3, directions + i * 3, INFINITY, &hit);
+			}
+			double elapsed = EGL_BenchNow() - begin;
+			best = (elapsed < best) ? elapsed : best;
+		}
+		EGL_BENCH_SINK += hits;
+		snprintf(label, sizeof(label), "raycast level %d (%.0f%% hit)", level, 100.0 * (double)hits / RAYS);
+		EGL_BenchReport(label, best, (double)RAYS, "ray");
+
+		EGL_BvhFree(&bvh);
+		EGL_free(vertices);
+		EGL_free(indices);
+	}
+
+	free(origins);
+	free(directions);
+}
@@ -0,0 +1,166 @@
+#include <EGL/EGL_testing.h>
+#include <math.h>
+#include <stdlib.h>
+
+
+#define LEVEL 4 // 5120 triangles.
+#define RAYS 2000
+
+
+/* Same arithmetic as the BVH so hits compare exactly. */
+static bool brute_intersect(const float *v0, const float *v1, const float *v2, const float o[3], const float d[3], float *t) {
+	float e1[3] = { v1[0] - v0[0], v1[1] - v0[1], v1[2] - v0[2] };
+	float e2[3] = { v2[0] - v0[0], v2[1] - v0[1], v2[2] - v0[2] };
+	float p[3] = { d[1] * e2[2] - d[2] * e2[1], d[2] * e2[0] - d[0] * e2[2], d[0] * e2[1] - d[1] * e2[0] };
+	float det = e1[0] * p[0] + e1[1] * p[1] + e1[2] * p[2];
+	if (det == 0.0f) {
+		return false;
+	}
+	float inv = 1.0f / det;
+	float s[3] = { o[0] - v0[0], o[1] - v0[1], o[2] - v0[2] };
+	float u = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) * inv;
+	if (u < 0.0f || u > 1.0f) {
+		return false;
+	}
+	float q[3] = { s[1] * e1[2] - s[2] * e1[1], s[2] * e1[0] - s[0] * e1[2], s[0] * e1[1] - s[1] * e1[0] };
+	float v = (d[0] * q[0] + d[1] * q[1] + d[2] * q[2]) * inv;
+	if (v < 0.0f || u + v > 1.0f) {
+		return false;
+	}
+	*t = (e2[0] * q[0] + e2[1] * q[1] + e2[2] * q[2]) * inv;
+	return *t >= 0.0f;
+}
+
+static void random_point(uint32_t *state, float radius, float p[3]) {
+	float r2;
+	do {
+		p[0] = 2.0f * EGL_RandFloat(state) - 1.0f;
+		p[1] = 2.0f * EGL_RandFloat(state) - 1.0f;
+		p[2] = 2.0f * EGL_RandFloat(state) - 1.0f;
+		r2 = p[0] * p[0] + p[1] * p[1] + p[2] * p[2];
+	} while (r2 < 0.01f || r2 > 1.0f);
+	float scale = radius / sqrtf(r2);
+	p[0] *= scale;
+	p[1] *= scale;
+	p[2] *= scale;
+}
+
+
+/**
+ * Ray casts return the same nearest triangle and distance as a brute force
+ * scan, for rays from outside, rays from inside and rays that miss.
+ */
+static void EGL_BvhRaycastTest(EGL_Test *T) {
+	EGL_DECLARE_TEST;
+
+	float *vertices = NULL;
+	uint32_t *indices = NULL;
+	uint32_t vertex_count = 0;
+	uint32_t index_count = 0;
+	EGL_Bvh bvh;
+
+	EGL_MeshIcosphere(LEVEL, &vertices, &vertex_count, &indices, &index_count);
+	if (!EGL_BvhBuild(&bvh, indices, index_count, vertices, vertex_count)) {
+		EGL_DECLARE_ERROR("Failed to build a BVH over %u triangles.", index_count / 3);
+		return;
+	}
+	if (bvh.triangle_count != index_count / 3 || bvh.node_count < 2) {
+		EGL_DECLARE_ERROR("BVH has %u triangles in %u nodes.", bvh.triangle_count, bvh.node_count);
+	}
+
+	uint32_t state[4] = {0,0,0,0};
+	EGL_Seed(state, 30);
+	int hits = 0;
+	int misses = 0;
+
+	for (int r = 0; r < RAYS && T->error_count < ERRORS_MAX - 1; r++) {
+		float o[3], target[3];
+		random_point(state, (r % 4 == 0) ? 0.5f : 3.0f, o);
+		random_point(state, 1.3f * EGL_RandFloat(state) + 0.01f, target);
+		float d[3] = { target[0] - o[0], target[1] - o[1], target[2] - o[2] };
+
+		float best_t = INFINITY;
+		uint32_t best = EGL_BVH_EMPTY;
+		for (uint32_t t = 0; t < index_count / 3; t++) {
+			float hit_t;
+			if (brute_intersect(vertices + indices[t * 3] * 3, vertices + indices[t * 3 + 1] * 3, vertices + indices[t * 3 + 2] * 3, o, d, &hit_t)) {
+				if (hit_t < best_t || (hit_t == best_t && t < best)) {
+					best_t = hit_t;
+					best = t;
+				}
+			}
+		}
+
+		EGL_BvhHit hit;
+		bool found = EGL_BvhRaycast(&bvh, o, d, INFINITY, &hit);
+		if (found != (best != EGL_BVH_EMPTY)) {
+			EGL_DECLARE_ERROR("Ray %d: BVH %s, brute force %s.", r, found ? "hit" : "missed", found ? "missed" : "hit");
+			continue;
+		}
+		if (!found) {
+			misses++;
+			continue;
+		}
+		hits++;
+		if (hit.triangle != best || hit.t != best_t) {
+			EGL_DECLARE_ERROR("Ray %d hit triangle %u at %f, expected %u at %f.", r, hit.triangle, hit.t, best, best_t);
+			continue;
+		}
+
+		/* Interpolated corner positions land on the ray */
+		float p[3];
+		EGL_BvhInterpolate(&hit, indices, vertices, 3, p);
+		for (int a = 0; a < 3; a++) {
+			if (fabsf(p[a] - (o[a] + hit.t * d[a])) > 1e-4f) {
+				EGL_DECLARE_ERROR("Ray %d barycentrics give a point %f off the ray.", r, p[a] - (o[a] + hit.t * d[a]));
+				break;
+			}
+		}
+	}
+
+	if (hits == 0 || misses == 0) {
+		EGL_DECLARE_ERROR("Degenerate rays: %d hits and %d misses.", hits, misses);
+	}
+
+	EGL_BvhFree(&bvh);
+	EGL_free(vertices);
+	EGL_free(indices);
+}
+
+/**
+ * Hits beyond t_max are ignored.
+ */
+static void EGL_BvhRangeTest(EGL_Test *T) {
+	EGL_DECLARE_TEST;
+
+	float *vertices = NULL;
+	uint32_t *indices = NULL;
+	uint32_t vertex_count = 0;
+	uint32_t index_count = 0;
+	EGL_Bvh bvh;
+
+	EGL_MeshIcosphere(LEVEL, &vertices, &vertex_count, &indices, &index_count);
+	EGL_BvhBuild(&bvh, indices, index_count, vertices, vertex_count);
+
+	const float o[3] = { 0.0f, 0.0f, 3.0f };
+	const float d[3] = { 0.0f, 0.0f, -1.0f };
+	EGL_BvhHit hit;
+	if (!EGL_BvhRaycast(&bvh, o, d, INFINITY, &hit) || fabsf(hit.t - 2.0f) > 0.01f) {
+		EGL_DECLARE_ERROR("Ray down the z axis should hit the sphere near t = %f.", 2.0);
+	}
+	if (EGL_BvhRaycast(&bvh, o, d, 1.5f, &hit)) {
+		EGL_DECLARE_ERROR("Ray limited to t = 1.5 hit at t = %f.", hit.t);
+	}
+
+	EGL_BvhFree(&bvh);
+	EGL_free(vertices);
+	EGL_free(indices);
+}
+
+
+void EGL_BvhTest(EGL_TestModule *M) {
+	EGL_DECLARE_MODULE(EGL_bvh);
+
+	EGL_RUN_TEST(EGL_BvhRaycastTest);
+	EGL_RUN_TEST(EGL_BvhRangeTest);
+}
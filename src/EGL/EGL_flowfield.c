@@ -0,0 +1,510 @@
+#include <EGL/EGL_flowfield.h>
+#include <EGL/EGL_parallel.h>
+#include <EGL/EGL_memory.h>
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+
+
+#define INF_BITS UINT32_C(0x7F800000)
+#define LOCAL_MAX 256 // Frontier entries buffered per thread before publishing.
+
+enum {
+	TOUCHED = 1, // Distance changed (or was reset) by the current update.
+	LISTED  = 2, // Already in the list of nodes to finalize.
+	INVALID = 4, // Shortest path ran through a node that got more expensive.
+	PENDING = 8, // Cost changed since the last sweep.
+};
+
+
+typedef struct {
+	mtx_t mutex;
+	cnd_t cond;
+	int waiting;
+	unsigned generation;
+} Barrier;
+
+typedef struct {
+	EGL_FlowField *f;
+	uint32_t frontier_count;
+	_Atomic uint32_t next_count;
+	_Atomic uint32_t touched_count;
+	Barrier barrier;
+} Sweep;
+
+typedef struct {
+	EGL_FlowField *f;
+	const uint32_t *list; // NULL to finalize every node.
+	uint32_t count;
+} Finalize;
+
+typedef struct {
+	float distance;
+	uint32_t node;
+} HeapEntry;
+
+
+/* Non-negative floats order the same as their bit patterns. */
+static inline uint32_t to_bits(float x) {
+	union { float f; uint32_t u; } v = { .f = x };
+	return v.u;
+}
+
+static inline float from_bits(uint32_t x) {
+	union { uint32_t u; float f; } v = { .u = x };
+	return v.f;
+}
+
+/* Symmetric in u and v so every sweep order sees identical weights. */
+static inline float edge_weight(const EGL_FlowField *f, uint32_t u, uint32_t v) {
+	const float *a = f->adj->positions + (size_t)u * 3;
+	const float *b = f->adj->positions + (size_t)v * 3;
+	float dx = a[0] - b[0];
+	float dy = a[1] - b[1];
+	float dz = a[2] - b[2];
+	return sqrtf(dx * dx + dy * dy + dz * dz) * (0.5f * (f->cost[u] + f->cost[v]));
+}
+
+static void barrier_wait(Barrier *b, int count) {
+	mtx_lock(&b->mutex);
+	unsigned generation = b->generation;
+	if (++b->waiting == count) {
+		b->waiting = 0;
+		b->generation++;
+		cnd_broadcast(&b->cond);
+	} else {
+		while (generation == b->generation) {
+			cnd_wait(&b->cond, &b->mutex);
+		}
+	}
+	mtx_unlock(&b->mutex);
+}
+
+/* Publish buffered frontier entries and record the nodes touched for the first time. */
+static void flush(Sweep *s, uint32_t *local, uint32_t n) {
+	EGL_FlowField *f = s->f;
+
+	uint32_t at = atomic_fetch_add_explicit(&s->next_count, n, memory_order_relaxed);
+	memcpy(f->frontier_next + at, local, sizeof(uint32_t) * n);
+
+	uint32_t fresh = 0;
+	for (uint32_t i = 0; i < n; i++) {
+		if (!(f->flags[local[i]] & TOUCHED)) {
+			f->flags[local[i]] |= TOUCHED;
+			local[fresh++] = local[i];
+		}
+	}
+	at = atomic_fetch_add_explicit(&s->touched_count, fresh, memory_order_relaxed);
+	memcpy(f->touched + at, local, sizeof(uint32_t) * fresh);
+}
+
+/*
+ * Label-correcting sweep: every thread relaxes its share of the frontier,
+ * lowering neighbor distances with an atomic min. Improved nodes form the next
+ * frontier. Iterates until no distance changes.
+ */
+static void sweep_kernel(void *data, int index, int count) {
+	Sweep *s = (Sweep *)data;
+	EGL_FlowField *f = s->f;
+	const uint32_t *offsets = f->adj->neighbor_offsets;
+	const uint32_t *neighbors = f->adj->neighbors;
+
+	uint32_t local[LOCAL_MAX];
+	uint32_t n = 0;
+
+	while (s->frontier_count > 0) {
+		size_t begin, end;
+		EGL_ParallelRange(s->frontier_count, index, count, &begin, &end);
+
+		for (size_t i = begin; i < end; i++) {
+			/*
+			 * Clearing queued[u] and then reading bits[u] pairs with lowering
+			 * bits[v] and then setting queued[v] below. All four are seq_cst so
+			 * a thread that lowers u after this read sees queued[u] clear and
+			 * queues u again, rather than both sides seeing the old values.
+			 */
+			uint32_t u = f->frontier[i];
+			atomic_store_explicit(&f->queued[u], 0, memory_order_seq_cst);
+			float du = from_bits(atomic_load_explicit(&f->bits[u], memory_order_seq_cst));
+
+			for (uint32_t e = offsets[u]; e < offsets[u + 1]; e++) {
+				uint32_t v = neighbors[e];
+				uint32_t candidate = to_bits(du + edge_weight(f, u, v));
+				uint32_t current = atomic_load_explicit(&f->bits[v], memory_order_relaxed);
+
+				while (candidate < current) {
+					if (atomic_compare_exchange_weak_explicit(&f->bits[v], &current, candidate, memory_order_seq_cst, memory_order_relaxed)) {
+						if (!atomic_exchange_explicit(&f->queued[v], 1, memory_order_seq_cst)) {
+							local[n++] = v;
+							if (n == LOCAL_MAX) {
+								flush(s, local, n);
+								n = 0;
+							}
+						}
+						break;
+					}
+				}
+			}
+		}
+		if (n > 0) {
+			flush(s, local, n);
+			n = 0;
+		}
+
+		barrier_wait(&s->barrier, count);
+		if (index == 0) {
+			uint32_t *swap = f->frontier;
+			f->frontier = f->frontier_next;
+			f->frontier_next = swap;
+			s->frontier_count = atomic_load_explicit(&s->next_count, memory_order_relaxed);
+			atomic_store_explicit(&s->next_count, 0, memory_order_relaxed);
+		}
+		barrier_wait(&s->barrier, count);
+	}
+}
+
+/* Sweep from the first `seeds` frontier nodes. Returns the new touched count. */
+static uint32_t sweep(EGL_FlowField *f, uint32_t seeds, uint32_t touched_count, int threads) {
+	Sweep s = {
+		.f = f,
+		.frontier_count = seeds,
+		.barrier = { .waiting = 0, .generation = 0 },
+	};
+	atomic_init(&s.next_count, 0);
+	atomic_init(&s.touched_count, touched_count);
+
+	if (mtx_init(&s.barrier.mutex, mtx_plain) != thrd_success) {
+		threads = 1;
+	} else if (cnd_init(&s.barrier.cond) != thrd_success) {
+		mtx_destroy(&s.barrier.mutex);
+		threads = 1;
+	}
+
+	if (threads > 1) {
+		EGL_ParallelRun(sweep_kernel, &s, threads);
+		cnd_destroy(&s.barrier.cond);
+		mtx_destroy(&s.barrier.mutex);
+	} else {
+		/* A single invocation never waits on the barrier */
+		sweep_kernel(&s, 0, 1);
+	}
+
+	return atomic_load_explicit(&s.touched_count, memory_order_relaxed);
+}
+
+/* Publish the final distance of a node and pick its cheapest neighbor (lowest id on ties). */
+static void finalize_node(EGL_FlowField *f, uint32_t v) {
+	const uint32_t *offsets = f->adj->neighbor_offsets;
+	const uint32_t *neighbors = f->adj->neighbors;
+
+	float dv = from_bits(atomic_load_explicit(&f->bits[v], memory_order_relaxed));
+	uint32_t best = EGL_FLOW_NONE;
+
+	if (!f->goal[v] && dv < INFINITY) {
+		float best_distance = INFINITY;
+		for (uint32_t e = offsets[v]; e < offsets[v + 1]; e++) {
+			uint32_t u = neighbors[e];
+			float candidate = from_bits(atomic_load_explicit(&f->bits[u], memory_order_relaxed)) + edge_weight(f, u, v);
+			if (candidate < best_distance) {
+				best_distance = candidate;
+				best = u;
+			}
+		}
+	}
+
+	f->distance[v] = dv;
+	f->next[v] = best;
+}
+
+static void finalize_kernel(void *data, int index, int count) {
+	Finalize *fin = (Finalize *)data;
+	size_t begin, end;
+	EGL_ParallelRange(fin->count, index, count, &begin, &end);
+
+	for (size_t i = begin; i < end; i++) {
+		finalize_node(fin->f, fin->list ? fin->list[i] : (uint32_t)i);
+	}
+}
+
+static void finalize(EGL_FlowField *f, const uint32_t *list, uint32_t count, int threads) {
+	Finalize fin = { .f = f, .list = list, .count = count };
+	EGL_ParallelRun(finalize_kernel, &fin, (count < 4096) ? 1 : threads);
+}
+
+static inline void seed(EGL_FlowField *f, uint32_t node, uint32_t *seeds) {
+	if (!atomic_load_explicit(&f->queued[node], memory_order_relaxed)) {
+		atomic_store_explicit(&f->queued[node], 1, memory_order_relaxed);
+		f->frontier[(*seeds)++] = node;
+	}
+}
+
+static inline void list(EGL_FlowField *f, uint32_t node, uint32_t *count) {
+	if (!(f->flags[node] & LISTED)) {
+		f->flags[node] |= LISTED;
+		f->frontier[(*count)++] = node;
+	}
+}
+
+static void heap_push(HeapEntry *heap, size_t *size, HeapEntry entry) {
+	size_t i = (*size)++;
+	while (i > 0) {
+		size_t parent = (i - 1) / 2;
+		if (heap[parent].distance <= entry.distance) {
+			break;
+		}
+		heap[i] = heap[parent];
+		i = parent;
+	}
+	heap[i] = entry;
+}
+
+static HeapEntry heap_pop(HeapEntry *heap, size_t *size) {
+	HeapEntry top = heap[0];
+	HeapEntry last = heap[--(*size)];
+	size_t i = 0;
+	for (;;) {
+		size_t child = i * 2 + 1;
+		if (child >= *size) {
+			break;
+		}
+		if (child + 1 < *size && heap[child + 1].distance < heap[child].distance) {
+			child++;
+		}
+		if (last.distance <= heap[child].distance) {
+			break;
+		}
+		heap[i] = heap[child];
+		i = child;
+	}
+	heap[i] = last;
+	return top;
+}
+
+
+bool EGL_FlowFieldInit(EGL_FlowField *f, const EGL_MeshAdjacency *adj) {
+	memset(f, 0, sizeof(*f));
+
+	const size_t n = adj->node_count;
+	f->adj = adj;
+	f->node_count = adj->node_count;
+	f->cost = (float *)EGL_malloc(sizeof(float) * n);
+	f->distance = (float *)EGL_malloc(sizeof(float) * n);
+	f->next = (uint32_t *)EGL_malloc(sizeof(uint32_t) * n);
+	f->goal = (uint8_t *)EGL_calloc(n, sizeof(uint8_t));
+	f->bits = (_Atomic uint32_t *)EGL_malloc(sizeof(_Atomic uint32_t) * n);
+	f->queued = (_Atomic uint8_t *)EGL_malloc(sizeof(_Atomic uint8_t) * n);
+	f->flags = (uint8_t *)EGL_calloc(n, sizeof(uint8_t));
+	f->frontier = (uint32_t *)EGL_malloc(sizeof(uint32_t) * n);
+	f->frontier_next = (uint32_t *)EGL_malloc(sizeof(uint32_t) * n);
+	f->touched = (uint32_t *)EGL_malloc(sizeof(uint32_t) * n);
+	f->pending = (uint32_t *)EGL_malloc(sizeof(uint32_t) * n);
+	f->pending_cost = (float *)EGL_malloc(sizeof(float) * n);
+
+	if (!f->cost || !f->distance || !f->next || !f->goal || !f->bits || !f->queued || !f->flags ||
+		!f->frontier || !f->frontier_next || !f->touched || !f->pending || !f->pending_cost) {
+		EGL_FlowFieldFree(f);
+		return false;
+	}
+
+	for (size_t i = 0; i < n; i++) {
+		f->cost[i] = 1.0f;
+		f->distance[i] = INFINITY;
+		f->next[i] = EGL_FLOW_NONE;
+		atomic_init(&f->bits[i], INF_BITS);
+		atomic_init(&f->queued[i], 0);
+	}
+
+	return true;
+}
+
+void EGL_FlowFieldFree(EGL_FlowField *f) {
+	EGL_free(f->cost);
+	EGL_free(f->distance);
+	EGL_free(f->next);
+	EGL_free(f->goal);
+	EGL_free((void *)f->bits);
+	EGL_free((void *)f->queued);
+	EGL_free(f->flags);
+	EGL_free(f->frontier);
+	EGL_free(f->frontier_next);
+	EGL_free(f->touched);
+	EGL_free(f->pending);
+	EGL_free(f->pending_cost);
+	memset(f, 0, sizeof(*f));
+}
+
+void EGL_FlowFieldSetGoal(EGL_FlowField *f, uint32_t node, bool goal) {
+	f->goal[node] = goal;
+}
+
+void EGL_FlowFieldSetCost(EGL_FlowField *f, uint32_t node, float cost) {
+	if (!(f->flags[node] & PENDING)) {
+		f->flags[node] |= PENDING;
+		f->pending[f->pending_count] = node;
+		f->pending_cost[f->pending_count] = f->cost[node];
+		f->pending_count++;
+	}
+	f->cost[node] = cost;
+}
+
+void EGL_FlowFieldBuild(EGL_FlowField *f, int threads) {
+	uint32_t seeds = 0;
+
+	for (uint32_t v = 0; v < f->node_count; v++) {
+		atomic_store_explicit(&f->bits[v], f->goal[v] ? 0 : INF_BITS, memory_order_relaxed);
+		atomic_store_explicit(&f->queued[v], f->goal[v], memory_order_relaxed);
+		if (f->goal[v]) {
+			f->frontier[seeds++] = v;
+		}
+	}
+
+	sweep(f, seeds, 0, threads);
+	finalize(f, NULL, f->node_count, threads);
+
+	memset(f->flags, 0, f->node_count);
+	f->pending_count = 0;
+}
+
+bool EGL_FlowFieldBuildReference(EGL_FlowField *f) {
+	const uint32_t *offsets = f->adj->neighbor_offsets;
+	const uint32_t *neighbors = f->adj->neighbors;
+
+	HeapEntry *heap = (HeapEntry *)EGL_malloc(sizeof(HeapEntry) * ((size_t)f->node_count + f->adj->edge_count));
+	if (!heap) {
+		return false;
+	}
+	size_t size = 0;
+
+	for (uint32_t v = 0; v < f->node_count; v++) {
+		f->distance[v] = f->goal[v] ? 0.0f : INFINITY;
+		if (f->goal[v]) {
+			heap_push(heap, &size, (HeapEntry){ 0.0f, v });
+		}
+	}
+
+	while (size > 0) {
+		HeapEntry top = heap_pop(heap, &size);
+		if (top.distance > f->distance[top.node]) {
+			continue;
+		}
+		for (uint32_t e = offsets[top.node]; e < offsets[top.node + 1]; e++) {
+			uint32_t v = neighbors[e];
+			float candidate = top.distance + edge_weight(f, top.node, v);
+			if (candidate < f->distance[v]) {
+				f->distance[v] = candidate;
+				heap_push(heap, &size, (HeapEntry){ candidate, v });
+			}
+		}
+	}
+	EGL_free(heap);
+
+	for (uint32_t v = 0; v < f->node_count; v++) {
+		atomic_store_explicit(&f->bits[v], to_bits(f->distance[v]), memory_order_relaxed);
+	}
+	finalize(f, NULL, f->node_count, 1);
+
+	memset(f->flags, 0, f->node_count);
+	f->pending_count = 0;
+
+	return true;
+}
+
+void EGL_FlowFieldUpdate(EGL_FlowField *f, int threads) {
+	if (f->pending_count == 0) {
+		return;
+	}
+
+	const uint32_t *offsets = f->adj->neighbor_offsets;
+	const uint32_t *neighbors = f->adj->neighbors;
+
+	/* Invalidate every node whose path runs through a node that got more expensive */
+	uint32_t *invalid = f->frontier_next;
+	uint32_t invalid_count = 0;
+	for (uint32_t i = 0; i < f->pending_count; i++) {
+		uint32_t p = f->pending[i];
+		if (f->cost[p] > f->pending_cost[i] && !(f->flags[p] & INVALID)) {
+			f->flags[p] |= INVALID;
+			invalid[invalid_count++] = p;
+		}
+	}
+	for (uint32_t head = 0; head < invalid_count; head++) {
+		uint32_t x = invalid[head];
+		for (uint32_t e = offsets[x]; e < offsets[x + 1]; e++) {
+			uint32_t v = neighbors[e];
+			if (f->next[v] == x && !(f->flags[v] & INVALID)) {
+				f->flags[v] |= INVALID;
+				invalid[invalid_count++] = v;
+			}
+		}
+	}
+
+	uint32_t touched_count = 0;
+	for (uint32_t i = 0; i < invalid_count; i++) {
+		uint32_t x = invalid[i];
+		if (!f->goal[x]) {
+			atomic_store_explicit(&f->bits[x], INF_BITS, memory_order_relaxed);
+		}
+		f->flags[x] |= TOUCHED;
+		f->touched[touched_count++] = x;
+	}
+
+	/* Seed the sweep from the still valid boundary of the invalid region */
+	uint32_t seeds = 0;
+	for (uint32_t i = 0; i < invalid_count; i++) {
+		uint32_t x = invalid[i];
+		if (f->goal[x]) {
+			seed(f, x, &seeds);
+		}
+		for (uint32_t e = offsets[x]; e < offsets[x + 1]; e++) {
+			uint32_t v = neighbors[e];
+			if (!(f->flags[v] & INVALID) && atomic_load_explicit(&f->bits[v], memory_order_relaxed) < INF_BITS) {
+				seed(f, v, &seeds);
+			}
+		}
+	}
+
+	/* Nodes that got cheaper pull their neighbors' distances in and push their own out */
+	for (uint32_t i = 0; i < f->pending_count; i++) {
+		uint32_t p = f->pending[i];
+		if (f->cost[p] >= f->pending_cost[i]) {
+			continue;
+		}
+		if (atomic_load_explicit(&f->bits[p], memory_order_relaxed) < INF_BITS) {
+			seed(f, p, &seeds);
+		}
+		for (uint32_t e = offsets[p]; e < offsets[p + 1]; e++) {
+			uint32_t v = neighbors[e];
+			if (atomic_load_explicit(&f->bits[v], memory_order_relaxed) < INF_BITS) {
+				seed(f, v, &seeds);
+			}
+		}
+	}
+
+	touched_count = sweep(f, seeds, touched_count, threads);
+
+	/* Steps can change for touched nodes, their neighbors and around changed costs */
+	uint32_t count = 0;
+	for (uint32_t i = 0; i < touched_count; i++) {
+		uint32_t t = f->touched[i];
+		list(f, t, &count);
+		for (uint32_t e = offsets[t]; e < offsets[t + 1]; e++) {
+			list(f, neighbors[e], &count);
+		}
+	}
+	for (uint32_t i = 0; i < f->pending_count; i++) {
+		uint32_t p = f->pending[i];
+		list(f, p, &count);
+		for (uint32_t e = offsets[p]; e < offsets[p + 1]; e++) {
+			list(f, neighbors[e], &count);
+		}
+	}
+
+	finalize(f, f->frontier, count, threads);
+
+	for (uint32_t i = 0; i < count; i++) {
+		f->flags[f->frontier[i]] = 0;
+	}
+	f->pending_count = 0;
+}
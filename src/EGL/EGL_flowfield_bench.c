@@ -0,0 +1,100 @@
+#include <EGL/EGL_bench.h>
+#include <EGL/EGL_flowfield.h>
+#include <EGL/EGL_parallel.h>
+
+#include <math.h>
+#include <stdlib.h>
+
+
+#define LEVEL 8    // 1.3M triangles, 655k nodes.
+#define TOWERS 64  // Towers placed and removed per incremental round.
+
+
+void EGL_FlowFieldBench(void) {
+	EGL_DECLARE_BENCH(EGL_flowfield);
+
+	float *vertices = NULL;
+	uint32_t *indices = NULL;
+	uint32_t vertex_count = 0;
+	uint32_t index_count = 0;
+	EGL_MeshAdjacency adj;
+	EGL_FlowField f;
+	char label[64];
+
+	if (!EGL_MeshIcosphere(LEVEL, &vertices, &vertex_count, &indices, &index_count)
+		|| !EGL_MeshAdjacencyBuild(&adj, indices, index_count, vertices, vertex_count)) {
+		printf(" level %d: failed to build the planet\n", LEVEL);
+		EGL_free(vertices);
+		EGL_free(indices);
+		return;
+	}
+	if (!EGL_FlowFieldInit(&f, &adj)) {
+		printf(" level %d: failed to allocate the flow field\n", LEVEL);
+		EGL_MeshAdjacencyFree(&adj);
+		EGL_free(vertices);
+		EGL_free(indices);
+		return;
+	}
+	EGL_FlowFieldSetGoal(&f, 0, true);
+
+	double best = 1e30;
+	for (int r = 0; r < EGL_BENCH_REPEATS; r++) {
+		double begin = EGL_BenchNow();
+		EGL_FlowFieldBuildReference(&f);
+		double elapsed = EGL_BenchNow() - begin;
+		best = (elapsed < best) ? elapsed : best;
+	}
+	snprintf(label, sizeof(label), "dijkstra level %d (%u nodes)", LEVEL, f.node_count);
+	EGL_BenchReport(label, best, (double)f.node_count, "node");
+
+	int threads_max = EGL_ThreadCount();
+	for (int threads = 1; threads <= threads_max; threads *= 2) {
+		best = 1e30;
+		for (int r = 0; r < EGL_BENCH_REPEATS; r++) {
+			double begin = EGL_BenchNow();
+			EGL_FlowFieldBuild(&f, threads);
+			double elapsed = EGL_BenchNow() - begin;
+			best = (elapsed < best) ? elapsed : best;
+		}
+		snprintf(label, sizeof(label), "sweep level %d, %d threads", LEVEL, threads);
+		EGL_BenchReport(label, best, (double)f.node_count, "node");
+	}
+	EGL_BENCH_SINK += (uint64_t)f.distance[f.node_count / 2];
+
+	/* Towers land in a band halfway to the goal where most paths run */
+	float farthest = 0.0f;
+	for (uint32_t n = 0; n < f.node_count; n++) {
+		farthest = (f.distance[n] < INFINITY && f.distance[n] > farthest) ? f.distance[n] : farthest;
+	}
+	uint32_t state = 12345;
+	uint32_t towers[TOWERS];
+	best = 1e30;
+	for (int r = 0; r < EGL_BENCH_REPEATS; r++) {
+		for (int t = 0; t < TOWERS; t++) {
+			do {
+				state = state * 1664525u + 1013904223u;
+				towers[t] = (state >> 8) % f.node_count;
+			} while (fabsf(f.distance[towers[t]] - 0.5f * farthest) > 0.05f * farthest);
+		}
+
+		double begin = EGL_BenchNow();
+		for (int t = 0; t < TOWERS; t++) {
+			EGL_FlowFieldSetCost(&f, towers[t], INFINITY);
+			EGL_FlowFieldUpdate(&f, threads_max);
+		}
+		for (int t = 0; t < TOWERS; t++) {
+			EGL_FlowFieldSetCost(&f, towers[t], 1.0f);
+			EGL_FlowFieldUpdate(&f, threads_max);
+		}
+		double elapsed = EGL_BenchNow() - begin;
+		best = (elapsed < best) ? elapsed : best;
+	}
+	snprintf(label, sizeof(label), "incremental tower place/remove, %d threads", threads_max);
+	EGL_BenchReport(label, best, 2.0 * TOWERS, "update");
+	EGL_BENCH_SINK += (uint64_t)f.distance[f.node_count / 3];
+
+	EGL_FlowFieldFree(&f);
+	EGL_MeshAdjacencyFree(&adj);
+	EGL_free(vertices);
+	EGL_free(indices);
+}
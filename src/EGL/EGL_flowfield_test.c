@@ -0,0 +1,231 @@
+#include <EGL/EGL_testing.h>
+#include <math.h>
+#include <stdlib.h>
+
+
+#define LEVEL 4    // 5120 triangles, 2562 nodes.
+#define THREADS 4
+#define STRESS_LEVEL 6 // 81920 triangles, 40962 nodes.
+#define STRESS_RUNS 24
+
+
+typedef struct {
+	float *vertices;
+	uint32_t *indices;
+	EGL_MeshAdjacency adj;
+} Planet;
+
+static bool planet_init_level(Planet *p, int level) {
+	uint32_t vertex_count = 0;
+	uint32_t index_count = 0;
+	if (!EGL_MeshIcosphere(level, &p->vertices, &vertex_count, &p->indices, &index_count)) {
+		return false;
+	}
+	return EGL_MeshAdjacencyBuild(&p->adj, p->indices, index_count, p->vertices, vertex_count);
+}
+
+static bool planet_init(Planet *p) {
+	return planet_init_level(p, LEVEL);
+}
+
+static void planet_free(Planet *p) {
+	EGL_MeshAdjacencyFree(&p->adj);
+	EGL_free(p->vertices);
+	EGL_free(p->indices);
+}
+
+/* Random terrain: costs in [1, 4) and roughly one node in eight blocked. */
+static void randomize_costs(EGL_FlowField *f, uint32_t seed) {
+	uint32_t state[4] = {0,0,0,0};
+	EGL_Seed(state, seed);
+	for (uint32_t n = 0; n < f->node_count; n++) {
+		float cost = 1.0f + 3.0f * EGL_RandFloat(state);
+		bool blocked = EGL_RandInt(state, 0, 8) == 0 && !f->goal[n];
+		EGL_FlowFieldSetCost(f, n, blocked ? INFINITY : cost);
+	}
+}
+
+/* Compare distances and steps bitwise. Returns the first mismatching node or EGL_FLOW_NONE. */
+static uint32_t compare_fields(const EGL_FlowField *a, const EGL_FlowField *b) {
+	for (uint32_t n = 0; n < a->node_count; n++) {
+		if (memcmp(&a->distance[n], &b->distance[n], sizeof(float)) != 0 || a->next[n] != b->next[n]) {
+			return n;
+		}
+	}
+	return EGL_FLOW_NONE;
+}
+
+
+/**
+ * Following the steps from any reachable node strictly decreases the distance
+ * and ends at a goal.
+ */
+static void EGL_FlowFieldDescentTest(EGL_Test *T) {
+	EGL_DECLARE_TEST;
+
+	Planet planet;
+	EGL_FlowField f;
+	if (!planet_init(&planet) || !EGL_FlowFieldInit(&f, &planet.adj)) {
+		EGL_DECLARE_ERROR("Failed to set up a level %d planet.", LEVEL);
+		return;
+	}
+
+	EGL_FlowFieldSetGoal(&f, 0, true);
+	EGL_FlowFieldBuild(&f, THREADS);
+
+	for (uint32_t n = 0; n < f.node_count && T->error_count < ERRORS_MAX - 1; n++) {
+		if (!(f.distance[n] < INFINITY)) {
+			EGL_DECLARE_ERROR("Node %u cannot reach the goal on open ground.", n);
+			continue;
+		}
+		uint32_t at = n;
+		for (uint32_t steps = 0; at != 0; steps++) {
+			uint32_t next = EGL_FlowFieldNext(&f, at);
+			if (next == EGL_FLOW_NONE || !(f.distance[next] < f.distance[at]) || steps > f.node_count) {
+				EGL_DECLARE_ERROR("Path from node %u is broken at node %u.", n, at);
+				break;
+			}
+			at = next;
+		}
+	}
+
+	EGL_FlowFieldFree(&f);
+	planet_free(&planet);
+}
+
+/**
+ * The parallel sweep matches single-threaded Dijkstra exactly on rough terrain
+ * with several goals.
+ */
+static void EGL_FlowFieldReferenceTest(EGL_Test *T) {
+	EGL_DECLARE_TEST;
+
+	Planet planet;
+	EGL_FlowField f;
+	EGL_FlowField ref;
+	if (!planet_init(&planet) || !EGL_FlowFieldInit(&f, &planet.adj) || !EGL_FlowFieldInit(&ref, &planet.adj)) {
+		EGL_DECLARE_ERROR("Failed to set up a level %d planet.", LEVEL);
+		return;
+	}
+
+	uint32_t goals[] = { 0, 5, 11, 1000 };
+	for (size_t i = 0; i < sizeof(goals) / sizeof(goals[0]); i++) {
+		EGL_FlowFieldSetGoal(&f, goals[i], true);
+		EGL_FlowFieldSetGoal(&ref, goals[i], true);
+	}
+	randomize_costs(&f, 42);
+	randomize_costs(&ref, 42);
+
+	EGL_FlowFieldBuild(&f, THREADS);
+	EGL_FlowFieldBuildReference(&ref);
+
+	uint32_t n = compare_fields(&f, &ref);
+	if (n != EGL_FLOW_NONE) {
+		EGL_DECLARE_ERROR("Node %u: sweep gives %f -> %u, Dijkstra %f -> %u.", n, f.distance[n], f.next[n], ref.distance[n], ref.next[n]);
+	}
+
+	EGL_FlowFieldFree(&ref);
+	EGL_FlowFieldFree(&f);
+	planet_free(&planet);
+}
+
+/**
+ * Incremental updates after blocking, unblocking and re-weighting nodes match
+ * a full rebuild exactly.
+ */
+static void EGL_FlowFieldUpdateTest(EGL_Test *T) {
+	EGL_DECLARE_TEST;
+
+	Planet planet;
+	EGL_FlowField f;
+	EGL_FlowField ref;
+	if (!planet_init(&planet) || !EGL_FlowFieldInit(&f, &planet.adj) || !EGL_FlowFieldInit(&ref, &planet.adj)) {
+		EGL_DECLARE_ERROR("Failed to set up a level %d planet.", LEVEL);
+		return;
+	}
+
+	uint32_t state[4] = {0,0,0,0};
+	EGL_Seed(state, 7);
+	EGL_FlowFieldSetGoal(&f, 0, true);
+	EGL_FlowFieldSetGoal(&ref, 0, true);
+	EGL_FlowFieldBuild(&f, THREADS);
+
+	for (int round = 0; round < 32 && T->error_count < ERRORS_MAX - 1; round++) {
+		/* A handful of towers placed, removed or turned into rough ground */
+		int changes = EGL_RandInt(state, 1, 9);
+		for (int c = 0; c < changes; c++) {
+			uint32_t node = (uint32_t)EGL_RandInt(state, 0, (int)f.node_count);
+			float cost = EGL_RandBool(state) ? INFINITY : (float)EGL_RandInt(state, 1, 5);
+			EGL_FlowFieldSetCost(&f, node, cost);
+			EGL_FlowFieldSetCost(&ref, node, cost);
+		}
+
+		EGL_FlowFieldUpdate(&f, (round & 1) ? THREADS : 1);
+		EGL_FlowFieldBuild(&ref, THREADS);
+
+		uint32_t n = compare_fields(&f, &ref);
+		if (n != EGL_FLOW_NONE) {
+			EGL_DECLARE_ERROR("Round %d, node %u: update gives %f -> %u, rebuild %f -> %u.", round, n, f.distance[n], f.next[n], ref.distance[n], ref.next[n]);
+		}
+	}
+
+	EGL_FlowFieldFree(&ref);
+	EGL_FlowFieldFree(&f);
+	planet_free(&planet);
+}
+
+/**
+ * On a large planet, where threads race to lower the same nodes, every
+ * parallel build matches a single-threaded one exactly, run after run.
+ */
+static void EGL_FlowFieldStressTest(EGL_Test *T) {
+	EGL_DECLARE_TEST;
+
+	Planet planet;
+	EGL_FlowField f;
+	EGL_FlowField ref;
+	if (!planet_init_level(&planet, STRESS_LEVEL) || !EGL_FlowFieldInit(&f, &planet.adj) || !EGL_FlowFieldInit(&ref, &planet.adj)) {
+		EGL_DECLARE_ERROR("Failed to set up a level %d planet.", STRESS_LEVEL);
+		return;
+	}
+
+	for (int run = 0; run < STRESS_RUNS && T->error_count < ERRORS_MAX - 1; run++) {
+		/* New terrain and goals every few runs, the same ones rebuilt in between */
+		if (run % 4 == 0) {
+			uint32_t state[4] = {0,0,0,0};
+			EGL_Seed(state, (uint32_t)run);
+			for (uint32_t n = 0; n < f.node_count; n++) {
+				EGL_FlowFieldSetGoal(&f, n, false);
+				EGL_FlowFieldSetGoal(&ref, n, false);
+			}
+			for (int g = 0; g < 3; g++) {
+				uint32_t goal = (uint32_t)EGL_RandInt(state, 0, (int)f.node_count);
+				EGL_FlowFieldSetGoal(&f, goal, true);
+				EGL_FlowFieldSetGoal(&ref, goal, true);
+			}
+			randomize_costs(&f, (uint32_t)run + 100);
+			randomize_costs(&ref, (uint32_t)run + 100);
+			EGL_FlowFieldBuild(&ref, 1);
+		}
+
+		EGL_FlowFieldBuild(&f, THREADS);
+		uint32_t n = compare_fields(&f, &ref);
+		if (n != EGL_FLOW_NONE) {
+			EGL_DECLARE_ERROR("Run %d, node %u: %d threads give %f -> %u, one %f -> %u.", run, n, THREADS, f.distance[n], f.next[n], ref.distance[n], ref.next[n]);
+		}
+	}
+
+	EGL_FlowFieldFree(&ref);
+	EGL_FlowFieldFree(&f);
+	planet_free(&planet);
+}
+
+
+void EGL_FlowFieldTest(EGL_TestModule *M) {
+	EGL_DECLARE_MODULE(EGL_flowfield);
+
+	EGL_RUN_TEST(EGL_FlowFieldDescentTest);
+	EGL_RUN_TEST(EGL_FlowFieldReferenceTest);
+	EGL_RUN_TEST(EGL_FlowFieldUpdateTest);
+	EGL_RUN_TEST(EGL_FlowFieldStressTest);
+}
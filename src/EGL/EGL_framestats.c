@@ -0,0 +1,174 @@
+#include <EGL/EGL_framestats.h>
+#include <EGL/EGL_memory.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+/* Deadlines an interval missed, rounded to whole vsync periods. */
+static uint64_t missed_deadlines(uint64_t interval_ns, uint64_t refresh_ns) {
+	if (!refresh_ns) {
+		return 0;
+	}
+	const uint64_t periods = (interval_ns + refresh_ns / 2) / refresh_ns;
+	return periods > 1 ? periods - 1 : 0;
+}
+
+static void percentiles(const EGL_Histogram *h, uint64_t max, EGL_FramePercentiles *p) {
+	p->p50 = EGL_HistogramQuantile(h, 0.50);
+	p->p95 = EGL_HistogramQuantile(h, 0.95);
+	p->p99 = EGL_HistogramQuantile(h, 0.99);
+	p->max = max;
+}
+
+static uint64_t window_max(const uint64_t *samples, uint64_t count) {
+	uint64_t max = 0;
+	for (uint64_t i = 0; i < count; i++) {
+		max = samples[i] > max ? samples[i] : max;
+	}
+	return max;
+}
+
+static void write_percentiles(FILE *f, const char *name, const EGL_FramePercentiles *p) {
+	fprintf(f, "\t\"%s\": {\"p50\": %llu, \"p95\": %llu, \"p99\": %llu, \"max\": %llu},\n", name,
+		(unsigned long long)p->p50, (unsigned long long)p->p95, (unsigned long long)p->p99, (unsigned long long)p->max);
+}
+
+/* Buckets as [largest value, count] pairs. */
+static void write_buckets(FILE *f, const char *name, const EGL_Histogram *h, bool last) {
+	fprintf(f, "\t\"%s_buckets\": [", name);
+	bool first = true;
+	for (uint32_t b = 0; b < EGL_HISTOGRAM_BUCKETS; b++) {
+		if (h->counts[b]) {
+			fprintf(f, "%s[%llu, %u]", first ? "" : ", ", (unsigned long long)EGL_HistogramBucketMax(b), h->counts[b]);
+			first = false;
+		}
+	}
+	fprintf(f, "]%s\n", last ? "" : ",");
+}
+
+
+void EGL_HistogramClear(EGL_Histogram *h) {
+	memset(h, 0, sizeof(*h));
+}
+
+void EGL_HistogramAdd(EGL_Histogram *h, uint64_t value) {
+	h->counts[EGL_HistogramBucket(value)]++;
+	h->total++;
+	h->max = value > h->max ? value : h->max;
+}
+
+void EGL_HistogramRemove(EGL_Histogram *h, uint64_t value) {
+	h->counts[EGL_HistogramBucket(value)]--;
+	h->total--;
+}
+
+uint64_t EGL_HistogramQuantile(const EGL_Histogram *h, double q) {
+	if (!h->total) {
+		return 0;
+	}
+	q = q < 0.0 ? 0.0 : (q > 1.0 ? 1.0 : q);
+	uint64_t rank = (uint64_t)(q * (double)h->total + 0.5);
+	rank = rank < 1 ? 1 : rank;
+
+	uint64_t seen = 0;
+	for (uint32_t b = 0; b < EGL_HISTOGRAM_BUCKETS; b++) {
+		seen += h->counts[b];
+		if (seen >= rank) {
+			const uint64_t value = EGL_HistogramBucketMax(b);
+			return value < h->max ? value : h->max;
+		}
+	}
+	return h->max;
+}
+
+
+bool EGL_FrameStatsInit(EGL_FrameStats *s, uint32_t window, uint64_t refresh_ns) {
+	memset(s, 0, sizeof(*s));
+	s->cpu_samples = (uint64_t *)EGL_calloc(window, sizeof(uint64_t));
+	s->interval_samples = (uint64_t *)EGL_calloc(window, sizeof(uint64_t));
+	s->missed_samples = (uint8_t *)EGL_calloc(window, sizeof(uint8_t));
+	if (!window || !s->cpu_samples || !s->interval_samples || !s->missed_samples) {
+		EGL_FrameStatsFree(s);
+		return false;
+	}
+	s->window = window;
+	s->refresh_ns = refresh_ns;
+	return true;
+}
+
+void EGL_FrameStatsFree(EGL_FrameStats *s) {
+	EGL_free(s->cpu_samples);
+	EGL_free(s->interval_samples);
+	EGL_free(s->missed_samples);
+	memset(s, 0, sizeof(*s));
+}
+
+/*
+ * The first frame has no previous present, so it records an interval equal to
+ * its CPU time rather than a bogus one measured from zero.
+ */
+void EGL_FrameStatsAdd(EGL_FrameStats *s, uint64_t cpu_ns, uint64_t present_ns) {
+	const uint64_t interval = s->last_present && present_ns > s->last_present ? present_ns - s->last_present : cpu_ns;
+	s->last_present = present_ns;
+	uint64_t missed = missed_deadlines(interval, s->refresh_ns);
+	missed = missed > UINT8_MAX ? UINT8_MAX : missed;
+
+	const uint32_t slot = s->next;
+	if (s->frames >= s->window) {
+		EGL_HistogramRemove(&s->cpu_window, s->cpu_samples[slot]);
+		EGL_HistogramRemove(&s->interval_window, s->interval_samples[slot]);
+		s->window_missed -= s->missed_samples[slot];
+	}
+	s->cpu_samples[slot] = cpu_ns;
+	s->interval_samples[slot] = interval;
+	s->missed_samples[slot] = (uint8_t)missed;
+	s->next = slot + 1 == s->window ? 0 : slot + 1;
+
+	EGL_HistogramAdd(&s->cpu_window, cpu_ns);
+	EGL_HistogramAdd(&s->interval_window, interval);
+	EGL_HistogramAdd(&s->cpu_run, cpu_ns);
+	EGL_HistogramAdd(&s->interval_run, interval);
+	s->window_missed += missed;
+	s->run_missed += missed;
+	s->frames++;
+}
+
+/* The window histograms' max never drops, so the window's max comes from its samples. */
+void EGL_FrameStatsWindow(const EGL_FrameStats *s, EGL_FrameReport *report) {
+	const uint64_t count = s->frames < s->window ? s->frames : s->window;
+	percentiles(&s->cpu_window, window_max(s->cpu_samples, count), &report->cpu);
+	percentiles(&s->interval_window, window_max(s->interval_samples, count), &report->interval);
+	report->frames = count;
+	report->missed = s->window_missed;
+}
+
+void EGL_FrameStatsRun(const EGL_FrameStats *s, EGL_FrameReport *report) {
+	percentiles(&s->cpu_run, s->cpu_run.max, &report->cpu);
+	percentiles(&s->interval_run, s->interval_run.max, &report->interval);
+	report->frames = s->frames;
+	report->missed = s->run_missed;
+}
+
+bool EGL_FrameStatsWrite(const EGL_FrameStats *s, const char *path) {
+	FILE *f = fopen(path, "w");
+	if (!f) {
+		return false;
+	}
+
+	EGL_FrameReport run;
+	EGL_FrameStatsRun(s, &run);
+	fprintf(f, "{\n");
+	fprintf(f, "\t\"frames\": %llu,\n", (unsigned long long)run.frames);
+	fprintf(f, "\t\"refresh_ns\": %llu,\n", (unsigned long long)s->refresh_ns);
+	fprintf(f, "\t\"missed\": %llu,\n", (unsigned long long)run.missed);
+	write_percentiles(f, "cpu_ns", &run.cpu);
+	write_percentiles(f, "interval_ns", &run.interval);
+	write_buckets(f, "cpu", &s->cpu_run, false);
+	write_buckets(f, "interval", &s->interval_run, true);
+	fprintf(f, "}\n");
+
+	const bool ok = !ferror(f);
+	return fclose(f) == 0 && ok;
+}
@@ -0,0 +1,60 @@
+#include <EGL/EGL_bench.h>
+#include <EGL/EGL_framestats.h>
+
+#include <stdlib.h>
+
+
+#define FRAMES 1000000
+#define REPORTS 10000
+#define WINDOW 240
+#define REFRESH_NS 16666667
+
+
+static uint32_t lcg(uint32_t *state) {
+	*state = *state * 1664525u + 1013904223u;
+	return *state >> 8;
+}
+
+
+void EGL_FrameStatsBench(void) {
+	EGL_DECLARE_BENCH(EGL_framestats);
+
+	EGL_FrameStats *s = (EGL_FrameStats *)malloc(sizeof(EGL_FrameStats));
+	if (!s || !EGL_FrameStatsInit(s, WINDOW, REFRESH_NS)) {
+		printf(" failed to allocate\n");
+		free(s);
+		return;
+	}
+	uint32_t state = 42;
+	uint64_t now = 0;
+
+#define RUN(name, count, unit, ...) do { \
+		double best = 1e30; \
+		for (int r = 0; r < EGL_BENCH_REPEATS; r++) { \
+			double begin = EGL_BenchNow(); \
+			for (int i = 0; i < (count); i++) { \
+				__VA_ARGS__; \
+			} \
+			double elapsed = EGL_BenchNow() - begin; \
+			best = (elapsed < best) ? elapsed : best; \
+		} \
+		EGL_BenchReport(name, best, (double)(count), unit); \
+	} while (0)
+
+	/* Frames of 2 to 10 ms, presented at 60 Hz with jitter */
+	RUN("add", FRAMES, "frame",
+		now += REFRESH_NS + lcg(&state) % 1000000;
+		EGL_FrameStatsAdd(s, 2000000 + lcg(&state) % 8000000, now));
+
+	EGL_FrameReport report;
+	RUN("window report", REPORTS, "report",
+		EGL_FrameStatsWindow(s, &report);
+		EGL_BENCH_SINK += report.cpu.p99);
+	RUN("run report", REPORTS, "report",
+		EGL_FrameStatsRun(s, &report);
+		EGL_BENCH_SINK += report.cpu.p99);
+#undef RUN
+
+	EGL_FrameStatsFree(s);
+	free(s);
+}
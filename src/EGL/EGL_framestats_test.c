@@ -0,0 +1,176 @@
+#include <EGL/EGL_testing.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+#define SAMPLES 100000
+#define WINDOW 120
+#define REFRESH_NS 16666667 // 60 Hz
+#define STATS_PATH "EGL_framestats_test.json"
+
+
+static uint32_t lcg(uint32_t *state) {
+	*state = *state * 1664525u + 1013904223u;
+	return *state >> 8;
+}
+
+static int compare_u64(const void *a, const void *b) {
+	const uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+	return (x > y) - (x < y);
+}
+
+
+/**
+ * Every value lands in a bucket whose range holds it, buckets are contiguous,
+ * and a bucket is never wider than 1/64 of the values in it.
+ */
+static void EGL_HistogramBucketTest(EGL_Test *T) {
+	EGL_DECLARE_TEST;
+
+	for (uint32_t b = 1; b < EGL_HISTOGRAM_BUCKETS; b++) {
+		const uint64_t low = EGL_HistogramBucketMax(b - 1) + 1, high = EGL_HistogramBucketMax(b);
+		if (EGL_HistogramBucket(low) != b || EGL_HistogramBucket(high) != b) {
+			EGL_DECLARE_ERROR("Bucket %u covers %llu to %llu, but they fall in %u and %u.", b,
+				(unsigned long long)low, (unsigned long long)high, EGL_HistogramBucket(low), EGL_HistogramBucket(high));
+			return;
+		}
+		if ((high - low) * EGL_HISTOGRAM_HALF > low) {
+			EGL_DECLARE_ERROR("Bucket %u from %llu to %llu is wider than 1/64 of its values.", b,
+				(unsigned long long)low, (unsigned long long)high);
+			return;
+		}
+	}
+	if (EGL_HistogramBucket(UINT64_MAX) != EGL_HISTOGRAM_BUCKETS - 1 || EGL_HistogramBucketMax(EGL_HISTOGRAM_BUCKETS - 1) != EGL_HISTOGRAM_MAX_NS) {
+		EGL_DECLARE_ERROR("The last bucket should hold %llu and everything above.", (unsigned long long)EGL_HISTOGRAM_MAX_NS);
+	}
+}
+
+/**
+ * Quantiles of widely spread values are within a bucket width above the
+ * exact answer, and never below it.
+ */
+static void EGL_HistogramQuantileTest(EGL_Test *T) {
+	EGL_DECLARE_TEST;
+
+	EGL_Histogram *h = (EGL_Histogram *)malloc(sizeof(EGL_Histogram));
+	uint64_t *values = (uint64_t *)malloc(SAMPLES * sizeof(uint64_t));
+	if (!h || !values) {
+		EGL_DECLARE_ERROR("Failed to allocate %d samples.", SAMPLES);
+		free(h);
+		free(values);
+		return;
+	}
+
+	EGL_HistogramClear(h);
+	uint32_t state = 7;
+	for (int i = 0; i < SAMPLES; i++) {
+		values[i] = (uint64_t)lcg(&state) << (lcg(&state) % 16); // 0 to about 2^40, weighted low.
+		EGL_HistogramAdd(h, values[i]);
+	}
+	qsort(values, SAMPLES, sizeof(uint64_t), compare_u64);
+
+	const double qs[] = { 0.0, 0.25, 0.5, 0.9, 0.95, 0.99, 0.999, 1.0 };
+	for (size_t i = 0; i < sizeof(qs) / sizeof(qs[0]); i++) {
+		size_t rank = (size_t)(qs[i] * SAMPLES + 0.5);
+		rank = rank < 1 ? 1 : rank;
+		const uint64_t exact = values[rank - 1], got = EGL_HistogramQuantile(h, qs[i]);
+		if (got < exact || got - exact > exact / EGL_HISTOGRAM_HALF) {
+			EGL_DECLARE_ERROR("Quantile %g was %llu, expected %llu within 1/64.", qs[i], (unsigned long long)got, (unsigned long long)exact);
+		}
+	}
+	if (h->max != values[SAMPLES - 1] || EGL_HistogramQuantile(h, 1.0) != h->max) {
+		EGL_DECLARE_ERROR("Max was %llu, expected %llu.", (unsigned long long)h->max, (unsigned long long)values[SAMPLES - 1]);
+	}
+
+	for (int i = 0; i < SAMPLES; i++) {
+		EGL_HistogramRemove(h, values[i]);
+	}
+	if (h->total != 0 || EGL_HistogramQuantile(h, 0.5) != 0) {
+		EGL_DECLARE_ERROR("Removing every value left %llu.", (unsigned long long)h->total);
+	}
+
+	free(h);
+	free(values);
+}
+
+/**
+ * The window forgets frames older than its length, while the run keeps them,
+ * and long intervals count the vsync deadlines they skipped.
+ */
+static void EGL_FrameStatsWindowTest(EGL_Test *T) {
+	EGL_DECLARE_TEST;
+
+	EGL_FrameStats *s = (EGL_FrameStats *)malloc(sizeof(EGL_FrameStats));
+	if (!s || !EGL_FrameStatsInit(s, WINDOW, REFRESH_NS)) {
+		EGL_DECLARE_ERROR("Failed to allocate a window of %d.", WINDOW);
+		free(s);
+		return;
+	}
+
+	/* A hitch: one frame takes 50 ms and skips two deadlines, then the rest hold 60 Hz */
+	uint64_t now = 1000;
+	EGL_FrameStatsAdd(s, 2000000, now);
+	now += 3 * REFRESH_NS;
+	EGL_FrameStatsAdd(s, 50000000, now);
+	for (int i = 0; i < WINDOW - 2; i++) {
+		now += REFRESH_NS + (i % 2 ? 100000 : -100000); // Jitter is not a miss.
+		EGL_FrameStatsAdd(s, 4000000, now);
+	}
+
+	EGL_FrameReport window;
+	EGL_FrameStatsWindow(s, &window);
+	if (window.frames != WINDOW || window.missed != 2 || window.cpu.max != 50000000 || window.interval.max != 3 * REFRESH_NS) {
+		EGL_DECLARE_ERROR("With the hitch in the window, got %llu frames, %llu missed, cpu max %llu.",
+			(unsigned long long)window.frames, (unsigned long long)window.missed, (unsigned long long)window.cpu.max);
+	}
+	if (window.cpu.p50 < 4000000 || window.cpu.p50 > 4000000 + 4000000 / EGL_HISTOGRAM_HALF) {
+		EGL_DECLARE_ERROR("Median cpu time was %llu, expected about 4000000.", (unsigned long long)window.cpu.p50);
+	}
+
+	/* Push the hitch out of the window */
+	for (int i = 0; i < 2; i++) {
+		now += REFRESH_NS;
+		EGL_FrameStatsAdd(s, 4000000, now);
+	}
+	EGL_FrameStatsWindow(s, &window);
+	if (window.missed != 0 || window.cpu.max != 4000000 || window.cpu.p99 > 4000000 + 4000000 / EGL_HISTOGRAM_HALF) {
+		EGL_DECLARE_ERROR("After the hitch left the window, got %llu missed, cpu max %llu and p99 %llu.",
+			(unsigned long long)window.missed, (unsigned long long)window.cpu.max, (unsigned long long)window.cpu.p99);
+	}
+
+	EGL_FrameReport run;
+	EGL_FrameStatsRun(s, &run);
+	if (run.frames != WINDOW + 2 || run.missed != 2 || run.cpu.max != 50000000) {
+		EGL_DECLARE_ERROR("The run had %llu frames, %llu missed and cpu max %llu.",
+			(unsigned long long)run.frames, (unsigned long long)run.missed, (unsigned long long)run.cpu.max);
+	}
+
+	if (!EGL_FrameStatsWrite(s, STATS_PATH)) {
+		EGL_DECLARE_ERROR("Failed to write %s.", STATS_PATH);
+	} else {
+		FILE *f = fopen(STATS_PATH, "r");
+		char text[256];
+		size_t length = 0;
+		if (f) {
+			length = fread(text, 1, sizeof(text) - 1, f);
+			fclose(f);
+		}
+		text[length] = '\0';
+		if (!strstr(text, "\"frames\": 122,") || !strstr(text, "\"missed\": 2,")) {
+			EGL_DECLARE_ERROR("%s did not start with the run summary.", STATS_PATH);
+		}
+		remove(STATS_PATH);
+	}
+
+	EGL_FrameStatsFree(s);
+	free(s);
+}
+
+
+void EGL_FrameStatsTest(EGL_TestModule *M) {
+	EGL_DECLARE_MODULE(EGL_framestats);
+
+	EGL_RUN_TEST(EGL_HistogramBucketTest);
+	EGL_RUN_TEST(EGL_HistogramQuantileTest);
+	EGL_RUN_TEST(EGL_FrameStatsWindowTest);
+}
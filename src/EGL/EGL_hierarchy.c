@@ -0,0 +1,206 @@
+#include <EGL/EGL_hierarchy.h>
+#include <EGL/EGL_memory.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+
+#define DIRTY         1 // The local transform changed.
+#define SUBTREE_DIRTY 2 // This node or a descendant is dirty.
+
+#define MATRIX (sizeof(float) * 16)
+
+
+/* r = a * b for column-major 4x4 matrices (r must not alias a or b). */
+static void matrix_mul(const float *a, const float *b, float *r) {
+#ifdef __SSE2__
+	const __m128 a0 = _mm_loadu_ps(a);
+	const __m128 a1 = _mm_loadu_ps(a + 4);
+	const __m128 a2 = _mm_loadu_ps(a + 8);
+	const __m128 a3 = _mm_loadu_ps(a + 12);
+	for (int c = 0; c < 4; c++) {
+		__m128 col = _mm_mul_ps(a0, _mm_set1_ps(b[c * 4]));
+		col = _mm_add_ps(col, _mm_mul_ps(a1, _mm_set1_ps(b[c * 4 + 1])));
+		col = _mm_add_ps(col, _mm_mul_ps(a2, _mm_set1_ps(b[c * 4 + 2])));
+		col = _mm_add_ps(col, _mm_mul_ps(a3, _mm_set1_ps(b[c * 4 + 3])));
+		_mm_storeu_ps(r + c * 4, col);
+	}
+#else
+	for (int c = 0; c < 4; c++) {
+		for (int row = 0; row < 4; row++) {
+			r[c * 4 + row] = a[row] * b[c * 4] + a[4 + row] * b[c * 4 + 1] + a[8 + row] * b[c * 4 + 2] + a[12 + row] * b[c * 4 + 3];
+		}
+	}
+#endif
+}
+
+/* Rotate elements [lo, hi) of an array so [mid, hi) comes first. */
+static void rotate(void *base, size_t elem, uint32_t lo, uint32_t mid, uint32_t hi, void *scratch) {
+	char *b = (char *)base;
+	memcpy(scratch, b + lo * elem, (mid - lo) * elem);
+	memmove(b + lo * elem, b + mid * elem, (hi - mid) * elem);
+	memcpy(b + (lo + hi - mid) * elem, scratch, (mid - lo) * elem);
+}
+
+/* Move the slots [mid, hi) in front of [lo, mid), then refresh the slot of every node from lo on. */
+static void move_slots(EGL_Hierarchy *h, uint32_t lo, uint32_t mid, uint32_t hi) {
+	if (lo < mid && mid < hi) {
+		rotate(h->node, sizeof(uint32_t), lo, mid, hi, h->scratch);
+		rotate(h->parent, sizeof(uint32_t), lo, mid, hi, h->scratch);
+		rotate(h->size, sizeof(uint32_t), lo, mid, hi, h->scratch);
+		rotate(h->flags, sizeof(uint8_t), lo, mid, hi, h->scratch);
+		rotate(h->local, MATRIX, lo, mid, hi, h->scratch);
+		rotate(h->world, MATRIX, lo, mid, hi, h->scratch);
+	}
+
+	/* Parents come first, so a parent's slot is always fixed before its children read it */
+	for (uint32_t s = lo; s < h->count; s++) {
+		h->slot[h->node[s]] = s;
+		h->parent_slot[s] = (h->parent[s] == EGL_HIERARCHY_NONE) ? EGL_HIERARCHY_NONE : h->slot[h->parent[s]];
+	}
+}
+
+static void add_to_ancestors(EGL_Hierarchy *h, uint32_t s, int32_t delta) {
+	for (uint32_t p = s; p != EGL_HIERARCHY_NONE; p = h->parent_slot[p]) {
+		h->size[p] = (uint32_t)((int32_t)h->size[p] + delta);
+	}
+}
+
+/* Flag a slot dirty and let every ancestor know, stopping at the first that already knows. */
+static void mark_dirty(EGL_Hierarchy *h, uint32_t s) {
+	h->flags[s] |= DIRTY | SUBTREE_DIRTY;
+	for (uint32_t p = h->parent_slot[s]; p != EGL_HIERARCHY_NONE && !(h->flags[p] & SUBTREE_DIRTY); p = h->parent_slot[p]) {
+		h->flags[p] |= SUBTREE_DIRTY;
+	}
+}
+
+
+bool EGL_HierarchyInit(EGL_Hierarchy *h, uint32_t capacity) {
+	memset(h, 0, sizeof(*h));
+	const size_t n = capacity ? capacity : 1;
+	h->capacity = capacity;
+	h->slot = (uint32_t *)EGL_malloc(sizeof(uint32_t) * n);
+	h->node = (uint32_t *)EGL_malloc(sizeof(uint32_t) * n);
+	h->parent = (uint32_t *)EGL_malloc(sizeof(uint32_t) * n);
+	h->parent_slot = (uint32_t *)EGL_malloc(sizeof(uint32_t) * n);
+	h->size = (uint32_t *)EGL_malloc(sizeof(uint32_t) * n);
+	h->flags = (uint8_t *)EGL_malloc(n);
+	h->local = (float *)EGL_malloc(MATRIX * n);
+	h->world = (float *)EGL_malloc(MATRIX * n);
+	h->scratch = EGL_malloc(MATRIX * n);
+	if (!h->slot || !h->node || !h->parent || !h->parent_slot || !h->size || !h->flags || !h->local || !h->world || !h->scratch) {
+		EGL_HierarchyFree(h);
+		return false;
+	}
+	return true;
+}
+
+void EGL_HierarchyFree(EGL_Hierarchy *h) {
+	EGL_free(h->slot);
+	EGL_free(h->node);
+	EGL_free(h->parent);
+	EGL_free(h->parent_slot);
+	EGL_free(h->size);
+	EGL_free(h->flags);
+	EGL_free(h->local);
+	EGL_free(h->world);
+	EGL_free(h->scratch);
+	memset(h, 0, sizeof(*h));
+}
+
+uint32_t EGL_HierarchyAdd(EGL_Hierarchy *h, uint32_t parent, const float local[16]) {
+	if (h->count >= h->capacity || (parent != EGL_HIERARCHY_NONE && parent >= h->count)) {
+		return EGL_HIERARCHY_NONE;
+	}
+
+	/* Append, then rotate into place at the end of the parent's subtree */
+	const uint32_t id = h->count;
+	const uint32_t end = id;
+	h->node[end] = id;
+	h->parent[end] = parent;
+	h->size[end] = 1;
+	h->flags[end] = 0;
+	memcpy(h->local + (size_t)end * 16, local, MATRIX);
+	h->count++;
+
+	uint32_t pos = end;
+	if (parent != EGL_HIERARCHY_NONE) {
+		const uint32_t ps = h->slot[parent];
+		pos = ps + h->size[ps];
+	}
+	move_slots(h, pos, end, end + 1);
+	if (parent != EGL_HIERARCHY_NONE) {
+		add_to_ancestors(h, h->parent_slot[pos], 1);
+	}
+	mark_dirty(h, pos);
+	return id;
+}
+
+bool EGL_HierarchyReparent(EGL_Hierarchy *h, uint32_t node, uint32_t parent) {
+	if (node >= h->count || (parent != EGL_HIERARCHY_NONE && parent >= h->count)) {
+		return false;
+	}
+	const uint32_t s = h->slot[node];
+	const uint32_t k = h->size[s];
+	uint32_t end = h->count;
+	if (parent != EGL_HIERARCHY_NONE) {
+		const uint32_t ps = h->slot[parent];
+		if (ps >= s && ps < s + k) {
+			return false;
+		}
+		end = ps + h->size[ps];
+	}
+
+	if (h->parent_slot[s] != EGL_HIERARCHY_NONE) {
+		add_to_ancestors(h, h->parent_slot[s], -(int32_t)k);
+	}
+	h->parent[s] = parent;
+	if (end >= s + k) {
+		move_slots(h, s, s + k, end);
+	} else {
+		move_slots(h, end, s, s + k);
+	}
+
+	const uint32_t moved = h->slot[node];
+	if (parent != EGL_HIERARCHY_NONE) {
+		add_to_ancestors(h, h->parent_slot[moved], (int32_t)k);
+	}
+	mark_dirty(h, moved);
+	return true;
+}
+
+void EGL_HierarchySetLocal(EGL_Hierarchy *h, uint32_t node, const float local[16]) {
+	const uint32_t s = h->slot[node];
+	memcpy(h->local + (size_t)s * 16, local, MATRIX);
+	mark_dirty(h, s);
+}
+
+void EGL_HierarchyUpdate(EGL_Hierarchy *h) {
+	uint32_t forced_end = 0; // Everything below a recomputed node is recomputed too.
+	uint32_t s = 0;
+	while (s < h->count) {
+		const uint8_t flags = h->flags[s];
+		if (s < forced_end || (flags & DIRTY)) {
+			if (s >= forced_end) {
+				forced_end = s + h->size[s];
+			}
+			const uint32_t p = h->parent_slot[s];
+			if (p == EGL_HIERARCHY_NONE) {
+				memcpy(h->world + (size_t)s * 16, h->local + (size_t)s * 16, MATRIX);
+			} else {
+				matrix_mul(h->world + (size_t)p * 16, h->local + (size_t)s * 16, h->world + (size_t)s * 16);
+			}
+			h->flags[s] = 0;
+			s++;
+		} else if (flags & SUBTREE_DIRTY) {
+			h->flags[s] = 0;
+			s++;
+		} else {
+			s += h->size[s];
+		}
+	}
+}
@@ -0,0 +1,175 @@
+#include <EGL/EGL_bench.h>
+#include <EGL/EGL_hierarchy.h>
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+#define NODES 100000
+#define DEPTH 1000   // Length of each chain in the deep hierarchy.
+#define BRANCHING 4  // Children per node in the balanced hierarchy.
+#define EDITS 1000   // Locals changed per frame in the sparse case (1%).
+
+
+/* The usual pointer tree: one allocation per node, recomputed recursively. */
+typedef struct NaiveNode {
+	float local[16];
+	float world[16];
+	struct NaiveNode **children;
+	uint32_t child_count;
+	uint32_t child_capacity;
+} NaiveNode;
+
+
+static uint32_t lcg(uint32_t *state) {
+	*state = *state * 1664525u + 1013904223u;
+	return *state >> 8;
+}
+
+static void random_local(uint32_t *state, float m[16]) {
+	const float angle = (float)lcg(state) / 16777216.0f * 6.2831853f;
+	memset(m, 0, sizeof(float) * 16);
+	m[0] = cosf(angle);
+	m[1] = sinf(angle);
+	m[4] = -sinf(angle);
+	m[5] = cosf(angle);
+	m[10] = 1.0f;
+	m[12] = 0.01f;
+	m[15] = 1.0f;
+}
+
+static void mul(const float *a, const float *b, float *r) {
+	for (int c = 0; c < 4; c++) {
+		for (int row = 0; row < 4; row++) {
+			r[c * 4 + row] = a[row] * b[c * 4] + a[4 + row] * b[c * 4 + 1] + a[8 + row] * b[c * 4 + 2] + a[12 + row] * b[c * 4 + 3];
+		}
+	}
+}
+
+static void naive_update(NaiveNode *node, const float *parent_world) {
+	if (parent_world) {
+		mul(parent_world, node->local, node->world);
+	} else {
+		memcpy(node->world, node->local, sizeof(node->world));
+	}
+	for (uint32_t c = 0; c < node->child_count; c++) {
+		naive_update(node->children[c], node->world);
+	}
+}
+
+static uint32_t shape_parent(int shape, uint32_t i) {
+	switch (shape) {
+	case 0: return (i % DEPTH == 0) ? EGL_HIERARCHY_NONE : i - 1;
+	case 1: return (i == 0) ? EGL_HIERARCHY_NONE : 0;
+	default: return (i == 0) ? EGL_HIERARCHY_NONE : (i - 1) / BRANCHING;
+	}
+}
+
+
+void EGL_HierarchyBench(void) {
+	EGL_DECLARE_BENCH(EGL_hierarchy);
+
+	static float locals[NODES][16];
+	NaiveNode **naive = (NaiveNode **)malloc(sizeof(NaiveNode *) * NODES);
+	if (!naive) {
+		printf(" %d nodes: failed to allocate\n", NODES);
+		return;
+	}
+
+	const char *names[3] = { "deep", "wide", "balanced" };
+	for (int shape = 0; shape < 3; shape++) {
+		EGL_Hierarchy h;
+		if (!EGL_HierarchyInit(&h, NODES)) {
+			printf(" %d nodes: failed to allocate\n", NODES);
+			break;
+		}
+		uint32_t state = 34;
+		for (uint32_t i = 0; i < NODES; i++) {
+			random_local(&state, locals[i]);
+			const uint32_t parent = shape_parent(shape, i);
+			EGL_HierarchyAdd(&h, parent, locals[i]);
+
+			naive[i] = (NaiveNode *)calloc(1, sizeof(NaiveNode));
+			memcpy(naive[i]->local, locals[i], sizeof(locals[i]));
+			if (parent != EGL_HIERARCHY_NONE) {
+				NaiveNode *p = naive[parent];
+				if (p->child_count == p->child_capacity) {
+					p->child_capacity = p->child_capacity ? p->child_capacity * 2 : 4;
+					p->children = (NaiveNode **)realloc(p->children, sizeof(NaiveNode *) * p->child_capacity);
+				}
+				p->children[p->child_count++] = naive[i];
+			}
+		}
+
+		char label[64];
+		double best = 1e30;
+		for (int r = 0; r < EGL_BENCH_REPEATS * 4; r++) {
+			double begin = EGL_BenchNow();
+			for (uint32_t i = 0; i < NODES; i++) {
+				if (shape_parent(shape, i) == EGL_HIERARCHY_NONE) {
+					naive_update(naive[i], NULL);
+				}
+			}
+			double elapsed = EGL_BenchNow() - begin;
+			best = (elapsed < best) ? elapsed : best;
+		}
+		EGL_BENCH_SINK += (uint64_t)naive[NODES - 1]->world[12];
+		snprintf(label, sizeof(label), "%s, naive recursive", names[shape]);
+		EGL_BenchReport(label, best, (double)NODES, "node");
+
+		/* Every root dirty drags its whole subtree along */
+		best = 1e30;
+		for (int r = 0; r < EGL_BENCH_REPEATS * 4; r++) {
+			double begin = EGL_BenchNow();
+			for (uint32_t i = 0; i < NODES; i++) {
+				if (shape_parent(shape, i) == EGL_HIERARCHY_NONE) {
+					EGL_HierarchySetLocal(&h, i, locals[i]);
+				}
+			}
+			EGL_HierarchyUpdate(&h);
+			double elapsed = EGL_BenchNow() - begin;
+			best = (elapsed < best) ? elapsed : best;
+		}
+		EGL_BENCH_SINK += (uint64_t)EGL_HierarchyWorld(&h, NODES - 1)[12];
+		snprintf(label, sizeof(label), "%s, flat all dirty", names[shape]);
+		EGL_BenchReport(label, best, (double)NODES, "node");
+
+		best = 1e30;
+		for (int r = 0; r < EGL_BENCH_REPEATS * 4; r++) {
+			double begin = EGL_BenchNow();
+			for (int e = 0; e < EDITS; e++) {
+				const uint32_t node = lcg(&state) % NODES;
+				EGL_HierarchySetLocal(&h, node, locals[node]);
+			}
+			EGL_HierarchyUpdate(&h);
+			double elapsed = EGL_BenchNow() - begin;
+			best = (elapsed < best) ? elapsed : best;
+		}
+		EGL_BENCH_SINK += (uint64_t)EGL_HierarchyWorld(&h, NODES - 1)[12];
+		snprintf(label, sizeof(label), "%s, flat %d edits", names[shape], EDITS);
+		EGL_BenchReport(label, best, (double)NODES, "node");
+
+		/* Move the last nodes added under random earlier ones */
+		best = 1e30;
+		for (int r = 0; r < EGL_BENCH_REPEATS; r++) {
+			double begin = EGL_BenchNow();
+			for (int e = 0; e < 100; e++) {
+				const uint32_t node = NODES - 1 - lcg(&state) % 100;
+				EGL_HierarchyReparent(&h, node, lcg(&state) % (NODES - 100));
+			}
+			double elapsed = EGL_BenchNow() - begin;
+			best = (elapsed < best) ? elapsed : best;
+		}
+		snprintf(label, sizeof(label), "%s, reparent", names[shape]);
+		EGL_BenchReport(label, best, 100.0, "move");
+
+		for (uint32_t i = 0; i < NODES; i++) {
+			free(naive[i]->children);
+			free(naive[i]);
+		}
+		EGL_HierarchyFree(&h);
+	}
+
+	free(naive);
+}
@@ -0,0 +1,194 @@
+#include <EGL/EGL_testing.h>
+#include <math.h>
+#include <stdlib.h>
+
+
+#define NODES 300
+
+
+/* A rotation about z and a translation, so chains of them stay well conditioned. */
+static void random_local(uint32_t *state, float m[16]) {
+	const float angle = 6.2831853f * EGL_RandFloat(state);
+	memset(m, 0, sizeof(float) * 16);
+	m[0] = cosf(angle);
+	m[1] = sinf(angle);
+	m[4] = -sinf(angle);
+	m[5] = cosf(angle);
+	m[10] = 1.0f;
+	m[12] = EGL_RandFloat(state) - 0.5f;
+	m[13] = EGL_RandFloat(state) - 0.5f;
+	m[14] = EGL_RandFloat(state) - 0.5f;
+	m[15] = 1.0f;
+}
+
+/* World matrix of a node as the product of the locals up its parent chain, in double precision. */
+static void reference_world(const uint32_t *parents, float (*locals)[16], uint32_t node, double r[16]) {
+	for (int k = 0; k < 16; k++) {
+		r[k] = locals[node][k];
+	}
+	for (uint32_t p = parents[node]; p != EGL_HIERARCHY_NONE; p = parents[p]) {
+		double t[16];
+		for (int c = 0; c < 4; c++) {
+			for (int row = 0; row < 4; row++) {
+				t[c * 4 + row] = 0.0;
+				for (int k = 0; k < 4; k++) {
+					t[c * 4 + row] += (double)locals[p][k * 4 + row] * r[c * 4 + k];
+				}
+			}
+		}
+		memcpy(r, t, sizeof(t));
+	}
+}
+
+/* Every subtree is contiguous and right after its parent, and sizes add up. */
+static bool check_order(const EGL_Hierarchy *h) {
+	for (uint32_t s = 0; s < h->count; s++) {
+		if (h->slot[h->node[s]] != s) {
+			return false;
+		}
+		uint32_t children = 1;
+		for (uint32_t c = s + 1; c < s + h->size[s]; c += h->size[c]) {
+			if (h->parent_slot[c] != s) {
+				return false;
+			}
+			children += h->size[c];
+		}
+		const uint32_t p = h->parent_slot[s];
+		if (children != h->size[s] || (p != EGL_HIERARCHY_NONE && (p >= s || s >= p + h->size[p]))) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static float compare(const EGL_Hierarchy *h, const uint32_t *parents, float (*locals)[16]) {
+	float error = 0.0f;
+	for (uint32_t node = 0; node < h->count; node++) {
+		double expected[16];
+		reference_world(parents, locals, node, expected);
+		const float *world = EGL_HierarchyWorld(h, node);
+		for (int k = 0; k < 16; k++) {
+			error = fmaxf(error, (float)fabs(expected[k] - world[k]));
+		}
+	}
+	return error;
+}
+
+
+/**
+ * Random adds, reparents and local edits always leave the hierarchy depth-first
+ * with world matrices matching the product of locals up each parent chain.
+ */
+static void EGL_HierarchyRandomTest(EGL_Test *T) {
+	EGL_DECLARE_TEST;
+
+	EGL_Hierarchy h;
+	if (!EGL_HierarchyInit(&h, NODES)) {
+		EGL_DECLARE_ERROR("Failed to allocate %d nodes.", NODES);
+		return;
+	}
+	static uint32_t parents[NODES];
+	static float locals[NODES][16];
+
+	uint32_t state[4] = {0,0,0,0};
+	EGL_Seed(state, 34);
+	for (uint32_t i = 0; i < NODES; i++) {
+		const uint32_t parent = (i == 0 || EGL_RandFloat(state) < 0.05f) ? EGL_HIERARCHY_NONE : (uint32_t)EGL_RandInt(state, 0, (int)i);
+		random_local(state, locals[i]);
+		parents[i] = parent;
+		if (EGL_HierarchyAdd(&h, parent, locals[i]) != i) {
+			EGL_DECLARE_ERROR("Node %u got the wrong id.", i);
+			EGL_HierarchyFree(&h);
+			return;
+		}
+	}
+	EGL_HierarchyUpdate(&h);
+	float error = compare(&h, parents, locals);
+	if (!check_order(&h) || error > 1e-4f) {
+		EGL_DECLARE_ERROR("After adding, worlds are off by %g.", error);
+	}
+
+	const float *local = h.local;
+	const float *world = h.world;
+	for (int round = 0; round < 200 && T->error_count < ERRORS_MAX - 1; round++) {
+		const uint32_t node = (uint32_t)EGL_RandInt(state, 0, NODES);
+		if (EGL_RandFloat(state) < 0.5f) {
+			const uint32_t parent = (EGL_RandFloat(state) < 0.1f) ? EGL_HIERARCHY_NONE : (uint32_t)EGL_RandInt(state, 0, NODES);
+			bool inside = false;
+			for (uint32_t p = parent; p != EGL_HIERARCHY_NONE && !inside; p = parents[p]) {
+				inside = (p == node);
+			}
+			if (EGL_HierarchyReparent(&h, node, parent) == inside) {
+				EGL_DECLARE_ERROR("Round %d: moving %u under %u should %s.", round, node, parent, inside ? "fail" : "succeed");
+			}
+			if (!inside) {
+				parents[node] = parent;
+			}
+		} else {
+			random_local(state, locals[node]);
+			EGL_HierarchySetLocal(&h, node, locals[node]);
+		}
+
+		/* Let several edits pile up between updates */
+		if (round % 3 == 2) {
+			EGL_HierarchyUpdate(&h);
+			error = compare(&h, parents, locals);
+			if (!check_order(&h) || error > 1e-4f) {
+				EGL_DECLARE_ERROR("Round %d: worlds are off by %g.", round, error);
+			}
+		}
+	}
+	if (h.local != local || h.world != world) {
+		EGL_DECLARE_ERROR("Reparenting reallocated the arrays of %u nodes.", h.count);
+	}
+
+	EGL_HierarchyFree(&h);
+}
+
+/**
+ * An update only touches dirty subtrees, and a full hierarchy rejects new nodes.
+ */
+static void EGL_HierarchyDirtyTest(EGL_Test *T) {
+	EGL_DECLARE_TEST;
+
+	EGL_Hierarchy h;
+	EGL_HierarchyInit(&h, 4);
+	float m[16] = {1,0,0,0, 0,1,0,0, 0,0,1,0, 0,0,0,1};
+	const uint32_t a = EGL_HierarchyAdd(&h, EGL_HIERARCHY_NONE, m);
+	const uint32_t b = EGL_HierarchyAdd(&h, EGL_HIERARCHY_NONE, m);
+	m[12] = 1.0f;
+	const uint32_t a1 = EGL_HierarchyAdd(&h, a, m);
+	const uint32_t b1 = EGL_HierarchyAdd(&h, b, m);
+	EGL_HierarchyUpdate(&h);
+	if (EGL_HierarchyAdd(&h, a, m) != EGL_HIERARCHY_NONE) {
+		EGL_DECLARE_ERROR("Added a node past capacity %u.", h.capacity);
+	}
+
+	/* Scribble on b's subtree; an update of a alone must leave it be */
+	h.world[h.slot[b1] * 16 + 12] = 99.0f;
+	m[12] = 2.0f;
+	EGL_HierarchySetLocal(&h, a, m);
+	EGL_HierarchyUpdate(&h);
+	if (EGL_HierarchyWorld(&h, a1)[12] != 3.0f || EGL_HierarchyWorld(&h, b1)[12] != 99.0f) {
+		EGL_DECLARE_ERROR("Child of a is at %f and b's clean child at %f.", EGL_HierarchyWorld(&h, a1)[12], EGL_HierarchyWorld(&h, b1)[12]);
+	}
+
+	/* Moving b under a1 recomputes b's subtree */
+	if (!EGL_HierarchyReparent(&h, b, a1) || EGL_HierarchyReparent(&h, a, b1)) {
+		EGL_DECLARE_ERROR("Reparenting %u under %u failed or %u under its own descendant succeeded.", b, a1, a);
+	}
+	EGL_HierarchyUpdate(&h);
+	if (EGL_HierarchyWorld(&h, b1)[12] != 4.0f) {
+		EGL_DECLARE_ERROR("Moved subtree is at %f.", EGL_HierarchyWorld(&h, b1)[12]);
+	}
+
+	EGL_HierarchyFree(&h);
+}
+
+
+void EGL_HierarchyTest(EGL_TestModule *M) {
+	EGL_DECLARE_MODULE(EGL_hierarchy);
+
+	EGL_RUN_TEST(EGL_HierarchyRandomTest);
+	EGL_RUN_TEST(EGL_HierarchyDirtyTest);
+}
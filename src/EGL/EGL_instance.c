@@ -0,0 +1,179 @@
+#include <EGL/EGL_instance.h>
+#include <EGL/EGL_sort.h>
+#include <EGL/EGL_memory.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+
+static inline int16_t snorm16(float v) {
+	const float clamped = (v < -1.0f) ? -1.0f : (v > 1.0f) ? 1.0f : v;
+	return (int16_t)(clamped * 32767.0f + ((clamped < 0.0f) ? -0.5f : 0.5f));
+}
+
+static void pack_one(const EGL_InstanceSource *s, const float eye[3], uint64_t group, uint32_t i, EGL_Instance *out, uint64_t *keys) {
+	EGL_Instance *instance = &out[i];
+	instance->position[0] = s->x[i];
+	instance->position[1] = s->y[i];
+	instance->position[2] = s->z[i];
+	instance->scale = s->scale ? s->scale[i] : 1.0f;
+	if (s->rotation_x) {
+		instance->rotation[0] = snorm16(s->rotation_x[i]);
+		instance->rotation[1] = snorm16(s->rotation_y[i]);
+		instance->rotation[2] = snorm16(s->rotation_z[i]);
+		instance->rotation[3] = snorm16(s->rotation_w[i]);
+	} else {
+		instance->rotation[0] = instance->rotation[1] = instance->rotation[2] = 0;
+		instance->rotation[3] = INT16_MAX;
+	}
+	instance->color = s->color ? s->color[i] : EGL_INSTANCE_WHITE;
+	instance->phase = s->phase ? s->phase[i] : 0.0f;
+
+	const float dx = s->x[i] - eye[0], dy = s->y[i] - eye[1], dz = s->z[i] - eye[2];
+	keys[i] = group | EGL_DrawKey(0, 0, dx * dx + dy * dy + dz * dz);
+}
+
+#ifdef __SSE2__
+/* Rounds half away from zero like snorm16: add a half of the value's sign, then truncate */
+static __m128i snorm16_four(const float *v, uint32_t i) {
+	const __m128 clamped = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(v + i), _mm_set1_ps(-1.0f)), _mm_set1_ps(1.0f));
+	const __m128 half = _mm_or_ps(_mm_and_ps(clamped, _mm_set1_ps(-0.0f)), _mm_set1_ps(0.5f));
+	return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(clamped, _mm_set1_ps(32767.0f)), half));
+}
+
+/* Four instances at once: transpose position and scale, and interleave the rest into place */
+static void pack_four(const EGL_InstanceSource *s, const float eye[3], uint64_t group, uint32_t i, EGL_Instance *out, uint64_t *keys) {
+	__m128 x = _mm_loadu_ps(s->x + i), y = _mm_loadu_ps(s->y + i), z = _mm_loadu_ps(s->z + i);
+	__m128 scale = s->scale ? _mm_loadu_ps(s->scale + i) : _mm_set1_ps(1.0f);
+
+	const __m128 dx = _mm_sub_ps(x, _mm_set1_ps(eye[0]));
+	const __m128 dy = _mm_sub_ps(y, _mm_set1_ps(eye[1]));
+	const __m128 dz = _mm_sub_ps(z, _mm_set1_ps(eye[2]));
+	const __m128i depth = _mm_castps_si128(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)));
+	const __m128i high = _mm_set1_epi64x((long long)group);
+	_mm_storeu_si128((__m128i *)(keys + i), _mm_or_si128(high, _mm_unpacklo_epi32(depth, _mm_setzero_si128())));
+	_mm_storeu_si128((__m128i *)(keys + i + 2), _mm_or_si128(high, _mm_unpackhi_epi32(depth, _mm_setzero_si128())));
+
+	_MM_TRANSPOSE4_PS(x, y, z, scale);
+
+	/* Quaternions to (x0 y0 z0 w0 x1 y1 z1 w1) and (x2 ... w3), 16 bits each */
+	__m128i q01 = _mm_set_epi16(INT16_MAX, 0, 0, 0, INT16_MAX, 0, 0, 0), q23 = q01;
+	if (s->rotation_x) {
+		const __m128i xy = _mm_packs_epi32(snorm16_four(s->rotation_x, i), snorm16_four(s->rotation_y, i));
+		const __m128i zw = _mm_packs_epi32(snorm16_four(s->rotation_z, i), snorm16_four(s->rotation_w, i));
+		const __m128i xyxy = _mm_unpacklo_epi16(xy, _mm_srli_si128(xy, 8));
+		const __m128i zwzw = _mm_unpacklo_epi16(zw, _mm_srli_si128(zw, 8));
+		q01 = _mm_unpacklo_epi32(xyxy, zwzw);
+		q23 = _mm_unpackhi_epi32(xyxy, zwzw);
+	}
+	const __m128i color = s->color ? _mm_loadu_si128((const __m128i *)(s->color + i)) : _mm_set1_epi32((int)EGL_INSTANCE_WHITE);
+	const __m128i phase = s->phase ? _mm_castps_si128(_mm_loadu_ps(s->phase + i)) : _mm_setzero_si128();
+	const __m128i cp01 = _mm_unpacklo_epi32(color, phase), cp23 = _mm_unpackhi_epi32(color, phase);
+
+	float *o = (float *)(out + i);
+	_mm_storeu_ps(o, x);
+	_mm_storeu_si128((__m128i *)(o + 4), _mm_unpacklo_epi64(q01, cp01));
+	_mm_storeu_ps(o + 8, y);
+	_mm_storeu_si128((__m128i *)(o + 12), _mm_unpackhi_epi64(q01, cp01));
+	_mm_storeu_ps(o + 16, z);
+	_mm_storeu_si128((__m128i *)(o + 20), _mm_unpacklo_epi64(q23, cp23));
+	_mm_storeu_ps(o + 24, scale);
+	_mm_storeu_si128((__m128i *)(o + 28), _mm_unpackhi_epi64(q23, cp23));
+}
+#endif
+
+
+bool EGL_InstanceBatchInit(EGL_InstanceBatch *b, uint32_t capacity, uint32_t draws_max) {
+	memset(b, 0, sizeof(*b));
+	b->instances = (EGL_Instance *)EGL_malloc((size_t)capacity * sizeof(EGL_Instance));
+	b->unsorted = (EGL_Instance *)EGL_malloc((size_t)capacity * sizeof(EGL_Instance));
+	b->keys = (uint64_t *)EGL_malloc((size_t)capacity * sizeof(uint64_t));
+	b->keys_tmp = (uint64_t *)EGL_malloc((size_t)capacity * sizeof(uint64_t));
+	b->order = (uint32_t *)EGL_malloc((size_t)capacity * sizeof(uint32_t));
+	b->order_tmp = (uint32_t *)EGL_malloc((size_t)capacity * sizeof(uint32_t));
+	b->sort_scratch = EGL_malloc(EGL_RadixSortScratchSize());
+	b->draws = (EGL_DrawBatch *)EGL_malloc((size_t)draws_max * sizeof(EGL_DrawBatch));
+	b->capacity = capacity;
+	b->draws_max = draws_max;
+	if (!b->instances || !b->unsorted || !b->keys || !b->keys_tmp || !b->order || !b->order_tmp || !b->sort_scratch || !b->draws) {
+		EGL_InstanceBatchFree(b);
+		return false;
+	}
+	return true;
+}
+
+void EGL_InstanceBatchFree(EGL_InstanceBatch *b) {
+	EGL_free(b->instances);
+	EGL_free(b->unsorted);
+	EGL_free(b->keys);
+	EGL_free(b->keys_tmp);
+	EGL_free(b->order);
+	EGL_free(b->order_tmp);
+	EGL_free(b->sort_scratch);
+	EGL_free(b->draws);
+	memset(b, 0, sizeof(*b));
+}
+
+void EGL_InstanceBatchBegin(EGL_InstanceBatch *b, const float eye[3]) {
+	b->count = 0;
+	b->draw_count = 0;
+	memcpy(b->eye, eye, sizeof(b->eye));
+}
+
+bool EGL_InstanceBatchAdd(EGL_InstanceBatch *b, uint16_t mesh, uint16_t material, const EGL_InstanceSource *source) {
+	if (source->count > b->capacity - b->count) {
+		return false;
+	}
+	EGL_InstanceSource s = *source;
+	if (!s.rotation_x || !s.rotation_y || !s.rotation_z || !s.rotation_w) {
+		s.rotation_x = NULL;
+	}
+	const uint64_t group = EGL_DrawKey(material, mesh, 0.0f);
+	EGL_Instance *out = b->unsorted + b->count;
+	uint64_t *keys = b->keys + b->count;
+	uint32_t *order = b->order + b->count;
+
+	uint32_t i = 0;
+#ifdef __SSE2__
+	for (; i + 4 <= s.count; i += 4) {
+		pack_four(&s, b->eye, group, i, out, keys);
+	}
+#endif
+	for (; i < s.count; i++) {
+		pack_one(&s, b->eye, group, i, out, keys);
+	}
+	for (i = 0; i < s.count; i++) {
+		order[i] = b->count + i;
+	}
+	b->count += s.count;
+	return true;
+}
+
+bool EGL_InstanceBatchBuild(EGL_InstanceBatch *b) {
+	b->draw_count = 0;
+	if (!EGL_RadixSort(b->keys, b->order, b->keys_tmp, b->order_tmp, b->count, b->sort_scratch)) {
+		return false;
+	}
+
+	/* Gather in key order, starting a new draw wherever the mesh or material changes */
+	for (uint32_t i = 0; i < b->count; i++) {
+		b->instances[i] = b->unsorted[b->order[i]];
+		const uint32_t group = (uint32_t)(b->keys[i] >> 32);
+		if (i == 0 || group != (uint32_t)(b->keys[i - 1] >> 32)) {
+			if (b->draw_count == b->draws_max) {
+				return false;
+			}
+			b->draws[b->draw_count++] = (EGL_DrawBatch){
+				.mesh = (uint16_t)group,
+				.material = (uint16_t)(group >> 16),
+				.first = i,
+			};
+		}
+		b->draws[b->draw_count - 1].count++;
+	}
+	return true;
+}
@@ -0,0 +1,129 @@
+#include <EGL/EGL_bench.h>
+#include <EGL/EGL_instance.h>
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+#define INSTANCES_MAX (1u << 17)
+#define GROUPS 8 // Meshes and materials, a group of each per frame.
+
+
+static uint32_t lcg(uint32_t *state) {
+	*state = *state * 1664525u + 1013904223u;
+	return *state >> 8;
+}
+
+static int compare_keys(const void *a, const void *b) {
+	const uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+	return (x > y) - (x < y);
+}
+
+
+typedef struct {
+	float *x, *y, *z, *rotation[4], *scale, *phase;
+	uint32_t *color;
+} Swarm;
+
+
+static void pack(EGL_InstanceBatch *b, const Swarm *s, uint32_t n) {
+	const float eye[3] = { 0.0f, 0.0f, -3.0f };
+	EGL_InstanceBatchBegin(b, eye);
+	const uint32_t group = n / GROUPS;
+	for (uint32_t g = 0; g < GROUPS; g++) {
+		const uint32_t at = g * group;
+		const EGL_InstanceSource source = {
+			.x = s->x + at, .y = s->y + at, .z = s->z + at,
+			.rotation_x = s->rotation[0] + at, .rotation_y = s->rotation[1] + at,
+			.rotation_z = s->rotation[2] + at, .rotation_w = s->rotation[3] + at,
+			.scale = s->scale + at, .color = s->color + at, .phase = s->phase + at,
+			.count = group,
+		};
+		EGL_InstanceBatchAdd(b, (uint16_t)(g % 3), (uint16_t)(g / 3), &source);
+	}
+}
+
+
+void EGL_InstanceBench(void) {
+	EGL_DECLARE_BENCH(EGL_instance);
+
+	Swarm s;
+	float *floats = (float *)malloc((size_t)INSTANCES_MAX * 9 * sizeof(float));
+	uint32_t *colors = (uint32_t *)malloc((size_t)INSTANCES_MAX * sizeof(uint32_t));
+	EGL_InstanceBatch b;
+	if (!floats || !colors || !EGL_InstanceBatchInit(&b, INSTANCES_MAX, GROUPS)) {
+		printf(" failed to allocate\n");
+		free(floats);
+		free(colors);
+		return;
+	}
+	s.x = floats;
+	s.y = s.x + INSTANCES_MAX;
+	s.z = s.y + INSTANCES_MAX;
+	for (int c = 0; c < 4; c++) {
+		s.rotation[c] = s.z + (size_t)(c + 1) * INSTANCES_MAX;
+	}
+	s.scale = s.rotation[3] + INSTANCES_MAX;
+	s.phase = s.scale + INSTANCES_MAX;
+	s.color = colors;
+
+	/* Objects on a unit sphere, facing random ways */
+	uint32_t state = 48;
+	for (uint32_t i = 0; i < INSTANCES_MAX; i++) {
+		float v[3], q[4], length = 0.0f, norm = 0.0f;
+		for (int c = 0; c < 3; c++) {
+			v[c] = (float)lcg(&state) / (float)(1 << 24) * 2.0f - 1.0f;
+			length += v[c] * v[c];
+		}
+		for (int c = 0; c < 4; c++) {
+			q[c] = (float)lcg(&state) / (float)(1 << 24) * 2.0f - 1.0f;
+			norm += q[c] * q[c];
+		}
+		length = (length > 0.0f) ? 1.0f / sqrtf(length) : 0.0f;
+		norm = (norm > 0.0f) ? 1.0f / sqrtf(norm) : 0.0f;
+		s.x[i] = v[0] * length;
+		s.y[i] = v[1] * length;
+		s.z[i] = v[2] * length;
+		for (int c = 0; c < 4; c++) {
+			s.rotation[c][i] = q[c] * norm;
+		}
+		s.scale[i] = 0.02f + (float)(lcg(&state) % 100) * 0.0002f;
+		s.phase[i] = (float)(lcg(&state) % 1000) * 0.001f;
+		s.color[i] = lcg(&state) | 0xFF000000u;
+	}
+
+#define RUN(name, n, ...) do { \
+		double best = 1e30; \
+		for (int rep = 0; rep < EGL_BENCH_REPEATS; rep++) { \
+			double begin = EGL_BenchNow(); \
+			__VA_ARGS__; \
+			double elapsed = EGL_BenchNow() - begin; \
+			best = (elapsed < best) ? elapsed : best; \
+		} \
+		EGL_BenchReport(name, best, (double)(n), "instance"); \
+	} while (0)
+
+	const uint32_t sizes[2] = { 4096, INSTANCES_MAX };
+	for (int k = 0; k < 2; k++) {
+		const uint32_t n = sizes[k];
+		printf(" %u instances, %d draws\n", n, GROUPS);
+
+		RUN("  pack", n, pack(&b, &s, n));
+
+		/* Sort freshly packed keys every repeat, packing outside the clock */
+		RUN("  radix sort and split", n, pack(&b, &s, n); begin = EGL_BenchNow(); EGL_InstanceBatchBuild(&b));
+		EGL_BENCH_SINK += b.draw_count;
+
+		RUN("  qsort keys, for comparison", n, pack(&b, &s, n); begin = EGL_BenchNow(); qsort(b.keys, b.count, sizeof(uint64_t), compare_keys));
+		EGL_BENCH_SINK += b.keys[0];
+
+		RUN("  frame: pack, sort and split", n, pack(&b, &s, n); EGL_InstanceBatchBuild(&b));
+		EGL_BENCH_SINK += b.instances[0].color;
+	}
+#undef RUN
+
+	EGL_InstanceBatchFree(&b);
+	free(floats);
+	free(colors);
+}
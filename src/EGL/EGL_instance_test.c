@@ -0,0 +1,222 @@
+#include <EGL/EGL_testing.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+#define CAPACITY 64
+#define DRAWS 3
+#define PACKED 7 // Four at a time, then three one at a time.
+#define HALVES 16 // Rotations exactly halfway between two snorm16 steps, all packed four at a time.
+
+
+/**
+ * Instances are packed from their SoA arrays, four at a time and then one at
+ * a time, with identity rotation, unit scale, white and phase 0 for the
+ * arrays left out.
+ */
+static void EGL_InstancePackTest(EGL_Test *T) {
+	EGL_DECLARE_TEST;
+
+	EGL_InstanceBatch b;
+	if (!EGL_InstanceBatchInit(&b, CAPACITY, DRAWS)) {
+		EGL_DECLARE_ERROR("Failed to set up a batch of %d instances.", CAPACITY);
+		return;
+	}
+
+	/* Farther from the eye with each index, so the sort keeps them in order */
+	const float eye[3] = { 0.0f, 0.0f, 0.0f };
+	float x[PACKED], y[PACKED], z[PACKED], qx[PACKED], qy[PACKED], qz[PACKED], qw[PACKED], scale[PACKED], phase[PACKED];
+	uint32_t color[PACKED];
+	for (int i = 0; i < PACKED; i++) {
+		x[i] = 1.0f + (float)i;
+		y[i] = -2.0f * (float)i;
+		z[i] = 0.5f;
+		qx[i] = (i % 2) ? -0.6f : 0.0f;
+		qy[i] = (i % 3) ? 0.0f : 0.6f;
+		qz[i] = 1.5f; // Clamped to 1
+		qw[i] = (i % 2) ? 0.8f : -0.8f;
+		scale[i] = 0.25f * (float)(i + 1);
+		phase[i] = 0.125f * (float)i;
+		color[i] = 0xFF000000u | (uint32_t)i * 0x010203u;
+	}
+	EGL_InstanceBatchBegin(&b, eye);
+	const EGL_InstanceSource bare = { .x = x, .y = y, .z = z, .count = PACKED };
+	const EGL_InstanceSource full = {
+		.x = x, .y = y, .z = z,
+		.rotation_x = qx, .rotation_y = qy, .rotation_z = qz, .rotation_w = qw,
+		.scale = scale, .color = color, .phase = phase, .count = PACKED,
+	};
+	if (!EGL_InstanceBatchAdd(&b, 0, 0, &bare) || !EGL_InstanceBatchAdd(&b, 0, 1, &full) || !EGL_InstanceBatchBuild(&b)) {
+		EGL_DECLARE_ERROR("Failed to build %u instances.", b.count);
+		EGL_InstanceBatchFree(&b);
+		return;
+	}
+
+	for (int k = 0; k < PACKED; k++) {
+		const EGL_Instance *i = &b.instances[k];
+		if (i->position[0] != x[k] || i->position[1] != y[k] || i->position[2] != z[k] || i->scale != 1.0f ||
+			i->rotation[0] != 0 || i->rotation[1] != 0 || i->rotation[2] != 0 || i->rotation[3] != 32767 ||
+			i->color != EGL_INSTANCE_WHITE || i->phase != 0.0f) {
+			EGL_DECLARE_ERROR("Bare instance %d was packed with scale %f and rotation w %d.", k, i->scale, i->rotation[3]);
+		}
+		i = &b.instances[PACKED + k];
+		const int16_t w = (k % 2) ? 26214 : -26214;
+		if (i->position[0] != x[k] || i->position[1] != y[k] || i->position[2] != z[k] || i->scale != scale[k] ||
+			i->rotation[0] != ((k % 2) ? -19660 : 0) || i->rotation[1] != ((k % 3) ? 0 : 19660) || i->rotation[2] != 32767 || i->rotation[3] != w ||
+			i->color != color[k] || i->phase != phase[k]) {
+			EGL_DECLARE_ERROR("Full instance %d was packed with rotation (%d, %d, %d, %d).", k, i->rotation[0], i->rotation[1], i->rotation[2], i->rotation[3]);
+		}
+	}
+	EGL_InstanceBatchFree(&b);
+}
+
+/**
+ * Rotation components exactly halfway between two snorm16 steps round away
+ * from zero, the same four at a time as one at a time.
+ */
+static void EGL_InstanceRoundingTest(EGL_Test *T) {
+	EGL_DECLARE_TEST;
+
+	/* Find floats whose product with 32767 is exactly k + 0.5 */
+	float halves[HALVES];
+	int16_t rounded[HALVES];
+	int found = 0;
+	for (int k = 0; k < 32767 && found < HALVES; k++) {
+		const float guess = (float)((k + 0.5) / 32767.0);
+		const float candidates[3] = { nextafterf(guess, 0.0f), guess, nextafterf(guess, 1.0f) };
+		for (int c = 0; c < 3; c++) {
+			if (candidates[c] * 32767.0f == (float)k + 0.5f) {
+				halves[found] = candidates[c];
+				rounded[found++] = (int16_t)(k + 1);
+				break;
+			}
+		}
+	}
+	if (found < HALVES) {
+		EGL_DECLARE_ERROR("Found only %d halfway rotations.", found);
+		return;
+	}
+
+	EGL_InstanceBatch b;
+	if (!EGL_InstanceBatchInit(&b, CAPACITY, DRAWS)) {
+		EGL_DECLARE_ERROR("Failed to set up a batch of %d instances.", CAPACITY);
+		return;
+	}
+	const float eye[3] = { 0.0f, 0.0f, 0.0f };
+	float x[HALVES], y[HALVES], z[HALVES], negative[HALVES];
+	for (int i = 0; i < HALVES; i++) {
+		x[i] = 1.0f + (float)i;
+		y[i] = z[i] = 0.0f;
+		negative[i] = -halves[i];
+	}
+	EGL_InstanceBatchBegin(&b, eye);
+	const EGL_InstanceSource s = {
+		.x = x, .y = y, .z = z,
+		.rotation_x = halves, .rotation_y = negative, .rotation_z = negative, .rotation_w = halves, .count = HALVES,
+	};
+	if (!EGL_InstanceBatchAdd(&b, 0, 0, &s) || !EGL_InstanceBatchBuild(&b)) {
+		EGL_DECLARE_ERROR("Failed to build %u instances.", b.count);
+		EGL_InstanceBatchFree(&b);
+		return;
+	}
+
+	for (int k = 0; k < HALVES; k++) {
+		const int16_t *q = b.instances[k].rotation;
+		if (q[0] != rounded[k] || q[1] != -rounded[k] || q[2] != -rounded[k] || q[3] != rounded[k]) {
+			EGL_DECLARE_ERROR("%.9g * 32767 packed to (%d, %d, %d, %d), expected %d.", (double)halves[k], q[0], q[1], q[2], q[3], rounded[k]);
+		}
+	}
+	EGL_InstanceBatchFree(&b);
+}
+
+/**
+ * Draws come out grouped by material then mesh, each a contiguous run of
+ * its own instances, nearest first; groups that would pass the capacity or
+ * the number of draws are refused.
+ */
+static void EGL_InstanceDrawsTest(EGL_Test *T) {
+	EGL_DECLARE_TEST;
+
+	EGL_InstanceBatch b;
+	if (!EGL_InstanceBatchInit(&b, CAPACITY, DRAWS)) {
+		EGL_DECLARE_ERROR("Failed to set up a batch of %d instances.", CAPACITY);
+		return;
+	}
+	float x[CAPACITY], y[CAPACITY], z[CAPACITY], phase[CAPACITY];
+	uint32_t state = 48;
+	for (int i = 0; i < CAPACITY; i++) {
+		x[i] = (float)((state = state * 1664525u + 1013904223u) >> 8) / (float)(1 << 24) * 100.0f - 50.0f;
+		y[i] = (float)((state = state * 1664525u + 1013904223u) >> 8) / (float)(1 << 24) * 100.0f - 50.0f;
+		z[i] = 0.0f;
+		phase[i] = (float)i; // Tags each instance with its index
+	}
+
+	/* Added out of order: (material 1, mesh 0), (0, 2), (0, 1) */
+	const float eye[3] = { 10.0f, -5.0f, 3.0f };
+	EGL_InstanceBatchBegin(&b, eye);
+	const uint16_t groups[DRAWS][2] = { { 0, 1 }, { 2, 0 }, { 1, 0 } }; // mesh, material
+	const uint32_t counts[DRAWS] = { 20, 15, 25 };
+	uint32_t first = 0;
+	for (int g = 0; g < DRAWS; g++) {
+		const EGL_InstanceSource s = { .x = x + first, .y = y + first, .z = z + first, .phase = phase + first, .count = counts[g] };
+		if (!EGL_InstanceBatchAdd(&b, groups[g][0], groups[g][1], &s)) {
+			EGL_DECLARE_ERROR("Failed to add group %d.", g);
+		}
+		first += counts[g];
+	}
+	const EGL_InstanceSource over = { .x = x, .y = y, .z = z, .count = CAPACITY - first + 1 };
+	if (EGL_InstanceBatchAdd(&b, 3, 0, &over) || b.count != first) {
+		EGL_DECLARE_ERROR("Added %u instances to a batch of %d.", b.count, CAPACITY);
+	}
+	if (!EGL_InstanceBatchBuild(&b) || b.draw_count != DRAWS) {
+		EGL_DECLARE_ERROR("Built %u draws, not %d.", b.draw_count, DRAWS);
+		EGL_InstanceBatchFree(&b);
+		return;
+	}
+
+	const uint16_t expected[DRAWS][2] = { { 1, 0 }, { 2, 0 }, { 0, 1 } };
+	const uint32_t starts[DRAWS] = { 35, 20, 0 }; // Where each group's sources begin
+	const uint32_t sizes[DRAWS] = { 25, 15, 20 };
+	uint32_t next = 0;
+	for (uint32_t d = 0; d < b.draw_count; d++) {
+		const EGL_DrawBatch *draw = &b.draws[d];
+		if (draw->mesh != expected[d][0] || draw->material != expected[d][1] || draw->first != next || draw->count != sizes[d]) {
+			EGL_DECLARE_ERROR("Draw %u is mesh %u, material %u.", d, draw->mesh, draw->material);
+			continue;
+		}
+		float last = -1.0f;
+		for (uint32_t k = draw->first; k < draw->first + draw->count; k++) {
+			const EGL_Instance *i = &b.instances[k];
+			const uint32_t source = (uint32_t)i->phase;
+			const float dx = i->position[0] - eye[0], dy = i->position[1] - eye[1], dz = i->position[2] - eye[2];
+			const float distance = dx * dx + dy * dy + dz * dz;
+			if (source < starts[d] || source >= starts[d] + sizes[d] || x[source] != i->position[0] || distance < last) {
+				EGL_DECLARE_ERROR("Instance %u of draw %u came from source %u.", k, d, source);
+				break;
+			}
+			last = distance;
+		}
+		next += draw->count;
+	}
+
+	/* A fourth mesh needs a fourth draw */
+	EGL_InstanceBatchBegin(&b, eye);
+	for (uint16_t mesh = 0; mesh <= DRAWS; mesh++) {
+		const EGL_InstanceSource s = { .x = x, .y = y, .z = z, .count = 1 };
+		EGL_InstanceBatchAdd(&b, mesh, 0, &s);
+	}
+	if (EGL_InstanceBatchBuild(&b)) {
+		EGL_DECLARE_ERROR("Built %u draws, past %d.", b.draw_count, DRAWS);
+	}
+	EGL_InstanceBatchFree(&b);
+}
+
+
+void EGL_InstanceTest(EGL_TestModule *M) {
+	EGL_DECLARE_MODULE(EGL_instance);
+
+	EGL_RUN_TEST(EGL_InstancePackTest);
+	EGL_RUN_TEST(EGL_InstanceRoundingTest);
+	EGL_RUN_TEST(EGL_InstanceDrawsTest);
+}
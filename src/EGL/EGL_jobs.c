@@ -0,0 +1,377 @@
+#define _GNU_SOURCE
+
+#include <EGL/EGL_jobs.h>
+#include <EGL/EGL_parallel.h>
+#include <EGL/EGL_memory.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <sched.h>
+#include <unistd.h>
+#endif
+
+
+#define MASK (EGL_JOBS_MAX - 1)
+#define SPINS 64 // Failed searches before an idle worker goes to sleep.
+
+
+typedef struct {
+	EGL_RangeFunc func;
+	void *data;
+	size_t grain;
+} ParallelFor;
+
+
+/* The worker running on this thread, if any */
+static _Thread_local EGL_JobWorker *CURRENT = NULL;
+
+
+static EGL_JobWorker *current(EGL_Jobs *s) {
+	return (CURRENT && CURRENT->system == s) ? CURRENT : NULL;
+}
+
+/*
+ * Chase-Lev deque with the C11 orderings from N. M. Lê et al., "Correct and
+ * Efficient Work-Stealing for Weak Memory Models". The owner pushes and takes
+ * at the bottom; thieves race each other (and the owner for the last job) at
+ * the top with a compare-and-swap.
+ */
+
+static bool push(EGL_JobDeque *d, EGL_Job *job) {
+	const int64_t b = atomic_load_explicit(&d->bottom, memory_order_relaxed);
+	const int64_t t = atomic_load_explicit(&d->top, memory_order_acquire);
+	if (b - t >= EGL_JOBS_MAX) {
+		return false;
+	}
+	atomic_store_explicit(&d->slots[b & MASK], job, memory_order_relaxed);
+	atomic_store_explicit(&d->bottom, b + 1, memory_order_release);
+	return true;
+}
+
+static EGL_Job *take(EGL_JobDeque *d) {
+	const int64_t b = atomic_load_explicit(&d->bottom, memory_order_relaxed) - 1;
+	atomic_store_explicit(&d->bottom, b, memory_order_relaxed);
+	atomic_thread_fence(memory_order_seq_cst);
+	int64_t t = atomic_load_explicit(&d->top, memory_order_relaxed);
+
+	if (t > b) {
+		atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+		return NULL;
+	}
+	EGL_Job *job = atomic_load_explicit(&d->slots[b & MASK], memory_order_relaxed);
+	if (t == b) {
+		/* The last job: beat the thieves to it or leave it to them */
+		if (!atomic_compare_exchange_strong_explicit(&d->top, &t, t + 1, memory_order_seq_cst, memory_order_relaxed)) {
+			job = NULL;
+		}
+		atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+	}
+	return job;
+}
+
+static EGL_Job *steal(EGL_JobDeque *d) {
+	int64_t t = atomic_load_explicit(&d->top, memory_order_acquire);
+	atomic_thread_fence(memory_order_seq_cst);
+	const int64_t b = atomic_load_explicit(&d->bottom, memory_order_acquire);
+	if (t >= b) {
+		return NULL;
+	}
+	EGL_Job *job = atomic_load_explicit(&d->slots[t & MASK], memory_order_relaxed);
+	if (!atomic_compare_exchange_strong_explicit(&d->top, &t, t + 1, memory_order_seq_cst, memory_order_relaxed)) {
+		return NULL;
+	}
+	return job;
+}
+
+/* Own jobs first, newest first, then the oldest job of the others starting at a random one */
+static EGL_Job *find(EGL_Jobs *s, EGL_JobWorker *w) {
+	EGL_Job *job = take(&w->deque);
+	if (job || s->worker_count == 1) {
+		return job;
+	}
+
+	w->rng ^= w->rng << 13;
+	w->rng ^= w->rng >> 17;
+	w->rng ^= w->rng << 5;
+	const int first = (int)(w->rng % (uint32_t)s->worker_count);
+	for (int k = 0; k < s->worker_count; k++) {
+		const int victim = (first + k) % s->worker_count;
+		if (victim != w->index && (job = steal(&s->workers[victim].deque))) {
+			return job;
+		}
+	}
+	return NULL;
+}
+
+static bool has_work(EGL_Jobs *s) {
+	for (int i = 0; i < s->worker_count; i++) {
+		EGL_JobDeque *d = &s->workers[i].deque;
+		if (atomic_load(&d->top) < atomic_load(&d->bottom)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/* Read the parent first: once a job's count reaches 0 its slot may be reused. */
+static void finish(EGL_Job *job) {
+	while (job) {
+		EGL_Job *parent = job->parent;
+		if (atomic_fetch_sub_explicit(&job->unfinished, 1, memory_order_acq_rel) != 1) {
+			return;
+		}
+		job = parent;
+	}
+}
+
+static void execute(EGL_Jobs *s, EGL_Job *job) {
+	job->func(s, job, job->data);
+	finish(job);
+}
+
+/* Split off the right half until the chunk is small enough, then run the left. */
+static void parallel_for_job(EGL_Jobs *s, EGL_Job *job, void *data) {
+	const ParallelFor *p = (const ParallelFor *)data;
+	size_t begin = job->begin;
+	size_t end = job->end;
+	while (end - begin > p->grain) {
+		const size_t middle = begin + (end - begin) / 2;
+		EGL_Job *right = EGL_JobsCreate(s, parallel_for_job, data, job);
+		right->begin = middle;
+		right->end = end;
+		EGL_JobsRun(s, right);
+		end = middle;
+	}
+	p->func(p->data, begin, end);
+}
+
+static void pin(int index) {
+#ifdef __linux__
+	const long online = sysconf(_SC_NPROCESSORS_ONLN);
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET((online > 0) ? index % (int)online : 0, &set);
+	sched_setaffinity(0, sizeof(set), &set);
+#endif
+}
+
+static int work(void *arg) {
+	EGL_JobWorker *w = (EGL_JobWorker *)arg;
+	EGL_Jobs *s = w->system;
+	CURRENT = w;
+
+	/* EGL_JobsInit holds the mutex until worker_count is final */
+	mtx_lock(&s->mutex);
+	mtx_unlock(&s->mutex);
+	if (s->affinity == EGL_JOBS_AFFINITY_PIN) {
+		pin(w->index);
+	}
+
+	int idle = 0;
+	while (atomic_load_explicit(&s->running, memory_order_acquire)) {
+		EGL_Job *job = find(s, w);
+		if (job) {
+			execute(s, job);
+			idle = 0;
+		} else if (++idle < SPINS) {
+			thrd_yield();
+		} else {
+			/* Pairs with the fence in EGL_JobsRun: either this sees the job or the pusher sees the sleeper */
+			mtx_lock(&s->mutex);
+			atomic_fetch_add(&s->sleepers, 1);
+			if (atomic_load(&s->running) && !has_work(s)) {
+				cnd_wait(&s->wake, &s->mutex);
+			}
+			atomic_fetch_sub(&s->sleepers, 1);
+			mtx_unlock(&s->mutex);
+			idle = 0;
+		}
+	}
+	return 0;
+}
+
+static void free_workers(EGL_Jobs *s, int count) {
+	for (int i = 0; i < count; i++) {
+		EGL_free(s->workers[i].deque.slots);
+		free(s->workers[i].jobs);
+	}
+	EGL_free(s->workers);
+}
+
+
+bool EGL_JobsInit(EGL_Jobs *jobs, int threads, EGL_JobsAffinity affinity) {
+	memset(jobs, 0, sizeof(*jobs));
+	if (threads < 1) {
+		threads = EGL_ThreadCount();
+	}
+	if (threads > EGL_THREADS_MAX) {
+		threads = EGL_THREADS_MAX;
+	}
+	jobs->affinity = affinity;
+	atomic_init(&jobs->running, true);
+	atomic_init(&jobs->sleepers, 0);
+
+	jobs->workers = (EGL_JobWorker *)EGL_calloc((size_t)threads, sizeof(EGL_JobWorker));
+	if (!jobs->workers) {
+		return false;
+	}
+	for (int i = 0; i < threads; i++) {
+		EGL_JobWorker *w = &jobs->workers[i];
+		w->index = i;
+		w->system = jobs;
+		w->rng = 2463534242u + (uint32_t)i * 2654435769u;
+		atomic_init(&w->deque.top, 0);
+		atomic_init(&w->deque.bottom, 0);
+		w->deque.slots = (_Atomic(EGL_Job *) *)EGL_calloc(EGL_JOBS_MAX, sizeof(*w->deque.slots));
+		w->jobs = (EGL_Job *)aligned_alloc(_Alignof(EGL_Job), EGL_JOBS_MAX * sizeof(EGL_Job));
+		if (!w->deque.slots || !w->jobs) {
+			free_workers(jobs, i + 1);
+			memset(jobs, 0, sizeof(*jobs));
+			return false;
+		}
+		for (int k = 0; k < EGL_JOBS_MAX; k++) {
+			atomic_init(&w->jobs[k].unfinished, 0);
+		}
+	}
+	if (mtx_init(&jobs->mutex, mtx_plain) != thrd_success) {
+		free_workers(jobs, threads);
+		memset(jobs, 0, sizeof(*jobs));
+		return false;
+	}
+	if (cnd_init(&jobs->wake) != thrd_success) {
+		mtx_destroy(&jobs->mutex);
+		free_workers(jobs, threads);
+		memset(jobs, 0, sizeof(*jobs));
+		return false;
+	}
+
+	/* Shrink to the threads actually created before any worker starts looking for work */
+	mtx_lock(&jobs->mutex);
+	int spawned = 1;
+	for (int i = 1; i < threads; i++) {
+		if (thrd_create(&jobs->workers[i].thread, work, &jobs->workers[i]) != thrd_success) {
+			break;
+		}
+		spawned++;
+	}
+	jobs->worker_count = spawned;
+	mtx_unlock(&jobs->mutex);
+	for (int i = spawned; i < threads; i++) {
+		EGL_free(jobs->workers[i].deque.slots);
+		free(jobs->workers[i].jobs);
+	}
+
+	CURRENT = &jobs->workers[0];
+	return true;
+}
+
+void EGL_JobsFree(EGL_Jobs *jobs) {
+	if (!jobs->workers) {
+		return;
+	}
+	atomic_store_explicit(&jobs->running, false, memory_order_release);
+	mtx_lock(&jobs->mutex);
+	cnd_broadcast(&jobs->wake);
+	mtx_unlock(&jobs->mutex);
+	for (int i = 1; i < jobs->worker_count; i++) {
+		thrd_join(jobs->workers[i].thread, NULL);
+	}
+
+	if (current(jobs)) {
+		CURRENT = NULL;
+	}
+	cnd_destroy(&jobs->wake);
+	mtx_destroy(&jobs->mutex);
+	free_workers(jobs, jobs->worker_count);
+	memset(jobs, 0, sizeof(*jobs));
+}
+
+EGL_Job *EGL_JobsCreate(EGL_Jobs *jobs, EGL_JobFunc func, void *data, EGL_Job *parent) {
+	EGL_JobWorker *w = current(jobs);
+	if (!w) {
+		return NULL;
+	}
+
+	/*
+	 * Skip slots still in use (parents wait there for their children). Only if
+	 * all EGL_JOBS_MAX are in flight, help run jobs until one frees up.
+	 */
+	EGL_Job *job = &w->jobs[w->next_job++ & MASK];
+	for (uint32_t tried = 1; atomic_load_explicit(&job->unfinished, memory_order_acquire) != 0; tried++) {
+		if (tried % EGL_JOBS_MAX == 0) {
+			EGL_Job *other = find(jobs, w);
+			if (other) {
+				execute(jobs, other);
+			} else {
+				thrd_yield();
+			}
+		}
+		job = &w->jobs[w->next_job++ & MASK];
+	}
+
+	job->func = func;
+	job->data = data;
+	job->begin = 0;
+	job->end = 0;
+	job->parent = parent;
+	atomic_store_explicit(&job->unfinished, 1, memory_order_relaxed);
+	if (parent) {
+		atomic_fetch_add_explicit(&parent->unfinished, 1, memory_order_relaxed);
+	}
+	return job;
+}
+
+bool EGL_JobsRun(EGL_Jobs *jobs, EGL_Job *job) {
+	EGL_JobWorker *w = current(jobs);
+	if (!w) {
+		return false;
+	}
+	if (!push(&w->deque, job)) {
+		execute(jobs, job);
+		return true;
+	}
+
+	atomic_thread_fence(memory_order_seq_cst);
+	if (atomic_load_explicit(&jobs->sleepers, memory_order_relaxed) > 0) {
+		mtx_lock(&jobs->mutex);
+		cnd_signal(&jobs->wake);
+		mtx_unlock(&jobs->mutex);
+	}
+	return true;
+}
+
+void EGL_JobsWait(EGL_Jobs *jobs, EGL_Job *job) {
+	EGL_JobWorker *w = current(jobs);
+	while (atomic_load_explicit(&job->unfinished, memory_order_acquire) != 0) {
+		EGL_Job *other = w ? find(jobs, w) : NULL;
+		if (other) {
+			execute(jobs, other);
+		} else {
+			thrd_yield();
+		}
+	}
+}
+
+void EGL_JobsParallelFor(EGL_Jobs *jobs, size_t n, size_t grain, EGL_RangeFunc func, void *data) {
+	if (n == 0) {
+		return;
+	}
+	EGL_JobWorker *w = current(jobs);
+	if (grain == 0) {
+		const size_t chunks = (size_t)(w ? jobs->worker_count : 1) * EGL_JOBS_GRAIN_SPLITS;
+		grain = (n + chunks - 1) / chunks;
+	}
+	if (!w || jobs->worker_count == 1 || n <= grain) {
+		func(data, 0, n);
+		return;
+	}
+
+	ParallelFor p = { .func = func, .data = data, .grain = grain };
+	EGL_Job *root = EGL_JobsCreate(jobs, parallel_for_job, &p, NULL);
+	root->begin = 0;
+	root->end = n;
+	execute(jobs, root);
+	EGL_JobsWait(jobs, root);
+}
@@ -0,0 +1,126 @@
+#include <EGL/EGL_bench.h>
+#include <EGL/EGL_jobs.h>
+#include <EGL/EGL_parallel.h>
+#include <EGL/EGL_transform.h>
+
+#include <math.h>
+#include <stdlib.h>
+
+
+#define SYNTHETIC 1000000 // Elements of the synthetic kernel.
+#define TRANSFORMS 100000
+#define SMALL 4096 // A batch small enough that dispatch overhead dominates.
+#define REPEATS 20
+
+
+typedef struct {
+	const float *in;
+	float *out;
+	size_t n;
+} Synthetic;
+
+
+static uint32_t lcg(uint32_t *state) {
+	*state = *state * 1664525u + 1013904223u;
+	return *state >> 8;
+}
+
+/* A few dozen flops per element with a dependency chain, so it is compute bound. */
+static void synthetic_range(void *data, size_t begin, size_t end) {
+	Synthetic *s = (Synthetic *)data;
+	for (size_t i = begin; i < end; i++) {
+		float x = s->in[i];
+		for (int k = 0; k < 8; k++) {
+			x = sqrtf(x * x + 1.0f) - 0.5f * x;
+		}
+		s->out[i] = x;
+	}
+}
+
+static void synthetic_kernel(void *data, int index, int count) {
+	Synthetic *s = (Synthetic *)data;
+	size_t begin, end;
+	EGL_ParallelRange(s->n, index, count, &begin, &end);
+	synthetic_range(data, begin, end);
+}
+
+static void update_range(void *data, size_t begin, size_t end) {
+	EGL_TransformBatchUpdateWords((EGL_TransformBatch *)data, begin, end);
+}
+
+static void mark_all(EGL_TransformBatch *batch) {
+	memset(batch->dirty, 0xff, sizeof(uint64_t) * (batch->count / 64));
+	for (uint32_t i = batch->count & ~63u; i < batch->count; i++) {
+		EGL_TransformBatchMarkDirty(batch, i);
+	}
+}
+
+
+void EGL_JobsBench(void) {
+	EGL_DECLARE_BENCH(EGL_jobs);
+
+	float *in = (float *)malloc(sizeof(float) * SYNTHETIC);
+	float *out = (float *)calloc(SYNTHETIC, sizeof(float));
+	EGL_TransformBatch batch;
+	if (!in || !out || !EGL_TransformBatchInit(&batch, TRANSFORMS)) {
+		printf(" %d elements: failed to allocate\n", SYNTHETIC);
+		free(in);
+		free(out);
+		return;
+	}
+	uint32_t state = 38;
+	for (size_t i = 0; i < SYNTHETIC; i++) {
+		in[i] = (float)lcg(&state) / 16777216.0f;
+	}
+	for (uint32_t i = 0; i < TRANSFORMS; i++) {
+		const float scale[3] = { 1.0f, 2.0f, 1.0f };
+		const float rotation[4] = { 0.0f, 0.6f, 0.0f, 0.8f };
+		const float translation[3] = { (float)i, 0.0f, 0.0f };
+		EGL_TransformBatchSet(&batch, i, scale, rotation, translation);
+	}
+	const size_t words = (TRANSFORMS + 63) / 64;
+	char label[64];
+
+	/* Every power of two up to the processor count, then the processor count itself */
+	const int threads_max = EGL_ThreadCount();
+	for (int threads = 1; threads <= threads_max; threads = (threads < threads_max && threads * 2 > threads_max) ? threads_max : threads * 2) {
+		EGL_Jobs jobs;
+		if (!EGL_JobsInit(&jobs, threads, EGL_JOBS_AFFINITY_NONE)) {
+			printf(" %d threads: failed to start\n", threads);
+			break;
+		}
+
+#define RUN(name, size, unit, ...) do { \
+			double best = 1e30; \
+			for (int r = 0; r < REPEATS; r++) { \
+				mark_all(&batch); \
+				double begin = EGL_BenchNow(); \
+				__VA_ARGS__; \
+				double elapsed = EGL_BenchNow() - begin; \
+				best = (elapsed < best) ? elapsed : best; \
+			} \
+			snprintf(label, sizeof(label), "%s, %d threads", name, threads); \
+			EGL_BenchReport(label, best, (double)(size), unit); \
+		} while (0)
+
+		Synthetic s = { .in = in, .out = out, .n = SYNTHETIC };
+		RUN("synthetic, EGL_ParallelRun", SYNTHETIC, "element", EGL_ParallelRun(synthetic_kernel, &s, threads));
+		RUN("synthetic, jobs", SYNTHETIC, "element", EGL_JobsParallelFor(&jobs, SYNTHETIC, 0, synthetic_range, &s));
+
+		RUN("transform update, EGL_ParallelRun", TRANSFORMS, "transform", EGL_TransformBatchUpdate(&batch, threads));
+		RUN("transform update, jobs", TRANSFORMS, "transform", EGL_JobsParallelFor(&jobs, words, 0, update_range, &batch));
+
+		/* Small batches, where starting threads for every call costs more than the work */
+		Synthetic small = { .in = in, .out = out, .n = SMALL };
+		RUN("small batch, EGL_ParallelRun", SMALL, "element", EGL_ParallelRun(synthetic_kernel, &small, threads));
+		RUN("small batch, jobs", SMALL, "element", EGL_JobsParallelFor(&jobs, SMALL, 0, synthetic_range, &small));
+#undef RUN
+
+		EGL_BENCH_SINK += (uint64_t)(out[SYNTHETIC / 2] + batch.models[16 * (TRANSFORMS / 2)]);
+		EGL_JobsFree(&jobs);
+	}
+
+	EGL_TransformBatchFree(&batch);
+	free(in);
+	free(out);
+}
@@ -0,0 +1,214 @@
+#include <EGL/EGL_testing.h>
+#include <stdlib.h>
+
+
+#define WORKERS 4
+#define DEPTH 13 // Levels of the fork-join tree: 2^13 leaves, more jobs than one worker's ring.
+
+
+typedef struct {
+	_Atomic uint32_t *hits;
+	EGL_Jobs *jobs;
+	size_t n;
+	size_t grain;
+} Cover;
+
+typedef struct {
+	_Atomic uint32_t leaves;
+	_Atomic uint32_t nested;
+} Tree;
+
+typedef struct {
+	EGL_Jobs *jobs;
+	EGL_Job *job;     /**< Created by worker 0. */
+	EGL_Job *created; /**< What EGL_JobsCreate returned off the pool. */
+	bool ran;         /**< What EGL_JobsRun returned off the pool. */
+} Outside;
+
+
+static void hit(void *data, size_t begin, size_t end) {
+	Cover *c = (Cover *)data;
+	for (size_t i = begin; i < end; i++) {
+		atomic_fetch_add_explicit(&c->hits[i], 1, memory_order_relaxed);
+	}
+}
+
+static size_t misses(_Atomic uint32_t *hits, size_t n, uint32_t expected) {
+	size_t wrong = 0;
+	for (size_t i = 0; i < n; i++) {
+		wrong += (atomic_load(&hits[i]) != expected);
+		atomic_store(&hits[i], 0);
+	}
+	return wrong;
+}
+
+static int cover_outside(void *arg) {
+	Cover *c = (Cover *)arg;
+	EGL_JobsParallelFor(c->jobs, c->n, c->grain, hit, c);
+	return 0;
+}
+
+static void count_nested(void *data, size_t begin, size_t end) {
+	Tree *tree = (Tree *)data;
+	atomic_fetch_add_explicit(&tree->nested, (uint32_t)(end - begin), memory_order_relaxed);
+}
+
+static int create_outside(void *arg) {
+	Outside *o = (Outside *)arg;
+	o->created = EGL_JobsCreate(o->jobs, NULL, NULL, NULL);
+	o->ran = EGL_JobsRun(o->jobs, o->job);
+	return 0;
+}
+
+static int wait_outside(void *arg) {
+	Outside *o = (Outside *)arg;
+	EGL_JobsWait(o->jobs, o->job);
+	return 0;
+}
+
+/* Split in two children down to the leaves; some leaves run a parallel for of their own. */
+static void branch(EGL_Jobs *jobs, EGL_Job *job, void *data) {
+	Tree *tree = (Tree *)data;
+	if (job->begin == 0) {
+		if (atomic_fetch_add_explicit(&tree->leaves, 1, memory_order_relaxed) % 512 == 0) {
+			EGL_JobsParallelFor(jobs, 1000, 7, count_nested, tree);
+		}
+		return;
+	}
+	for (int k = 0; k < 2; k++) {
+		EGL_Job *child = EGL_JobsCreate(jobs, branch, data, job);
+		child->begin = job->begin - 1;
+		EGL_JobsRun(jobs, child);
+	}
+}
+
+
+/**
+ * A parallel for runs every index exactly once for any size and grain, from
+ * a worker or from a thread outside the job system.
+ */
+static void EGL_JobsParallelForTest(EGL_Test *T) {
+	EGL_DECLARE_TEST;
+
+	EGL_Jobs jobs;
+	if (!EGL_JobsInit(&jobs, WORKERS, EGL_JOBS_AFFINITY_NONE)) {
+		EGL_DECLARE_ERROR("Failed to start %d workers.", WORKERS);
+		return;
+	}
+	if (jobs.worker_count < 1 || jobs.worker_count > WORKERS) {
+		EGL_DECLARE_ERROR("Started %d workers, not up to %d.", jobs.worker_count, WORKERS);
+	}
+
+	const size_t sizes[] = { 0, 1, 7, 1000, 100003 };
+	const size_t grains[] = { 0, 1, 64, 1000000 };
+	_Atomic uint32_t *hits = (_Atomic uint32_t *)calloc(100003, sizeof(*hits));
+	if (!hits) {
+		EGL_DECLARE_ERROR("Failed to allocate %d counters.", 100003);
+		EGL_JobsFree(&jobs);
+		return;
+	}
+
+	for (int s = 0; s < 5; s++) {
+		for (int g = 0; g < 4; g++) {
+			Cover c = { .hits = hits, .jobs = &jobs, .n = sizes[s], .grain = grains[g] };
+			EGL_JobsParallelFor(&jobs, c.n, c.grain, hit, &c);
+			size_t wrong = misses(hits, c.n, 1);
+			if (wrong) {
+				EGL_DECLARE_ERROR("%zu of %zu indices were not run exactly once with grain %zu.", wrong, c.n, c.grain);
+			}
+
+			thrd_t outside;
+			if (thrd_create(&outside, cover_outside, &c) == thrd_success) {
+				thrd_join(outside, NULL);
+				wrong = misses(hits, c.n, 1);
+				if (wrong) {
+					EGL_DECLARE_ERROR("From outside, %zu of %zu indices were not run exactly once with grain %zu.", wrong, c.n, c.grain);
+				}
+			}
+		}
+	}
+
+	free(hits);
+	EGL_JobsFree(&jobs);
+}
+
+/**
+ * A job waited on finishes only after every descendant, including jobs that
+ * ran nested parallel fors, and the job system can be restarted afterwards.
+ */
+static void EGL_JobsForkJoinTest(EGL_Test *T) {
+	EGL_DECLARE_TEST;
+
+	for (int round = 0; round < 3; round++) {
+		EGL_Jobs jobs;
+		if (!EGL_JobsInit(&jobs, WORKERS, (round == 2) ? EGL_JOBS_AFFINITY_PIN : EGL_JOBS_AFFINITY_NONE)) {
+			EGL_DECLARE_ERROR("Round %d: failed to start %d workers.", round, WORKERS);
+			return;
+		}
+
+		Tree tree;
+		atomic_init(&tree.leaves, 0);
+		atomic_init(&tree.nested, 0);
+		EGL_Job *root = EGL_JobsCreate(&jobs, branch, &tree, NULL);
+		root->begin = DEPTH;
+		EGL_JobsRun(&jobs, root);
+		EGL_JobsWait(&jobs, root);
+
+		const uint32_t leaves = atomic_load(&tree.leaves);
+		const uint32_t nested = atomic_load(&tree.nested);
+		const uint32_t expected = 1u << DEPTH;
+		if (leaves != expected || nested != 1000 * ((expected + 511) / 512)) {
+			EGL_DECLARE_ERROR("Round %d: waited for %u of %u leaves and %u nested indices.", round, leaves, expected, nested);
+		}
+		EGL_JobsFree(&jobs);
+	}
+}
+
+/**
+ * A thread outside the job system cannot create or queue jobs, and leaves
+ * the job it tried to queue to worker 0, but it can wait on one.
+ */
+static void EGL_JobsOutsideTest(EGL_Test *T) {
+	EGL_DECLARE_TEST;
+
+	EGL_Jobs jobs;
+	if (!EGL_JobsInit(&jobs, WORKERS, EGL_JOBS_AFFINITY_NONE)) {
+		EGL_DECLARE_ERROR("Failed to start %d workers.", WORKERS);
+		return;
+	}
+
+	Tree tree;
+	atomic_init(&tree.leaves, 0);
+	atomic_init(&tree.nested, 0);
+	Outside o = { .jobs = &jobs, .job = EGL_JobsCreate(&jobs, branch, &tree, NULL) };
+	thrd_t outside;
+	if (thrd_create(&outside, create_outside, &o) == thrd_success) {
+		thrd_join(outside, NULL);
+		if (o.created || o.ran) {
+			EGL_DECLARE_ERROR("Off the pool, created %p and queued %d.", (void *)o.created, o.ran);
+		}
+	}
+	if (atomic_load(&tree.leaves) != 0) {
+		EGL_DECLARE_ERROR("A job queued off the pool ran %u times.", atomic_load(&tree.leaves));
+	}
+
+	const bool ran = EGL_JobsRun(&jobs, o.job);
+	const bool waiting = (thrd_create(&outside, wait_outside, &o) == thrd_success);
+	EGL_JobsWait(&jobs, o.job);
+	if (waiting) {
+		thrd_join(outside, NULL);
+	}
+	if (!ran || atomic_load(&tree.leaves) != 1) {
+		EGL_DECLARE_ERROR("Worker 0 queued %d and ran the job %u times.", ran, atomic_load(&tree.leaves));
+	}
+	EGL_JobsFree(&jobs);
+}
+
+
+void EGL_JobsTest(EGL_TestModule *M) {
+	EGL_DECLARE_MODULE(EGL_jobs);
+
+	EGL_RUN_TEST(EGL_JobsParallelForTest);
+	EGL_RUN_TEST(EGL_JobsForkJoinTest);
+	EGL_RUN_TEST(EGL_JobsOutsideTest);
+}
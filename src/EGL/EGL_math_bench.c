@@ -0,0 +1,198 @@
+#include <EGL/EGL_bench.h>
+#include <EGL/EGL_math.h>
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* cglm is the library the game uses today; compare against it when its headers are around */
+#if defined(__has_include)
+#if __has_include(<cglm/cglm.h>)
+#include <cglm/cglm.h>
+#define HAVE_CGLM
+#endif
+#endif
+
+
+#define COUNT 4096 // Small enough to stay in L2, so this measures the math and not memory.
+
+
+static uint32_t lcg(uint32_t *state) {
+	*state = *state * 1664525u + 1013904223u;
+	return *state >> 8;
+}
+
+static float unit(uint32_t *state) {
+	return (float)lcg(state) / 16777216.0f;
+}
+
+
+/* Plain pointer-in, pointer-out scalar versions, written the way a C math library is */
+
+static void scalar_mul(const float *a, const float *b, float *r) {
+	for (int c = 0; c < 4; c++) {
+		for (int row = 0; row < 4; row++) {
+			r[c * 4 + row] = a[row] * b[c * 4] + a[4 + row] * b[c * 4 + 1] + a[8 + row] * b[c * 4 + 2] + a[12 + row] * b[c * 4 + 3];
+		}
+	}
+}
+
+static void scalar_inverse(const float *m, float *r) {
+	float cofactor[16];
+	for (int c = 0; c < 4; c++) {
+		for (int row = 0; row < 4; row++) {
+			/* Determinant of the 3x3 minor without column c and row row */
+			int cols[3], rows[3];
+			for (int k = 0, n = 0; k < 4; k++) {
+				if (k != c) {
+					cols[n++] = k;
+				}
+			}
+			for (int k = 0, n = 0; k < 4; k++) {
+				if (k != row) {
+					rows[n++] = k;
+				}
+			}
+			float minor[9];
+			for (int i = 0; i < 3; i++) {
+				for (int j = 0; j < 3; j++) {
+					minor[i * 3 + j] = m[cols[i] * 4 + rows[j]];
+				}
+			}
+			const float det = minor[0] * (minor[4] * minor[8] - minor[5] * minor[7])
+				- minor[1] * (minor[3] * minor[8] - minor[5] * minor[6])
+				+ minor[2] * (minor[3] * minor[7] - minor[4] * minor[6]);
+			cofactor[c * 4 + row] = ((c + row) & 1) ? -det : det;
+		}
+	}
+	float det = 0.0f;
+	for (int row = 0; row < 4; row++) {
+		det += m[row] * cofactor[row];
+	}
+	const float inv = 1.0f / det;
+	for (int c = 0; c < 4; c++) {
+		for (int row = 0; row < 4; row++) {
+			r[c * 4 + row] = cofactor[row * 4 + c] * inv;
+		}
+	}
+}
+
+static void scalar_rotate(const float *q, const float *v, float *r) {
+	const float t[3] = {
+		2.0f * (q[1] * v[2] - q[2] * v[1]),
+		2.0f * (q[2] * v[0] - q[0] * v[2]),
+		2.0f * (q[0] * v[1] - q[1] * v[0]),
+	};
+	r[0] = v[0] + q[3] * t[0] + q[1] * t[2] - q[2] * t[1];
+	r[1] = v[1] + q[3] * t[1] + q[2] * t[0] - q[0] * t[2];
+	r[2] = v[2] + q[3] * t[2] + q[0] * t[1] - q[1] * t[0];
+}
+
+/* Identity, then translate, rotate and scale in place, as a transform stack does it */
+static void scalar_trs(const float *t, const float *q, const float *s, float *r) {
+	float m[16] = { 1,0,0,0, 0,1,0,0, 0,0,1,0, 0,0,0,1 };
+	float step[16] = { 1,0,0,0, 0,1,0,0, 0,0,1,0, t[0],t[1],t[2],1 };
+	scalar_mul(m, step, r);
+
+	const float x = q[0], y = q[1], z = q[2], w = q[3];
+	const float rotation[16] = {
+		1 - 2 * (y * y + z * z), 2 * (x * y + w * z), 2 * (x * z - w * y), 0,
+		2 * (x * y - w * z), 1 - 2 * (x * x + z * z), 2 * (y * z + w * x), 0,
+		2 * (x * z + w * y), 2 * (y * z - w * x), 1 - 2 * (x * x + y * y), 0,
+		0, 0, 0, 1,
+	};
+	scalar_mul(r, rotation, m);
+
+	memset(step, 0, sizeof(step));
+	step[0] = s[0];
+	step[5] = s[1];
+	step[10] = s[2];
+	step[15] = 1.0f;
+	scalar_mul(m, step, r);
+}
+
+
+void EGL_MathBench(void) {
+	EGL_DECLARE_BENCH(EGL_math);
+
+	EGL_Mat4 *a = (EGL_Mat4 *)malloc(sizeof(EGL_Mat4) * COUNT);
+	EGL_Mat4 *b = (EGL_Mat4 *)malloc(sizeof(EGL_Mat4) * COUNT);
+	EGL_Mat4 *r = (EGL_Mat4 *)calloc(COUNT, sizeof(EGL_Mat4));
+	EGL_Quat *q = (EGL_Quat *)malloc(sizeof(EGL_Quat) * COUNT);
+	EGL_Vec3 *v = (EGL_Vec3 *)malloc(sizeof(EGL_Vec3) * COUNT);
+	EGL_Vec3 *s = (EGL_Vec3 *)malloc(sizeof(EGL_Vec3) * COUNT);
+	EGL_Vec3 *out = (EGL_Vec3 *)calloc(COUNT, sizeof(EGL_Vec3));
+	float *soa = (float *)malloc(sizeof(float) * COUNT * 6);
+	if (!a || !b || !r || !q || !v || !s || !out || !soa) {
+		printf(" %d matrices: failed to allocate\n", COUNT);
+		free(a); free(b); free(r); free(q); free(v); free(s); free(out); free(soa);
+		return;
+	}
+
+	uint32_t state = 35;
+	for (int i = 0; i < COUNT; i++) {
+		for (int k = 0; k < 16; k++) {
+			a[i].array[k] = unit(&state) - 0.5f + ((k % 5 == 0) ? 2.0f : 0.0f);
+			b[i].array[k] = unit(&state) - 0.5f + ((k % 5 == 0) ? 2.0f : 0.0f);
+		}
+		const EGL_Quat raw = {{ unit(&state) - 0.5f, unit(&state) - 0.5f, unit(&state) - 0.5f, unit(&state) - 0.5f }};
+		q[i] = EGL_QuatUnit(raw);
+		v[i] = (EGL_Vec3){{ unit(&state), unit(&state), unit(&state) }};
+		s[i] = (EGL_Vec3){{ 1.0f + unit(&state), 1.0f + unit(&state), 1.0f + unit(&state) }};
+		soa[i] = v[i].x;
+		soa[COUNT + i] = v[i].y;
+		soa[2 * COUNT + i] = v[i].z;
+	}
+
+#define RUN(label, unit_name, ...) do { \
+		double best = 1e30; \
+		for (int rep = 0; rep < EGL_BENCH_REPEATS * 4; rep++) { \
+			double begin = EGL_BenchNow(); \
+			for (int i = 0; i < COUNT; i++) { \
+				__VA_ARGS__; \
+			} \
+			double elapsed = EGL_BenchNow() - begin; \
+			best = (elapsed < best) ? elapsed : best; \
+		} \
+		EGL_BENCH_SINK += (uint64_t)(r[COUNT / 2].array[5] + out[COUNT / 2].y); \
+		EGL_BenchReport(label, best, (double)COUNT, unit_name); \
+	} while (0)
+
+	RUN("mul, EGL", "mat", r[i] = EGL_Mat4Mul(a[i], b[i]));
+	RUN("mul, scalar", "mat", scalar_mul(a[i].array, b[i].array, r[i].array));
+#ifdef HAVE_CGLM
+	RUN("mul, cglm", "mat", glm_mat4_mul((vec4 *)a[i].array, (vec4 *)b[i].array, (vec4 *)r[i].array));
+#endif
+
+	RUN("inverse, EGL", "mat", r[i] = EGL_Mat4Inverse(a[i]));
+	RUN("inverse, scalar", "mat", scalar_inverse(a[i].array, r[i].array));
+#ifdef HAVE_CGLM
+	RUN("inverse, cglm", "mat", glm_mat4_inv((vec4 *)a[i].array, (vec4 *)r[i].array));
+#endif
+
+	RUN("quat rotate, EGL", "vec", out[i] = EGL_QuatRotateVec3(q[i], v[i]));
+	RUN("quat rotate, scalar", "vec", scalar_rotate(q[i].array, v[i].array, out[i].array));
+#ifdef HAVE_CGLM
+	RUN("quat rotate, cglm", "vec", glm_quat_rotatev(q[i].array, v[i].array, out[i].array));
+#endif
+	/* One rotation for eight SoA vectors at a time */
+	RUN("quat rotate, EGL x8", "vec", if ((i & 7) == 0) {
+		const EGL_Vec3x8 w = EGL_Vec3x8Rotate(q[0], EGL_Vec3x8Load(soa, soa + COUNT, soa + 2 * COUNT, (size_t)i));
+		EGL_Vec3x8Store(soa + 3 * COUNT, soa + 4 * COUNT, soa + 5 * COUNT, (size_t)i, w);
+	});
+	EGL_BENCH_SINK += (uint64_t)soa[4 * COUNT + 1];
+
+	RUN("TRS compose, EGL", "mat", r[i] = EGL_Mat4Trs(v[i], q[i], s[i]));
+	RUN("TRS compose, scalar", "mat", scalar_trs(v[i].array, q[i].array, s[i].array, r[i].array));
+#ifdef HAVE_CGLM
+	RUN("TRS compose, cglm", "mat", {
+		glm_mat4_identity((vec4 *)r[i].array);
+		glm_translate((vec4 *)r[i].array, v[i].array);
+		glm_quat_rotate((vec4 *)r[i].array, q[i].array, (vec4 *)r[i].array);
+		glm_scale((vec4 *)r[i].array, s[i].array);
+	});
+#endif
+#undef RUN
+
+	free(a); free(b); free(r); free(q); free(v); free(s); free(out); free(soa);
+}
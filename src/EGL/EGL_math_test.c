@@ -0,0 +1,206 @@
+#include <EGL/EGL_testing.h>
+#include <math.h>
+#include <stdlib.h>
+
+
+#define ROUNDS 1000
+
+
+static EGL_Vec3 random_vec3(uint32_t *state, float scale) {
+	return (EGL_Vec3){{ scale * (2.0f * EGL_RandFloat(state) - 1.0f), scale * (2.0f * EGL_RandFloat(state) - 1.0f), scale * (2.0f * EGL_RandFloat(state) - 1.0f) }};
+}
+
+static EGL_Quat random_quat(uint32_t *state) {
+	EGL_Quat q;
+	float r2;
+	do {
+		for (int a = 0; a < 4; a++) {
+			q.array[a] = 2.0f * EGL_RandFloat(state) - 1.0f;
+		}
+		r2 = EGL_Vec4Dot(q, q);
+	} while (r2 < 0.01f || r2 > 1.0f);
+	return EGL_QuatUnit(q);
+}
+
+/* Random entries with a heavy diagonal, so the matrix is comfortably invertible. */
+static EGL_Mat4 random_mat4(uint32_t *state) {
+	EGL_Mat4 m;
+	for (int k = 0; k < 16; k++) {
+		m.array[k] = 2.0f * EGL_RandFloat(state) - 1.0f + ((k % 5 == 0) ? 4.0f : 0.0f);
+	}
+	return m;
+}
+
+static float max_error(const float *a, const double *b, int n) {
+	float error = 0.0f;
+	for (int k = 0; k < n; k++) {
+		error = fmaxf(error, (float)fabs(a[k] - b[k]));
+	}
+	return error;
+}
+
+static void reference_mul(const float *a, const float *b, double *r) {
+	for (int c = 0; c < 4; c++) {
+		for (int row = 0; row < 4; row++) {
+			r[c * 4 + row] = 0.0;
+			for (int k = 0; k < 4; k++) {
+				r[c * 4 + row] += (double)a[k * 4 + row] * b[c * 4 + k];
+			}
+		}
+	}
+}
+
+
+/**
+ * Products, inverses and transposes of matrices match double precision.
+ */
+static void EGL_MathMat4Test(EGL_Test *T) {
+	EGL_DECLARE_TEST;
+
+	uint32_t state[4] = {0,0,0,0};
+	EGL_Seed(state, 35);
+	for (int round = 0; round < ROUNDS && T->error_count < ERRORS_MAX - 1; round++) {
+		const EGL_Mat4 a = random_mat4(state);
+		const EGL_Mat4 b = random_mat4(state);
+		double expected[16];
+
+		reference_mul(a.array, b.array, expected);
+		const EGL_Mat4 ab = EGL_Mat4Mul(a, b);
+		float error = max_error(ab.array, expected, 16);
+		if (error > 1e-4f) {
+			EGL_DECLARE_ERROR("Round %d: product is off by %g.", round, error);
+		}
+
+		const float identity[16] = { 1,0,0,0, 0,1,0,0, 0,0,1,0, 0,0,0,1 };
+		const EGL_Mat4 inverse = EGL_Mat4Inverse(a);
+		reference_mul(a.array, inverse.array, expected);
+		error = max_error(identity, expected, 16);
+		if (error > 1e-5f) {
+			EGL_DECLARE_ERROR("Round %d: a matrix times its inverse is off the identity by %g.", round, error);
+		}
+
+		const EGL_Mat4 t = EGL_Mat4Transpose(a);
+		if (t.array[1] != a.array[4] || t.array[14] != a.array[11] || t.array[0] != a.array[0]) {
+			EGL_DECLARE_ERROR("Round %d: transpose moved the wrong elements.", round);
+		}
+
+		const EGL_Vec4 v = {{ a.array[3], a.array[7], 1.0f, -2.0f }};
+		const EGL_Vec4 av = EGL_Mat4MulVec4(a, v);
+		double column[4];
+		for (int row = 0; row < 4; row++) {
+			column[row] = (double)a.array[row] * v.x + (double)a.array[4 + row] * v.y + (double)a.array[8 + row] * v.z + (double)a.array[12 + row] * v.w;
+		}
+		error = max_error(av.array, column, 4);
+		if (error > 1e-4f) {
+			EGL_DECLARE_ERROR("Round %d: matrix times vector is off by %g.", round, error);
+		}
+	}
+}
+
+/**
+ * Quaternion products, vector rotation and TRS composition agree with each
+ * other and with the array helpers in EGL_transform.h.
+ */
+static void EGL_MathQuatTest(EGL_Test *T) {
+	EGL_DECLARE_TEST;
+
+	uint32_t state[4] = {0,0,0,0};
+	EGL_Seed(state, 36);
+	for (int round = 0; round < ROUNDS && T->error_count < ERRORS_MAX - 1; round++) {
+		const EGL_Quat p = random_quat(state);
+		const EGL_Quat q = random_quat(state);
+		const EGL_Vec3 v = random_vec3(state, 5.0f);
+
+		float expected[4];
+		EGL_QuatMul(p.array, q.array, expected);
+		const EGL_Quat pq = EGL_QuatProduct(p, q);
+		float error = 0.0f;
+		for (int a = 0; a < 4; a++) {
+			error = fmaxf(error, fabsf(pq.array[a] - expected[a]));
+		}
+		if (error > 1e-6f) {
+			EGL_DECLARE_ERROR("Round %d: product differs from EGL_QuatMul by %g.", round, error);
+		}
+
+		/* Rotating by p then q is rotating by q * p */
+		const EGL_Vec3 twice = EGL_QuatRotateVec3(q, EGL_QuatRotateVec3(p, v));
+		const EGL_Vec3 once = EGL_QuatRotateVec3(EGL_QuatProduct(q, p), v);
+		error = EGL_Vec3Length(EGL_Vec3Sub(twice, once));
+		if (error > 1e-5f || fabsf(EGL_Vec3Length(once) - EGL_Vec3Length(v)) > 1e-5f) {
+			EGL_DECLARE_ERROR("Round %d: composed rotation is off by %g.", round, error);
+		}
+
+		const EGL_Vec3 scale = {{ 0.5f + EGL_RandFloat(state), 0.5f + EGL_RandFloat(state), 0.5f + EGL_RandFloat(state) }};
+		const EGL_Vec3 translation = random_vec3(state, 10.0f);
+		const EGL_Mat4 trs = EGL_Mat4Trs(translation, q, scale);
+		const EGL_Vec3 moved = EGL_Vec3Add(translation, EGL_QuatRotateVec3(q, EGL_Vec3Mul(scale, v)));
+		error = EGL_Vec3Length(EGL_Vec3Sub(EGL_Mat4MulPoint(trs, v), moved));
+		if (error > 1e-5f) {
+			EGL_DECLARE_ERROR("Round %d: TRS moves a point %g off.", round, error);
+		}
+
+		const EGL_Mat4 rigid = EGL_Mat4Trs(translation, q, (EGL_Vec3){{ 1.0f, 1.0f, 1.0f }});
+		const EGL_Mat4 a = EGL_Mat4InverseRigid(rigid);
+		const EGL_Mat4 b = EGL_Mat4Inverse(rigid);
+		error = 0.0f;
+		for (int k = 0; k < 16; k++) {
+			error = fmaxf(error, fabsf(a.array[k] - b.array[k]));
+		}
+		if (error > 1e-5f) {
+			EGL_DECLARE_ERROR("Round %d: rigid inverse differs from the general one by %g.", round, error);
+		}
+	}
+}
+
+/**
+ * Every lane of the wide types matches the one-at-a-time functions.
+ */
+static void EGL_MathWideTest(EGL_Test *T) {
+	EGL_DECLARE_TEST;
+
+	float x[16], y[16], z[16];
+	float out_x[16], out_y[16], out_z[16];
+	uint32_t state[4] = {0,0,0,0};
+	EGL_Seed(state, 37);
+	for (int i = 0; i < 16; i++) {
+		const EGL_Vec3 v = random_vec3(state, 3.0f);
+		x[i] = v.x;
+		y[i] = v.y;
+		z[i] = v.z;
+	}
+	const EGL_Quat q = random_quat(state);
+	const EGL_Vec3 axis = random_vec3(state, 1.0f);
+
+	for (size_t i = 0; i < 16; i += 8) {
+		const EGL_Vec3x8 v = EGL_Vec3x8Load(x, y, z, i);
+		const EGL_Vec3x8 r = EGL_Vec3x8Cross(EGL_Vec3x8Splat(axis), EGL_Vec3x8Normalize(EGL_Vec3x8Rotate(q, v)));
+		EGL_Vec3x8Store(out_x, out_y, out_z, i, r);
+	}
+	for (int i = 0; i < 16; i++) {
+		const EGL_Vec3 v = {{ x[i], y[i], z[i] }};
+		const EGL_Vec3 expected = EGL_Vec3Cross(axis, EGL_Vec3Normalize(EGL_QuatRotateVec3(q, v)));
+		const EGL_Vec3 got = {{ out_x[i], out_y[i], out_z[i] }};
+		const float error = EGL_Vec3Length(EGL_Vec3Sub(got, expected));
+		if (error > 1e-5f) {
+			EGL_DECLARE_ERROR("Lane %d is off by %g.", i, error);
+		}
+	}
+
+	float lo[8], hi[8];
+	EGL_Floatx8Store(lo, EGL_Floatx8Min(EGL_Floatx8Load(x), EGL_Floatx8Load(y)));
+	EGL_Floatx8Store(hi, EGL_Floatx8Max(EGL_Floatx8Load(x), EGL_Floatx8Load(y)));
+	for (int i = 0; i < 8; i++) {
+		if (lo[i] != ((x[i] < y[i]) ? x[i] : y[i]) || hi[i] != ((x[i] < y[i]) ? y[i] : x[i])) {
+			EGL_DECLARE_ERROR("Lane %d: min %f and max %f of %f and %f.", i, lo[i], hi[i], x[i], y[i]);
+		}
+	}
+}
+
+
+void EGL_MathTest(EGL_TestModule *M) {
+	EGL_DECLARE_MODULE(EGL_math);
+
+	EGL_RUN_TEST(EGL_MathMat4Test);
+	EGL_RUN_TEST(EGL_MathQuatTest);
+	EGL_RUN_TEST(EGL_MathWideTest);
+}
@@ -0,0 +1,33 @@
+#include <EGL/EGL_memory.h>
+
+#include <stdlib.h>
+
+
+static EGL_MallocFunc MALLOC = malloc;
+static EGL_CallocFunc CALLOC = calloc;
+static EGL_ReallocFunc REALLOC = realloc;
+static EGL_FreeFunc FREE = free;
+
+
+void EGL_SetMemoryFunctions(EGL_MallocFunc malloc_func, EGL_CallocFunc calloc_func, EGL_ReallocFunc realloc_func, EGL_FreeFunc free_func) {
+	MALLOC = malloc_func ? malloc_func : malloc;
+	CALLOC = calloc_func ? calloc_func : calloc;
+	REALLOC = realloc_func ? realloc_func : realloc;
+	FREE = free_func ? free_func : free;
+}
+
+void *EGL_malloc(size_t size) {
+	return MALLOC(size);
+}
+
+void *EGL_calloc(size_t count, size_t size) {
+	return CALLOC(count, size);
+}
+
+void *EGL_realloc(void *memory, size_t size) {
+	return REALLOC(memory, size);
+}
+
+void EGL_free(void *memory) {
+	FREE(memory);
+}
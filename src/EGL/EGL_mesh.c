@@ -0,0 +1,435 @@
+#include <EGL/EGL_mesh.h>
+#include <EGL/EGL_sort.h>
+#include <EGL/EGL_parallel.h>
+#include <EGL/EGL_memory.h>
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+#define WELD_BITS 21
+#define HEADER_WORDS 8
+
+
+/* Spread the low 21 bits of x so there are two zero bits between each. */
+static inline uint64_t spread_bits(uint64_t x) {
+	x &= 0x1FFFFF;
+	x = (x | x << 32) & UINT64_C(0x001F00000000FFFF);
+	x = (x | x << 16) & UINT64_C(0x001F0000FF0000FF);
+	x = (x | x <<  8) & UINT64_C(0x100F00F00F00F00F);
+	x = (x | x <<  4) & UINT64_C(0x10C30C30C30C30C3);
+	x = (x | x <<  2) & UINT64_C(0x1249249249249249);
+	return x;
+}
+
+static inline uint64_t morton3(uint32_t x, uint32_t y, uint32_t z) {
+	return spread_bits(x) | (spread_bits(y) << 1) | (spread_bits(z) << 2);
+}
+
+static size_t layout_size(uint32_t vertex_count, uint32_t node_count, uint32_t triangle_count, uint32_t edge_count) {
+	return sizeof(uint32_t) * (
+		(size_t)vertex_count +
+		(size_t)node_count * 3 +
+		(size_t)triangle_count * 3 +
+		(size_t)node_count + 1 +
+		(size_t)edge_count +
+		(size_t)triangle_count * 3 +
+		(size_t)node_count + 1 +
+		(size_t)triangle_count * 3
+	);
+}
+
+/* Carve the arrays out of the memory block in serialization order. */
+static void layout(EGL_MeshAdjacency *adj) {
+	uint32_t *head = (uint32_t *)adj->memory;
+
+	adj->remap = head;                 head += adj->vertex_count;
+	adj->positions = (float *)head;    head += (size_t)adj->node_count * 3;
+	adj->triangle_nodes = head;        head += (size_t)adj->triangle_count * 3;
+	adj->neighbor_offsets = head;      head += (size_t)adj->node_count + 1;
+	adj->neighbors = head;             head += adj->edge_count;
+	adj->triangle_neighbors = head;    head += (size_t)adj->triangle_count * 3;
+	adj->fan_offsets = head;           head += (size_t)adj->node_count + 1;
+	adj->fans = head;
+}
+
+
+bool EGL_MeshAdjacencyBuild(EGL_MeshAdjacency *adj, const uint32_t *indices, uint32_t index_count, const float *vertices, uint32_t vertex_count) {
+	memset(adj, 0, sizeof(*adj));
+
+	/* Indices from a file index the per-vertex arrays below, so reject any out of range */
+	if (index_count % 3 != 0) {
+		return false;
+	}
+	for (uint32_t i = 0; i < index_count; i++) {
+		if (indices[i] >= vertex_count) {
+			return false;
+		}
+	}
+
+	const uint32_t triangle_count = index_count / 3;
+	const size_t half_edge_count = (size_t)triangle_count * 3;
+	const size_t scratch_count = (half_edge_count > vertex_count) ? half_edge_count : vertex_count;
+
+	uint64_t *keys = (uint64_t *)EGL_malloc(sizeof(uint64_t) * scratch_count);
+	uint64_t *keys_tmp = (uint64_t *)EGL_malloc(sizeof(uint64_t) * scratch_count);
+	uint32_t *values = (uint32_t *)EGL_malloc(sizeof(uint32_t) * scratch_count);
+	uint32_t *values_tmp = (uint32_t *)EGL_malloc(sizeof(uint32_t) * scratch_count);
+	uint32_t *remap = (uint32_t *)EGL_malloc(sizeof(uint32_t) * ((size_t)vertex_count + 1));
+	uint32_t *degree = NULL;
+
+	if (!keys || !keys_tmp || !values || !values_tmp || !remap) {
+		goto fail;
+	}
+
+	/* Weld: sort vertices by the Morton code of their quantized position */
+	float lo[3] = { INFINITY, INFINITY, INFINITY };
+	float hi[3] = { -INFINITY, -INFINITY, -INFINITY };
+	for (uint32_t v = 0; v < vertex_count; v++) {
+		for (int c = 0; c < 3; c++) {
+			float x = vertices[v * 3 + c];
+			lo[c] = (x < lo[c]) ? x : lo[c];
+			hi[c] = (x > hi[c]) ? x : hi[c];
+		}
+	}
+
+	float scale[3];
+	for (int c = 0; c < 3; c++) {
+		float extent = hi[c] - lo[c];
+		scale[c] = (extent > 0.0f) ? (float)((1 << WELD_BITS) - 1) / extent : 0.0f;
+	}
+
+	for (uint32_t v = 0; v < vertex_count; v++) {
+		uint32_t q[3];
+		for (int c = 0; c < 3; c++) {
+			float x = (vertices[(size_t)v * 3 + c] - lo[c]) * scale[c];
+			q[c] = (x < (float)((1 << WELD_BITS) - 1)) ? (uint32_t)x : (1 << WELD_BITS) - 1;
+		}
+		keys[v] = morton3(q[0], q[1], q[2]);
+		values[v] = v;
+	}
+
+	if (!EGL_RadixSort(keys, values, keys_tmp, values_tmp, vertex_count, NULL)) {
+		goto fail;
+	}
+
+	/* Nodes are runs of equal keys; remember the first vertex of each run */
+	uint32_t node_count = 0;
+	for (uint32_t i = 0; i < vertex_count; i++) {
+		if (i == 0 || keys[i] != keys[i - 1]) {
+			values_tmp[node_count++] = values[i];
+		}
+		remap[values[i]] = node_count - 1;
+	}
+
+	/* Pair half-edges by their undirected key (min << 32 | max) */
+	for (uint32_t t = 0; t < triangle_count; t++) {
+		for (uint32_t e = 0; e < 3; e++) {
+			uint32_t a = remap[indices[t * 3 + e]];
+			uint32_t b = remap[indices[t * 3 + (e + 1) % 3]];
+			size_t he = (size_t)t * 3 + e;
+			keys[he] = (a == b) ? UINT64_MAX : (a < b) ? ((uint64_t)a << 32 | b) : ((uint64_t)b << 32 | a);
+			values[he] = (uint32_t)he;
+		}
+	}
+
+	/* Keep the representative vertices before the scratch values are reused */
+	uint32_t *representative = (uint32_t *)EGL_malloc(sizeof(uint32_t) * ((size_t)node_count + 1));
+	if (!representative) {
+		goto fail;
+	}
+	memcpy(representative, values_tmp, sizeof(uint32_t) * node_count);
+
+	if (!EGL_RadixSort(keys, values, keys_tmp, values_tmp, half_edge_count, NULL)) {
+		EGL_free(representative);
+		goto fail;
+	}
+
+	degree = (uint32_t *)EGL_calloc((size_t)node_count + 1, sizeof(uint32_t));
+	if (!degree) {
+		EGL_free(representative);
+		goto fail;
+	}
+
+	size_t edge_count = 0;
+	size_t valid_count = half_edge_count;
+	for (size_t i = 0; i < half_edge_count; i++) {
+		if (keys[i] == UINT64_MAX) {
+			valid_count = i;
+			break;
+		}
+		if (i == 0 || keys[i] != keys[i - 1]) {
+			degree[keys[i] >> 32]++;
+			degree[keys[i] & 0xFFFFFFFF]++;
+			edge_count += 2;
+		}
+	}
+
+	adj->vertex_count = vertex_count;
+	adj->node_count = node_count;
+	adj->triangle_count = triangle_count;
+	adj->edge_count = (uint32_t)edge_count;
+	adj->memory_size = layout_size(vertex_count, node_count, triangle_count, adj->edge_count);
+	adj->memory = EGL_malloc(adj->memory_size);
+	if (!adj->memory) {
+		EGL_free(representative);
+		goto fail;
+	}
+	layout(adj);
+
+	memcpy(adj->remap, remap, sizeof(uint32_t) * vertex_count);
+	for (uint32_t n = 0; n < node_count; n++) {
+		memcpy(adj->positions + (size_t)n * 3, vertices + (size_t)representative[n] * 3, sizeof(float) * 3);
+	}
+	EGL_free(representative);
+
+	for (size_t i = 0; i < half_edge_count; i++) {
+		adj->triangle_nodes[i] = remap[indices[i]];
+		adj->triangle_neighbors[i] = EGL_MESH_NONE;
+	}
+
+	/* Twins are adjacent after sorting */
+	for (size_t i = 0; i + 1 < valid_count; i++) {
+		if (keys[i] == keys[i + 1]) {
+			adj->triangle_neighbors[values[i]] = values[i + 1] / 3;
+			adj->triangle_neighbors[values[i + 1]] = values[i] / 3;
+			i++;
+		}
+	}
+
+	/* CSR vertex graph. Filling the smaller endpoints first leaves each list sorted */
+	adj->neighbor_offsets[0] = 0;
+	for (uint32_t n = 0; n < node_count; n++) {
+		adj->neighbor_offsets[n + 1] = adj->neighbor_offsets[n] + degree[n];
+		degree[n] = adj->neighbor_offsets[n];
+	}
+	for (size_t i = 0; i < valid_count; i++) {
+		if (i == 0 || keys[i] != keys[i - 1]) {
+			uint32_t b = (uint32_t)(keys[i] & 0xFFFFFFFF);
+			adj->neighbors[degree[b]++] = (uint32_t)(keys[i] >> 32);
+		}
+	}
+	for (size_t i = 0; i < valid_count; i++) {
+		if (i == 0 || keys[i] != keys[i - 1]) {
+			uint32_t a = (uint32_t)(keys[i] >> 32);
+			adj->neighbors[degree[a]++] = (uint32_t)(keys[i] & 0xFFFFFFFF);
+		}
+	}
+
+	/* Vertex fans by counting sort */
+	memset(degree, 0, sizeof(uint32_t) * ((size_t)node_count + 1));
+	for (size_t i = 0; i < half_edge_count; i++) {
+		degree[adj->triangle_nodes[i]]++;
+	}
+	adj->fan_offsets[0] = 0;
+	for (uint32_t n = 0; n < node_count; n++) {
+		adj->fan_offsets[n + 1] = adj->fan_offsets[n] + degree[n];
+		degree[n] = adj->fan_offsets[n];
+	}
+	for (size_t i = 0; i < half_edge_count; i++) {
+		adj->fans[degree[adj->triangle_nodes[i]]++] = (uint32_t)(i / 3);
+	}
+
+	EGL_free(degree);
+	EGL_free(remap);
+	EGL_free(values_tmp);
+	EGL_free(values);
+	EGL_free(keys_tmp);
+	EGL_free(keys);
+	return true;
+
+fail:
+	EGL_free(degree);
+	EGL_free(remap);
+	EGL_free(values_tmp);
+	EGL_free(values);
+	EGL_free(keys_tmp);
+	EGL_free(keys);
+	EGL_MeshAdjacencyFree(adj);
+	return false;
+}
+
+void EGL_MeshAdjacencyFree(EGL_MeshAdjacency *adj) {
+	EGL_free(adj->memory);
+	memset(adj, 0, sizeof(*adj));
+}
+
+size_t EGL_MeshAdjacencySerializedSize(const EGL_MeshAdjacency *adj) {
+	return sizeof(uint32_t) * HEADER_WORDS + adj->memory_size;
+}
+
+size_t EGL_MeshAdjacencySerialize(const EGL_MeshAdjacency *adj, void *dst) {
+	uint32_t header[HEADER_WORDS] = {
+		EGL_MESH_ADJACENCY_MAGIC,
+		EGL_MESH_ADJACENCY_VERSION,
+		adj->vertex_count,
+		adj->node_count,
+		adj->triangle_count,
+		adj->edge_count,
+		0,
+		0,
+	};
+
+	memcpy(dst, header, sizeof(header));
+	memcpy((char *)dst + sizeof(header), adj->memory, adj->memory_size);
+
+	return sizeof(header) + adj->memory_size;
+}
+
+bool EGL_MeshAdjacencyDeserialize(EGL_MeshAdjacency *adj, const void *src, size_t size) {
+	uint32_t header[HEADER_WORDS];
+
+	memset(adj, 0, sizeof(*adj));
+	if (size < sizeof(header)) {
+		return false;
+	}
+	memcpy(header, src, sizeof(header));
+	if (header[0] != EGL_MESH_ADJACENCY_MAGIC || header[1] != EGL_MESH_ADJACENCY_VERSION) {
+		return false;
+	}
+
+	adj->vertex_count = header[2];
+	adj->node_count = header[3];
+	adj->triangle_count = header[4];
+	adj->edge_count = header[5];
+	adj->memory_size = layout_size(adj->vertex_count, adj->node_count, adj->triangle_count, adj->edge_count);
+	if (size - sizeof(header) < adj->memory_size) {
+		memset(adj, 0, sizeof(*adj));
+		return false;
+	}
+
+	adj->memory = EGL_malloc(adj->memory_size);
+	if (!adj->memory) {
+		memset(adj, 0, sizeof(*adj));
+		return false;
+	}
+	memcpy(adj->memory, (const char *)src + sizeof(header), adj->memory_size);
+	layout(adj);
+
+	return true;
+}
+
+/* Offsets must start at 0, never decrease and end at total */
+static bool valid_offsets(const uint32_t *offsets, uint32_t count, uint32_t total) {
+	if (offsets[0] != 0 || offsets[count] != total) {
+		return false;
+	}
+	for (uint32_t i = 0; i < count; i++) {
+		if (offsets[i] > offsets[i + 1]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool EGL_MeshAdjacencyValidate(const EGL_MeshAdjacency *adj, const uint32_t *indices, uint32_t index_count, uint32_t vertex_count) {
+	const uint32_t triangle_count = index_count / 3;
+	if (!adj->memory || adj->vertex_count != vertex_count || adj->triangle_count != triangle_count || adj->node_count > vertex_count) {
+		return false;
+	}
+
+	for (uint32_t v = 0; v < vertex_count; v++) {
+		if (adj->remap[v] >= adj->node_count) {
+			return false;
+		}
+	}
+	for (size_t i = 0; i < (size_t)triangle_count * 3; i++) {
+		if (indices[i] >= vertex_count || adj->triangle_nodes[i] != adj->remap[indices[i]]) {
+			return false;
+		}
+		const uint32_t across = adj->triangle_neighbors[i];
+		if ((across >= triangle_count && across != EGL_MESH_NONE) || adj->fans[i] >= triangle_count) {
+			return false;
+		}
+	}
+
+	if (!valid_offsets(adj->neighbor_offsets, adj->node_count, adj->edge_count) ||
+		!valid_offsets(adj->fan_offsets, adj->node_count, triangle_count * 3)) {
+		return false;
+	}
+	for (uint32_t e = 0; e < adj->edge_count; e++) {
+		if (adj->neighbors[e] >= adj->node_count) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool EGL_MeshIcosphere(int level, float **vertices, uint32_t *vertex_count, uint32_t **indices, uint32_t *index_count) {
+	static const float PHI = 1.6180339887498949f;
+	static const float CORNERS[12][3] = {
+		{ -1.0f,  PHI,  0.0f }, {  1.0f,  PHI,  0.0f }, { -1.0f, -PHI,  0.0f }, {  1.0f, -PHI,  0.0f },
+		{  0.0f, -1.0f,  PHI }, {  0.0f,  1.0f,  PHI }, {  0.0f, -1.0f, -PHI }, {  0.0f,  1.0f, -PHI },
+		{  PHI,  0.0f, -1.0f }, {  PHI,  0.0f,  1.0f }, { -PHI,  0.0f, -1.0f }, { -PHI,  0.0f,  1.0f },
+	};
+	static const uint8_t FACES[20][3] = {
+		{ 0, 11,  5 }, { 0,  5,  1 }, { 0,  1,  7 }, { 0,  7, 10 }, { 0, 10, 11 },
+		{ 1,  5,  9 }, { 5, 11,  4 }, { 11, 10, 2 }, { 10, 7,  6 }, { 7,  1,  8 },
+		{ 3,  9,  4 }, { 3,  4,  2 }, { 3,  2,  6 }, { 3,  6,  8 }, { 3,  8,  9 },
+		{ 4,  9,  5 }, { 2,  4, 11 }, { 6,  2, 10 }, { 8,  6,  7 }, { 9,  8,  1 },
+	};
+
+	if (level < 0 || level > 10) {
+		return false;
+	}
+
+	const uint32_t n = UINT32_C(1) << level;
+	const uint32_t face_vertices = (n + 1) * (n + 2) / 2;
+	const uint32_t face_triangles = n * n;
+
+	*vertex_count = 20 * face_vertices;
+	*index_count = 20 * face_triangles * 3;
+	*vertices = (float *)EGL_malloc(sizeof(float) * 3 * (size_t)*vertex_count);
+	*indices = (uint32_t *)EGL_malloc(sizeof(uint32_t) * (size_t)*index_count);
+	if (!*vertices || !*indices) {
+		EGL_free(*vertices);
+		EGL_free(*indices);
+		*vertices = NULL;
+		*indices = NULL;
+		return false;
+	}
+
+	float *v = *vertices;
+	uint32_t *idx = *indices;
+	for (int f = 0; f < 20; f++) {
+		const float *A = CORNERS[FACES[f][0]];
+		const float *B = CORNERS[FACES[f][1]];
+		const float *C = CORNERS[FACES[f][2]];
+		const uint32_t base = (uint32_t)f * face_vertices;
+
+		/* Row i holds i + 1 vertices; weights are integers so shared edges match exactly */
+		for (uint32_t i = 0; i <= n; i++) {
+			for (uint32_t j = 0; j <= i; j++) {
+				float wa = (float)(n - i);
+				float wb = (float)(i - j);
+				float wc = (float)j;
+				float p[3];
+				for (int c = 0; c < 3; c++) {
+					p[c] = wa * A[c] + wb * B[c] + wc * C[c];
+				}
+				float inv = 1.0f / sqrtf(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+				*v++ = p[0] * inv;
+				*v++ = p[1] * inv;
+				*v++ = p[2] * inv;
+			}
+		}
+
+		for (uint32_t i = 0; i < n; i++) {
+			uint32_t row = base + i * (i + 1) / 2;
+			uint32_t next = base + (i + 1) * (i + 2) / 2;
+			for (uint32_t j = 0; j <= i; j++) {
+				*idx++ = row + j;
+				*idx++ = next + j;
+				*idx++ = next + j + 1;
+				if (j < i) {
+					*idx++ = row + j;
+					*idx++ = next + j + 1;
+					*idx++ = row + j + 1;
+				}
+			}
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,90 @@
+#include <EGL/EGL_bench.h>
+#include <EGL/EGL_mesh.h>
+
+#include <stdlib.h>
+
+
+#define LEVEL_MIN 4
+#define LEVEL_MAX 9
+
+
+/* Average each node's neighbor positions (one umbrella smoothing step). */
+static double iterate_neighbors(const EGL_MeshAdjacency *adj, float *out) {
+	const uint32_t *offsets = adj->neighbor_offsets;
+	const uint32_t *neighbors = adj->neighbors;
+	const float *positions = adj->positions;
+
+	double begin = EGL_BenchNow();
+	for (uint32_t n = 0; n < adj->node_count; n++) {
+		float sum[3] = { 0.0f, 0.0f, 0.0f };
+		for (uint32_t e = offsets[n]; e < offsets[n + 1]; e++) {
+			const float *p = positions + (size_t)neighbors[e] * 3;
+			sum[0] += p[0];
+			sum[1] += p[1];
+			sum[2] += p[2];
+		}
+		float inv = 1.0f / (float)(offsets[n + 1] - offsets[n]);
+		out[n * 3 + 0] = sum[0] * inv;
+		out[n * 3 + 1] = sum[1] * inv;
+		out[n * 3 + 2] = sum[2] * inv;
+	}
+	return EGL_BenchNow() - begin;
+}
+
+
+void EGL_MeshBench(void) {
+	EGL_DECLARE_BENCH(EGL_mesh);
+
+	char label[64];
+
+	for (int level = LEVEL_MIN; level <= LEVEL_MAX; level++) {
+		float *vertices = NULL;
+		uint32_t *indices = NULL;
+		uint32_t vertex_count = 0;
+		uint32_t index_count = 0;
+
+		if (!EGL_MeshIcosphere(level, &vertices, &vertex_count, &indices, &index_count)) {
+			printf(" level %d: failed to generate icosphere\n", level);
+			return;
+		}
+
+		EGL_MeshAdjacency adj;
+		double best = 1e30;
+		int repeats = (level < 8) ? EGL_BENCH_REPEATS : 1;
+		for (int r = 0; r < repeats; r++) {
+			double begin = EGL_BenchNow();
+			if (!EGL_MeshAdjacencyBuild(&adj, indices, index_count, vertices, vertex_count)) {
+				printf(" level %d: failed to build adjacency\n", level);
+				EGL_free(vertices);
+				EGL_free(indices);
+				return;
+			}
+			double elapsed = EGL_BenchNow() - begin;
+			best = (elapsed < best) ? elapsed : best;
+			if (r + 1 < repeats) {
+				EGL_MeshAdjacencyFree(&adj);
+			}
+		}
+		snprintf(label, sizeof(label), "build level %d (%u tris)", level, adj.triangle_count);
+		EGL_BenchReport(label, best, (double)adj.triangle_count, "tri");
+
+		float *smoothed = (float *)malloc(sizeof(float) * 3 * adj.node_count);
+		best = 1e30;
+		for (int r = 0; r < EGL_BENCH_REPEATS; r++) {
+			double elapsed = iterate_neighbors(&adj, smoothed);
+			best = (elapsed < best) ? elapsed : best;
+		}
+		EGL_BENCH_SINK += (uint64_t)smoothed[adj.node_count / 2];
+
+		/* Offsets, neighbor ids, gathered positions and written averages */
+		double bytes = (double)adj.node_count * (sizeof(uint32_t) + 3 * sizeof(float))
+			+ (double)adj.edge_count * (sizeof(uint32_t) + 3 * sizeof(float));
+		snprintf(label, sizeof(label), "neighbor iteration level %d (%u nodes)", level, adj.node_count);
+		EGL_BenchReport(label, best, bytes, "B");
+
+		free(smoothed);
+		EGL_MeshAdjacencyFree(&adj);
+		EGL_free(vertices);
+		EGL_free(indices);
+	}
+}
@@ -0,0 +1,230 @@
+#include <EGL/EGL_testing.h>
+#include <math.h>
+#include <stdlib.h>
+
+
+#define LEVEL 3 // 1280 triangles, 642 welded vertices.
+
+
+/**
+ * Icosphere generation produces 20 * 4^L triangles on the unit sphere.
+ */
+static void EGL_MeshIcosphereTest(EGL_Test *T) {
+	EGL_DECLARE_TEST;
+
+	float *vertices = NULL;
+	uint32_t *indices = NULL;
+	uint32_t vertex_count = 0;
+	uint32_t index_count = 0;
+
+	if (!EGL_MeshIcosphere(LEVEL, &vertices, &vertex_count, &indices, &index_count)) {
+		EGL_DECLARE_ERROR("Failed to generate icosphere of level %d.", LEVEL);
+		return;
+	}
+
+	if (index_count != 1280 * 3) {
+		EGL_DECLARE_ERROR("Expected %d indices, got %u.", 1280 * 3, index_count);
+	}
+	for (uint32_t v = 0; v < vertex_count; v++) {
+		float *p = vertices + v * 3;
+		float r = p[0] * p[0] + p[1] * p[1] + p[2] * p[2];
+		if (fabsf(r - 1.0f) > 1e-5f) {
+			EGL_DECLARE_ERROR("Vertex %u is not on the unit sphere (r^2 = %f).", v, r);
+			break;
+		}
+	}
+	for (uint32_t i = 0; i < index_count; i++) {
+		if (indices[i] >= vertex_count) {
+			EGL_DECLARE_ERROR("Index %u out of bounds: %u.", i, indices[i]);
+			break;
+		}
+	}
+
+	EGL_free(vertices);
+	EGL_free(indices);
+}
+
+/**
+ * A closed icosphere welds to V = 10 * 4^L + 2 nodes, 12 of degree 5 and the
+ * rest of degree 6. Every triangle has three mutual neighbors sharing an edge.
+ */
+static void EGL_MeshAdjacencyTest(EGL_Test *T) {
+	EGL_DECLARE_TEST;
+
+	float *vertices = NULL;
+	uint32_t *indices = NULL;
+	uint32_t vertex_count = 0;
+	uint32_t index_count = 0;
+	EGL_MeshAdjacency adj;
+
+	EGL_MeshIcosphere(LEVEL, &vertices, &vertex_count, &indices, &index_count);
+	if (!EGL_MeshAdjacencyBuild(&adj, indices, index_count, vertices, vertex_count)) {
+		EGL_DECLARE_ERROR("Failed to build adjacency of level %d.", LEVEL);
+		return;
+	}
+
+	if (adj.node_count != 642) {
+		EGL_DECLARE_ERROR("Expected 642 welded nodes, got %u.", adj.node_count);
+	}
+	if (adj.edge_count != 1280 * 3) {
+		EGL_DECLARE_ERROR("Expected %d directed edges, got %u.", 1280 * 3, adj.edge_count);
+	}
+
+	int pentagons = 0;
+	for (uint32_t n = 0; n < adj.node_count && T->error_count < ERRORS_MAX - 1; n++) {
+		uint32_t degree = EGL_MeshNodeDegree(&adj, n);
+		pentagons += (degree == 5);
+		if (degree != 5 && degree != 6) {
+			EGL_DECLARE_ERROR("Node %u has degree %u.", n, degree);
+		}
+		if (adj.fan_offsets[n + 1] - adj.fan_offsets[n] != degree) {
+			EGL_DECLARE_ERROR("Node %u fan size differs from its degree.", n);
+		}
+		for (uint32_t e = adj.neighbor_offsets[n] + 1; e < adj.neighbor_offsets[n + 1]; e++) {
+			if (adj.neighbors[e - 1] >= adj.neighbors[e]) {
+				EGL_DECLARE_ERROR("Neighbors of node %u are not sorted.", n);
+			}
+		}
+	}
+	if (pentagons != 12) {
+		EGL_DECLARE_ERROR("Expected 12 nodes of degree 5, got %d.", pentagons);
+	}
+
+	for (uint32_t t = 0; t < adj.triangle_count && T->error_count < ERRORS_MAX - 1; t++) {
+		for (uint32_t e = 0; e < 3; e++) {
+			uint32_t u = adj.triangle_neighbors[t * 3 + e];
+			if (u == EGL_MESH_NONE) {
+				EGL_DECLARE_ERROR("Triangle %u has no neighbor across edge %u.", t, e);
+				continue;
+			}
+			uint32_t a = adj.triangle_nodes[t * 3 + e];
+			uint32_t b = adj.triangle_nodes[t * 3 + (e + 1) % 3];
+			bool back = false;
+			int shared = 0;
+			for (uint32_t f = 0; f < 3; f++) {
+				back |= (adj.triangle_neighbors[u * 3 + f] == t);
+				shared += (adj.triangle_nodes[u * 3 + f] == a) + (adj.triangle_nodes[u * 3 + f] == b);
+			}
+			if (!back || shared != 2) {
+				EGL_DECLARE_ERROR("Triangles %u and %u are not mutual edge neighbors.", t, u);
+			}
+		}
+	}
+
+	EGL_MeshAdjacencyFree(&adj);
+	EGL_free(vertices);
+	EGL_free(indices);
+}
+
+/**
+ * Building rejects an index past the last vertex and a partial triangle,
+ * leaving the adjacency empty, rather than reading past the vertex arrays.
+ */
+static void EGL_MeshAdjacencyIndicesTest(EGL_Test *T) {
+	EGL_DECLARE_TEST;
+
+	float *vertices = NULL;
+	uint32_t *indices = NULL;
+	uint32_t vertex_count = 0;
+	uint32_t index_count = 0;
+	EGL_MeshAdjacency adj;
+
+	EGL_MeshIcosphere(LEVEL, &vertices, &vertex_count, &indices, &index_count);
+	const uint32_t kept = indices[index_count / 2];
+	indices[index_count / 2] = vertex_count;
+	if (EGL_MeshAdjacencyBuild(&adj, indices, index_count, vertices, vertex_count) || adj.memory) {
+		EGL_DECLARE_ERROR("Built adjacency with index %u of %u vertices.", vertex_count, vertex_count);
+		EGL_MeshAdjacencyFree(&adj);
+	}
+	indices[index_count / 2] = kept;
+	if (EGL_MeshAdjacencyBuild(&adj, indices, index_count - 1, vertices, vertex_count) || adj.memory) {
+		EGL_DECLARE_ERROR("Built adjacency from %u indices.", index_count - 1);
+		EGL_MeshAdjacencyFree(&adj);
+	}
+
+	EGL_free(vertices);
+	EGL_free(indices);
+}
+
+/**
+ * Serialized adjacency deserializes to identical memory and rejects garbage,
+ * and validates only against the mesh it was built from.
+ */
+static void EGL_MeshAdjacencySerializeTest(EGL_Test *T) {
+	EGL_DECLARE_TEST;
+
+	float *vertices = NULL;
+	uint32_t *indices = NULL;
+	uint32_t vertex_count = 0;
+	uint32_t index_count = 0;
+	EGL_MeshAdjacency adj;
+	EGL_MeshAdjacency copy;
+
+	EGL_MeshIcosphere(LEVEL, &vertices, &vertex_count, &indices, &index_count);
+	EGL_MeshAdjacencyBuild(&adj, indices, index_count, vertices, vertex_count);
+
+	size_t size = EGL_MeshAdjacencySerializedSize(&adj);
+	char *buffer = (char *)malloc(size);
+	size_t written = EGL_MeshAdjacencySerialize(&adj, buffer);
+	if (written != size) {
+		EGL_DECLARE_ERROR("Wrote %zu bytes, expected %zu.", written, size);
+	}
+
+	if (!EGL_MeshAdjacencyDeserialize(&copy, buffer, size)) {
+		EGL_DECLARE_ERROR("Failed to deserialize %zu bytes of adjacency.", size);
+	} else {
+		if (copy.memory_size != adj.memory_size || memcmp(copy.memory, adj.memory, adj.memory_size) != 0) {
+			EGL_DECLARE_ERROR("Deserialized adjacency (%zu bytes) differs from the original.", copy.memory_size);
+		}
+		if (copy.neighbors[copy.neighbor_offsets[7]] != adj.neighbors[adj.neighbor_offsets[7]]) {
+			EGL_DECLARE_ERROR("Deserialized neighbors of node %d are laid out incorrectly.", 7);
+		}
+		EGL_MeshAdjacencyFree(&copy);
+	}
+
+	/* It matches the mesh it was built from, and no longer does once changed or paired with another */
+	if (!EGL_MeshAdjacencyValidate(&adj, indices, index_count, vertex_count)) {
+		EGL_DECLARE_ERROR("Adjacency of %u vertices failed to validate against its own mesh.", vertex_count);
+	}
+	if (EGL_MeshAdjacencyValidate(&adj, indices, index_count - 3, vertex_count) ||
+		EGL_MeshAdjacencyValidate(&adj, indices, index_count, vertex_count + 1)) {
+		EGL_DECLARE_ERROR("Adjacency of %u triangles validated against a mesh of another size.", adj.triangle_count);
+	}
+	const uint32_t neighbor = adj.neighbors[0];
+	adj.neighbors[0] = adj.node_count;
+	if (EGL_MeshAdjacencyValidate(&adj, indices, index_count, vertex_count)) {
+		EGL_DECLARE_ERROR("Adjacency with neighbor %u of %u nodes validated.", adj.neighbors[0], adj.node_count);
+	}
+	adj.neighbors[0] = neighbor;
+	const uint32_t corner = indices[0];
+	indices[0] = indices[1];
+	if (EGL_MeshAdjacencyValidate(&adj, indices, index_count, vertex_count)) {
+		EGL_DECLARE_ERROR("Adjacency validated against a mesh with triangle %d rewired.", 0);
+	}
+	indices[0] = corner;
+
+	if (EGL_MeshAdjacencyDeserialize(&copy, buffer, size - 4)) {
+		EGL_DECLARE_ERROR("Deserialized truncated data (%zu bytes).", size - 4);
+		EGL_MeshAdjacencyFree(&copy);
+	}
+	buffer[0] ^= 0xFF;
+	if (EGL_MeshAdjacencyDeserialize(&copy, buffer, size)) {
+		EGL_DECLARE_ERROR("Deserialized data with a bad magic number (0x%08X).", *(uint32_t *)buffer);
+		EGL_MeshAdjacencyFree(&copy);
+	}
+
+	free(buffer);
+	EGL_MeshAdjacencyFree(&adj);
+	EGL_free(vertices);
+	EGL_free(indices);
+}
+
+
+void EGL_MeshTest(EGL_TestModule *M) {
+	EGL_DECLARE_MODULE(EGL_mesh);
+
+	EGL_RUN_TEST(EGL_MeshIcosphereTest);
+	EGL_RUN_TEST(EGL_MeshAdjacencyTest);
+	EGL_RUN_TEST(EGL_MeshAdjacencyIndicesTest);
+	EGL_RUN_TEST(EGL_MeshAdjacencySerializeTest);
+}
@@ -0,0 +1,207 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <EGL/EGL_pack.h>
+#include <EGL/EGL_memory.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __unix__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+static size_t round_up(size_t n, size_t multiple) {
+	return (n + multiple - 1) / multiple * multiple;
+}
+
+static bool write_zeros(FILE *f, size_t count) {
+	static const uint8_t zeros[EGL_PACK_ALIGN];
+	return fwrite(zeros, 1, count, f) == count;
+}
+
+/* Check everything lookups will trust, so a truncated or foreign file is rejected here */
+static bool validate(EGL_Pack *p) {
+	if (p->size < sizeof(EGL_PackHeader)) {
+		return false;
+	}
+	const EGL_PackHeader *h = (const EGL_PackHeader *)p->base;
+	if (memcmp(h->magic, EGL_PACK_MAGIC, sizeof(EGL_PACK_MAGIC)) != 0 || h->version != EGL_PACK_VERSION || h->size != p->size) {
+		return false;
+	}
+	if (h->slots == 0 || (h->slots & (h->slots - 1)) != 0 || h->slots <= h->count) {
+		return false;
+	}
+	const uint64_t names = sizeof(EGL_PackHeader) + (uint64_t)h->count * sizeof(EGL_PackEntry) + (uint64_t)h->slots * sizeof(uint32_t);
+	if (names + h->names_size > p->size) {
+		return false;
+	}
+
+	p->header = h;
+	p->entries = (const EGL_PackEntry *)(p->base + sizeof(EGL_PackHeader));
+	p->slots = (const uint32_t *)(p->entries + h->count);
+	p->names = (const char *)(p->base + names);
+
+	for (uint32_t i = 0; i < h->count; i++) {
+		const EGL_PackEntry *e = &p->entries[i];
+		if (e->offset % EGL_PACK_ALIGN || e->offset > p->size || e->size > p->size - e->offset) {
+			return false;
+		}
+		if ((uint64_t)e->name + e->name_length >= h->names_size || p->names[e->name + e->name_length] != '\0') {
+			return false;
+		}
+	}
+	uint32_t used = 0;
+	for (uint32_t s = 0; s < h->slots; s++) {
+		if (p->slots[s] > h->count) {
+			return false;
+		}
+		used += (p->slots[s] != 0);
+	}
+	return used == h->count; // So lookups always reach an empty slot
+}
+
+
+bool EGL_PackWrite(const char *path, const char *const *names, const void *const *data, const size_t *sizes, uint32_t count) {
+	EGL_PackHeader header = { .magic = EGL_PACK_MAGIC, .version = EGL_PACK_VERSION, .count = count, .slots = 1 };
+	while (header.slots < 2 * (uint64_t)count) {
+		header.slots *= 2;
+	}
+
+	EGL_PackEntry *entries = (EGL_PackEntry *)EGL_calloc(count ? count : 1, sizeof(EGL_PackEntry));
+	uint32_t *slots = (uint32_t *)EGL_calloc(header.slots, sizeof(uint32_t));
+	if (!entries || !slots) {
+		EGL_free(entries);
+		EGL_free(slots);
+		return false;
+	}
+
+	/* Names and the hash table first, so the assets' offsets are known before writing */
+	bool ok = true;
+	size_t names_size = 0;
+	for (uint32_t i = 0; i < count && ok; i++) {
+		const size_t length = strlen(names[i]);
+		entries[i].hash = EGL_PackHash(names[i], length);
+		entries[i].name = (uint32_t)names_size;
+		entries[i].name_length = (uint32_t)length;
+		entries[i].size = sizes[i];
+		names_size += length + 1;
+
+		uint32_t s = (uint32_t)entries[i].hash & (header.slots - 1);
+		while (slots[s]) {
+			const EGL_PackEntry *other = &entries[slots[s] - 1];
+			if (other->hash == entries[i].hash && strcmp(names[slots[s] - 1], names[i]) == 0) {
+				ok = false; // The same name twice
+				break;
+			}
+			s = (s + 1) & (header.slots - 1);
+		}
+		slots[s] = i + 1;
+	}
+	header.names_size = (uint32_t)names_size;
+
+	const size_t table_end = sizeof(header) + count * sizeof(EGL_PackEntry) + header.slots * sizeof(uint32_t) + names_size;
+	size_t offset = round_up(table_end, EGL_PACK_ALIGN);
+	for (uint32_t i = 0; i < count; i++) {
+		entries[i].offset = offset;
+		offset = round_up(offset + sizes[i], EGL_PACK_ALIGN);
+	}
+	header.size = offset;
+
+	FILE *f = ok ? fopen(path, "wb") : NULL;
+	ok = f != NULL;
+	ok = ok && fwrite(&header, sizeof(header), 1, f) == 1;
+	ok = ok && fwrite(entries, sizeof(EGL_PackEntry), count, f) == count;
+	ok = ok && fwrite(slots, sizeof(uint32_t), header.slots, f) == header.slots;
+	for (uint32_t i = 0; i < count && ok; i++) {
+		ok = fwrite(names[i], 1, entries[i].name_length + 1, f) == entries[i].name_length + 1;
+	}
+	ok = ok && write_zeros(f, round_up(table_end, EGL_PACK_ALIGN) - table_end);
+	for (uint32_t i = 0; i < count && ok; i++) {
+		ok = fwrite(data[i], 1, sizes[i], f) == sizes[i];
+		ok = ok && write_zeros(f, round_up(sizes[i], EGL_PACK_ALIGN) - sizes[i]);
+	}
+	if (f && fclose(f) != 0) {
+		ok = false;
+	}
+
+	EGL_free(entries);
+	EGL_free(slots);
+	return ok;
+}
+
+bool EGL_PackOpen(EGL_Pack *p, const char *path) {
+	memset(p, 0, sizeof(*p));
+#ifdef __unix__
+	const int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+		close(fd);
+		return false;
+	}
+	void *base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd); // The mapping keeps the file open
+	if (base == MAP_FAILED) {
+		return false;
+	}
+	p->base = (const uint8_t *)base;
+	p->size = (size_t)st.st_size;
+	p->mapped = true;
+#else
+	FILE *f = fopen(path, "rb");
+	if (!f) {
+		return false;
+	}
+	long size = -1;
+	if (fseek(f, 0, SEEK_END) == 0) {
+		size = ftell(f);
+	}
+	uint8_t *base = (size > 0 && fseek(f, 0, SEEK_SET) == 0) ? (uint8_t *)EGL_malloc((size_t)size) : NULL;
+	if (!base || fread(base, 1, (size_t)size, f) != (size_t)size) {
+		EGL_free(base);
+		fclose(f);
+		return false;
+	}
+	fclose(f);
+	p->base = base;
+	p->size = (size_t)size;
+#endif
+
+	if (!validate(p)) {
+		EGL_PackClose(p);
+		return false;
+	}
+	return true;
+}
+
+void EGL_PackClose(EGL_Pack *p) {
+#ifdef __unix__
+	if (p->mapped) {
+		munmap((void *)p->base, p->size);
+	}
+#else
+	EGL_free((void *)p->base);
+#endif
+	memset(p, 0, sizeof(*p));
+}
+
+uint32_t EGL_PackFind(const EGL_Pack *p, const char *name) {
+	const size_t length = strlen(name);
+	const uint64_t hash = EGL_PackHash(name, length);
+	const uint32_t mask = p->header->slots - 1;
+
+	for (uint32_t s = (uint32_t)hash & mask; p->slots[s]; s = (s + 1) & mask) {
+		const EGL_PackEntry *e = &p->entries[p->slots[s] - 1];
+		if (e->hash == hash && e->name_length == length && memcmp(p->names + e->name, name, length) == 0) {
+			return p->slots[s] - 1;
+		}
+	}
+	return EGL_PACK_NONE;
+}
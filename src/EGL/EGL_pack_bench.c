@@ -0,0 +1,132 @@
+#include <EGL/EGL_bench.h>
+#include <EGL/EGL_pack.h>
+
+#include <stdlib.h>
+
+
+#define ASSETS 64
+#define ASSET_BYTES_MAX 65536 // Assets are 1 to this many bytes.
+#define LOOKUPS 1000000
+#define PACK_PATH "EGL_pack_bench.pack"
+#define PATH_FORMAT "EGL_pack_bench_%d.bin"
+
+
+static uint32_t lcg(uint32_t *state) {
+	*state = *state * 1664525u + 1013904223u;
+	return *state >> 8;
+}
+
+/* Sum one byte per cache line, so every page of the asset is touched */
+static uint64_t touch(const uint8_t *bytes, size_t size) {
+	uint64_t sum = 0;
+	for (size_t i = 0; i < size; i += 64) {
+		sum += bytes[i];
+	}
+	return sum;
+}
+
+/* What startup did before: open, size, allocate and copy each file */
+static void load_loose(char paths[ASSETS][64]) {
+	for (int i = 0; i < ASSETS; i++) {
+		FILE *f = fopen(paths[i], "rb");
+		if (!f) {
+			continue;
+		}
+		fseek(f, 0, SEEK_END);
+		const long size = ftell(f);
+		fseek(f, 0, SEEK_SET);
+		uint8_t *data = (uint8_t *)malloc((size_t)size);
+		if (data && fread(data, 1, (size_t)size, f) == (size_t)size) {
+			EGL_BENCH_SINK += touch(data, (size_t)size);
+		}
+		free(data);
+		fclose(f);
+	}
+}
+
+static void load_pack(char names[ASSETS][32]) {
+	EGL_Pack p;
+	if (!EGL_PackOpen(&p, PACK_PATH)) {
+		return;
+	}
+	for (int i = 0; i < ASSETS; i++) {
+		size_t size = 0;
+		const uint8_t *view = (const uint8_t *)EGL_PackGet(&p, names[i], &size);
+		EGL_BENCH_SINK += view ? touch(view, size) : 0;
+	}
+	EGL_PackClose(&p);
+}
+
+
+void EGL_PackBench(void) {
+	EGL_DECLARE_BENCH(EGL_pack);
+
+	char paths[ASSETS][64];
+	char names[ASSETS][32];
+	const char *name_list[ASSETS];
+	const void *data[ASSETS];
+	size_t sizes[ASSETS];
+	uint8_t *bytes = (uint8_t *)malloc(ASSET_BYTES_MAX);
+	if (!bytes) {
+		printf(" failed to allocate\n");
+		return;
+	}
+	uint32_t state = 46;
+	for (int b = 0; b < ASSET_BYTES_MAX; b++) {
+		bytes[b] = (uint8_t)lcg(&state);
+	}
+	for (int i = 0; i < ASSETS; i++) {
+		snprintf(paths[i], sizeof(paths[i]), PATH_FORMAT, i);
+		snprintf(names[i], sizeof(names[i]), PATH_FORMAT, i);
+		name_list[i] = names[i];
+		data[i] = bytes;
+		sizes[i] = 1 + lcg(&state) % ASSET_BYTES_MAX;
+		FILE *f = fopen(paths[i], "wb");
+		if (f) {
+			fwrite(bytes, 1, sizes[i], f);
+			fclose(f);
+		}
+	}
+	const bool packed = EGL_PackWrite(PACK_PATH, name_list, data, sizes, ASSETS);
+	free(bytes);
+	EGL_Pack p;
+	if (!packed || !EGL_PackOpen(&p, PACK_PATH)) {
+		printf(" failed to write %s\n", PACK_PATH);
+		return;
+	}
+
+#define RUN(name, count, unit, ...) do { \
+		double best = 1e30; \
+		for (int r = 0; r < EGL_BENCH_REPEATS; r++) { \
+			double begin = EGL_BenchNow(); \
+			for (int i = 0; i < (count); i++) { \
+				__VA_ARGS__; \
+			} \
+			double elapsed = EGL_BenchNow() - begin; \
+			best = (elapsed < best) ? elapsed : best; \
+		} \
+		EGL_BenchReport(name, best, (double)(count) * ASSETS, unit); \
+	} while (0)
+
+	/* Every asset opened and touched, from a warm page cache */
+	RUN("load, loose files", 20, "asset", load_loose(paths));
+	RUN("load, packed archive", 20, "asset", load_pack(names));
+#undef RUN
+
+	double best = 1e30;
+	for (int r = 0; r < EGL_BENCH_REPEATS; r++) {
+		double begin = EGL_BenchNow();
+		for (int i = 0; i < LOOKUPS; i++) {
+			EGL_BENCH_SINK += EGL_PackFind(&p, names[lcg(&state) % ASSETS]);
+		}
+		double elapsed = EGL_BenchNow() - begin;
+		best = (elapsed < best) ? elapsed : best;
+	}
+	EGL_BenchReport("lookup by name", best, LOOKUPS, "lookup");
+
+	EGL_PackClose(&p);
+	for (int i = 0; i < ASSETS; i++) {
+		remove(paths[i]);
+	}
+	remove(PACK_PATH);
+}
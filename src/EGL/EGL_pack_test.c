@@ -0,0 +1,137 @@
+#include <EGL/EGL_testing.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+#define ASSETS 40
+#define PACK_PATH "EGL_pack_test.pack"
+
+
+/* Asset i holds i * 37 bytes (asset 0 is empty), each the asset's index plus its position */
+static void fill(uint8_t *bytes, int i) {
+	for (int b = 0; b < i * 37; b++) {
+		bytes[b] = (uint8_t)(i + b);
+	}
+}
+
+static bool write_pack(char names[ASSETS][32], uint8_t *bytes[ASSETS]) {
+	const char *name_list[ASSETS];
+	const void *data[ASSETS];
+	size_t sizes[ASSETS];
+	for (int i = 0; i < ASSETS; i++) {
+		snprintf(names[i], 32, "asset_%d.bin", i);
+		bytes[i] = (uint8_t *)malloc((size_t)i * 37 + 1);
+		if (!bytes[i]) {
+			return false;
+		}
+		fill(bytes[i], i);
+		name_list[i] = names[i];
+		data[i] = bytes[i];
+		sizes[i] = (size_t)i * 37;
+	}
+	return EGL_PackWrite(PACK_PATH, name_list, data, sizes, ASSETS);
+}
+
+
+/**
+ * Every packed asset is found by name and by id, aligned and byte for byte
+ * what was packed, and names that were not packed are not found.
+ */
+static void EGL_PackLookupTest(EGL_Test *T) {
+	EGL_DECLARE_TEST;
+
+	char names[ASSETS][32];
+	uint8_t *bytes[ASSETS] = { 0 };
+	const bool written = write_pack(names, bytes);
+	EGL_Pack p;
+	if (!written || !EGL_PackOpen(&p, PACK_PATH)) {
+		EGL_DECLARE_ERROR("Failed to write or open %s.", PACK_PATH);
+		for (int i = 0; i < ASSETS; i++) {
+			free(bytes[i]);
+		}
+		return;
+	}
+
+	for (int i = 0; i < ASSETS; i++) {
+		const uint32_t id = EGL_PackFind(&p, names[i]);
+		size_t size = 0;
+		const uint8_t *view = (const uint8_t *)EGL_PackGet(&p, names[i], &size);
+		if (id != (uint32_t)i || !view || size != (size_t)i * 37 || strcmp(EGL_PackName(&p, id), names[i]) != 0) {
+			EGL_DECLARE_ERROR("Looking up %s gave id %u and %zu bytes.", names[i], id, size);
+			continue;
+		}
+		if ((uintptr_t)view % EGL_PACK_ALIGN || memcmp(view, bytes[i], size) != 0) {
+			EGL_DECLARE_ERROR("Asset %d was misaligned or its bytes differ.", i);
+		}
+	}
+	size_t size = 0;
+	if (EGL_PackFind(&p, "asset_40.bin") != EGL_PACK_NONE || EGL_PackFind(&p, "asset_1") != EGL_PACK_NONE ||
+		EGL_PackGet(&p, "", &size) != NULL || EGL_PackData(&p, ASSETS, &size) != NULL) {
+		EGL_DECLARE_ERROR("Found an asset that was not packed among %d.", ASSETS);
+	}
+
+	EGL_PackClose(&p);
+	for (int i = 0; i < ASSETS; i++) {
+		free(bytes[i]);
+	}
+	remove(PACK_PATH);
+}
+
+/**
+ * Packing the same name twice fails, and a truncated or foreign file does not
+ * open.
+ */
+static void EGL_PackRejectTest(EGL_Test *T) {
+	EGL_DECLARE_TEST;
+
+	const char *names[] = { "a.bin", "b.bin", "a.bin" };
+	const void *data[] = { "a", "b", "c" };
+	const size_t sizes[] = { 1, 1, 1 };
+	if (EGL_PackWrite(PACK_PATH, names, data, sizes, 3)) {
+		EGL_DECLARE_ERROR("Packed %s twice.", names[0]);
+	}
+	if (!EGL_PackWrite(PACK_PATH, names, data, sizes, 2)) {
+		EGL_DECLARE_ERROR("Failed to write %s.", PACK_PATH);
+		return;
+	}
+
+	/* Read the archive back, then write it out cut short and with a bad magic */
+	FILE *f = fopen(PACK_PATH, "rb");
+	uint8_t whole[1024];
+	const size_t length = f ? fread(whole, 1, sizeof(whole), f) : 0;
+	if (f) {
+		fclose(f);
+	}
+	EGL_Pack p;
+	const size_t cuts[] = { length - 1, sizeof(EGL_PackHeader) + 8, 4 };
+	for (size_t c = 0; c < sizeof(cuts) / sizeof(cuts[0]); c++) {
+		f = fopen(PACK_PATH, "wb");
+		if (f) {
+			fwrite(whole, 1, cuts[c], f);
+			fclose(f);
+		}
+		if (EGL_PackOpen(&p, PACK_PATH)) {
+			EGL_DECLARE_ERROR("Opened an archive of %zu bytes cut to %zu.", length, cuts[c]);
+			EGL_PackClose(&p);
+		}
+	}
+	whole[0] ^= 0xff;
+	f = fopen(PACK_PATH, "wb");
+	if (f) {
+		fwrite(whole, 1, length, f);
+		fclose(f);
+	}
+	if (EGL_PackOpen(&p, PACK_PATH)) {
+		EGL_DECLARE_ERROR("Opened an archive with magic byte %02x.", whole[0]);
+		EGL_PackClose(&p);
+	}
+	remove(PACK_PATH);
+}
+
+
+void EGL_PackTest(EGL_TestModule *M) {
+	EGL_DECLARE_MODULE(EGL_pack);
+
+	EGL_RUN_TEST(EGL_PackLookupTest);
+	EGL_RUN_TEST(EGL_PackRejectTest);
+}
@@ -0,0 +1,103 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <EGL/EGL_parallel.h>
+
+#include <stdbool.h>
+#include <threads.h>
+#include <unistd.h>
+
+
+static int THREAD_COUNT = 0;
+
+
+typedef struct {
+	mtx_t mutex;
+	cnd_t cond;
+	bool open;
+} Gate;
+
+typedef struct {
+	EGL_ParallelFunc func;
+	void *data;
+	int index;
+	int count;
+	Gate *gate;
+} Invocation;
+
+/* Wait until every invocation has a thread so they all run concurrently. */
+static int invoke(void *arg) {
+	Invocation *inv = (Invocation *)arg;
+
+	mtx_lock(&inv->gate->mutex);
+	while (!inv->gate->open) {
+		cnd_wait(&inv->gate->cond, &inv->gate->mutex);
+	}
+	mtx_unlock(&inv->gate->mutex);
+
+	inv->func(inv->data, inv->index, inv->count);
+	return 0;
+}
+
+
+int EGL_ThreadCount(void) {
+	if (THREAD_COUNT > 0) {
+		return THREAD_COUNT;
+	}
+
+	long online = sysconf(_SC_NPROCESSORS_ONLN);
+	if (online < 1) {
+		return 1;
+	}
+	return (online > EGL_THREADS_MAX) ? EGL_THREADS_MAX : (int)online;
+}
+
+void EGL_SetThreadCount(int count) {
+	THREAD_COUNT = (count > EGL_THREADS_MAX) ? EGL_THREADS_MAX : count;
+}
+
+void EGL_ParallelRun(EGL_ParallelFunc func, void *data, int count) {
+	if (count > EGL_THREADS_MAX) {
+		count = EGL_THREADS_MAX;
+	}
+
+	Gate gate = { .open = false };
+	if (count <= 1 || mtx_init(&gate.mutex, mtx_plain) != thrd_success) {
+		func(data, 0, 1);
+		return;
+	}
+	if (cnd_init(&gate.cond) != thrd_success) {
+		mtx_destroy(&gate.mutex);
+		func(data, 0, 1);
+		return;
+	}
+
+	thrd_t threads[EGL_THREADS_MAX];
+	Invocation invocations[EGL_THREADS_MAX];
+
+	/* Shrink the count to the threads actually created before any invocation starts */
+	int spawned = 1;
+	for (int i = 1; i < count; i++) {
+		invocations[i] = (Invocation){ .func = func, .data = data, .index = i, .gate = &gate };
+		if (thrd_create(&threads[i], invoke, &invocations[i]) != thrd_success) {
+			break;
+		}
+		spawned++;
+	}
+	for (int i = 1; i < spawned; i++) {
+		invocations[i].count = spawned;
+	}
+
+	mtx_lock(&gate.mutex);
+	gate.open = true;
+	cnd_broadcast(&gate.cond);
+	mtx_unlock(&gate.mutex);
+
+	func(data, 0, spawned);
+
+	for (int i = 1; i < spawned; i++) {
+		thrd_join(threads[i], NULL);
+	}
+
+	cnd_destroy(&gate.cond);
+	mtx_destroy(&gate.mutex);
+}
@@ -0,0 +1,245 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <EGL/EGL_profile.h>
+#include <EGL/EGL_memory.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+#include <time.h>
+
+
+#define NAME_MAX 64   // Characters of a name written to the trace.
+#define LINE_MAX 256  // Room for one event with a name of NAME_MAX escaped characters.
+
+
+typedef struct {
+	const char *name;
+	uint64_t begin_ns;
+	uint64_t end_ns;
+} Event;
+
+/*
+ * A thread's ring, registered the first time it records. Rings live until the
+ * process exits, since a thread may record at any moment and nothing tells
+ * the profiler it is gone.
+ */
+typedef struct ProfileThread {
+	EGL_SpscRing ring;                 /**< Written by the thread, drained under LOCK. */
+	_Atomic(const char *) name;
+	const char *written_name;          /**< The name last written to the trace, under LOCK. */
+	int tid;
+	struct ProfileThread *next;
+} ProfileThread;
+
+
+_Atomic bool EGL_PROFILE_ENABLED = false;
+
+static _Atomic(ProfileThread *) THREADS = NULL;
+static _Thread_local ProfileThread *CURRENT = NULL;
+static _Atomic int NEXT_TID = 0;
+static _Atomic uint64_t DROPPED = 0;
+
+/* The trace, guarded by LOCK */
+static once_flag ONCE = ONCE_FLAG_INIT;
+static mtx_t LOCK;
+static FILE *TRACE = NULL;
+static uint64_t ORIGIN_NS = 0;
+static uint64_t FRAME = 0;
+static bool FIRST = true;
+
+
+static void init_lock(void) {
+	mtx_init(&LOCK, mtx_plain);
+}
+
+static ProfileThread *current(void) {
+	if (CURRENT) {
+		return CURRENT;
+	}
+	ProfileThread *t = (ProfileThread *)EGL_calloc(1, sizeof(ProfileThread));
+	if (!t || !EGL_SpscRingInit(&t->ring, EGL_PROFILE_EVENTS, sizeof(Event))) {
+		EGL_free(t);
+		return NULL;
+	}
+	atomic_init(&t->name, NULL);
+	t->tid = atomic_fetch_add(&NEXT_TID, 1) + 1;
+	t->next = atomic_load(&THREADS);
+	while (!atomic_compare_exchange_weak(&THREADS, &t->next, t)) {
+	}
+	CURRENT = t;
+	return t;
+}
+
+/*
+ * Events are formatted by hand into one buffer per line: fprintf with doubles,
+ * or a locked stdio call per character, costs more than recording the zone did.
+ */
+static char *put_text(char *p, const char *s) {
+	const size_t n = strlen(s);
+	memcpy(p, s, n);
+	return p + n;
+}
+
+/* A JSON string of at most NAME_MAX characters. */
+static char *put_string(char *p, const char *s) {
+	*p++ = '"';
+	for (int n = 0; *s && n < NAME_MAX; s++, n++) {
+		if (*s == '"' || *s == '\\') {
+			*p++ = '\\';
+			*p++ = *s;
+		} else if ((unsigned char)*s >= 0x20) {
+			*p++ = *s;
+		}
+	}
+	*p++ = '"';
+	return p;
+}
+
+static char *put_u64(char *p, uint64_t v) {
+	char digits[20];
+	int n = 0;
+	do {
+		digits[n++] = (char)('0' + v % 10);
+		v /= 10;
+	} while (v);
+	while (n) {
+		*p++ = digits[--n];
+	}
+	return p;
+}
+
+/* Nanoseconds as microseconds with three decimals. */
+static char *put_micros(char *p, uint64_t ns) {
+	p = put_u64(p, ns / 1000);
+	const unsigned frac = (unsigned)(ns % 1000);
+	*p++ = '.';
+	*p++ = (char)('0' + frac / 100);
+	*p++ = (char)('0' + frac / 10 % 10);
+	*p++ = (char)('0' + frac % 10);
+	return p;
+}
+
+/* Drain every thread's ring into the trace. Call with LOCK held. */
+static void flush(void) {
+	for (ProfileThread *t = atomic_load(&THREADS); t; t = t->next) {
+		const char *name = atomic_load_explicit(&t->name, memory_order_acquire);
+		char line[LINE_MAX];
+		if (name && name != t->written_name) {
+			char *p = put_text(line, FIRST ? "\n" : ",\n");
+			p = put_text(p, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":");
+			p = put_u64(p, (uint64_t)t->tid);
+			p = put_text(p, ",\"args\":{\"name\":");
+			p = put_string(p, name);
+			p = put_text(p, "}}");
+			fwrite(line, 1, (size_t)(p - line), TRACE);
+			FIRST = false;
+			t->written_name = name;
+		}
+
+		Event e;
+		while (EGL_SpscRingPop(&t->ring, &e)) {
+			if (e.begin_ns < ORIGIN_NS) {
+				continue; // Started before this trace.
+			}
+			char *p = put_text(line, FIRST ? "\n{\"name\":" : ",\n{\"name\":");
+			p = put_string(p, e.name);
+			p = put_text(p, ",\"ph\":\"X\",\"pid\":1,\"tid\":");
+			p = put_u64(p, (uint64_t)t->tid);
+			p = put_text(p, ",\"ts\":");
+			p = put_micros(p, e.begin_ns - ORIGIN_NS);
+			p = put_text(p, ",\"dur\":");
+			p = put_micros(p, e.end_ns - e.begin_ns);
+			*p++ = '}';
+			fwrite(line, 1, (size_t)(p - line), TRACE);
+			FIRST = false;
+		}
+	}
+}
+
+
+uint64_t EGL_ProfileNow(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+void EGL_ProfileRecord(const char *name, uint64_t begin_ns, uint64_t end_ns) {
+	ProfileThread *t = current();
+	const Event e = { .name = name, .begin_ns = begin_ns, .end_ns = end_ns };
+	if (!t || !EGL_SpscRingPush(&t->ring, &e)) {
+		atomic_fetch_add_explicit(&DROPPED, 1, memory_order_relaxed);
+	}
+}
+
+void EGL_ProfileThreadName(const char *name) {
+	ProfileThread *t = current();
+	if (t) {
+		atomic_store_explicit(&t->name, name, memory_order_release);
+	}
+}
+
+uint64_t EGL_ProfileDropped(void) {
+	return atomic_load(&DROPPED);
+}
+
+bool EGL_ProfileStart(const char *path) {
+	call_once(&ONCE, init_lock);
+	mtx_lock(&LOCK);
+	if (TRACE) {
+		mtx_unlock(&LOCK);
+		return false;
+	}
+	TRACE = fopen(path, "w");
+	if (!TRACE) {
+		mtx_unlock(&LOCK);
+		return false;
+	}
+
+	fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", TRACE);
+	FIRST = true;
+	FRAME = 0;
+	ORIGIN_NS = EGL_ProfileNow();
+	for (ProfileThread *t = atomic_load(&THREADS); t; t = t->next) {
+		t->written_name = NULL;
+	}
+	atomic_store(&DROPPED, 0);
+	atomic_store(&EGL_PROFILE_ENABLED, true);
+	mtx_unlock(&LOCK);
+	return true;
+}
+
+void EGL_ProfileStop(void) {
+	call_once(&ONCE, init_lock);
+	mtx_lock(&LOCK);
+	if (TRACE) {
+		atomic_store(&EGL_PROFILE_ENABLED, false);
+		flush();
+		fputs("\n]}\n", TRACE);
+		fclose(TRACE);
+		TRACE = NULL;
+	}
+	mtx_unlock(&LOCK);
+}
+
+void EGL_ProfileFrame(void) {
+	if (!atomic_load_explicit(&EGL_PROFILE_ENABLED, memory_order_relaxed)) {
+		return;
+	}
+	const uint64_t now = EGL_ProfileNow();
+	mtx_lock(&LOCK);
+	if (TRACE) {
+		char line[LINE_MAX];
+		char *p = put_text(line, FIRST ? "\n" : ",\n");
+		p = put_text(p, "{\"name\":\"frame\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":0,\"ts\":");
+		p = put_micros(p, now - ORIGIN_NS);
+		p = put_text(p, ",\"args\":{\"frame\":");
+		p = put_u64(p, FRAME++);
+		p = put_text(p, "}}");
+		fwrite(line, 1, (size_t)(p - line), TRACE);
+		FIRST = false;
+		flush();
+	}
+	mtx_unlock(&LOCK);
+}
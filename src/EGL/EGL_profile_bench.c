@@ -0,0 +1,51 @@
+#define EGL_PROFILE // Compile the zone macros in.
+
+#include <EGL/EGL_bench.h>
+#include <EGL/EGL_profile.h>
+
+
+#define ZONES 1000000
+#define FRAME_ZONES 1000 // Zones between frames, well under a ring's capacity.
+#define TRACE_PATH "EGL_profile_bench.json"
+
+
+static uint32_t lcg(uint32_t *state) {
+	*state = *state * 1664525u + 1013904223u;
+	return *state >> 8;
+}
+
+
+void EGL_ProfileBench(void) {
+	EGL_DECLARE_BENCH(EGL_profile);
+
+	uint32_t state = 41;
+
+#define RUN(name, ...) do { \
+		double best = 1e30; \
+		for (int r = 0; r < EGL_BENCH_REPEATS; r++) { \
+			double begin = EGL_BenchNow(); \
+			for (int z = 0; z < ZONES; z++) { \
+				__VA_ARGS__; \
+				if (z % FRAME_ZONES == 0) { \
+					EGL_PROFILE_FRAME(); \
+				} \
+			} \
+			double elapsed = EGL_BenchNow() - begin; \
+			best = (elapsed < best) ? elapsed : best; \
+		} \
+		EGL_BenchReport(name, best, (double)ZONES, "zone"); \
+	} while (0)
+
+	/* The cost of a zone around almost no work, so the zone is all there is */
+	RUN("no zone", EGL_BENCH_SINK += lcg(&state));
+	RUN("zone, not tracing", EGL_PROFILE_SCOPE("zone") { EGL_BENCH_SINK += lcg(&state); });
+	if (EGL_ProfileStart(TRACE_PATH)) {
+		RUN("zone, tracing", EGL_PROFILE_SCOPE("zone") { EGL_BENCH_SINK += lcg(&state); });
+		EGL_ProfileStop();
+		remove(TRACE_PATH);
+	} else {
+		printf(" failed to open %s\n", TRACE_PATH);
+	}
+	RUN("clock read", EGL_BENCH_SINK += EGL_ProfileNow());
+#undef RUN
+}
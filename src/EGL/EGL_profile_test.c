@@ -0,0 +1,191 @@
+#define EGL_PROFILE // Compile the zone macros in.
+
+#include <EGL/EGL_testing.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+#define THREADS 4
+#define ROUNDS 300 // Outer zones per thread, each holding two inner zones.
+#define TRACE_PATH "EGL_profile_test.json"
+#define LINE_MAX 512
+
+
+typedef struct {
+	_Atomic int done;
+} Shared;
+
+typedef struct {
+	int outer, inner, named, frames, other;
+	int tids[THREADS + 2];
+	int misplaced; /**< Inner zones outside the outer zone that closed after them. */
+} Count;
+
+
+static int record(void *arg) {
+	Shared *s = (Shared *)arg;
+	EGL_ProfileThreadName("worker");
+	volatile uint64_t sink = 0;
+	for (int r = 0; r < ROUNDS; r++) {
+		EGL_PROFILE_SCOPE("outer") {
+			for (int k = 0; k < 2; k++) {
+				EGL_PROFILE_SCOPE("inner") {
+					for (int i = 0; i < 200; i++) {
+						sink += (uint64_t)i;
+					}
+				}
+			}
+		}
+		if (r % 16 == 0) {
+			thrd_yield();
+		}
+	}
+	atomic_fetch_add(&s->done, 1);
+	return 0;
+}
+
+/*
+ * Count the events in a trace written one per line. Events leave a thread in
+ * the order they close, so the inner zones of an outer zone come just before it.
+ */
+static bool count(const char *path, Count *c) {
+	memset(c, 0, sizeof(*c));
+	FILE *f = fopen(path, "r");
+	if (!f) {
+		return false;
+	}
+
+	char line[LINE_MAX];
+	double pending[THREADS + 2][2][2]; // [tid][inner][ts, dur]
+	int pending_count[THREADS + 2] = { 0 };
+	bool closed = false;
+	while (fgets(line, sizeof(line), f)) {
+		char name[64];
+		int tid;
+		double ts, dur;
+		if (strncmp(line, "]}", 2) == 0) {
+			closed = true;
+		} else if (strstr(line, "\"ph\":\"M\"")) {
+			c->named++;
+		} else if (strstr(line, "\"ph\":\"i\"")) {
+			c->frames++;
+		} else if (sscanf(line, "{\"name\":\"%63[^\"]\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%lf,\"dur\":%lf}", name, &tid, &ts, &dur) == 4
+			&& tid > 0 && tid < THREADS + 2) {
+			c->tids[tid]++;
+			if (strcmp(name, "inner") == 0 && pending_count[tid] < 2) {
+				pending[tid][pending_count[tid]][0] = ts;
+				pending[tid][pending_count[tid]++][1] = dur;
+				c->inner++;
+			} else if (strcmp(name, "outer") == 0) {
+				for (int k = 0; k < pending_count[tid]; k++) {
+					c->misplaced += (pending[tid][k][0] < ts || pending[tid][k][0] + pending[tid][k][1] > ts + dur + 0.001);
+				}
+				c->misplaced += (pending_count[tid] != 2);
+				pending_count[tid] = 0;
+				c->outer++;
+			} else {
+				c->other++;
+			}
+		} else if (line[0] == '{' && strstr(line, "\"ph\"")) {
+			c->other++;
+		}
+	}
+	fclose(f);
+	return closed;
+}
+
+
+/**
+ * Zones from several threads, flushed by frames while they run, all reach
+ * the trace nested as they were recorded.
+ */
+static void EGL_ProfileThreadsTest(EGL_Test *T) {
+	EGL_DECLARE_TEST;
+
+	if (!EGL_ProfileStart(TRACE_PATH)) {
+		EGL_DECLARE_ERROR("Failed to open %s.", TRACE_PATH);
+		return;
+	}
+	if (EGL_ProfileStart(TRACE_PATH)) {
+		EGL_DECLARE_ERROR("Started a second trace at %s while one was open.", TRACE_PATH);
+	}
+
+	Shared s;
+	atomic_init(&s.done, 0);
+	thrd_t threads[THREADS];
+	int started = 0;
+	for (int t = 0; t < THREADS; t++) {
+		started += (thrd_create(&threads[started], record, &s) == thrd_success);
+	}
+	int frames = 0;
+	while (atomic_load(&s.done) < started) {
+		EGL_PROFILE_FRAME();
+		frames++;
+		thrd_yield();
+	}
+	for (int t = 0; t < started; t++) {
+		thrd_join(threads[t], NULL);
+	}
+	EGL_ProfileStop();
+
+	Count c;
+	if (!count(TRACE_PATH, &c)) {
+		EGL_DECLARE_ERROR("The trace at %s was missing or not closed.", TRACE_PATH);
+	}
+	if (c.outer != started * ROUNDS || c.inner != 2 * started * ROUNDS || c.other != 0 || c.misplaced != 0) {
+		EGL_DECLARE_ERROR("Expected %d outer and %d inner zones, got %d and %d with %d misplaced and %d unknown.",
+			started * ROUNDS, 2 * started * ROUNDS, c.outer, c.inner, c.misplaced, c.other);
+	}
+	if (c.named != started || c.frames != frames) {
+		EGL_DECLARE_ERROR("Expected %d thread names and %d frames, got %d and %d.", started, frames, c.named, c.frames);
+	}
+	if (EGL_ProfileDropped() != 0) {
+		EGL_DECLARE_ERROR("Dropped %llu events with frames flushing.", (unsigned long long)EGL_ProfileDropped());
+	}
+	remove(TRACE_PATH);
+}
+
+/**
+ * Zones outside a trace record nothing, and a thread that records more than
+ * its ring holds between flushes loses only the excess.
+ */
+static void EGL_ProfileLimitsTest(EGL_Test *T) {
+	EGL_DECLARE_TEST;
+
+	for (int i = 0; i < 1000; i++) {
+		EGL_PROFILE_SCOPE("untraced") {
+		}
+	}
+	if (!EGL_ProfileStart(TRACE_PATH)) {
+		EGL_DECLARE_ERROR("Failed to open %s.", TRACE_PATH);
+		return;
+	}
+	EGL_PROFILE_BEGIN(late, "late");
+	const int extra = 10;
+	for (int i = 0; i < EGL_PROFILE_EVENTS - 1 + extra; i++) {
+		EGL_PROFILE_SCOPE("filler") {
+		}
+	}
+	EGL_PROFILE_END(late);
+	const uint64_t dropped = EGL_ProfileDropped();
+	EGL_ProfileStop();
+
+	Count c;
+	count(TRACE_PATH, &c);
+	int total = 0;
+	for (int t = 0; t < THREADS + 2; t++) {
+		total += c.tids[t];
+	}
+	if (dropped != (uint64_t)extra || total != EGL_PROFILE_EVENTS) {
+		EGL_DECLARE_ERROR("Expected %d zones and %d dropped, got %d and %llu.", EGL_PROFILE_EVENTS, extra, total, (unsigned long long)dropped);
+	}
+	remove(TRACE_PATH);
+}
+
+
+void EGL_ProfileTest(EGL_TestModule *M) {
+	EGL_DECLARE_MODULE(EGL_profile);
+
+	EGL_RUN_TEST(EGL_ProfileThreadsTest);
+	EGL_RUN_TEST(EGL_ProfileLimitsTest);
+}
@@ -0,0 +1,292 @@
+#include <EGL/EGL_bench.h>
+#include <EGL/EGL_queue.h>
+
+#include <stdlib.h>
+#include <threads.h>
+
+
+#define ITEMS 1000000 // Items pushed per run, split across producers.
+#define ROUND_TRIPS 20000
+#define CAPACITY 1024
+#define THREADS_MAX 8
+
+
+/* The baseline: a ring behind a mutex. */
+typedef struct {
+	mtx_t lock;
+	uint64_t *slots;
+	size_t head, tail, mask;
+} Locked;
+
+typedef enum {
+	KIND_MPMC,
+	KIND_LOCKED,
+} Kind;
+
+typedef struct {
+	Kind kind;
+	EGL_MpmcQueue *queue;
+	Locked *locked;
+	_Atomic uint64_t consumed;
+	_Atomic uint64_t sum;
+	uint64_t total;
+	uint64_t count; /**< Items per producer. */
+} Run;
+
+typedef struct {
+	EGL_SpscRing *ping, *pong;
+} PingPong;
+
+typedef struct {
+	_Alignas(EGL_CACHE_LINE) _Atomic int64_t single;
+	EGL_ShardedCounter sharded;
+	int adds; /**< Adds per thread. */
+} Count;
+
+
+static bool locked_push(Locked *l, uint64_t value) {
+	mtx_lock(&l->lock);
+	const bool ok = l->tail - l->head <= l->mask;
+	if (ok) {
+		l->slots[l->tail++ & l->mask] = value;
+	}
+	mtx_unlock(&l->lock);
+	return ok;
+}
+
+static bool locked_pop(Locked *l, uint64_t *value) {
+	mtx_lock(&l->lock);
+	const bool ok = l->head != l->tail;
+	if (ok) {
+		*value = l->slots[l->head++ & l->mask];
+	}
+	mtx_unlock(&l->lock);
+	return ok;
+}
+
+static int produce(void *arg) {
+	Run *r = (Run *)arg;
+	for (uint64_t i = 1; i <= r->count; i++) {
+		while (!((r->kind == KIND_MPMC) ? EGL_MpmcQueuePush(r->queue, &i) : locked_push(r->locked, i))) {
+			thrd_yield();
+		}
+	}
+	return 0;
+}
+
+static int consume(void *arg) {
+	Run *r = (Run *)arg;
+	uint64_t sum = 0;
+	while (atomic_load_explicit(&r->consumed, memory_order_relaxed) < r->total) {
+		uint64_t value;
+		if (!((r->kind == KIND_MPMC) ? EGL_MpmcQueuePop(r->queue, &value) : locked_pop(r->locked, &value))) {
+			thrd_yield();
+			continue;
+		}
+		sum += value;
+		atomic_fetch_add_explicit(&r->consumed, 1, memory_order_relaxed);
+	}
+	atomic_fetch_add(&r->sum, sum);
+	return 0;
+}
+
+/* Push ITEMS through the queue from several producers to several consumers. */
+static double run(Kind kind, EGL_MpmcQueue *queue, Locked *locked, int producers, int consumers) {
+	Run r = { .kind = kind, .queue = queue, .locked = locked, .count = ITEMS / producers };
+	r.total = r.count * producers;
+	atomic_init(&r.consumed, 0);
+	atomic_init(&r.sum, 0);
+	thrd_t threads[THREADS_MAX];
+	int started = 0;
+
+	double begin = EGL_BenchNow();
+	for (int p = 0; p < producers; p++) {
+		started += (thrd_create(&threads[started], produce, &r) == thrd_success);
+	}
+	for (int c = 0; c < consumers; c++) {
+		started += (thrd_create(&threads[started], consume, &r) == thrd_success);
+	}
+	if (started != producers + consumers) {
+		abort(); // The started threads would wait forever on the missing ones.
+	}
+	for (int t = 0; t < started; t++) {
+		thrd_join(threads[t], NULL);
+	}
+	double elapsed = EGL_BenchNow() - begin;
+
+	EGL_BENCH_SINK += atomic_load(&r.sum);
+	return elapsed;
+}
+
+static int spsc_produce(void *arg) {
+	EGL_SpscRing *ring = (EGL_SpscRing *)arg;
+	for (uint64_t i = 1; i <= ITEMS; i++) {
+		while (!EGL_SpscRingPush(ring, &i)) {
+			thrd_yield();
+		}
+	}
+	return 0;
+}
+
+/* Bounce one item back and forth, so each trip is two handoffs. */
+static int echo(void *arg) {
+	PingPong *p = (PingPong *)arg;
+	for (int i = 0; i < ROUND_TRIPS; i++) {
+		uint64_t value;
+		while (!EGL_SpscRingPop(p->ping, &value)) {
+			thrd_yield();
+		}
+		while (!EGL_SpscRingPush(p->pong, &value)) {
+			thrd_yield();
+		}
+	}
+	return 0;
+}
+
+static double run_spsc(EGL_SpscRing *ring) {
+	double begin = EGL_BenchNow();
+	thrd_t producer;
+	if (thrd_create(&producer, spsc_produce, ring) != thrd_success) {
+		abort();
+	}
+	uint64_t sum = 0;
+	for (uint64_t n = 0; n < ITEMS;) {
+		uint64_t value;
+		if (!EGL_SpscRingPop(ring, &value)) {
+			thrd_yield();
+			continue;
+		}
+		sum += value;
+		n++;
+	}
+	thrd_join(producer, NULL);
+	EGL_BENCH_SINK += sum;
+	return EGL_BenchNow() - begin;
+}
+
+static double run_round_trips(PingPong *p) {
+	double begin = EGL_BenchNow();
+	thrd_t other;
+	if (thrd_create(&other, echo, p) != thrd_success) {
+		abort();
+	}
+	for (uint64_t i = 0; i < ROUND_TRIPS; i++) {
+		uint64_t value = i;
+		while (!EGL_SpscRingPush(p->ping, &value)) {
+			thrd_yield();
+		}
+		while (!EGL_SpscRingPop(p->pong, &value)) {
+			thrd_yield();
+		}
+		EGL_BENCH_SINK += value;
+	}
+	thrd_join(other, NULL);
+	return EGL_BenchNow() - begin;
+}
+
+static int count_single(void *arg) {
+	Count *c = (Count *)arg;
+	for (int i = 0; i < c->adds; i++) {
+		atomic_fetch_add_explicit(&c->single, 1, memory_order_relaxed);
+	}
+	return 0;
+}
+
+static int count_sharded(void *arg) {
+	Count *c = (Count *)arg;
+	for (int i = 0; i < c->adds; i++) {
+		EGL_ShardedCounterAdd(&c->sharded, 1);
+	}
+	return 0;
+}
+
+/* Split ITEMS adds across threads hammering one counter. */
+static double run_count(bool sharded, int count) {
+	static Count c;
+	atomic_init(&c.single, 0);
+	EGL_ShardedCounterInit(&c.sharded);
+	c.adds = ITEMS / count;
+	thrd_t threads[THREADS_MAX];
+	int started = 0;
+
+	double begin = EGL_BenchNow();
+	for (int t = 0; t < count; t++) {
+		started += (thrd_create(&threads[started], sharded ? count_sharded : count_single, &c) == thrd_success);
+	}
+	for (int t = 0; t < started; t++) {
+		thrd_join(threads[t], NULL);
+	}
+	double elapsed = EGL_BenchNow() - begin;
+
+	EGL_BENCH_SINK += (uint64_t)(atomic_load(&c.single) + EGL_ShardedCounterSum(&c.sharded));
+	return elapsed;
+}
+
+
+void EGL_QueueBench(void) {
+	EGL_DECLARE_BENCH(EGL_queue);
+
+	EGL_SpscRing ring = { 0 }, ping = { 0 }, pong = { 0 };
+	EGL_MpmcQueue queue = { 0 };
+	Locked locked = { .mask = CAPACITY - 1 };
+	locked.slots = (uint64_t *)malloc(sizeof(uint64_t) * CAPACITY);
+	if (!locked.slots || mtx_init(&locked.lock, mtx_plain) != thrd_success) {
+		printf(" %d items: failed to allocate\n", CAPACITY);
+		free(locked.slots);
+		return;
+	}
+	if (!EGL_SpscRingInit(&ring, CAPACITY, sizeof(uint64_t)) || !EGL_MpmcQueueInit(&queue, CAPACITY, sizeof(uint64_t))
+		|| !EGL_SpscRingInit(&ping, 2, sizeof(uint64_t)) || !EGL_SpscRingInit(&pong, 2, sizeof(uint64_t))) {
+		printf(" %d items: failed to allocate\n", CAPACITY);
+		EGL_SpscRingFree(&ring);
+		EGL_SpscRingFree(&ping);
+		EGL_SpscRingFree(&pong);
+		EGL_MpmcQueueFree(&queue);
+		mtx_destroy(&locked.lock);
+		free(locked.slots);
+		return;
+	}
+	char label[64];
+
+#define RUN(name, size, unit, ...) do { \
+		double best = 1e30; \
+		for (int r = 0; r < EGL_BENCH_REPEATS; r++) { \
+			double elapsed = __VA_ARGS__; \
+			best = (elapsed < best) ? elapsed : best; \
+		} \
+		EGL_BenchReport(name, best, (double)(size), unit); \
+	} while (0)
+
+	/* Throughput, one producer to one consumer */
+	RUN("spsc 1:1", ITEMS, "item", run_spsc(&ring));
+
+	/* Throughput across producer and consumer counts */
+	static const int shapes[][2] = { { 1, 1 }, { 2, 2 }, { 4, 4 }, { 1, 4 }, { 4, 1 } };
+	for (size_t s = 0; s < sizeof(shapes) / sizeof(shapes[0]); s++) {
+		const int producers = shapes[s][0], consumers = shapes[s][1];
+		snprintf(label, sizeof(label), "mpmc %d:%d", producers, consumers);
+		RUN(label, ITEMS, "item", run(KIND_MPMC, &queue, NULL, producers, consumers));
+		snprintf(label, sizeof(label), "mutex %d:%d", producers, consumers);
+		RUN(label, ITEMS, "item", run(KIND_LOCKED, NULL, &locked, producers, consumers));
+	}
+
+	/* Latency: a round trip is two handoffs between threads */
+	PingPong p = { .ping = &ping, .pong = &pong };
+	RUN("spsc round trip", ROUND_TRIPS, "trip", run_round_trips(&p));
+
+	/* Contended counting: every thread on one cache line, or each on its own */
+	for (int threads = 1; threads <= THREADS_MAX; threads *= 2) {
+		snprintf(label, sizeof(label), "single counter, %d threads", threads);
+		RUN(label, ITEMS, "add", run_count(false, threads));
+		snprintf(label, sizeof(label), "sharded counter, %d threads", threads);
+		RUN(label, ITEMS, "add", run_count(true, threads));
+	}
+#undef RUN
+
+	EGL_SpscRingFree(&ring);
+	EGL_SpscRingFree(&ping);
+	EGL_SpscRingFree(&pong);
+	EGL_MpmcQueueFree(&queue);
+	mtx_destroy(&locked.lock);
+	free(locked.slots);
+}
@@ -0,0 +1,255 @@
+#include <EGL/EGL_testing.h>
+#include <stdlib.h>
+
+
+#define ITEMS 200000 // Items each producer pushes.
+#define PRODUCERS 4
+#define CONSUMERS 4
+#define CAPACITY 64  // Small, so the indices wrap thousands of times.
+
+
+typedef struct {
+	uint64_t value;
+	uint64_t triple; /**< 3 * value, so a torn copy is caught. */
+	uint64_t inverse;  /**< ~value */
+} Item;
+
+typedef struct {
+	EGL_SpscRing *ring;
+} Spsc;
+
+typedef struct {
+	EGL_MpmcQueue *queue;
+	_Atomic uint8_t *seen;     /**< [PRODUCERS * ITEMS] */
+	_Atomic uint64_t consumed;
+	_Atomic uint32_t errors;
+	int index;
+} Mpmc;
+
+typedef struct {
+	EGL_ShardedCounter *counter;
+} Count;
+
+
+static Item make_item(uint64_t value) {
+	return (Item){ .value = value, .triple = 3 * value, .inverse = ~value };
+}
+
+static bool whole(const Item *item) {
+	return item->triple == 3 * item->value && item->inverse == ~item->value;
+}
+
+static int spsc_produce(void *arg) {
+	Spsc *s = (Spsc *)arg;
+	for (uint64_t i = 0; i < ITEMS; i++) {
+		const Item item = make_item(i);
+		while (!EGL_SpscRingPush(s->ring, &item)) {
+			thrd_yield();
+		}
+	}
+	return 0;
+}
+
+static int mpmc_produce(void *arg) {
+	Mpmc *m = (Mpmc *)arg;
+	for (uint64_t i = 0; i < ITEMS; i++) {
+		const Item item = make_item((uint64_t)m->index * ITEMS + i);
+		while (!EGL_MpmcQueuePush(m->queue, &item)) {
+			thrd_yield();
+		}
+	}
+	return 0;
+}
+
+/* Items from one producer must come out in the order it pushed them. */
+static int mpmc_consume(void *arg) {
+	Mpmc *m = (Mpmc *)arg;
+	uint64_t last[PRODUCERS];
+	for (int p = 0; p < PRODUCERS; p++) {
+		last[p] = UINT64_MAX;
+	}
+	while (atomic_load(&m->consumed) < (uint64_t)PRODUCERS * ITEMS) {
+		Item item;
+		if (!EGL_MpmcQueuePop(m->queue, &item)) {
+			thrd_yield();
+			continue;
+		}
+		atomic_fetch_add(&m->consumed, 1);
+		const uint64_t producer = item.value / ITEMS;
+		if (!whole(&item) || producer >= PRODUCERS || (last[producer] != UINT64_MAX && item.value <= last[producer])
+			|| atomic_exchange(&m->seen[item.value], 1) != 0) {
+			atomic_fetch_add(&m->errors, 1);
+			continue;
+		}
+		last[producer] = item.value;
+	}
+	return 0;
+}
+
+static int count_up(void *arg) {
+	Count *c = (Count *)arg;
+	for (int i = 0; i < ITEMS; i++) {
+		EGL_ShardedCounterAdd(c->counter, (i & 1) ? 3 : -1);
+	}
+	return 0;
+}
+
+
+/**
+ * Single-threaded, the queues hold exactly their capacity, refuse more, and
+ * give elements back in order until they are empty.
+ */
+static void EGL_QueueBoundsTest(EGL_Test *T) {
+	EGL_DECLARE_TEST;
+
+	EGL_SpscRing ring;
+	EGL_MpmcQueue queue;
+	if (!EGL_SpscRingInit(&ring, 50, sizeof(Item)) || !EGL_MpmcQueueInit(&queue, 50, sizeof(Item))) {
+		EGL_DECLARE_ERROR("Failed to allocate queues of %zu-byte items.", sizeof(Item));
+		return;
+	}
+
+	for (int lap = 0; lap < 3; lap++) {
+		uint64_t pushed = 0;
+		for (Item item = make_item(0); EGL_SpscRingPush(&ring, &item) && EGL_MpmcQueuePush(&queue, &item); item = make_item(++pushed)) {
+		}
+		if (pushed != 64 || EGL_SpscRingCount(&ring) != 64) {
+			EGL_DECLARE_ERROR("Lap %d: a capacity of 50 held %llu items, not 64.", lap, (unsigned long long)pushed);
+		}
+		for (uint64_t i = 0; i < 64; i++) {
+			Item a, b;
+			if (!EGL_SpscRingPop(&ring, &a) || !EGL_MpmcQueuePop(&queue, &b) || a.value != i || b.value != i || !whole(&a) || !whole(&b)) {
+				EGL_DECLARE_ERROR("Lap %d: item %llu came out wrong.", lap, (unsigned long long)i);
+				break;
+			}
+		}
+		Item item;
+		if (EGL_SpscRingPop(&ring, &item) || EGL_MpmcQueuePop(&queue, &item)) {
+			EGL_DECLARE_ERROR("Lap %d: an empty queue gave item %llu.", lap, (unsigned long long)item.value);
+		}
+	}
+
+	EGL_SpscRingFree(&ring);
+	EGL_MpmcQueueFree(&queue);
+}
+
+/**
+ * One producer and one consumer racing through a small ring: every item
+ * arrives whole, once, and in order.
+ */
+static void EGL_QueueSpscTest(EGL_Test *T) {
+	EGL_DECLARE_TEST;
+
+	EGL_SpscRing ring;
+	if (!EGL_SpscRingInit(&ring, CAPACITY, sizeof(Item))) {
+		EGL_DECLARE_ERROR("Failed to allocate a ring of %d items.", CAPACITY);
+		return;
+	}
+	Spsc s = { .ring = &ring };
+	thrd_t producer;
+	if (thrd_create(&producer, spsc_produce, &s) != thrd_success) {
+		EGL_DECLARE_ERROR("Failed to start the producer of %d items.", ITEMS);
+		EGL_SpscRingFree(&ring);
+		return;
+	}
+
+	for (uint64_t expected = 0; expected < ITEMS;) {
+		Item item;
+		if (!EGL_SpscRingPop(&ring, &item)) {
+			thrd_yield();
+			continue;
+		}
+		if (item.value != expected || !whole(&item)) {
+			EGL_DECLARE_ERROR("Expected item %llu, got %llu.", (unsigned long long)expected, (unsigned long long)item.value);
+			break;
+		}
+		expected++;
+	}
+	thrd_join(producer, NULL);
+	EGL_SpscRingFree(&ring);
+}
+
+/**
+ * Several producers and consumers racing through a small queue: every item
+ * is consumed whole and exactly once, and each consumer sees each producer's
+ * items in order.
+ */
+static void EGL_QueueMpmcTest(EGL_Test *T) {
+	EGL_DECLARE_TEST;
+
+	EGL_MpmcQueue queue;
+	_Atomic uint8_t *seen = (_Atomic uint8_t *)calloc((size_t)PRODUCERS * ITEMS, sizeof(*seen));
+	if (!seen || !EGL_MpmcQueueInit(&queue, CAPACITY, sizeof(Item))) {
+		EGL_DECLARE_ERROR("Failed to allocate a queue of %d items.", CAPACITY);
+		free(seen);
+		return;
+	}
+
+	Mpmc shared = { .queue = &queue, .seen = seen };
+	atomic_init(&shared.consumed, 0);
+	atomic_init(&shared.errors, 0);
+	Mpmc producers[PRODUCERS];
+	thrd_t threads[PRODUCERS + CONSUMERS];
+	int started = 0;
+	for (int p = 0; p < PRODUCERS; p++) {
+		producers[p] = (Mpmc){ .queue = &queue, .index = p };
+		started += (thrd_create(&threads[started], mpmc_produce, &producers[p]) == thrd_success);
+	}
+	for (int c = 0; c < CONSUMERS; c++) {
+		started += (thrd_create(&threads[started], mpmc_consume, &shared) == thrd_success);
+	}
+	if (started != PRODUCERS + CONSUMERS) {
+		EGL_DECLARE_ERROR("Only %d of %d threads started.", started, PRODUCERS + CONSUMERS);
+		abort(); // The started threads would wait forever on the missing ones.
+	}
+	for (int t = 0; t < started; t++) {
+		thrd_join(threads[t], NULL);
+	}
+
+	size_t missing = 0;
+	for (size_t i = 0; i < (size_t)PRODUCERS * ITEMS; i++) {
+		missing += (atomic_load(&seen[i]) == 0);
+	}
+	if (missing > 0 || atomic_load(&shared.errors) > 0) {
+		EGL_DECLARE_ERROR("%zu items never arrived and %u arrived torn, twice or out of order.", missing, atomic_load(&shared.errors));
+	}
+
+	EGL_MpmcQueueFree(&queue);
+	free(seen);
+}
+
+/**
+ * More threads than shards adding at once lose no counts.
+ */
+static void EGL_QueueCounterTest(EGL_Test *T) {
+	EGL_DECLARE_TEST;
+
+	EGL_ShardedCounter counter;
+	EGL_ShardedCounterInit(&counter);
+	Count c = { .counter = &counter };
+
+	const int count = EGL_COUNTER_SHARDS + 4;
+	thrd_t threads[EGL_COUNTER_SHARDS + 4];
+	int started = 0;
+	for (int t = 0; t < count; t++) {
+		started += (thrd_create(&threads[started], count_up, &c) == thrd_success);
+	}
+	for (int t = 0; t < started; t++) {
+		thrd_join(threads[t], NULL);
+	}
+
+	const int64_t expected = (int64_t)started * (ITEMS / 2) * 2;
+	if (EGL_ShardedCounterSum(&counter) != expected) {
+		EGL_DECLARE_ERROR("%d threads counted %lld, not %lld.", started, (long long)EGL_ShardedCounterSum(&counter), (long long)expected);
+	}
+}
+
+
+void EGL_QueueTest(EGL_TestModule *M) {
+	EGL_DECLARE_MODULE(EGL_queue);
+
+	EGL_RUN_TEST(EGL_QueueBoundsTest);
+	EGL_RUN_TEST(EGL_QueueSpscTest);
+	EGL_RUN_TEST(EGL_QueueMpmcTest);
+	EGL_RUN_TEST(EGL_QueueCounterTest);
+}
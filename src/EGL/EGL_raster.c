@@ -0,0 +1,426 @@
+#include <EGL/EGL_raster.h>
+#include <EGL/EGL_parallel.h>
+#include <EGL/EGL_memory.h>
+
+#include <math.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+
+#define SUBPIXEL 16.0f // Vertices snap to 1/SUBPIXEL of a pixel.
+#define GUARD 2.0f     // Triangles are clipped to GUARD times the view on each axis,
+#define NEAR_W 1e-5f   // and to w >= NEAR_W, in front of the eye.
+#define PLANES 5
+#define CLIPPED_MAX (3 + PLANES) // Corners of a triangle clipped by every plane.
+#define VARYINGS 6
+
+
+typedef struct {
+	float clip[4];
+	float varyings[VARYINGS];
+} ClipVertex;
+
+typedef struct {
+	EGL_Raster *r;
+	atomic_uint next; // The next tile to draw.
+} TileJob;
+
+
+static float plane_distance(const ClipVertex *v, int plane) {
+	const float x = v->clip[0], y = v->clip[1], w = v->clip[3];
+	switch (plane) {
+	case 0: return w - NEAR_W;
+	case 1: return GUARD * w - x;
+	case 2: return GUARD * w + x;
+	case 3: return GUARD * w - y;
+	default: return GUARD * w + y;
+	}
+}
+
+/* Bit p is set if the vertex is outside plane p */
+static uint32_t outcode(const ClipVertex *v) {
+	uint32_t code = 0;
+	for (int p = 0; p < PLANES; p++) {
+		code |= (uint32_t)(plane_distance(v, p) < 0.0f) << p;
+	}
+	return code;
+}
+
+/* Sutherland-Hodgman against every plane; returns the corners left in poly */
+static uint32_t clip_polygon(ClipVertex poly[CLIPPED_MAX], uint32_t n) {
+	ClipVertex tmp[CLIPPED_MAX];
+	for (int p = 0; p < PLANES && n >= 3; p++) {
+		uint32_t out = 0;
+		for (uint32_t i = 0; i < n; i++) {
+			const ClipVertex *a = &poly[i], *b = &poly[(i + 1) % n];
+			const float da = plane_distance(a, p), db = plane_distance(b, p);
+			if (da >= 0.0f) {
+				tmp[out++] = *a;
+			}
+			if ((da >= 0.0f) != (db >= 0.0f)) {
+				/* Always from the inside corner, so an edge two triangles share is cut at the same point */
+				const ClipVertex *in = (da >= 0.0f) ? a : b, *outside = (da >= 0.0f) ? b : a;
+				const float d_in = (da >= 0.0f) ? da : db, d_out = (da >= 0.0f) ? db : da;
+				const float t = d_in / (d_in - d_out);
+				ClipVertex *v = &tmp[out++];
+				for (int c = 0; c < 4; c++) {
+					v->clip[c] = in->clip[c] + t * (outside->clip[c] - in->clip[c]);
+				}
+				for (int c = 0; c < VARYINGS; c++) {
+					v->varyings[c] = in->varyings[c] + t * (outside->varyings[c] - in->varyings[c]);
+				}
+			}
+		}
+		memcpy(poly, tmp, out * sizeof(ClipVertex));
+		n = out;
+	}
+	return (n >= 3) ? n : 0;
+}
+
+/* Project, snap and set up one triangle; false if it is degenerate or off the target */
+static bool setup(const EGL_Raster *r, const ClipVertex *v[3], const EGL_Image *texture, EGL_RasterTriangle *t) {
+	const float width = (float)r->target.width, height = (float)r->target.height;
+	float x[3], y[3];
+	for (int k = 0; k < 3; k++) {
+		const float inverse_w = 1.0f / v[k]->clip[3];
+		const float sx = (v[k]->clip[0] * inverse_w * 0.5f + 0.5f) * width;
+		const float sy = (0.5f - v[k]->clip[1] * inverse_w * 0.5f) * height;
+		x[k] = floorf(sx * SUBPIXEL + 0.5f) / SUBPIXEL;
+		y[k] = floorf(sy * SUBPIXEL + 0.5f) / SUBPIXEL;
+		t->z[k] = v[k]->clip[2] * inverse_w;
+		t->inverse_w[k] = inverse_w;
+		for (int c = 0; c < VARYINGS; c++) {
+			t->varyings[k][c] = v[k]->varyings[c] * inverse_w;
+		}
+	}
+
+	/* Snapped coordinates are exact in floats, and so is this */
+	const double area = ((double)x[1] - x[0]) * ((double)y[2] - y[0]) - ((double)x[2] - x[0]) * ((double)y[1] - y[0]);
+	if (area == 0.0) {
+		return false;
+	}
+	t->inverse_area = (float)(1.0 / fabs(area));
+
+	t->top_left = 0;
+	for (int k = 0; k < 3; k++) {
+		int a = (k + 1) % 3, b = (k + 2) % 3;
+		if (y[b] < y[a] || (y[b] == y[a] && x[b] < x[a])) {
+			const int swap = a;
+			a = b;
+			b = swap;
+		}
+		t->edge_x[k] = x[a];
+		t->edge_y[k] = y[a];
+		t->edge_dx[k] = x[b] - x[a];
+		t->edge_dy[k] = y[b] - y[a];
+		const float at_vertex = (x[k] - x[a]) * t->edge_dy[k] - (y[k] - y[a]) * t->edge_dx[k];
+		t->edge_sign[k] = (at_vertex > 0.0f) ? 1.0f : -1.0f;
+
+		/* The inward normal; pixels on the edge are inside if it points right, or straight down */
+		const float nx = t->edge_sign[k] * t->edge_dy[k], ny = -t->edge_sign[k] * t->edge_dx[k];
+		if (nx > 0.0f || (nx == 0.0f && ny > 0.0f)) {
+			t->top_left |= 1u << k;
+		}
+	}
+
+	const float min_x = fminf(fminf(x[0], x[1]), x[2]), max_x = fmaxf(fmaxf(x[0], x[1]), x[2]);
+	const float min_y = fminf(fminf(y[0], y[1]), y[2]), max_y = fmaxf(fmaxf(y[0], y[1]), y[2]);
+	t->x0 = (int32_t)fmaxf(floorf(min_x), 0.0f);
+	t->y0 = (int32_t)fmaxf(floorf(min_y), 0.0f);
+	t->x1 = (int32_t)fminf(ceilf(max_x), width);
+	t->y1 = (int32_t)fminf(ceilf(max_y), height);
+	t->texture = texture;
+	return t->x0 < t->x1 && t->y0 < t->y1;
+}
+
+static bool emit(EGL_Raster *r, const ClipVertex *v[3], const EGL_Image *texture) {
+	if (r->triangle_count == r->triangles_max) {
+		r->dropped++;
+		return false;
+	}
+	if (setup(r, v, texture, &r->triangles[r->triangle_count])) {
+		r->triangle_count++;
+	}
+	return true;
+}
+
+
+/* Bilinear, with repeat, as the game's default sampler */
+static void sample(const EGL_Image *texture, float u, float v, float out[4]) {
+	if (!isfinite(u) || !isfinite(v)) {
+		u = v = 0.0f;
+	}
+	const uint32_t w = texture->width, h = texture->height;
+	const float x = (u - floorf(u)) * (float)w - 0.5f, y = (v - floorf(v)) * (float)h - 0.5f;
+	const float fx0 = floorf(x), fy0 = floorf(y);
+	const float fx = x - fx0, fy = y - fy0;
+	const uint32_t x0 = (fx0 < 0.0f) ? w - 1 : (uint32_t)fx0 % w, y0 = (fy0 < 0.0f) ? h - 1 : (uint32_t)fy0 % h;
+	const uint32_t x1 = (x0 + 1 == w) ? 0 : x0 + 1, y1 = (y0 + 1 == h) ? 0 : y0 + 1;
+
+	const uint8_t *p = texture->pixels;
+	const uint8_t *t00 = p + ((size_t)y0 * w + x0) * 4, *t10 = p + ((size_t)y0 * w + x1) * 4;
+	const uint8_t *t01 = p + ((size_t)y1 * w + x0) * 4, *t11 = p + ((size_t)y1 * w + x1) * 4;
+	for (int c = 0; c < 4; c++) {
+		const float top = (float)t00[c] + fx * ((float)t10[c] - (float)t00[c]);
+		const float bottom = (float)t01[c] + fx * ((float)t11[c] - (float)t01[c]);
+		out[c] = (top + fy * (bottom - top)) * (1.0f / 255.0f);
+	}
+}
+
+/* Perspective-correct varyings, times the texture, into one pixel */
+static void shade(const EGL_RasterTriangle *t, float l0, float l1, float l2, uint8_t *pixel) {
+	const float w = 1.0f / (l0 * t->inverse_w[0] + l1 * t->inverse_w[1] + l2 * t->inverse_w[2]);
+	float v[VARYINGS];
+	for (int c = 0; c < VARYINGS; c++) {
+		v[c] = (l0 * t->varyings[0][c] + l1 * t->varyings[1][c] + l2 * t->varyings[2][c]) * w;
+	}
+	float texel[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	if (t->texture) {
+		sample(t->texture, v[4], v[5], texel);
+	}
+	for (int c = 0; c < 4; c++) {
+		const float value = v[c] * texel[c];
+		pixel[c] = (uint8_t)(((value < 0.0f) ? 0.0f : (value > 1.0f) ? 1.0f : value) * 255.0f + 0.5f);
+	}
+}
+
+/* One pixel, with the same arithmetic as the four-wide path */
+static void draw_pixel(EGL_Raster *r, const EGL_RasterTriangle *t, int32_t x, int32_t y) {
+	const float px = (float)x + 0.5f, py = (float)y + 0.5f;
+	float e[3];
+	for (int k = 0; k < 3; k++) {
+		e[k] = ((px - t->edge_x[k]) * t->edge_dy[k] - (py - t->edge_y[k]) * t->edge_dx[k]) * t->edge_sign[k];
+		if (!(e[k] > 0.0f || (e[k] == 0.0f && (t->top_left >> k & 1)))) {
+			return;
+		}
+	}
+	const float l0 = e[0] * t->inverse_area, l1 = e[1] * t->inverse_area, l2 = e[2] * t->inverse_area;
+	const float z = l0 * t->z[0] + l1 * t->z[1] + l2 * t->z[2];
+	const size_t i = (size_t)y * r->target.width + (size_t)x;
+	if (z < r->depth[i]) {
+		r->depth[i] = z;
+		shade(t, l0, l1, l2, r->target.pixels + i * 4);
+	}
+}
+
+static void draw_rows(EGL_Raster *r, const EGL_RasterTriangle *t, int32_t x0, int32_t y0, int32_t x1, int32_t y1) {
+#ifdef __SSE2__
+	const size_t width = r->target.width;
+	const __m128 inverse_area = _mm_set1_ps(t->inverse_area);
+	const __m128 offsets = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+	__m128 ex[3], ey[3], dx[3], dy[3], sign[3], tl[3];
+	for (int k = 0; k < 3; k++) {
+		ex[k] = _mm_set1_ps(t->edge_x[k]);
+		ey[k] = _mm_set1_ps(t->edge_y[k]);
+		dx[k] = _mm_set1_ps(t->edge_dx[k]);
+		dy[k] = _mm_set1_ps(t->edge_dy[k]);
+		sign[k] = _mm_set1_ps(t->edge_sign[k]);
+		tl[k] = _mm_castsi128_ps(_mm_set1_epi32((t->top_left >> k & 1) ? -1 : 0));
+	}
+	const __m128 z0 = _mm_set1_ps(t->z[0]), z1 = _mm_set1_ps(t->z[1]), z2 = _mm_set1_ps(t->z[2]);
+	const __m128 zero = _mm_setzero_ps();
+#endif
+
+	for (int32_t y = y0; y < y1; y++) {
+		int32_t x = x0;
+#ifdef __SSE2__
+		const __m128 py = _mm_set1_ps((float)y + 0.5f);
+		for (; x + 4 <= x1; x += 4) {
+			const __m128 px = _mm_add_ps(_mm_set1_ps((float)x), offsets);
+			__m128 e[3];
+			__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+			for (int k = 0; k < 3; k++) {
+				const __m128 across = _mm_mul_ps(_mm_sub_ps(px, ex[k]), dy[k]);
+				const __m128 along = _mm_mul_ps(_mm_sub_ps(py, ey[k]), dx[k]);
+				e[k] = _mm_mul_ps(_mm_sub_ps(across, along), sign[k]);
+				inside = _mm_and_ps(inside, _mm_or_ps(_mm_cmpgt_ps(e[k], zero), _mm_and_ps(_mm_cmpeq_ps(e[k], zero), tl[k])));
+			}
+			if (_mm_movemask_ps(inside) == 0) {
+				continue;
+			}
+
+			/* Depth test and write the four at once, then shade those that passed */
+			const __m128 l0 = _mm_mul_ps(e[0], inverse_area), l1 = _mm_mul_ps(e[1], inverse_area), l2 = _mm_mul_ps(e[2], inverse_area);
+			const __m128 z = _mm_add_ps(_mm_add_ps(_mm_mul_ps(l0, z0), _mm_mul_ps(l1, z1)), _mm_mul_ps(l2, z2));
+			float *depth = r->depth + (size_t)y * width + (size_t)x;
+			const __m128 old = _mm_loadu_ps(depth);
+			const __m128 pass = _mm_and_ps(inside, _mm_cmplt_ps(z, old));
+			const int mask = _mm_movemask_ps(pass);
+			if (mask == 0) {
+				continue;
+			}
+			_mm_storeu_ps(depth, _mm_or_ps(_mm_and_ps(pass, z), _mm_andnot_ps(pass, old)));
+
+			float w0[4], w1[4], w2[4];
+			_mm_storeu_ps(w0, l0);
+			_mm_storeu_ps(w1, l1);
+			_mm_storeu_ps(w2, l2);
+			uint8_t *pixels = r->target.pixels + ((size_t)y * width + (size_t)x) * 4;
+			for (int lane = 0; lane < 4; lane++) {
+				if (mask >> lane & 1) {
+					shade(t, w0[lane], w1[lane], w2[lane], pixels + lane * 4);
+				}
+			}
+		}
+#endif
+		for (; x < x1; x++) {
+			draw_pixel(r, t, x, y);
+		}
+	}
+}
+
+static void draw_tile(EGL_Raster *r, uint32_t tile) {
+	const int32_t x0 = (int32_t)(tile % r->tiles_x) * EGL_RASTER_TILE, y0 = (int32_t)(tile / r->tiles_x) * EGL_RASTER_TILE;
+	const int32_t x1 = (int32_t)fminf((float)(x0 + EGL_RASTER_TILE), (float)r->target.width);
+	const int32_t y1 = (int32_t)fminf((float)(y0 + EGL_RASTER_TILE), (float)r->target.height);
+	const size_t width = r->target.width;
+
+	for (int32_t y = y0; y < y1; y++) {
+		uint32_t *color = (uint32_t *)r->target.pixels + (size_t)y * width;
+		float *depth = r->depth + (size_t)y * width;
+		for (int32_t x = x0; x < x1; x++) {
+			color[x] = r->clear_color;
+			depth[x] = r->clear_depth;
+		}
+	}
+
+	for (uint32_t b = r->bin_starts[tile]; b < r->bin_starts[tile + 1]; b++) {
+		const EGL_RasterTriangle *t = &r->triangles[r->bins[b]];
+		const int32_t tx0 = (t->x0 > x0) ? t->x0 : x0, tx1 = (t->x1 < x1) ? t->x1 : x1;
+		const int32_t ty0 = (t->y0 > y0) ? t->y0 : y0, ty1 = (t->y1 < y1) ? t->y1 : y1;
+		draw_rows(r, t, tx0, ty0, tx1, ty1);
+	}
+}
+
+static void tile_kernel(void *data, int index, int count) {
+	TileJob *job = (TileJob *)data;
+	const uint32_t tiles = job->r->tiles_x * job->r->tiles_y;
+	for (uint32_t tile = atomic_fetch_add(&job->next, 1); tile < tiles; tile = atomic_fetch_add(&job->next, 1)) {
+		draw_tile(job->r, tile);
+	}
+}
+
+
+bool EGL_RasterInit(EGL_Raster *r, uint32_t width, uint32_t height, uint32_t triangles_max) {
+	memset(r, 0, sizeof(*r));
+	if (width == 0 || height == 0 || width > EGL_RASTER_SIZE_MAX || height > EGL_RASTER_SIZE_MAX) {
+		return false;
+	}
+	r->tiles_x = (width + EGL_RASTER_TILE - 1) / EGL_RASTER_TILE;
+	r->tiles_y = (height + EGL_RASTER_TILE - 1) / EGL_RASTER_TILE;
+	r->depth = (float *)EGL_malloc((size_t)width * height * sizeof(float));
+	r->triangles = (EGL_RasterTriangle *)EGL_malloc((size_t)triangles_max * sizeof(EGL_RasterTriangle));
+	r->bin_starts = (uint32_t *)EGL_malloc(((size_t)r->tiles_x * r->tiles_y + 1) * sizeof(uint32_t));
+	r->triangles_max = triangles_max;
+	if (!EGL_ImageInit(&r->target, width, height) || !r->depth || !r->triangles || !r->bin_starts) {
+		EGL_RasterFree(r);
+		return false;
+	}
+	EGL_RasterBegin(r, 0, 1.0f);
+	return true;
+}
+
+void EGL_RasterFree(EGL_Raster *r) {
+	EGL_ImageFree(&r->target);
+	EGL_free(r->depth);
+	EGL_free(r->triangles);
+	EGL_free(r->bin_starts);
+	EGL_free(r->bins);
+	memset(r, 0, sizeof(*r));
+}
+
+void EGL_RasterBegin(EGL_Raster *r, uint32_t clear_color, float clear_depth) {
+	r->triangle_count = 0;
+	r->clear_color = clear_color;
+	r->clear_depth = clear_depth;
+}
+
+bool EGL_RasterDraw(EGL_Raster *r, const float *mvp, const EGL_RasterVertex *vertices, uint32_t vertex_count,
+	const uint16_t *indices, uint32_t index_count, const EGL_Image *texture) {
+	bool ok = true;
+	for (uint32_t i = 0; i + 2 < index_count; i += 3) {
+		if (indices[i] >= vertex_count || indices[i + 1] >= vertex_count || indices[i + 2] >= vertex_count) {
+			continue;
+		}
+
+		ClipVertex corners[CLIPPED_MAX];
+		uint32_t codes[3];
+		for (int k = 0; k < 3; k++) {
+			const EGL_RasterVertex *v = &vertices[indices[i + k]];
+			for (int row = 0; row < 4; row++) {
+				corners[k].clip[row] = mvp[row] * v->position[0] + mvp[4 + row] * v->position[1] + mvp[8 + row] * v->position[2] + mvp[12 + row];
+			}
+			memcpy(corners[k].varyings, v->color, sizeof(v->color));
+			memcpy(corners[k].varyings + 4, v->uv, sizeof(v->uv));
+			codes[k] = outcode(&corners[k]);
+		}
+		if (codes[0] & codes[1] & codes[2]) {
+			continue; // Wholly outside one plane
+		}
+		if ((codes[0] | codes[1] | codes[2]) == 0) {
+			ok = emit(r, (const ClipVertex *[3]){ &corners[0], &corners[1], &corners[2] }, texture) && ok;
+			continue;
+		}
+
+		const uint32_t n = clip_polygon(corners, 3);
+		for (uint32_t k = 1; k + 1 < n; k++) {
+			ok = emit(r, (const ClipVertex *[3]){ &corners[0], &corners[k], &corners[k + 1] }, texture) && ok;
+		}
+	}
+	return ok;
+}
+
+bool EGL_RasterEnd(EGL_Raster *r) {
+	const uint32_t tiles = r->tiles_x * r->tiles_y;
+
+	/* Count each tile's triangles, then place them after the tiles before it */
+	memset(r->bin_starts, 0, ((size_t)tiles + 1) * sizeof(uint32_t));
+	uint64_t total = 0;
+	for (uint32_t i = 0; i < r->triangle_count; i++) {
+		const EGL_RasterTriangle *t = &r->triangles[i];
+		for (int32_t ty = t->y0 / EGL_RASTER_TILE; ty <= (t->y1 - 1) / EGL_RASTER_TILE; ty++) {
+			for (int32_t tx = t->x0 / EGL_RASTER_TILE; tx <= (t->x1 - 1) / EGL_RASTER_TILE; tx++) {
+				r->bin_starts[(uint32_t)ty * r->tiles_x + (uint32_t)tx + 1]++;
+				total++;
+			}
+		}
+	}
+	if (total > UINT32_MAX) {
+		return false;
+	}
+	if (total > r->bins_capacity) {
+		const uint64_t capacity = (total > (uint64_t)r->bins_capacity * 2) ? total : (uint64_t)r->bins_capacity * 2;
+		uint32_t *bins = (uint32_t *)EGL_realloc(r->bins, (size_t)capacity * sizeof(uint32_t));
+		if (!bins) {
+			return false;
+		}
+		r->bins = bins;
+		r->bins_capacity = (uint32_t)((capacity > UINT32_MAX) ? UINT32_MAX : capacity);
+	}
+	for (uint32_t tile = 0; tile < tiles; tile++) {
+		r->bin_starts[tile + 1] += r->bin_starts[tile];
+	}
+
+	/* Fill in draw order, advancing each tile's start to its end, then shift the starts back */
+	for (uint32_t i = 0; i < r->triangle_count; i++) {
+		const EGL_RasterTriangle *t = &r->triangles[i];
+		for (int32_t ty = t->y0 / EGL_RASTER_TILE; ty <= (t->y1 - 1) / EGL_RASTER_TILE; ty++) {
+			for (int32_t tx = t->x0 / EGL_RASTER_TILE; tx <= (t->x1 - 1) / EGL_RASTER_TILE; tx++) {
+				r->bins[r->bin_starts[(uint32_t)ty * r->tiles_x + (uint32_t)tx]++] = i;
+			}
+		}
+	}
+	memmove(r->bin_starts + 1, r->bin_starts, (size_t)tiles * sizeof(uint32_t));
+	r->bin_starts[0] = 0;
+
+	TileJob job = { .r = r };
+	atomic_init(&job.next, 0);
+	const int threads = EGL_ThreadCount();
+	EGL_ParallelRun(tile_kernel, &job, ((uint32_t)threads > tiles) ? (int)tiles : threads);
+	return true;
+}
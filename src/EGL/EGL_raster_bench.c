@@ -0,0 +1,110 @@
+#include <EGL/EGL_bench.h>
+#include <EGL/EGL_raster.h>
+#include <EGL/EGL_parallel.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+
+#define WIDTH 800
+#define HEIGHT 600
+#define QUADS 4096 // Small ones, like the swarm, on top of one textured floor.
+#define TEXTURE 64
+
+
+static uint32_t lcg(uint32_t *state) {
+	*state = *state * 1664525u + 1013904223u;
+	return *state >> 8;
+}
+
+static float unit(uint32_t *state) {
+	return (float)lcg(state) / (float)(1 << 24);
+}
+
+
+void EGL_RasterBench(void) {
+	EGL_DECLARE_BENCH(EGL_raster);
+
+	const uint32_t vertex_count = 4 * (QUADS + 1), index_count = 6 * (QUADS + 1);
+	EGL_RasterVertex *vertices = (EGL_RasterVertex *)malloc((size_t)vertex_count * sizeof(EGL_RasterVertex));
+	uint16_t *indices = (uint16_t *)malloc((size_t)index_count * sizeof(uint16_t));
+	EGL_Image texture;
+	EGL_Raster r;
+	if (!vertices || !indices || !EGL_ImageInit(&texture, TEXTURE, TEXTURE) || !EGL_RasterInit(&r, WIDTH, HEIGHT, 4 * (QUADS + 1))) {
+		printf(" failed to allocate\n");
+		free(vertices);
+		free(indices);
+		EGL_ImageFree(&texture);
+		return;
+	}
+
+	uint32_t state = 48;
+	for (uint32_t i = 0; i < TEXTURE * TEXTURE; i++) {
+		const uint32_t checker = ((i % TEXTURE) / 8 + (i / TEXTURE) / 8) % 2;
+		const uint32_t value = checker ? 0xFFC0C0C0u : 0xFF404040u;
+		memcpy(texture.pixels + i * 4, &value, 4);
+	}
+
+	/* A floor from z = 1 to 20, then quads scattered in front of it, each two triangles */
+	const float floor_corners[4][3] = { { -10, -1, 1 }, { 10, -1, 1 }, { 10, -1, 20 }, { -10, -1, 20 } };
+	const float uvs[4][2] = { { 0, 0 }, { 8, 0 }, { 8, 8 }, { 0, 8 } };
+	for (uint32_t q = 0; q <= QUADS; q++) {
+		const float x = unit(&state) * 8.0f - 4.0f, y = unit(&state) * 4.0f - 1.0f, z = 2.0f + unit(&state) * 15.0f;
+		const float size = 0.05f + unit(&state) * 0.2f;
+		const float color[4] = { unit(&state), unit(&state), unit(&state), 1.0f };
+		for (int k = 0; k < 4; k++) {
+			EGL_RasterVertex *v = &vertices[4 * q + (uint32_t)k];
+			if (q == QUADS) {
+				memcpy(v->position, floor_corners[k], sizeof(v->position));
+				memcpy(v->color, (const float[4]){ 1, 1, 1, 1 }, sizeof(v->color));
+			} else {
+				v->position[0] = x + ((k == 1 || k == 2) ? size : -size);
+				v->position[1] = y + ((k >= 2) ? size : -size);
+				v->position[2] = z;
+				memcpy(v->color, color, sizeof(v->color));
+			}
+			memcpy(v->uv, uvs[k], sizeof(v->uv));
+		}
+		const uint16_t first = (uint16_t)(4 * q);
+		const uint16_t quad[6] = { first, (uint16_t)(first + 1), (uint16_t)(first + 2), first, (uint16_t)(first + 2), (uint16_t)(first + 3) };
+		memcpy(indices + 6 * q, quad, sizeof(quad));
+	}
+
+	/* A 60 degree perspective looking down +z, depth 0 at z = 0.5 and 1 at z = 50, column-major */
+	const float f = 1.7320508f, n = 0.5f, d = 50.0f;
+	const float mvp[16] = {
+		f * HEIGHT / WIDTH, 0, 0, 0,
+		0, f, 0, 0,
+		0, 0, d / (d - n), 1,
+		0, 0, -n * d / (d - n), 0,
+	};
+
+	/* The floor is textured and the quads are not, so they are two draws */
+	const uint32_t quad_indices = 6 * QUADS;
+	const int threads = EGL_ThreadCount();
+	const int counts[2] = { 1, threads };
+	for (int k = 0; k < ((threads > 1) ? 2 : 1); k++) {
+		EGL_SetThreadCount(counts[k]);
+		double best = 1e30;
+		for (int rep = 0; rep < EGL_BENCH_REPEATS; rep++) {
+			const double begin = EGL_BenchNow();
+			EGL_RasterBegin(&r, 0xFF201010u, 1.0f);
+			EGL_RasterDraw(&r, mvp, vertices, vertex_count, indices + quad_indices, 6, &texture);
+			EGL_RasterDraw(&r, mvp, vertices, vertex_count, indices, quad_indices, NULL);
+			EGL_RasterEnd(&r);
+			const double elapsed = EGL_BenchNow() - begin;
+			best = (elapsed < best) ? elapsed : best;
+		}
+		EGL_BENCH_SINK += r.target.pixels[(HEIGHT / 2 * WIDTH + WIDTH / 2) * 4];
+		char label[64];
+		snprintf(label, sizeof(label), "  %d x %d, %d quads, %d thread(s)", WIDTH, HEIGHT, QUADS, counts[k]);
+		EGL_BenchReport(label, best, (double)WIDTH * HEIGHT, "px");
+		printf("   %.1f frames/s\n", 1.0 / best);
+	}
+	EGL_SetThreadCount(0);
+
+	EGL_RasterFree(&r);
+	EGL_ImageFree(&texture);
+	free(vertices);
+	free(indices);
+}
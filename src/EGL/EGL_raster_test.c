@@ -0,0 +1,404 @@
+#include <EGL/EGL_testing.h>
+#include <EGL/EGL_parallel.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+#define WIDTH 100 // Not a multiple of the tile size or of 4, so partial tiles and rows are drawn.
+#define HEIGHT 90
+#define CELLS 12
+#define CLEAR 0xFF000000u
+#define VERTICES_MAX 1024 // Per draw
+#define SWARM 150
+#define SCENE_HASH 0xafb7e201u // FNV-1a of EGL_RasterSceneTest's image; redraw it and update this on purpose only.
+
+
+static const float identity[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+
+/* Clip w is the vertex's z, and clip z is 0, so anything in front of the eye passes the depth test */
+static const float perspective[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0 };
+
+
+static uint32_t lcg(uint32_t *state) {
+	*state = *state * 1664525u + 1013904223u;
+	return *state >> 8;
+}
+
+static uint32_t pixel_at(const EGL_Raster *r, uint32_t x, uint32_t y) {
+	return ((const uint32_t *)r->target.pixels)[y * r->target.width + x];
+}
+
+static void set_vertex(EGL_RasterVertex *v, float x, float y, float z, float red, float green, float u) {
+	*v = (EGL_RasterVertex){ .position = { x, y, z }, .color = { red, green, 0.0f, 1.0f }, .uv = { u, 0.0f } };
+}
+
+/* Two triangles, drawn without indices */
+static void quad(EGL_RasterVertex v[6], const float corners[4][3], float red, float green) {
+	const int order[6] = { 0, 1, 2, 0, 2, 3 };
+	for (int k = 0; k < 6; k++) {
+		set_vertex(&v[k], corners[order[k]][0], corners[order[k]][1], corners[order[k]][2], red, green, 0.0f);
+	}
+}
+
+/* FNV-1a over the pixels, as the game checksums its headless runs */
+static uint32_t image_hash(const EGL_Image *image) {
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < (size_t)image->width * image->height * 4; i++) {
+		hash = (hash ^ image->pixels[i]) * 16777619u;
+	}
+	return hash;
+}
+
+static bool draw(EGL_Raster *r, const float *mvp, const EGL_RasterVertex *vertices, uint32_t count, const EGL_Image *texture) {
+	uint16_t indices[VERTICES_MAX];
+	for (uint32_t i = 0; i < count; i++) {
+		indices[i] = (uint16_t)i;
+	}
+	return EGL_RasterDraw(r, mvp, vertices, count, indices, count, texture);
+}
+
+
+/**
+ * A jittered grid of triangles, each its own color, that runs off every side
+ * of the target and past the guard band covers every pixel once: drawn
+ * forward or backward at one depth, where the first triangle to cover a
+ * pixel keeps it, the image is the same and has no holes. Corners sit on
+ * pixel centers, so many edges run exactly through them.
+ */
+static void EGL_RasterCoverageTest(EGL_Test *T) {
+	EGL_DECLARE_TEST;
+
+	/* CELL pixels apart, interior corners moved up to 6 pixels each way */
+	enum { CELL = 20 };
+	float corners[CELLS + 1][CELLS + 1][2];
+	uint32_t state = 48;
+	for (int j = 0; j <= CELLS; j++) {
+		for (int i = 0; i <= CELLS; i++) {
+			const bool inner = i > 0 && i < CELLS && j > 0 && j < CELLS;
+			const int jitter_x = inner ? (int)(lcg(&state) % 13) - 6 : 0, jitter_y = inner ? (int)(lcg(&state) % 13) - 6 : 0;
+			const float x = (float)((i - CELLS / 2) * CELL + jitter_x) + WIDTH / 2 + 0.5f;
+			const float y = (float)((j - CELLS / 2) * CELL + jitter_y) + HEIGHT / 2 + 0.5f;
+			corners[j][i][0] = x / WIDTH * 2.0f - 1.0f;
+			corners[j][i][1] = 1.0f - y / HEIGHT * 2.0f;
+		}
+	}
+	enum { TRIANGLES = 2 * CELLS * CELLS };
+	static EGL_RasterVertex forward[3 * TRIANGLES], backward[3 * TRIANGLES];
+	for (int t = 0; t < TRIANGLES; t++) {
+		const int cell = t / 2, i = cell % CELLS, j = cell / CELLS;
+		const int picks[2][3][2] = { { { 0, 0 }, { 1, 0 }, { 1, 1 } }, { { 0, 0 }, { 1, 1 }, { 0, 1 } } };
+		for (int k = 0; k < 3; k++) {
+			const float *c = corners[j + picks[t % 2][k][1]][i + picks[t % 2][k][0]];
+			const float red = (float)((t + 1) & 0xFF) / 255.0f, green = (float)((t + 1) >> 8) / 255.0f;
+			set_vertex(&forward[3 * t + k], c[0], c[1], 0.5f, red, green, 0.0f);
+		}
+	}
+	for (int t = 0; t < TRIANGLES; t++) {
+		memcpy(&backward[3 * t], &forward[3 * (TRIANGLES - 1 - t)], 3 * sizeof(EGL_RasterVertex));
+	}
+
+	EGL_Raster a, b;
+	if (!EGL_RasterInit(&a, WIDTH, HEIGHT, 4 * TRIANGLES) || !EGL_RasterInit(&b, WIDTH, HEIGHT, 4 * TRIANGLES)) {
+		EGL_DECLARE_ERROR("Failed to set up a %d x %d rasterizer.", WIDTH, HEIGHT);
+		EGL_RasterFree(&a);
+		return;
+	}
+	EGL_RasterBegin(&a, CLEAR, 1.0f);
+	EGL_RasterBegin(&b, CLEAR, 1.0f);
+	if (!draw(&a, identity, forward, 3 * TRIANGLES, NULL) || !draw(&b, identity, backward, 3 * TRIANGLES, NULL) ||
+		!EGL_RasterEnd(&a) || !EGL_RasterEnd(&b)) {
+		EGL_DECLARE_ERROR("Failed to draw %d triangles.", TRIANGLES);
+	}
+
+	uint32_t holes = 0, overlaps = 0;
+	for (uint32_t y = 0; y < HEIGHT; y++) {
+		for (uint32_t x = 0; x < WIDTH; x++) {
+			holes += pixel_at(&a, x, y) == CLEAR;
+			overlaps += pixel_at(&a, x, y) != pixel_at(&b, x, y);
+		}
+	}
+	if (holes || overlaps) {
+		EGL_DECLARE_ERROR("Found %u pixels covered by no triangle and %u by two.", holes, overlaps);
+	}
+	EGL_RasterFree(&a);
+	EGL_RasterFree(&b);
+}
+
+/**
+ * The nearer of two overlapping quads wins in either order, and a triangle
+ * reaching behind the eye is clipped to what is in front of it.
+ */
+static void EGL_RasterDepthTest(EGL_Test *T) {
+	EGL_DECLARE_TEST;
+
+	EGL_Raster r;
+	if (!EGL_RasterInit(&r, WIDTH, HEIGHT, 16)) {
+		EGL_DECLARE_ERROR("Failed to set up a %d x %d rasterizer.", WIDTH, HEIGHT);
+		return;
+	}
+
+	/* Red at depth 0.5 on the left two thirds, green at 0.2 on the right two thirds */
+	const float far[4][3] = { { -1, -1, 0.5f }, { 0.33f, -1, 0.5f }, { 0.33f, 1, 0.5f }, { -1, 1, 0.5f } };
+	const float near[4][3] = { { -0.33f, -1, 0.2f }, { 1, -1, 0.2f }, { 1, 1, 0.2f }, { -0.33f, 1, 0.2f } };
+	EGL_RasterVertex quads[2][6];
+	quad(quads[0], far, 1.0f, 0.0f);
+	quad(quads[1], near, 0.0f, 1.0f);
+	for (int first = 0; first < 2; first++) {
+		EGL_RasterBegin(&r, CLEAR, 1.0f);
+		draw(&r, identity, quads[first], 6, NULL);
+		draw(&r, identity, quads[1 - first], 6, NULL);
+		EGL_RasterEnd(&r);
+		const uint32_t left = pixel_at(&r, 5, HEIGHT / 2), middle = pixel_at(&r, WIDTH / 2, HEIGHT / 2), right = pixel_at(&r, WIDTH - 5, HEIGHT / 2);
+		if (left != 0xFF0000FFu || middle != 0xFF00FF00u || right != 0xFF00FF00u) {
+			EGL_DECLARE_ERROR("Drew %08x, %08x, %08x across the quads.", left, middle, right);
+		}
+	}
+
+	/* The far corner is behind the eye; straight ahead and straight up are in front of it */
+	EGL_RasterVertex behind[3];
+	set_vertex(&behind[0], -1.0f, -0.5f, 1.0f, 1.0f, 1.0f, 0.0f);
+	set_vertex(&behind[1], 1.0f, -0.5f, 1.0f, 1.0f, 1.0f, 0.0f);
+	set_vertex(&behind[2], 0.0f, 1.0f, -1.0f, 1.0f, 1.0f, 0.0f);
+	EGL_RasterBegin(&r, CLEAR, 1.0f);
+	draw(&r, perspective, behind, 3, NULL);
+	EGL_RasterEnd(&r);
+	const uint32_t top = pixel_at(&r, WIDTH / 2, 0), center = pixel_at(&r, WIDTH / 2, HEIGHT / 2), bottom = pixel_at(&r, WIDTH / 2, HEIGHT - 1);
+	if (top != 0xFF00FFFFu || center != 0xFF00FFFFu || bottom != CLEAR) {
+		EGL_DECLARE_ERROR("Drew %08x, %08x, %08x down a triangle behind the eye.", top, center, bottom);
+	}
+	EGL_RasterFree(&r);
+}
+
+/**
+ * Varyings interpolate with perspective: across a quad from w = 1 to 3, the
+ * middle of the screen is a quarter of the way along. Textures are sampled
+ * bilinearly at pixel centers, wrapping at the edges.
+ */
+static void EGL_RasterPerspectiveTest(EGL_Test *T) {
+	EGL_DECLARE_TEST;
+
+	EGL_Raster r;
+	if (!EGL_RasterInit(&r, WIDTH, HEIGHT, 16)) {
+		EGL_DECLARE_ERROR("Failed to set up a %d x %d rasterizer.", WIDTH, HEIGHT);
+		return;
+	}
+	EGL_RasterVertex v[6];
+	const float slanted[4][3] = { { -1, -1, 1 }, { 3, -3, 3 }, { 3, 3, 3 }, { -1, 1, 1 } };
+	quad(v, slanted, 0.0f, 0.0f);
+	for (int k = 0; k < 6; k++) {
+		v[k].color[0] = (v[k].position[2] > 2.0f) ? 1.0f : 0.0f;
+	}
+	EGL_RasterBegin(&r, CLEAR, 1.0f);
+	draw(&r, perspective, v, 6, NULL);
+	EGL_RasterEnd(&r);
+
+	/* Pixel centers are half a pixel right of the middle, x / w = 1 / WIDTH */
+	const float ndc = 1.0f / WIDTH, along = (1.0f + ndc) / (4.0f - 2.0f * ndc);
+	const int red = (int)(pixel_at(&r, WIDTH / 2, HEIGHT / 2) & 0xFF), expected = (int)(along * 255.0f + 0.5f);
+	if (abs(red - expected) > 1) {
+		EGL_DECLARE_ERROR("Drew red %d in the middle of a slanted quad, not %d.", red, expected);
+	}
+
+	/* A 2 x 2 texture over an 8 x 8 target */
+	EGL_Image texture;
+	EGL_Raster small;
+	if (!EGL_ImageInit(&texture, 2, 2) || !EGL_RasterInit(&small, 8, 8, 16)) {
+		EGL_DECLARE_ERROR("Failed to set up a %d x %d texture.", 2, 2);
+		EGL_ImageFree(&texture);
+		EGL_RasterFree(&r);
+		return;
+	}
+	const uint8_t texels[4][4] = { { 255, 0, 0, 255 }, { 0, 255, 0, 255 }, { 0, 0, 255, 255 }, { 255, 255, 255, 0 } };
+	memcpy(texture.pixels, texels, sizeof(texels));
+	const float full[4][3] = { { -1, 1, 0 }, { 1, 1, 0 }, { 1, -1, 0 }, { -1, -1, 0 } };
+	quad(v, full, 1.0f, 1.0f);
+	const float uvs[6][2] = { { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, 0 }, { 1, 1 }, { 0, 1 } };
+	for (int k = 0; k < 6; k++) {
+		v[k].color[2] = 1.0f;
+		memcpy(v[k].uv, uvs[k], sizeof(uvs[k]));
+	}
+	EGL_RasterBegin(&small, 0, 1.0f);
+	draw(&small, identity, v, 6, &texture);
+	EGL_RasterEnd(&small);
+
+	int worst = 0;
+	for (uint32_t y = 0; y < 8; y++) {
+		for (uint32_t x = 0; x < 8; x++) {
+			/* Texel space is the pixel center over 4, less half a texel */
+			const float s = ((float)x + 0.5f) / 4.0f - 0.5f, t = ((float)y + 0.5f) / 4.0f - 0.5f;
+			const float fs = s - floorf(s), ft = t - floorf(t);
+			const int s0 = ((int)floorf(s) + 2) % 2, t0 = ((int)floorf(t) + 2) % 2;
+			const uint8_t *pixel = small.target.pixels + (y * 8 + x) * 4;
+			for (int c = 0; c < 4; c++) {
+				const float top = texels[t0 * 2 + s0][c] * (1.0f - fs) + texels[t0 * 2 + 1 - s0][c] * fs;
+				const float bottom = texels[(1 - t0) * 2 + s0][c] * (1.0f - fs) + texels[(1 - t0) * 2 + 1 - s0][c] * fs;
+				const int error = abs((int)pixel[c] - (int)(top * (1.0f - ft) + bottom * ft + 0.5f));
+				worst = (error > worst) ? error : worst;
+			}
+		}
+	}
+	if (worst > 1) {
+		EGL_DECLARE_ERROR("Sampled a texture up to %d off.", worst);
+	}
+	EGL_ImageFree(&texture);
+	EGL_RasterFree(&small);
+	EGL_RasterFree(&r);
+}
+
+/**
+ * A pile of overlapping triangles draws the same image on one thread as on
+ * all of them, and a frame with more triangles than it holds drops the rest.
+ */
+static void EGL_RasterThreadsTest(EGL_Test *T) {
+	EGL_DECLARE_TEST;
+
+	enum { TRIANGLES = 300 };
+	static EGL_RasterVertex v[3 * TRIANGLES];
+	uint32_t state = 7;
+	for (int i = 0; i < 3 * TRIANGLES; i++) {
+		const float x = (float)(lcg(&state) % 2400) / 1000.0f - 1.2f, y = (float)(lcg(&state) % 2400) / 1000.0f - 1.2f;
+		set_vertex(&v[i], x, y, (float)(lcg(&state) % 1000) / 1000.0f, (float)(lcg(&state) % 256) / 255.0f, (float)(i % 7) / 6.0f, x);
+	}
+
+	EGL_Raster one, all;
+	if (!EGL_RasterInit(&one, WIDTH, HEIGHT, TRIANGLES) || !EGL_RasterInit(&all, WIDTH, HEIGHT, TRIANGLES)) {
+		EGL_DECLARE_ERROR("Failed to set up a %d x %d rasterizer.", WIDTH, HEIGHT);
+		EGL_RasterFree(&one);
+		return;
+	}
+	EGL_SetThreadCount(1);
+	EGL_RasterBegin(&one, CLEAR, 1.0f);
+	draw(&one, identity, v, 3 * TRIANGLES, NULL);
+	EGL_RasterEnd(&one);
+	EGL_SetThreadCount(0);
+	EGL_RasterBegin(&all, CLEAR, 1.0f);
+	draw(&all, identity, v, 3 * TRIANGLES, NULL);
+	EGL_RasterEnd(&all);
+	if (memcmp(one.target.pixels, all.target.pixels, (size_t)WIDTH * HEIGHT * 4) != 0) {
+		EGL_DECLARE_ERROR("Drew a different image on %d threads than on one.", EGL_ThreadCount());
+	}
+
+	/* Twice as many, all inside the view */
+	EGL_RasterBegin(&one, CLEAR, 1.0f);
+	draw(&one, identity, v, 3 * TRIANGLES, NULL);
+	if (draw(&one, identity, v, 3 * TRIANGLES, NULL) || one.dropped == 0 || one.triangle_count > TRIANGLES) {
+		EGL_DECLARE_ERROR("Kept %u triangles past %d.", one.triangle_count, TRIANGLES);
+	}
+	EGL_RasterFree(&one);
+	EGL_RasterFree(&all);
+}
+
+/**
+ * The headless frame in small: a textured backdrop, then a swarm of quads
+ * sorted nearest first by EGL_InstanceBatch, as the game hands them to its
+ * depth-tested pipeline. Drawn farthest first instead, the depth test gives
+ * the same image, and that image hashes to SCENE_HASH.
+ */
+static void EGL_RasterSceneTest(EGL_Test *T) {
+	EGL_DECLARE_TEST;
+
+	EGL_Image texture;
+	EGL_InstanceBatch b;
+	EGL_Raster r;
+	static EGL_RasterVertex vertices[2][4 * (SWARM + 1)];
+	static uint16_t indices[6 * (SWARM + 1)];
+	if (!EGL_ImageInit(&texture, 8, 8) || !EGL_InstanceBatchInit(&b, SWARM, 1) || !EGL_RasterInit(&r, WIDTH, HEIGHT, 2 * (SWARM + 1))) {
+		EGL_DECLARE_ERROR("Failed to set up a scene of %d quads.", SWARM);
+		EGL_ImageFree(&texture);
+		EGL_InstanceBatchFree(&b);
+		return;
+	}
+	for (uint32_t i = 0; i < 64; i++) {
+		const uint32_t value = ((i % 8) / 2 + (i / 8) / 2) % 2 ? 0xFFC0C0C0u : 0xFF404040u;
+		memcpy(texture.pixels + i * 4, &value, 4);
+	}
+
+	/* Each quad a step farther than the last, so no two tie at a pixel */
+	float x[SWARM], y[SWARM], z[SWARM], scale[SWARM];
+	uint32_t color[SWARM];
+	uint32_t state = 11;
+	for (int i = 0; i < SWARM; i++) {
+		x[i] = (float)(lcg(&state) % 4000) / 1000.0f - 2.0f;
+		y[i] = (float)(lcg(&state) % 4000) / 1000.0f - 2.0f;
+		z[i] = 2.0f + 3.0f * (float)((i * 37) % SWARM) / SWARM;
+		scale[i] = 0.1f + (float)(lcg(&state) % 300) / 1000.0f;
+		color[i] = 0xFF000000u | lcg(&state);
+	}
+	const EGL_InstanceSource swarm = { .x = x, .y = y, .z = z, .scale = scale, .color = color, .count = SWARM };
+	EGL_InstanceBatchBegin(&b, (const float[3]){ 0.0f, 0.0f, 0.0f });
+	if (!EGL_InstanceBatchAdd(&b, 0, 0, &swarm) || !EGL_InstanceBatchBuild(&b)) {
+		EGL_DECLARE_ERROR("Failed to build %d instances.", SWARM);
+	}
+
+	/* The backdrop, then the swarm nearest first in [0] and farthest first in [1] */
+	const float corners[4][2] = { { -1, -1 }, { 1, -1 }, { 1, 1 }, { -1, 1 } };
+	for (int order = 0; order < 2; order++) {
+		for (int k = 0; k < 4; k++) {
+			vertices[order][k] = (EGL_RasterVertex){
+				.position = { 6.0f * corners[k][0], 6.0f * corners[k][1], 6.0f },
+				.color = { 1, 1, 1, 1 },
+				.uv = { 4.0f * corners[k][0], 4.0f * corners[k][1] },
+			};
+		}
+		for (uint32_t n = 0; n < b.count; n++) {
+			const EGL_Instance *instance = &b.instances[order ? b.count - 1 - n : n];
+			for (int k = 0; k < 4; k++) {
+				EGL_RasterVertex *v = &vertices[order][4 * (n + 1) + (uint32_t)k];
+				*v = (EGL_RasterVertex){
+					.position = {
+						instance->position[0] + instance->scale * corners[k][0],
+						instance->position[1] + instance->scale * corners[k][1],
+						instance->position[2],
+					},
+					.color = { (float)(instance->color & 0xFF) / 255.0f, (float)(instance->color >> 8 & 0xFF) / 255.0f,
+						(float)(instance->color >> 16 & 0xFF) / 255.0f, 1.0f },
+				};
+			}
+		}
+	}
+	for (uint16_t q = 0; q <= SWARM; q++) {
+		const uint16_t first = (uint16_t)(4 * q);
+		const uint16_t quad[6] = { first, (uint16_t)(first + 1), (uint16_t)(first + 2), first, (uint16_t)(first + 2), (uint16_t)(first + 3) };
+		memcpy(indices + 6 * q, quad, sizeof(quad));
+	}
+
+	/* A 90 degree perspective looking down +z, depth 0 at z = 0.5 and 1 at z = 50, column-major */
+	const float n = 0.5f, d = 50.0f;
+	const float mvp[16] = {
+		(float)HEIGHT / WIDTH, 0, 0, 0,
+		0, 1, 0, 0,
+		0, 0, d / (d - n), 1,
+		0, 0, -n * d / (d - n), 0,
+	};
+	uint32_t hashes[2];
+	for (int order = 0; order < 2; order++) {
+		EGL_RasterBegin(&r, CLEAR, 1.0f);
+		if (!EGL_RasterDraw(&r, mvp, vertices[order], 4, indices, 6, &texture) ||
+			!EGL_RasterDraw(&r, mvp, vertices[order], 4 * (SWARM + 1), indices + 6, 6 * SWARM, NULL) || !EGL_RasterEnd(&r)) {
+			EGL_DECLARE_ERROR("Failed to draw %u triangles.", r.triangle_count);
+		}
+		hashes[order] = image_hash(&r.target);
+	}
+	if (hashes[0] != hashes[1]) {
+		EGL_DECLARE_ERROR("Drew %08x nearest first but %08x farthest first.", hashes[0], hashes[1]);
+	}
+	if (hashes[0] != SCENE_HASH) {
+		EGL_DECLARE_ERROR("Drew the scene as %08x, not %08x.", hashes[0], SCENE_HASH);
+	}
+
+	EGL_RasterFree(&r);
+	EGL_InstanceBatchFree(&b);
+	EGL_ImageFree(&texture);
+}
+
+
+void EGL_RasterTest(EGL_TestModule *M) {
+	EGL_DECLARE_MODULE(EGL_raster);
+
+	EGL_RUN_TEST(EGL_RasterCoverageTest);
+	EGL_RUN_TEST(EGL_RasterDepthTest);
+	EGL_RUN_TEST(EGL_RasterPerspectiveTest);
+	EGL_RUN_TEST(EGL_RasterThreadsTest);
+	EGL_RUN_TEST(EGL_RasterSceneTest);
+}
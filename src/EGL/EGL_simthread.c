@@ -0,0 +1,117 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <EGL/EGL_simthread.h>
+#include <EGL/EGL_memory.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+
+#define CACHE_LINE 64
+
+
+static void publish(EGL_SimThread *sim, uint64_t tick, uint64_t time_ns) {
+	unsigned char *slot = (unsigned char *)EGL_TripleBufferBack(&sim->buffer);
+	*(EGL_SimFrame *)slot = (EGL_SimFrame){ .tick = tick, .time_ns = time_ns };
+	memcpy(slot + EGL_SIM_STATE_OFFSET, sim->state, sim->state_size);
+	EGL_TripleBufferPublish(&sim->buffer);
+}
+
+/* Sleep until each step is due, so the step rate never depends on the reader. */
+static int run(void *arg) {
+	EGL_SimThread *sim = (EGL_SimThread *)arg;
+
+	uint64_t tick = 0;
+	uint64_t due = sim->start_ns;
+	while (atomic_load_explicit(&sim->running, memory_order_relaxed)) {
+		due += sim->step_ns;
+		uint64_t now = EGL_SimNow();
+		if (now > due + EGL_SIM_LAG_MAX * sim->step_ns) {
+			const uint64_t behind = (now - due) / sim->step_ns;
+			atomic_fetch_add_explicit(&sim->skipped, behind, memory_order_relaxed);
+			due += behind * sim->step_ns;
+		}
+		while (now < due) {
+			const uint64_t wait = due - now;
+			thrd_sleep(&(struct timespec){ .tv_sec = (time_t)(wait / 1000000000u), .tv_nsec = (long)(wait % 1000000000u) }, NULL);
+			now = EGL_SimNow();
+		}
+
+		sim->step(sim->data, sim->state, ++tick);
+		publish(sim, tick, due);
+	}
+	return 0;
+}
+
+
+bool EGL_TripleBufferInit(EGL_TripleBuffer *b, size_t size) {
+	memset(b, 0, sizeof(*b));
+	b->size = size;
+	b->stride = (size + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+	if (b->stride == 0) {
+		b->stride = CACHE_LINE;
+	}
+
+	b->slots = (unsigned char *)aligned_alloc(CACHE_LINE, 3 * b->stride);
+	if (!b->slots) {
+		return false;
+	}
+	memset(b->slots, 0, 3 * b->stride);
+
+	b->front = 0;
+	atomic_init(&b->shared, 1u);
+	b->back = 2;
+	return true;
+}
+
+void EGL_TripleBufferFree(EGL_TripleBuffer *b) {
+	free(b->slots);
+	memset(b, 0, sizeof(*b));
+}
+
+uint64_t EGL_SimNow(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+bool EGL_SimThreadStart(EGL_SimThread *sim, const void *initial, size_t size, uint64_t step_ns, EGL_SimStepFunc step, void *data) {
+	memset(sim, 0, sizeof(*sim));
+	sim->state_size = size;
+	sim->step_ns = step_ns ? step_ns : 1;
+	sim->step = step;
+	sim->data = data;
+
+	sim->state = EGL_malloc(size ? size : 1);
+	if (!sim->state || !EGL_TripleBufferInit(&sim->buffer, EGL_SIM_STATE_OFFSET + size)) {
+		EGL_free(sim->state);
+		EGL_TripleBufferFree(&sim->buffer);
+		memset(sim, 0, sizeof(*sim));
+		return false;
+	}
+	memcpy(sim->state, initial, size);
+
+	sim->start_ns = EGL_SimNow();
+	publish(sim, 0, sim->start_ns);
+
+	atomic_init(&sim->running, true);
+	atomic_init(&sim->skipped, 0);
+	if (thrd_create(&sim->thread, run, sim) != thrd_success) {
+		EGL_free(sim->state);
+		EGL_TripleBufferFree(&sim->buffer);
+		memset(sim, 0, sizeof(*sim));
+		return false;
+	}
+	return true;
+}
+
+void EGL_SimThreadStop(EGL_SimThread *sim) {
+	if (sim->state) {
+		atomic_store_explicit(&sim->running, false, memory_order_relaxed);
+		thrd_join(sim->thread, NULL);
+		EGL_free(sim->state);
+		EGL_TripleBufferFree(&sim->buffer);
+	}
+	memset(sim, 0, sizeof(*sim));
+}
@@ -0,0 +1,161 @@
+#include <EGL/EGL_testing.h>
+#include <stdlib.h>
+#include <time.h>
+
+
+#define WORDS 64          // Words per state, so a torn copy is easy to spot.
+#define PUBLISHES 200000  // States the writer thread publishes.
+#define STEP_NS 4000000u  // 4 ms simulation step.
+#define RUN_NS 600000000u // How long the stalling renderer runs.
+
+
+typedef struct {
+	uint64_t words[WORDS];
+} State;
+
+typedef struct {
+	EGL_TripleBuffer *buffer;
+} Writer;
+
+
+static bool consistent(const State *s) {
+	for (int k = 1; k < WORDS; k++) {
+		if (s->words[k] != s->words[0] + (uint64_t)k) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static void fill(State *s, uint64_t value) {
+	for (int k = 0; k < WORDS; k++) {
+		s->words[k] = value + (uint64_t)k;
+	}
+}
+
+static int write_states(void *arg) {
+	Writer *w = (Writer *)arg;
+	for (uint64_t i = 1; i <= PUBLISHES; i++) {
+		fill((State *)EGL_TripleBufferBack(w->buffer), i);
+		EGL_TripleBufferPublish(w->buffer);
+	}
+	return 0;
+}
+
+static void step_state(void *data, void *state, uint64_t tick) {
+	fill((State *)state, tick);
+}
+
+static void sleep_ns(uint64_t ns) {
+	thrd_sleep(&(struct timespec){ .tv_sec = (time_t)(ns / 1000000000u), .tv_nsec = (long)(ns % 1000000000u) }, NULL);
+}
+
+
+/**
+ * A reader racing one writer never sees a torn slot, never goes back in time,
+ * and ends on the last state published.
+ */
+static void EGL_TripleBufferRaceTest(EGL_Test *T) {
+	EGL_DECLARE_TEST;
+
+	EGL_TripleBuffer buffer;
+	if (!EGL_TripleBufferInit(&buffer, sizeof(State))) {
+		EGL_DECLARE_ERROR("Failed to allocate a buffer of %zu bytes.", sizeof(State));
+		return;
+	}
+	Writer writer = { .buffer = &buffer };
+	thrd_t thread;
+	if (thrd_create(&thread, write_states, &writer) != thrd_success) {
+		EGL_DECLARE_ERROR("Failed to start the writer for %d states.", PUBLISHES);
+		EGL_TripleBufferFree(&buffer);
+		return;
+	}
+
+	uint64_t last = 0;
+	uint64_t reads = 0;
+	while (last < PUBLISHES && T->error_count < ERRORS_MAX - 1) {
+		bool fresh;
+		const State *s = (const State *)EGL_TripleBufferLatest(&buffer, &fresh);
+		reads++;
+		if (!fresh && last == 0) {
+			continue; // Still the zeroed slot.
+		}
+		if (!consistent(s)) {
+			EGL_DECLARE_ERROR("Read %llu: slot starting at %llu is torn.", (unsigned long long)reads, (unsigned long long)s->words[0]);
+		} else if (s->words[0] < last || (fresh && s->words[0] == last)) {
+			EGL_DECLARE_ERROR("Read %llu: got state %llu after %llu.", (unsigned long long)reads, (unsigned long long)s->words[0], (unsigned long long)last);
+		}
+		last = s->words[0];
+	}
+	thrd_join(thread, NULL);
+
+	bool fresh;
+	const State *s = (const State *)EGL_TripleBufferLatest(&buffer, &fresh);
+	if (fresh || s->words[0] != PUBLISHES) {
+		EGL_DECLARE_ERROR("Ended on state %llu, not %d.", (unsigned long long)s->words[0], PUBLISHES);
+	}
+	EGL_TripleBufferFree(&buffer);
+}
+
+/**
+ * A renderer that stalls for up to ten steps at a time does not slow the
+ * simulation down or make it skip: ticks keep coming every step, and every
+ * state read is whole and no older than the stall.
+ */
+static void EGL_SimThreadStallTest(EGL_Test *T) {
+	EGL_DECLARE_TEST;
+
+	State initial;
+	fill(&initial, 0);
+	EGL_SimThread sim;
+	if (!EGL_SimThreadStart(&sim, &initial, sizeof(initial), STEP_NS, step_state, NULL)) {
+		EGL_DECLARE_ERROR("Failed to start a simulation of %zu bytes.", sizeof(initial));
+		return;
+	}
+
+	uint32_t state[4] = {0,0,0,0};
+	EGL_Seed(state, 37);
+	uint64_t last = 0;
+	uint64_t now = EGL_SimNow();
+	while (now - sim.start_ns < RUN_NS && T->error_count < ERRORS_MAX - 1) {
+		EGL_SimFrame frame;
+		const State *s = (const State *)EGL_SimThreadLatest(&sim, &frame);
+		if (!consistent(s) || s->words[0] != frame.tick) {
+			EGL_DECLARE_ERROR("Frame %llu holds a torn state starting at %llu.", (unsigned long long)frame.tick, (unsigned long long)s->words[0]);
+		}
+		if (frame.tick < last || frame.time_ns != sim.start_ns + frame.tick * STEP_NS) {
+			EGL_DECLARE_ERROR("Frame %llu after %llu was due %lld ns off schedule.", (unsigned long long)frame.tick, (unsigned long long)last,
+				(long long)(frame.time_ns - sim.start_ns - frame.tick * STEP_NS));
+		}
+		const float alpha = EGL_SimThreadAlpha(&sim, &frame, now);
+		if (alpha < 0.0f || alpha > 1.0f || now > frame.time_ns + 3 * STEP_NS) {
+			EGL_DECLARE_ERROR("Frame %llu is %lld ns old and blends by %f.", (unsigned long long)frame.tick, (long long)(now - frame.time_ns), alpha);
+		}
+		last = frame.tick;
+
+		/* Mostly a frame or two, sometimes a long stall, like a blocked swapchain */
+		const uint64_t stall = (EGL_RandInt(state, 0, 8) == 0) ? STEP_NS * 10 : STEP_NS / 4 * (uint64_t)EGL_RandInt(state, 1, 8);
+		sleep_ns(stall);
+		now = EGL_SimNow();
+	}
+
+	EGL_SimFrame frame;
+	EGL_SimThreadLatest(&sim, &frame);
+	const uint64_t elapsed = EGL_SimNow() - sim.start_ns;
+	const uint64_t skipped = atomic_load(&sim.skipped);
+	EGL_SimThreadStop(&sim);
+
+	/* Allow a step or two of latency and some scheduler jitter on a loaded machine */
+	const double expected = (double)elapsed / STEP_NS;
+	if (skipped > 0 || frame.tick + 3 < expected || (double)frame.tick > expected + 1.0) {
+		EGL_DECLARE_ERROR("Simulated %llu steps (%llu skipped) in %.1f steps of time.", (unsigned long long)frame.tick, (unsigned long long)skipped, expected);
+	}
+}
+
+
+void EGL_SimThreadTest(EGL_TestModule *M) {
+	EGL_DECLARE_MODULE(EGL_simthread);
+
+	EGL_RUN_TEST(EGL_TripleBufferRaceTest);
+	EGL_RUN_TEST(EGL_SimThreadStallTest);
+}
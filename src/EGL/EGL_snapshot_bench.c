@@ -0,0 +1,98 @@
+#include <EGL/EGL_bench.h>
+#include <EGL/EGL_parallel.h>
+#include <EGL/EGL_snapshot.h>
+
+#include <math.h>
+#include <stdlib.h>
+
+
+#define ENTITIES 100000
+
+
+static uint32_t lcg(uint32_t *state) {
+	*state = *state * 1664525u + 1013904223u;
+	return *state >> 8;
+}
+
+static float unit(uint32_t *state) {
+	return (float)lcg(state) / 16777216.0f;
+}
+
+
+void EGL_SnapshotBench(void) {
+	EGL_DECLARE_BENCH(EGL_snapshot);
+
+	EGL_Snapshot snapshot;
+	EGL_TransformBatch out;
+	if (!EGL_SnapshotInit(&snapshot, ENTITIES) || !EGL_TransformBatchInit(&out, ENTITIES)) {
+		printf(" %d entities: failed to allocate\n", ENTITIES);
+		return;
+	}
+
+	/* One simulation step of entities spinning and drifting */
+	uint32_t state = 33;
+	for (uint32_t i = 0; i < ENTITIES; i++) {
+		float q[4] = { unit(&state) - 0.5f, unit(&state) - 0.5f, unit(&state) - 0.5f, unit(&state) - 0.5f };
+		EGL_QuatNormalize(q);
+		snapshot.current.rotation_x[i] = q[0];
+		snapshot.current.rotation_y[i] = q[1];
+		snapshot.current.rotation_z[i] = q[2];
+		snapshot.current.rotation_w[i] = q[3];
+		snapshot.current.translation_x[i] = unit(&state);
+	}
+	EGL_SnapshotSave(&snapshot);
+	for (uint32_t i = 0; i < ENTITIES; i++) {
+		float q[4] = { snapshot.current.rotation_x[i], snapshot.current.rotation_y[i], snapshot.current.rotation_z[i], snapshot.current.rotation_w[i] };
+		const float omega[3] = { unit(&state) - 0.5f, unit(&state) - 0.5f, unit(&state) - 0.5f };
+		EGL_QuatIntegrate(q, omega, 0.3f);
+		snapshot.current.rotation_x[i] = q[0];
+		snapshot.current.rotation_y[i] = q[1];
+		snapshot.current.rotation_z[i] = q[2];
+		snapshot.current.rotation_w[i] = q[3];
+		snapshot.current.translation_x[i] += 0.01f;
+	}
+
+	char label[64];
+	double best = 1e30;
+	for (int r = 0; r < EGL_BENCH_REPEATS * 4; r++) {
+		double begin = EGL_BenchNow();
+		EGL_SnapshotSave(&snapshot);
+		double elapsed = EGL_BenchNow() - begin;
+		best = (elapsed < best) ? elapsed : best;
+	}
+	snprintf(label, sizeof(label), "save %d", ENTITIES);
+	EGL_BenchReport(label, best, (double)ENTITIES, "entity");
+
+	const char *names[3] = { "lerp", "nlerp", "slerp" };
+	const int threads_max = EGL_ThreadCount();
+	for (int mode = EGL_INTERPOLATE_LERP; mode <= EGL_INTERPOLATE_SLERP; mode++) {
+		for (int threads = 1; threads <= threads_max; threads *= 2) {
+			best = 1e30;
+			for (int r = 0; r < EGL_BENCH_REPEATS * 4; r++) {
+				double begin = EGL_BenchNow();
+				EGL_SnapshotInterpolate(&snapshot, 0.37f, (EGL_InterpolateMode)mode, &out, threads);
+				double elapsed = EGL_BenchNow() - begin;
+				best = (elapsed < best) ? elapsed : best;
+			}
+			EGL_BENCH_SINK += (uint64_t)(out.rotation_w[0] * 1000.0f);
+			snprintf(label, sizeof(label), "%s %d, %d threads", names[mode], ENTITIES, threads);
+			EGL_BenchReport(label, best, (double)ENTITIES, "entity");
+		}
+	}
+
+	/* What a frame costs: blend, then compose the matrices */
+	best = 1e30;
+	for (int r = 0; r < EGL_BENCH_REPEATS * 4; r++) {
+		double begin = EGL_BenchNow();
+		EGL_SnapshotInterpolate(&snapshot, 0.37f, EGL_INTERPOLATE_SLERP, &out, threads_max);
+		EGL_TransformBatchUpdate(&out, threads_max);
+		double elapsed = EGL_BenchNow() - begin;
+		best = (elapsed < best) ? elapsed : best;
+	}
+	EGL_BENCH_SINK += (uint64_t)out.models[0];
+	snprintf(label, sizeof(label), "slerp + matrices %d, %d threads", ENTITIES, threads_max);
+	EGL_BenchReport(label, best, (double)ENTITIES, "entity");
+
+	EGL_SnapshotFree(&snapshot);
+	EGL_TransformBatchFree(&out);
+}
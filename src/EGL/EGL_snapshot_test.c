@@ -0,0 +1,170 @@
+#include <EGL/EGL_testing.h>
+#include <math.h>
+#include <stdlib.h>
+
+
+#define COUNT 1003 // Not a multiple of the SIMD width or a dirty word.
+
+
+static void random_rotation(uint32_t *state, float q[4]) {
+	float r2;
+	do {
+		for (int a = 0; a < 4; a++) {
+			q[a] = 2.0f * EGL_RandFloat(state) - 1.0f;
+		}
+		r2 = q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3];
+	} while (r2 < 0.01f || r2 > 1.0f);
+	EGL_QuatNormalize(q);
+}
+
+/* Previous states are random; current states turn by up to `angle` and sometimes flip the sign of the quaternion. */
+static void random_steps(uint32_t *state, EGL_Snapshot *snapshot, float angle) {
+	for (uint32_t i = 0; i < snapshot->count; i++) {
+		float q[4];
+		random_rotation(state, q);
+		snapshot->current.rotation_x[i] = q[0];
+		snapshot->current.rotation_y[i] = q[1];
+		snapshot->current.rotation_z[i] = q[2];
+		snapshot->current.rotation_w[i] = q[3];
+		snapshot->current.translation_x[i] = EGL_RandFloat(state);
+		snapshot->current.scale_y[i] = 1.0f + EGL_RandFloat(state);
+	}
+	EGL_SnapshotSave(snapshot);
+
+	for (uint32_t i = 0; i < snapshot->count; i++) {
+		float q[4] = { snapshot->current.rotation_x[i], snapshot->current.rotation_y[i], snapshot->current.rotation_z[i], snapshot->current.rotation_w[i] };
+		float axis[3] = { EGL_RandFloat(state) - 0.5f, EGL_RandFloat(state) - 0.5f, EGL_RandFloat(state) + 0.1f };
+		EGL_QuatRotate(q, angle * EGL_RandFloat(state), axis);
+		const float sign = (i % 3 == 0) ? -1.0f : 1.0f;
+		snapshot->current.rotation_x[i] = sign * q[0];
+		snapshot->current.rotation_y[i] = sign * q[1];
+		snapshot->current.rotation_z[i] = sign * q[2];
+		snapshot->current.rotation_w[i] = sign * q[3];
+		snapshot->current.translation_x[i] += 1.0f;
+		snapshot->current.scale_y[i] *= 2.0f;
+	}
+}
+
+/* Slerp in double precision with trig, for reference. */
+static void slerp(const float p[4], const float q[4], float t, double r[4]) {
+	double d = 0.0;
+	for (int a = 0; a < 4; a++) {
+		d += (double)p[a] * q[a];
+	}
+	const double sign = (d < 0.0) ? -1.0 : 1.0;
+	d = fabs(d);
+	const double theta = acos(d < 1.0 ? d : 1.0);
+	double wp = 1.0 - t;
+	double wq = t;
+	if (theta > 1e-6) {
+		wp = sin((1.0 - t) * theta) / sin(theta);
+		wq = sin(t * theta) / sin(theta);
+	}
+	for (int a = 0; a < 4; a++) {
+		r[a] = wp * p[a] + sign * wq * q[a];
+	}
+}
+
+
+/**
+ * Each mode blends every entity like a double precision reference, and nlerp
+ * and slerp take the shorter arc.
+ */
+static void EGL_SnapshotInterpolateTest(EGL_Test *T) {
+	EGL_DECLARE_TEST;
+
+	EGL_Snapshot snapshot;
+	EGL_TransformBatch out;
+	if (!EGL_SnapshotInit(&snapshot, COUNT) || !EGL_TransformBatchInit(&out, COUNT)) {
+		EGL_DECLARE_ERROR("Failed to allocate %d entities.", COUNT);
+		return;
+	}
+
+	uint32_t state[4] = {0,0,0,0};
+	EGL_Seed(state, 33);
+	random_steps(state, &snapshot, 2.0f);
+
+	const float alphas[] = { 0.0f, 0.3f, 0.5f, 0.9f, 1.0f };
+	for (int mode = EGL_INTERPOLATE_LERP; mode <= EGL_INTERPOLATE_SLERP; mode++) {
+		for (int k = 0; k < 5 && T->error_count < ERRORS_MAX - 1; k++) {
+			const float alpha = alphas[k];
+			memset(out.dirty, 0, sizeof(uint64_t) * ((COUNT + 63) / 64));
+			EGL_SnapshotInterpolate(&snapshot, alpha, (EGL_InterpolateMode)mode, &out, 3);
+
+			for (uint32_t i = 0; i < COUNT && T->error_count < ERRORS_MAX - 1; i++) {
+				const float p[4] = { snapshot.previous.rotation_x[i], snapshot.previous.rotation_y[i], snapshot.previous.rotation_z[i], snapshot.previous.rotation_w[i] };
+				const float q[4] = { snapshot.current.rotation_x[i], snapshot.current.rotation_y[i], snapshot.current.rotation_z[i], snapshot.current.rotation_w[i] };
+				const float got[4] = { out.rotation_x[i], out.rotation_y[i], out.rotation_z[i], out.rotation_w[i] };
+
+				double expected[4];
+				if (mode == EGL_INTERPOLATE_SLERP) {
+					slerp(p, q, alpha, expected);
+				} else {
+					double d = 0.0;
+					for (int a = 0; a < 4; a++) {
+						d += (double)p[a] * q[a];
+					}
+					const double sign = (mode == EGL_INTERPOLATE_NLERP && d < 0.0) ? -1.0 : 1.0;
+					double n = 0.0;
+					for (int a = 0; a < 4; a++) {
+						expected[a] = (1.0 - alpha) * p[a] + sign * alpha * (double)q[a];
+						n += expected[a] * expected[a];
+					}
+					for (int a = 0; a < 4 && mode == EGL_INTERPOLATE_NLERP; a++) {
+						expected[a] /= sqrt(n);
+					}
+				}
+
+				double error = 0.0;
+				for (int a = 0; a < 4; a++) {
+					error = fmax(error, fabs(expected[a] - got[a]));
+				}
+				if (error > 2e-5) {
+					EGL_DECLARE_ERROR("Mode %d, alpha %.1f: entity %u is off by %g.", mode, alpha, i, error);
+				}
+
+				const float tx = (1.0f - alpha) * snapshot.previous.translation_x[i] + alpha * snapshot.current.translation_x[i];
+				if (fabsf(out.translation_x[i] - tx) > 1e-6f || !(out.dirty[i >> 6] & ((uint64_t)1 << (i & 63)))) {
+					EGL_DECLARE_ERROR("Mode %d, alpha %.1f: entity %u translation or dirty bit is wrong.", mode, alpha, i);
+				}
+			}
+		}
+	}
+
+	EGL_SnapshotFree(&snapshot);
+	EGL_TransformBatchFree(&out);
+}
+
+/**
+ * Saving copies the current state, so an entity that stops moving renders still.
+ */
+static void EGL_SnapshotSaveTest(EGL_Test *T) {
+	EGL_DECLARE_TEST;
+
+	EGL_Snapshot snapshot;
+	EGL_TransformBatch out;
+	EGL_SnapshotInit(&snapshot, 5);
+	EGL_TransformBatchInit(&out, 5);
+
+	snapshot.current.translation_y[2] = 4.0f;
+	EGL_SnapshotSave(&snapshot);
+	EGL_SnapshotInterpolate(&snapshot, 0.25f, EGL_INTERPOLATE_SLERP, &out, 1);
+	if (out.translation_y[2] != 4.0f || out.rotation_w[2] != 1.0f) {
+		EGL_DECLARE_ERROR("Saved entity moved to %f.", out.translation_y[2]);
+	}
+
+	if (EGL_SnapshotAlpha(4000000, 16000000) != 0.25f || EGL_SnapshotAlpha(17000000, 16000000) != 1.0f) {
+		EGL_DECLARE_ERROR("Alpha of 4 ms into a 16 ms step is %f.", EGL_SnapshotAlpha(4000000, 16000000));
+	}
+
+	EGL_SnapshotFree(&snapshot);
+	EGL_TransformBatchFree(&out);
+}
+
+
+void EGL_SnapshotTest(EGL_TestModule *M) {
+	EGL_DECLARE_MODULE(EGL_snapshot);
+
+	EGL_RUN_TEST(EGL_SnapshotInterpolateTest);
+	EGL_RUN_TEST(EGL_SnapshotSaveTest);
+}
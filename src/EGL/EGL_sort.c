@@ -0,0 +1,165 @@
+#include <EGL/EGL_sort.h>
+#include <EGL/EGL_parallel.h>
+#include <EGL/EGL_memory.h>
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+#define RADIX 256
+#define DIGITS 8
+#define GRAIN 65536 // Minimum elements per thread before splitting is worthwhile.
+
+
+typedef struct {
+	uint64_t *src_keys;
+	uint32_t *src_values;
+	uint64_t *dst_keys;
+	uint32_t *dst_values;
+	size_t n;
+	int chunks;
+	int shift;
+	size_t hist[EGL_THREADS_MAX][RADIX];
+	size_t totals[EGL_THREADS_MAX][DIGITS][RADIX];
+} SortPass;
+
+
+/* Kernels loop over chunks so the partition is fixed even if fewer threads run */
+static void count_all_digits(void *data, int index, int count) {
+	SortPass *p = (SortPass *)data;
+
+	for (int c = index; c < p->chunks; c += count) {
+		size_t begin, end;
+		EGL_ParallelRange(p->n, c, p->chunks, &begin, &end);
+
+		size_t (*totals)[RADIX] = p->totals[c];
+		memset(totals, 0, sizeof(p->totals[c]));
+		for (size_t i = begin; i < end; i++) {
+			uint64_t key = p->src_keys[i];
+			for (int d = 0; d < DIGITS; d++) {
+				totals[d][(key >> (d * 8)) & 0xFF]++;
+			}
+		}
+	}
+}
+
+static void count_digit(void *data, int index, int count) {
+	SortPass *p = (SortPass *)data;
+
+	for (int c = index; c < p->chunks; c += count) {
+		size_t begin, end;
+		EGL_ParallelRange(p->n, c, p->chunks, &begin, &end);
+
+		size_t *hist = p->hist[c];
+		memset(hist, 0, sizeof(p->hist[c]));
+		for (size_t i = begin; i < end; i++) {
+			hist[(p->src_keys[i] >> p->shift) & 0xFF]++;
+		}
+	}
+}
+
+static void scatter_digit(void *data, int index, int count) {
+	SortPass *p = (SortPass *)data;
+
+	for (int c = index; c < p->chunks; c += count) {
+		size_t begin, end;
+		EGL_ParallelRange(p->n, c, p->chunks, &begin, &end);
+
+		size_t *offsets = p->hist[c];
+		if (p->src_values) {
+			for (size_t i = begin; i < end; i++) {
+				uint64_t key = p->src_keys[i];
+				size_t dst = offsets[(key >> p->shift) & 0xFF]++;
+				p->dst_keys[dst] = key;
+				p->dst_values[dst] = p->src_values[i];
+			}
+		} else {
+			for (size_t i = begin; i < end; i++) {
+				uint64_t key = p->src_keys[i];
+				p->dst_keys[offsets[(key >> p->shift) & 0xFF]++] = key;
+			}
+		}
+	}
+}
+
+
+size_t EGL_RadixSortScratchSize(void) {
+	return sizeof(SortPass);
+}
+
+bool EGL_RadixSort(uint64_t *keys, uint32_t *values, uint64_t *keys_tmp, uint32_t *values_tmp, size_t n, void *scratch) {
+	if (n < 2) {
+		return true;
+	}
+
+	/* Histograms are too large for the stack */
+	SortPass *p = scratch ? (SortPass *)scratch : (SortPass *)EGL_malloc(sizeof(SortPass));
+	if (!p) {
+		return false;
+	}
+
+	int threads = EGL_ThreadCount();
+	if ((size_t)threads > n / GRAIN + 1) {
+		threads = (int)(n / GRAIN + 1);
+	}
+
+	p->src_keys = keys;
+	p->src_values = values;
+	p->dst_keys = keys_tmp;
+	p->dst_values = values ? values_tmp : NULL;
+	p->n = n;
+	p->chunks = threads;
+
+	EGL_ParallelRun(count_all_digits, p, threads);
+
+	for (int d = 0; d < DIGITS; d++) {
+		/* Skip digits shared by every key */
+		bool trivial = false;
+		for (int b = 0; b < RADIX && !trivial; b++) {
+			size_t total = 0;
+			for (int t = 0; t < threads; t++) {
+				total += p->totals[t][d][b];
+			}
+			trivial = (total == n);
+		}
+		if (trivial) {
+			continue;
+		}
+
+		p->shift = d * 8;
+		EGL_ParallelRun(count_digit, p, threads);
+
+		/* Exclusive prefix sum in (digit, thread) order keeps the sort stable */
+		size_t sum = 0;
+		for (int b = 0; b < RADIX; b++) {
+			for (int t = 0; t < threads; t++) {
+				size_t c = p->hist[t][b];
+				p->hist[t][b] = sum;
+				sum += c;
+			}
+		}
+
+		EGL_ParallelRun(scatter_digit, p, threads);
+
+		uint64_t *k = p->src_keys;
+		p->src_keys = p->dst_keys;
+		p->dst_keys = k;
+
+		uint32_t *v = p->src_values;
+		p->src_values = p->dst_values;
+		p->dst_values = v;
+	}
+
+	if (p->src_keys != keys) {
+		memcpy(keys, p->src_keys, n * sizeof(*keys));
+		if (values) {
+			memcpy(values, p->src_values, n * sizeof(*values));
+		}
+	}
+
+	if (p != scratch) {
+		EGL_free(p);
+	}
+	return true;
+}
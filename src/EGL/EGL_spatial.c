@@ -0,0 +1,471 @@
+#include <EGL/EGL_spatial.h>
+#include <EGL/EGL_parallel.h>
+#include <EGL/EGL_memory.h>
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+#define PARALLEL_MIN 16384  // Entities below which bucketing runs on one thread.
+#define RADIUS_SLACK 1e-5f  // Widens cell radii to cover float rounding in cell lookup.
+
+
+typedef struct {
+	float bound; // Lower bound on the angle to anything in the cell.
+	uint32_t cell;
+} CellEntry;
+
+typedef struct {
+	EGL_SpatialIndex *index;
+	const float *x;
+	const float *y;
+	const float *z;
+	uint32_t count;
+} Bucket;
+
+
+/* Faces are +X, -X, +Y, -Y, +Z, -Z. Face axis a has tangent axes (a + 1) % 3 and (a + 2) % 3. */
+static inline uint32_t cell_of(uint32_t n, float x, float y, float z) {
+	float ax = fabsf(x);
+	float ay = fabsf(y);
+	float az = fabsf(z);
+	uint32_t face;
+	float m, u, v;
+
+	if (ax >= ay && ax >= az) {
+		face = 0 + (x < 0.0f);
+		m = ax; u = y; v = z;
+	} else if (ay >= az) {
+		face = 2 + (y < 0.0f);
+		m = ay; u = z; v = x;
+	} else {
+		face = 4 + (z < 0.0f);
+		m = az; u = x; v = y;
+	}
+
+	float scale = 0.5f * (float)n / m;
+	int i = (int)((u + m) * scale);
+	int j = (int)((v + m) * scale);
+	i = (i < 0) ? 0 : (i >= (int)n) ? (int)n - 1 : i;
+	j = (j < 0) ? 0 : (j >= (int)n) ? (int)n - 1 : j;
+
+	return (face * n + (uint32_t)j) * n + (uint32_t)i;
+}
+
+/* Unit direction of face coordinates (u, v), which may lie past the face edge. */
+static void face_point(uint32_t face, double u, double v, double out[3]) {
+	uint32_t a = face / 2;
+	out[a] = (face & 1) ? -1.0 : 1.0;
+	out[(a + 1) % 3] = u;
+	out[(a + 2) % 3] = v;
+
+	double inv = 1.0 / sqrt(out[0] * out[0] + out[1] * out[1] + out[2] * out[2]);
+	out[0] *= inv;
+	out[1] *= inv;
+	out[2] *= inv;
+}
+
+/* Rounding can push the dot product of unit vectors slightly past +-1. */
+static inline float acos_clamped(float d) {
+	return acosf((d > 1.0f) ? 1.0f : (d < -1.0f) ? -1.0f : d);
+}
+
+static inline float angle_between(const float *a, const float *b) {
+	return acos_clamped(a[0] * b[0] + a[1] * b[1] + a[2] * b[2]);
+}
+
+static inline void normalize(const float p[3], float out[3]) {
+	float inv = 1.0f / sqrtf(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+	out[0] = p[0] * inv;
+	out[1] = p[1] * inv;
+	out[2] = p[2] * inv;
+}
+
+static uint32_t next_generation(EGL_SpatialScratch *s) {
+	if (++s->generation == 0) {
+		memset(s->stamp, 0, sizeof(uint32_t) * s->cell_count);
+		s->generation = 1;
+	}
+	return s->generation;
+}
+
+static void cell_push(CellEntry *heap, size_t *size, CellEntry entry) {
+	size_t i = (*size)++;
+	while (i > 0) {
+		size_t parent = (i - 1) / 2;
+		if (heap[parent].bound <= entry.bound) {
+			break;
+		}
+		heap[i] = heap[parent];
+		i = parent;
+	}
+	heap[i] = entry;
+}
+
+static CellEntry cell_pop(CellEntry *heap, size_t *size) {
+	CellEntry top = heap[0];
+	CellEntry last = heap[--(*size)];
+	size_t i = 0;
+	for (;;) {
+		size_t child = i * 2 + 1;
+		if (child >= *size) {
+			break;
+		}
+		if (child + 1 < *size && heap[child + 1].bound < heap[child].bound) {
+			child++;
+		}
+		if (last.bound <= heap[child].bound) {
+			break;
+		}
+		heap[i] = heap[child];
+		i = child;
+	}
+	heap[i] = last;
+	return top;
+}
+
+/* Neighbor a is worse than b: farther, or as far with a higher id. */
+static inline bool worse(float dot_a, uint32_t id_a, float dot_b, uint32_t id_b) {
+	return dot_a < dot_b || (dot_a == dot_b && id_a > id_b);
+}
+
+/* Restore the worst-on-top heap of neighbors below slot i. */
+static void result_sift(float *dots, uint32_t *ids, uint32_t i, uint32_t size) {
+	float dot = dots[i];
+	uint32_t id = ids[i];
+	for (;;) {
+		uint32_t child = i * 2 + 1;
+		if (child >= size) {
+			break;
+		}
+		if (child + 1 < size && worse(dots[child + 1], ids[child + 1], dots[child], ids[child])) {
+			child++;
+		}
+		if (!worse(dots[child], ids[child], dot, id)) {
+			break;
+		}
+		dots[i] = dots[child];
+		ids[i] = ids[child];
+		i = child;
+	}
+	dots[i] = dot;
+	ids[i] = id;
+}
+
+static void result_push(float *dots, uint32_t *ids, uint32_t *size, float dot, uint32_t id) {
+	uint32_t i = (*size)++;
+	while (i > 0) {
+		uint32_t parent = (i - 1) / 2;
+		if (!worse(dot, id, dots[parent], ids[parent])) {
+			break;
+		}
+		dots[i] = dots[parent];
+		ids[i] = ids[parent];
+		i = parent;
+	}
+	dots[i] = dot;
+	ids[i] = id;
+}
+
+static void bucket_kernel(void *data, int index, int count) {
+	Bucket *b = (Bucket *)data;
+	size_t begin, end;
+	EGL_ParallelRange(b->count, index, count, &begin, &end);
+
+	const uint32_t n = b->index->resolution;
+	uint32_t *entity_cell = b->index->entity_cell;
+	for (size_t i = begin; i < end; i++) {
+		entity_cell[i] = cell_of(n, b->x[i], b->y[i], b->z[i]);
+	}
+}
+
+static bool reserve(EGL_SpatialIndex *index, uint32_t count) {
+	if (count <= index->capacity) {
+		return true;
+	}
+
+	float **floats[3] = { &index->x, &index->y, &index->z };
+	for (int i = 0; i < 3; i++) {
+		float *p = (float *)EGL_realloc(*floats[i], sizeof(float) * count);
+		if (!p) {
+			return false;
+		}
+		*floats[i] = p;
+	}
+	uint32_t **uints[2] = { &index->ids, &index->entity_cell };
+	for (int i = 0; i < 2; i++) {
+		uint32_t *p = (uint32_t *)EGL_realloc(*uints[i], sizeof(uint32_t) * count);
+		if (!p) {
+			return false;
+		}
+		*uints[i] = p;
+	}
+
+	index->capacity = count;
+	return true;
+}
+
+
+bool EGL_SpatialIndexInit(EGL_SpatialIndex *index, uint32_t resolution) {
+	memset(index, 0, sizeof(*index));
+	if (resolution < 1 || resolution > EGL_SPATIAL_RESOLUTION_MAX) {
+		return false;
+	}
+
+	const uint32_t n = resolution;
+	index->resolution = n;
+	index->cell_count = 6 * n * n;
+	index->cell_start = (uint32_t *)EGL_calloc((size_t)index->cell_count + 1, sizeof(uint32_t));
+	index->cell_center = (float *)EGL_malloc(sizeof(float) * 3 * index->cell_count);
+	index->cell_radius = (float *)EGL_malloc(sizeof(float) * index->cell_count);
+	index->cell_neighbors = (uint32_t *)EGL_malloc(sizeof(uint32_t) * 8 * index->cell_count);
+	if (!index->cell_start || !index->cell_center || !index->cell_radius || !index->cell_neighbors) {
+		EGL_SpatialIndexFree(index);
+		return false;
+	}
+
+	const double h = 2.0 / (double)n;
+	const double probe = 0.55 * h; // Just past the cell edge, well short of the next one.
+	for (uint32_t face = 0; face < 6; face++) {
+		for (uint32_t j = 0; j < n; j++) {
+			for (uint32_t i = 0; i < n; i++) {
+				uint32_t cell = (face * n + j) * n + i;
+				double u = -1.0 + ((double)i + 0.5) * h;
+				double v = -1.0 + ((double)j + 0.5) * h;
+				double center[3];
+				face_point(face, u, v, center);
+
+				/* Cells are spherical quadrilaterals, so the farthest point is a corner */
+				double radius = 0.0;
+				for (int c = 0; c < 4; c++) {
+					double corner[3];
+					face_point(face, u + ((c & 1) ? 0.5 : -0.5) * h, v + ((c & 2) ? 0.5 : -0.5) * h, corner);
+					double d = center[0] * corner[0] + center[1] * corner[1] + center[2] * corner[2];
+					double angle = acos((d > 1.0) ? 1.0 : d);
+					radius = (angle > radius) ? angle : radius;
+				}
+
+				index->cell_center[cell * 3 + 0] = (float)center[0];
+				index->cell_center[cell * 3 + 1] = (float)center[1];
+				index->cell_center[cell * 3 + 2] = (float)center[2];
+				index->cell_radius[cell] = (float)radius + RADIUS_SLACK;
+
+				/* Probe past each edge and corner; across a face edge this lands on the next face */
+				uint32_t *neighbors = index->cell_neighbors + (size_t)cell * 8;
+				uint32_t found = 0;
+				for (int dj = -1; dj <= 1; dj++) {
+					for (int di = -1; di <= 1; di++) {
+						if (di == 0 && dj == 0) {
+							continue;
+						}
+						double p[3];
+						face_point(face, u + di * probe, v + dj * probe, p);
+						uint32_t other = cell_of(n, (float)p[0], (float)p[1], (float)p[2]);
+						bool seen = (other == cell);
+						for (uint32_t k = 0; k < found; k++) {
+							seen |= (neighbors[k] == other);
+						}
+						if (!seen) {
+							neighbors[found++] = other;
+						}
+					}
+				}
+				while (found < 8) {
+					neighbors[found++] = EGL_SPATIAL_NONE;
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+void EGL_SpatialIndexFree(EGL_SpatialIndex *index) {
+	EGL_free(index->cell_start);
+	EGL_free(index->cell_center);
+	EGL_free(index->cell_radius);
+	EGL_free(index->cell_neighbors);
+	EGL_free(index->x);
+	EGL_free(index->y);
+	EGL_free(index->z);
+	EGL_free(index->ids);
+	EGL_free(index->entity_cell);
+	memset(index, 0, sizeof(*index));
+}
+
+uint32_t EGL_SpatialIndexCell(const EGL_SpatialIndex *index, const float p[3]) {
+	return cell_of(index->resolution, p[0], p[1], p[2]);
+}
+
+bool EGL_SpatialIndexBuild(EGL_SpatialIndex *index, const float *x, const float *y, const float *z, uint32_t count, int threads) {
+	if (!reserve(index, count)) {
+		return false;
+	}
+	index->count = count;
+
+	Bucket bucket = { .index = index, .x = x, .y = y, .z = z, .count = count };
+	EGL_ParallelRun(bucket_kernel, &bucket, (count < PARALLEL_MIN) ? 1 : threads);
+
+	/* Counting sort: histogram, exclusive prefix sum, stable scatter */
+	uint32_t *start = index->cell_start;
+	memset(start, 0, sizeof(uint32_t) * ((size_t)index->cell_count + 1));
+	for (uint32_t i = 0; i < count; i++) {
+		start[index->entity_cell[i]]++;
+	}
+	uint32_t sum = 0;
+	for (uint32_t c = 0; c < index->cell_count; c++) {
+		uint32_t cell_size = start[c];
+		start[c] = sum;
+		sum += cell_size;
+	}
+
+	for (uint32_t i = 0; i < count; i++) {
+		uint32_t slot = start[index->entity_cell[i]]++;
+		float inv = 1.0f / sqrtf(x[i] * x[i] + y[i] * y[i] + z[i] * z[i]);
+		index->x[slot] = x[i] * inv;
+		index->y[slot] = y[i] * inv;
+		index->z[slot] = z[i] * inv;
+		index->ids[slot] = i;
+	}
+
+	/* Scattering advanced every start to the next cell's start */
+	memmove(start + 1, start, sizeof(uint32_t) * index->cell_count);
+	start[0] = 0;
+
+	return true;
+}
+
+bool EGL_SpatialScratchInit(EGL_SpatialScratch *scratch, const EGL_SpatialIndex *index) {
+	scratch->cell_count = index->cell_count;
+	scratch->generation = 0;
+	scratch->stamp = (uint32_t *)EGL_calloc(index->cell_count, sizeof(uint32_t));
+	scratch->queue = (uint32_t *)EGL_malloc(sizeof(uint32_t) * index->cell_count);
+	scratch->heap = EGL_malloc(sizeof(CellEntry) * index->cell_count);
+
+	if (!scratch->stamp || !scratch->queue || !scratch->heap) {
+		EGL_SpatialScratchFree(scratch);
+		return false;
+	}
+	return true;
+}
+
+void EGL_SpatialScratchFree(EGL_SpatialScratch *scratch) {
+	EGL_free(scratch->stamp);
+	EGL_free(scratch->queue);
+	EGL_free(scratch->heap);
+	memset(scratch, 0, sizeof(*scratch));
+}
+
+uint32_t EGL_SpatialIndexRadius(const EGL_SpatialIndex *index, EGL_SpatialScratch *scratch, const float p[3], float radius, uint32_t *out, uint32_t out_max) {
+	float q[3];
+	normalize(p, q);
+	const float cos_radius = cosf(radius);
+	const uint32_t generation = next_generation(scratch);
+	uint32_t *stamp = scratch->stamp;
+	uint32_t *queue = scratch->queue;
+
+	uint32_t head = 0;
+	uint32_t tail = 0;
+	uint32_t found = 0;
+
+	uint32_t start = cell_of(index->resolution, q[0], q[1], q[2]);
+	stamp[start] = generation;
+	queue[tail++] = start;
+
+	while (head < tail) {
+		uint32_t cell = queue[head++];
+
+		for (uint32_t s = index->cell_start[cell]; s < index->cell_start[cell + 1]; s++) {
+			float d = index->x[s] * q[0] + index->y[s] * q[1] + index->z[s] * q[2];
+			if (d >= cos_radius) {
+				if (found < out_max) {
+					out[found] = index->ids[s];
+				}
+				found++;
+			}
+		}
+
+		const uint32_t *neighbors = index->cell_neighbors + (size_t)cell * 8;
+		for (int k = 0; k < 8 && neighbors[k] != EGL_SPATIAL_NONE; k++) {
+			uint32_t other = neighbors[k];
+			if (stamp[other] == generation) {
+				continue;
+			}
+			stamp[other] = generation;
+			if (angle_between(q, index->cell_center + (size_t)other * 3) - index->cell_radius[other] <= radius) {
+				queue[tail++] = other;
+			}
+		}
+	}
+
+	return found;
+}
+
+uint32_t EGL_SpatialIndexNearest(const EGL_SpatialIndex *index, EGL_SpatialScratch *scratch, const float p[3], uint32_t k, uint32_t *out, float *angles) {
+	if (k == 0 || index->count == 0) {
+		return 0;
+	}
+
+	float q[3];
+	normalize(p, q);
+	const uint32_t generation = next_generation(scratch);
+	uint32_t *stamp = scratch->stamp;
+	CellEntry *heap = (CellEntry *)scratch->heap;
+	size_t heap_size = 0;
+
+	/* Neighbors so far in a worst-on-top heap; angles holds their dot products until the end */
+	float *dots = angles;
+	uint32_t found = 0;
+
+	uint32_t start = cell_of(index->resolution, q[0], q[1], q[2]);
+	stamp[start] = generation;
+	cell_push(heap, &heap_size, (CellEntry){ 0.0f, start });
+
+	while (heap_size > 0) {
+		CellEntry top = cell_pop(heap, &heap_size);
+		if (found == k && top.bound > acos_clamped(dots[0])) {
+			break;
+		}
+
+		uint32_t cell = top.cell;
+		for (uint32_t s = index->cell_start[cell]; s < index->cell_start[cell + 1]; s++) {
+			float d = index->x[s] * q[0] + index->y[s] * q[1] + index->z[s] * q[2];
+			uint32_t id = index->ids[s];
+			if (found < k) {
+				result_push(dots, out, &found, d, id);
+			} else if (worse(dots[0], out[0], d, id)) {
+				dots[0] = d;
+				out[0] = id;
+				result_sift(dots, out, 0, found);
+			}
+		}
+
+		const uint32_t *neighbors = index->cell_neighbors + (size_t)cell * 8;
+		for (int n = 0; n < 8 && neighbors[n] != EGL_SPATIAL_NONE; n++) {
+			uint32_t other = neighbors[n];
+			if (stamp[other] == generation) {
+				continue;
+			}
+			stamp[other] = generation;
+			float bound = angle_between(q, index->cell_center + (size_t)other * 3) - index->cell_radius[other];
+			cell_push(heap, &heap_size, (CellEntry){ (bound > 0.0f) ? bound : 0.0f, other });
+		}
+	}
+
+	/* Heap sort: moving the worst to the back leaves the nearest first */
+	for (uint32_t size = found; size > 1; size--) {
+		float d = dots[0];
+		uint32_t id = out[0];
+		dots[0] = dots[size - 1];
+		out[0] = out[size - 1];
+		dots[size - 1] = d;
+		out[size - 1] = id;
+		result_sift(dots, out, 0, size - 1);
+	}
+	for (uint32_t i = 0; i < found; i++) {
+		angles[i] = acos_clamped(dots[i]);
+	}
+
+	return found;
+}
@@ -0,0 +1,133 @@
+#include <EGL/EGL_bench.h>
+#include <EGL/EGL_parallel.h>
+#include <EGL/EGL_spatial.h>
+
+#include <math.h>
+#include <stdlib.h>
+
+
+#define QUERIES 10000
+#define PER_CELL 8    // Target entities per cell when picking the resolution.
+#define IN_RANGE 32   // Target entities per radius query.
+#define K 8
+
+
+static uint32_t lcg(uint32_t *state) {
+	*state = *state * 1664525u + 1013904223u;
+	return *state >> 8;
+}
+
+/* Uniform points on the unit sphere (normalized gaussian-free cube rejection). */
+static void random_points(uint32_t *state, uint32_t count, float *x, float *y, float *z) {
+	for (uint32_t i = 0; i < count; i++) {
+		float p[3], r2;
+		do {
+			p[0] = (float)lcg(state) / 8388608.0f - 1.0f;
+			p[1] = (float)lcg(state) / 8388608.0f - 1.0f;
+			p[2] = (float)lcg(state) / 8388608.0f - 1.0f;
+			r2 = p[0] * p[0] + p[1] * p[1] + p[2] * p[2];
+		} while (r2 < 0.01f || r2 > 1.0f);
+		float inv = 1.0f / sqrtf(r2);
+		x[i] = p[0] * inv;
+		y[i] = p[1] * inv;
+		z[i] = p[2] * inv;
+	}
+}
+
+
+void EGL_SpatialBench(void) {
+	EGL_DECLARE_BENCH(EGL_spatial);
+
+	const uint32_t counts[] = { 10000, 100000, 1000000 };
+	char label[64];
+	uint32_t state = 2024;
+
+	float *queries = (float *)malloc(sizeof(float) * QUERIES * 3);
+	random_points(&state, QUERIES, queries, queries + QUERIES, queries + QUERIES * 2);
+
+	for (int c = 0; c < 3; c++) {
+		const uint32_t count = counts[c];
+		float *x = (float *)malloc(sizeof(float) * count * 3);
+		float *y = x + count;
+		float *z = y + count;
+		uint32_t *found = (uint32_t *)malloc(sizeof(uint32_t) * count);
+		random_points(&state, count, x, y, z);
+
+		uint32_t resolution = (uint32_t)sqrtf((float)count / (6.0f * PER_CELL));
+		resolution = (resolution < 1) ? 1 : resolution;
+		EGL_SpatialIndex index;
+		EGL_SpatialScratch scratch;
+		EGL_SpatialIndexInit(&index, resolution);
+		EGL_SpatialScratchInit(&scratch, &index);
+
+		double best = 1e30;
+		for (int r = 0; r < EGL_BENCH_REPEATS; r++) {
+			double begin = EGL_BenchNow();
+			EGL_SpatialIndexBuild(&index, x, y, z, count, EGL_ThreadCount());
+			double elapsed = EGL_BenchNow() - begin;
+			best = (elapsed < best) ? elapsed : best;
+		}
+		snprintf(label, sizeof(label), "rebuild %u entities (N = %u)", count, resolution);
+		EGL_BenchReport(label, best, (double)count, "entity");
+
+		/* Cap area fraction (1 - cos r) / 2 holds IN_RANGE entities on average */
+		const float radius = acosf(1.0f - 2.0f * (float)IN_RANGE / (float)count);
+		uint64_t hits = 0;
+		best = 1e30;
+		for (int r = 0; r < EGL_BENCH_REPEATS; r++) {
+			hits = 0;
+			double begin = EGL_BenchNow();
+			for (uint32_t q = 0; q < QUERIES; q++) {
+				float p[3] = { queries[q], queries[QUERIES + q], queries[QUERIES * 2 + q] };
+				hits += EGL_SpatialIndexRadius(&index, &scratch, p, radius, found, count);
+			}
+			double elapsed = EGL_BenchNow() - begin;
+			best = (elapsed < best) ? elapsed : best;
+		}
+		EGL_BENCH_SINK += hits;
+		snprintf(label, sizeof(label), "radius query %u entities (~%d hits)", count, IN_RANGE);
+		EGL_BenchReport(label, best, (double)QUERIES, "query");
+
+		if (count <= 10000) {
+			const float cos_radius = cosf(radius);
+			best = 1e30;
+			for (int r = 0; r < EGL_BENCH_REPEATS; r++) {
+				hits = 0;
+				double begin = EGL_BenchNow();
+				for (uint32_t q = 0; q < QUERIES; q++) {
+					for (uint32_t i = 0; i < count; i++) {
+						hits += (x[i] * queries[q] + y[i] * queries[QUERIES + q] + z[i] * queries[QUERIES * 2 + q] >= cos_radius);
+					}
+				}
+				double elapsed = EGL_BenchNow() - begin;
+				best = (elapsed < best) ? elapsed : best;
+			}
+			EGL_BENCH_SINK += hits;
+			snprintf(label, sizeof(label), "brute force radius %u entities", count);
+			EGL_BenchReport(label, best, (double)QUERIES, "query");
+		}
+
+		uint32_t ids[K];
+		float angles[K];
+		best = 1e30;
+		for (int r = 0; r < EGL_BENCH_REPEATS; r++) {
+			double begin = EGL_BenchNow();
+			for (uint32_t q = 0; q < QUERIES; q++) {
+				float p[3] = { queries[q], queries[QUERIES + q], queries[QUERIES * 2 + q] };
+				EGL_SpatialIndexNearest(&index, &scratch, p, K, ids, angles);
+				EGL_BENCH_SINK += ids[0];
+			}
+			double elapsed = EGL_BenchNow() - begin;
+			best = (elapsed < best) ? elapsed : best;
+		}
+		snprintf(label, sizeof(label), "%d-nearest query %u entities", K, count);
+		EGL_BenchReport(label, best, (double)QUERIES, "query");
+
+		EGL_SpatialScratchFree(&scratch);
+		EGL_SpatialIndexFree(&index);
+		free(found);
+		free(x);
+	}
+
+	free(queries);
+}
@@ -0,0 +1,240 @@
+#include <EGL/EGL_testing.h>
+#include <math.h>
+#include <stdlib.h>
+
+
+#define COUNT 5000
+#define RESOLUTION 8
+#define QUERIES 200
+#define K 16
+
+
+/* Random positions on a sphere of radius 10, plus a few on cube edges and corners. */
+static void random_points(uint32_t seed, uint32_t count, float *x, float *y, float *z) {
+	uint32_t state[4] = {0,0,0,0};
+	EGL_Seed(state, seed);
+	for (uint32_t i = 0; i < count; i++) {
+		float p[3];
+		float r2;
+		do {
+			p[0] = 2.0f * EGL_RandFloat(state) - 1.0f;
+			p[1] = 2.0f * EGL_RandFloat(state) - 1.0f;
+			p[2] = 2.0f * EGL_RandFloat(state) - 1.0f;
+			r2 = p[0] * p[0] + p[1] * p[1] + p[2] * p[2];
+		} while (r2 < 0.01f || r2 > 1.0f);
+		if (i % 50 == 0) {
+			p[0] = (p[0] < 0.0f) ? -1.0f : 1.0f;
+			p[1] = (p[1] < 0.0f) ? -1.0f : 1.0f;
+			p[2] = (i % 100 == 0) ? p[2] : ((p[2] < 0.0f) ? -1.0f : 1.0f);
+			r2 = p[0] * p[0] + p[1] * p[1] + p[2] * p[2];
+		}
+		float scale = 10.0f / sqrtf(r2);
+		x[i] = p[0] * scale;
+		y[i] = p[1] * scale;
+		z[i] = p[2] * scale;
+	}
+}
+
+static int compare_ids(const void *a, const void *b) {
+	uint32_t x = *(const uint32_t *)a;
+	uint32_t y = *(const uint32_t *)b;
+	return (x > y) - (x < y);
+}
+
+/* Dot product of the query with an indexed entity, as the index computes it. */
+static float slot_dot(const EGL_SpatialIndex *index, uint32_t s, const float q[3]) {
+	return index->x[s] * q[0] + index->y[s] * q[1] + index->z[s] * q[2];
+}
+
+static void normalize(float p[3]) {
+	float inv = 1.0f / sqrtf(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+	p[0] *= inv;
+	p[1] *= inv;
+	p[2] *= inv;
+}
+
+
+/**
+ * Every entity lies within its cell's bounding cap and cell neighbors are
+ * mutual, including across cube face edges and corners.
+ */
+static void EGL_SpatialCellTest(EGL_Test *T) {
+	EGL_DECLARE_TEST;
+
+	float *x = (float *)malloc(sizeof(float) * COUNT * 3);
+	float *y = x + COUNT;
+	float *z = y + COUNT;
+	EGL_SpatialIndex index;
+	random_points(1, COUNT, x, y, z);
+	if (!EGL_SpatialIndexInit(&index, RESOLUTION) || !EGL_SpatialIndexBuild(&index, x, y, z, COUNT, 4)) {
+		EGL_DECLARE_ERROR("Failed to build a resolution %d index.", RESOLUTION);
+		free(x);
+		return;
+	}
+
+	if (index.cell_start[index.cell_count] != COUNT) {
+		EGL_DECLARE_ERROR("Cells hold %u entities, expected %d.", index.cell_start[index.cell_count], COUNT);
+	}
+
+	for (uint32_t c = 0; c < index.cell_count && T->error_count < ERRORS_MAX - 1; c++) {
+		const float *center = index.cell_center + c * 3;
+		for (uint32_t s = index.cell_start[c]; s < index.cell_start[c + 1]; s++) {
+			float d = index.x[s] * center[0] + index.y[s] * center[1] + index.z[s] * center[2];
+			if (acosf(fminf(d, 1.0f)) > index.cell_radius[c]) {
+				EGL_DECLARE_ERROR("Entity %u lies outside the cap of cell %u.", index.ids[s], c);
+			}
+		}
+
+		int degree = 0;
+		for (int k = 0; k < 8; k++) {
+			uint32_t other = index.cell_neighbors[c * 8 + k];
+			if (other == EGL_SPATIAL_NONE) {
+				continue;
+			}
+			degree++;
+			bool mutual = false;
+			for (int m = 0; m < 8; m++) {
+				mutual |= (index.cell_neighbors[other * 8 + m] == c);
+			}
+			if (!mutual) {
+				EGL_DECLARE_ERROR("Cells %u and %u are not mutual neighbors.", c, other);
+			}
+		}
+		if (degree < 7) {
+			EGL_DECLARE_ERROR("Cell %u has only %d neighbors.", c, degree);
+		}
+	}
+
+	EGL_SpatialIndexFree(&index);
+	free(x);
+}
+
+/**
+ * Radius queries find exactly the entities a brute force scan finds, for
+ * radii from a fraction of a cell to more than a hemisphere.
+ */
+static void EGL_SpatialRadiusTest(EGL_Test *T) {
+	EGL_DECLARE_TEST;
+
+	float *x = (float *)malloc(sizeof(float) * COUNT * 3);
+	float *y = x + COUNT;
+	float *z = y + COUNT;
+	uint32_t *found = (uint32_t *)malloc(sizeof(uint32_t) * COUNT);
+	uint32_t *expected = (uint32_t *)malloc(sizeof(uint32_t) * COUNT);
+	float *queries = (float *)malloc(sizeof(float) * QUERIES * 3);
+	EGL_SpatialIndex index;
+	EGL_SpatialScratch scratch;
+
+	random_points(2, COUNT, x, y, z);
+	random_points(3, QUERIES, queries, queries + QUERIES, queries + QUERIES * 2);
+	EGL_SpatialIndexInit(&index, RESOLUTION);
+	EGL_SpatialIndexBuild(&index, x, y, z, COUNT, 4);
+	EGL_SpatialScratchInit(&scratch, &index);
+
+	const float radii[] = { 0.01f, 0.1f, 0.3f, 1.0f, 2.0f };
+	for (int r = 0; r < 5; r++) {
+		for (uint32_t i = 0; i < QUERIES && T->error_count < ERRORS_MAX - 1; i++) {
+			float p[3] = { queries[i], queries[QUERIES + i], queries[QUERIES * 2 + i] };
+			uint32_t count = EGL_SpatialIndexRadius(&index, &scratch, p, radii[r], found, COUNT);
+
+			normalize(p);
+			float cos_radius = cosf(radii[r]);
+			uint32_t expected_count = 0;
+			for (uint32_t s = 0; s < COUNT; s++) {
+				if (slot_dot(&index, s, p) >= cos_radius) {
+					expected[expected_count++] = index.ids[s];
+				}
+			}
+
+			qsort(found, count, sizeof(uint32_t), compare_ids);
+			qsort(expected, expected_count, sizeof(uint32_t), compare_ids);
+			if (count != expected_count || memcmp(found, expected, sizeof(uint32_t) * count) != 0) {
+				EGL_DECLARE_ERROR("Query %u radius %.2f found %u entities, expected %u.", i, radii[r], count, expected_count);
+			}
+		}
+	}
+
+	EGL_SpatialScratchFree(&scratch);
+	EGL_SpatialIndexFree(&index);
+	free(queries);
+	free(expected);
+	free(found);
+	free(x);
+}
+
+/**
+ * Nearest neighbor queries return the same entities in the same order as a
+ * brute force scan (nearest first, lowest id on ties).
+ */
+static void EGL_SpatialNearestTest(EGL_Test *T) {
+	EGL_DECLARE_TEST;
+
+	float *x = (float *)malloc(sizeof(float) * COUNT * 3);
+	float *y = x + COUNT;
+	float *z = y + COUNT;
+	float *queries = (float *)malloc(sizeof(float) * QUERIES * 3);
+	EGL_SpatialIndex index;
+	EGL_SpatialScratch scratch;
+
+	random_points(4, COUNT, x, y, z);
+	random_points(5, QUERIES, queries, queries + QUERIES, queries + QUERIES * 2);
+	EGL_SpatialIndexInit(&index, RESOLUTION);
+	EGL_SpatialIndexBuild(&index, x, y, z, COUNT, 4);
+	EGL_SpatialScratchInit(&scratch, &index);
+
+	for (uint32_t i = 0; i < QUERIES && T->error_count < ERRORS_MAX - 1; i++) {
+		float p[3] = { queries[i], queries[QUERIES + i], queries[QUERIES * 2 + i] };
+		uint32_t ids[K];
+		float angles[K];
+		uint32_t count = EGL_SpatialIndexNearest(&index, &scratch, p, K, ids, angles);
+		if (count != K) {
+			EGL_DECLARE_ERROR("Query %u found %u neighbors, expected %d.", i, count, K);
+			continue;
+		}
+
+		/* Selection by (dot descending, id ascending) over every slot */
+		normalize(p);
+		uint32_t expected[K];
+		float expected_dot[K];
+		for (int k = 0; k < K; k++) {
+			float best_dot = -2.0f;
+			uint32_t best_id = UINT32_MAX;
+			for (uint32_t s = 0; s < COUNT; s++) {
+				float d = slot_dot(&index, s, p);
+				uint32_t id = index.ids[s];
+				bool taken = (k > 0) && (d > expected_dot[k - 1] || (d == expected_dot[k - 1] && id <= expected[k - 1]));
+				if (!taken && (d > best_dot || (d == best_dot && id < best_id))) {
+					best_dot = d;
+					best_id = id;
+				}
+			}
+			expected[k] = best_id;
+			expected_dot[k] = best_dot;
+		}
+
+		for (int k = 0; k < K; k++) {
+			if (ids[k] != expected[k]) {
+				EGL_DECLARE_ERROR("Query %u neighbor %d is %u, expected %u.", i, k, ids[k], expected[k]);
+				break;
+			}
+			if (k > 0 && angles[k] < angles[k - 1]) {
+				EGL_DECLARE_ERROR("Query %u neighbors are not sorted by angle.", i);
+				break;
+			}
+		}
+	}
+
+	EGL_SpatialScratchFree(&scratch);
+	EGL_SpatialIndexFree(&index);
+	free(queries);
+	free(x);
+}
+
+
+void EGL_SpatialTest(EGL_TestModule *M) {
+	EGL_DECLARE_MODULE(EGL_spatial);
+
+	EGL_RUN_TEST(EGL_SpatialCellTest);
+	EGL_RUN_TEST(EGL_SpatialRadiusTest);
+	EGL_RUN_TEST(EGL_SpatialNearestTest);
+}
@@ -0,0 +1,100 @@
+#include <EGL/EGL_staging.h>
+#include <EGL/EGL_memory.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+
+static EGL_StagingCopy *record(EGL_StagingRing *r, void *target, const void *data, uint32_t size) {
+	if (r->copy_count == r->copies_max) {
+		r->fails++;
+		return NULL;
+	}
+	uint32_t offset;
+	void *space = EGL_StagingAlloc(r, size, &offset);
+	if (!space) {
+		return NULL;
+	}
+	memcpy(space, data, size);
+	EGL_StagingCopy *c = &r->copies[r->copy_count++];
+	*c = (EGL_StagingCopy){ .target = target, .offset = offset, .size = size };
+	return c;
+}
+
+
+bool EGL_StagingInit(EGL_StagingRing *r, uint32_t capacity, uint32_t copies_max) {
+	memset(r, 0, sizeof(*r));
+	r->copies = (EGL_StagingCopy *)EGL_malloc((size_t)copies_max * sizeof(EGL_StagingCopy));
+	if (!r->copies) {
+		return false;
+	}
+	r->capacity = capacity;
+	r->copies_max = copies_max;
+	return true;
+}
+
+void EGL_StagingFree(EGL_StagingRing *r) {
+	EGL_free(r->copies);
+	memset(r, 0, sizeof(*r));
+}
+
+void *EGL_StagingAlloc(EGL_StagingRing *r, uint32_t size, uint32_t *offset) {
+	if (!r->memory || size > r->capacity) {
+		r->fails++;
+		return NULL;
+	}
+
+	/* Never split an upload across the end: skip to the start instead */
+	uint64_t start = (r->head + EGL_STAGING_ALIGN - 1) & ~(uint64_t)(EGL_STAGING_ALIGN - 1);
+	const uint64_t at = start % r->capacity;
+	if (at + size > r->capacity) {
+		start += r->capacity - at;
+	}
+	if (start + size - r->tail > r->capacity) {
+		r->fails++;
+		return NULL; // Would overwrite bytes the GPU may still be reading
+	}
+	r->head = start + size;
+	r->bytes += size;
+	*offset = (uint32_t)(start % r->capacity);
+	return r->memory + *offset;
+}
+
+bool EGL_StagingBuffer(EGL_StagingRing *r, void *buffer, uint32_t buffer_offset, const void *data, uint32_t size) {
+	EGL_StagingCopy *c = record(r, buffer, data, size);
+	if (!c) {
+		return false;
+	}
+	c->target_offset = buffer_offset;
+	return true;
+}
+
+bool EGL_StagingTexture(EGL_StagingRing *r, void *texture, uint32_t level, uint32_t width, uint32_t height, const void *data, uint32_t size) {
+	EGL_StagingCopy *c = record(r, texture, data, size);
+	if (!c) {
+		return false;
+	}
+	c->texture = true;
+	c->level = level;
+	c->width = width;
+	c->height = height;
+	return true;
+}
+
+bool EGL_StagingEndFrame(EGL_StagingRing *r) {
+	if (EGL_StagingInFlight(r) == EGL_STAGING_FRAMES) {
+		return false;
+	}
+	r->frame_ends[r->frames % EGL_STAGING_FRAMES] = r->head;
+	r->frames++;
+	r->copy_count = 0;
+	return true;
+}
+
+void EGL_StagingRetire(EGL_StagingRing *r) {
+	if (r->retired == r->frames) {
+		return;
+	}
+	r->tail = r->frame_ends[r->retired % EGL_STAGING_FRAMES];
+	r->retired++;
+}
@@ -0,0 +1,93 @@
+#include <EGL/EGL_bench.h>
+#include <EGL/EGL_staging.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+
+#define RING_BYTES (8u << 20)
+#define FRAMES 2000
+#define FRAME_UPLOADS 32       // Uploads per frame, of 64 bytes to UPLOAD_BYTES_MAX.
+#define UPLOAD_BYTES_MAX 16384
+#define LAG 2                  // Frames the GPU runs behind.
+
+
+static uint32_t lcg(uint32_t *state) {
+	*state = *state * 1664525u + 1013904223u;
+	return *state >> 8;
+}
+
+
+/* Only the ring's bookkeeping: take the space, copy nothing */
+static void frame_alloc(EGL_StagingRing *r, uint32_t *state) {
+	for (int i = 0; i < FRAME_UPLOADS; i++) {
+		const uint32_t size = 64 + lcg(state) % (UPLOAD_BYTES_MAX - 64);
+		uint32_t offset = 0;
+		while (!EGL_StagingAlloc(r, size, &offset) && EGL_StagingInFlight(r) > 0) {
+			EGL_StagingRetire(r);
+		}
+		EGL_BENCH_SINK += offset;
+	}
+	while (EGL_StagingInFlight(r) >= LAG) {
+		EGL_StagingRetire(r);
+	}
+	EGL_StagingEndFrame(r);
+}
+
+static void frame_ring(EGL_StagingRing *r, const uint8_t *data, uint32_t *state) {
+	for (int i = 0; i < FRAME_UPLOADS; i++) {
+		const uint32_t size = 64 + lcg(state) % (UPLOAD_BYTES_MAX - 64);
+		while (!EGL_StagingBuffer(r, NULL, 0, data, size) && EGL_StagingInFlight(r) > 0) {
+			EGL_StagingRetire(r);
+		}
+	}
+	EGL_BENCH_SINK += r->copy_count;
+	while (EGL_StagingInFlight(r) >= LAG) {
+		EGL_StagingRetire(r);
+	}
+	EGL_StagingEndFrame(r);
+}
+
+
+void EGL_StagingBench(void) {
+	EGL_DECLARE_BENCH(EGL_staging);
+
+	EGL_StagingRing r;
+	uint8_t *memory = (uint8_t *)malloc(RING_BYTES);
+	uint8_t *data = (uint8_t *)malloc(UPLOAD_BYTES_MAX);
+	if (!memory || !data || !EGL_StagingInit(&r, RING_BYTES, FRAME_UPLOADS)) {
+		printf(" failed to allocate\n");
+		free(memory);
+		free(data);
+		return;
+	}
+	r.memory = memory;
+	memset(memory, 0, RING_BYTES);
+	memset(data, 1, UPLOAD_BYTES_MAX);
+
+#define RUN(name, work, unit, ...) do { \
+		double best = 1e30; \
+		for (int rep = 0; rep < EGL_BENCH_REPEATS; rep++) { \
+			uint32_t state = 48; \
+			double begin = EGL_BenchNow(); \
+			for (int f = 0; f < FRAMES; f++) { \
+				__VA_ARGS__; \
+			} \
+			double elapsed = EGL_BenchNow() - begin; \
+			best = (elapsed < best) ? elapsed : best; \
+		} \
+		EGL_BenchReport(name, best, work, unit); \
+	} while (0)
+
+	RUN("ring bookkeeping", (double)FRAMES * FRAME_UPLOADS, "upload", frame_alloc(&r, &state));
+	RUN("ring uploads", (double)FRAMES * FRAME_UPLOADS, "upload", frame_ring(&r, data, &state));
+
+	/* The same uploads again, counted in bytes: the work is read after every repeat has run */
+	const uint64_t bytes = r.bytes;
+	RUN("ring throughput", (double)(r.bytes - bytes) / EGL_BENCH_REPEATS, "B", frame_ring(&r, data, &state));
+#undef RUN
+
+	EGL_StagingFree(&r);
+	free(memory);
+	free(data);
+}
@@ -0,0 +1,152 @@
+#include <EGL/EGL_testing.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+#define RING_BYTES 256
+#define COPIES 8
+#define SIM_RING_BYTES 2048
+#define SIM_UPLOAD_BYTES 128 // Uploads are 1 to this many bytes, so a frame always fits.
+#define SIM_FRAMES 2000
+#define SIM_LAG 3 // Frames the simulated GPU runs behind.
+
+
+typedef struct {
+	EGL_StagingCopy copies[EGL_STAGING_FRAMES][COPIES];
+	uint32_t counts[EGL_STAGING_FRAMES];
+	int errors;
+} GPU;
+
+
+/* Read the oldest frame's uploads, each filled with one byte, then hand them back */
+static void gpu_read(GPU *gpu, EGL_StagingRing *r) {
+	const uint32_t slot = (uint32_t)(r->retired % EGL_STAGING_FRAMES);
+	for (uint32_t i = 0; i < gpu->counts[slot]; i++) {
+		const EGL_StagingCopy *c = &gpu->copies[slot][i];
+		for (uint32_t b = 1; b < c->size; b++) {
+			gpu->errors += (r->memory[c->offset + b] != r->memory[c->offset]);
+		}
+	}
+	EGL_StagingRetire(r);
+}
+
+
+/**
+ * Uploads are aligned and recorded in order, never split across the end of
+ * the ring, and refused while the bytes they would need are still in flight.
+ */
+static void EGL_StagingRingTest(EGL_Test *T) {
+	EGL_DECLARE_TEST;
+
+	EGL_StagingRing r;
+	uint8_t memory[RING_BYTES];
+	if (!EGL_StagingInit(&r, RING_BYTES, COPIES)) {
+		EGL_DECLARE_ERROR("Failed to set up a ring of %d bytes.", RING_BYTES);
+		return;
+	}
+	uint8_t data[RING_BYTES];
+	memset(data, 7, sizeof(data));
+	int texture = 0, buffer = 0;
+	if (EGL_StagingBuffer(&r, &buffer, 0, data, 1)) {
+		EGL_DECLARE_ERROR("Staged into a ring of %d bytes before it was mapped.", RING_BYTES);
+	}
+	r.memory = memory;
+
+	/* Two frames of 100 bytes: at 0, then at 112 after alignment */
+	if (!EGL_StagingBuffer(&r, &buffer, 40, data, 100) || !EGL_StagingEndFrame(&r) ||
+		!EGL_StagingTexture(&r, &texture, 2, 5, 5, data, 100) || r.copy_count != 1) {
+		EGL_DECLARE_ERROR("Failed to stage two uploads in a ring of %d bytes.", RING_BYTES);
+	}
+	const EGL_StagingCopy *c = &r.copies[0];
+	if (c->offset != 112 || c->size != 100 || !c->texture || c->target != &texture || c->level != 2 || memory[211] != 7) {
+		EGL_DECLARE_ERROR("The second upload went to offset %u.", c->offset);
+	}
+	if (!EGL_StagingEndFrame(&r) || EGL_StagingInFlight(&r) != 2) {
+		EGL_DECLARE_ERROR("%u frames in flight, not 2.", EGL_StagingInFlight(&r));
+	}
+
+	/* A third would wrap to 0, which the first frame still holds */
+	uint32_t offset = 0;
+	if (EGL_StagingAlloc(&r, 100, &offset) || EGL_StagingAlloc(&r, RING_BYTES + 1, &offset)) {
+		EGL_DECLARE_ERROR("Staged over bytes in flight, at offset %u.", offset);
+	}
+	EGL_StagingRetire(&r);
+	if (EGL_StagingAlloc(&r, 100, &offset) != memory || offset != 0 || r.fails != 3) {
+		EGL_DECLARE_ERROR("After retiring a frame, staged at offset %u with %llu failures.", offset, (unsigned long long)r.fails);
+	}
+
+	/* No more than EGL_STAGING_FRAMES in flight, and no more than COPIES per frame */
+	while (EGL_StagingEndFrame(&r)) {
+	}
+	if (EGL_StagingInFlight(&r) != EGL_STAGING_FRAMES) {
+		EGL_DECLARE_ERROR("Ended %u frames in flight.", EGL_StagingInFlight(&r));
+	}
+	while (EGL_StagingInFlight(&r) > 0) {
+		EGL_StagingRetire(&r);
+	}
+	for (int i = 0; i < COPIES; i++) {
+		EGL_StagingBuffer(&r, &buffer, 0, data, 1);
+	}
+	if (r.copy_count != COPIES || EGL_StagingBuffer(&r, &buffer, 0, data, 1)) {
+		EGL_DECLARE_ERROR("Staged %u copies, past %d.", r.copy_count, COPIES);
+	}
+	EGL_StagingFree(&r);
+}
+
+/**
+ * Over many frames of random uploads, with a GPU that reads each frame's
+ * copies SIM_LAG frames after it is submitted, no upload is written over
+ * before it is read.
+ */
+static void EGL_StagingFramesTest(EGL_Test *T) {
+	EGL_DECLARE_TEST;
+
+	EGL_StagingRing r;
+	uint8_t *memory = (uint8_t *)malloc(SIM_RING_BYTES);
+	if (!memory || !EGL_StagingInit(&r, SIM_RING_BYTES, COPIES)) {
+		EGL_DECLARE_ERROR("Failed to set up a ring of %d bytes.", SIM_RING_BYTES);
+		free(memory);
+		return;
+	}
+	r.memory = memory;
+
+	GPU gpu = { .errors = 0 };
+	uint8_t data[SIM_UPLOAD_BYTES];
+	uint32_t state = 48, staged = 0, stalls = 0;
+	for (uint32_t frame = 0; frame < SIM_FRAMES && gpu.errors == 0; frame++) {
+		const uint32_t uploads = 1 + (state = state * 1664525u + 1013904223u) % COPIES;
+		for (uint32_t u = 0; u < uploads; u++) {
+			const uint32_t size = 1 + (state = state * 1664525u + 1013904223u) % SIM_UPLOAD_BYTES;
+			memset(data, (int)(frame + u), size);
+
+			/* Out of space: wait for the oldest frame, as a fence would */
+			while (!EGL_StagingBuffer(&r, NULL, 0, data, size) && EGL_StagingInFlight(&r) > 0) {
+				gpu_read(&gpu, &r);
+				stalls++;
+			}
+			staged++;
+		}
+
+		/* The GPU reads the oldest frame once it is SIM_LAG behind */
+		while (EGL_StagingInFlight(&r) >= SIM_LAG) {
+			gpu_read(&gpu, &r);
+		}
+		const uint32_t slot = (uint32_t)(r.frames % EGL_STAGING_FRAMES);
+		memcpy(gpu.copies[slot], r.copies, r.copy_count * sizeof(EGL_StagingCopy));
+		gpu.counts[slot] = r.copy_count;
+		EGL_StagingEndFrame(&r);
+	}
+	if (gpu.errors > 0 || stalls == 0 || r.copy_count != 0) {
+		EGL_DECLARE_ERROR("%d bytes were written over in flight, over %u uploads.", gpu.errors, staged);
+	}
+	EGL_StagingFree(&r);
+	free(memory);
+}
+
+
+void EGL_StagingTest(EGL_TestModule *M) {
+	EGL_DECLARE_MODULE(EGL_staging);
+
+	EGL_RUN_TEST(EGL_StagingRingTest);
+	EGL_RUN_TEST(EGL_StagingFramesTest);
+}
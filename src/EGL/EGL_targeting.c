@@ -0,0 +1,168 @@
+#include <EGL/EGL_targeting.h>
+#include <EGL/EGL_parallel.h>
+
+#include <math.h>
+#include <stdbool.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+
+#define TOWER_GROUP 64    // Towers whose running best is kept while streaming aliens.
+#define ALIEN_BLOCK 2048  // Aliens per block (40 KiB of SoA data, stays in L2).
+
+
+typedef struct {
+	const EGL_TargetTowers *towers;
+	const EGL_TargetAliens *aliens;
+	uint32_t *targets;
+} Select;
+
+
+/*
+ * Fold aliens [begin, end) into a tower's running best. An alien replaces the
+ * best only with a strictly greater key, so the lowest index wins ties as long
+ * as blocks are scanned in order.
+ */
+static void scan_block(const EGL_TargetAliens *a, float tx, float ty, float tz, float cos_range, uint8_t policy,
+	uint32_t begin, uint32_t end, float *best_key, uint32_t *best) {
+	const bool nearest = (policy == EGL_TARGET_NEAREST);
+	const float *keys = (policy == EGL_TARGET_FIRST) ? a->progress : a->health;
+	uint32_t i = begin;
+
+#ifdef __SSE2__
+	if (end - begin >= 4) {
+		const __m128 vx = _mm_set1_ps(tx);
+		const __m128 vy = _mm_set1_ps(ty);
+		const __m128 vz = _mm_set1_ps(tz);
+		const __m128 vcos = _mm_set1_ps(cos_range);
+		const __m128 zero = _mm_setzero_ps();
+		const __m128i four = _mm_set1_epi32(4);
+		__m128 lane_key = _mm_set1_ps(-INFINITY);
+		__m128i lane_best = _mm_set1_epi32(-1);
+		__m128i index = _mm_setr_epi32((int)i, (int)i + 1, (int)i + 2, (int)i + 3);
+
+		for (; i + 4 <= end; i += 4) {
+			__m128 d = _mm_add_ps(_mm_add_ps(
+				_mm_mul_ps(_mm_loadu_ps(a->x + i), vx),
+				_mm_mul_ps(_mm_loadu_ps(a->y + i), vy)),
+				_mm_mul_ps(_mm_loadu_ps(a->z + i), vz));
+			__m128 in_range = _mm_cmpge_ps(d, vcos);
+
+			/* Towers see a small cap of the planet, so most groups of four miss */
+			if (_mm_movemask_ps(in_range) != 0) {
+				__m128 key = nearest ? d : _mm_loadu_ps(keys + i);
+				__m128 mask = _mm_and_ps(in_range, _mm_cmpgt_ps(_mm_loadu_ps(a->health + i), zero));
+				mask = _mm_and_ps(mask, _mm_cmpgt_ps(key, lane_key));
+				__m128i mask_i = _mm_castps_si128(mask);
+
+				lane_key = _mm_or_ps(_mm_and_ps(mask, key), _mm_andnot_ps(mask, lane_key));
+				lane_best = _mm_or_si128(_mm_and_si128(mask_i, index), _mm_andnot_si128(mask_i, lane_best));
+			}
+			index = _mm_add_epi32(index, four);
+		}
+
+		/* Lanes interleave indices, so break equal keys by index explicitly */
+		float keys_out[4];
+		int32_t best_out[4];
+		_mm_storeu_ps(keys_out, lane_key);
+		_mm_storeu_si128((__m128i *)best_out, lane_best);
+		float block_key = -INFINITY;
+		int32_t block_best = -1;
+		for (int l = 0; l < 4; l++) {
+			if (best_out[l] < 0) {
+				continue;
+			}
+			if (block_best < 0 || keys_out[l] > block_key || (keys_out[l] == block_key && best_out[l] < block_best)) {
+				block_key = keys_out[l];
+				block_best = best_out[l];
+			}
+		}
+		if (block_best >= 0 && block_key > *best_key) {
+			*best_key = block_key;
+			*best = (uint32_t)block_best;
+		}
+	}
+#endif
+
+	for (; i < end; i++) {
+		float d = a->x[i] * tx + a->y[i] * ty + a->z[i] * tz;
+		float key = nearest ? d : keys[i];
+		if (d >= cos_range && a->health[i] > 0.0f && key > *best_key) {
+			*best_key = key;
+			*best = i;
+		}
+	}
+}
+
+static void select_kernel(void *data, int index, int count) {
+	Select *s = (Select *)data;
+	const EGL_TargetTowers *t = s->towers;
+	const EGL_TargetAliens *a = s->aliens;
+
+	size_t begin, end;
+	EGL_ParallelRange(t->count, index, count, &begin, &end);
+
+	float cos_range[TOWER_GROUP];
+	float best_key[TOWER_GROUP];
+	uint32_t best[TOWER_GROUP];
+
+	for (size_t group = begin; group < end; group += TOWER_GROUP) {
+		uint32_t n = (uint32_t)((end - group < TOWER_GROUP) ? end - group : TOWER_GROUP);
+		for (uint32_t k = 0; k < n; k++) {
+			cos_range[k] = cosf(t->range[group + k]);
+			best_key[k] = -INFINITY;
+			best[k] = EGL_TARGET_NONE;
+		}
+
+		for (uint32_t block = 0; block < a->count; block += ALIEN_BLOCK) {
+			uint32_t block_end = (a->count - block < ALIEN_BLOCK) ? a->count : block + ALIEN_BLOCK;
+			for (uint32_t k = 0; k < n; k++) {
+				size_t tower = group + k;
+				scan_block(a, t->x[tower], t->y[tower], t->z[tower], cos_range[k], t->policy[tower],
+					block, block_end, &best_key[k], &best[k]);
+			}
+		}
+
+		for (uint32_t k = 0; k < n; k++) {
+			s->targets[group + k] = best[k];
+		}
+	}
+}
+
+
+void EGL_TargetSelect(const EGL_TargetTowers *towers, const EGL_TargetAliens *aliens, uint32_t *targets, int threads) {
+	Select s = { .towers = towers, .aliens = aliens, .targets = targets };
+	EGL_ParallelRun(select_kernel, &s, ((int)towers->count < threads) ? (int)towers->count : threads);
+}
+
+void EGL_TargetSelectReference(const EGL_TargetTowers *towers, const EGL_TargetAliens *aliens, uint32_t *targets) {
+	const EGL_TargetAliens *a = aliens;
+
+	for (uint32_t t = 0; t < towers->count; t++) {
+		const float tx = towers->x[t];
+		const float ty = towers->y[t];
+		const float tz = towers->z[t];
+		const float cos_range = cosf(towers->range[t]);
+		const uint8_t policy = towers->policy[t];
+
+		float best_key = -INFINITY;
+		uint32_t best = EGL_TARGET_NONE;
+		for (uint32_t i = 0; i < a->count; i++) {
+			if (!(a->health[i] > 0.0f)) {
+				continue;
+			}
+			float d = a->x[i] * tx + a->y[i] * ty + a->z[i] * tz;
+			if (!(d >= cos_range)) {
+				continue;
+			}
+			float key = (policy == EGL_TARGET_NEAREST) ? d : (policy == EGL_TARGET_FIRST) ? a->progress[i] : a->health[i];
+			if (key > best_key) {
+				best_key = key;
+				best = i;
+			}
+		}
+		targets[t] = best;
+	}
+}
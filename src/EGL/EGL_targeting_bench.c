@@ -0,0 +1,112 @@
+#include <EGL/EGL_bench.h>
+#include <EGL/EGL_parallel.h>
+#include <EGL/EGL_targeting.h>
+
+#include <math.h>
+#include <stdlib.h>
+
+
+static uint32_t lcg(uint32_t *state) {
+	*state = *state * 1664525u + 1013904223u;
+	return *state >> 8;
+}
+
+static float unit(uint32_t *state) {
+	return (float)lcg(state) / 16777216.0f;
+}
+
+static void random_directions(uint32_t *state, uint32_t count, float *x, float *y, float *z) {
+	for (uint32_t i = 0; i < count; i++) {
+		float p[3], r2;
+		do {
+			p[0] = 2.0f * unit(state) - 1.0f;
+			p[1] = 2.0f * unit(state) - 1.0f;
+			p[2] = 2.0f * unit(state) - 1.0f;
+			r2 = p[0] * p[0] + p[1] * p[1] + p[2] * p[2];
+		} while (r2 < 0.01f || r2 > 1.0f);
+		float inv = 1.0f / sqrtf(r2);
+		x[i] = p[0] * inv;
+		y[i] = p[1] * inv;
+		z[i] = p[2] * inv;
+	}
+}
+
+
+void EGL_TargetBench(void) {
+	EGL_DECLARE_BENCH(EGL_targeting);
+
+	const uint32_t tower_counts[] = { 64, 256, 1024 };
+	const uint32_t alien_counts[] = { 10000, 100000 };
+	uint32_t state = 7;
+	char label[64];
+
+	for (int ac = 0; ac < 2; ac++) {
+		const uint32_t alien_count = alien_counts[ac];
+		float *alien_data = (float *)malloc(sizeof(float) * alien_count * 5);
+		EGL_TargetAliens aliens = {
+			.x = alien_data,
+			.y = alien_data + alien_count,
+			.z = alien_data + alien_count * 2,
+			.health = alien_data + alien_count * 3,
+			.progress = alien_data + alien_count * 4,
+			.count = alien_count,
+		};
+		random_directions(&state, alien_count, alien_data, alien_data + alien_count, alien_data + alien_count * 2);
+		for (uint32_t i = 0; i < alien_count; i++) {
+			alien_data[alien_count * 3 + i] = 1.0f + 9.0f * unit(&state);
+			alien_data[alien_count * 4 + i] = 100.0f * unit(&state);
+		}
+
+		for (int tc = 0; tc < 3; tc++) {
+			const uint32_t tower_count = tower_counts[tc];
+			float *tower_data = (float *)malloc(sizeof(float) * tower_count * 4);
+			uint8_t *policy = (uint8_t *)malloc(tower_count);
+			uint32_t *targets = (uint32_t *)malloc(sizeof(uint32_t) * tower_count);
+			random_directions(&state, tower_count, tower_data, tower_data + tower_count, tower_data + tower_count * 2);
+			for (uint32_t t = 0; t < tower_count; t++) {
+				tower_data[tower_count * 3 + t] = 0.1f;
+				policy[t] = (uint8_t)(t % 3);
+			}
+			EGL_TargetTowers towers = {
+				.x = tower_data,
+				.y = tower_data + tower_count,
+				.z = tower_data + tower_count * 2,
+				.range = tower_data + tower_count * 3,
+				.policy = policy,
+				.count = tower_count,
+			};
+			const double pairs = (double)tower_count * alien_count;
+
+			double best = 1e30;
+			for (int r = 0; r < EGL_BENCH_REPEATS; r++) {
+				double begin = EGL_BenchNow();
+				EGL_TargetSelectReference(&towers, &aliens, targets);
+				double elapsed = EGL_BenchNow() - begin;
+				best = (elapsed < best) ? elapsed : best;
+			}
+			EGL_BENCH_SINK += targets[0];
+			snprintf(label, sizeof(label), "reference %u towers x %u aliens", tower_count, alien_count);
+			EGL_BenchReport(label, best, pairs, "pair");
+
+			int threads_max = EGL_ThreadCount();
+			for (int threads = 1; threads <= threads_max; threads *= 2) {
+				best = 1e30;
+				for (int r = 0; r < EGL_BENCH_REPEATS; r++) {
+					double begin = EGL_BenchNow();
+					EGL_TargetSelect(&towers, &aliens, targets, threads);
+					double elapsed = EGL_BenchNow() - begin;
+					best = (elapsed < best) ? elapsed : best;
+				}
+				EGL_BENCH_SINK += targets[0];
+				snprintf(label, sizeof(label), "batched %u x %u, %d threads", tower_count, alien_count, threads);
+				EGL_BenchReport(label, best, pairs, "pair");
+			}
+
+			free(targets);
+			free(policy);
+			free(tower_data);
+		}
+
+		free(alien_data);
+	}
+}
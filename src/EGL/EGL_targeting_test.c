@@ -0,0 +1,134 @@
+#include <EGL/EGL_testing.h>
+#include <math.h>
+#include <stdlib.h>
+
+
+#define TOWERS 301
+#define ALIENS 5003 // Not a multiple of the SIMD width or block size.
+
+
+static void random_direction(uint32_t *state, float *x, float *y, float *z) {
+	float p[3];
+	float r2;
+	do {
+		p[0] = 2.0f * EGL_RandFloat(state) - 1.0f;
+		p[1] = 2.0f * EGL_RandFloat(state) - 1.0f;
+		p[2] = 2.0f * EGL_RandFloat(state) - 1.0f;
+		r2 = p[0] * p[0] + p[1] * p[1] + p[2] * p[2];
+	} while (r2 < 0.01f || r2 > 1.0f);
+	float inv = 1.0f / sqrtf(r2);
+	*x = p[0] * inv;
+	*y = p[1] * inv;
+	*z = p[2] * inv;
+}
+
+
+/**
+ * Each policy picks the expected alien in a hand-built scene.
+ */
+static void EGL_TargetPolicyTest(EGL_Test *T) {
+	EGL_DECLARE_TEST;
+
+	/* Alien 0 is nearest, 1 is furthest along, 2 is strongest, 3 is out of range, 4 is dead */
+	const float c = cosf(0.2f), s = sinf(0.2f);
+	float ax[] = { 1.0f, c, c, 0.0f, 1.0f };
+	float ay[] = { 0.0f, s, 0.0f, 1.0f, 0.0f };
+	float az[] = { 0.0f, 0.0f, s, 0.0f, 0.0f };
+	float health[] = { 1.0f, 2.0f, 9.0f, 99.0f, 0.0f };
+	float progress[] = { 1.0f, 5.0f, 2.0f, 99.0f, 99.0f };
+	EGL_TargetAliens aliens = { ax, ay, az, health, progress, 5 };
+
+	float tx[] = { 1.0f, 1.0f, 1.0f, -1.0f };
+	float ty[] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	float tz[] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	float range[] = { 0.5f, 0.5f, 0.5f, 0.5f };
+	uint8_t policy[] = { EGL_TARGET_NEAREST, EGL_TARGET_FIRST, EGL_TARGET_STRONGEST, EGL_TARGET_NEAREST };
+	EGL_TargetTowers towers = { tx, ty, tz, range, policy, 4 };
+
+	const uint32_t expected[] = { 0, 1, 2, EGL_TARGET_NONE };
+	uint32_t targets[4];
+	EGL_TargetSelect(&towers, &aliens, targets, 2);
+	for (int t = 0; t < 4; t++) {
+		if (targets[t] != expected[t]) {
+			EGL_DECLARE_ERROR("Tower %d targeted %u, expected %u.", t, targets[t], expected[t]);
+		}
+	}
+}
+
+/**
+ * The SIMD multi-threaded kernel matches the scalar reference exactly,
+ * including ties between aliens with equal keys.
+ */
+static void EGL_TargetReferenceTest(EGL_Test *T) {
+	EGL_DECLARE_TEST;
+
+	uint32_t state[4] = {0,0,0,0};
+	EGL_Seed(state, 29);
+
+	float *alien_data = (float *)malloc(sizeof(float) * ALIENS * 5);
+	float *ax = alien_data;
+	float *ay = ax + ALIENS;
+	float *az = ay + ALIENS;
+	float *health = az + ALIENS;
+	float *progress = health + ALIENS;
+	for (uint32_t i = 0; i < ALIENS; i++) {
+		if (i % 7 == 3) {
+			/* Stacked on an earlier alien so nearest has exact ties */
+			ax[i] = ax[i - 3];
+			ay[i] = ay[i - 3];
+			az[i] = az[i - 3];
+		} else {
+			random_direction(state, &ax[i], &ay[i], &az[i]);
+		}
+		/* Few distinct values so first and strongest have ties; some aliens are dead */
+		health[i] = (float)EGL_RandInt(state, -1, 5);
+		progress[i] = (float)EGL_RandInt(state, 0, 20);
+	}
+	EGL_TargetAliens aliens = { ax, ay, az, health, progress, ALIENS };
+
+	float tower_data[TOWERS * 4];
+	uint8_t policy[TOWERS];
+	float *tx = tower_data;
+	float *ty = tx + TOWERS;
+	float *tz = ty + TOWERS;
+	float *range = tz + TOWERS;
+	for (uint32_t t = 0; t < TOWERS; t++) {
+		random_direction(state, &tx[t], &ty[t], &tz[t]);
+		range[t] = 0.01f + 0.3f * EGL_RandFloat(state);
+		policy[t] = (uint8_t)(t % 3);
+	}
+	EGL_TargetTowers towers = { tx, ty, tz, range, policy, TOWERS };
+
+	uint32_t expected[TOWERS];
+	uint32_t targets[TOWERS];
+	EGL_TargetSelectReference(&towers, &aliens, expected);
+
+	int with_target = 0;
+	for (uint32_t t = 0; t < TOWERS; t++) {
+		with_target += (expected[t] != EGL_TARGET_NONE);
+	}
+	if (with_target < TOWERS / 2 || with_target == TOWERS) {
+		EGL_DECLARE_ERROR("Degenerate scene: %d of %d towers have a target.", with_target, TOWERS);
+	}
+
+	const int threads[] = { 1, 3, 8 };
+	for (int k = 0; k < 3; k++) {
+		EGL_TargetSelect(&towers, &aliens, targets, threads[k]);
+		for (uint32_t t = 0; t < TOWERS; t++) {
+			if (targets[t] != expected[t]) {
+				EGL_DECLARE_ERROR("%d threads: tower %u (policy %d) targeted %u, expected %u.", threads[k], t, policy[t], targets[t], expected[t]);
+				break;
+			}
+		}
+	}
+
+	free(alien_data);
+}
+
+
+void EGL_TargetTest(EGL_TestModule *M) {
+	EGL_DECLARE_MODULE(EGL_targeting);
+
+	EGL_RUN_TEST(EGL_TargetPolicyTest);
+	EGL_RUN_TEST(EGL_TargetReferenceTest);
+}
@@ -13,17 +13,38 @@ int main(int argc, char **argv)
 
 	/*$ TESTS */
 	EGL_RUN_MODULE(EGL_Xoshiro128PlusTest);
+	EGL_RUN_MODULE(EGL_MeshTest);
+	EGL_RUN_MODULE(EGL_FlowFieldTest);
+	EGL_RUN_MODULE(EGL_SpatialTest);
+	EGL_RUN_MODULE(EGL_TargetTest);
+	EGL_RUN_MODULE(EGL_BvhTest);
+	EGL_RUN_MODULE(EGL_TransformTest);
+	EGL_RUN_MODULE(EGL_SnapshotTest);
+	EGL_RUN_MODULE(EGL_HierarchyTest);
+	EGL_RUN_MODULE(EGL_MathTest);
+	EGL_RUN_MODULE(EGL_ApproxTest);
+	EGL_RUN_MODULE(EGL_SimThreadTest);
+	EGL_RUN_MODULE(EGL_JobsTest);
+	EGL_RUN_MODULE(EGL_QueueTest);
+	EGL_RUN_MODULE(EGL_ProfileTest);
+	EGL_RUN_MODULE(EGL_FrameStatsTest);
+	EGL_RUN_MODULE(EGL_AllocTest);
+	EGL_RUN_MODULE(EGL_ArenaTest);
+	EGL_RUN_MODULE(EGL_AssetsTest);
+	EGL_RUN_MODULE(EGL_PackTest);
+	EGL_RUN_MODULE(EGL_TextureTest);
+	EGL_RUN_MODULE(EGL_StagingTest);
+	EGL_RUN_MODULE(EGL_InstanceTest);
+	EGL_RUN_MODULE(EGL_RasterTest);
 	/*$ END TESTS */
 
 	printf("\n\033[0m TEST | ");
 	if (TESTS_FAILING) {
 		printf("\033[31m%d/%d \033[0mPASSING\n", M.test_count - M.fail_count, M.test_count);
-		memcpy(L.buffer + L.size, ANSI_RED(HLINE), sizeof(ANSI_RED(HLINE)));
-		L.size += sizeof(ANSI_RED(HLINE));
+		EGL_LogPrintf(&L, "%s", ANSI_RED(HLINE));
 	} else {
 		printf("\033[32m%d/%d \033[0mPASSING\n", M.test_count - M.fail_count, M.test_count);
-		memcpy(L.buffer + L.size, ANSI_GREEN(HLINE), sizeof(ANSI_GREEN(HLINE)));
-		L.size += sizeof(ANSI_GREEN(HLINE));
+		EGL_LogPrintf(&L, "%s", ANSI_GREEN(HLINE));
 	}
 
 	printf("%s%s\n", L.buffer, ANSI_RESET);
@@ -0,0 +1,1005 @@
+#include <EGL/EGL_texture.h>
+#include <EGL/EGL_memory.h>
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+
+#define SIZE_MAX_PIXELS 32768 // Largest width or height accepted from a file.
+#define ENCODE_STEPS 4095     // Linear values are rounded to this many steps before sRGB encoding.
+#define PCA_ITERATIONS 8
+#define REFINE_ITERATIONS 2
+
+
+static float SRGB_TO_LINEAR[256];
+static uint8_t LINEAR_TO_SRGB[ENCODE_STEPS + 1];
+static once_flag TABLES_ONCE = ONCE_FLAG_INIT;
+
+static const int BC7_WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+
+static void init_tables(void) {
+	for (int i = 0; i < 256; i++) {
+		const double c = i / 255.0;
+		SRGB_TO_LINEAR[i] = (float)((c <= 0.04045) ? c / 12.92 : pow((c + 0.055) / 1.055, 2.4));
+	}
+	for (int i = 0; i <= ENCODE_STEPS; i++) {
+		const double l = (double)i / ENCODE_STEPS;
+		const double c = (l <= 0.0031308) ? l * 12.92 : 1.055 * pow(l, 1.0 / 2.4) - 0.055;
+		LINEAR_TO_SRGB[i] = (uint8_t)(c * 255.0 + 0.5);
+	}
+}
+
+static inline uint32_t read_u16(const uint8_t *p) {
+	return (uint32_t)p[0] | (uint32_t)p[1] << 8;
+}
+
+static inline uint32_t read_u32(const uint8_t *p) {
+	return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static inline void write_u16(uint8_t *p, uint32_t v) {
+	p[0] = (uint8_t)v;
+	p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void write_u32(uint8_t *p, uint32_t v) {
+	write_u16(p, v);
+	write_u16(p + 2, v >> 16);
+}
+
+static inline int clamp_int(int v, int lo, int hi) {
+	return (v < lo) ? lo : (v > hi) ? hi : v;
+}
+
+static inline uint8_t expand5(uint32_t v) {
+	return (uint8_t)((v << 3) | (v >> 2));
+}
+
+static inline uint8_t expand6(uint32_t v) {
+	return (uint8_t)((v << 2) | (v >> 4));
+}
+
+
+/* Pixel conversion, one row at a time */
+
+static void convert_row(const uint8_t *src, EGL_PixelFormat format, uint32_t width, uint8_t *dst) {
+	uint32_t x = 0;
+	switch (format) {
+	case EGL_PIXEL_RGBA8:
+		memcpy(dst, src, (size_t)width * 4);
+		return;
+
+	case EGL_PIXEL_BGRA8:
+	case EGL_PIXEL_BGRX8: {
+		const uint32_t alpha = (format == EGL_PIXEL_BGRX8) ? 0xff000000u : 0;
+#ifdef __SSE2__
+		/* Swap the red and blue bytes of four pixels at a time */
+		const __m128i ag_mask = _mm_set1_epi32((int)0xff00ff00u);
+		const __m128i byte_mask = _mm_set1_epi32(0xff);
+		const __m128i alpha_bits = _mm_set1_epi32((int)alpha);
+		for (; x + 4 <= width; x += 4) {
+			const __m128i v = _mm_loadu_si128((const __m128i *)(src + x * 4));
+			const __m128i r = _mm_and_si128(_mm_srli_epi32(v, 16), byte_mask);
+			const __m128i b = _mm_slli_epi32(_mm_and_si128(v, byte_mask), 16);
+			const __m128i out = _mm_or_si128(_mm_or_si128(_mm_and_si128(v, ag_mask), r), _mm_or_si128(b, alpha_bits));
+			_mm_storeu_si128((__m128i *)(dst + x * 4), out);
+		}
+#endif
+		for (; x < width; x++) {
+			const uint32_t v = read_u32(src + x * 4) | alpha;
+			dst[x * 4 + 0] = (uint8_t)(v >> 16);
+			dst[x * 4 + 1] = (uint8_t)(v >> 8);
+			dst[x * 4 + 2] = (uint8_t)v;
+			dst[x * 4 + 3] = (uint8_t)(v >> 24);
+		}
+		return;
+	}
+
+	case EGL_PIXEL_BGR8:
+		for (; x < width; x++) {
+			dst[x * 4 + 0] = src[x * 3 + 2];
+			dst[x * 4 + 1] = src[x * 3 + 1];
+			dst[x * 4 + 2] = src[x * 3 + 0];
+			dst[x * 4 + 3] = 255;
+		}
+		return;
+
+	case EGL_PIXEL_RGB565:
+	case EGL_PIXEL_XRGB1555: {
+		const bool wide_green = (format == EGL_PIXEL_RGB565);
+#ifdef __SSE2__
+		/* Eight pixels at a time: widen each field to eight bits in 16-bit lanes, then interleave */
+		const __m128i five = _mm_set1_epi16(31);
+		const __m128i six = _mm_set1_epi16(63);
+		const __m128i opaque = _mm_set1_epi16((short)0xff00);
+		for (; x + 8 <= width; x += 8) {
+			const __m128i p = _mm_loadu_si128((const __m128i *)(src + x * 2));
+			__m128i r, g, b;
+			if (wide_green) {
+				r = _mm_srli_epi16(p, 11);
+				g = _mm_and_si128(_mm_srli_epi16(p, 5), six);
+				g = _mm_or_si128(_mm_slli_epi16(g, 2), _mm_srli_epi16(g, 4));
+			} else {
+				r = _mm_and_si128(_mm_srli_epi16(p, 10), five);
+				g = _mm_and_si128(_mm_srli_epi16(p, 5), five);
+				g = _mm_or_si128(_mm_slli_epi16(g, 3), _mm_srli_epi16(g, 2));
+			}
+			b = _mm_and_si128(p, five);
+			r = _mm_or_si128(_mm_slli_epi16(r, 3), _mm_srli_epi16(r, 2));
+			b = _mm_or_si128(_mm_slli_epi16(b, 3), _mm_srli_epi16(b, 2));
+
+			const __m128i rg = _mm_or_si128(r, _mm_slli_epi16(g, 8));
+			const __m128i ba = _mm_or_si128(b, opaque);
+			_mm_storeu_si128((__m128i *)(dst + x * 4), _mm_unpacklo_epi16(rg, ba));
+			_mm_storeu_si128((__m128i *)(dst + x * 4 + 16), _mm_unpackhi_epi16(rg, ba));
+		}
+#endif
+		for (; x < width; x++) {
+			const uint32_t p = read_u16(src + x * 2);
+			if (wide_green) {
+				dst[x * 4 + 0] = expand5(p >> 11);
+				dst[x * 4 + 1] = expand6((p >> 5) & 63);
+			} else {
+				dst[x * 4 + 0] = expand5((p >> 10) & 31);
+				dst[x * 4 + 1] = expand5((p >> 5) & 31);
+			}
+			dst[x * 4 + 2] = expand5(p & 31);
+			dst[x * 4 + 3] = 255;
+		}
+		return;
+	}
+	}
+}
+
+
+/* Mip generation in linear light */
+
+static void to_linear(const uint8_t *rgba, size_t pixels, float *linear) {
+	for (size_t i = 0; i < pixels; i++) {
+		linear[i * 4 + 0] = SRGB_TO_LINEAR[rgba[i * 4 + 0]];
+		linear[i * 4 + 1] = SRGB_TO_LINEAR[rgba[i * 4 + 1]];
+		linear[i * 4 + 2] = SRGB_TO_LINEAR[rgba[i * 4 + 2]];
+		linear[i * 4 + 3] = rgba[i * 4 + 3] * (1.0f / 255.0f);
+	}
+}
+
+static inline uint8_t encode_srgb(float l) {
+	const float clamped = (l < 0.0f) ? 0.0f : (l > 1.0f) ? 1.0f : l;
+	return LINEAR_TO_SRGB[(int)(clamped * ENCODE_STEPS + 0.5f)];
+}
+
+/* Halve one level: each pixel is the mean of its 2x2 footprint, clamped at odd edges */
+static void downsample(const float *src, uint32_t w, uint32_t h, float *dst, uint8_t *rgba) {
+	const uint32_t dw = (w > 1) ? w / 2 : 1;
+	const uint32_t dh = (h > 1) ? h / 2 : 1;
+	for (uint32_t y = 0; y < dh; y++) {
+		const float *row0 = src + (size_t)((2 * y < h) ? 2 * y : h - 1) * w * 4;
+		const float *row1 = src + (size_t)((2 * y + 1 < h) ? 2 * y + 1 : h - 1) * w * 4;
+		for (uint32_t x = 0; x < dw; x++) {
+			const uint32_t x0 = (2 * x < w) ? 2 * x : w - 1;
+			const uint32_t x1 = (2 * x + 1 < w) ? 2 * x + 1 : w - 1;
+			float *out = dst + ((size_t)y * dw + x) * 4;
+#ifdef __SSE2__
+			const __m128 sum = _mm_add_ps(_mm_add_ps(_mm_loadu_ps(row0 + x0 * 4), _mm_loadu_ps(row0 + x1 * 4)),
+				_mm_add_ps(_mm_loadu_ps(row1 + x0 * 4), _mm_loadu_ps(row1 + x1 * 4)));
+			_mm_storeu_ps(out, _mm_mul_ps(sum, _mm_set1_ps(0.25f)));
+#else
+			for (int c = 0; c < 4; c++) {
+				out[c] = 0.25f * (row0[x0 * 4 + c] + row0[x1 * 4 + c] + row1[x0 * 4 + c] + row1[x1 * 4 + c]);
+			}
+#endif
+			uint8_t *px = rgba + ((size_t)y * dw + x) * 4;
+			px[0] = encode_srgb(out[0]);
+			px[1] = encode_srgb(out[1]);
+			px[2] = encode_srgb(out[2]);
+			px[3] = (uint8_t)(clamp_int((int)(out[3] * 255.0f + 0.5f), 0, 255));
+		}
+	}
+}
+
+
+/* Block helpers */
+
+/* Gather a 4x4 block, repeating the last row and column where the image ends */
+static void load_block(const EGL_Image *image, uint32_t bx, uint32_t by, uint8_t block[16][4]) {
+	for (uint32_t y = 0; y < 4; y++) {
+		const uint32_t sy = (by * 4 + y < image->height) ? by * 4 + y : image->height - 1;
+		for (uint32_t x = 0; x < 4; x++) {
+			const uint32_t sx = (bx * 4 + x < image->width) ? bx * 4 + x : image->width - 1;
+			memcpy(block[y * 4 + x], image->pixels + ((size_t)sy * image->width + sx) * 4, 4);
+		}
+	}
+}
+
+static void store_block(uint8_t *rgba, uint32_t width, uint32_t height, uint32_t bx, uint32_t by, uint8_t block[16][4]) {
+	for (uint32_t y = 0; y < 4 && by * 4 + y < height; y++) {
+		for (uint32_t x = 0; x < 4 && bx * 4 + x < width; x++) {
+			memcpy(rgba + ((size_t)(by * 4 + y) * width + bx * 4 + x) * 4, block[y * 4 + x], 4);
+		}
+	}
+}
+
+/*
+ * Find the line through points of `channels` components that fits them best:
+ * their bounding box diagonal, or their principal axis by power iteration.
+ * Writes the ends of the points' extent along it.
+ */
+static void fit_line(const float (*points)[4], int count, int channels, EGL_TextureQuality quality, float lo[4], float hi[4]) {
+	float mean[4] = { 0 }, min[4], max[4];
+	for (int c = 0; c < channels; c++) {
+		min[c] = max[c] = points[0][c];
+	}
+	for (int i = 0; i < count; i++) {
+		for (int c = 0; c < channels; c++) {
+			mean[c] += points[i][c];
+			min[c] = fminf(min[c], points[i][c]);
+			max[c] = fmaxf(max[c], points[i][c]);
+		}
+	}
+	for (int c = 0; c < channels; c++) {
+		mean[c] /= (float)count;
+	}
+
+	if (quality == EGL_TEXTURE_FAST) {
+		/* Inset the box a little, since the extremes are rarely both hit */
+		int widest = 0;
+		for (int c = 0; c < channels; c++) {
+			const float inset = (max[c] - min[c]) / 32.0f;
+			lo[c] = min[c] + inset;
+			hi[c] = max[c] - inset;
+			widest = (max[c] - min[c] > max[widest] - min[widest]) ? c : widest;
+		}
+
+		/* Pick the diagonal: flip channels that fall as the widest one rises */
+		for (int c = 0; c < channels; c++) {
+			float covariance = 0.0f;
+			for (int i = 0; i < count; i++) {
+				covariance += (points[i][widest] - mean[widest]) * (points[i][c] - mean[c]);
+			}
+			if (covariance < 0.0f) {
+				const float swap = lo[c];
+				lo[c] = hi[c];
+				hi[c] = swap;
+			}
+		}
+		return;
+	}
+
+	float cov[4][4] = { { 0 } };
+	for (int i = 0; i < count; i++) {
+		float d[4];
+		for (int c = 0; c < channels; c++) {
+			d[c] = points[i][c] - mean[c];
+		}
+		for (int a = 0; a < channels; a++) {
+			for (int b = 0; b < channels; b++) {
+				cov[a][b] += d[a] * d[b];
+			}
+		}
+	}
+	float axis[4];
+	for (int c = 0; c < channels; c++) {
+		axis[c] = max[c] - min[c];
+	}
+	for (int it = 0; it < PCA_ITERATIONS; it++) {
+		float next[4] = { 0 }, length = 0.0f;
+		for (int a = 0; a < channels; a++) {
+			for (int b = 0; b < channels; b++) {
+				next[a] += cov[a][b] * axis[b];
+			}
+			length = fmaxf(length, fabsf(next[a]));
+		}
+		if (length < 1e-6f) {
+			break; // Flat block: keep the box diagonal
+		}
+		for (int c = 0; c < channels; c++) {
+			axis[c] = next[c] / length;
+		}
+	}
+
+	float norm = 0.0f;
+	for (int c = 0; c < channels; c++) {
+		norm += axis[c] * axis[c];
+	}
+	float t_min = 0.0f, t_max = 0.0f;
+	if (norm > 0.0f) {
+		t_min = INFINITY;
+		t_max = -INFINITY;
+		for (int i = 0; i < count; i++) {
+			float t = 0.0f;
+			for (int c = 0; c < channels; c++) {
+				t += (points[i][c] - mean[c]) * axis[c];
+			}
+			t_min = fminf(t_min, t / norm);
+			t_max = fmaxf(t_max, t / norm);
+		}
+	}
+	for (int c = 0; c < channels; c++) {
+		lo[c] = mean[c] + axis[c] * t_min;
+		hi[c] = mean[c] + axis[c] * t_max;
+	}
+}
+
+/*
+ * Solve for the two endpoints that best reproduce the points given each
+ * point's weight toward the second one. Returns false if the weights cannot
+ * separate them.
+ */
+static bool least_squares(const float (*points)[4], const float *weights, int count, int channels, float lo[4], float hi[4]) {
+	float a = 0.0f, b = 0.0f, c = 0.0f, x1[4] = { 0 }, x2[4] = { 0 };
+	for (int i = 0; i < count; i++) {
+		const float t = weights[i], s = 1.0f - t;
+		a += s * s;
+		b += s * t;
+		c += t * t;
+		for (int k = 0; k < channels; k++) {
+			x1[k] += s * points[i][k];
+			x2[k] += t * points[i][k];
+		}
+	}
+	const float det = a * c - b * b;
+	if (fabsf(det) < 1e-6f) {
+		return false;
+	}
+	for (int k = 0; k < channels; k++) {
+		lo[k] = fminf(fmaxf((c * x1[k] - b * x2[k]) / det, 0.0f), 255.0f);
+		hi[k] = fminf(fmaxf((a * x2[k] - b * x1[k]) / det, 0.0f), 255.0f);
+	}
+	return true;
+}
+
+
+/* BC1 */
+
+static uint32_t pack565(const float c[4]) {
+	const int r = clamp_int((int)(c[0] * 31.0f / 255.0f + 0.5f), 0, 31);
+	const int g = clamp_int((int)(c[1] * 63.0f / 255.0f + 0.5f), 0, 63);
+	const int b = clamp_int((int)(c[2] * 31.0f / 255.0f + 0.5f), 0, 31);
+	return (uint32_t)(r << 11 | g << 5 | b);
+}
+
+static void unpack565(uint32_t v, int out[3]) {
+	out[0] = expand5(v >> 11);
+	out[1] = expand6((v >> 5) & 63);
+	out[2] = expand5(v & 31);
+}
+
+/* The four colours a BC1 block can hold; in three-colour mode the last is transparent black */
+static void bc1_palette(uint32_t c0, uint32_t c1, int palette[4][4]) {
+	unpack565(c0, palette[0]);
+	unpack565(c1, palette[1]);
+	palette[0][3] = palette[1][3] = 255;
+	for (int k = 0; k < 3; k++) {
+		if (c0 > c1) {
+			palette[2][k] = (2 * palette[0][k] + palette[1][k]) / 3;
+			palette[3][k] = (palette[0][k] + 2 * palette[1][k]) / 3;
+		} else {
+			palette[2][k] = (palette[0][k] + palette[1][k]) / 2;
+			palette[3][k] = 0;
+		}
+	}
+	palette[2][3] = 255;
+	palette[3][3] = (c0 > c1) ? 255 : 0;
+}
+
+/*
+ * Quantize endpoints, order them for the mode, pick each pixel's nearest
+ * colour and write the block. Returns its squared error and each opaque
+ * pixel's weight toward the second endpoint.
+ */
+static float bc1_try(const uint8_t block[16][4], bool transparent, const float lo[4], const float hi[4], uint8_t out[8], float weights[16]) {
+	uint32_t c0 = pack565(lo), c1 = pack565(hi);
+	if (transparent ? c0 > c1 : c0 < c1) {
+		const uint32_t swap = c0;
+		c0 = c1;
+		c1 = swap;
+	}
+	int palette[4][4];
+	bc1_palette(c0, c1, palette);
+	static const float WEIGHTS4[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+	static const float WEIGHTS3[4] = { 0.0f, 1.0f, 0.5f, 0.0f };
+	const int colours = (c0 > c1) ? 4 : 3;
+
+	uint32_t indices = 0;
+	float error = 0.0f;
+	int n = 0;
+	for (int i = 0; i < 16; i++) {
+		int best = 3, best_d = 0;
+		if (!transparent || block[i][3] >= 128) {
+			best_d = INT32_MAX;
+			for (int p = 0; p < colours; p++) {
+				const int dr = block[i][0] - palette[p][0], dg = block[i][1] - palette[p][1], db = block[i][2] - palette[p][2];
+				const int d = dr * dr + dg * dg + db * db;
+				if (d < best_d) {
+					best_d = d;
+					best = p;
+				}
+			}
+			weights[n++] = (colours == 4) ? WEIGHTS4[best] : WEIGHTS3[best];
+		}
+		error += (float)best_d;
+		indices |= (uint32_t)best << (2 * i);
+	}
+	out[0] = (uint8_t)c0;
+	out[1] = (uint8_t)(c0 >> 8);
+	out[2] = (uint8_t)c1;
+	out[3] = (uint8_t)(c1 >> 8);
+	out[4] = (uint8_t)indices;
+	out[5] = (uint8_t)(indices >> 8);
+	out[6] = (uint8_t)(indices >> 16);
+	out[7] = (uint8_t)(indices >> 24);
+	return error;
+}
+
+static void bc1_encode(const uint8_t block[16][4], EGL_TextureQuality quality, uint8_t out[8]) {
+	float points[16][4];
+	int count = 0;
+	bool transparent = false;
+	for (int i = 0; i < 16; i++) {
+		if (block[i][3] < 128) {
+			transparent = true;
+			continue;
+		}
+		for (int c = 0; c < 3; c++) {
+			points[count][c] = block[i][c];
+		}
+		count++;
+	}
+	if (count == 0) {
+		memset(out, 0, 4);
+		memset(out + 4, 0xff, 4); // Every pixel transparent
+		return;
+	}
+
+	float lo[4], hi[4], weights[16];
+	fit_line((const float (*)[4])points, count, 3, quality, lo, hi);
+	float best = bc1_try(block, transparent, lo, hi, out, weights);
+	for (int it = 0; quality == EGL_TEXTURE_BEST && it < REFINE_ITERATIONS; it++) {
+		uint8_t candidate[8];
+		float candidate_weights[16];
+		if (!least_squares((const float (*)[4])points, weights, count, 3, lo, hi)) {
+			break;
+		}
+		const float error = bc1_try(block, transparent, lo, hi, candidate, candidate_weights);
+		if (error >= best) {
+			break;
+		}
+		best = error;
+		memcpy(out, candidate, 8);
+		memcpy(weights, candidate_weights, sizeof(weights));
+	}
+}
+
+static void bc1_decode(const uint8_t in[8], uint8_t block[16][4]) {
+	const uint32_t c0 = read_u16(in), c1 = read_u16(in + 2), indices = read_u32(in + 4);
+	int palette[4][4];
+	bc1_palette(c0, c1, palette);
+	for (int i = 0; i < 16; i++) {
+		const int p = (indices >> (2 * i)) & 3;
+		for (int c = 0; c < 4; c++) {
+			block[i][c] = (uint8_t)palette[p][c];
+		}
+	}
+}
+
+
+/* BC7, mode 6 only */
+
+typedef struct {
+	uint64_t bits[2];
+	int at;
+} Bits;
+
+static void put_bits(Bits *b, uint32_t value, int count) {
+	for (int i = 0; i < count; i++, b->at++) {
+		b->bits[b->at / 64] |= (uint64_t)((value >> i) & 1) << (b->at % 64);
+	}
+}
+
+static uint32_t get_bits(Bits *b, int count) {
+	uint32_t value = 0;
+	for (int i = 0; i < count; i++, b->at++) {
+		value |= (uint32_t)((b->bits[b->at / 64] >> (b->at % 64)) & 1) << i;
+	}
+	return value;
+}
+
+static inline int bc7_interpolate(int e0, int e1, int weight) {
+	return ((64 - weight) * e0 + weight * e1 + 32) >> 6;
+}
+
+/* Round an endpoint to seven bits per channel plus a low bit shared by all four */
+static void bc7_quantize(const float e[4], int pbit, int q[4]) {
+	for (int c = 0; c < 4; c++) {
+		q[c] = clamp_int((int)((e[c] - (float)pbit) * 0.5f + 0.5f), 0, 127);
+	}
+}
+
+static int bc7_pbit(const float e[4]) {
+	float error[2] = { 0.0f, 0.0f };
+	for (int p = 0; p < 2; p++) {
+		int q[4];
+		bc7_quantize(e, p, q);
+		for (int c = 0; c < 4; c++) {
+			const float d = e[c] - (float)(q[c] << 1 | p);
+			error[p] += d * d;
+		}
+	}
+	return error[1] < error[0];
+}
+
+/* Write a mode 6 block for quantized endpoints. Returns its squared error and each pixel's weight. */
+static float bc7_try(const uint8_t block[16][4], int q0[4], int q1[4], int p0, int p1, uint8_t out[16], float weights[16]) {
+	int e0[4], e1[4], palette[16][4];
+	for (int c = 0; c < 4; c++) {
+		e0[c] = q0[c] << 1 | p0;
+		e1[c] = q1[c] << 1 | p1;
+	}
+	for (int i = 0; i < 16; i++) {
+		for (int c = 0; c < 4; c++) {
+			palette[i][c] = bc7_interpolate(e0[c], e1[c], BC7_WEIGHTS[i]);
+		}
+	}
+
+	/* Project onto the endpoint line for a first guess, then check its neighbours */
+	int dir[4], length = 0;
+	for (int c = 0; c < 4; c++) {
+		dir[c] = e1[c] - e0[c];
+		length += dir[c] * dir[c];
+	}
+	int indices[16];
+	float error = 0.0f;
+	for (int i = 0; i < 16; i++) {
+		int guess = 0;
+		if (length > 0) {
+			int dot = 0;
+			for (int c = 0; c < 4; c++) {
+				dot += (block[i][c] - e0[c]) * dir[c];
+			}
+			guess = clamp_int((dot * 15 + length / 2) / length, 0, 15);
+		}
+		int best = guess, best_d = INT32_MAX;
+		for (int p = clamp_int(guess - 1, 0, 15); p <= clamp_int(guess + 1, 0, 15); p++) {
+			int d = 0;
+			for (int c = 0; c < 4; c++) {
+				d += (block[i][c] - palette[p][c]) * (block[i][c] - palette[p][c]);
+			}
+			if (d < best_d) {
+				best_d = d;
+				best = p;
+			}
+		}
+		indices[i] = best;
+		weights[i] = (float)BC7_WEIGHTS[best] / 64.0f;
+		error += (float)best_d;
+	}
+
+	/* The first index has an implicit zero top bit; swap the endpoints if it needs one */
+	if (indices[0] & 8) {
+		int *swap = q0;
+		q0 = q1;
+		q1 = swap;
+		const int pswap = p0;
+		p0 = p1;
+		p1 = pswap;
+		for (int i = 0; i < 16; i++) {
+			indices[i] = 15 - indices[i];
+		}
+	}
+
+	Bits b = { { 0, 0 }, 0 };
+	put_bits(&b, 1 << 6, 7); // Mode 6
+	for (int c = 0; c < 4; c++) {
+		put_bits(&b, (uint32_t)q0[c], 7);
+		put_bits(&b, (uint32_t)q1[c], 7);
+	}
+	put_bits(&b, (uint32_t)p0, 1);
+	put_bits(&b, (uint32_t)p1, 1);
+	put_bits(&b, (uint32_t)indices[0], 3);
+	for (int i = 1; i < 16; i++) {
+		put_bits(&b, (uint32_t)indices[i], 4);
+	}
+	for (int i = 0; i < 16; i++) {
+		out[i] = (uint8_t)(b.bits[i / 8] >> (8 * (i % 8)));
+	}
+	return error;
+}
+
+static float bc7_fit(const uint8_t block[16][4], const float lo[4], const float hi[4], bool all_pbits, uint8_t out[16], float weights[16]) {
+	float best = INFINITY;
+	for (int combo = 0; combo < 4; combo++) {
+		int p0 = combo & 1, p1 = combo >> 1;
+		if (!all_pbits) {
+			if (combo > 0) {
+				break;
+			}
+			p0 = bc7_pbit(lo);
+			p1 = bc7_pbit(hi);
+		}
+		int q0[4], q1[4];
+		bc7_quantize(lo, p0, q0);
+		bc7_quantize(hi, p1, q1);
+		uint8_t candidate[16];
+		float candidate_weights[16];
+		const float error = bc7_try(block, q0, q1, p0, p1, candidate, candidate_weights);
+		if (combo == 0 || error < best) {
+			best = error;
+			memcpy(out, candidate, 16);
+			memcpy(weights, candidate_weights, sizeof(candidate_weights));
+		}
+	}
+	return best;
+}
+
+static void bc7_encode(const uint8_t block[16][4], EGL_TextureQuality quality, uint8_t out[16]) {
+	float points[16][4];
+	for (int i = 0; i < 16; i++) {
+		for (int c = 0; c < 4; c++) {
+			points[i][c] = block[i][c];
+		}
+	}
+	float lo[4], hi[4], weights[16];
+	fit_line((const float (*)[4])points, 16, 4, quality, lo, hi);
+	const bool best_quality = (quality == EGL_TEXTURE_BEST);
+	float best = bc7_fit(block, lo, hi, best_quality, out, weights);
+
+	for (int it = 0; best_quality && it < REFINE_ITERATIONS; it++) {
+		uint8_t candidate[16];
+		float candidate_weights[16];
+		if (!least_squares((const float (*)[4])points, weights, 16, 4, lo, hi)) {
+			break;
+		}
+		const float error = bc7_fit(block, lo, hi, true, candidate, candidate_weights);
+		if (error >= best) {
+			break;
+		}
+		best = error;
+		memcpy(out, candidate, 16);
+		memcpy(weights, candidate_weights, sizeof(weights));
+	}
+}
+
+static void bc7_decode(const uint8_t in[16], uint8_t block[16][4]) {
+	Bits b = { { 0, 0 }, 0 };
+	for (int i = 0; i < 16; i++) {
+		b.bits[i / 8] |= (uint64_t)in[i] << (8 * (i % 8));
+	}
+	if (get_bits(&b, 7) != 1 << 6) {
+		memset(block, 0, 64); // Not mode 6, which is all this encoder writes
+		return;
+	}
+	int e0[4], e1[4];
+	for (int c = 0; c < 4; c++) {
+		e0[c] = (int)get_bits(&b, 7) << 1;
+		e1[c] = (int)get_bits(&b, 7) << 1;
+	}
+	const int p0 = (int)get_bits(&b, 1), p1 = (int)get_bits(&b, 1);
+	for (int c = 0; c < 4; c++) {
+		e0[c] |= p0;
+		e1[c] |= p1;
+	}
+	for (int i = 0; i < 16; i++) {
+		const int index = (int)get_bits(&b, (i == 0) ? 3 : 4);
+		for (int c = 0; c < 4; c++) {
+			block[i][c] = (uint8_t)bc7_interpolate(e0[c], e1[c], BC7_WEIGHTS[index]);
+		}
+	}
+}
+
+
+bool EGL_ImageInit(EGL_Image *image, uint32_t width, uint32_t height) {
+	image->width = width;
+	image->height = height;
+	image->pixels = (uint8_t *)EGL_malloc((size_t)width * height * 4);
+	return image->pixels != NULL;
+}
+
+void EGL_ImageFree(EGL_Image *image) {
+	EGL_free(image->pixels);
+	memset(image, 0, sizeof(*image));
+}
+
+void EGL_PixelsConvert(const void *src, ptrdiff_t pitch, EGL_PixelFormat format, uint32_t width, uint32_t height, uint8_t *rgba) {
+	for (uint32_t y = 0; y < height; y++) {
+		convert_row((const uint8_t *)src + (ptrdiff_t)y * pitch, format, width, rgba + (size_t)y * width * 4);
+	}
+}
+
+bool EGL_ImageReadBMP(EGL_Image *image, const void *data, size_t size) {
+	memset(image, 0, sizeof(*image));
+	const uint8_t *bytes = (const uint8_t *)data;
+	if (size < 54 || bytes[0] != 'B' || bytes[1] != 'M') {
+		return false;
+	}
+	const uint32_t offset = read_u32(bytes + 10);
+	const uint32_t header = read_u32(bytes + 14);
+	const int32_t width = (int32_t)read_u32(bytes + 18);
+	const int32_t height = (int32_t)read_u32(bytes + 22);
+	const uint32_t bpp = read_u16(bytes + 28);
+	const uint32_t compression = read_u32(bytes + 30);
+	if (width <= 0 || width > SIZE_MAX_PIXELS || height == 0 || height < -SIZE_MAX_PIXELS || height > SIZE_MAX_PIXELS) {
+		return false;
+	}
+
+	/* Bit fields follow a 40-byte header, or sit inside a longer one */
+	const bool fields = (compression == 3);
+	if (compression != 0 && !fields) {
+		return false;
+	}
+	if (fields && size < 66) {
+		return false;
+	}
+	const uint32_t red = fields ? read_u32(bytes + 54) : 0;
+	const uint32_t green = fields ? read_u32(bytes + 58) : 0;
+	const uint32_t blue = fields ? read_u32(bytes + 62) : 0;
+	const uint32_t alpha = (fields && header >= 56 && size >= 70) ? read_u32(bytes + 66) : 0;
+
+	EGL_PixelFormat format;
+	if (bpp == 16 && (!fields || (red == 0x7c00 && green == 0x03e0 && blue == 0x001f))) {
+		format = EGL_PIXEL_XRGB1555;
+	} else if (bpp == 16 && red == 0xf800 && green == 0x07e0 && blue == 0x001f) {
+		format = EGL_PIXEL_RGB565;
+	} else if (bpp == 24 && !fields) {
+		format = EGL_PIXEL_BGR8;
+	} else if (bpp == 32 && (!fields || (red == 0x00ff0000 && green == 0x0000ff00 && blue == 0x000000ff))) {
+		format = (alpha == 0xff000000u) ? EGL_PIXEL_BGRA8 : EGL_PIXEL_BGRX8;
+	} else {
+		return false;
+	}
+
+	const uint32_t rows = (uint32_t)((height < 0) ? -height : height);
+	const size_t stride = ((size_t)width * bpp + 31) / 32 * 4;
+	if (offset > size || stride * rows > size - offset) {
+		return false;
+	}
+	if (!EGL_ImageInit(image, (uint32_t)width, rows)) {
+		return false;
+	}
+
+	/* Rows are stored bottom to top unless the height is negative */
+	const uint8_t *first = bytes + offset;
+	ptrdiff_t pitch = (ptrdiff_t)stride;
+	if (height > 0) {
+		first += stride * (rows - 1);
+		pitch = -pitch;
+	}
+	EGL_PixelsConvert(first, pitch, format, image->width, image->height, image->pixels);
+	return true;
+}
+
+size_t EGL_ImageWriteBMP(const EGL_Image *image, uint8_t **out) {
+	/* 32-bit BGRA bit fields after a 56-byte header, rows top to bottom */
+	const size_t offset = 14 + 56;
+	const size_t pixels = (size_t)image->width * image->height;
+	const size_t size = offset + pixels * 4;
+	uint8_t *bmp = (uint8_t *)EGL_calloc(1, size);
+	*out = bmp;
+	if (!bmp || size > UINT32_MAX) {
+		EGL_free(bmp);
+		*out = NULL;
+		return 0;
+	}
+	bmp[0] = 'B';
+	bmp[1] = 'M';
+	write_u32(bmp + 2, (uint32_t)size);
+	write_u32(bmp + 10, (uint32_t)offset);
+	write_u32(bmp + 14, 56);
+	write_u32(bmp + 18, image->width);
+	write_u32(bmp + 22, (uint32_t)-(int32_t)image->height);
+	write_u16(bmp + 26, 1);
+	write_u16(bmp + 28, 32);
+	write_u32(bmp + 30, 3);
+	write_u32(bmp + 34, (uint32_t)(pixels * 4));
+	write_u32(bmp + 54, 0x00ff0000);
+	write_u32(bmp + 58, 0x0000ff00);
+	write_u32(bmp + 62, 0x000000ff);
+	write_u32(bmp + 66, 0xff000000u);
+	for (size_t i = 0; i < pixels; i++) {
+		const uint8_t *rgba = image->pixels + i * 4;
+		uint8_t *bgra = bmp + offset + i * 4;
+		bgra[0] = rgba[2];
+		bgra[1] = rgba[1];
+		bgra[2] = rgba[0];
+		bgra[3] = rgba[3];
+	}
+	return size;
+}
+
+double EGL_ImagePSNR(const uint8_t *a, const uint8_t *b, size_t pixels, bool alpha) {
+	const int channels = alpha ? 4 : 3;
+	double sum = 0.0;
+	for (size_t i = 0; i < pixels; i++) {
+		for (int c = 0; c < channels; c++) {
+			const double d = (double)a[i * 4 + c] - (double)b[i * 4 + c];
+			sum += d * d;
+		}
+	}
+	if (sum == 0.0) {
+		return INFINITY;
+	}
+	const double mse = sum / ((double)pixels * channels);
+	return 10.0 * log10(255.0 * 255.0 / mse);
+}
+
+bool EGL_MipChainBuild(EGL_MipChain *m, const EGL_Image *base) {
+	memset(m, 0, sizeof(*m));
+	call_once(&TABLES_ONCE, init_tables);
+
+	/* Every level in one allocation, largest first */
+	size_t total = 0;
+	uint32_t w = base->width, h = base->height;
+	while (m->count < EGL_TEXTURE_LEVELS_MAX) {
+		m->levels[m->count++] = (EGL_Image){ NULL, w, h };
+		total += (size_t)w * h * 4;
+		if (w == 1 && h == 1) {
+			break;
+		}
+		w = (w > 1) ? w / 2 : 1;
+		h = (h > 1) ? h / 2 : 1;
+	}
+	uint8_t *memory = (uint8_t *)EGL_malloc(total);
+	const size_t base_pixels = (size_t)base->width * base->height;
+	const size_t half_pixels = (m->count > 1) ? (size_t)m->levels[1].width * m->levels[1].height : 1;
+	float *linear[2] = { (float *)EGL_malloc(base_pixels * 4 * sizeof(float)), (float *)EGL_malloc(half_pixels * 4 * sizeof(float)) };
+	if (!memory || !linear[0] || !linear[1]) {
+		EGL_free(memory);
+		EGL_free(linear[0]);
+		EGL_free(linear[1]);
+		memset(m, 0, sizeof(*m));
+		return false;
+	}
+
+	size_t offset = 0;
+	for (uint32_t i = 0; i < m->count; i++) {
+		m->levels[i].pixels = memory + offset;
+		offset += (size_t)m->levels[i].width * m->levels[i].height * 4;
+	}
+	memcpy(m->levels[0].pixels, base->pixels, base_pixels * 4);
+
+	/* Each level comes from the previous one's linear values, not its rounded bytes */
+	to_linear(base->pixels, base_pixels, linear[0]);
+	for (uint32_t i = 1; i < m->count; i++) {
+		const EGL_Image *from = &m->levels[i - 1];
+		downsample(linear[(i - 1) & 1], from->width, from->height, linear[i & 1], m->levels[i].pixels);
+	}
+	EGL_free(linear[0]);
+	EGL_free(linear[1]);
+	return true;
+}
+
+void EGL_MipChainFree(EGL_MipChain *m) {
+	EGL_free(m->count ? m->levels[0].pixels : NULL);
+	memset(m, 0, sizeof(*m));
+}
+
+size_t EGL_TextureLevelSize(EGL_TextureFormat format, uint32_t width, uint32_t height) {
+	const size_t blocks = (size_t)((width + 3) / 4) * ((height + 3) / 4);
+	switch (format) {
+	case EGL_TEXTURE_BC1:
+		return blocks * 8;
+	case EGL_TEXTURE_BC7:
+		return blocks * 16;
+	case EGL_TEXTURE_RGBA8:
+	default:
+		return (size_t)width * height * 4;
+	}
+}
+
+void EGL_TextureEncode(const EGL_Image *image, EGL_TextureFormat format, EGL_TextureQuality quality, uint8_t *out) {
+	if (format == EGL_TEXTURE_RGBA8) {
+		memcpy(out, image->pixels, (size_t)image->width * image->height * 4);
+		return;
+	}
+	const size_t block_size = (format == EGL_TEXTURE_BC1) ? 8 : 16;
+	const uint32_t bw = (image->width + 3) / 4, bh = (image->height + 3) / 4;
+	for (uint32_t by = 0; by < bh; by++) {
+		for (uint32_t bx = 0; bx < bw; bx++) {
+			uint8_t block[16][4];
+			load_block(image, bx, by, block);
+			uint8_t *dst = out + ((size_t)by * bw + bx) * block_size;
+			if (format == EGL_TEXTURE_BC1) {
+				bc1_encode((const uint8_t (*)[4])block, quality, dst);
+			} else {
+				bc7_encode((const uint8_t (*)[4])block, quality, dst);
+			}
+		}
+	}
+}
+
+void EGL_TextureDecode(const uint8_t *data, EGL_TextureFormat format, uint32_t width, uint32_t height, uint8_t *rgba) {
+	if (format == EGL_TEXTURE_RGBA8) {
+		memcpy(rgba, data, (size_t)width * height * 4);
+		return;
+	}
+	const size_t block_size = (format == EGL_TEXTURE_BC1) ? 8 : 16;
+	const uint32_t bw = (width + 3) / 4, bh = (height + 3) / 4;
+	for (uint32_t by = 0; by < bh; by++) {
+		for (uint32_t bx = 0; bx < bw; bx++) {
+			uint8_t block[16][4];
+			const uint8_t *src = data + ((size_t)by * bw + bx) * block_size;
+			if (format == EGL_TEXTURE_BC1) {
+				bc1_decode(src, block);
+			} else {
+				bc7_decode(src, block);
+			}
+			store_block(rgba, width, height, bx, by, block);
+		}
+	}
+}
+
+size_t EGL_TextureCook(const EGL_Image *base, EGL_TextureFormat format, EGL_TextureQuality quality, bool mips, uint8_t **out) {
+	*out = NULL;
+	EGL_MipChain chain = { .levels = { *base }, .count = 1 };
+	if (mips && !EGL_MipChainBuild(&chain, base)) {
+		return 0;
+	}
+
+	size_t size = sizeof(EGL_TextureHeader);
+	for (uint32_t i = 0; i < chain.count; i++) {
+		size += EGL_TextureLevelSize(format, chain.levels[i].width, chain.levels[i].height);
+	}
+	uint8_t *cooked = (uint8_t *)EGL_malloc(size);
+	if (cooked) {
+		const EGL_TextureHeader header = {
+			.magic = EGL_TEXTURE_MAGIC,
+			.version = EGL_TEXTURE_VERSION,
+			.format = (uint32_t)format,
+			.width = base->width,
+			.height = base->height,
+			.levels = chain.count,
+		};
+		memcpy(cooked, &header, sizeof(header));
+		size_t offset = sizeof(header);
+		for (uint32_t i = 0; i < chain.count; i++) {
+			EGL_TextureEncode(&chain.levels[i], format, quality, cooked + offset);
+			offset += EGL_TextureLevelSize(format, chain.levels[i].width, chain.levels[i].height);
+		}
+	}
+	if (mips) {
+		EGL_MipChainFree(&chain);
+	}
+	*out = cooked;
+	return cooked ? size : 0;
+}
+
+bool EGL_TextureParse(EGL_Texture *t, const void *data, size_t size) {
+	memset(t, 0, sizeof(*t));
+	EGL_TextureHeader header;
+	if (size < sizeof(header)) {
+		return false;
+	}
+	memcpy(&header, data, sizeof(header));
+	if (memcmp(header.magic, EGL_TEXTURE_MAGIC, sizeof(EGL_TEXTURE_MAGIC)) != 0 || header.version != EGL_TEXTURE_VERSION ||
+		header.format > EGL_TEXTURE_BC7 || header.levels == 0 || header.levels > EGL_TEXTURE_LEVELS_MAX ||
+		header.width == 0 || header.width > SIZE_MAX_PIXELS || header.height == 0 || header.height > SIZE_MAX_PIXELS) {
+		return false;
+	}
+
+	t->format = (EGL_TextureFormat)header.format;
+	t->width = header.width;
+	t->height = header.height;
+	t->levels = header.levels;
+	size_t offset = sizeof(header);
+	uint32_t w = header.width, h = header.height;
+	for (uint32_t i = 0; i < header.levels; i++) {
+		const size_t level = EGL_TextureLevelSize(t->format, w, h);
+		if (level > size - offset) {
+			memset(t, 0, sizeof(*t));
+			return false;
+		}
+		t->data[i] = (const uint8_t *)data + offset;
+		t->sizes[i] = level;
+		offset += level;
+		w = (w > 1) ? w / 2 : 1;
+		h = (h > 1) ? h / 2 : 1;
+	}
+	t->size = offset - sizeof(header);
+	return true;
+}
@@ -0,0 +1,83 @@
+#include <EGL/EGL_bench.h>
+#include <EGL/EGL_texture.h>
+
+#include <stdlib.h>
+
+
+#define IMAGE_SIZE 512
+
+
+static uint32_t lcg(uint32_t *state) {
+	*state = *state * 1664525u + 1013904223u;
+	return *state >> 8;
+}
+
+
+void EGL_TextureBench(void) {
+	EGL_DECLARE_BENCH(EGL_texture);
+
+	const size_t pixels = (size_t)IMAGE_SIZE * IMAGE_SIZE;
+	EGL_Image image;
+	uint8_t *source = (uint8_t *)malloc(pixels * 4);
+	uint8_t *encoded = (uint8_t *)malloc(pixels * 4);
+	if (!source || !encoded || !EGL_ImageInit(&image, IMAGE_SIZE, IMAGE_SIZE)) {
+		printf(" failed to allocate\n");
+		free(source);
+		free(encoded);
+		return;
+	}
+
+	/* Noisy gradients, so the block encoders cannot take shortcuts */
+	uint32_t state = 47;
+	for (size_t i = 0; i < pixels; i++) {
+		const uint32_t x = (uint32_t)(i % IMAGE_SIZE), y = (uint32_t)(i / IMAGE_SIZE), noise = lcg(&state) & 15;
+		image.pixels[i * 4 + 0] = (uint8_t)(x / 2 + noise);
+		image.pixels[i * 4 + 1] = (uint8_t)(y / 2 + noise);
+		image.pixels[i * 4 + 2] = (uint8_t)((x + y) / 4 + noise);
+		image.pixels[i * 4 + 3] = 255;
+	}
+	for (size_t i = 0; i < pixels * 4; i++) {
+		source[i] = (uint8_t)lcg(&state);
+	}
+
+#define RUN(name, count, ...) do { \
+		double best = 1e30; \
+		for (int r = 0; r < EGL_BENCH_REPEATS; r++) { \
+			double begin = EGL_BenchNow(); \
+			for (int i = 0; i < (count); i++) { \
+				__VA_ARGS__; \
+			} \
+			double elapsed = EGL_BenchNow() - begin; \
+			best = (elapsed < best) ? elapsed : best; \
+		} \
+		EGL_BenchReport(name, best, (double)(count) * pixels, "pixel"); \
+		EGL_BENCH_SINK += encoded[0]; \
+	} while (0)
+
+	/* Rows bottom up, as BMPs store them */
+	const ptrdiff_t bgra_pitch = -(ptrdiff_t)IMAGE_SIZE * 4, packed_pitch = -(ptrdiff_t)IMAGE_SIZE * 2;
+	RUN("convert BGRA8", 20, EGL_PixelsConvert(source + pixels * 4 + bgra_pitch, bgra_pitch, EGL_PIXEL_BGRA8, IMAGE_SIZE, IMAGE_SIZE, encoded));
+	RUN("convert RGB565", 20, EGL_PixelsConvert(source + pixels * 2 + packed_pitch, packed_pitch, EGL_PIXEL_RGB565, IMAGE_SIZE, IMAGE_SIZE, encoded));
+	RUN("convert XRGB1555", 20, EGL_PixelsConvert(source + pixels * 2 + packed_pitch, packed_pitch, EGL_PIXEL_XRGB1555, IMAGE_SIZE, IMAGE_SIZE, encoded));
+
+	RUN("mip chain", 5, {
+		EGL_MipChain m;
+		if (EGL_MipChainBuild(&m, &image)) {
+			EGL_BENCH_SINK += m.levels[m.count - 1].pixels[0];
+			EGL_MipChainFree(&m);
+		}
+	});
+
+	RUN("BC1 fast", 5, EGL_TextureEncode(&image, EGL_TEXTURE_BC1, EGL_TEXTURE_FAST, encoded));
+	RUN("BC1 normal", 5, EGL_TextureEncode(&image, EGL_TEXTURE_BC1, EGL_TEXTURE_NORMAL, encoded));
+	RUN("BC1 best", 2, EGL_TextureEncode(&image, EGL_TEXTURE_BC1, EGL_TEXTURE_BEST, encoded));
+	RUN("BC7 fast", 5, EGL_TextureEncode(&image, EGL_TEXTURE_BC7, EGL_TEXTURE_FAST, encoded));
+	RUN("BC7 normal", 5, EGL_TextureEncode(&image, EGL_TEXTURE_BC7, EGL_TEXTURE_NORMAL, encoded));
+	RUN("BC7 best", 2, EGL_TextureEncode(&image, EGL_TEXTURE_BC7, EGL_TEXTURE_BEST, encoded));
+	RUN("BC7 decode", 5, EGL_TextureDecode(encoded, EGL_TEXTURE_BC7, IMAGE_SIZE, IMAGE_SIZE, source));
+#undef RUN
+
+	free(source);
+	free(encoded);
+	EGL_ImageFree(&image);
+}
@@ -0,0 +1,322 @@
+#include <EGL/EGL_testing.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+#define IMAGE_SIZE 64
+#define CONVERT_WIDTH 13 // Not a multiple of the SIMD width, so the scalar tail runs too.
+#define CONVERT_HEIGHT 3
+
+
+/* Smooth gradients with a little noise */
+static void fill_image(EGL_Image *image) {
+	uint32_t state = 47;
+	for (uint32_t y = 0; y < image->height; y++) {
+		for (uint32_t x = 0; x < image->width; x++) {
+			state = state * 1664525u + 1013904223u;
+			const int noise = (int)(state >> 30) - 2;
+			uint8_t *px = image->pixels + ((size_t)y * image->width + x) * 4;
+			px[0] = (uint8_t)(x * 255 / image->width);
+			px[1] = (uint8_t)(128 + 100 * sin(y * 0.2) + noise);
+			px[2] = (uint8_t)((x + y) * 2 + noise + 8);
+			px[3] = 255;
+		}
+	}
+}
+
+static double round_trip(const EGL_Image *image, EGL_TextureFormat format, EGL_TextureQuality quality) {
+	uint8_t *encoded = (uint8_t *)malloc(EGL_TextureLevelSize(format, image->width, image->height));
+	uint8_t *decoded = (uint8_t *)malloc((size_t)image->width * image->height * 4);
+	double psnr = 0.0;
+	if (encoded && decoded) {
+		EGL_TextureEncode(image, format, quality, encoded);
+		EGL_TextureDecode(encoded, format, image->width, image->height, decoded);
+		psnr = EGL_ImagePSNR(image->pixels, decoded, (size_t)image->width * image->height, true);
+	}
+	free(encoded);
+	free(decoded);
+	return psnr;
+}
+
+
+/**
+ * Every source layout converts to the same RGBA8, read top down or bottom up.
+ */
+static void EGL_TextureConvertTest(EGL_Test *T) {
+	EGL_DECLARE_TEST;
+
+	/*
+	 * Colours whose every field survives a 5-bit round trip exactly. Green's
+	 * top three bits match, so it widens to the same byte from 5 or 6 bits.
+	 */
+	uint8_t expected[CONVERT_HEIGHT][CONVERT_WIDTH][4];
+	uint8_t bgra[CONVERT_HEIGHT][CONVERT_WIDTH][4], bgr[CONVERT_HEIGHT][CONVERT_WIDTH][3];
+	uint16_t rgb565[CONVERT_HEIGHT][CONVERT_WIDTH], xrgb1555[CONVERT_HEIGHT][CONVERT_WIDTH];
+	for (int y = 0; y < CONVERT_HEIGHT; y++) {
+		for (int x = 0; x < CONVERT_WIDTH; x++) {
+			const uint32_t r = (uint32_t)(x * 2 + y) & 31, g = ((uint32_t)(x + 7 * y) & 3) | ((x & 1) ? 28 : 0), b = (uint32_t)(31 - x) & 31;
+			const uint8_t r8 = (uint8_t)(r << 3 | r >> 2), g8 = (uint8_t)(g << 3 | g >> 2), b8 = (uint8_t)(b << 3 | b >> 2);
+			memcpy(expected[y][x], (uint8_t[4]){ r8, g8, b8, 255 }, 4);
+			memcpy(bgra[y][x], (uint8_t[4]){ b8, g8, r8, 255 }, 4);
+			memcpy(bgr[y][x], (uint8_t[3]){ b8, g8, r8 }, 3);
+			rgb565[y][x] = (uint16_t)(r << 11 | (g << 1 | g >> 4) << 5 | b);
+			xrgb1555[y][x] = (uint16_t)(0x8000 | r << 10 | g << 5 | b);
+		}
+	}
+
+	struct {
+		const char *name;
+		const void *pixels;
+		ptrdiff_t pitch;
+		EGL_PixelFormat format;
+	} cases[] = {
+		{ "RGBA8", expected, sizeof(expected[0]), EGL_PIXEL_RGBA8 },
+		{ "BGRA8", bgra, sizeof(bgra[0]), EGL_PIXEL_BGRA8 },
+		{ "BGRX8", bgra, sizeof(bgra[0]), EGL_PIXEL_BGRX8 },
+		{ "BGR8", bgr, sizeof(bgr[0]), EGL_PIXEL_BGR8 },
+		{ "RGB565", rgb565, sizeof(rgb565[0]), EGL_PIXEL_RGB565 },
+		{ "XRGB1555", xrgb1555, sizeof(xrgb1555[0]), EGL_PIXEL_XRGB1555 },
+	};
+	for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+		uint8_t rgba[CONVERT_HEIGHT][CONVERT_WIDTH][4];
+		EGL_PixelsConvert(cases[c].pixels, cases[c].pitch, cases[c].format, CONVERT_WIDTH, CONVERT_HEIGHT, &rgba[0][0][0]);
+		if (memcmp(rgba, expected, sizeof(rgba)) != 0) {
+			EGL_DECLARE_ERROR("Converting %s top down gave the wrong pixels.", cases[c].name);
+		}
+
+		/* Start at the last row and step backwards: the rows come out flipped */
+		const uint8_t *last = (const uint8_t *)cases[c].pixels + cases[c].pitch * (CONVERT_HEIGHT - 1);
+		EGL_PixelsConvert(last, -cases[c].pitch, cases[c].format, CONVERT_WIDTH, CONVERT_HEIGHT, &rgba[0][0][0]);
+		for (int y = 0; y < CONVERT_HEIGHT; y++) {
+			if (memcmp(rgba[y], expected[CONVERT_HEIGHT - 1 - y], sizeof(rgba[y])) != 0) {
+				EGL_DECLARE_ERROR("Converting %s bottom up gave the wrong row %d.", cases[c].name, y);
+			}
+		}
+	}
+}
+
+/**
+ * A bottom-up RGB565 bitfield BMP, like data/bricks.bmp, reads right side up,
+ * writing it back out keeps every pixel, and a truncated one does not read.
+ */
+static void EGL_TextureBMPTest(EGL_Test *T) {
+	EGL_DECLARE_TEST;
+
+	/* 3 x 2 pixels: rows pad to 8 bytes, stored bottom row first */
+	enum { WIDTH = 3, HEIGHT = 2, STRIDE = 8, OFFSET = 66 };
+	uint8_t file[OFFSET + STRIDE * HEIGHT] = { 'B', 'M' };
+	const uint32_t fields[] = {
+		2, sizeof(file), 10, OFFSET, 14, 40, 18, WIDTH, 22, HEIGHT, 30, 3, 54, 0xf800, 58, 0x07e0, 62, 0x001f,
+	};
+	for (size_t f = 0; f < sizeof(fields) / sizeof(fields[0]); f += 2) {
+		for (int b = 0; b < 4; b++) {
+			file[fields[f] + (uint32_t)b] = (uint8_t)(fields[f + 1] >> (8 * b));
+		}
+	}
+	file[28] = 16;
+	const uint16_t top[WIDTH] = { 0xf800, 0x07e0, 0x001f }, bottom[WIDTH] = { 0xffff, 0x0000, 0x8410 };
+	memcpy(file + OFFSET, bottom, sizeof(bottom));
+	memcpy(file + OFFSET + STRIDE, top, sizeof(top));
+
+	EGL_Image image;
+	if (!EGL_ImageReadBMP(&image, file, sizeof(file))) {
+		EGL_DECLARE_ERROR("Failed to read a %d x %d BMP.", WIDTH, HEIGHT);
+		return;
+	}
+	const uint8_t expected[HEIGHT * WIDTH][4] = {
+		{ 255, 0, 0, 255 }, { 0, 255, 0, 255 }, { 0, 0, 255, 255 },
+		{ 255, 255, 255, 255 }, { 0, 0, 0, 255 }, { 132, 130, 132, 255 },
+	};
+	if (image.width != WIDTH || image.height != HEIGHT || memcmp(image.pixels, expected, sizeof(expected)) != 0) {
+		EGL_DECLARE_ERROR("Read a BMP as %u x %u with the wrong pixels.", image.width, image.height);
+	}
+
+	/* Written back out with alpha, it reads the same */
+	image.pixels[3] = 128;
+	uint8_t *written;
+	const size_t size = EGL_ImageWriteBMP(&image, &written);
+	EGL_Image again;
+	if (!size || !EGL_ImageReadBMP(&again, written, size)) {
+		EGL_DECLARE_ERROR("Failed to read back a written %zu byte BMP.", size);
+	} else {
+		if (again.width != WIDTH || again.height != HEIGHT || memcmp(again.pixels, image.pixels, sizeof(expected)) != 0) {
+			EGL_DECLARE_ERROR("Wrote a BMP that reads back as %u x %u with other pixels.", again.width, again.height);
+		}
+		EGL_ImageFree(&again);
+	}
+	EGL_free(written);
+	EGL_ImageFree(&image);
+
+	if (EGL_ImageReadBMP(&image, file, sizeof(file) - 1)) {
+		EGL_DECLARE_ERROR("Read a BMP cut short by %d byte.", 1);
+		EGL_ImageFree(&image);
+	}
+}
+
+/**
+ * Mips average in linear light: a black and white checkerboard shrinks to
+ * sRGB 188, not 128, and odd sizes round down to 1 x 1.
+ */
+static void EGL_TextureMipTest(EGL_Test *T) {
+	EGL_DECLARE_TEST;
+
+	EGL_Image base;
+	if (!EGL_ImageInit(&base, 8, 8)) {
+		EGL_DECLARE_ERROR("Failed to allocate %d x %d.", 8, 8);
+		return;
+	}
+	for (int i = 0; i < 64; i++) {
+		const uint8_t v = ((i % 8 + i / 8) & 1) ? 255 : 0;
+		memcpy(base.pixels + i * 4, (uint8_t[4]){ v, v, v, 255 }, 4);
+	}
+	EGL_MipChain m;
+	if (!EGL_MipChainBuild(&m, &base)) {
+		EGL_DECLARE_ERROR("Failed to build the mips of %d x %d.", 8, 8);
+		EGL_ImageFree(&base);
+		return;
+	}
+	if (m.count != 4 || m.levels[3].width != 1 || m.levels[3].height != 1 || memcmp(m.levels[0].pixels, base.pixels, 64 * 4) != 0) {
+		EGL_DECLARE_ERROR("Built %u levels from %d x 8.", m.count, 8);
+	}
+	for (uint32_t l = 1; l < m.count; l++) {
+		for (uint32_t i = 0; i < m.levels[l].width * m.levels[l].height; i++) {
+			const uint8_t *px = m.levels[l].pixels + i * 4;
+			if (px[0] < 187 || px[0] > 189 || px[1] != px[0] || px[2] != px[0] || px[3] != 255) {
+				EGL_DECLARE_ERROR("Level %u averaged black and white to %u.", l, px[0]);
+				break;
+			}
+		}
+	}
+	EGL_MipChainFree(&m);
+	EGL_ImageFree(&base);
+
+	if (!EGL_ImageInit(&base, 5, 3)) {
+		EGL_DECLARE_ERROR("Failed to allocate %d x %d.", 5, 3);
+		return;
+	}
+	memset(base.pixels, 200, 5 * 3 * 4);
+	if (!EGL_MipChainBuild(&m, &base) || m.count != 3 || m.levels[1].width != 2 || m.levels[1].height != 1 || m.levels[2].pixels[0] != 200) {
+		EGL_DECLARE_ERROR("Built %u levels from %d x 3.", m.count, 5);
+	}
+	EGL_MipChainFree(&m);
+	EGL_ImageFree(&base);
+}
+
+/**
+ * Both block formats keep a gradient image above a PSNR floor, searching
+ * harder never loses quality, and BC1 keeps transparent pixels transparent.
+ */
+static void EGL_TextureCompressTest(EGL_Test *T) {
+	EGL_DECLARE_TEST;
+
+	EGL_Image image;
+	if (!EGL_ImageInit(&image, IMAGE_SIZE, IMAGE_SIZE)) {
+		EGL_DECLARE_ERROR("Failed to allocate %d x %d.", IMAGE_SIZE, IMAGE_SIZE);
+		return;
+	}
+	fill_image(&image);
+
+	const struct {
+		EGL_TextureFormat format;
+		const char *name;
+		double floor[3];
+	} cases[] = {
+		{ EGL_TEXTURE_BC1, "BC1", { 34.0, 37.0, 37.5 } },
+		{ EGL_TEXTURE_BC7, "BC7", { 35.5, 39.0, 39.0 } },
+	};
+	for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+		double previous = 0.0;
+		for (int q = EGL_TEXTURE_FAST; q <= EGL_TEXTURE_BEST; q++) {
+			const double psnr = round_trip(&image, cases[c].format, (EGL_TextureQuality)q);
+			if (psnr < cases[c].floor[q] || psnr < previous - 0.1) {
+				EGL_DECLARE_ERROR("%s at quality %d gave %.2f dB.", cases[c].name, q, psnr);
+			}
+			previous = psnr;
+		}
+	}
+	if (round_trip(&image, EGL_TEXTURE_RGBA8, EGL_TEXTURE_FAST) != INFINITY) {
+		EGL_DECLARE_ERROR("RGBA8 was not lossless on %d x %d.", IMAGE_SIZE, IMAGE_SIZE);
+	}
+
+	/* A 6 x 5 image cut into partial blocks, with a transparent hole */
+	EGL_ImageFree(&image);
+	if (!EGL_ImageInit(&image, 6, 5)) {
+		EGL_DECLARE_ERROR("Failed to allocate %d x %d.", 6, 5);
+		return;
+	}
+	fill_image(&image);
+	image.pixels[(1 * 6 + 2) * 4 + 3] = 0;
+	uint8_t encoded[4 * 8], decoded[6 * 5 * 4];
+	EGL_TextureEncode(&image, EGL_TEXTURE_BC1, EGL_TEXTURE_NORMAL, encoded);
+	EGL_TextureDecode(encoded, EGL_TEXTURE_BC1, 6, 5, decoded);
+	for (int i = 0; i < 6 * 5; i++) {
+		if ((decoded[i * 4 + 3] == 0) != (i == 1 * 6 + 2)) {
+			EGL_DECLARE_ERROR("BC1 gave pixel %d alpha %u.", i, decoded[i * 4 + 3]);
+		}
+	}
+	EGL_ImageFree(&image);
+}
+
+/**
+ * A cooked texture parses back with every level where it was written, and a
+ * truncated one does not parse.
+ */
+static void EGL_TextureCookTest(EGL_Test *T) {
+	EGL_DECLARE_TEST;
+
+	EGL_Image image;
+	if (!EGL_ImageInit(&image, 20, 12)) {
+		EGL_DECLARE_ERROR("Failed to allocate %d x %d.", 20, 12);
+		return;
+	}
+	fill_image(&image);
+	uint8_t *cooked = NULL;
+	const size_t size = EGL_TextureCook(&image, EGL_TEXTURE_BC7, EGL_TEXTURE_NORMAL, true, &cooked);
+	EGL_Texture t;
+	if (!size || !EGL_TextureParse(&t, cooked, size)) {
+		EGL_DECLARE_ERROR("Failed to cook or parse %d x 12.", 20);
+		EGL_free(cooked);
+		EGL_ImageFree(&image);
+		return;
+	}
+
+	/* 20 x 12, 10 x 6, 5 x 3, 2 x 1, 1 x 1 */
+	const size_t sizes[] = { 5 * 3 * 16, 3 * 2 * 16, 2 * 1 * 16, 16, 16 };
+	size_t offset = sizeof(EGL_TextureHeader);
+	if (t.format != EGL_TEXTURE_BC7 || t.width != 20 || t.height != 12 || t.levels != 5 || t.size != size - offset) {
+		EGL_DECLARE_ERROR("Parsed %u levels of %u x %u.", t.levels, t.width, t.height);
+	}
+	for (uint32_t l = 0; l < t.levels && l < 5; l++) {
+		if (t.sizes[l] != sizes[l] || t.data[l] != cooked + offset) {
+			EGL_DECLARE_ERROR("Level %u has %zu bytes at the wrong place.", l, t.sizes[l]);
+		}
+		offset += sizes[l];
+	}
+	uint8_t decoded[20 * 12 * 4];
+	EGL_TextureDecode(t.data[0], t.format, t.width, t.height, decoded);
+	if (EGL_ImagePSNR(image.pixels, decoded, 20 * 12, true) < 31.0) {
+		EGL_DECLARE_ERROR("Level 0 decoded at %.2f dB.", EGL_ImagePSNR(image.pixels, decoded, 20 * 12, true));
+	}
+
+	if (EGL_TextureParse(&t, cooked, size - 1) || EGL_TextureParse(&t, cooked, sizeof(EGL_TextureHeader) - 1)) {
+		EGL_DECLARE_ERROR("Parsed a texture of %zu bytes cut short.", size);
+	}
+	cooked[0] ^= 0xff;
+	if (EGL_TextureParse(&t, cooked, size)) {
+		EGL_DECLARE_ERROR("Parsed a texture with magic byte %02x.", cooked[0]);
+	}
+	EGL_free(cooked);
+	EGL_ImageFree(&image);
+}
+
+
+void EGL_TextureTest(EGL_TestModule *M) {
+	EGL_DECLARE_MODULE(EGL_texture);
+
+	EGL_RUN_TEST(EGL_TextureConvertTest);
+	EGL_RUN_TEST(EGL_TextureBMPTest);
+	EGL_RUN_TEST(EGL_TextureMipTest);
+	EGL_RUN_TEST(EGL_TextureCompressTest);
+	EGL_RUN_TEST(EGL_TextureCookTest);
+}
@@ -0,0 +1,362 @@
+#include <EGL/EGL_transform.h>
+#include <EGL/EGL_parallel.h>
+#include <EGL/EGL_memory.h>
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+
+/* Arrays are padded to a multiple of 4 with identity transforms, so groups never need a scalar tail */
+#define PADDED(n) (((n) + 3u) & ~3u)
+
+
+/*
+ * Rotation matrix of a quaternion, with the same order of operations as
+ * cglm's glm_quat_mat4 so the results match EGL_TransformUpdate.
+ */
+static void rotation_matrix(float x, float y, float z, float w, float *r) {
+	const float norm = sqrtf(x * x + y * y + z * z + w * w);
+	const float s = (norm > 0.0f) ? 2.0f / norm : 0.0f;
+
+	const float xx = s * x * x, xy = s * x * y, wx = s * w * x;
+	const float yy = s * y * y, yz = s * y * z, wy = s * w * y;
+	const float zz = s * z * z, xz = s * x * z, wz = s * w * z;
+
+	r[0]  = 1.0f - yy - zz;
+	r[1]  = xy + wz;
+	r[2]  = xz - wy;
+	r[3]  = 0.0f;
+	r[4]  = xy - wz;
+	r[5]  = 1.0f - xx - zz;
+	r[6]  = yz + wx;
+	r[7]  = 0.0f;
+	r[8]  = xz + wy;
+	r[9]  = yz - wx;
+	r[10] = 1.0f - xx - yy;
+	r[11] = 0.0f;
+	r[12] = 0.0f;
+	r[13] = 0.0f;
+	r[14] = 0.0f;
+	r[15] = 1.0f;
+}
+
+#ifndef __SSE2__
+/* S * R scales row i of the rotation by scale i. */
+static void compose_one(const EGL_TransformBatch *b, uint32_t i, float *m) {
+	rotation_matrix(b->rotation_x[i], b->rotation_y[i], b->rotation_z[i], b->rotation_w[i], m);
+	for (int c = 0; c < 3; c++) {
+		m[c * 4 + 0] = b->scale_x[i] * m[c * 4 + 0];
+		m[c * 4 + 1] = b->scale_y[i] * m[c * 4 + 1];
+		m[c * 4 + 2] = b->scale_z[i] * m[c * 4 + 2];
+	}
+	m[12] = b->translation_x[i];
+	m[13] = b->translation_y[i];
+	m[14] = b->translation_z[i];
+}
+#endif
+
+#ifdef __SSE2__
+/* Transpose one matrix column from lanes to transforms and store it for the dirty lanes. */
+static void store_column(float *models, uint32_t first, uint32_t lanes, int column, __m128 r0, __m128 r1, __m128 r2, __m128 r3) {
+	_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+	const __m128 rows[4] = { r0, r1, r2, r3 };
+	for (uint32_t l = 0; l < 4; l++) {
+		if (lanes & (1u << l)) {
+			_mm_storeu_ps(models + (size_t)(first + l) * 16 + column * 4, rows[l]);
+		}
+	}
+}
+
+/* Compose four transforms starting at `first`; `lanes` holds their dirty bits. */
+static void compose_four(const EGL_TransformBatch *b, uint32_t first, uint32_t lanes) {
+	const __m128 x = _mm_loadu_ps(b->rotation_x + first);
+	const __m128 y = _mm_loadu_ps(b->rotation_y + first);
+	const __m128 z = _mm_loadu_ps(b->rotation_z + first);
+	const __m128 w = _mm_loadu_ps(b->rotation_w + first);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+
+	__m128 norm = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_add_ps(
+		_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)), _mm_mul_ps(w, w)));
+	__m128 s = _mm_and_ps(_mm_cmpgt_ps(norm, zero), _mm_div_ps(_mm_set1_ps(2.0f), norm));
+
+	const __m128 s_x = _mm_mul_ps(s, x);
+	const __m128 s_y = _mm_mul_ps(s, y);
+	const __m128 s_z = _mm_mul_ps(s, z);
+	const __m128 s_w = _mm_mul_ps(s, w);
+	const __m128 xx = _mm_mul_ps(s_x, x), xy = _mm_mul_ps(s_x, y), wx = _mm_mul_ps(s_w, x);
+	const __m128 yy = _mm_mul_ps(s_y, y), yz = _mm_mul_ps(s_y, z), wy = _mm_mul_ps(s_w, y);
+	const __m128 zz = _mm_mul_ps(s_z, z), xz = _mm_mul_ps(s_x, z), wz = _mm_mul_ps(s_w, z);
+	const __m128 sx = _mm_loadu_ps(b->scale_x + first);
+	const __m128 sy = _mm_loadu_ps(b->scale_y + first);
+	const __m128 sz = _mm_loadu_ps(b->scale_z + first);
+
+	store_column(b->models, first, lanes, 0,
+		_mm_mul_ps(sx, _mm_sub_ps(_mm_sub_ps(one, yy), zz)),
+		_mm_mul_ps(sy, _mm_add_ps(xy, wz)),
+		_mm_mul_ps(sz, _mm_sub_ps(xz, wy)),
+		zero);
+	store_column(b->models, first, lanes, 1,
+		_mm_mul_ps(sx, _mm_sub_ps(xy, wz)),
+		_mm_mul_ps(sy, _mm_sub_ps(_mm_sub_ps(one, xx), zz)),
+		_mm_mul_ps(sz, _mm_add_ps(yz, wx)),
+		zero);
+	store_column(b->models, first, lanes, 2,
+		_mm_mul_ps(sx, _mm_add_ps(xz, wy)),
+		_mm_mul_ps(sy, _mm_sub_ps(yz, wx)),
+		_mm_mul_ps(sz, _mm_sub_ps(_mm_sub_ps(one, xx), yy)),
+		zero);
+	store_column(b->models, first, lanes, 3,
+		_mm_loadu_ps(b->translation_x + first),
+		_mm_loadu_ps(b->translation_y + first),
+		_mm_loadu_ps(b->translation_z + first),
+		one);
+}
+#endif
+
+/* Each invocation owns whole dirty words (64 transforms, 4 KiB of matrices), so no cache line is shared. */
+static void update_kernel(void *data, int index, int count) {
+	EGL_TransformBatch *b = (EGL_TransformBatch *)data;
+
+	size_t begin, end;
+	EGL_ParallelRange((b->count + 63) / 64, index, count, &begin, &end);
+	EGL_TransformBatchUpdateWords(b, begin, end);
+}
+
+typedef struct {
+	EGL_TransformBatch *batch;
+	const float *omega_x;
+	const float *omega_y;
+	const float *omega_z;
+	float dt;
+	bool renormalize;
+} Integrate;
+
+static void integrate_kernel(void *data, int index, int count) {
+	Integrate *g = (Integrate *)data;
+	EGL_TransformBatch *b = g->batch;
+
+	size_t begin, end;
+	EGL_ParallelRange((b->count + 63) / 64, index, count, &begin, &end);
+	for (size_t word = begin; word < end; word++) {
+		b->dirty[word] = ~(uint64_t)0;
+	}
+	if (end == (b->count + 63) / 64 && (b->count & 63)) {
+		b->dirty[end - 1] = ((uint64_t)1 << (b->count & 63)) - 1; // Padding is never dirty.
+	}
+
+	size_t i = begin * 64;
+	const size_t last = (end * 64 < b->count) ? end * 64 : b->count;
+
+#ifdef __SSE2__
+	const __m128 half_dt = _mm_set1_ps(0.5f * g->dt);
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 zero = _mm_setzero_ps();
+	for (; i + 4 <= last; i += 4) {
+		const __m128 hx = _mm_mul_ps(half_dt, _mm_loadu_ps(g->omega_x + i));
+		const __m128 hy = _mm_mul_ps(half_dt, _mm_loadu_ps(g->omega_y + i));
+		const __m128 hz = _mm_mul_ps(half_dt, _mm_loadu_ps(g->omega_z + i));
+		const __m128 h2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(hx, hx), _mm_mul_ps(hy, hy)), _mm_mul_ps(hz, hz));
+		const __m128 h4 = _mm_mul_ps(h2, h2);
+		const __m128 s = _mm_add_ps(_mm_sub_ps(one, _mm_mul_ps(h2, _mm_set1_ps(1.0f / 6.0f))), _mm_mul_ps(h4, _mm_set1_ps(1.0f / 120.0f)));
+		const __m128 c = _mm_add_ps(_mm_sub_ps(one, _mm_mul_ps(h2, _mm_set1_ps(0.5f))), _mm_mul_ps(h4, _mm_set1_ps(1.0f / 24.0f)));
+		const __m128 dx = _mm_mul_ps(hx, s);
+		const __m128 dy = _mm_mul_ps(hy, s);
+		const __m128 dz = _mm_mul_ps(hz, s);
+
+		/* Same terms in the same order as EGL_QuatMul */
+		const __m128 qx = _mm_loadu_ps(b->rotation_x + i);
+		const __m128 qy = _mm_loadu_ps(b->rotation_y + i);
+		const __m128 qz = _mm_loadu_ps(b->rotation_z + i);
+		const __m128 qw = _mm_loadu_ps(b->rotation_w + i);
+		__m128 x = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(qw, dx), _mm_mul_ps(qx, c)), _mm_mul_ps(qy, dz)), _mm_mul_ps(qz, dy));
+		__m128 y = _mm_add_ps(_mm_add_ps(_mm_sub_ps(_mm_mul_ps(qw, dy), _mm_mul_ps(qx, dz)), _mm_mul_ps(qy, c)), _mm_mul_ps(qz, dx));
+		__m128 z = _mm_add_ps(_mm_sub_ps(_mm_add_ps(_mm_mul_ps(qw, dz), _mm_mul_ps(qx, dy)), _mm_mul_ps(qy, dx)), _mm_mul_ps(qz, c));
+		__m128 w = _mm_sub_ps(_mm_sub_ps(_mm_sub_ps(_mm_mul_ps(qw, c), _mm_mul_ps(qx, dx)), _mm_mul_ps(qy, dy)), _mm_mul_ps(qz, dz));
+
+		if (g->renormalize) {
+			const __m128 d = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)), _mm_mul_ps(w, w));
+			const __m128 inv = _mm_div_ps(one, _mm_sqrt_ps(d));
+			const __m128 valid = _mm_cmpgt_ps(d, zero);
+			x = _mm_and_ps(valid, _mm_mul_ps(x, inv));
+			y = _mm_and_ps(valid, _mm_mul_ps(y, inv));
+			z = _mm_and_ps(valid, _mm_mul_ps(z, inv));
+			w = _mm_or_ps(_mm_and_ps(valid, _mm_mul_ps(w, inv)), _mm_andnot_ps(valid, one));
+		}
+
+		_mm_storeu_ps(b->rotation_x + i, x);
+		_mm_storeu_ps(b->rotation_y + i, y);
+		_mm_storeu_ps(b->rotation_z + i, z);
+		_mm_storeu_ps(b->rotation_w + i, w);
+	}
+#endif
+
+	for (; i < last; i++) {
+		float q[4] = { b->rotation_x[i], b->rotation_y[i], b->rotation_z[i], b->rotation_w[i] };
+		const float omega[3] = { g->omega_x[i], g->omega_y[i], g->omega_z[i] };
+		EGL_QuatIntegrate(q, omega, g->dt);
+		if (g->renormalize) {
+			EGL_QuatNormalize(q);
+		}
+		b->rotation_x[i] = q[0];
+		b->rotation_y[i] = q[1];
+		b->rotation_z[i] = q[2];
+		b->rotation_w[i] = q[3];
+	}
+}
+
+
+bool EGL_TransformBatchInit(EGL_TransformBatch *batch, uint32_t count) {
+	memset(batch, 0, sizeof(*batch));
+	batch->count = count;
+
+	const size_t padded = PADDED((size_t)count);
+	float **arrays[10] = {
+		&batch->scale_x, &batch->scale_y, &batch->scale_z,
+		&batch->rotation_x, &batch->rotation_y, &batch->rotation_z, &batch->rotation_w,
+		&batch->translation_x, &batch->translation_y, &batch->translation_z,
+	};
+	bool ok = true;
+	for (int a = 0; a < 10; a++) {
+		*arrays[a] = (float *)EGL_malloc(sizeof(float) * (padded ? padded : 1));
+		ok = ok && *arrays[a];
+	}
+	batch->models = (float *)EGL_malloc(sizeof(float) * 16 * (padded ? padded : 1));
+	batch->dirty = (uint64_t *)EGL_calloc((count + 63) / 64 + 1, sizeof(uint64_t)); // Never a zero-size allocation.
+	if (!ok || !batch->models || !batch->dirty) {
+		EGL_TransformBatchFree(batch);
+		return false;
+	}
+
+	for (size_t i = 0; i < padded; i++) {
+		batch->scale_x[i] = batch->scale_y[i] = batch->scale_z[i] = 1.0f;
+		batch->rotation_x[i] = batch->rotation_y[i] = batch->rotation_z[i] = 0.0f;
+		batch->rotation_w[i] = 1.0f;
+		batch->translation_x[i] = batch->translation_y[i] = batch->translation_z[i] = 0.0f;
+	}
+
+	/* Padding is never dirty */
+	for (uint32_t i = 0; i < count; i++) {
+		EGL_TransformBatchMarkDirty(batch, i);
+	}
+	return true;
+}
+
+void EGL_TransformBatchFree(EGL_TransformBatch *batch) {
+	EGL_free(batch->scale_x);
+	EGL_free(batch->scale_y);
+	EGL_free(batch->scale_z);
+	EGL_free(batch->rotation_x);
+	EGL_free(batch->rotation_y);
+	EGL_free(batch->rotation_z);
+	EGL_free(batch->rotation_w);
+	EGL_free(batch->translation_x);
+	EGL_free(batch->translation_y);
+	EGL_free(batch->translation_z);
+	EGL_free(batch->models);
+	EGL_free(batch->dirty);
+	memset(batch, 0, sizeof(*batch));
+}
+
+void EGL_TransformBatchSet(EGL_TransformBatch *batch, uint32_t i, const float scale[3], const float rotation[4], const float translation[3]) {
+	batch->scale_x[i] = scale[0];
+	batch->scale_y[i] = scale[1];
+	batch->scale_z[i] = scale[2];
+	batch->rotation_x[i] = rotation[0];
+	batch->rotation_y[i] = rotation[1];
+	batch->rotation_z[i] = rotation[2];
+	batch->rotation_w[i] = rotation[3];
+	batch->translation_x[i] = translation[0];
+	batch->translation_y[i] = translation[1];
+	batch->translation_z[i] = translation[2];
+	EGL_TransformBatchMarkDirty(batch, i);
+}
+
+void EGL_TransformBatchUpdate(EGL_TransformBatch *batch, int threads) {
+	const int words = (int)((batch->count + 63) / 64);
+	if (words == 0) {
+		return;
+	}
+	EGL_ParallelRun(update_kernel, batch, (words < threads) ? words : threads);
+}
+
+void EGL_TransformBatchUpdateWords(EGL_TransformBatch *batch, size_t begin, size_t end) {
+	for (size_t word = begin; word < end; word++) {
+		uint64_t bits = batch->dirty[word];
+		if (bits == 0) {
+			continue;
+		}
+		batch->dirty[word] = 0;
+
+		for (uint32_t group = 0; group < 16 && bits != 0; group++, bits >>= 4) {
+			uint32_t lanes = (uint32_t)(bits & 15);
+			if (lanes == 0) {
+				continue;
+			}
+			uint32_t first = (uint32_t)word * 64 + group * 4;
+#ifdef __SSE2__
+			compose_four(batch, first, lanes);
+#else
+			for (uint32_t l = 0; l < 4; l++) {
+				if (lanes & (1u << l)) {
+					compose_one(batch, first + l, batch->models + (size_t)(first + l) * 16);
+				}
+			}
+#endif
+		}
+	}
+}
+
+void EGL_TransformBatchUpdateReference(EGL_TransformBatch *batch) {
+	for (uint32_t i = 0; i < batch->count; i++) {
+		if (!(batch->dirty[i >> 6] & ((uint64_t)1 << (i & 63)))) {
+			continue;
+		}
+
+		/* glm_mat4_identity, glm_scale */
+		float m[16] = { 0 };
+		m[0] = batch->scale_x[i];
+		m[5] = batch->scale_y[i];
+		m[10] = batch->scale_z[i];
+		m[15] = 1.0f;
+
+		/* glm_quat_rotate: m = m * rotation */
+		float r[16];
+		rotation_matrix(batch->rotation_x[i], batch->rotation_y[i], batch->rotation_z[i], batch->rotation_w[i], r);
+
+		float *model = batch->models + (size_t)i * 16;
+		for (int c = 0; c < 4; c++) {
+			for (int row = 0; row < 4; row++) {
+				model[c * 4 + row] = m[row] * r[c * 4] + m[4 + row] * r[c * 4 + 1] + m[8 + row] * r[c * 4 + 2] + m[12 + row] * r[c * 4 + 3];
+			}
+		}
+
+		/* glm_vec3_copy(translation, model[3]) */
+		model[12] = batch->translation_x[i];
+		model[13] = batch->translation_y[i];
+		model[14] = batch->translation_z[i];
+	}
+	memset(batch->dirty, 0, sizeof(uint64_t) * ((batch->count + 63) / 64));
+}
+
+void EGL_TransformBatchIntegrate(EGL_TransformBatch *batch, const float *omega_x, const float *omega_y, const float *omega_z,
+	float dt, bool renormalize, int threads) {
+	const int words = (int)((batch->count + 63) / 64);
+	if (words == 0) {
+		return;
+	}
+	Integrate g = {
+		.batch = batch,
+		.omega_x = omega_x,
+		.omega_y = omega_y,
+		.omega_z = omega_z,
+		.dt = dt,
+		.renormalize = renormalize,
+	};
+	EGL_ParallelRun(integrate_kernel, &g, (words < threads) ? words : threads);
+}
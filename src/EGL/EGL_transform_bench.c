@@ -0,0 +1,305 @@
+#include <EGL/EGL_bench.h>
+#include <EGL/EGL_parallel.h>
+#include <EGL/EGL_transform.h>
+
+#include <math.h>
+#include <stdlib.h>
+
+/* The AoS baseline needs cglm and SDL headers, which the bench does not otherwise depend on */
+#if defined(__has_include)
+#if __has_include(<cglm/cglm.h>) && __has_include(<SDL3/SDL_stdinc.h>)
+#include <EGL/EGL_3d.h>
+#define HAVE_EGL_3D
+#endif
+#endif
+
+
+static uint32_t lcg(uint32_t *state) {
+	*state = *state * 1664525u + 1013904223u;
+	return *state >> 8;
+}
+
+static float unit(uint32_t *state) {
+	return (float)lcg(state) / 16777216.0f;
+}
+
+static void random_transforms(uint32_t *state, EGL_TransformBatch *batch) {
+	for (uint32_t i = 0; i < batch->count; i++) {
+		float q[4] = { unit(state) - 0.5f, unit(state) - 0.5f, unit(state) - 0.5f, unit(state) - 0.5f };
+		float inv = 1.0f / sqrtf(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3] + 1e-12f);
+		q[0] *= inv;
+		q[1] *= inv;
+		q[2] *= inv;
+		q[3] *= inv;
+		const float scale[3] = { 1.0f + unit(state), 1.0f + unit(state), 1.0f + unit(state) };
+		const float translation[3] = { unit(state), unit(state), unit(state) };
+		EGL_TransformBatchSet(batch, i, scale, q, translation);
+	}
+}
+
+/* The matrix round trip EGL_TransformRotate used to do: glm_rotate, then glm_mat4_quat. */
+static void matrix_rotate(float m[16], float q[4], float angle, const float axis[3]) {
+	const float c = cosf(angle);
+	const float s = sinf(angle);
+	const float inv = 1.0f / sqrtf(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+	const float k[3] = { axis[0] * inv, axis[1] * inv, axis[2] * inv };
+	const float v[3] = { k[0] * (1.0f - c), k[1] * (1.0f - c), k[2] * (1.0f - c) };
+	const float vs[3] = { k[0] * s, k[1] * s, k[2] * s };
+
+	float r[16] = {
+		k[0] * v[0] + c,     k[1] * v[0] + vs[2], k[2] * v[0] - vs[1], 0.0f,
+		k[0] * v[1] - vs[2], k[1] * v[1] + c,     k[2] * v[1] + vs[0], 0.0f,
+		k[0] * v[2] + vs[1], k[1] * v[2] - vs[0], k[2] * v[2] + c,     0.0f,
+		0.0f, 0.0f, 0.0f, 1.0f,
+	};
+	float out[16];
+	for (int col = 0; col < 4; col++) {
+		for (int row = 0; row < 4; row++) {
+			out[col * 4 + row] = m[row] * r[col * 4] + m[4 + row] * r[col * 4 + 1] + m[8 + row] * r[col * 4 + 2] + m[12 + row] * r[col * 4 + 3];
+		}
+	}
+	memcpy(m, out, sizeof(out));
+
+	const float trace = m[0] + m[5] + m[10];
+	if (trace >= 0.0f) {
+		float t = sqrtf(1.0f + trace), ti = 0.5f / t;
+		q[0] = ti * (m[6] - m[9]);
+		q[1] = ti * (m[8] - m[2]);
+		q[2] = ti * (m[1] - m[4]);
+		q[3] = t * 0.5f;
+	} else if (m[0] >= m[5] && m[0] >= m[10]) {
+		float t = sqrtf(1.0f - m[5] - m[10] + m[0]), ti = 0.5f / t;
+		q[0] = t * 0.5f;
+		q[1] = ti * (m[1] + m[4]);
+		q[2] = ti * (m[2] + m[8]);
+		q[3] = ti * (m[6] - m[9]);
+	} else if (m[5] >= m[10]) {
+		float t = sqrtf(1.0f - m[0] - m[10] + m[5]), ti = 0.5f / t;
+		q[0] = ti * (m[1] + m[4]);
+		q[1] = t * 0.5f;
+		q[2] = ti * (m[6] + m[9]);
+		q[3] = ti * (m[8] - m[2]);
+	} else {
+		float t = sqrtf(1.0f - m[0] - m[5] + m[10]), ti = 0.5f / t;
+		q[0] = ti * (m[2] + m[8]);
+		q[1] = ti * (m[6] + m[9]);
+		q[2] = t * 0.5f;
+		q[3] = ti * (m[1] - m[4]);
+	}
+}
+
+/* Angle in radians between a rotation and `ticks` exact steps of `angle` about `axis`. */
+static double rotation_error(const float q[4], uint32_t ticks, float angle, const float axis[3]) {
+	const double half = 0.5 * (double)ticks * (double)angle;
+	const double length = sqrt((double)axis[0] * axis[0] + (double)axis[1] * axis[1] + (double)axis[2] * axis[2]);
+	const double e[4] = { axis[0] * sin(half) / length, axis[1] * sin(half) / length, axis[2] * sin(half) / length, cos(half) };
+	const double n = sqrt((double)q[0] * q[0] + (double)q[1] * q[1] + (double)q[2] * q[2] + (double)q[3] * q[3]);
+
+	/* Vector part of conj(e) * q / |q| */
+	const double x = (e[3] * q[0] - e[0] * q[3] - e[1] * q[2] + e[2] * q[1]) / n;
+	const double y = (e[3] * q[1] + e[0] * q[2] - e[1] * q[3] - e[2] * q[0]) / n;
+	const double z = (e[3] * q[2] - e[0] * q[1] + e[1] * q[0] - e[2] * q[3]) / n;
+	const double v = sqrt(x * x + y * y + z * z);
+	return 2.0 * asin(v < 1.0 ? v : 1.0);
+}
+
+static void mark_all(EGL_TransformBatch *batch) {
+	memset(batch->dirty, 0xff, sizeof(uint64_t) * (batch->count / 64));
+	for (uint32_t i = batch->count & ~63u; i < batch->count; i++) {
+		EGL_TransformBatchMarkDirty(batch, i);
+	}
+}
+
+
+void EGL_TransformBench(void) {
+	EGL_DECLARE_BENCH(EGL_transform);
+
+	const uint32_t counts[] = { 1000, 10000, 100000, 1000000 };
+	uint32_t state = 31;
+	char label[64];
+
+	for (int c = 0; c < 4; c++) {
+		const uint32_t count = counts[c];
+		EGL_TransformBatch batch;
+		if (!EGL_TransformBatchInit(&batch, count)) {
+			printf(" %u transforms: failed to allocate\n", count);
+			break;
+		}
+		random_transforms(&state, &batch);
+		const int repeats = (count < 100000) ? 50 : EGL_BENCH_REPEATS;
+
+#ifdef HAVE_EGL_3D
+		Transform *transforms = (Transform *)malloc(sizeof(Transform) * count);
+		for (uint32_t i = 0; i < count; i++) {
+			EGL_TransformReset(&transforms[i]);
+			transforms[i].scale[0] = batch.scale_x[i];
+			transforms[i].scale[1] = batch.scale_y[i];
+			transforms[i].scale[2] = batch.scale_z[i];
+			transforms[i].rotation[0] = batch.rotation_x[i];
+			transforms[i].rotation[1] = batch.rotation_y[i];
+			transforms[i].rotation[2] = batch.rotation_z[i];
+			transforms[i].rotation[3] = batch.rotation_w[i];
+			transforms[i].x = batch.translation_x[i];
+			transforms[i].y = batch.translation_y[i];
+			transforms[i].z = batch.translation_z[i];
+		}
+		double best = 1e30;
+		for (int r = 0; r < repeats; r++) {
+			double begin = EGL_BenchNow();
+			for (uint32_t i = 0; i < count; i++) {
+				EGL_TransformUpdate(&transforms[i]);
+			}
+			double elapsed = EGL_BenchNow() - begin;
+			best = (elapsed < best) ? elapsed : best;
+		}
+		EGL_BENCH_SINK += (uint64_t)transforms[count - 1].model[0][0];
+		snprintf(label, sizeof(label), "EGL_TransformUpdate loop, %u", count);
+		EGL_BenchReport(label, best, (double)count, "transform");
+		free(transforms);
+#else
+		double best;
+#endif
+
+		best = 1e30;
+		for (int r = 0; r < repeats; r++) {
+			mark_all(&batch);
+			double begin = EGL_BenchNow();
+			EGL_TransformBatchUpdateReference(&batch);
+			double elapsed = EGL_BenchNow() - begin;
+			best = (elapsed < best) ? elapsed : best;
+		}
+		EGL_BENCH_SINK += (uint64_t)batch.models[0];
+		snprintf(label, sizeof(label), "reference %u", count);
+		EGL_BenchReport(label, best, (double)count, "transform");
+
+		int threads_max = EGL_ThreadCount();
+		for (int threads = 1; threads <= threads_max; threads *= 2) {
+			best = 1e30;
+			for (int r = 0; r < repeats; r++) {
+				mark_all(&batch);
+				double begin = EGL_BenchNow();
+				EGL_TransformBatchUpdate(&batch, threads);
+				double elapsed = EGL_BenchNow() - begin;
+				best = (elapsed < best) ? elapsed : best;
+			}
+			EGL_BENCH_SINK += (uint64_t)batch.models[0];
+			snprintf(label, sizeof(label), "batched %u, %d threads", count, threads);
+			EGL_BenchReport(label, best, (double)count, "transform");
+		}
+
+		/* A sparse update touches one transform in 16 */
+		best = 1e30;
+		for (int r = 0; r < repeats; r++) {
+			for (uint32_t i = 0; i < count; i += 16) {
+				EGL_TransformBatchMarkDirty(&batch, i);
+			}
+			double begin = EGL_BenchNow();
+			EGL_TransformBatchUpdate(&batch, 1);
+			double elapsed = EGL_BenchNow() - begin;
+			best = (elapsed < best) ? elapsed : best;
+		}
+		EGL_BENCH_SINK += (uint64_t)batch.models[0];
+		snprintf(label, sizeof(label), "batched %u, 1/16 dirty", count);
+		EGL_BenchReport(label, best, (double)count, "transform");
+
+		EGL_TransformBatchFree(&batch);
+	}
+}
+
+#define TICKS 1000000
+
+void EGL_TransformRotateBench(void) {
+	EGL_DECLARE_BENCH(EGL_transform_rotate);
+
+	/* The game's tick: 0.01 rad/ms for 16 ms, about a tilted axis so every component moves */
+	const float angle = 0.16f;
+	const float axis[3] = { 0.26726124f, 0.5345225f, 0.8017837f };
+	const float omega[3] = { axis[0] * angle, axis[1] * angle, axis[2] * angle };
+	char label[64];
+
+	const char *names[4] = { "matrix round trip", "EGL_QuatRotate", "EGL_QuatIntegrate", "EGL_QuatIntegrate, renormalized" };
+	float q[4][4];
+	double seconds[4];
+	for (int method = 0; method < 4; method++) {
+		float m[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+		float *r = q[method];
+		r[0] = r[1] = r[2] = 0.0f;
+		r[3] = 1.0f;
+
+		double begin = EGL_BenchNow();
+		for (uint32_t t = 1; t <= TICKS; t++) {
+			switch (method) {
+				case 0: matrix_rotate(m, r, angle, axis); break;
+				case 1: EGL_QuatRotate(r, angle, axis); break;
+				case 2: EGL_QuatIntegrate(r, omega, 1.0f); break;
+				default:
+					EGL_QuatIntegrate(r, omega, 1.0f);
+					if (t % EGL_QUAT_RENORMALIZE_STEPS == 0) {
+						EGL_QuatNormalize(r);
+					}
+					break;
+			}
+		}
+		seconds[method] = EGL_BenchNow() - begin;
+		EGL_BENCH_SINK += (uint64_t)(r[0] * 1000.0f);
+	}
+
+	for (int method = 0; method < 4; method++) {
+		EGL_BenchReport(names[method], seconds[method], (double)TICKS, "tick");
+	}
+	printf(" drift after %d ticks:\n", TICKS);
+	for (int method = 0; method < 4; method++) {
+		const float *r = q[method];
+		double norm = sqrt((double)r[0] * r[0] + (double)r[1] * r[1] + (double)r[2] * r[2] + (double)r[3] * r[3]);
+		snprintf(label, sizeof(label), "%s", names[method]);
+		printf(" %-44s %9.1f ns/op  |q| - 1 = %9.2e  angle error %8.2e rad\n",
+			label, seconds[method] / TICKS * 1e9, norm - 1.0, rotation_error(r, TICKS, angle, axis));
+	}
+
+	/* Batches of spinning transforms */
+	const uint32_t count = 100000;
+	EGL_TransformBatch batch;
+	if (!EGL_TransformBatchInit(&batch, count)) {
+		printf(" %u transforms: failed to allocate\n", count);
+		return;
+	}
+	float *omegas = (float *)malloc(sizeof(float) * 3 * count);
+	for (uint32_t i = 0; i < 3 * count; i++) {
+		omegas[i] = 0.16f * (float)((i * 2654435761u) >> 8) / 16777216.0f;
+	}
+
+	double best = 1e30;
+	for (int r = 0; r < EGL_BENCH_REPEATS; r++) {
+		double begin = EGL_BenchNow();
+		for (uint32_t i = 0; i < count; i++) {
+			float qi[4] = { batch.rotation_x[i], batch.rotation_y[i], batch.rotation_z[i], batch.rotation_w[i] };
+			const float wi[3] = { omegas[i], omegas[count + i], omegas[2 * count + i] };
+			EGL_QuatIntegrate(qi, wi, 1.0f);
+			batch.rotation_x[i] = qi[0];
+			batch.rotation_y[i] = qi[1];
+			batch.rotation_z[i] = qi[2];
+			batch.rotation_w[i] = qi[3];
+		}
+		double elapsed = EGL_BenchNow() - begin;
+		best = (elapsed < best) ? elapsed : best;
+	}
+	snprintf(label, sizeof(label), "EGL_QuatIntegrate loop %u", count);
+	EGL_BenchReport(label, best, (double)count, "transform");
+
+	int threads_max = EGL_ThreadCount();
+	for (int threads = 1; threads <= threads_max; threads *= 2) {
+		best = 1e30;
+		for (int r = 0; r < EGL_BENCH_REPEATS; r++) {
+			double begin = EGL_BenchNow();
+			EGL_TransformBatchIntegrate(&batch, omegas, omegas + count, omegas + 2 * count, 1.0f, r == 0, threads);
+			double elapsed = EGL_BenchNow() - begin;
+			best = (elapsed < best) ? elapsed : best;
+		}
+		snprintf(label, sizeof(label), "batched %u, %d threads", count, threads);
+		EGL_BenchReport(label, best, (double)count, "transform");
+	}
+	EGL_BENCH_SINK += (uint64_t)(batch.rotation_w[0] * 1000.0f);
+
+	free(omegas);
+	EGL_TransformBatchFree(&batch);
+}
@@ -0,0 +1,187 @@
+#include <EGL/EGL_testing.h>
+#include <math.h>
+#include <stdlib.h>
+
+
+#define COUNT 1003 // Not a multiple of the SIMD width or a dirty word.
+
+
+static void random_transforms(uint32_t *state, EGL_TransformBatch *batch) {
+	for (uint32_t i = 0; i < batch->count; i++) {
+		float q[4], r2;
+		do {
+			for (int a = 0; a < 4; a++) {
+				q[a] = 2.0f * EGL_RandFloat(state) - 1.0f;
+			}
+			r2 = q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3];
+		} while (r2 < 0.01f || r2 > 1.0f);
+		float inv = 1.0f / sqrtf(r2);
+		for (int a = 0; a < 4; a++) {
+			q[a] *= inv;
+		}
+
+		const float scale[3] = { 0.1f + 4.0f * EGL_RandFloat(state), 0.1f + 4.0f * EGL_RandFloat(state), 0.1f + 4.0f * EGL_RandFloat(state) };
+		const float translation[3] = { 20.0f * EGL_RandFloat(state) - 10.0f, 20.0f * EGL_RandFloat(state) - 10.0f, 20.0f * EGL_RandFloat(state) - 10.0f };
+		EGL_TransformBatchSet(batch, i, scale, q, translation);
+	}
+}
+
+
+/**
+ * The SIMD multi-threaded update matches the one-at-a-time reference.
+ */
+static void EGL_TransformBatchReferenceTest(EGL_Test *T) {
+	EGL_DECLARE_TEST;
+
+	EGL_TransformBatch batch, reference;
+	if (!EGL_TransformBatchInit(&batch, COUNT) || !EGL_TransformBatchInit(&reference, COUNT)) {
+		EGL_DECLARE_ERROR("Failed to allocate %d transforms.", COUNT);
+		return;
+	}
+
+	/* Fresh batches compose to the identity */
+	EGL_TransformBatchUpdate(&batch, 3);
+	for (uint32_t i = 0; i < COUNT; i++) {
+		for (int e = 0; e < 16; e++) {
+			if (batch.models[i * 16 + e] != ((e % 5 == 0) ? 1.0f : 0.0f)) {
+				EGL_DECLARE_ERROR("Transform %u is not the identity after init.", i);
+				i = COUNT;
+				break;
+			}
+		}
+	}
+
+	uint32_t state[4] = {0,0,0,0};
+	EGL_Seed(state, 31);
+	random_transforms(state, &batch);
+	EGL_Seed(state, 31);
+	random_transforms(state, &reference);
+
+	EGL_TransformBatchUpdate(&batch, 3);
+	EGL_TransformBatchUpdateReference(&reference);
+	for (uint32_t i = 0; i < COUNT && T->error_count < ERRORS_MAX - 1; i++) {
+		for (int e = 0; e < 16; e++) {
+			float a = batch.models[i * 16 + e];
+			float b = reference.models[i * 16 + e];
+			if (fabsf(a - b) > 1e-6f * (1.0f + fabsf(b))) {
+				EGL_DECLARE_ERROR("Transform %u element %d is %f, expected %f.", i, e, a, b);
+				break;
+			}
+		}
+	}
+	for (uint32_t w = 0; w < (COUNT + 63) / 64; w++) {
+		if (batch.dirty[w] != 0) {
+			EGL_DECLARE_ERROR("Dirty word %u was not cleared.", w);
+		}
+	}
+
+	EGL_TransformBatchFree(&batch);
+	EGL_TransformBatchFree(&reference);
+}
+
+/**
+ * Only transforms marked dirty are recomposed.
+ */
+static void EGL_TransformBatchDirtyTest(EGL_Test *T) {
+	EGL_DECLARE_TEST;
+
+	EGL_TransformBatch batch;
+	EGL_TransformBatchInit(&batch, COUNT);
+	EGL_TransformBatchUpdate(&batch, 1);
+
+	for (uint32_t i = 0; i < COUNT; i++) {
+		batch.translation_x[i] = (float)i;
+		if (i % 7 == 0) {
+			EGL_TransformBatchMarkDirty(&batch, i);
+		}
+	}
+	EGL_TransformBatchUpdate(&batch, 2);
+
+	for (uint32_t i = 0; i < COUNT; i++) {
+		float expected = (i % 7 == 0) ? (float)i : 0.0f;
+		if (batch.models[i * 16 + 12] != expected) {
+			EGL_DECLARE_ERROR("Transform %u has translation %f, expected %f.", i, batch.models[i * 16 + 12], expected);
+			break;
+		}
+	}
+
+	EGL_TransformBatchFree(&batch);
+}
+
+/**
+ * Integrating an angular velocity matches the exact axis-angle rotation, and
+ * the batch integrates every transform like the scalar version.
+ */
+static void EGL_TransformIntegrateTest(EGL_Test *T) {
+	EGL_DECLARE_TEST;
+
+	const float axis[3] = { 1.0f, -2.0f, 0.5f };
+	const float length = sqrtf(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+	const float angle = 0.16f;
+	const float omega[3] = { axis[0] / length * angle, axis[1] / length * angle, axis[2] / length * angle };
+
+	float exact[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+	float integrated[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+	for (int t = 1; t <= 1000; t++) {
+		EGL_QuatRotate(exact, angle, axis);
+		EGL_QuatIntegrate(integrated, omega, 1.0f);
+		if (t % EGL_QUAT_RENORMALIZE_STEPS == 0) {
+			EGL_QuatNormalize(exact);
+			EGL_QuatNormalize(integrated);
+		}
+	}
+	float dot = 0.0f;
+	for (int a = 0; a < 4; a++) {
+		dot += exact[a] * integrated[a];
+	}
+	if (fabsf(fabsf(dot) - 1.0f) > 1e-5f) {
+		EGL_DECLARE_ERROR("Integrated rotation is off the exact one (dot %f).", dot);
+	}
+
+	EGL_TransformBatch batch;
+	EGL_TransformBatchInit(&batch, COUNT);
+	uint32_t state[4] = {0,0,0,0};
+	EGL_Seed(state, 32);
+	random_transforms(state, &batch);
+	EGL_TransformBatchUpdate(&batch, 1);
+
+	float *omegas = (float *)malloc(sizeof(float) * 3 * COUNT);
+	for (uint32_t i = 0; i < 3 * COUNT; i++) {
+		omegas[i] = 0.2f * EGL_RandFloat(state) - 0.1f;
+	}
+	EGL_TransformBatchIntegrate(&batch, omegas, omegas + COUNT, omegas + 2 * COUNT, 1.5f, true, 3);
+
+	EGL_Seed(state, 32);
+	EGL_TransformBatch reference;
+	EGL_TransformBatchInit(&reference, COUNT);
+	random_transforms(state, &reference);
+	for (uint32_t i = 0; i < COUNT && T->error_count < ERRORS_MAX - 1; i++) {
+		float q[4] = { reference.rotation_x[i], reference.rotation_y[i], reference.rotation_z[i], reference.rotation_w[i] };
+		const float w[3] = { omegas[i], omegas[COUNT + i], omegas[2 * COUNT + i] };
+		EGL_QuatIntegrate(q, w, 1.5f);
+		EGL_QuatNormalize(q);
+		const float got[4] = { batch.rotation_x[i], batch.rotation_y[i], batch.rotation_z[i], batch.rotation_w[i] };
+		for (int a = 0; a < 4; a++) {
+			if (fabsf(got[a] - q[a]) > 1e-6f) {
+				EGL_DECLARE_ERROR("Transform %u component %d is %f, expected %f.", i, a, got[a], q[a]);
+				break;
+			}
+		}
+		if (!(batch.dirty[i >> 6] & ((uint64_t)1 << (i & 63)))) {
+			EGL_DECLARE_ERROR("Transform %u was not marked dirty.", i);
+		}
+	}
+
+	free(omegas);
+	EGL_TransformBatchFree(&batch);
+	EGL_TransformBatchFree(&reference);
+}
+
+
+void EGL_TransformTest(EGL_TestModule *M) {
+	EGL_DECLARE_MODULE(EGL_transform);
+
+	EGL_RUN_TEST(EGL_TransformBatchReferenceTest);
+	EGL_RUN_TEST(EGL_TransformBatchDirtyTest);
+	EGL_RUN_TEST(EGL_TransformIntegrateTest);
+}
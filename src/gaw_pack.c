@@ -0,0 +1,80 @@
+/*
+ * Asset packer: bundles files into one archive for EGL_PackOpen.
+ *
+ *     pack out.pack data/sphere.bin data/bricks.bmp ...
+ *
+ * Each asset is named by its file name without the directory.
+ */
+
+#include <EGL/EGL_pack.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+static const char *base_name(const char *path) {
+	const char *slash = strrchr(path, '/');
+#ifdef _WIN32
+	const char *backslash = strrchr(path, '\\');
+	slash = (backslash > slash) ? backslash : slash;
+#endif
+	return slash ? slash + 1 : path;
+}
+
+static void *read_file(const char *path, size_t *size) {
+	FILE *f = fopen(path, "rb");
+	if (!f) {
+		return NULL;
+	}
+	long length = -1;
+	if (fseek(f, 0, SEEK_END) == 0) {
+		length = ftell(f);
+	}
+	void *data = (length >= 0 && fseek(f, 0, SEEK_SET) == 0) ? malloc((size_t)length + 1) : NULL;
+	if (!data || fread(data, 1, (size_t)length, f) != (size_t)length) {
+		free(data);
+		fclose(f);
+		return NULL;
+	}
+	fclose(f);
+	*size = (size_t)length;
+	return data;
+}
+
+
+int main(int argc, char **argv)
+{
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s out.pack [file ...]\n", argv[0]);
+		return 1;
+	}
+
+	const uint32_t count = (uint32_t)(argc - 2);
+	const char **names = (const char **)calloc(count + 1, sizeof(char *));
+	const void **data = (const void **)calloc(count + 1, sizeof(void *));
+	size_t *sizes = (size_t *)calloc(count + 1, sizeof(size_t));
+	int status = (names && data && sizes) ? 0 : 1;
+
+	for (uint32_t i = 0; i < count && status == 0; i++) {
+		const char *path = argv[i + 2];
+		names[i] = base_name(path);
+		data[i] = read_file(path, &sizes[i]);
+		if (!data[i]) {
+			fprintf(stderr, "failed to read %s\n", path);
+			status = 1;
+		}
+	}
+	if (status == 0 && !EGL_PackWrite(argv[1], names, data, sizes, count)) {
+		fprintf(stderr, "failed to write %s (are two files named alike?)\n", argv[1]);
+		status = 1;
+	}
+
+	for (uint32_t i = 0; data && i < count; i++) {
+		free((void *)data[i]);
+	}
+	free(names);
+	free(data);
+	free(sizes);
+	return status;
+}
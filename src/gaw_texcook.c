@@ -0,0 +1,106 @@
+/*
+ * Texture cooker: converts a BMP into a mipmapped, block-compressed texture
+ * for EGL_TextureParse.
+ *
+ *     texcook data/bricks.bmp bricks.tex [rgba8|bc1|bc7] [fast|normal|best]
+ *
+ * Defaults to bc7 at normal quality, and prints each level's PSNR.
+ */
+
+#include <EGL/EGL_texture.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+static void *read_file(const char *path, size_t *size) {
+	FILE *f = fopen(path, "rb");
+	if (!f) {
+		return NULL;
+	}
+	long length = -1;
+	if (fseek(f, 0, SEEK_END) == 0) {
+		length = ftell(f);
+	}
+	void *data = (length >= 0 && fseek(f, 0, SEEK_SET) == 0) ? malloc((size_t)length + 1) : NULL;
+	if (!data || fread(data, 1, (size_t)length, f) != (size_t)length) {
+		free(data);
+		fclose(f);
+		return NULL;
+	}
+	fclose(f);
+	*size = (size_t)length;
+	return data;
+}
+
+static int find(const char *name, const char *const *names, int count) {
+	for (int i = 0; i < count; i++) {
+		if (strcmp(name, names[i]) == 0) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+/* Decode each cooked level and compare it with the mip it was encoded from */
+static void report(const EGL_Image *base, const EGL_Texture *t) {
+	EGL_MipChain m;
+	if (!EGL_MipChainBuild(&m, base)) {
+		return;
+	}
+	for (uint32_t l = 0; l < t->levels && l < m.count; l++) {
+		const EGL_Image *level = &m.levels[l];
+		uint8_t *decoded = (uint8_t *)malloc((size_t)level->width * level->height * 4);
+		if (decoded) {
+			EGL_TextureDecode(t->data[l], t->format, level->width, level->height, decoded);
+			printf("level %2u %5u x %-5u %8zu bytes %6.2f dB\n", l, level->width, level->height, t->sizes[l],
+				EGL_ImagePSNR(level->pixels, decoded, (size_t)level->width * level->height, true));
+		}
+		free(decoded);
+	}
+	EGL_MipChainFree(&m);
+}
+
+
+int main(int argc, char **argv)
+{
+	static const char *const FORMATS[] = { "rgba8", "bc1", "bc7" };
+	static const char *const QUALITIES[] = { "fast", "normal", "best" };
+	const int format = (argc > 3) ? find(argv[3], FORMATS, 3) : EGL_TEXTURE_BC7;
+	const int quality = (argc > 4) ? find(argv[4], QUALITIES, 3) : EGL_TEXTURE_NORMAL;
+	if (argc < 3 || argc > 5 || format < 0 || quality < 0) {
+		fprintf(stderr, "usage: %s in.bmp out.tex [rgba8|bc1|bc7] [fast|normal|best]\n", argv[0]);
+		return 1;
+	}
+
+	size_t size = 0;
+	void *bmp = read_file(argv[1], &size);
+	EGL_Image image;
+	if (!bmp || !EGL_ImageReadBMP(&image, bmp, size)) {
+		fprintf(stderr, "failed to read %s\n", argv[1]);
+		free(bmp);
+		return 1;
+	}
+	free(bmp);
+
+	uint8_t *cooked = NULL;
+	size = EGL_TextureCook(&image, (EGL_TextureFormat)format, (EGL_TextureQuality)quality, true, &cooked);
+	FILE *f = size ? fopen(argv[2], "wb") : NULL;
+	int status = (f && fwrite(cooked, 1, size, f) == size) ? 0 : 1;
+	if (f && fclose(f) != 0) {
+		status = 1;
+	}
+	if (status != 0) {
+		fprintf(stderr, "failed to write %s\n", argv[2]);
+	} else {
+		EGL_Texture t;
+		EGL_TextureParse(&t, cooked, size);
+		printf("%s: %u x %u %s, %u levels, %zu bytes\n", argv[2], t.width, t.height, FORMATS[format], t.levels, size);
+		report(&image, &t);
+	}
+
+	EGL_free(cooked);
+	EGL_ImageFree(&image);
+	return status;
+}
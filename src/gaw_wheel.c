@@ -23,12 +23,18 @@
 
 #include <EGL/EGL_strings.h>
 #include <EGL/EGL_random.h>
+#include <EGL/EGL_profile.h>
+#include <EGL/EGL_framestats.h>
+#include <EGL/EGL_alloc.h>
+#include <EGL/EGL_arena.h>
+#include <EGL/EGL_assets.h>
+#include <EGL/EGL_pack.h>
 
 #include <stdint.h>
 #include <time.h>
 
 
-#define PATH_MAX 4096
+#define SCRATCH_BYTES 65536 // Temporary memory for a frame, or for loading.
 #define WHEEL_MAX 12
 #define WORD_MAX 16
 
@@ -45,6 +51,11 @@
 #define DELTA_T 32 // milliseconds per simulation tick (16 ~ 60 FPS, 32 ~ 30 FPS)
 #define IMPULSE 0.00025f // d𝛚 = (I / T) dt where IMPULSE = (I / T) [I = Moment of Inertia, T = Avg Torque]
 
+#define STATS_WINDOW 240 // Frames in the rolling frame time statistics.
+#define STATS_REPORT 10  // Frames between refreshes of the statistics overlay.
+#define REFRESH_NS_DEFAULT 16666667 // Vsync period when the display does not report one (60 Hz).
+#define ALLOC_WARMUP 60 // Frames before the allocation budget applies (--alloc-budget N).
+
 #define EGL_ClearStr(s) ( s[0] = '\0' )
 
 
@@ -72,21 +83,124 @@ typedef struct {
 	Font font;
 	Wheel wheel;
 
-#ifdef DEBUG
-	float avg_fps;
-	Uint32 frames;
-	Uint32 frame_time;
-#endif
+	EGL_FrameStats stats;
+	EGL_FrameReport report; // The window as of the last overlay refresh.
+	const char *stats_path; // Write whole-run statistics here at quit (--stats path).
+
+	EGL_Arena scratch; // Temporary memory, reset at the top of each frame and after loading.
+
+	EGL_Pack pack;          // Every asset, mapped from wheel.pack next to the binary; the font reads from it.
+	EGL_AssetLoader loader; // Decodes assets while the window is created.
+	EGL_Asset wheel_asset;  // Decodes to an SDL_Surface.
+	EGL_Asset words_asset;  // Decodes into wheel.words.
+
+	EGL_AllocCounts frame_allocs; // What the last frame allocated, on every thread.
+	Sint64 alloc_budget;          // Fail once a frame past warmup allocates more than this (--alloc-budget N), or -1.
 
 	Uint64 total_time;
 	Uint64 physics_time;
 	Uint64 prev_tick;
+
+	Uint64 headless_ticks; // Simulate this many ticks without a window, then quit (--headless N).
 } AppState;
 
 
+/* One fixed simulation step: the wheel spins and slows down */
+static void Wheel_Step(Wheel *wheel)
+{
+	wheel->angle_prev = wheel->angle;
+	wheel->angle += wheel->angular_speed * DELTA_T;
+	wheel->angular_speed -= IMPULSE * DELTA_T;
+	wheel->angular_speed = (wheel->angular_speed < 0) ? 0 : wheel->angular_speed;
+}
+
+/*
+ * Run ctx->headless_ticks simulation steps as fast as possible, then log the
+ * final state and the tick rate.
+ */
+static SDL_AppResult RunHeadless(AppState *ctx, Uint32 seed)
+{
+	const Uint64 begin = SDL_GetPerformanceCounter();
+	EGL_PROFILE_SCOPE("headless run") {
+		if (ctx->stats_path) {
+			/* Each tick is a frame with no vsync to miss */
+			Uint64 tick_begin = SDL_GetTicksNS();
+			for (Uint64 tick = 0; tick < ctx->headless_ticks; tick++) {
+				Wheel_Step(&ctx->wheel);
+				const Uint64 tick_end = SDL_GetTicksNS();
+				EGL_FrameStatsAdd(&ctx->stats, tick_end - tick_begin, tick_end);
+				tick_begin = tick_end;
+			}
+		} else {
+			for (Uint64 tick = 0; tick < ctx->headless_ticks; tick++) {
+				Wheel_Step(&ctx->wheel);
+			}
+		}
+	}
+	const double seconds = (double)(SDL_GetPerformanceCounter() - begin) / (double)SDL_GetPerformanceFrequency();
+
+	SDL_Log("Headless: %llu ticks, seed %u\n", (unsigned long long)ctx->headless_ticks, (unsigned)seed);
+	SDL_Log("Angle:    %.9g deg, speed %.9g deg / ms\n", ctx->wheel.angle, ctx->wheel.angular_speed);
+	SDL_Log("Time:     %.6f s, %.0f ticks/s\n", seconds, (seconds > 0.0) ? (double)ctx->headless_ticks / seconds : 0.0);
+	return SDL_APP_SUCCESS;
+}
+
+
+/* Decode a bitmap into an SDL_Surface, on a decode worker */
+static bool DecodeBitmap(EGL_Asset *asset)
+{
+	SDL_IOStream *io = SDL_IOFromConstMem(asset->data, asset->size);
+	asset->result = io ? SDL_LoadBMP_IO(io, true) : NULL;
+	EGL_AssetFree(asset);
+	return asset->result != NULL;
+}
+
+/* Read the wheel's words, one per line, on a decode worker */
+static bool DecodeWords(EGL_Asset *asset)
+{
+	Wheel *wheel = &((AppState *)asset->user)->wheel;
+	Reader word_reader = { .data = (char *)asset->data, .size = asset->size, .offset = 0 };
+
+	bool ok = true;
+	for (int i = 0; i < WHEEL_MAX && ok; i++) {
+		const int err = EGL_ReadLine(&word_reader, wheel->words[i], WORD_MAX);
+		if (err < 0) {
+			SDL_Log("Failure to read line %d with error code: %d\n", i, err);
+			ok = false;
+		}
+	}
+	EGL_AssetFree(asset);
+	return ok;
+}
+
+/* Queue a packed asset for decoding, straight from the mapping */
+static bool QueueAsset(AppState *ctx, EGL_Asset *asset, const char *name, EGL_AssetDecodeFunc decode)
+{
+	size_t size = 0;
+	const void *data = EGL_PackGet(&ctx->pack, name, &size);
+	if (!data) {
+		SDL_Log("Failure to find %s in the asset archive.\n", name);
+		return false;
+	}
+	*asset = (EGL_Asset){ .path = name, .decode = decode, .user = ctx };
+	EGL_AssetLoadMemory(&ctx->loader, asset, data, size);
+	return true;
+}
+
+
 SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[])
 {
-	char *path = (char *) SDL_malloc(PATH_MAX * sizeof(char));
+	const Uint64 startup_begin = SDL_GetTicksNS();
+
+	/* Count every allocation SDL and EGL make from here on */
+	SDL_malloc_func malloc_func;
+	SDL_calloc_func calloc_func;
+	SDL_realloc_func realloc_func;
+	SDL_free_func free_func;
+	SDL_GetOriginalMemoryFunctions(&malloc_func, &calloc_func, &realloc_func, &free_func);
+	EGL_AllocWrap(malloc_func, calloc_func, realloc_func, free_func);
+	SDL_SetMemoryFunctions(EGL_AllocMalloc, EGL_AllocCalloc, EGL_AllocRealloc, EGL_AllocFree);
+	EGL_SetMemoryFunctions(EGL_AllocMalloc, EGL_AllocCalloc, EGL_AllocRealloc, EGL_AllocFree);
 
 	AppState *ctx = (AppState *)SDL_calloc(1, sizeof(AppState));
 	if (!ctx) {
@@ -94,8 +208,68 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[])
 	}
 
 	*appstate = ctx;
+	ctx->alloc_budget = -1;
+	if (!EGL_ArenaInit(&ctx->scratch, SCRATCH_BYTES)) {
+		SDL_Log("Failure to allocate scratch memory.\n");
+		return SDL_APP_FAILURE;
+	}
+
+	/* An argument that is not an option names the word list */
+	const char *words = "games";
+	Uint32 seed = (Uint32)time(NULL);
+	for (int i = 1; i < argc; i++) {
+		if (SDL_strcmp(argv[i], "--headless") == 0 && i + 1 < argc) {
+			ctx->headless_ticks = SDL_strtoull(argv[++i], NULL, 10);
+		} else if (SDL_strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+			seed = (Uint32)SDL_strtoul(argv[++i], NULL, 10);
+		} else if (SDL_strcmp(argv[i], "--profile") == 0 && i + 1 < argc) {
+			if (!EGL_ProfileStart(argv[++i])) {
+				SDL_Log("Failure to open trace file %s.\n", argv[i]);
+			}
+			EGL_ProfileThreadName("main");
+		} else if (SDL_strcmp(argv[i], "--stats") == 0 && i + 1 < argc) {
+			ctx->stats_path = argv[++i];
+		} else if (SDL_strcmp(argv[i], "--alloc-budget") == 0 && i + 1 < argc) {
+			ctx->alloc_budget = (Sint64)SDL_strtoull(argv[++i], NULL, 10);
+		} else {
+			words = argv[i];
+		}
+	}
+
+	/* Initialize Wheel */
+	EGL_Seed(RNG, seed);
+	ctx->wheel.angular_speed = WHEEL_SPEED_MIN + WHEEL_SPEED_RANGE * EGL_RandFloat(RNG);
+
+	if (ctx->headless_ticks > 0) {
+		if (!EGL_FrameStatsInit(&ctx->stats, STATS_WINDOW, 0)) {
+			SDL_Log("Failure to allocate frame statistics.\n");
+			return SDL_APP_FAILURE;
+		}
+		return RunHeadless(ctx, seed);
+	}
+
+	/* Map every asset at once, then decode them on other threads while the window is created */
+	const char *path = EGL_ArenaPrintf(&ctx->scratch, "%swheel.pack", SDL_GetBasePath());
+	const char *words_file = EGL_ArenaPrintf(&ctx->scratch, "%s.dat", words);
+	if (!path || !words_file) {
+		SDL_Log("Failure to write path to buffer.\n");
+		return SDL_APP_FAILURE;
+	}
+	if (!EGL_PackOpen(&ctx->pack, path)) {
+		SDL_Log("Failure to open asset archive %s.\n", path);
+		return SDL_APP_FAILURE;
+	}
+	if (!EGL_AssetLoaderInit(&ctx->loader, 0)) {
+		SDL_Log("Failure to start the asset loader.\n");
+		return SDL_APP_FAILURE;
+	}
+	if (!QueueAsset(ctx, &ctx->wheel_asset, "wheel.bmp", DecodeBitmap) ||
+		!QueueAsset(ctx, &ctx->words_asset, words_file, DecodeWords)) {
+		return SDL_APP_FAILURE;
+	}
 
 	/* Initialize App */
+	EGL_PROFILE_BEGIN(create_window, "create window");
     SDL_SetAppMetadata("Wheel Of Fortune", "0.0.0a", "com.wheel");
 
     if (!SDL_Init(SDL_INIT_VIDEO)) {
@@ -111,19 +285,32 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[])
 
 	SDL_SetRenderVSync(ctx->renderer, SDL_RENDERER_VSYNC_ADAPTIVE);
 
-	/* Load Wheel Texture */
-	int err = SDL_snprintf(path, PATH_MAX, "%swheel.bmp", SDL_GetBasePath());
-	if (err < 0) {
-		SDL_Log("Failure to write path to buffer.\n");
+	/* Count missed deadlines against the display the window opened on */
+	const SDL_DisplayMode *mode = SDL_GetCurrentDisplayMode(SDL_GetDisplayForWindow(ctx->window));
+	const Uint64 refresh_ns = (mode && mode->refresh_rate > 0.0f) ? (Uint64)(1e9 / mode->refresh_rate) : REFRESH_NS_DEFAULT;
+	if (!EGL_FrameStatsInit(&ctx->stats, STATS_WINDOW, refresh_ns)) {
+		SDL_Log("Failure to allocate frame statistics.\n");
 		return SDL_APP_FAILURE;
 	}
 
-	SDL_Surface *surface = SDL_LoadBMP(path);
-	if (!surface) {
-		SDL_Log("Failure to load bitmap: %s\n", SDL_GetError());
-		return SDL_APP_FAILURE;
+	EGL_PROFILE_END(create_window);
+
+	/* Finish Loading */
+	EGL_PROFILE_BEGIN(wait_assets, "wait for assets");
+	EGL_AssetWaitAll(&ctx->loader);
+	EGL_AssetLoaderFree(&ctx->loader);
+	EGL_PROFILE_END(wait_assets);
+	const EGL_Asset *required[] = { &ctx->wheel_asset, &ctx->words_asset };
+	for (size_t i = 0; i < SDL_arraysize(required); i++) {
+		if (required[i]->state != EGL_ASSET_LOADED) {
+			SDL_Log("Failure to load %s.\n", required[i]->path);
+			return SDL_APP_FAILURE;
+		}
 	}
 
+	/* Load Wheel Texture */
+	EGL_PROFILE_BEGIN(load_texture, "load wheel texture");
+	SDL_Surface *surface = (SDL_Surface *)ctx->wheel_asset.result;
 	ctx->wheel.texture = SDL_CreateTextureFromSurface(ctx->renderer, surface);
 	if (!ctx->wheel.texture) {
 		SDL_Log("Failure to create static texture: %s\n", SDL_GetError());
@@ -131,67 +318,28 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[])
 	}
 
 	SDL_DestroySurface(surface);
-
-	/* Initialize Wheel */
-	EGL_Seed(RNG, (uint32_t)time(NULL));
-	ctx->wheel.angular_speed = WHEEL_SPEED_MIN + WHEEL_SPEED_RANGE * EGL_RandFloat(RNG);
-
-	/* Load Words */
-	EGL_ClearStr(path);
-	if (argc > 1) {
-		err = SDL_snprintf(path, PATH_MAX, "%s%s.dat", SDL_GetBasePath(), argv[1]);
-		if (err < 0) {
-			SDL_Log("Failure to write path to buffer.\n");
-			return SDL_APP_FAILURE;
-		}
-	} else {
-		err = SDL_snprintf(path, PATH_MAX, "%sgames.dat", SDL_GetBasePath());
-		if (err < 0) {
-			SDL_Log("Failure to write path to buffer.\n");
-			return SDL_APP_FAILURE;
-		}
-	}
-
-	Reader word_reader;
-	word_reader.data = (char *) SDL_LoadFile(path, &(word_reader.size));
-	word_reader.offset = 0;
-
-	if (!word_reader.data) {
-		SDL_Log("Failure to load file: %s\n", SDL_GetError());
-		return SDL_APP_FAILURE;
-	}
-
-	for (int i = 0; i < WHEEL_MAX; i++) {
-		err = EGL_ReadLine(&word_reader, ctx->wheel.words[i], WORD_MAX);
-		if (err < 0) {
-		SDL_Log("Failure to read line %d with error code: %d\n", i, err);
-		return SDL_APP_FAILURE;
-		}
-	}
-	SDL_free(word_reader.data);
+	ctx->wheel_asset.result = NULL;
+	EGL_PROFILE_END(load_texture);
 
 	/* Load Font */
+	EGL_PROFILE_BEGIN(load_font, "load font");
 	if (!TTF_Init()) {
 		SDL_Log("Failure to initialize SDL_ttf: %s\n", SDL_GetError());
 		return SDL_APP_FAILURE;
 	}
 
-	EGL_ClearStr(path);
-	err = SDL_snprintf(path, PATH_MAX, "%shey_comic.ttf", SDL_GetBasePath());
-	if (err < 0) {
-		SDL_Log("Failure to write path to buffer.\n");
-		return SDL_APP_FAILURE;
-	}
-
-	ctx->font.ttf = TTF_OpenFontIO(SDL_IOFromFile(path, "r"), true, TEXT_PT_SIZE);
+	size_t font_size = 0;
+	const void *font_data = EGL_PackGet(&ctx->pack, "hey_comic.ttf", &font_size);
+	ctx->font.ttf = font_data ? TTF_OpenFontIO(SDL_IOFromConstMem(font_data, font_size), true, TEXT_PT_SIZE) : NULL;
 	if (!ctx->font.ttf) {
 		SDL_Log("Failure to open font: %s\n", SDL_GetError());
 		return SDL_APP_FAILURE;
 	}
 
-	SDL_free(path);
+	EGL_PROFILE_END(load_font);
 
 	/* Create texture for words on wheel */
+	EGL_PROFILE_BEGIN(render_words, "render words");
 	SDL_Color word_color = { 255, 255, 255, SDL_ALPHA_OPAQUE };
 	ctx->font.texture = SDL_CreateTexture(ctx->renderer, SDL_PIXELFORMAT_ARGB32, SDL_TEXTUREACCESS_TARGET, WHEEL_DIAMETER, WHEEL_DIAMETER);
 	SDL_SetRenderTarget(ctx->renderer, ctx->font.texture);
@@ -219,13 +367,16 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[])
 	}
 	SDL_DestroySurface(word_surface);
 	SDL_SetRenderTarget(ctx->renderer, NULL);
+	EGL_PROFILE_END(render_words);
 
 	if (!ctx->font.texture) {
 		SDL_Log("Failure to create text texture: %s\n", SDL_GetError());
 		return SDL_APP_FAILURE;
 	}
 
+	EGL_ArenaReset(&ctx->scratch);
 	ctx->prev_tick = SDL_GetTicks();
+	SDL_Log("Startup: %.3f ms\n", (double)(SDL_GetTicksNS() - startup_begin) * 1e-6);
 
     return SDL_APP_CONTINUE;  /* carry on with the program! */
 }
@@ -247,21 +398,22 @@ SDL_AppResult SDL_AppIterate(void *appstate)
 	SDL_FPoint center;
 	SDL_FRect wheel_AABB;
 
+	EGL_PROFILE_FRAME();
+	EGL_ArenaReset(&ctx->scratch);
+
+	const Uint64 frame_begin = SDL_GetTicksNS();
 	const Uint64 now = SDL_GetTicks();
 	const Uint64 dt = now - ctx->prev_tick;
 
 	// Physics
+	EGL_PROFILE_BEGIN(simulate, "simulate");
 	ctx->physics_time += dt;
 
 	while (ctx->physics_time >= DELTA_T) {
-
-		ctx->wheel.angle_prev = ctx->wheel.angle;
-		ctx->wheel.angle += ctx->wheel.angular_speed * DELTA_T;
-		ctx->wheel.angular_speed -= IMPULSE * DELTA_T;
-		ctx->wheel.angular_speed = (ctx->wheel.angular_speed < 0) ? 0 : ctx->wheel.angular_speed;
-
+		Wheel_Step(&ctx->wheel);
 		ctx->physics_time -= DELTA_T;
 	}
+	EGL_PROFILE_END(simulate);
 
 	// Game Logic
 	wheel_AABB.x = (float) (WINDOW_WIDTH - WHEEL_DIAMETER) / 2.0f;
@@ -273,6 +425,7 @@ SDL_AppResult SDL_AppIterate(void *appstate)
 	center.y = (float) WHEEL_RADIUS;
 
 	// Draw frame
+	EGL_PROFILE_BEGIN(draw, "draw");
 	const float render_angle = glm_lerp(ctx->wheel.angle_prev, ctx->wheel.angle, ((float) ctx->physics_time) / DELTA_T);
 
 	SDL_SetRenderDrawColor(ctx->renderer, 0, 0, 0, SDL_ALPHA_OPAQUE);
@@ -283,17 +436,34 @@ SDL_AppResult SDL_AppIterate(void *appstate)
 	SDL_SetRenderDrawColor(ctx->renderer, 255, 255, 255, SDL_ALPHA_OPAQUE);  /* white, full alpha */
 
 #ifdef DEBUG
-	if (ctx->frames >= 10) {
-		ctx->avg_fps = 10000.0f / (float)ctx->frame_time;
-		ctx->frame_time = 0;
-		ctx->frames = 0;
+	if (ctx->stats.frames % STATS_REPORT == 0) {
+		EGL_FrameStatsWindow(&ctx->stats, &ctx->report);
 	}
-    SDL_RenderDebugTextFormat(ctx->renderer, 10, 10, "%f FPS", ctx->avg_fps);
-	ctx->frame_time += now - ctx->prev_tick;
-	ctx->frames += 1;
+	const EGL_FrameReport *r = &ctx->report;
+	SDL_RenderDebugTextFormat(ctx->renderer, 10, 10, "cpu   p50 %5.2f  p95 %5.2f  p99 %5.2f  max %5.2f ms",
+		r->cpu.p50 / 1e6, r->cpu.p95 / 1e6, r->cpu.p99 / 1e6, r->cpu.max / 1e6);
+	SDL_RenderDebugTextFormat(ctx->renderer, 10, 20, "frame p50 %5.2f  p95 %5.2f  p99 %5.2f  max %5.2f ms",
+		r->interval.p50 / 1e6, r->interval.p95 / 1e6, r->interval.p99 / 1e6, r->interval.max / 1e6);
+	SDL_RenderDebugTextFormat(ctx->renderer, 10, 30, "missed %llu vsyncs in %llu frames",
+		(unsigned long long)r->missed, (unsigned long long)r->frames);
+	SDL_RenderDebugTextFormat(ctx->renderer, 10, 40, "alloc %llu calls, %llu bytes last frame",
+		(unsigned long long)ctx->frame_allocs.allocs, (unsigned long long)ctx->frame_allocs.bytes);
 #endif
+	EGL_PROFILE_END(draw);
 
+	const Uint64 frame_end = SDL_GetTicksNS();
+	EGL_PROFILE_BEGIN(present, "present");
 	SDL_RenderPresent(ctx->renderer);
+	EGL_PROFILE_END(present);
+	EGL_FrameStatsAdd(&ctx->stats, frame_end - frame_begin, SDL_GetTicksNS());
+
+	EGL_AllocFrame(&ctx->frame_allocs);
+	if (ctx->alloc_budget >= 0 && ctx->stats.frames > ALLOC_WARMUP && ctx->frame_allocs.allocs > (Uint64)ctx->alloc_budget) {
+		SDL_Log("Frame %llu allocated %llu times (%llu bytes), over the budget of %lld.\n", (unsigned long long)ctx->stats.frames,
+			(unsigned long long)ctx->frame_allocs.allocs, (unsigned long long)ctx->frame_allocs.bytes, (long long)ctx->alloc_budget);
+		EGL_AllocPrintSites(stderr, 8);
+		return SDL_APP_FAILURE;
+	}
 
 	// Update frame timer
 	ctx->prev_tick = now;
@@ -313,8 +483,18 @@ void SDL_AppQuit(void *appstate, SDL_AppResult result)
 		if (ctx->font.ttf) {
 			TTF_CloseFont(ctx->font.ttf);
 		}
+		EGL_AssetLoaderFree(&ctx->loader);
+		SDL_DestroySurface((SDL_Surface *)ctx->wheel_asset.result);
+		EGL_PackClose(&ctx->pack);
 
 		TTF_Quit();
+		EGL_ProfileStop();
+
+		if (ctx->stats_path && !EGL_FrameStatsWrite(&ctx->stats, ctx->stats_path)) {
+			SDL_Log("Failure to write frame statistics to %s.\n", ctx->stats_path);
+		}
+		EGL_FrameStatsFree(&ctx->stats);
+		EGL_ArenaFree(&ctx->scratch);
 		SDL_free(ctx);
 	}
 }
@@ -16,15 +16,43 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <stdlib.h>
 
 #include <EGL/EGL_3d.h>
+#include <EGL/EGL_snapshot.h>
+#include <EGL/EGL_simthread.h>
+#include <EGL/EGL_random.h>
+#include <EGL/EGL_profile.h>
+#include <EGL/EGL_framestats.h>
+#include <EGL/EGL_alloc.h>
+#include <EGL/EGL_assets.h>
+#include <EGL/EGL_pack.h>
+#include <EGL/EGL_texture.h>
+#include <EGL/EGL_staging.h>
+#include <EGL/EGL_instance.h>
+#include <EGL/EGL_raster.h>
 
 #include <cglm/cglm.h>
 
 #include "world.h"
 
 
-#define PATH_MAX 4096
+#define SCRATCH_BYTES 65536 // Temporary memory for a frame, or for loading.
+#define STAGING_BYTES (4 << 20) // The upload ring, shared by every frame in flight.
+#define STAGING_COPIES 64      // Uploads staged in one frame.
+
+#define ALIENS_DEFAULT 2048  // Aliens hovering over the planet (--aliens N).
+#define TOWERS 256
+#define ALIEN_ALTITUDE 1.3f  // Distance from the planet's center, in its radii.
+#define ALIEN_SIZE 0.04f
+#define TOWER_SIZE 0.06f
+#define INSTANCE_DRAWS 8     // Distinct meshes and materials drawn instanced in a frame.
+#define RASTER_INSTANCES 16384 // Instances drawn on the CPU at once, so their indices fit in 16 bits.
+#define GOLDEN_PSNR 40.0     // dB a headless render must reach against its golden image (--golden path).
+
+/* Meshes and materials of instanced draws, as their draw keys hold them */
+enum { MESH_QUAD };
+enum { MATERIAL_ALIEN, MATERIAL_TOWER };
 
 #define WINDOW_WIDTH  800
 #define WINDOW_HEIGHT 800
@@ -32,6 +60,10 @@
 #define FOVY 1.2217304763960306f // 70 deg in radians
 #define OMEGA 0.01//0.0031415926535897933f // rad / ms
 #define DELTA_T 16 // milliseconds per simulation tick (16 ~ 60 FPS, 32 ~ 30 FPS)
+#define DELTA_T_NS SDL_MS_TO_NS(DELTA_T)
+#define STATS_WINDOW 240 // Frames in the rolling frame time statistics, logged once per window.
+#define REFRESH_NS_DEFAULT 16666667 // Vsync period when the display does not report one (60 Hz).
+#define ALLOC_WARMUP 60 // Frames before the allocation budget applies (--alloc-budget N).
 
 #define STRIDE 32
 
@@ -40,15 +72,38 @@ typedef struct {
 	mat4 mvp;
 } UBO;
 
+/* Objects on the planet, in its model space, laid out as EGL_InstanceSource reads them */
+typedef struct {
+	float *x, *y, *z;
+	float *rotation_x, *rotation_y, *rotation_z, *rotation_w; // Facing away from the planet.
+	float *scale;
+	Uint32 *color;
+	float *phase;
+	float *rate; // Phase per second.
+	Uint32 count;
+} Swarm;
+
+/* What the simulation thread publishes for rendering */
+typedef struct {
+	Transform previous_transform;
+	Transform transform;
+} SimState;
+
 typedef struct {
 	SDL_Window *window;
 	SDL_Renderer *renderer;
 	SDL_GPUDevice *gpu_dev;
 	SDL_GPUGraphicsPipeline *pipeline;
+	SDL_GPUGraphicsPipeline *instanced_pipeline;
 	SDL_GPUBuffer *vertex_buffer;
+	SDL_GPUBuffer *instance_buffer; // Rewritten each frame from batch.
 	SDL_GPUBuffer *index_buffer;
 	SDL_GPUTexture *brick_texture;
 	SDL_GPUSampler *sampler;
+	SDL_GPUTexture *depth_texture; // Sized to the swapchain, and recreated when it resizes.
+	SDL_GPUTextureFormat depth_format;
+	Uint32 depth_width;
+	Uint32 depth_height;
 
 	World world;
 
@@ -57,8 +112,45 @@ typedef struct {
 	mat4 projection;
 
 	Uint64 total_time;
-	Uint64 physics_time;
-	Uint64 prev_tick;
+	Uint64 physics_time; // Nanoseconds simulated ahead of rendering.
+	Uint64 prev_tick;    // Nanoseconds.
+	Uint64 ticks;
+
+	bool threaded;   // Simulate on ctx->sim instead of in SDL_AppIterate (--sim-thread).
+	EGL_SimThread sim;
+
+	Uint64 headless_ticks; // Simulate this many ticks without a window, then quit (--headless N).
+	const char *render_path; // With --headless, then draw the last tick on the CPU and write it here as a BMP (--render path).
+	const char *golden_path; // Compare that render to this BMP, or record it here if there is none (--golden path).
+	bool seeded;           // Start the planet at a random spin (--seed S).
+	Uint32 seed;
+	uint32_t rng[4];
+
+	EGL_Snapshot planet;             // The planet's last two steps, blended for each frame.
+	EGL_TransformBatch planet_batch; // The blend, and its model matrix.
+
+	EGL_Arena scratch; // Temporary memory, reset at the top of each frame and after loading.
+
+	EGL_Pack pack;          // Every asset, mapped from florbles.pack next to the binary.
+	EGL_AssetLoader loader; // Decodes assets while the window and device are created.
+	EGL_Asset world_asset;
+	EGL_Asset brick_asset;  // Decodes to brick, a view into the pack.
+	EGL_Texture brick;
+
+	EGL_StagingRing staging;               // Every upload goes through one transfer buffer, reused each frame.
+	SDL_GPUTransferBuffer *staging_buffer;
+	SDL_GPUFence *staging_fences[EGL_STAGING_FRAMES]; // Signaled as each frame of uploads is copied.
+
+	Uint32 alien_count; // --aliens N
+	Swarm aliens;
+	Swarm towers;
+	EGL_InstanceBatch batch; // Every alien and tower, sorted into one instanced draw per mesh and material.
+
+	EGL_FrameStats stats;
+	const char *stats_path; // Write whole-run statistics here at quit (--stats path).
+
+	EGL_AllocCounts window_allocs; // Allocations on every thread over the current stats window.
+	Sint64 alloc_budget;           // Fail once a frame past warmup allocates more than this (--alloc-budget N), or -1.
 } AppState;
 
 typedef struct {
@@ -67,21 +159,726 @@ typedef struct {
 	vec2 uv;
 } VertexData;
 
+/* The textured quad through the planet, which instances reuse */
+static const VertexData QUAD_VERTICES[] = {
+	{ .vertex = {-0.5,  0.5,  0.0}, .color = {1.0, 0.0, 0.0, 1}, .uv = {0.0, 0.0} },
+	{ .vertex = { 0.5,  0.5,  0.0}, .color = {0.0, 1.0, 0.0, 1}, .uv = {1.0, 0.0} },
+	{ .vertex = {-0.5, -0.5,  0.0}, .color = {0.0, 0.0, 1.0, 1}, .uv = {0.0, 1.0} },
+	{ .vertex = { 0.5, -0.5,  0.0}, .color = {1.0, 1.0, 0.0, 1}, .uv = {1.0, 1.0} },
+};
+static const uint16_t QUAD_INDICES[] = {
+	0, 1, 2,
+	2, 1, 3,
+};
+
+
+/* One fixed simulation step: everything the game does per tick that is not drawing */
+static void Simulate(Transform *transform, Transform *previous_transform, uint64_t tick)
+{
+	EGL_TransformCopy(transform, previous_transform);
+	EGL_TransformIntegrate(transform, (vec3){ 0.0f, OMEGA, 0.0f }, DELTA_T);
+	if (tick % EGL_QUAT_RENORMALIZE_STEPS == 0) {
+		EGL_QuatNormalize(transform->rotation);
+	}
+}
+
+/* One fixed simulation step, on the simulation thread */
+static void SimStep(void *data, void *state, uint64_t tick)
+{
+	SimState *s = (SimState *)state;
+	if (tick == 1) {
+		EGL_ProfileThreadName("simulation");
+	}
+	EGL_PROFILE_SCOPE("simulate") {
+		Simulate(&s->transform, &s->previous_transform, tick);
+	}
+}
+
+/*
+ * Run ctx->headless_ticks simulation steps as fast as possible, then log the
+ * final state, a checksum of it to compare runs by, and the tick rate.
+ */
+static SDL_AppResult RunHeadless(AppState *ctx)
+{
+	World *world = &ctx->world;
+
+	const Uint64 begin = SDL_GetPerformanceCounter();
+	EGL_PROFILE_SCOPE("headless run") {
+		if (ctx->stats_path) {
+			/* Each tick is a frame with no vsync to miss */
+			Uint64 tick_begin = SDL_GetTicksNS();
+			for (Uint64 tick = 1; tick <= ctx->headless_ticks; tick++) {
+				Simulate(&world->transform, &world->previous_transform, tick);
+				const Uint64 tick_end = SDL_GetTicksNS();
+				EGL_FrameStatsAdd(&ctx->stats, tick_end - tick_begin, tick_end);
+				tick_begin = tick_end;
+			}
+		} else {
+			for (Uint64 tick = 1; tick <= ctx->headless_ticks; tick++) {
+				Simulate(&world->transform, &world->previous_transform, tick);
+			}
+		}
+	}
+	const double seconds = (double)(SDL_GetPerformanceCounter() - begin) / (double)SDL_GetPerformanceFrequency();
+	ctx->ticks = ctx->headless_ticks;
+	EGL_TransformUpdate(&world->transform);
+
+	/* FNV-1a over the state, so runs can be compared for bitwise determinism */
+	Uint32 checksum = 2166136261u;
+	const unsigned char *bytes = (const unsigned char *)&world->transform;
+	for (size_t i = 0; i < sizeof(Transform); i++) {
+		checksum = (checksum ^ bytes[i]) * 16777619u;
+	}
+
+	const float *q = world->transform.rotation;
+	SDL_Log("Headless: %llu ticks, seed %u", (unsigned long long)ctx->ticks, (unsigned)ctx->seed);
+	SDL_Log("Rotation: [%.9g, %.9g, %.9g, %.9g]", q[0], q[1], q[2], q[3]);
+	SDL_Log("Checksum: %08x", (unsigned)checksum);
+	SDL_Log("Time:     %.6f s, %.0f ticks/s", seconds, (seconds > 0.0) ? (double)ctx->ticks / seconds : 0.0);
+	return SDL_APP_SUCCESS;
+}
+
+/* Build the world from sphere.bin, on a decode worker */
+static bool DecodeWorld(EGL_Asset *asset)
+{
+	World *world = &((AppState *)asset->user)->world;
+
+	const bool deserialized = World_Deserialize(world, (const char *)asset->data, asset->size);
+	EGL_AssetFree(asset);
+	if (!deserialized) {
+		SDL_Log("Failure to build world adjacency.");
+		return false;
+	}
+	EGL_PROFILE_BEGIN(build_flow, "build flow field");
+	if (!World_InitFlow(world)) {
+		SDL_Log("Failure to build world flow field.");
+		return false;
+	}
+	EGL_PROFILE_END(build_flow);
+	EGL_PROFILE_BEGIN(build_bvh, "build picking bvh");
+	if (!World_InitPicking(world)) {
+		SDL_Log("Failure to build world picking BVH.");
+		return false;
+	}
+	EGL_PROFILE_END(build_bvh);
+	return true;
+}
+
+/* Place the loaded world, on the main thread */
+static void WorldLoaded(EGL_Asset *asset)
+{
+	AppState *ctx = (AppState *)asset->user;
+	if (asset->state != EGL_ASSET_LOADED) {
+		return;
+	}
+
+	Transform *world_transform = &ctx->world.transform;
+	EGL_TransformReset(world_transform);
+	world_transform->z -= 3.0f;
+	if (ctx->seeded) {
+		EGL_Seed(ctx->rng, ctx->seed);
+		EGL_TransformRotate(world_transform, 2.0f * GLM_PIf * EGL_RandFloat(ctx->rng), (vec3){ 0.0f, 1.0f, 0.0f });
+	}
+	EGL_TransformUpdate(world_transform);
+	EGL_TransformCopy(world_transform, &ctx->world.previous_transform);
+	EGL_TransformCopy(world_transform, &ctx->world.render_transform);
+#ifdef DEBUG
+	EGL_TransformPrint(world_transform);
+#endif
+}
+
+/* Check a cooked texture's header and find its levels, on a decode worker */
+static bool DecodeTexture(EGL_Asset *asset)
+{
+	AppState *ctx = (AppState *)asset->user;
+	if (!EGL_TextureParse(&ctx->brick, asset->data, asset->size)) {
+		return false;
+	}
+	asset->result = &ctx->brick;
+	return true;
+}
+
+/*
+ * The texels are sRGB, but the swapchain is not, so they are sampled raw and
+ * written out as they are. Their mips were still averaged in linear light.
+ */
+static SDL_GPUTextureFormat TextureFormat(EGL_TextureFormat format)
+{
+	switch (format) {
+	case EGL_TEXTURE_BC1:
+		return SDL_GPU_TEXTUREFORMAT_BC1_RGBA_UNORM;
+	case EGL_TEXTURE_BC7:
+		return SDL_GPU_TEXTUREFORMAT_BC7_RGBA_UNORM;
+	case EGL_TEXTURE_RGBA8:
+	default:
+		return SDL_GPU_TEXTUREFORMAT_R8G8B8A8_UNORM;
+	}
+}
+
+/* Match the depth buffer to the swapchain, which changes size with the window */
+static bool ResizeDepth(AppState *ctx, Uint32 w, Uint32 h)
+{
+	if (ctx->depth_texture && ctx->depth_width == w && ctx->depth_height == h) {
+		return true;
+	}
+	SDL_ReleaseGPUTexture(ctx->gpu_dev, ctx->depth_texture);
+	ctx->depth_texture = SDL_CreateGPUTexture(ctx->gpu_dev, (SDL_GPUTextureCreateInfo[]){{
+		.type = SDL_GPU_TEXTURETYPE_2D,
+		.format = ctx->depth_format,
+		.usage = SDL_GPU_TEXTUREUSAGE_DEPTH_STENCIL_TARGET,
+		.width = w,
+		.height = h,
+		.layer_count_or_depth = 1,
+		.num_levels = 1,
+	}});
+	ctx->depth_width = w;
+	ctx->depth_height = h;
+	return ctx->depth_texture != NULL;
+}
+
+/* Queue a packed asset for decoding, straight from the mapping */
+static bool QueueAsset(AppState *ctx, EGL_Asset *asset, const char *name, EGL_AssetDecodeFunc decode, EGL_AssetDoneFunc done)
+{
+	size_t size = 0;
+	const void *data = EGL_PackGet(&ctx->pack, name, &size);
+	if (!data) {
+		SDL_Log("Failure to find %s in the asset archive.", name);
+		return false;
+	}
+	*asset = (EGL_Asset){ .path = name, .decode = decode, .done = done, .user = ctx };
+	EGL_AssetLoadMemory(&ctx->loader, asset, data, size);
+	return true;
+}
+
+/* Hand back the staging bytes of every frame of uploads the GPU has finished */
+static void RetireUploads(AppState *ctx)
+{
+	while (EGL_StagingInFlight(&ctx->staging) > 0) {
+		SDL_GPUFence **fence = &ctx->staging_fences[ctx->staging.retired % EGL_STAGING_FRAMES];
+		if (!SDL_QueryGPUFence(ctx->gpu_dev, *fence)) {
+			return;
+		}
+		SDL_ReleaseGPUFence(ctx->gpu_dev, *fence);
+		*fence = NULL;
+		EGL_StagingRetire(&ctx->staging);
+	}
+}
+
+/* Block until the oldest frame of uploads is copied, then hand back its bytes. False if none is in flight. */
+static bool WaitUploads(AppState *ctx)
+{
+	if (EGL_StagingInFlight(&ctx->staging) == 0) {
+		return false;
+	}
+	SDL_GPUFence **fence = &ctx->staging_fences[ctx->staging.retired % EGL_STAGING_FRAMES];
+	SDL_WaitForGPUFences(ctx->gpu_dev, true, fence, 1);
+	SDL_ReleaseGPUFence(ctx->gpu_dev, *fence);
+	*fence = NULL;
+	EGL_StagingRetire(&ctx->staging);
+	return true;
+}
+
+/* The ring is unmapped while its copies are recorded, and mapped again for the next upload */
+static bool MapStaging(AppState *ctx)
+{
+	if (!ctx->staging.memory) {
+		ctx->staging.memory = (uint8_t *)SDL_MapGPUTransferBuffer(ctx->gpu_dev, ctx->staging_buffer, false);
+	}
+	return ctx->staging.memory != NULL;
+}
+
+/* Stage bytes for a buffer, waiting on the GPU if the ring is full */
+static bool StageBuffer(AppState *ctx, SDL_GPUBuffer *buffer, Uint32 offset, const void *data, Uint32 size)
+{
+	do {
+		if (MapStaging(ctx) && EGL_StagingBuffer(&ctx->staging, buffer, offset, data, size)) {
+			return true;
+		}
+	} while (WaitUploads(ctx));
+	return false;
+}
+
+/* Stage one mip level of a texture, waiting on the GPU if the ring is full */
+static bool StageTexture(AppState *ctx, SDL_GPUTexture *texture, Uint32 level, Uint32 w, Uint32 h, const void *data, Uint32 size)
+{
+	do {
+		if (MapStaging(ctx) && EGL_StagingTexture(&ctx->staging, texture, level, w, h, data, size)) {
+			return true;
+		}
+	} while (WaitUploads(ctx));
+	return false;
+}
+
+/* Record every upload staged this frame in one copy pass, ahead of the frame's drawing */
+static bool FlushUploads(AppState *ctx, SDL_GPUCommandBuffer *cmd_buf)
+{
+	EGL_StagingRing *staging = &ctx->staging;
+	if (staging->copy_count == 0) {
+		return true;
+	}
+	SDL_UnmapGPUTransferBuffer(ctx->gpu_dev, ctx->staging_buffer);
+	staging->memory = NULL;
+
+	SDL_GPUCopyPass *copy_pass = SDL_BeginGPUCopyPass(cmd_buf);
+	if (!copy_pass) {
+		SDL_Log("Failure to begin copy pass: %s", SDL_GetError());
+		return false;
+	}
+	for (Uint32 i = 0; i < staging->copy_count; i++) {
+		const EGL_StagingCopy *c = &staging->copies[i];
+		if (c->texture) {
+			SDL_UploadToGPUTexture(copy_pass,
+				(SDL_GPUTextureTransferInfo[]){{ .transfer_buffer = ctx->staging_buffer, .offset = c->offset }},
+				(SDL_GPUTextureRegion[]){{ .texture = (SDL_GPUTexture *)c->target, .mip_level = c->level, .w = c->width, .h = c->height, .d = 1 }},
+				false);
+		} else {
+			SDL_UploadToGPUBuffer(copy_pass,
+				(SDL_GPUTransferBufferLocation[]){{ .transfer_buffer = ctx->staging_buffer, .offset = c->offset }},
+				(SDL_GPUBufferRegion[]){{ .buffer = (SDL_GPUBuffer *)c->target, .offset = c->target_offset, .size = c->size }},
+				false);
+		}
+	}
+	SDL_EndGPUCopyPass(copy_pass);
+	return true;
+}
+
+/* Submit a frame, with a fence to hand back its staging bytes if it copied any */
+static bool SubmitFrame(AppState *ctx, SDL_GPUCommandBuffer *cmd_buf)
+{
+	if (ctx->staging.copy_count == 0) {
+		return SDL_SubmitGPUCommandBuffer(cmd_buf);
+	}
+	if (EGL_StagingInFlight(&ctx->staging) == EGL_STAGING_FRAMES) {
+		WaitUploads(ctx);
+	}
+	SDL_GPUFence *fence = SDL_SubmitGPUCommandBufferAndAcquireFence(cmd_buf);
+	if (!fence) {
+		return false;
+	}
+	ctx->staging_fences[ctx->staging.frames % EGL_STAGING_FRAMES] = fence;
+	return EGL_StagingEndFrame(&ctx->staging);
+}
+
+/* Scatter count objects over a sphere, each facing out from it */
+static bool InitSwarm(Swarm *s, Uint32 count, float radius, float size, Uint32 tint, uint32_t rng[4])
+{
+	float *floats = (float *)SDL_malloc((size_t)count * 10 * sizeof(float));
+	Uint32 *colors = (Uint32 *)SDL_malloc((size_t)count * sizeof(Uint32));
+	if (!floats || !colors) {
+		SDL_free(floats);
+		SDL_free(colors);
+		return false;
+	}
+	float **arrays[] = { &s->x, &s->y, &s->z, &s->rotation_x, &s->rotation_y, &s->rotation_z, &s->rotation_w, &s->scale, &s->phase, &s->rate };
+	for (size_t a = 0; a < SDL_arraysize(arrays); a++) {
+		*arrays[a] = floats + a * count;
+	}
+	s->color = colors;
+	s->count = count;
+
+	for (Uint32 i = 0; i < count; i++) {
+		const float z = 2.0f * EGL_RandFloat(rng) - 1.0f;
+		const float angle = 2.0f * GLM_PIf * EGL_RandFloat(rng);
+		const float r = SDL_sqrtf(SDL_max(1.0f - z * z, 0.0f));
+		const vec3 n = { r * SDL_cosf(angle), r * SDL_sinf(angle), z };
+		s->x[i] = radius * n[0];
+		s->y[i] = radius * n[1];
+		s->z[i] = radius * n[2];
+
+		/* The shortest arc from +z, the quad's normal, to n */
+		versor q = { -n[1], n[0], 0.0f, 1.0f + n[2] };
+		if (q[3] < 1e-6f) {
+			q[0] = 1.0f; // Straight down: half a turn about x
+			q[1] = q[2] = q[3] = 0.0f;
+		}
+		glm_quat_normalize(q);
+		s->rotation_x[i] = q[0];
+		s->rotation_y[i] = q[1];
+		s->rotation_z[i] = q[2];
+		s->rotation_w[i] = q[3];
+
+		s->scale[i] = size * (0.75f + 0.5f * EGL_RandFloat(rng));
+		s->phase[i] = EGL_RandFloat(rng);
+		s->rate[i] = 1.0f + EGL_RandFloat(rng);
+		const Uint32 shade = 0xC0 + (EGL_RandNext(rng) & 0x3F);
+		s->color[i] = 0xFF000000u | (tint & ((shade << 16) | (shade << 8) | shade));
+	}
+	return true;
+}
+
+static void FreeSwarm(Swarm *s)
+{
+	SDL_free(s->x);
+	SDL_free(s->color);
+	SDL_memset(s, 0, sizeof(*s));
+}
+
+static EGL_InstanceSource SwarmSource(const Swarm *s)
+{
+	return (EGL_InstanceSource){
+		.x = s->x, .y = s->y, .z = s->z,
+		.rotation_x = s->rotation_x, .rotation_y = s->rotation_y, .rotation_z = s->rotation_z, .rotation_w = s->rotation_w,
+		.scale = s->scale, .color = s->color, .phase = s->phase,
+		.count = s->count,
+	};
+}
+
+/* Scatter the aliens and towers, no more than one frame's upload can hold */
+static bool InitInstances(AppState *ctx)
+{
+	uint32_t rng[4];
+	EGL_Seed(rng, ctx->seed);
+	const Uint32 aliens_max = (Uint32)(STAGING_BYTES / EGL_STAGING_FRAMES / sizeof(EGL_Instance)) - TOWERS; // A frame of instances per frame in flight
+	if (ctx->alien_count > aliens_max) {
+		SDL_Log("Limiting aliens to %u.", aliens_max);
+		ctx->alien_count = aliens_max;
+	}
+	const Uint32 instance_count = ctx->alien_count + TOWERS;
+	if (!InitSwarm(&ctx->aliens, ctx->alien_count, ALIEN_ALTITUDE, ALIEN_SIZE, 0x40FF40, rng) ||
+		!InitSwarm(&ctx->towers, TOWERS, 1.0f, TOWER_SIZE, 0xFFC080, rng) ||
+		!EGL_InstanceBatchInit(&ctx->batch, instance_count, INSTANCE_DRAWS)) {
+		SDL_Log("Failure to allocate %u instances.", instance_count);
+		return false;
+	}
+	return true;
+}
+
+/* Advance each object's pulse, wrapping at 1 */
+static void AnimateSwarm(Swarm *s, float seconds)
+{
+	for (Uint32 i = 0; i < s->count; i++) {
+		const float phase = s->phase[i] + s->rate[i] * seconds;
+		s->phase[i] = phase - SDL_floorf(phase);
+	}
+}
+
+/* Entity i of a snapshot state from a transform */
+static void SnapshotWrite(const EGL_SnapshotState *s, Uint32 i, const Transform *t)
+{
+	s->scale_x[i] = t->scale[0];
+	s->scale_y[i] = t->scale[1];
+	s->scale_z[i] = t->scale[2];
+	s->rotation_x[i] = t->rotation[0];
+	s->rotation_y[i] = t->rotation[1];
+	s->rotation_z[i] = t->rotation[2];
+	s->rotation_w[i] = t->rotation[3];
+	s->translation_x[i] = t->translation[0];
+	s->translation_y[i] = t->translation[1];
+	s->translation_z[i] = t->translation[2];
+}
+
+/*
+ * Blend the planet's previous and current steps into world->render_transform
+ * through its snapshot. The aliens and towers sit still in the planet's model
+ * space, so they follow the blended planet and have nothing of their own to
+ * blend; only their phase moves, and that advances with each frame.
+ */
+static void InterpolatePlanet(AppState *ctx, float alpha)
+{
+	World *world = &ctx->world;
+	SnapshotWrite(&ctx->planet.previous, 0, &world->previous_transform);
+	SnapshotWrite(&ctx->planet.current, 0, &world->transform);
+	EGL_SnapshotInterpolate(&ctx->planet, alpha, EGL_INTERPOLATE_SLERP, &ctx->planet_batch, 1);
+	EGL_TransformBatchUpdate(&ctx->planet_batch, 1);
+
+	const EGL_TransformBatch *b = &ctx->planet_batch;
+	Transform *t = &world->render_transform;
+	t->scale[0] = b->scale_x[0];
+	t->scale[1] = b->scale_y[0];
+	t->scale[2] = b->scale_z[0];
+	t->rotation[0] = b->rotation_x[0];
+	t->rotation[1] = b->rotation_y[0];
+	t->rotation[2] = b->rotation_z[0];
+	t->rotation[3] = b->rotation_w[0];
+	t->translation[0] = b->translation_x[0];
+	t->translation[1] = b->translation_y[0];
+	t->translation[2] = b->translation_z[0];
+	SDL_memcpy(t->model, b->models, sizeof(mat4));
+}
+
+/* Pack every alien and tower into the frame's instances, nearest first within each draw */
+static bool BuildInstances(AppState *ctx)
+{
+	/* The camera sits at the origin, which is here in the planet's model space */
+	mat4 inverse;
+	glm_mat4_inv(ctx->world.render_transform.model, inverse);
+	EGL_InstanceBatchBegin(&ctx->batch, inverse[3]);
+
+	const EGL_InstanceSource aliens = SwarmSource(&ctx->aliens);
+	const EGL_InstanceSource towers = SwarmSource(&ctx->towers);
+	return EGL_InstanceBatchAdd(&ctx->batch, MESH_QUAD, MATERIAL_ALIEN, &aliens) &&
+		EGL_InstanceBatchAdd(&ctx->batch, MESH_QUAD, MATERIAL_TOWER, &towers) &&
+		EGL_InstanceBatchBuild(&ctx->batch);
+}
+
+static EGL_RasterVertex RasterVertex(const VertexData *v)
+{
+	return (EGL_RasterVertex){
+		.position = { v->vertex[0], v->vertex[1], v->vertex[2] },
+		.color = { v->color.r, v->color.g, v->color.b, v->color.a },
+		.uv = { v->uv[0], v->uv[1] },
+	};
+}
+
+/* A vertex of one instance, in the planet's model space, as instanced_vert.glsl places it */
+static EGL_RasterVertex InstanceVertex(const EGL_Instance *instance, const VertexData *v)
+{
+	vec3 q = { instance->rotation[0] / 32767.0f, instance->rotation[1] / 32767.0f, instance->rotation[2] / 32767.0f };
+	const float w = instance->rotation[3] / 32767.0f;
+	const float pulse = 1.0f + 0.15f * SDL_sinf(2.0f * GLM_PIf * instance->phase);
+	vec3 p = { v->vertex[0], v->vertex[1], v->vertex[2] }, t, u;
+	glm_vec3_scale(p, instance->scale * pulse, p);
+	glm_vec3_cross(q, p, t);
+	for (int c = 0; c < 3; c++) {
+		t[c] += w * p[c];
+	}
+	glm_vec3_cross(q, t, u);
+
+	EGL_RasterVertex out = RasterVertex(v);
+	for (int c = 0; c < 3; c++) {
+		out.position[c] = instance->position[c] + p[c] + 2.0f * u[c];
+	}
+	for (int c = 0; c < 4; c++) {
+		out.color[c] *= (float)((instance->color >> (8 * c)) & 0xFF) / 255.0f;
+	}
+	return out;
+}
+
+/*
+ * Draw the last headless tick on the CPU, as a frame would show it, into
+ * ctx->render_path. With ctx->golden_path, fail unless the render is within
+ * GOLDEN_PSNR of it, or record the render there if it does not exist yet.
+ */
+static bool RenderHeadless(AppState *ctx)
+{
+	World *world = &ctx->world;
+	const EGL_Texture *brick = &ctx->brick;
+
+	EGL_Image texture = { 0 };
+	EGL_Raster raster = { 0 };
+	EGL_RasterVertex *vertices = NULL;
+	uint16_t *indices = NULL;
+	uint8_t *bmp = NULL;
+	bool ok = false;
+
+	/* The frame after the last tick, with every alien pulsing for as long as it ran */
+	if (!InitInstances(ctx)) {
+		goto done;
+	}
+	AnimateSwarm(&ctx->aliens, (float)(ctx->ticks * DELTA_T) * 1e-3f);
+	EGL_TransformCopy(&world->transform, &world->render_transform);
+	EGL_TransformUpdate(&world->render_transform);
+	glm_perspective(FOVY, (float)WINDOW_WIDTH / (float)WINDOW_HEIGHT, 0.0001, 1000, ctx->projection);
+	glm_mat4_mul(ctx->projection, world->render_transform.model, ctx->ubo.mvp);
+	if (!BuildInstances(ctx)) {
+		SDL_Log("Failure to build instances.");
+		goto done;
+	}
+
+	/* Top level only: the CPU samples without mips */
+	vertices = (EGL_RasterVertex *)SDL_malloc(RASTER_INSTANCES * 4 * sizeof(EGL_RasterVertex));
+	indices = (uint16_t *)SDL_malloc(RASTER_INSTANCES * 6 * sizeof(uint16_t));
+	if (!vertices || !indices || !EGL_ImageInit(&texture, brick->width, brick->height) ||
+		!EGL_RasterInit(&raster, WINDOW_WIDTH, WINDOW_HEIGHT, 4 * (ctx->batch.count + 1))) {
+		SDL_Log("Failure to allocate a %dx%d render.", WINDOW_WIDTH, WINDOW_HEIGHT);
+		goto done;
+	}
+	EGL_TextureDecode(brick->data[0], brick->format, brick->width, brick->height, texture.pixels);
+	for (Uint32 i = 0; i < RASTER_INSTANCES * 6; i++) {
+		indices[i] = (uint16_t)(i / 6 * 4 + QUAD_INDICES[i % 6]);
+	}
+
+	const Uint64 begin = SDL_GetTicksNS();
+	const float *mvp = (const float *)ctx->ubo.mvp;
+	EGL_RasterBegin(&raster, 0xFF663300u, 1.0f); // The frame's clear color
+	for (Uint32 k = 0; k < SDL_arraysize(QUAD_VERTICES); k++) {
+		vertices[k] = RasterVertex(&QUAD_VERTICES[k]);
+	}
+	ok = EGL_RasterDraw(&raster, mvp, vertices, SDL_arraysize(QUAD_VERTICES), QUAD_INDICES, SDL_arraysize(QUAD_INDICES), &texture);
+	for (Uint32 i = 0; i < ctx->batch.draw_count; i++) {
+		const EGL_DrawBatch *draw = &ctx->batch.draws[i];
+		for (Uint32 first = 0; first < draw->count; first += RASTER_INSTANCES) {
+			const Uint32 count = SDL_min(draw->count - first, RASTER_INSTANCES);
+			for (Uint32 n = 0; n < count; n++) {
+				const EGL_Instance *instance = &ctx->batch.instances[draw->first + first + n];
+				for (Uint32 k = 0; k < 4; k++) {
+					vertices[n * 4 + k] = InstanceVertex(instance, &QUAD_VERTICES[k]);
+				}
+			}
+			ok = EGL_RasterDraw(&raster, mvp, vertices, count * 4, indices, count * 6, &texture) && ok;
+		}
+	}
+	ok = EGL_RasterEnd(&raster) && ok;
+	const double seconds = (double)(SDL_GetTicksNS() - begin) * 1e-9;
+	if (!ok) {
+		SDL_Log("Failure to render %u instances.", ctx->batch.count);
+		goto done;
+	}
+	SDL_Log("Render:   %s, %u triangles in %.3f ms", ctx->render_path, raster.triangle_count, seconds * 1e3);
+
+	/* FNV-1a over the pixels, so renders can be compared without keeping them */
+	Uint32 checksum = 2166136261u;
+	for (size_t i = 0; i < (size_t)WINDOW_WIDTH * WINDOW_HEIGHT * 4; i++) {
+		checksum = (checksum ^ raster.target.pixels[i]) * 16777619u;
+	}
+	SDL_Log("Checksum: %08x", (unsigned)checksum);
+
+	ok = false;
+	const size_t size = EGL_ImageWriteBMP(&raster.target, &bmp);
+	if (!size || !SDL_SaveFile(ctx->render_path, bmp, size)) {
+		SDL_Log("Failure to write %s.", ctx->render_path);
+		goto done;
+	}
+	if (ctx->golden_path) {
+		size_t golden_size = 0;
+		void *golden_bmp = SDL_LoadFile(ctx->golden_path, &golden_size);
+		if (!golden_bmp) {
+			SDL_Log("Golden:   none at %s, recording this render.", ctx->golden_path);
+			if (!SDL_SaveFile(ctx->golden_path, bmp, size)) {
+				SDL_Log("Failure to write %s.", ctx->golden_path);
+				goto done;
+			}
+		} else {
+			EGL_Image golden;
+			const bool read = EGL_ImageReadBMP(&golden, golden_bmp, golden_size);
+			SDL_free(golden_bmp);
+			if (!read || golden.width != WINDOW_WIDTH || golden.height != WINDOW_HEIGHT) {
+				SDL_Log("Failure to read a %dx%d golden image from %s.", WINDOW_WIDTH, WINDOW_HEIGHT, ctx->golden_path);
+				if (read) {
+					EGL_ImageFree(&golden);
+				}
+				goto done;
+			}
+			const double psnr = EGL_ImagePSNR(raster.target.pixels, golden.pixels, (size_t)WINDOW_WIDTH * WINDOW_HEIGHT, false);
+			EGL_ImageFree(&golden);
+			SDL_Log("Golden:   %.2f dB against %s, at least %.2f to pass", psnr, ctx->golden_path, GOLDEN_PSNR);
+			if (psnr < GOLDEN_PSNR) {
+				goto done;
+			}
+		}
+	}
+	ok = true;
+
+done:
+	EGL_free(bmp); // From EGL_malloc, not SDL_malloc
+	EGL_RasterFree(&raster);
+	EGL_ImageFree(&texture);
+	SDL_free(vertices);
+	SDL_free(indices);
+	return ok;
+}
 
 SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[])
 {
-	char *path = (char *) SDL_malloc(PATH_MAX * sizeof(char));
-	int err;
+	const Uint64 startup_begin = SDL_GetTicksNS();
+
+	/* Count every allocation SDL and EGL make from here on */
+	SDL_malloc_func malloc_func;
+	SDL_calloc_func calloc_func;
+	SDL_realloc_func realloc_func;
+	SDL_free_func free_func;
+	SDL_GetOriginalMemoryFunctions(&malloc_func, &calloc_func, &realloc_func, &free_func);
+	EGL_AllocWrap(malloc_func, calloc_func, realloc_func, free_func);
+	SDL_SetMemoryFunctions(EGL_AllocMalloc, EGL_AllocCalloc, EGL_AllocRealloc, EGL_AllocFree);
+	EGL_SetMemoryFunctions(EGL_AllocMalloc, EGL_AllocCalloc, EGL_AllocRealloc, EGL_AllocFree);
 
 	AppState *ctx = (AppState *)SDL_calloc(1, sizeof(AppState));
 	if (!ctx) {
 		return SDL_APP_FAILURE;
 	}
 	*appstate = ctx;
+	ctx->alloc_budget = -1;
+	ctx->alien_count = ALIENS_DEFAULT;
+	if (!EGL_ArenaInit(&ctx->scratch, SCRATCH_BYTES)) {
+		SDL_Log("Failure to allocate scratch memory.");
+		return SDL_APP_FAILURE;
+	}
+	if (!EGL_SnapshotInit(&ctx->planet, 1) || !EGL_TransformBatchInit(&ctx->planet_batch, 1)) {
+		SDL_Log("Failure to allocate the planet's snapshot.");
+		return SDL_APP_FAILURE;
+	}
+
+	for (int i = 1; i < argc; i++) {
+		if (SDL_strcmp(argv[i], "--sim-thread") == 0) {
+			ctx->threaded = true;
+		} else if (SDL_strcmp(argv[i], "--headless") == 0 && i + 1 < argc) {
+			ctx->headless_ticks = SDL_strtoull(argv[++i], NULL, 10);
+		} else if (SDL_strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+			ctx->seeded = true;
+			ctx->seed = (Uint32)SDL_strtoul(argv[++i], NULL, 10);
+		} else if (SDL_strcmp(argv[i], "--profile") == 0 && i + 1 < argc) {
+			if (!EGL_ProfileStart(argv[++i])) {
+				SDL_Log("Failure to open trace file %s.", argv[i]);
+			}
+			EGL_ProfileThreadName("main");
+		} else if (SDL_strcmp(argv[i], "--stats") == 0 && i + 1 < argc) {
+			ctx->stats_path = argv[++i];
+		} else if (SDL_strcmp(argv[i], "--alloc-budget") == 0 && i + 1 < argc) {
+			ctx->alloc_budget = (Sint64)SDL_strtoull(argv[++i], NULL, 10);
+		} else if (SDL_strcmp(argv[i], "--aliens") == 0 && i + 1 < argc) {
+			ctx->alien_count = (Uint32)SDL_strtoul(argv[++i], NULL, 10);
+		} else if (SDL_strcmp(argv[i], "--render") == 0 && i + 1 < argc) {
+			ctx->render_path = argv[++i];
+		} else if (SDL_strcmp(argv[i], "--golden") == 0 && i + 1 < argc) {
+			ctx->golden_path = argv[++i];
+		}
+	}
+
+	/* Map every asset at once, then decode them on other threads while the window and device are created */
+	const char *path = EGL_ArenaPrintf(&ctx->scratch, "%sflorbles.pack", SDL_GetBasePath());
+	if (!path) {
+		SDL_Log("Failure to write path to buffer.");
+		return SDL_APP_FAILURE;
+	}
+	if (!EGL_PackOpen(&ctx->pack, path)) {
+		SDL_Log("Failure to open asset archive %s.", path);
+		return SDL_APP_FAILURE;
+	}
+	if (!EGL_AssetLoaderInit(&ctx->loader, 0)) {
+		SDL_Log("Failure to start the asset loader.");
+		return SDL_APP_FAILURE;
+	}
+	if (!QueueAsset(ctx, &ctx->world_asset, "sphere.bin", DecodeWorld, WorldLoaded)) {
+		return SDL_APP_FAILURE;
+	}
+
+	/* The simulation needs no window or GPU, and neither does a render of it */
+	if (ctx->headless_ticks > 0) {
+		if (ctx->render_path && !QueueAsset(ctx, &ctx->brick_asset, "bricks.tex", DecodeTexture, NULL)) {
+			return SDL_APP_FAILURE;
+		}
+		if (!EGL_AssetWait(&ctx->loader, &ctx->world_asset)) {
+			SDL_Log("Failure to load world from %s.", ctx->world_asset.path);
+			return SDL_APP_FAILURE;
+		}
+		if (ctx->render_path && !EGL_AssetWait(&ctx->loader, &ctx->brick_asset)) {
+			SDL_Log("Failure to load %s.", ctx->brick_asset.path);
+			return SDL_APP_FAILURE;
+		}
+		EGL_AssetLoaderFree(&ctx->loader);
+		if (!ctx->render_path) {
+			EGL_PackClose(&ctx->pack); // The bricks are viewed in place, so a render keeps it until quit
+		}
+		if (!EGL_FrameStatsInit(&ctx->stats, STATS_WINDOW, 0)) {
+			SDL_Log("Failure to allocate frame statistics.");
+			return SDL_APP_FAILURE;
+		}
+		SDL_Log("Startup: %.3f ms", (double)(SDL_GetTicksNS() - startup_begin) * 1e-6);
+		const SDL_AppResult result = RunHeadless(ctx);
+		if (result != SDL_APP_SUCCESS || !ctx->render_path) {
+			return result;
+		}
+		return RenderHeadless(ctx) ? SDL_APP_SUCCESS : SDL_APP_FAILURE;
+	}
+
+	if (!QueueAsset(ctx, &ctx->brick_asset, "bricks.tex", DecodeTexture, NULL)) {
+		return SDL_APP_FAILURE;
+	}
 
 	glm_perspective(FOVY, (float)WINDOW_WIDTH / (float)WINDOW_HEIGHT, 0.0001, 1000, ctx->projection);
 
 	/* Initialize App */
+	EGL_PROFILE_BEGIN(create_device, "create window and device");
     SDL_SetAppMetadata("Florbles: Alien Invasion!", "0.0.0a", "com.florbles");
 
     if (!SDL_Init(SDL_INIT_VIDEO)) {
@@ -97,6 +894,14 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[])
     }
 	//SDL_SetRenderVSync(ctx->renderer, SDL_RENDERER_VSYNC_ADAPTIVE);
 
+	/* Count missed deadlines against the display the window opened on */
+	const SDL_DisplayMode *mode = SDL_GetCurrentDisplayMode(SDL_GetDisplayForWindow(ctx->window));
+	const Uint64 refresh_ns = (mode && mode->refresh_rate > 0.0f) ? (Uint64)(1e9 / mode->refresh_rate) : REFRESH_NS_DEFAULT;
+	if (!EGL_FrameStatsInit(&ctx->stats, STATS_WINDOW, refresh_ns)) {
+		SDL_Log("Failure to allocate frame statistics.");
+		return SDL_APP_FAILURE;
+	}
+
 	/* Initialize GPU Device */
 	ctx->gpu_dev = SDL_CreateGPUDevice(SDL_GPU_SHADERFORMAT_SPIRV, DEBUG, NULL);
     if (!ctx->gpu_dev) {
@@ -106,70 +911,58 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[])
 
 	SDL_ClaimWindowForGPUDevice(ctx->gpu_dev, ctx->window);
 
-	/* Initialize Sphere */
-	err = SDL_snprintf(path, PATH_MAX, "%ssphere.bin", SDL_GetBasePath());
-	if (err < 0) {
-		SDL_Log("Failure to write path to buffer.");
+	ctx->staging_buffer = SDL_CreateGPUTransferBuffer(ctx->gpu_dev, (SDL_GPUTransferBufferCreateInfo[]){{
+		.usage = SDL_GPU_TRANSFERBUFFERUSAGE_UPLOAD,
+		.size = STAGING_BYTES,
+	}});
+	if (!ctx->staging_buffer || !EGL_StagingInit(&ctx->staging, STAGING_BYTES, STAGING_COPIES)) {
+		SDL_Log("Failure to create staging buffer: %s", SDL_GetError());
 		return SDL_APP_FAILURE;
 	}
-
-	char *data = (char *) SDL_LoadFile(path, NULL);
-	if (!data) {
-		SDL_Log("Failure to load file at %s.", path);
-		return SDL_APP_FAILURE;
+	EGL_PROFILE_END(create_device);
+
+	/* Finish Loading */
+	EGL_PROFILE_BEGIN(wait_assets, "wait for assets");
+	EGL_AssetWaitAll(&ctx->loader);
+	EGL_AssetLoaderFree(&ctx->loader);
+	EGL_PROFILE_END(wait_assets);
+	const EGL_Asset *required[] = { &ctx->world_asset, &ctx->brick_asset };
+	for (size_t i = 0; i < SDL_arraysize(required); i++) {
+		if (required[i]->state != EGL_ASSET_LOADED) {
+			SDL_Log("Failure to load %s.", required[i]->path);
+			return SDL_APP_FAILURE;
+		}
 	}
 
-	World_Deserialize(&ctx->world, data);
-
-
-	Transform *world_transform = &ctx->world.transform;
-	EGL_TransformReset(world_transform);
-	world_transform->z -= 3.0f;
-	EGL_TransformUpdate(world_transform);
-	EGL_TransformCopy(world_transform, &ctx->world.render_transform);
-#ifdef DEBUG
-	EGL_TransformPrint(world_transform);
-#endif
-
 	/* Load Texture */
-	err = SDL_snprintf(path, PATH_MAX, "%sbricks.bmp", SDL_GetBasePath());
-	if (err < 0) {
-		SDL_Log("Failure to write path to buffer.");
-		return SDL_APP_FAILURE;
-	}
-
-	SDL_Surface *brick_surface = SDL_LoadBMP(path);
-	if (!brick_surface) {
-		SDL_Log("Failure to load bitmap: %s", SDL_GetError());
-		return SDL_APP_FAILURE;
-	}
-
-	const uint32_t brick_texture_size = brick_surface->w * brick_surface->h * 2;
+	EGL_PROFILE_BEGIN(load_texture, "load texture");
+	const EGL_Texture *brick = &ctx->brick;
 	ctx->brick_texture = SDL_CreateGPUTexture(ctx->gpu_dev, (SDL_GPUTextureCreateInfo[]){(SDL_GPUTextureCreateInfo){
 		.type = SDL_GPU_TEXTURETYPE_2D,	
-		.format = SDL_GPU_TEXTUREFORMAT_B5G5R5A1_UNORM,
+		.format = TextureFormat(brick->format),
 		.usage = SDL_GPU_TEXTUREUSAGE_SAMPLER,
-		.width = brick_surface->w,
-		.height = brick_surface->h,
+		.width = brick->width,
+		.height = brick->height,
 		.layer_count_or_depth = 1,
-		.num_levels = 1,
+		.num_levels = brick->levels,
 	}});
 	if (!ctx->brick_texture) {
 		SDL_Log("Failure to create brick texture: %s", SDL_GetError());
 		return SDL_APP_FAILURE;
 	}
 
+	EGL_PROFILE_END(load_texture);
+
 	/* Initialize Shaders */
-	// TODO: EGL_LoadShader to make this less annoying
-	err = SDL_snprintf(path, PATH_MAX, "%striangle_frag.spv", SDL_GetBasePath());
-	if (err < 0) {
-		SDL_Log("Failure to write path to buffer.");
-		return SDL_APP_FAILURE;
-	}
+	EGL_PROFILE_BEGIN(load_shaders, "load shaders");
 	size_t frag_shader_size = 0;
-	Uint8 *frag_shader_bin = (Uint8 *) SDL_LoadFile(path, &frag_shader_size);
-	if (!frag_shader_bin) {
-		SDL_Log("Failure to load shader at %s.", path);
+	size_t vert_shader_size = 0;
+	const Uint8 *frag_shader_bin = (const Uint8 *)EGL_PackGet(&ctx->pack, "triangle_frag.spv", &frag_shader_size);
+	const Uint8 *vert_shader_bin = (const Uint8 *)EGL_PackGet(&ctx->pack, "triangle_vert.spv", &vert_shader_size);
+	size_t instanced_shader_size = 0;
+	const Uint8 *instanced_shader_bin = (const Uint8 *)EGL_PackGet(&ctx->pack, "instanced_vert.spv", &instanced_shader_size);
+	if (!frag_shader_bin || !vert_shader_bin || !instanced_shader_bin) {
+		SDL_Log("Failure to find shaders in the asset archive.");
 		return SDL_APP_FAILURE;
 	}
 	SDL_GPUShader *frag_shader = SDL_CreateGPUShader(ctx->gpu_dev, (SDL_GPUShaderCreateInfo[]){{
@@ -181,17 +974,6 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[])
 		.num_samplers = 1,
 	}});
 
-	err = SDL_snprintf(path, PATH_MAX, "%striangle_vert.spv", SDL_GetBasePath());
-	if (err < 0) {
-		SDL_Log("Failure to write path to buffer.");
-		return SDL_APP_FAILURE;
-	}
-	size_t vert_shader_size = 0;
-	Uint8 *vert_shader_bin = (Uint8 *) SDL_LoadFile(path, &vert_shader_size);
-	if (!vert_shader_bin) {
-		SDL_Log("Failure to load shader at %s.", path);
-		return SDL_APP_FAILURE;
-	}
 	SDL_GPUShader *vert_shader = SDL_CreateGPUShader(ctx->gpu_dev, (SDL_GPUShaderCreateInfo[]){{
 		.code_size = vert_shader_size,
 		.code = vert_shader_bin,
@@ -201,22 +983,21 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[])
 		.num_uniform_buffers = 1,
 	}});
 
-	/* Initialize Graphics Pipeline */
-	const uint32_t vertex_count = 4;
-	VertexData *vertices = (VertexData[]){
-		{ .vertex = {-0.5,  0.5,  0.0}, .color = {1.0, 0.0, 0.0, 1}, .uv = {0.0, 0.0} },
-		{ .vertex = { 0.5,  0.5,  0.0}, .color = {0.0, 1.0, 0.0, 1}, .uv = {1.0, 0.0} },
-		{ .vertex = {-0.5, -0.5,  0.0}, .color = {0.0, 0.0, 1.0, 1}, .uv = {0.0, 1.0} },
-		{ .vertex = { 0.5, -0.5,  0.0}, .color = {1.0, 1.0, 0.0, 1}, .uv = {1.0, 1.0} },
-	};
-	const uint32_t vert_size = vertex_count * sizeof(VertexData);
+	SDL_GPUShader *instanced_shader = SDL_CreateGPUShader(ctx->gpu_dev, (SDL_GPUShaderCreateInfo[]){{
+		.code_size = instanced_shader_size,
+		.code = instanced_shader_bin,
+		.entrypoint = "main",
+		.format = SDL_GPU_SHADERFORMAT_SPIRV,
+		.stage = SDL_GPU_SHADERSTAGE_VERTEX,
+		.num_uniform_buffers = 1,
+	}});
 
-	const uint32_t index_count = 6;
-	uint16_t *indices = (uint16_t[]){
-		0, 1, 2,
-		2, 1, 3,
-	};
-	const uint32_t index_size = index_count * sizeof(*indices);
+	EGL_PROFILE_END(load_shaders);
+
+	/* Initialize Graphics Pipeline */
+	EGL_PROFILE_BEGIN(upload, "upload buffers and texture");
+	const uint32_t vert_size = sizeof(QUAD_VERTICES);
+	const uint32_t index_size = sizeof(QUAD_INDICES);
 
 	ctx->vertex_buffer = SDL_CreateGPUBuffer(ctx->gpu_dev, (SDL_GPUBufferCreateInfo[]){{
 		.usage = SDL_GPU_BUFFERUSAGE_VERTEX,
@@ -236,95 +1017,48 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[])
 		return SDL_APP_FAILURE;
 	}
 
-	SDL_GPUTransferBuffer *transfer_buffer = SDL_CreateGPUTransferBuffer(ctx->gpu_dev, (SDL_GPUTransferBufferCreateInfo[]){{
-		.usage = SDL_GPU_TRANSFERBUFFERUSAGE_UPLOAD,
-		.size = vert_size + index_size,
-	}});
-	if (!transfer_buffer) {
-		SDL_Log("Failure to create transfer buffer: %s", SDL_GetError());
+	/* Aliens and towers, drawn instanced from one buffer rewritten each frame */
+	if (!InitInstances(ctx)) {
 		return SDL_APP_FAILURE;
 	}
-
-	SDL_GPUTransferBuffer *tex_transfer_buffer = SDL_CreateGPUTransferBuffer(ctx->gpu_dev, (SDL_GPUTransferBufferCreateInfo[]){{
-		.usage = SDL_GPU_TRANSFERBUFFERUSAGE_UPLOAD,
-		.size = brick_texture_size,
+	const Uint32 instance_count = ctx->batch.capacity;
+	ctx->instance_buffer = SDL_CreateGPUBuffer(ctx->gpu_dev, (SDL_GPUBufferCreateInfo[]){{
+		.usage = SDL_GPU_BUFFERUSAGE_VERTEX,
+		.size = instance_count * (Uint32)sizeof(EGL_Instance),
 	}});
-	if (!tex_transfer_buffer) {
-		SDL_Log("Failure to create transfer buffer: %s", SDL_GetError());
+	if (!ctx->instance_buffer) {
+		SDL_Log("Failure to create instance buffer: %s", SDL_GetError());
 		return SDL_APP_FAILURE;
 	}
 
-	void *transfer_mem = SDL_MapGPUTransferBuffer(ctx->gpu_dev, transfer_buffer, false);
-	if (!transfer_mem) {
-		SDL_Log("Failure to obtain transfer memory: %s", SDL_GetError());
-		return SDL_APP_FAILURE;
+	/* Everything goes up in one copy pass, through the staging ring */
+	bool ok = StageBuffer(ctx, ctx->vertex_buffer, 0, QUAD_VERTICES, vert_size) &&
+		StageBuffer(ctx, ctx->index_buffer, 0, QUAD_INDICES, index_size);
+	for (Uint32 level = 0; ok && level < brick->levels; level++) {
+		ok = StageTexture(ctx, ctx->brick_texture, level, SDL_max(brick->width >> level, 1), SDL_max(brick->height >> level, 1),
+			brick->data[level], (Uint32)brick->sizes[level]);
 	}
-	SDL_memcpy(transfer_mem, vertices, vert_size);
-	SDL_memcpy((uint8_t *)transfer_mem + vert_size, indices, index_size);
-
-	void *tex_transfer_mem = SDL_MapGPUTransferBuffer(ctx->gpu_dev, tex_transfer_buffer, false);
-	if (!tex_transfer_mem) {
-		SDL_Log("Failure to obtain transfer memory: %s", SDL_GetError());
+	if (!ok) {
+		SDL_Log("Failure to stage uploads: %s", SDL_GetError());
 		return SDL_APP_FAILURE;
 	}
-	SDL_memcpy(tex_transfer_mem, brick_surface->pixels, brick_texture_size);
-
-	SDL_UnmapGPUTransferBuffer(ctx->gpu_dev, transfer_buffer);
-	SDL_UnmapGPUTransferBuffer(ctx->gpu_dev, tex_transfer_buffer);
 
 	SDL_GPUCommandBuffer *copy_cmd_buf = SDL_AcquireGPUCommandBuffer(ctx->gpu_dev);
 	if (!copy_cmd_buf) {
 		SDL_Log("Failure to create copy cmd buffer: %s", SDL_GetError());
 		return SDL_APP_FAILURE;
 	}
-
-	SDL_GPUCopyPass *copy_pass = SDL_BeginGPUCopyPass(copy_cmd_buf);
-	if (!copy_pass) {
-		SDL_Log("Failure to begin copy pass: %s", SDL_GetError());
+	if (!FlushUploads(ctx, copy_cmd_buf)) {
 		return SDL_APP_FAILURE;
 	}
+	ok = SubmitFrame(ctx, copy_cmd_buf); SDL_assert(ok);
+	EGL_PROFILE_END(upload);
 
-	SDL_UploadToGPUBuffer(copy_pass,
-		(SDL_GPUTransferBufferLocation[]){{
-			.transfer_buffer = transfer_buffer,
-		}},
-		(SDL_GPUBufferRegion[]){{
-			.buffer = ctx->vertex_buffer,
-			.size = vert_size,
-		}},
-		false);
-
-	SDL_UploadToGPUBuffer(copy_pass,
-		(SDL_GPUTransferBufferLocation[]){{
-			.transfer_buffer = transfer_buffer,
-			.offset = vert_size,
-		}},
-		(SDL_GPUBufferRegion[]){{
-			.buffer = ctx->index_buffer,
-			.size = index_size,
-		}},
-		false);
-
-	SDL_UploadToGPUTexture(copy_pass,
-		(SDL_GPUTextureTransferInfo[]){(SDL_GPUTextureTransferInfo){
-			.transfer_buffer = tex_transfer_buffer,
-		}},
-		(SDL_GPUTextureRegion[]){(SDL_GPUTextureRegion){
-			.texture = ctx->brick_texture,
-			.w = brick_surface->w,
-			.h = brick_surface->h,
-			.d = 1,
-		}},
-		false);
-
-	SDL_EndGPUCopyPass(copy_pass);
-
-	bool ok = SDL_SubmitGPUCommandBuffer(copy_cmd_buf); SDL_assert(ok);
-
-	SDL_ReleaseGPUTransferBuffer(ctx->gpu_dev, transfer_buffer);
-
+	EGL_PROFILE_BEGIN(create_pipeline, "create pipeline");
 	ctx->sampler = SDL_CreateGPUSampler(ctx->gpu_dev, (SDL_GPUSamplerCreateInfo[]){(SDL_GPUSamplerCreateInfo){
+		.mipmap_mode = SDL_GPU_SAMPLERMIPMAPMODE_LINEAR,
 		.max_anisotropy = 16.0,
+		.max_lod = (float)ctx->brick.levels,
 		.enable_anisotropy = true,
 	}});
 	if (!ctx->sampler) {
@@ -332,6 +1066,17 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[])
 		return SDL_APP_FAILURE;
 	}
 
+	/* The near plane is close, so take float depth where there is one; 16 bits are always there */
+	ctx->depth_format = SDL_GPUTextureSupportsFormat(ctx->gpu_dev, SDL_GPU_TEXTUREFORMAT_D32_FLOAT, SDL_GPU_TEXTURETYPE_2D,
+		SDL_GPU_TEXTUREUSAGE_DEPTH_STENCIL_TARGET) ? SDL_GPU_TEXTUREFORMAT_D32_FLOAT : SDL_GPU_TEXTUREFORMAT_D16_UNORM;
+	int window_w = 0;
+	int window_h = 0;
+	SDL_GetWindowSizeInPixels(ctx->window, &window_w, &window_h);
+	if (!ResizeDepth(ctx, (Uint32)window_w, (Uint32)window_h)) {
+		SDL_Log("Failure to create depth buffer: %s", SDL_GetError());
+		return SDL_APP_FAILURE;
+	}
+
 	ctx->pipeline = SDL_CreateGPUGraphicsPipeline(ctx->gpu_dev, (SDL_GPUGraphicsPipelineCreateInfo[]){{
 		.vertex_shader = vert_shader,
 		.fragment_shader = frag_shader,
@@ -361,11 +1106,18 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[])
 				},
 			},
 		},
+		.depth_stencil_state = {
+			.compare_op = SDL_GPU_COMPAREOP_LESS,
+			.enable_depth_test = true,
+			.enable_depth_write = true,
+		},
 		.target_info = {
 			.num_color_targets = 1,
 			.color_target_descriptions = (SDL_GPUColorTargetDescription[]){{
 				.format = SDL_GetGPUSwapchainTextureFormat(ctx->gpu_dev, ctx->window),
 			}},
+			.depth_stencil_format = ctx->depth_format,
+			.has_depth_stencil_target = true,
 		}
 	}});
 	if (!ctx->pipeline) {
@@ -373,13 +1125,105 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[])
 		return SDL_APP_FAILURE;
 	}
 
-	SDL_DestroySurface(brick_surface);
+	/* The same vertices, and one EGL_Instance per instance from slot 1 */
+	ctx->instanced_pipeline = SDL_CreateGPUGraphicsPipeline(ctx->gpu_dev, (SDL_GPUGraphicsPipelineCreateInfo[]){{
+		.vertex_shader = instanced_shader,
+		.fragment_shader = frag_shader,
+		.primitive_type = SDL_GPU_PRIMITIVETYPE_TRIANGLELIST,
+		.vertex_input_state = {
+			.num_vertex_buffers = 2,
+			.vertex_buffer_descriptions = (SDL_GPUVertexBufferDescription[]){
+				{
+					.slot = 0,
+					.pitch = sizeof(VertexData),
+				},
+				{
+					.slot = 1,
+					.pitch = sizeof(EGL_Instance),
+					.input_rate = SDL_GPU_VERTEXINPUTRATE_INSTANCE,
+				},
+			},
+			.num_vertex_attributes = 7,
+			.vertex_attributes = (SDL_GPUVertexAttribute[]){
+				{
+					.location = 0,
+					.format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT3,
+					.offset = (uint32_t)offsetof(VertexData, vertex),
+				},
+				{
+					.location = 1,
+					.format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT4,
+					.offset = (uint32_t)offsetof(VertexData, color),
+				},
+				{
+					.location = 2,
+					.format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT2,
+					.offset = (uint32_t)offsetof(VertexData, uv),
+				},
+				{
+					.location = 3,
+					.buffer_slot = 1,
+					.format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT4, // Position, then scale
+					.offset = (uint32_t)offsetof(EGL_Instance, position),
+				},
+				{
+					.location = 4,
+					.buffer_slot = 1,
+					.format = SDL_GPU_VERTEXELEMENTFORMAT_SHORT4_NORM,
+					.offset = (uint32_t)offsetof(EGL_Instance, rotation),
+				},
+				{
+					.location = 5,
+					.buffer_slot = 1,
+					.format = SDL_GPU_VERTEXELEMENTFORMAT_UBYTE4_NORM,
+					.offset = (uint32_t)offsetof(EGL_Instance, color),
+				},
+				{
+					.location = 6,
+					.buffer_slot = 1,
+					.format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT,
+					.offset = (uint32_t)offsetof(EGL_Instance, phase),
+				},
+			},
+		},
+		.depth_stencil_state = {
+			.compare_op = SDL_GPU_COMPAREOP_LESS,
+			.enable_depth_test = true,
+			.enable_depth_write = true,
+		},
+		.target_info = {
+			.num_color_targets = 1,
+			.color_target_descriptions = (SDL_GPUColorTargetDescription[]){{
+				.format = SDL_GetGPUSwapchainTextureFormat(ctx->gpu_dev, ctx->window),
+			}},
+			.depth_stencil_format = ctx->depth_format,
+			.has_depth_stencil_target = true,
+		}
+	}});
+	if (!ctx->instanced_pipeline) {
+		SDL_Log("Failure to create instanced pipeline: %s", SDL_GetError());
+		return SDL_APP_FAILURE;
+	}
+	EGL_PROFILE_END(create_pipeline);
+
+	EGL_PackClose(&ctx->pack);
 	SDL_ReleaseGPUShader(ctx->gpu_dev, frag_shader);
 	SDL_ReleaseGPUShader(ctx->gpu_dev, vert_shader);
-	SDL_free(data);
-	SDL_free(path);
-
-	ctx->prev_tick = SDL_GetTicks();
+	SDL_ReleaseGPUShader(ctx->gpu_dev, instanced_shader);
+	EGL_ArenaReset(&ctx->scratch);
+
+	ctx->prev_tick = SDL_GetTicksNS();
+	SDL_Log("Startup: %.3f ms", (double)(ctx->prev_tick - startup_begin) * 1e-6);
+
+	if (ctx->threaded) {
+		SimState initial;
+		EGL_TransformCopy(&ctx->world.previous_transform, &initial.previous_transform);
+		EGL_TransformCopy(&ctx->world.transform, &initial.transform);
+		if (!EGL_SimThreadStart(&ctx->sim, &initial, sizeof(initial), DELTA_T_NS, SimStep, NULL)) {
+			SDL_Log("Failure to start the simulation thread.");
+			return SDL_APP_FAILURE;
+		}
+	}
 
 	return SDL_APP_CONTINUE;
 }
@@ -395,6 +1239,26 @@ SDL_AppResult SDL_AppEvent(void *appstate, SDL_Event *event)
 		int h = 0;
 		SDL_GetWindowSizeInPixels(ctx->window, &w, &h);
 		glm_perspective(FOVY, (float)w / (float)h, 0.0001, 1000, ctx->projection);
+	} else if (event->type == SDL_EVENT_MOUSE_BUTTON_DOWN) {
+		int w = 0;
+		int h = 0;
+		SDL_GetWindowSize(ctx->window, &w, &h);
+
+		/* The camera sits at the origin, so the ray runs through the unprojected far point */
+		mat4 inverse;
+		vec4 far = { 2.0f * event->button.x / (float)w - 1.0f, 1.0f - 2.0f * event->button.y / (float)h, 1.0f, 1.0f };
+		glm_mat4_inv(ctx->projection, inverse);
+		glm_mat4_mulv(inverse, far, far);
+
+		vec3 origin = { 0.0f, 0.0f, 0.0f };
+		vec3 direction = { far[0] / far[3], far[1] / far[3], far[2] / far[3] };
+		EGL_BvhHit hit;
+		vec2 uv;
+		if (World_Pick(&ctx->world, origin, direction, &hit, uv)) {
+#ifdef DEBUG
+			SDL_Log("Picked triangle %u at uv (%f, %f).", hit.triangle, uv[0], uv[1]);
+#endif
+		}
 	}
 
     return SDL_APP_CONTINUE;
@@ -412,32 +1276,68 @@ SDL_AppResult SDL_AppIterate(void *appstate)
 
 	bool ok;
 
+	EGL_PROFILE_FRAME();
+	EGL_ArenaReset(&ctx->scratch);
+
 	/* Physics */
-	const Uint64 now = SDL_GetTicks();
+	const Uint64 now = SDL_GetTicksNS();
 	const Uint64 dt = now - ctx->prev_tick;
-
-	// Physics
-	ctx->physics_time += dt;
-
-	while (ctx->physics_time >= DELTA_T) {
-		EGL_TransformCopy(&world->transform, &world->render_transform);
-		EGL_TransformRotate(&world->transform, OMEGA * DELTA_T, GLM_YUP);
-
-		ctx->physics_time -= DELTA_T;
+	float alpha;
+
+	EGL_PROFILE_BEGIN(simulate, "simulate");
+
+	if (ctx->threaded) {
+		/* Take whatever the simulation thread published last, never waiting on it */
+		EGL_SimFrame frame;
+		const SimState *s = (const SimState *)EGL_SimThreadLatest(&ctx->sim, &frame);
+		SDL_memcpy(&world->previous_transform, &s->previous_transform, sizeof(Transform));
+		SDL_memcpy(&world->transform, &s->transform, sizeof(Transform));
+		ctx->ticks = frame.tick;
+		alpha = EGL_SimThreadAlpha(&ctx->sim, &frame, EGL_SimNow());
+	} else {
+		ctx->physics_time += dt;
+
+		while (ctx->physics_time >= DELTA_T_NS) {
+			Simulate(&world->transform, &world->previous_transform, ++ctx->ticks);
+			ctx->physics_time -= DELTA_T_NS;
+		}
+		alpha = EGL_SnapshotAlpha(ctx->physics_time, DELTA_T_NS);
 	}
+	EGL_PROFILE_END(simulate);
 
 	
 	/* Game State */
+	EGL_PROFILE_BEGIN(animate, "animate aliens");
+	AnimateSwarm(&ctx->aliens, (float)dt * 1e-9f);
+	EGL_PROFILE_END(animate);
 
 	/* Rendering */
-	glm_quat_slerp(world->render_transform.rotation, world->transform.rotation, (float)ctx->physics_time / (float)DELTA_T, world->render_transform.rotation);
-	EGL_TransformUpdate(&world->render_transform);
+	EGL_PROFILE_BEGIN(interpolate, "interpolate");
+	InterpolatePlanet(ctx, alpha);
 	// Push this responsibility to gpu?
-	glm_mat4_mul(ctx->projection, world->transform.model, ctx->ubo.mvp);
+	glm_mat4_mul(ctx->projection, world->render_transform.model, ctx->ubo.mvp);
+	EGL_PROFILE_END(interpolate);
+
+	EGL_PROFILE_BEGIN(instances, "build instances");
+	ok = BuildInstances(ctx); SDL_assert(ok);
+	EGL_PROFILE_END(instances);
+
+	/* Waiting for the swapchain is not work, so it is left out of the frame's cpu time */
+	const Uint64 acquire_begin = SDL_GetTicksNS();
+	EGL_PROFILE_BEGIN(acquire, "acquire swapchain");
 	SDL_GPUCommandBuffer *cmd_buf = SDL_AcquireGPUCommandBuffer(gpu_dev); SDL_assert(NULL != cmd_buf);
 
 	SDL_GPUTexture *swapchain_tex;
-	ok = SDL_WaitAndAcquireGPUSwapchainTexture(cmd_buf, window, &swapchain_tex, NULL, NULL); SDL_assert(ok);
+	Uint32 swapchain_w;
+	Uint32 swapchain_h;
+	ok = SDL_WaitAndAcquireGPUSwapchainTexture(cmd_buf, window, &swapchain_tex, &swapchain_w, &swapchain_h); SDL_assert(ok);
+	EGL_PROFILE_END(acquire);
+	const Uint64 acquire_end = SDL_GetTicksNS();
+
+	EGL_PROFILE_BEGIN(record, "record commands");
+	RetireUploads(ctx);
+	ok = StageBuffer(ctx, ctx->instance_buffer, 0, ctx->batch.instances, ctx->batch.count * (Uint32)sizeof(EGL_Instance)); SDL_assert(ok);
+	ok = FlushUploads(ctx, cmd_buf); SDL_assert(ok);
 
 	/* Check for NULL swapchain texture which can occur if the window resizes */
 	if (swapchain_tex) {
@@ -447,18 +1347,69 @@ SDL_AppResult SDL_AppIterate(void *appstate)
 			.clear_color = { .r=0.0, .g=0.2, .b=0.4, .a=1.0 },
 			.store_op = SDL_GPU_STOREOP_STORE,
 		};
+		ok = ResizeDepth(ctx, swapchain_w, swapchain_h); SDL_assert(ok);
+		SDL_GPUDepthStencilTargetInfo depth_target = {
+			.texture = ctx->depth_texture,
+			.clear_depth = 1.0f,
+			.load_op = SDL_GPU_LOADOP_CLEAR,
+			.store_op = SDL_GPU_STOREOP_DONT_CARE,
+		};
 
-		SDL_GPURenderPass *render_pass = SDL_BeginGPURenderPass(cmd_buf, &color_target, 1, NULL);
+		SDL_GPURenderPass *render_pass = SDL_BeginGPURenderPass(cmd_buf, &color_target, 1, &depth_target);
 		SDL_BindGPUGraphicsPipeline(render_pass, pipeline);
 		SDL_BindGPUVertexBuffers(render_pass, 0, (SDL_GPUBufferBinding[]){{ .buffer = ctx->vertex_buffer }}, 1);
 		SDL_BindGPUIndexBuffer(render_pass, (SDL_GPUBufferBinding[]){{ .buffer = ctx->index_buffer }}, sizeof(uint16_t));
 		SDL_PushGPUVertexUniformData(cmd_buf, 0, &ctx->ubo, sizeof(ctx->ubo));
 		SDL_BindGPUFragmentSamplers(render_pass, 0, (SDL_GPUTextureSamplerBinding[]){{ .texture = ctx->brick_texture, .sampler = ctx->sampler }}, 1);
 		SDL_DrawGPUIndexedPrimitives(render_pass, 6, 1, 0, 0, 0);
+
+		/* One call per mesh and material, for every instance of them */
+		SDL_BindGPUGraphicsPipeline(render_pass, ctx->instanced_pipeline);
+		SDL_BindGPUVertexBuffers(render_pass, 0, (SDL_GPUBufferBinding[]){
+			{ .buffer = ctx->vertex_buffer },
+			{ .buffer = ctx->instance_buffer },
+		}, 2);
+		SDL_PushGPUVertexUniformData(cmd_buf, 0, &ctx->ubo, sizeof(ctx->ubo));
+		for (Uint32 i = 0; i < ctx->batch.draw_count; i++) {
+			const EGL_DrawBatch *draw = &ctx->batch.draws[i];
+			SDL_DrawGPUIndexedPrimitives(render_pass, 6, draw->count, 0, 0, draw->first);
+		}
 		SDL_EndGPURenderPass(render_pass);
 	}
+	EGL_PROFILE_END(record);
+
+	EGL_PROFILE_BEGIN(submit, "submit");
+	ok = SubmitFrame(ctx, cmd_buf); SDL_assert(ok);
+	EGL_PROFILE_END(submit);
+
+	const Uint64 frame_end = SDL_GetTicksNS();
+	EGL_FrameStatsAdd(&ctx->stats, (acquire_begin - now) + (frame_end - acquire_end), frame_end);
+
+	EGL_AllocCounts allocs;
+	EGL_AllocFrame(&allocs);
+	ctx->window_allocs.allocs += allocs.allocs;
+	ctx->window_allocs.bytes += allocs.bytes;
+	if (ctx->alloc_budget >= 0 && ctx->stats.frames > ALLOC_WARMUP && allocs.allocs > (Uint64)ctx->alloc_budget) {
+		SDL_Log("Frame %llu allocated %llu times (%llu bytes), over the budget of %lld.", (unsigned long long)ctx->stats.frames,
+			(unsigned long long)allocs.allocs, (unsigned long long)allocs.bytes, (long long)ctx->alloc_budget);
+		EGL_AllocPrintSites(stderr, 8);
+		return SDL_APP_FAILURE;
+	}
 
-	ok = SDL_SubmitGPUCommandBuffer(cmd_buf); SDL_assert(ok);
+	if (ctx->stats.frames % STATS_WINDOW == 0) {
+#ifdef DEBUG
+		EGL_FrameReport r;
+		EGL_FrameStatsWindow(&ctx->stats, &r);
+		SDL_Log("cpu   p50 %5.2f  p95 %5.2f  p99 %5.2f  max %5.2f ms",
+			r.cpu.p50 / 1e6, r.cpu.p95 / 1e6, r.cpu.p99 / 1e6, r.cpu.max / 1e6);
+		SDL_Log("frame p50 %5.2f  p95 %5.2f  p99 %5.2f  max %5.2f ms, missed %llu vsyncs in %llu frames",
+			r.interval.p50 / 1e6, r.interval.p95 / 1e6, r.interval.p99 / 1e6, r.interval.max / 1e6,
+			(unsigned long long)r.missed, (unsigned long long)r.frames);
+		SDL_Log("alloc %.2f calls, %.0f bytes per frame",
+			(double)ctx->window_allocs.allocs / STATS_WINDOW, (double)ctx->window_allocs.bytes / STATS_WINDOW);
+#endif
+		SDL_memset(&ctx->window_allocs, 0, sizeof(ctx->window_allocs));
+	}
 
 	ctx->prev_tick = now;
 
@@ -469,18 +1420,49 @@ void SDL_AppQuit(void *appstate, SDL_AppResult result)
 {
 	if (appstate) {
 		AppState *ctx = (AppState *)appstate;
+		EGL_SimThreadStop(&ctx->sim);
+		EGL_AssetLoaderFree(&ctx->loader);
+		EGL_ProfileStop();
+		if (ctx->stats_path && !EGL_FrameStatsWrite(&ctx->stats, ctx->stats_path)) {
+			SDL_Log("Failure to write frame statistics to %s.", ctx->stats_path);
+		}
+		EGL_FrameStatsFree(&ctx->stats);
 		SDL_DestroyRenderer(ctx->renderer);
-		SDL_DestroyWindow(ctx->window);
 
 		//if (ctx->font.ttf) {
 		//	TTF_CloseFont(ctx->font.ttf);
 		//}
 
 		//TTF_Quit();
-		SDL_free(ctx->world.indices);
-		SDL_free(ctx->world.vertices);
-		SDL_free(ctx->world.normals);
-		SDL_free(ctx->world.uvs);
+		World_Free(&ctx->world);
+		while (WaitUploads(ctx)) {
+		}
+		if (ctx->gpu_dev) {
+			SDL_ReleaseGPUGraphicsPipeline(ctx->gpu_dev, ctx->instanced_pipeline);
+			SDL_ReleaseGPUGraphicsPipeline(ctx->gpu_dev, ctx->pipeline);
+			SDL_ReleaseGPUTexture(ctx->gpu_dev, ctx->depth_texture);
+			SDL_ReleaseGPUSampler(ctx->gpu_dev, ctx->sampler);
+			SDL_ReleaseGPUBuffer(ctx->gpu_dev, ctx->instance_buffer);
+		}
+		EGL_InstanceBatchFree(&ctx->batch);
+		FreeSwarm(&ctx->aliens);
+		FreeSwarm(&ctx->towers);
+		if (ctx->gpu_dev) {
+			SDL_ReleaseGPUBuffer(ctx->gpu_dev, ctx->index_buffer);
+			SDL_ReleaseGPUBuffer(ctx->gpu_dev, ctx->vertex_buffer);
+			SDL_ReleaseGPUTexture(ctx->gpu_dev, ctx->brick_texture);
+			SDL_ReleaseGPUTransferBuffer(ctx->gpu_dev, ctx->staging_buffer);
+		}
+		EGL_StagingFree(&ctx->staging);
+		if (ctx->gpu_dev) {
+			SDL_ReleaseWindowFromGPUDevice(ctx->gpu_dev, ctx->window);
+			SDL_DestroyGPUDevice(ctx->gpu_dev);
+		}
+		SDL_DestroyWindow(ctx->window);
+		EGL_PackClose(&ctx->pack);
+		EGL_TransformBatchFree(&ctx->planet_batch);
+		EGL_SnapshotFree(&ctx->planet);
+		EGL_ArenaFree(&ctx->scratch);
 		SDL_free(ctx);
 	}
 }
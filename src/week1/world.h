@@ -6,6 +6,11 @@
 #include <stdint.h>
 #include <cglm/mat4.h>
 #include <EGL/EGL_3d.h>
+#include <EGL/EGL_arena.h>
+#include <EGL/EGL_mesh.h>
+#include <EGL/EGL_bvh.h>
+#include <EGL/EGL_flowfield.h>
+#include <EGL/EGL_parallel.h>
 
 
 typedef struct {
@@ -21,46 +26,207 @@ typedef struct {
 	float *vertices; // vec3: [(x,y,z)(x,y,z)...]
 	float *normals;  // vec3: [(x,y,z)(x,y,z)...]
 	float *uvs;      // vec2: [(u,v)(u,v)(u,v)...]
+	EGL_Arena mesh_arena; // Holds indices, vertices, normals and uvs for the world's lifetime.
 
-	Transform transform;
-	Transform render_transform;
+	EGL_MeshAdjacency adjacency; // Welded connectivity of the sphere.
+	EGL_FlowField flow;          // Paths from every node to the defended pentagon.
+	uint32_t base;               // Node of the defended pentagon.
+	EGL_Bvh bvh;                 // Object space triangles for picking.
+
+	Transform transform;          // State at the latest simulation step.
+	Transform previous_transform; // State at the step before, to interpolate from.
+	Transform render_transform;   // Interpolated state being drawn.
 } World;
 
-static inline void World_Deserialize(World *w, char *data) {
-	int offset = 0;
+/**
+ * Deserialize the world mesh from the sphere.bin format.
+ *
+ * The file holds size-prefixed blocks of indices, vertices, normals and uvs,
+ * optionally followed by a size-prefixed block of serialized adjacency. If the
+ * adjacency block is missing, malformed or does not match the mesh (a stale
+ * file from before the mesh changed), it is built from the mesh.
+ *
+ * The four mesh arrays share one arena sized to fit them exactly, so loading
+ * makes one allocation rather than four and World_Free releases them at once.
+ *
+ * @param w The world to initialize.
+ * @param data The file contents.
+ * @param size The size of the file in bytes.
+ * @return False if the mesh blocks run past the end of the data, the mesh
+ * memory could not be allocated or the adjacency could not be loaded or built.
+ */
+static inline bool World_Deserialize(World *w, const char *data, size_t size) {
+	/* Size the arena from the block headers, each checked against the data, before copying anything */
+	uint32_t block_sizes[4];
+	size_t arena_size = 0;
+	for (size_t offset = 0, i = 0; i < 4; i++) {
+		uint32_t block_size;
+		if (offset + 4 > size) {
+			return false;
+		}
+		SDL_memcpy(&block_size, data + offset, 4);
+		if (block_size > size - offset - 4) {
+			return false;
+		}
+		block_sizes[i] = block_size;
+		arena_size += block_size + EGL_ARENA_ALIGN;
+		offset += 4 + block_size;
+	}
+	if (!EGL_ArenaInit(&w->mesh_arena, arena_size)) {
+		return false;
+	}
 
-	size_t indices_size = *(uint32_t *)(data + offset);
-	offset += 4;
-	w->indices = (uint32_t *)SDL_malloc(indices_size);
-	SDL_memcpy((void *)w->indices, (void *)(data + offset), indices_size);
-	offset += indices_size;
+	void *blocks[4];
+	size_t offset = 0;
+	for (int i = 0; i < 4; i++) {
+		offset += 4;
+		blocks[i] = EGL_ArenaAlloc(&w->mesh_arena, block_sizes[i]);
+		if (!blocks[i]) {
+			EGL_ArenaFree(&w->mesh_arena);
+			return false;
+		}
+		SDL_memcpy(blocks[i], data + offset, block_sizes[i]);
+		offset += block_sizes[i];
+	}
+	w->indices = (uint32_t *)blocks[0];
+	w->vertices = (float *)blocks[1];
+	w->normals = (float *)blocks[2];
+	w->uvs = (float *)blocks[3];
 
-	size_t vertices_size = *(uint32_t *)(data + offset);
-	offset += 4;
-	w->vertices = (float *)SDL_malloc(vertices_size);
-	SDL_memcpy((void *)w->vertices, (void *)(data + offset), vertices_size);
-	offset += vertices_size;
+	w->indices_size = block_sizes[0];
+	w->vertices_size = block_sizes[1];
+	w->normals_size = block_sizes[2];
+	w->uvs_size = block_sizes[3];
 
-	size_t normals_size = *(uint32_t *)(data + offset);
-	offset += 4;
-	w->normals = (float *)SDL_malloc(normals_size);
-	SDL_memcpy((void *)w->normals, (void *)(data + offset), normals_size);
-	offset += normals_size;
+	w->index_count = w->indices_size / 4;    // 4 bytes
+	w->vertex_count = w->vertices_size / 12; // 4 bytes per 3 coordinates
+	w->normal_count = w->normals_size / 12;  // 4 bytes per 3 coordinates
+	w->uv_count = w->uvs_size / 8;           // 4 bytes per 2 coordinates
+
+	if (offset + 4 <= size) {
+		uint32_t adjacency_size;
+		SDL_memcpy(&adjacency_size, data + offset, 4);
+		offset += 4;
+		if (adjacency_size <= size - offset && EGL_MeshAdjacencyDeserialize(&w->adjacency, data + offset, adjacency_size)) {
+			if (EGL_MeshAdjacencyValidate(&w->adjacency, w->indices, w->index_count, w->vertex_count)) {
+				return true;
+			}
+			EGL_MeshAdjacencyFree(&w->adjacency);
+			SDL_Log("Ignoring adjacency in world data that does not match its mesh.");
+		} else {
+			SDL_Log("Ignoring malformed adjacency in world data.");
+		}
+	}
 
-	size_t uvs_size = *(uint32_t *)(data + offset);
+	return EGL_MeshAdjacencyBuild(&w->adjacency, w->indices, w->index_count, w->vertices, w->vertex_count);
+}
+
+/**
+ * Serialize the world mesh and its adjacency into the sphere.bin format.
+ *
+ * @param w The world to serialize.
+ * @param size Output size of the returned buffer in bytes.
+ * @return A buffer to be freed with SDL_free, or NULL on failure.
+ */
+static inline char *World_Serialize(World *w, size_t *size) {
+	const uint32_t adjacency_size = (uint32_t)EGL_MeshAdjacencySerializedSize(&w->adjacency);
+	*size = 5 * 4 + w->indices_size + w->vertices_size + w->normals_size + w->uvs_size + adjacency_size;
+
+	char *data = (char *)SDL_malloc(*size);
+	if (!data) {
+		return NULL;
+	}
+
+	size_t offset = 0;
+	const uint32_t sizes[4] = { w->indices_size, w->vertices_size, w->normals_size, w->uvs_size };
+	const void *blocks[4] = { w->indices, w->vertices, w->normals, w->uvs };
+	for (int i = 0; i < 4; i++) {
+		SDL_memcpy(data + offset, &sizes[i], 4);
+		offset += 4;
+		SDL_memcpy(data + offset, blocks[i], sizes[i]);
+		offset += sizes[i];
+	}
+
+	SDL_memcpy(data + offset, &adjacency_size, 4);
 	offset += 4;
-	w->uvs = (float *)SDL_malloc(uvs_size);
-	SDL_memcpy((void *)w->uvs, (void *)(data + offset), uvs_size);
-
-	w->indices_size = indices_size;
-	w->vertices_size = vertices_size;
-	w->normals_size = normals_size;
-	w->uvs_size = uvs_size;
-
-	w->index_count = indices_size / 4;    // 4 bytes
-	w->vertex_count = vertices_size / 12; // 4 bytes per 3 coordinates
-	w->normal_count = normals_size / 12;  // 4 bytes per 3 coordinates
-	w->uv_count = uvs_size / 8;           // 4 bytes per 2 coordinates
+	EGL_MeshAdjacencySerialize(&w->adjacency, data + offset);
+
+	return data;
+}
+
+/**
+ * Place the base on the first pentagon (degree 5 node) and build the flow field
+ * aliens follow towards it.
+ *
+ * @param w The world (its adjacency must be loaded).
+ * @return False on allocation failure.
+ */
+static inline bool World_InitFlow(World *w) {
+	if (!EGL_FlowFieldInit(&w->flow, &w->adjacency)) {
+		return false;
+	}
+
+	w->base = 0;
+	for (uint32_t n = 0; n < w->adjacency.node_count; n++) {
+		if (EGL_MeshNodeDegree(&w->adjacency, n) == 5) {
+			w->base = n;
+			break;
+		}
+	}
+
+	EGL_FlowFieldSetGoal(&w->flow, w->base, true);
+	EGL_FlowFieldBuild(&w->flow, EGL_ThreadCount());
+	return true;
+}
+
+/**
+ * Build the picking BVH over the world mesh.
+ *
+ * @param w The world (its mesh must be loaded).
+ * @return False on allocation failure or a malformed mesh.
+ */
+static inline bool World_InitPicking(World *w) {
+	return EGL_BvhBuild(&w->bvh, w->indices, w->index_count, w->vertices, w->vertex_count);
+}
+
+/**
+ * Cast a world space ray against the planet as it is drawn.
+ *
+ * The ray is moved into object space with the inverse render transform, so the
+ * BVH never needs rebuilding as the planet turns. An affine transform keeps the
+ * ray parameter, so hit->t is a world space distance in units of the direction.
+ *
+ * @param w The world.
+ * @param origin The ray origin in world space.
+ * @param direction The ray direction in world space.
+ * @param hit Output nearest hit.
+ * @param uv Output texture coordinate at the hit.
+ * @return True if the ray hits the planet.
+ */
+static inline bool World_Pick(World *w, vec3 origin, vec3 direction, EGL_BvhHit *hit, vec2 uv) {
+	mat4 inverse;
+	vec3 o, d;
+	glm_mat4_inv(w->render_transform.model, inverse);
+	glm_mat4_mulv3(inverse, origin, 1.0f, o);
+	glm_mat4_mulv3(inverse, direction, 0.0f, d);
+
+	if (!EGL_BvhRaycast(&w->bvh, o, d, INFINITY, hit)) {
+		return false;
+	}
+	EGL_BvhInterpolate(hit, w->indices, w->uvs, 2, uv);
+	return true;
+}
+
+/** Free all memory held by the world mesh. */
+static inline void World_Free(World *w) {
+	EGL_ArenaFree(&w->mesh_arena);
+	w->indices = NULL;
+	w->vertices = NULL;
+	w->normals = NULL;
+	w->uvs = NULL;
+	EGL_FlowFieldFree(&w->flow);
+	EGL_BvhFree(&w->bvh);
+	EGL_MeshAdjacencyFree(&w->adjacency);
 }
 
 